@@ -12,6 +12,7 @@
 #define MAX_COMMAND_LINE_FILES 4096
 #define MAX_COMMAND_LINE_RUN_ARGS 2048
 #define MAX_THREADS 0xFFFF
+#define MAX_CODEGEN_UNITS 256
 #define DEFAULT_SYMTAB_SIZE (256 * 1024)
 #define DEFAULT_SWITCHRANGE_MAX_SIZE (256)
 #define DEFAULT_SWITCH_JUMP_MAX_SIZE (0x3FFF)
@@ -48,6 +49,7 @@ typedef enum
 	COMMAND_UNIT_TEST,
 	COMMAND_PRINT_SYNTAX,
 	COMMAND_PROJECT,
+	COMMAND_DAEMON,
 } CompilerCommand;
 
 typedef enum
@@ -198,6 +200,63 @@ typedef enum
 	STRIP_UNUSED_ON = 1
 } StripUnused;
 
+typedef enum
+{
+	STRIP_INTROSPECTION_NOT_SET = -1,
+	STRIP_INTROSPECTION_OFF = 0,
+	STRIP_INTROSPECTION_ON = 1
+} StripIntrospection;
+
+typedef enum
+{
+	INCREMENTAL_NOT_SET = -1,
+	INCREMENTAL_OFF = 0,
+	INCREMENTAL_ON = 1
+} Incremental;
+
+typedef enum
+{
+	LINKER_ICF_NOT_SET = -1,
+	LINKER_ICF_NONE = 0,
+	LINKER_ICF_SAFE = 1,
+	LINKER_ICF_ALL = 2,
+} LinkerIcf;
+
+typedef enum
+{
+	THIN_LTO_NOT_SET = -1,
+	THIN_LTO_OFF = 0,
+	THIN_LTO_ON = 1
+} ThinLto;
+
+typedef enum
+{
+	DEBUG_DEDUP_NOT_SET = -1,
+	DEBUG_DEDUP_OFF = 0,
+	DEBUG_DEDUP_ON = 1
+} DebugDedup;
+
+typedef enum
+{
+	SPLIT_DWARF_NOT_SET = -1,
+	SPLIT_DWARF_OFF = 0,
+	SPLIT_DWARF_ON = 1
+} SplitDwarf;
+
+typedef enum
+{
+	LLVM_VERIFY_NOT_SET = -1,
+	LLVM_VERIFY_OFF = 0,
+	LLVM_VERIFY_ON = 1
+} LlvmVerify;
+
+typedef enum
+{
+	PGO_INSTRUMENT_NOT_SET = -1,
+	PGO_INSTRUMENT_OFF = 0,
+	PGO_INSTRUMENT_ON = 1
+} PgoInstrument;
+
 typedef enum
 {
 	LINK_LIBC_NOT_SET = -1,
@@ -484,9 +543,20 @@ typedef struct BuildOptions_
 		int api_version;
 	} android;
 	int build_threads;
+	int codegen_units;
+	int link_threads;
 	const char **libraries_to_fetch;
 	const char **files;
 	const char *test_filter;
+	const char *test_junit;
+	const char *test_json;
+	int test_jobs;
+	const char *benchmark_json;
+	int benchmark_time;
+	const char *benchmark_save;
+	const char *benchmark_compare;
+	const char *benchmark_threshold;
+	bool benchmark_counters;
 	const char **args;
 	const char **feature_names;
 	const char **removed_feature_names;
@@ -495,6 +565,9 @@ typedef struct BuildOptions_
 	const char *target_select;
 	const char *path;
 	const char *vendor_download_path;
+	const char *download_cache_dir;
+	const char *daemon_socket;
+	bool watch;
 	const char *template;
 	const char **unchecked_directories;
 	LinkerType linker_type;
@@ -544,12 +617,15 @@ typedef struct BuildOptions_
 	bool benchmark_mode;
 	bool test_mode;
 	bool lsp_mode;
+	bool lsp_server;
 	bool no_entry;
 	bool no_obj;
 	bool no_headers;
 	bool read_stdin;
 	bool print_output;
 	bool print_input;
+	bool print_opt_stats;
+	bool audit_init;
 	bool run_once;
 	bool suppress_run;
 	bool old_slice_copy;
@@ -564,7 +640,13 @@ typedef struct BuildOptions_
 	const char *asm_out;
 	const char *header_out;
 	const char *obj_out;
+	const char *object_cache_dir;
 	const char *script_dir;
+	const char *trace_file;
+	const char *stats_json;
+	const char *json_dir;
+	const char *deps_file;
+	const char *pgo_profile;
 	RelocModel reloc_model;
 	X86VectorCapability x86_vector_capability;
 	X86CpuSet x86_cpu_set;
@@ -575,6 +657,17 @@ typedef struct BuildOptions_
 	UseStdlib use_stdlib;
 	LinkLibc link_libc;
 	StripUnused strip_unused;
+	StripIntrospection strip_introspection;
+	Incremental incremental;
+	ThinLto thin_lto;
+	LinkerIcf linker_icf;
+	DebugDedup debug_dedup;
+	SplitDwarf split_dwarf;
+	LlvmVerify llvm_verify;
+	const char *llvm_passes;
+	const char **module_llvm_passes;
+	const char **module_safe;
+	PgoInstrument pgo_instrument;
 	OptimizationLevel optlevel;
 	SizeOptimizationLevel optsize;
 	RiscvFloatCapability riscv_float_capability;
@@ -650,6 +743,8 @@ typedef struct
 	const char **link_args;
 	const char *build_dir;
 	const char *object_file_dir;
+	const char *object_cache_dir;
+	const char *pgo_profile;
 	const char *output_dir;
 	const char *ir_file_dir;
 	const char *asm_file_dir;
@@ -664,6 +759,7 @@ typedef struct
 	bool benchmark_output;
 	bool test_output;
 	bool lsp_output;
+	bool lsp_server;
 	bool output_headers;
 	bool output_ast;
 	bool lex_only;
@@ -672,6 +768,7 @@ typedef struct
 	bool emit_llvm;
 	bool emit_asm;
 	bool emit_object_files;
+	bool objects_in_memory;
 	bool benchmarking;
 	bool testing;
 	bool silent;
@@ -679,13 +776,20 @@ typedef struct
 	bool read_stdin;
 	bool print_output;
 	bool print_input;
+	bool print_opt_stats;
+	bool audit_init;
 	bool print_linking;
 	bool no_entry;
 	bool kernel_build;
 	bool silence_deprecation;
 	bool print_stats;
+	const char *stats_json;
+	const char *json_dir;
+	const char *deps_file;
 	bool old_slice_copy;
 	int build_threads;
+	int codegen_units;
+	int link_threads;
 	TrustLevel trust_level;
 	OptimizationSetting optsetting;
 	OptimizationLevel optlevel;
@@ -698,6 +802,17 @@ typedef struct
 	LinkLibc link_libc;
 	ShowBacktrace show_backtrace;
 	StripUnused strip_unused;
+	StripIntrospection strip_introspection;
+	Incremental incremental;
+	ThinLto thin_lto;
+	LinkerIcf linker_icf;
+	DebugDedup debug_dedup;
+	SplitDwarf split_dwarf;
+	LlvmVerify llvm_verify;
+	const char *llvm_passes;
+	const char **module_llvm_passes;
+	const char **module_safe;
+	PgoInstrument pgo_instrument;
 	DebugInfo debug_info;
 	MergeFunctions merge_functions;
 	UnrollLoops unroll_loops;
@@ -798,6 +913,14 @@ static BuildTarget default_build_target = {
 		.slp_vectorization = VECTORIZATION_NOT_SET,
 		.loop_vectorization = VECTORIZATION_NOT_SET,
 		.strip_unused = STRIP_UNUSED_NOT_SET,
+		.strip_introspection = STRIP_INTROSPECTION_NOT_SET,
+		.incremental = INCREMENTAL_NOT_SET,
+		.thin_lto = THIN_LTO_NOT_SET,
+		.linker_icf = LINKER_ICF_NOT_SET,
+		.debug_dedup = DEBUG_DEDUP_NOT_SET,
+		.split_dwarf = SPLIT_DWARF_NOT_SET,
+		.llvm_verify = LLVM_VERIFY_NOT_SET,
+		.pgo_instrument = PGO_INSTRUMENT_NOT_SET,
 		.symtab_size = DEFAULT_SYMTAB_SIZE,
 		.reloc_model = RELOC_DEFAULT,
 		.cc = NULL,
@@ -119,6 +119,12 @@ static const char *backtrace_levels[2] = {
 	[SHOW_BACKTRACE_ON] = "on",
 };
 
+static const char *linker_icf[3] = {
+	[LINKER_ICF_NONE] = "none",
+	[LINKER_ICF_SAFE] = "safe",
+	[LINKER_ICF_ALL] = "all",
+};
+
 static const char *reloc_models[5] = {
 	[RELOC_NONE] = "none",
 	[RELOC_SMALL_PIC] = "pic",
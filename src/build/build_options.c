@@ -70,6 +70,7 @@ static void usage(bool full)
 	print_cmd("dynamic-lib <file1> [<file2> ...]", "Compile files without a project into a dynamic library.");
 	print_cmd("vendor-fetch <library> ...", "Fetches one or more libraries from the vendor collection.");
 	print_cmd("project <subcommand> ...", "Manipulate or view project files.");
+	print_cmd("daemon <socket>", "Keep the compiler and standard library loaded, serving requests from '--daemon <socket>'.");
 	PRINTF("");
 	full ? PRINTF("Options:") : PRINTF("Common options:");
 	print_opt("-h -hh --help", "Print the help, -h for the normal options, -hh for the full help.");
@@ -78,9 +79,11 @@ static void usage(bool full)
 	print_opt("-v -vv -vvv", "Verbose output, -v for default, -vv and -vvv gives more information.");
 	print_opt("-E", "Lex only.");
 	print_opt("-P", "Only parse and output the AST as JSON.");
+	print_opt("--json-dir=<dir>", "With -P, write the JSON as one file per module to <dir>, leaving unchanged files untouched.");
 	print_opt("-C", "Only lex, parse and check.");
 	print_opt("-", "Read code from standard in.");
 	print_opt("-o <file>", "Write output to <file>.");
+	print_opt("--emit-deps=<file>", "Write the files the build depends on to <file>, as a Makefile dependency file.");
 	print_opt("-O0", "Safe, no optimizations, emit debug info.");
 	print_opt("-O1", "Safe, high optimization, emit debug info.");
 	print_opt("-O2", "Unsafe, high optimization, emit debug info.");
@@ -105,13 +108,15 @@ static void usage(bool full)
 		print_opt("--no-entry", "Do not generate (or require) a main function.");
 		print_opt("--path <dir>", "Use this as the base directory for the current command.");
 		print_opt("--template <template>", "Select template for 'init': \"exe\", \"static-lib\", \"dynamic-lib\" or a path.");
-		print_opt("--symtab <value>", "Sets the preferred symtab size.");
+		print_opt("--symtab <value>", "Sets the initial symtab size.");
 		print_opt("--run-once", "After running the output file, delete it immediately.");
 		print_opt("--suppress-run", "Build but do not run on test/benchmark options.");
 		print_opt("--trust=<option>", "Trust level: none (default), include ($include allowed), full ($exec / exec allowed).");
 		print_opt("--output-dir <dir>", "Override general output directory.");
 		print_opt("--build-dir <dir>", "Override build output directory.");
 		print_opt("--obj-out <dir>", "Override object file output directory.");
+		print_opt("--object-cache <dir>", "Share object files between builds through a cache directory.");
+		print_opt("--download-cache <dir>", "Keep libraries fetched by 'vendor-fetch' and 'project fetch' in a cache directory.");
 		print_opt("--script-dir <dir>", "Override the base directory for $exec.");
 		print_opt("--llvm-out <dir>", "Override llvm output directory for '--emit-llvm'.");
 		print_opt("--asm-out <dir> ", "Override asm output directory for '--emit-asm'.");
@@ -123,18 +128,37 @@ static void usage(bool full)
 		print_opt("--no-headers", "Do not generate C headers when building a library.");
 		print_opt("--target <target>", "Compile for a particular architecture + OS target.");
 		print_opt("--threads <number>", "Set the number of threads to use for compilation.");
+		print_opt("--trace-out=<file>", "Write a Chrome trace event timeline of the compilation to the file.");
+		print_opt("--stats-json=<file>", "Write the compile time of each phase and the memory use as JSON to the file.");
+		print_opt("--huge-pages", "Back compiler memory with huge pages where available, and prefault it.");
+		print_opt("--daemon <socket>", "Run the command in a 'c3c daemon' listening on the socket, if there is one.");
+		print_opt("--watch", "Rebuild whenever a source, $include or $embed file or the project file changes.");
 		print_opt("--safe=<yes|no>", "Turn safety (contracts, runtime bounds checking, null pointer checks etc) on or off.");
+		print_opt("--module-safe <module>=<yes|no>", "Turn runtime checks on or off for a module, or for 'foo::*' a module and its submodules.");
 		print_opt("--panic-msg=<yes|no>", "Turn panic message output on or off.");
 		print_opt("--optlevel=<option>", "Code optimization level: none, less, more, max.");
 		print_opt("--optsize=<option>", "Code size optimization: none, small, tiny.");
 		print_opt("--single-module=<yes|no>", "Compile all modules together, enables more inlining.");
+		print_opt("--thin-lto=<yes|no>", "Emit ThinLTO bitcode and optimize across modules when linking, in parallel.");
+		print_opt("--codegen-units <number>", "Split large modules into up to this many objects, so they are compiled in parallel.");
+		print_opt("--link-threads <number>", "Set the number of threads the built-in linker uses (default: same as --threads).");
+		print_opt("--icf=<none|safe|all>", "Fold identical code sections when using the built-in linker.");
+		print_opt("--pgo-instrument=<yes|no>", "Build a binary which writes an execution profile when it exits.");
+		print_opt("--pgo-profile <file>", "Optimize using a .profdata file merged from instrumented runs.");
+		print_opt("--llvm-passes <pipeline>", "Replace the LLVM pass pipeline, e.g. 'default<O3>,function(loop-distribute)'.");
+		print_opt("--module-llvm-passes <module>=<pipeline>", "Use this pipeline for a module, or for 'foo::*' a module and its submodules.");
+		print_opt("--llvm-verify=<yes|no>", "Verify the IR after every LLVM pass (default: only with --emit-llvm).");
+		print_opt("--incremental=<yes|no>", "Keep object files in the build directory and reuse those of unchanged modules. (default: no)");
 		print_opt("--show-backtrace=<yes|no>", "Show detailed backtrace on segfaults.");
 		print_opt("--lsp", "Emit data about errors suitable for a LSP.");
+		print_opt("--lsp-server", "Like --lsp, but keep the standard library parsed and check the project every time 'check' is read from stdin.");
 		print_opt("--use-old-slice-copy", "Use the old slice copy semantics.");
 	}
 	PRINTF("");
 	print_opt("-g", "Emit debug info.");
 	print_opt("-g0", "Emit no debug info.");
+	print_opt("--debug-dedup=<yes|no>", "Describe each type fully in only one object and use declarations elsewhere.");
+	print_opt("--split-dwarf=<yes|no>", "Write the DWARF debug info to .dwo files next to the objects, which the linker skips.");
 	if (full)
 	{
 		PRINTF("");
@@ -145,6 +169,15 @@ static void usage(bool full)
 		print_opt("--test-noleak", "Disable tracking allocator and memory leak detection for tests");
 		print_opt("--test-nocapture", "Disable test stdout capturing, all tests can print as they run");
 		print_opt("--test-quiet", "Run tests without printing full names, printing output only on failure");
+		print_opt("--test-jobs=<number>", "Run the tests in this many forked worker processes (POSIX only).");
+		print_opt("--test-junit <file>", "Write the test results as a JUnit XML report to <file>.");
+		print_opt("--test-json <file>", "Write the test results as a JSON report to <file>.");
+		print_opt("--benchmark-time=<ms>", "Time budget in milliseconds for measuring each benchmark.");
+		print_opt("--benchmark-json <file>", "Write the benchmark results as a JSON report to <file>.");
+		print_opt("--benchmark-counters", "Also report hardware counters for each benchmark (Linux only).");
+		print_opt("--save-baseline=<name>", "Save the benchmark results as a baseline in the build directory.");
+		print_opt("--compare=<name>", "Compare the benchmark results to a saved baseline, failing on regressions.");
+		print_opt("--regression-threshold=<percent>", "Slowdown that counts as a benchmark regression, default is 5.");
 	}
 	PRINTF("");
 	print_opt("-l <library>", "Link with the static or dynamic library provided.");
@@ -168,6 +201,7 @@ static void usage(bool full)
 		print_opt("--riscvfloat=<option>", "Set type of RISC-V float support: none, float, double.");
 		print_opt("--memory-env=<option>", "Set the memory environment: normal, small, tiny, none.");
 		print_opt("--strip-unused=<yes|no>", "Strip unused code and globals from the output. (default: yes)");
+		print_opt("--strip-introspection=<yes|no>", "Only emit type introspection for types whose typeid is used at runtime. (default: no)");
 		print_opt("--fp-math=<option>", "FP math behaviour: strict, relaxed, fast.");
 		print_opt("--win64-simd=<option>", "Win64 SIMD ABI: array, full.");
 		print_opt("--win-debug=<option>", "Select debug output on Windows: codeview or dwarf (default: codeview).");
@@ -190,6 +224,8 @@ static void usage(bool full)
 		PRINTF("");
 		print_opt("--print-output", "Print the object files created to stdout.");
 		print_opt("--print-input", "Print inputted C3 files to stdout.");
+		print_opt("--audit-init", "Time each @init function at startup and print the result to stderr.");
+		print_opt("--print-opt-stats", "Print the optimization time per pass and the instruction counts per function, one JSON line per module.");
 		PRINTF("");
 		print_opt("--winsdk <dir>", "Set the directory for Windows system library files for cross compilation.");
 		print_opt("--wincrt=<option>", "Windows CRT linking: none, static-debug, static, dynamic-debug (default if debug info enabled), dynamic (default).");
@@ -396,6 +432,13 @@ static void parse_command(BuildOptions *options)
 		options->command = COMMAND_STATIC_LIB;
 		return;
 	}
+	if (arg_match("daemon"))
+	{
+		options->command = COMMAND_DAEMON;
+		if (at_end() || next_is_opt()) error_exit("error: daemon needs a socket path.");
+		options->daemon_socket = next_arg();
+		return;
+	}
 	if (arg_match("vendor-fetch"))
 	{
 		options->command = COMMAND_VENDOR_FETCH;
@@ -422,6 +465,7 @@ static void parse_command(BuildOptions *options)
 	{
 		options->command = COMMAND_BENCHMARK;
 		options->benchmarking = true;
+		parse_optional_target(options);
 		return;
 	}
 	if (arg_match("test"))
@@ -768,6 +812,59 @@ static void parse_option(BuildOptions *options)
 				options->test_quiet = true;
 				return;
 			}
+			if ((argopt = match_argopt("test-jobs")))
+			{
+				int jobs = atoi(argopt);
+				if (jobs < 1) error_exit("error: --test-jobs needs a valid integer 1 or higher.");
+				options->test_jobs = jobs;
+				return;
+			}
+			if (match_longopt("test-junit"))
+			{
+				if (at_end() || next_is_opt()) FAIL_WITH_ERR_LONG("error: --test-junit needs a file name.");
+				options->test_junit = next_arg();
+				return;
+			}
+			if (match_longopt("test-json"))
+			{
+				if (at_end() || next_is_opt()) FAIL_WITH_ERR_LONG("error: --test-json needs a file name.");
+				options->test_json = next_arg();
+				return;
+			}
+			if ((argopt = match_argopt("benchmark-time")))
+			{
+				int ms = atoi(argopt);
+				if (ms < 1) error_exit("error: --benchmark-time needs a valid integer 1 or higher.");
+				options->benchmark_time = ms;
+				return;
+			}
+			if (match_longopt("benchmark-counters"))
+			{
+				options->benchmark_counters = true;
+				return;
+			}
+			if ((argopt = match_argopt("save-baseline")))
+			{
+				options->benchmark_save = argopt;
+				return;
+			}
+			if ((argopt = match_argopt("compare")))
+			{
+				options->benchmark_compare = argopt;
+				return;
+			}
+			if ((argopt = match_argopt("regression-threshold")))
+			{
+				if (atof(argopt) < 0) error_exit("error: --regression-threshold needs a percentage 0 or higher.");
+				options->benchmark_threshold = argopt;
+				return;
+			}
+			if (match_longopt("benchmark-json"))
+			{
+				if (at_end() || next_is_opt()) FAIL_WITH_ERR_LONG("error: --benchmark-json needs a file name.");
+				options->benchmark_json = next_arg();
+				return;
+			}
 			if (match_longopt("test-nosort"))
 			{
 				options->test_nosort = true;
@@ -838,6 +935,18 @@ static void parse_option(BuildOptions *options)
 				options->safety_level = parse_opt_select(SafetyLevel, argopt, on_off);
 				return;
 			}
+			if (match_longopt("module-safe"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --module-safe needs a <module>=<yes|no> argument.");
+				const char *arg = next_arg();
+				const char *eq = strchr(arg, '=');
+				if (!eq || (!str_eq(eq + 1, "yes") && !str_eq(eq + 1, "no")))
+				{
+					error_exit("error: --module-safe expected <module>=<yes|no>, not '%s'.", arg);
+				}
+				vec_add(options->module_safe, arg);
+				return;
+			}
 			if ((argopt = match_argopt("show-backtrace")))
 			{
 				options->show_backtrace = parse_opt_select(ShowBacktrace, argopt, on_off);
@@ -874,6 +983,61 @@ static void parse_option(BuildOptions *options)
 				options->strip_unused = parse_opt_select(StripUnused, argopt, on_off);
 				return;
 			}
+			if ((argopt = match_argopt("strip-introspection")))
+			{
+				options->strip_introspection = parse_opt_select(StripIntrospection, argopt, on_off);
+				return;
+			}
+			if ((argopt = match_argopt("incremental")))
+			{
+				options->incremental = parse_opt_select(Incremental, argopt, on_off);
+				return;
+			}
+			if ((argopt = match_argopt("thin-lto")))
+			{
+				options->thin_lto = parse_opt_select(ThinLto, argopt, on_off);
+				return;
+			}
+			if ((argopt = match_argopt("debug-dedup")))
+			{
+				options->debug_dedup = parse_opt_select(DebugDedup, argopt, on_off);
+				return;
+			}
+			if ((argopt = match_argopt("split-dwarf")))
+			{
+				options->split_dwarf = parse_opt_select(SplitDwarf, argopt, on_off);
+				return;
+			}
+			if ((argopt = match_argopt("pgo-instrument")))
+			{
+				options->pgo_instrument = parse_opt_select(PgoInstrument, argopt, on_off);
+				return;
+			}
+			if (match_longopt("pgo-profile"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --pgo-profile needs a file.");
+				options->pgo_profile = next_arg();
+				return;
+			}
+			if (match_longopt("llvm-passes"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --llvm-passes needs a pipeline.");
+				options->llvm_passes = next_arg();
+				return;
+			}
+			if (match_longopt("module-llvm-passes"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --module-llvm-passes needs a <module>=<pipeline> argument.");
+				const char *arg = next_arg();
+				if (!strchr(arg, '=')) error_exit("error: --module-llvm-passes expected <module>=<pipeline>, not '%s'.", arg);
+				vec_add(options->module_llvm_passes, arg);
+				return;
+			}
+			if ((argopt = match_argopt("llvm-verify")))
+			{
+				options->llvm_verify = parse_opt_select(LlvmVerify, argopt, on_off);
+				return;
+			}
 			if ((argopt = match_argopt("emit-stdlib")))
 			{
 				options->emit_stdlib = parse_opt_select(EmitStdlib, argopt, on_off);
@@ -920,6 +1084,30 @@ static void parse_option(BuildOptions *options)
 				}
 				return;
 			}
+			if ((argopt = match_argopt("trace-out")))
+			{
+				if (!argopt[0]) error_exit("error: --trace-out needs a file name.");
+				options->trace_file = argopt;
+				return;
+			}
+			if ((argopt = match_argopt("json-dir")))
+			{
+				if (!argopt[0]) error_exit("error: --json-dir needs a directory name.");
+				options->json_dir = argopt;
+				return;
+			}
+			if ((argopt = match_argopt("emit-deps")))
+			{
+				if (!argopt[0]) error_exit("error: --emit-deps needs a file name.");
+				options->deps_file = argopt;
+				return;
+			}
+			if ((argopt = match_argopt("stats-json")))
+			{
+				if (!argopt[0]) error_exit("error: --stats-json needs a file name.");
+				options->stats_json = argopt;
+				return;
+			}
 			if ((argopt = match_argopt("memory-env")))
 			{
 				options->memory_environment = parse_opt_select(MemoryEnvironment, argopt, memory_environment);
@@ -936,6 +1124,23 @@ static void parse_option(BuildOptions *options)
 				PRINTF("C3 is low level programming language based on C.");
 				exit_compiler(COMPILER_SUCCESS_EXIT);
 			}
+			if (match_longopt("huge-pages"))
+			{
+				// Already handled before memory was set up.
+				return;
+			}
+			if (match_longopt("watch"))
+			{
+				options->watch = true;
+				return;
+			}
+			if (match_longopt("daemon"))
+			{
+				// Already handled before memory was set up, we only get here if there was no daemon.
+				if (at_end() || next_is_opt()) error_exit("error: --daemon needs a socket path.");
+				next_arg();
+				return;
+			}
 			if (match_longopt("no-obj"))
 			{
 				options->no_obj = true;
@@ -1014,6 +1219,29 @@ static void parse_option(BuildOptions *options)
 				options->build_threads = threads;
 				return;
 			}
+			if (match_longopt("link-threads"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --link-threads needs a valid integer 1 or higher.");
+				int threads = atoi(next_arg());
+				if (threads < 1) error_exit("error: --link-threads needs a valid integer 1 or higher.");
+				if (threads > MAX_THREADS) error_exit("error: --link-threads cannot exceed %d.", MAX_THREADS);
+				options->link_threads = threads;
+				return;
+			}
+			if ((argopt = match_argopt("icf")))
+			{
+				options->linker_icf = parse_opt_select(LinkerIcf, argopt, linker_icf);
+				return;
+			}
+			if (match_longopt("codegen-units"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --codegen-units needs a valid integer 1 or higher.");
+				int units = atoi(next_arg());
+				if (units < 1) error_exit("error: --codegen-units needs a valid integer 1 or higher.");
+				if (units > MAX_CODEGEN_UNITS) error_exit("error: --codegen-units cannot exceed %d.", MAX_CODEGEN_UNITS);
+				options->codegen_units = units;
+				return;
+			}
 			if (match_longopt("target"))
 			{
 				if (at_end() || next_is_opt()) error_exit("error: --target needs a arch+os definition.");
@@ -1053,6 +1281,16 @@ static void parse_option(BuildOptions *options)
 				options->print_output = true;
 				return;
 			}
+			if (match_longopt("print-opt-stats"))
+			{
+				options->print_opt_stats = true;
+				return;
+			}
+			if (match_longopt("audit-init"))
+			{
+				options->audit_init = true;
+				return;
+			}
 			if (match_longopt("print-input"))
 			{
 				options->print_input = true;
@@ -1171,6 +1409,18 @@ static void parse_option(BuildOptions *options)
 				options->obj_out = next_arg();
 				return;
 			}
+			if (match_longopt("download-cache"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --download-cache needs a directory.");
+				options->download_cache_dir = next_arg();
+				return;
+			}
+			if (match_longopt("object-cache"))
+			{
+				if (at_end() || next_is_opt()) error_exit("error: --object-cache needs a directory.");
+				options->object_cache_dir = next_arg();
+				return;
+			}
 			if (match_longopt("script-dir"))
 			{
 				if (at_end() || next_is_opt()) error_exit("error: --script-dir needs a directory.");
@@ -1246,6 +1496,16 @@ static void parse_option(BuildOptions *options)
 				options->benchmark_mode = true;
 				return;
 			}
+			if (match_longopt("lsp-server"))
+			{
+				options->lsp_mode = true;
+				options->lsp_server = true;
+				options->strip_unused = STRIP_UNUSED_OFF;
+				options->test_mode = false;
+				options->benchmarking = true;
+				options->testing = true;
+				return;
+			}
 			if (match_longopt("lsp"))
 			{
 				options->lsp_mode = true;
@@ -1368,6 +1628,14 @@ BuildOptions parse_arguments(int argc, const char *argv[])
 		.validation_level = VALIDATION_NOT_SET,
 		.ansi = ANSI_DETECT,
 		.strip_unused = STRIP_UNUSED_NOT_SET,
+		.strip_introspection = STRIP_INTROSPECTION_NOT_SET,
+		.incremental = INCREMENTAL_NOT_SET,
+		.thin_lto = THIN_LTO_NOT_SET,
+		.linker_icf = LINKER_ICF_NOT_SET,
+		.debug_dedup = DEBUG_DEDUP_NOT_SET,
+		.split_dwarf = SPLIT_DWARF_NOT_SET,
+		.llvm_verify = LLVM_VERIFY_NOT_SET,
+		.pgo_instrument = PGO_INSTRUMENT_NOT_SET,
 		.single_module = SINGLE_MODULE_NOT_SET,
 		.sanitize_mode = SANITIZE_NOT_SET,
 		.unroll_loops = UNROLL_LOOPS_NOT_SET,
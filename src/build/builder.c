@@ -90,6 +90,7 @@ bool command_accepts_files(CompilerCommand command)
 		case COMMAND_TEST:
 		case COMMAND_VENDOR_FETCH:
 		case COMMAND_PROJECT:
+		case COMMAND_DAEMON:
 			return false;
 	}
 	UNREACHABLE
@@ -122,6 +123,7 @@ bool command_passes_args(CompilerCommand command)
 		case COMMAND_PRINT_SYNTAX:
 		case COMMAND_VENDOR_FETCH:
 		case COMMAND_PROJECT:
+		case COMMAND_DAEMON:
 			return false;
 	}
 	UNREACHABLE
@@ -279,6 +281,22 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 		case COMMAND_BENCHMARK:
 			target->run_after_compile = !options->suppress_run;
 			target->type = TARGET_TYPE_BENCHMARK;
+			if (options->benchmark_time)
+			{
+				vec_add(target->args, "--benchmark-time");
+				vec_add(target->args, str_printf("%d", options->benchmark_time));
+			}
+			if (options->benchmark_json)
+			{
+				vec_add(target->args, "--benchmark-json");
+				vec_add(target->args, options->benchmark_json);
+			}
+			if (options->benchmark_counters) vec_add(target->args, "--benchmark-counters");
+			if (options->benchmark_threshold)
+			{
+				vec_add(target->args, "--benchmark-threshold");
+				vec_add(target->args, options->benchmark_threshold);
+			}
 			break;
 		case COMMAND_COMPILE_TEST:
 		case COMMAND_TEST:
@@ -305,6 +323,21 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 			if (options->test_quiet) vec_add(target->args, "--test-quiet");
 			if (options->test_noleak) vec_add(target->args, "--test-noleak");
 			if (options->test_nocapture) vec_add(target->args, "--test-nocapture");
+			if (options->test_jobs > 1)
+			{
+				vec_add(target->args, "--test-jobs");
+				vec_add(target->args, str_printf("%d", options->test_jobs));
+			}
+			if (options->test_junit)
+			{
+				vec_add(target->args, "--test-junit");
+				vec_add(target->args, options->test_junit);
+			}
+			if (options->test_json)
+			{
+				vec_add(target->args, "--test-json");
+				vec_add(target->args, options->test_json);
+			}
 			break;
 		case COMMAND_RUN:
 		case COMMAND_COMPILE_RUN:
@@ -385,6 +418,14 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 	set_if_updated(target->feature.safe_mode, options->safety_level);
 	set_if_updated(target->feature.panic_level, options->panic_level);
 	set_if_updated(target->strip_unused, options->strip_unused);
+	set_if_updated(target->strip_introspection, options->strip_introspection);
+	set_if_updated(target->incremental, options->incremental);
+	set_if_updated(target->thin_lto, options->thin_lto);
+	set_if_updated(target->linker_icf, options->linker_icf);
+	set_if_updated(target->debug_dedup, options->debug_dedup);
+	set_if_updated(target->split_dwarf, options->split_dwarf);
+	set_if_updated(target->llvm_verify, options->llvm_verify);
+	set_if_updated(target->pgo_instrument, options->pgo_instrument);
 	set_if_updated(target->memory_environment, options->memory_environment);
 	set_if_updated(target->debug_info, options->debug_info_override);
 	set_if_updated(target->show_backtrace, options->show_backtrace);
@@ -403,6 +444,14 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 	set_if_updated(target->feature.pass_win64_simd_as_arrays, options->win_64_simd);
 
 	OVERRIDE_IF_SET(output_dir);
+	OVERRIDE_IF_SET(object_cache_dir);
+	OVERRIDE_IF_SET(pgo_profile);
+	OVERRIDE_IF_SET(llvm_passes);
+	// Added last, so they take precedence over the ones in the project.
+	if (options->module_llvm_passes) append_strings_to_strings(&target->module_llvm_passes, options->module_llvm_passes);
+	if (options->module_safe) append_strings_to_strings(&target->module_safe, options->module_safe);
+	OVERRIDE_IF_SET(codegen_units);
+	OVERRIDE_IF_SET(link_threads);
 	OVERRIDE_IF_SET(panicfn);
 	OVERRIDE_IF_SET(testfn);
 	OVERRIDE_IF_SET(benchfn);
@@ -448,10 +497,16 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 	}
 	target->print_output = options->print_output;
 	target->print_input = options->print_input;
+	target->print_opt_stats = options->print_opt_stats;
+	target->audit_init = options->audit_init;
 	target->emit_llvm = options->emit_llvm;
 	target->build_threads = options->build_threads;
+	if (!target->link_threads) target->link_threads = target->build_threads;
 	target->emit_asm = options->emit_asm;
 	target->print_stats = options->verbosity_level >= 2;
+	target->stats_json = options->stats_json;
+	target->json_dir = options->json_dir;
+	target->deps_file = options->deps_file;
 
 	target->benchmarking = options->benchmarking;
 	target->testing = options->testing;
@@ -498,6 +553,24 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 	}
 	if (!options->run_dir) options->run_dir = target->run_dir;
 
+	if (target->type == TARGET_TYPE_BENCHMARK && (options->benchmark_save || options->benchmark_compare))
+	{
+		// The runner may run in another directory, so use an absolute path.
+		const char *dir = file_append_path(target->build_dir, "benchmarks");
+		char cwd[PATH_MAX];
+		if (dir[0] != '/' && dir[1] != ':' && getcwd(cwd, PATH_MAX)) dir = file_append_path(cwd, dir);
+		if (options->benchmark_save)
+		{
+			vec_add(target->args, "--benchmark-save");
+			vec_add(target->args, file_append_path(dir, str_printf("%s.baseline", options->benchmark_save)));
+		}
+		if (options->benchmark_compare)
+		{
+			vec_add(target->args, "--benchmark-compare");
+			vec_add(target->args, file_append_path(dir, str_printf("%s.baseline", options->benchmark_compare)));
+		}
+	}
+
 	target->ir_file_dir = options->llvm_out;
 	target->asm_file_dir = options->asm_out;
 	target->header_file_dir = options->header_out;
@@ -562,6 +635,7 @@ static void update_build_target_from_options(BuildTarget *target, BuildOptions *
 	if (options->lsp_mode)
 	{
 		target->lsp_output = true;
+		target->lsp_server = options->lsp_server;
 		target->emit_llvm = false;
 		target->emit_asm = false;
 		target->emit_object_files = false;
@@ -178,48 +178,101 @@ INLINE JSONObject* read_manifest(const char *lib, const char *manifest_data)
 	return json;
 }
 
+typedef struct
+{
+	size_t size;
+	int64_t mtime;
+	uint64_t hash;
+} ArchiveStamp;
+
+static bool read_archive_stamp(const char *stamp_file, ArchiveStamp *stamp)
+{
+	size_t len;
+	char *data = file_exists(stamp_file) ? file_read_all(stamp_file, &len) : NULL;
+	if (!data) return false;
+	unsigned long long size, hash;
+	long long mtime;
+	if (sscanf(data, "%llu %lld %llx", &size, &mtime, &hash) != 3) return false;
+	*stamp = (ArchiveStamp) { .size = (size_t)size, .mtime = (int64_t)mtime, .hash = (uint64_t)hash };
+	return true;
+}
+
+static void write_archive_stamp(const char *stamp_file, ArchiveStamp *stamp)
+{
+	char buf[96];
+	size_t len = snprintf(buf, 96, "%llu %lld %llx", (unsigned long long)stamp->size,
+	                      (long long)stamp->mtime, (unsigned long long)stamp->hash);
+	file_write_all(stamp_file, buf, len);
+}
+
+/**
+ * Extract a .c3l archive into build_dir/_c3l/<name>/, reusing an earlier extraction.
+ *
+ * The extraction is stamped with the size and mtime of the archive and a hash of its
+ * directory (names, sizes and crc of all files). An unchanged size and mtime skips opening
+ * the archive at all, a matching hash only refreshes the stamp. Keeping the extracted files
+ * untouched lets the object cache and incremental builds reuse the library objects.
+ */
 static inline JSONObject *resolve_zip_library(BuildTarget *build_target, const char *lib, const char **resulting_library)
 {
+	ArchiveStamp stamp = { 0 };
+	if (!file_size_and_mtime(lib, &stamp.size, &stamp.mtime)) error_exit("Failed to open library '%s' for reading.", lib);
+
+	const char *lib_name = filename(lib);
+	scratch_buffer_clear();
+	ASSERT(build_target->build_dir);
+	scratch_buffer_append(build_target->build_dir);
+	scratch_buffer_printf("/_c3l/%s/", lib_name);
+	char *lib_dir = scratch_buffer_copy();
+	scratch_buffer_append("checksum.txt");
+	const char *stamp_file = scratch_buffer_copy();
+	const char *manifest_path = file_append_path(lib_dir, MANIFEST_FILE);
+	*resulting_library = lib_dir;
+
+	ArchiveStamp old_stamp = { 0 };
+	bool has_stamp = file_is_dir(lib_dir) && read_archive_stamp(stamp_file, &old_stamp) && file_exists(manifest_path);
+	if (has_stamp && old_stamp.size == stamp.size && old_stamp.mtime == stamp.mtime)
+	{
+		size_t size;
+		return read_manifest(lib, file_read_all(manifest_path, &size));
+	}
+
 	FILE *f = fopen(lib, "rb");
 	if (!f) error_exit("Failed to open library '%s' for reading.", lib);
-	ZipDirIterator iterator;
 
-	// Find the manifest.
+	// Hash the directory and find the manifest.
+	ZipDirIterator iterator;
 	ZipFile file;
+	ZipFile manifest_file;
+	bool has_manifest = false;
+	uint64_t hash = FNV1_64_SEED;
 	zip_check_err(lib, zip_dir_iterator(f, &iterator));
-	do
+	while (iterator.current_file < iterator.files)
 	{
-		if (iterator.current_file >= iterator.files) error_exit("Missing manifest in '%s'.", lib);
 		zip_check_err(lib, zip_dir_iterator_next(&iterator, &file));
-		if (strcmp(file.name, MANIFEST_FILE) == 0) break;
-	} while (1);
+		hash = fnv1a_64(file.name, strlen(file.name) + 1, hash);
+		hash = fnv1a_64(&file.uncompressed_size, sizeof(file.uncompressed_size), hash);
+		hash = fnv1a_64(&file.file_crc32, sizeof(file.file_crc32), hash);
+		if (!has_manifest && strcmp(file.name, MANIFEST_FILE) == 0)
+		{
+			manifest_file = file;
+			has_manifest = true;
+		}
+	}
+	if (!has_manifest) error_exit("Missing manifest in '%s'.", lib);
+	stamp.hash = hash;
 
 	// Read the manifest.
 	char *manifest_data;
-	zip_check_err(lib, zip_file_read(f, &file, (void**)&manifest_data));
+	zip_check_err(lib, zip_file_read(f, &manifest_file, (void**)&manifest_data));
 
 	// Parse the JSON
 	JSONObject *json = read_manifest(lib, manifest_data);
 
-	// Create the directory for the temporary files.
-	const char *lib_name = filename(lib);
-	scratch_buffer_clear();
-	assert(build_target->build_dir);
-	scratch_buffer_append(build_target->build_dir);
-	scratch_buffer_printf("/_c3l/%s/", lib_name);
-	char *lib_dir = scratch_buffer_copy();
-	char *lib_dir_copy = scratch_buffer_copy();
-	scratch_buffer_append("checksum.txt");
-	const char *checksum_file = scratch_buffer_to_string();
-	uint32_t crc = file.file_crc32;
-	if (file_is_dir(lib_dir))
-	{
-		size_t len;
-		char *data = file_exists(checksum_file) ? file_read_all(checksum_file, &len) : NULL;
-		if (data && crc == strtoll(data, &data, 16)) goto DONE;
-		file_delete_dir(lib_dir);
-	}
-	dir_make_recursive(lib_dir_copy);
+	if (has_stamp && old_stamp.hash == stamp.hash) goto DONE;
+
+	if (file_is_dir(lib_dir)) file_delete_dir(lib_dir);
+	dir_make_recursive(str_copy(lib_dir, strlen(lib_dir)));
 
 	// Iterate through all files.
 	zip_check_err(lib, zip_dir_iterator(f, &iterator));
@@ -232,13 +285,11 @@ static inline JSONObject *resolve_zip_library(BuildTarget *build_target, const c
 	}
 DONE:
 	fclose(f);
-	char buf[64];
-	size_t len = snprintf(buf, 64, "%x", crc);
-	file_write_all(checksum_file, buf, len);
-	*resulting_library = lib_dir;
+	// The stamp is written last, so an interrupted extraction is redone.
+	write_archive_stamp(stamp_file, &stamp);
 	return json;
-
 }
+
 void resolve_libraries(BuildTarget *build_target)
 {
 	DEBUG_LOG("Resolve libraries");
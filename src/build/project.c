@@ -13,31 +13,43 @@ const char *project_default_keys[][2] = {
 		{"c-sources", "Set the C sources to be compiled."},
 		{"cc", "Set C compiler (defaults to 'cc')."},
 		{"cflags", "C compiler flags."},
+		{"codegen-units", "Split large modules into up to this many objects, so they are compiled in parallel (default: 1)."},
 		{"cpu", "CPU name, used for optimizations in the compiler backend."},
+		{"debug-dedup", "Describe each type fully in only one object and use declarations elsewhere (default: false)."},
 		{"debug-info", "Debug level: none, line-tables, full."},
 		{"dependencies", "C3 library dependencies for all targets."},
 		{"dependency-search-paths", "The C3 library search paths."},
 		{"exec", "Scripts run for all targets."},
 		{"features", "Features enabled for all targets."},
 		{"fp-math", "Set math behaviour: `strict`, `relaxed` or `fast`."},
+		{"icf", "Fold identical code sections with the built-in linker: none, safe, all."},
+		{"incremental", "Keep object files and reuse those of unchanged modules (default: false)."},
 		{"langrev", "Version of the C3 language used."},
 		{"link-args", "Linker arguments for all targets."},
 		{"link-libc", "Link libc (default: true)."},
+		{"link-threads", "Set the number of threads the built-in linker uses (default: same as the compiler)."},
 		{"linked-libraries", "Libraries linked by the linker for all targets."},
 		{"linker", "'builtin' for the builtin linker, 'cc' for the system linker or <path> to a custom compiler."},
 		{"linker-search-paths", "Linker search paths."},
 		{"linux-crt", "Set the directory to use for finding crt1.o and related files."},
+		{"llvm-passes", "Replace the LLVM pass pipeline, e.g. 'default<O3>,function(loop-distribute)'."},
+		{"llvm-verify", "Verify the IR after every LLVM pass (default: only when emitting LLVM IR)."},
 		{"macos-min-version", "Set the minimum MacOS version to compile for."},
 		{"macos-sdk-version", "Set the MacOS SDK compiled for." },
 		{"macossdk", "Set the directory for the MacOS SDK for cross compilation."},
 		{"memory-env", "Set the memory environment: normal, small, tiny, none."},
+		{"module-llvm-passes", "A list of '<module>=<pipeline>' pass pipelines for single modules, where 'foo::*' also matches the submodules."},
+		{"module-safe", "A list of '<module>=<yes|no>' turning runtime checks on or off for single modules, where 'foo::*' also matches the submodules."},
 		{"no-entry", "Do not generate (or require) a main function."},
+		{"object-cache", "Directory where object files are shared between builds."},
 		{"opt", "Optimization setting: O0, O1, O2, O3, O4, O5, Os, Oz."},
 		{"optlevel", "Code optimization level: none, less, more, max."},
 		{"optsize", "Code size optimization: none, small, tiny."},
 		{"output", "Output location, relative to project file."},
 		{"panic-msg", "Turn panic message output on or off."},
 		{"panicfn", "Override the panic function."},
+		{"pgo-instrument", "Build a binary which writes an execution profile when it exits (default: false)."},
+		{"pgo-profile", "A .profdata file used for profile-guided optimization."},
 		{"quiet", "Silence unnecessary output."},
 		{"reloc", "Relocation model: none, pic, PIC, pie, PIE."},
 		{"run-dir", "Override run directory for 'run'."},
@@ -48,12 +60,15 @@ const char *project_default_keys[][2] = {
 		{"single-module", "Compile all modules together, enables more inlining."},
 		{"soft-float", "Output soft-float functions."},
 		{"sources", "Paths to project sources for all targets."},
+		{"split-dwarf", "Write the DWARF debug info to .dwo files next to the objects (default: false)."},
+		{"strip-introspection", "Only emit type introspection for types whose typeid is used at runtime. (default: false)"},
 		{"strip-unused", "Strip unused code and globals from the output. (default: true)"},
 		{"symtab", "Sets the preferred symtab size."},
 		{"target", "Compile for a particular architecture + OS target."},
 		{"targets", "Set of targets for the project."},
 		{"test-sources", "Paths to project test sources for all targets."},
 		{"testfn", "Override the test function."},
+		{"thin-lto", "Emit ThinLTO bitcode and optimize across modules when linking (default: false)."},
 		{"trap-on-wrap", "Make signed and unsigned integer overflow generate a panic rather than wrapping."},
 		{"use-stdlib", "Include the standard library (default: true)."},
 		{"vendor", "Vendor specific extensions, ignored by c3c."},
@@ -80,7 +95,9 @@ const char* project_target_keys[][2] = {
 		{"cc", "Set C compiler (defaults to 'cc')."},
 		{"cflags", "Additional C compiler flags for the target."},
 		{"cflags-override", "C compiler flags for the target, overriding global settings."},
+		{"codegen-units", "Split large modules into up to this many objects, so they are compiled in parallel (default: 1)."},
 		{"cpu", "CPU name, used for optimizations in the compiler backend."},
+		{"debug-dedup", "Describe each type fully in only one object and use declarations elsewhere (default: false)."},
 		{"debug-info", "Debug level: none, line-tables, full."},
 		{"dependencies", "Additional C3 library dependencies for the target."},
 		{"dependencies-override", "C3 library dependencies for this target, overriding global settings."},
@@ -91,28 +108,38 @@ const char* project_target_keys[][2] = {
 		{"extension", "Override the default file extension for the build output."},
 		{"features", "Features enabled for all targets."},
 		{"fp-math", "Set math behaviour: `strict`, `relaxed` or `fast`."},
+		{"icf", "Fold identical code sections with the built-in linker: none, safe, all."},
+		{"incremental", "Keep object files and reuse those of unchanged modules (default: false)."},
 		{"langrev", "Version of the C3 language used."},
 		{"link-args", "Additional linker arguments for the target."},
 		{"link-args-override", "Linker arguments for this target, overriding global settings."},
 		{"link-libc", "Link libc (default: true)."},
+		{"link-threads", "Set the number of threads the built-in linker uses (default: same as the compiler)."},
 		{"linked-libraries", "Additional libraries linked by the linker for the target."},
 		{"linked-libraries-override", "Libraries linked by the linker for this target, overriding global settings."},
 		{"linker", "'builtin' for the builtin linker, 'cc' for the system linker or <path> to a custom compiler."},
 		{"linker-search-paths", "Additional linker search paths for the target."},
 		{"linker-search-paths-override", "Linker search paths for this target, overriding global settings."},
 		{"linux-crt", "Set the directory to use for finding crt1.o and related files."},
+		{"llvm-passes", "Replace the LLVM pass pipeline, e.g. 'default<O3>,function(loop-distribute)'."},
+		{"llvm-verify", "Verify the IR after every LLVM pass (default: only when emitting LLVM IR)."},
 		{"macos-min-version", "Set the minimum MacOS version to compile for."},
 		{"macos-sdk-version", "Set the MacOS SDK compiled for." },
 		{"macossdk", "Set the directory for the MacOS SDK for cross compilation."},
 		{"memory-env", "Set the memory environment: normal, small, tiny, none."},
+		{"module-llvm-passes", "A list of '<module>=<pipeline>' pass pipelines for single modules, where 'foo::*' also matches the submodules."},
+		{"module-safe", "A list of '<module>=<yes|no>' turning runtime checks on or off for single modules, where 'foo::*' also matches the submodules."},
 		{"name", "Set the name to be different from the target name."},
 		{"no-entry", "Do not generate (or require) a main function."},
+		{"object-cache", "Directory where object files are shared between builds."},
 		{"opt", "Optimization setting: O0, O1, O2, O3, O4, O5, Os, Oz."},
 		{"optlevel", "Code optimization level: none, less, more, max."},
 		{"optsize", "Code size optimization: none, small, tiny."},
 		{"output", "Output location, relative to project file."},
 		{"panic-msg", "Turn panic message output on or off."},
 		{"panicfn", "Override the panic function."},
+		{"pgo-instrument", "Build a binary which writes an execution profile when it exits (default: false)."},
+		{"pgo-profile", "A .profdata file used for profile-guided optimization."},
 		{"quiet", "Silence unnecessary output."},
 		{"reloc", "Relocation model: none, pic, PIC, pie, PIE."},
 		{"run-dir", "Override run directory for 'run'."},
@@ -124,12 +151,15 @@ const char* project_target_keys[][2] = {
 		{"soft-float", "Output soft-float functions."},
 		{"sources", "Additional paths to project sources for the target."},
 		{"sources-override", "Paths to project sources for this target, overriding global settings."},
+		{"split-dwarf", "Write the DWARF debug info to .dwo files next to the objects (default: false)."},
+		{"strip-introspection", "Only emit type introspection for types whose typeid is used at runtime. (default: false)"},
 		{"strip-unused", "Strip unused code and globals from the output. (default: true)"},
 		{"symtab", "Sets the preferred symtab size."},
 		{"target", "Compile for a particular architecture + OS target."},
 		{"test-sources", "Additional paths to project test sources for the target."},
 		{"test-sources-override", "Paths to project test sources for this target, overriding global settings."},
 		{"testfn", "Override the test function."},
+		{"thin-lto", "Emit ThinLTO bitcode and optimize across modules when linking (default: false)."},
 		{"trap-on-wrap", "Make signed and unsigned integer overflow generate a panic rather than wrapping."},
 		{"type", "Type of output, one of 'executable', 'static-lib', 'dynamic-lib', 'benchmark', 'test', 'object-files' and 'prepare'." },
 		{"use-stdlib", "Include the standard library (default: true)."},
@@ -171,6 +201,9 @@ static void load_into_build_target(BuildParseContext context, JSONObject *json,
 
 	// Where to `run` from
 	target->run_dir = get_string(context, json, "run-dir", target->run_dir);
+
+	// Shared object file cache
+	target->object_cache_dir = get_string(context, json, "object-cache", target->object_cache_dir);
 	// The output directory
 	target->output_dir = get_string(context, json, "output", target->output_dir);
 
@@ -296,6 +329,28 @@ static void load_into_build_target(BuildParseContext context, JSONObject *json,
 		target->symtab_size = (uint32_t)symtab_size;
 	}
 
+	// Codegen units
+	long codegen_units = get_valid_integer(context, json, "codegen-units", false);
+	if (codegen_units > 0)
+	{
+		if (codegen_units > MAX_CODEGEN_UNITS)
+		{
+			error_exit("Error reading %s: codegen-units may not exceed %d.", context.file, MAX_CODEGEN_UNITS);
+		}
+		target->codegen_units = (int)codegen_units;
+	}
+
+	// Link threads
+	long link_threads = get_valid_integer(context, json, "link-threads", false);
+	if (link_threads > 0)
+	{
+		if (link_threads > MAX_THREADS)
+		{
+			error_exit("Error reading %s: link-threads may not exceed %d.", context.file, MAX_THREADS);
+		}
+		target->link_threads = (int)link_threads;
+	}
+
 	// Vector size
 	long vector_size = get_valid_integer(context, json, "max-vector-size", false);
 	if (vector_size > 0)
@@ -426,6 +481,57 @@ static void load_into_build_target(BuildParseContext context, JSONObject *json,
 	// strip-unused
 	target->strip_unused = (StripUnused) get_valid_bool(context, json, "strip-unused", target->strip_unused);
 
+	// strip-introspection
+	target->strip_introspection = (StripIntrospection) get_valid_bool(context, json, "strip-introspection", target->strip_introspection);
+
+	// incremental
+	target->incremental = (Incremental) get_valid_bool(context, json, "incremental", target->incremental);
+
+	// thin-lto
+	target->thin_lto = (ThinLto) get_valid_bool(context, json, "thin-lto", target->thin_lto);
+
+	// debug-dedup
+	target->debug_dedup = (DebugDedup) get_valid_bool(context, json, "debug-dedup", target->debug_dedup);
+
+	// split-dwarf
+	target->split_dwarf = (SplitDwarf) get_valid_bool(context, json, "split-dwarf", target->split_dwarf);
+
+	// icf
+	LinkerIcf icf = GET_SETTING(LinkerIcf, "icf", linker_icf, "'none', 'safe' or 'all'.");
+	if (icf != LINKER_ICF_NOT_SET) target->linker_icf = icf;
+
+	// pgo-instrument
+	target->pgo_instrument = (PgoInstrument) get_valid_bool(context, json, "pgo-instrument", target->pgo_instrument);
+
+	// pgo-profile
+	target->pgo_profile = get_string(context, json, "pgo-profile", target->pgo_profile);
+
+	// llvm-passes
+	target->llvm_passes = get_string(context, json, "llvm-passes", target->llvm_passes);
+
+	// module-llvm-passes
+	const char **module_passes = get_optional_string_array(context, json, "module-llvm-passes");
+	FOREACH(const char *, entry, module_passes)
+	{
+		if (!strchr(entry, '=')) error_exit("In file '%s': 'module-llvm-passes' expected <module>=<pipeline>, not '%s'.", context.file, entry);
+	}
+	if (module_passes) target->module_llvm_passes = module_passes;
+
+	// module-safe
+	const char **module_safe = get_optional_string_array(context, json, "module-safe");
+	FOREACH(const char *, entry, module_safe)
+	{
+		const char *eq = strchr(entry, '=');
+		if (!eq || (!str_eq(eq + 1, "yes") && !str_eq(eq + 1, "no")))
+		{
+			error_exit("In file '%s': 'module-safe' expected <module>=<yes|no>, not '%s'.", context.file, entry);
+		}
+	}
+	if (module_safe) target->module_safe = module_safe;
+
+	// llvm-verify
+	target->llvm_verify = (LlvmVerify) get_valid_bool(context, json, "llvm-verify", target->llvm_verify);
+
 	// linker
 	const char *linker_selection = get_optional_string(context, json, "linker");
 	if (linker_selection)
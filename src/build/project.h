@@ -6,4 +6,4 @@ const char** get_project_dependencies();
 
 static void print_vec(const char *header, const char **vec, bool opt, const char *delim);
 void add_libraries_to_project_file(const char** libs, const char* target_name);
-const char* vendor_fetch_single(const char* lib, const char* path);
+const char* vendor_fetch_single(const char* lib, const char* path, const char *cache_dir);
@@ -222,6 +222,8 @@ static void view_target(BuildParseContext context, JSONObject *target, bool verb
 	TARGET_VIEW_STRING("C compiler flags (override)", "cflags-override");
 	TARGET_VIEW_STRING("CPU name", "cpu");
 	TARGET_VIEW_SETTING("Debug level", "debug-info", debug_levels);
+	TARGET_VIEW_BOOL("Deduplicate debug types", "debug-dedup");
+	TARGET_VIEW_BOOL("Split DWARF", "split-dwarf");
 	TARGET_VIEW_STRING_ARRAY("Additional scripts to run", "exec", ", ");
 	TARGET_VIEW_STRING_ARRAY("Scripts to run (override)", "exec", ", ");
 	TARGET_VIEW_STRING_ARRAY("Enabled features", "features", ", ");
@@ -246,10 +248,23 @@ static void view_target(BuildParseContext context, JSONObject *target, bool verb
 	TARGET_VIEW_BOOL("Print backtrace on signals", "show-backtrace");
 	TARGET_VIEW_STRING("Script directory", "script-dir");
 	TARGET_VIEW_STRING("Run directory", "run-dir");
+	TARGET_VIEW_STRING("Object file cache", "object-cache");
 	TARGET_VIEW_BOOL("Compile into single module", "single-module");
 	TARGET_VIEW_BOOL("Output soft-float functions", "soft-float");
 	TARGET_VIEW_BOOL("Strip unused code/globals", "strip-unused");
+	TARGET_VIEW_BOOL("Strip unused introspection", "strip-introspection");
+	TARGET_VIEW_BOOL("Reuse unchanged object files", "incremental");
+	TARGET_VIEW_BOOL("Use ThinLTO", "thin-lto");
+	TARGET_VIEW_BOOL("Instrument for PGO", "pgo-instrument");
+	TARGET_VIEW_STRING("PGO profile", "pgo-profile");
+	TARGET_VIEW_STRING("LLVM pass pipeline", "llvm-passes");
+	TARGET_VIEW_STRING_ARRAY("Module LLVM pass pipelines", "module-llvm-passes", ", ");
+	TARGET_VIEW_STRING_ARRAY("Module safety", "module-safe", ", ");
+	TARGET_VIEW_BOOL("Verify after each LLVM pass", "llvm-verify");
 	TARGET_VIEW_INTEGER("Preferred symtab size", "symtab");
+	TARGET_VIEW_INTEGER("Codegen units", "codegen-units");
+	TARGET_VIEW_INTEGER("Linker threads", "link-threads");
+	TARGET_VIEW_SETTING("Identical code folding", "icf", linker_icf);
 	TARGET_VIEW_STRING("Target", "target");
 	TARGET_VIEW_STRING("Test function override", "testfn");
 	TARGET_VIEW_BOOL("Integers panic on wrapping", "trap-on-wrap");
@@ -322,7 +337,7 @@ void fetch_project(BuildOptions* options)
 			printf("Fetching missing library '%s'...", dep);
 			fflush(stdout);
 
-			const char *error = vendor_fetch_single(dep, options->vendor_download_path);
+			const char *error = vendor_fetch_single(dep, options->vendor_download_path, options->download_cache_dir);
 
 			if (!error)
 			{
@@ -545,6 +560,8 @@ void view_project(BuildOptions *build_options)
 	VIEW_STRING("C compiler flags", "cflags");
 	VIEW_STRING("CPU name", "cpu");
 	VIEW_SETTING("Debug level", "debug-info", debug_levels);
+	VIEW_BOOL("Deduplicate debug types", "debug-dedup");
+	VIEW_BOOL("Split DWARF", "split-dwarf");
 	VIEW_STRING_ARRAY("Scripts to run", "exec", ", ");
 	VIEW_STRING_ARRAY("Enabled features", "features", ", ");
 	VIEW_SETTING("Floating point behaviour", "fp-math", fp_math);
@@ -565,10 +582,23 @@ void view_project(BuildOptions *build_options)
 	VIEW_BOOL("Print backtrace on signals", "show-backtrace");
 	VIEW_STRING("Script directory", "script-dir");
 	VIEW_STRING("Run directory", "run-dir");
+	VIEW_STRING("Object file cache", "object-cache");
 	VIEW_BOOL("Compile into single module", "single-module");
 	VIEW_BOOL("Output soft-float functions", "soft-float");
 	VIEW_BOOL("Strip unused code/globals", "strip-unused");
+	VIEW_BOOL("Strip unused introspection", "strip-introspection");
+	VIEW_BOOL("Reuse unchanged object files", "incremental");
+	VIEW_BOOL("Use ThinLTO", "thin-lto");
+	VIEW_BOOL("Instrument for PGO", "pgo-instrument");
+	VIEW_STRING("PGO profile", "pgo-profile");
+	VIEW_STRING("LLVM pass pipeline", "llvm-passes");
+	VIEW_STRING_ARRAY("Module LLVM pass pipelines", "module-llvm-passes", ", ");
+	VIEW_STRING_ARRAY("Module safety", "module-safe", ", ");
+	VIEW_BOOL("Verify after each LLVM pass", "llvm-verify");
 	VIEW_INTEGER("Preferred symtab size", "symtab");
+	VIEW_INTEGER("Codegen units", "codegen-units");
+	VIEW_INTEGER("Linker threads", "link-threads");
+	VIEW_SETTING("Identical code folding", "icf", linker_icf);
 	VIEW_STRING("Target", "target");
 	VIEW_STRING("Test function override", "testfn");
 	VIEW_BOOL("Integers panic on wrapping", "trap-on-wrap");
@@ -15,7 +15,7 @@ INLINE AsmInstruction *insert_instruction_named(PlatformTarget *target, const ch
 {
 	TokenType token_type = TOKEN_IDENT;
 	unsigned len = (unsigned)strlen(name);
-	const char *interned = symtab_add(name, len, fnv1a(name, len), &token_type);
+	const char *interned = symtab_add(name, len, symtab_hash(name, len), &token_type);
 	uint32_t hash = ASM_PTR_HASH(interned);
 	uint32_t slot = hash & ASM_INSTRUCTION_MASK;
 	while (1)
@@ -198,7 +198,7 @@ INLINE void reg_register(PlatformTarget *target, const char *name, AsmRegisterTy
 {
 	TokenType token_type = TOKEN_CT_IDENT;
 	unsigned len = (unsigned)strlen(name);
-	const char *interned = symtab_add(name, len, fnv1a(name, len), &token_type);
+	const char *interned = symtab_add(name, len, symtab_hash(name, len), &token_type);
 	uint32_t hash = ASM_PTR_HASH(interned);
 	uint32_t slot = hash & ASM_REGISTER_MASK;
 	while (1)
@@ -297,9 +297,9 @@ void decl_append_links_to_global(Decl *decl)
 		FOREACH(const char *, link, unit->links) linking_add_link(&compiler.linking, link);
 		unit->links = NULL; // Don't register twice
 	}
-	if (decl->attrs_resolved && decl->attrs_resolved->links)
+	if (decl_attrs_resolved(decl) && decl_attrs_resolved(decl)->links)
 	{
-		FOREACH(const char *, link, decl->attrs_resolved->links)
+		FOREACH(const char *, link, decl_attrs_resolved(decl)->links)
 		{
 			linking_add_link(&compiler.linking, link);
 		}
@@ -462,9 +462,9 @@ bool ast_supports_continue(Ast *stmt)
 void scratch_buffer_set_extern_decl_name(Decl *decl, bool clear)
 {
 	if (clear) scratch_buffer_clear();
-	if (decl->extname)
+	if (decl_extname(decl))
 	{
-		scratch_buffer_append(decl->extname);
+		scratch_buffer_append(decl_extname(decl));
 		return;
 	}
 	if (decl->is_extern)
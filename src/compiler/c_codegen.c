@@ -1,1030 +1,1483 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
 #include "c_codegen_internal.h"
+#include <stdarg.h>
+
+static const char *c_preamble =
+		"#include <stdint.h>\n"
+		"#include <stddef.h>\n"
+		"#include <stdbool.h>\n"
+		"#define __C3_STR2(x__) #x__\n"
+		"#define __C3_STR(x__) __C3_STR2(x__)\n"
+		"#define C3_LABEL(name__) __asm__(__C3_STR(__USER_LABEL_PREFIX__) name__)\n"
+
+		"static inline unsigned __int128 __c3_bits_get(const void *ptr, unsigned start, unsigned end)\n"
+		"{\n"
+		"\tconst unsigned char *bytes = (const unsigned char *)ptr;\n"
+		"\tunsigned __int128 value = 0;\n"
+		"\tfor (unsigned i = start; i <= end; i++) value |= (unsigned __int128)((bytes[i / 8] >> (i % 8)) & 1) << (i - start);\n"
+		"\treturn value;\n"
+		"}\n"
+		"static inline void __c3_bits_set(void *ptr, unsigned start, unsigned end, unsigned __int128 value)\n"
+		"{\n"
+		"\tunsigned char *bytes = (unsigned char *)ptr;\n"
+		"\tfor (unsigned i = start; i <= end; i++)\n"
+		"\t{\n"
+		"\t\tunsigned char bit = (unsigned char)(1u << (i % 8));\n"
+		"\t\tbytes[i / 8] = (unsigned char)((value >> (i - start)) & 1 ? bytes[i / 8] | bit : bytes[i / 8] & ~bit);\n"
+		"\t}\n"
+		"}\n"
+		"static inline unsigned __int128 __c3_bitreverse(unsigned __int128 value, unsigned bits)\n"
+		"{\n"
+		"\tunsigned __int128 result = 0;\n"
+		"\tfor (unsigned i = 0; i < bits; i++) result |= ((value >> i) & 1) << (bits - 1 - i);\n"
+		"\treturn result;\n"
+		"}\n"
+		"static inline unsigned __int128 __c3_bswap128(unsigned __int128 value)\n"
+		"{\n"
+		"\treturn ((unsigned __int128)__builtin_bswap64((uint64_t)value) << 64) | __builtin_bswap64((uint64_t)(value >> 64));\n"
+		"}\n";
+
+static void c_gen_introspection_global(GenContext *c, Type *type, const char *name);
+
+static void cbuffer_reserve(CBuffer *buffer, size_t len)
+{
+	if (buffer->len + len + 1 <= buffer->capacity) return;
+	size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+	while (capacity < buffer->len + len + 1) capacity *= 2;
+	buffer->data = realloc(buffer->data, capacity);
+	if (!buffer->data) error_exit("Failed to allocate memory for the C output.");
+	buffer->capacity = capacity;
+}
 
-#include <inttypes.h>
+void cbuffer_append_len(CBuffer *buffer, const char *string, size_t len)
+{
+	cbuffer_reserve(buffer, len);
+	memcpy(buffer->data + buffer->len, string, len);
+	buffer->len += len;
+	buffer->data[buffer->len] = 0;
+}
 
-typedef struct OptionalCatch_
+void cbuffer_append(CBuffer *buffer, const char *string)
 {
-	const char* fault;
-	int block;
-} OptionalCatch;
+	cbuffer_append_len(buffer, string, strlen(string));
+}
 
+static void cbuffer_vprintf(CBuffer *buffer, const char *format, va_list args)
+{
+	va_list copy;
+	va_copy(copy, args);
+	int len = vsnprintf(NULL, 0, format, copy);
+	va_end(copy);
+	cbuffer_reserve(buffer, (size_t)len);
+	vsnprintf(buffer->data + buffer->len, (size_t)len + 1, format, args);
+	buffer->len += (size_t)len;
+}
 
-#define PUSH_CATCH() OptionalCatch _old_catch = c->catch
-#define PUSH_CATCH_VAR_BLOCK(fault_, block_) OptionalCatch _old_catch = c->catch; c->catch = (OptionalCatch) { fault_, block_ }
-#define PUSH_CLEAR_CATCH() OptionalCatch _old_catch = c->catch; c->catch = (OptionalCatch) { NULL, 0 }
-#define POP_CATCH() c->catch = _old_catch
+void cbuffer_printf(CBuffer *buffer, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	cbuffer_vprintf(buffer, format, args);
+	va_end(args);
+}
 
-typedef int VariableId;
+void cbuffer_free(CBuffer *buffer)
+{
+	free(buffer->data);
+	*buffer = (CBuffer) { 0 };
+}
 
-typedef enum
+void c_emit(GenContext *c, const char *format, ...)
 {
-	CV_VALUE,
-	CV_ADDRESS,
-	CV_OPTIONAL_ADDRESS,
-} CValueType;
+	cbuffer_append_len(&c->body, "\t", 1);
+	va_list args;
+	va_start(args, format);
+	cbuffer_vprintf(&c->body, format, args);
+	va_end(args);
+	cbuffer_append_len(&c->body, "\n", 1);
+}
 
-typedef struct CValue
+const char *c_temp_name(GenContext *c)
 {
-	Type *type;
-	VariableId optional;
-	VariableId var;
-	CValueType kind;
-} CValue;
+	return str_printf("__t%u", ++c->temp_id);
+}
 
-typedef struct
+int c_new_label(GenContext *c)
 {
-	HTable gen_decl;
-	HTable gen_def;
-	FILE *file;
-	OptionalCatch catch;
-	int x;
-	int typename;
-	int id_gen;
-} GenContext;
+	return (int)++c->temp_id;
+}
 
-#define PRINTF(x, ...) fprintf(c->file, x, ## __VA_ARGS__) /* NOLINT */
-#define PRINT(x, ...) fputs(x, c->file) /* NOLINT */
+void c_emit_label(GenContext *c, int label)
+{
+	cbuffer_printf(&c->body, "__L%d:;\n", label);
+}
 
-static void c_emit_stmt(GenContext *c, Ast *stmt);
+void c_emit_goto(GenContext *c, int label)
+{
+	c_emit(c, "goto __L%d;", label);
+}
 
-static const char *c_type_name(GenContext *c, Type *type)
+static inline bool c_string_char_needs_escape(unsigned char ch)
 {
-	type = type_lowering(type);
-	switch (type->type_kind)
+	return ch == '"' || ch == '\\' || ch == '?';
+}
+
+const char *c_string_literal(const char *str, size_t len)
+{
+	// Written directly rather than through the scratch buffer, as $embed data can be megabytes.
+	size_t size = 2;
+	for (size_t i = 0; i < len; i++)
 	{
-		case TYPE_VOID:
-			return "void";
-		case TYPE_BOOL:
-			return "bool";
-		case TYPE_POINTER:
-			return "void*";
-		case TYPE_I8:
-			return "int8_t";
-		case TYPE_I16:
-			return "int16_t";
-		case TYPE_I32:
-			return "int32_t";
-		case TYPE_I64:
-			return "int64_t";
-		case TYPE_I128:
-			return "__c3_int128";
-		case TYPE_U8:
-			return "uint8_t";
-		case TYPE_U16:
-			return "uint16_t";
-		case TYPE_U32:
-			return "uint32_t";
-		case TYPE_U64:
-			return "uint64_t";
-		case TYPE_U128:
-			return "__c3_uint128";
-		case TYPE_F16:
-			error_exit("float16 not supported in the C backend.");
-		case TYPE_BF16:
-			error_exit("bfloat16 not supported in the C backend.");
-		case TYPE_F32:
-			return "float";
-		case TYPE_F64:
-			return "double";
-		case TYPE_F128:
-			error_exit("float128 not supported in the C backend.");
-		case TYPE_ANYFAULT:
-		case TYPE_TYPEID:
-		case TYPE_INTERFACE:
-		case TYPE_DISTINCT:
-		case TYPE_FUNC_RAW:
-		case TYPE_TYPEDEF:
-		case TYPE_ENUM:
-		case TYPE_UNTYPED_LIST:
-		case TYPE_INFERRED_ARRAY:
-		case TYPE_INFERRED_VECTOR:
-		case TYPE_OPTIONAL:
-		case TYPE_TYPEINFO:
-		case TYPE_WILDCARD:
-		case TYPE_MEMBER:
-		case TYPE_POISONED:
-			UNREACHABLE
-		case TYPE_ANY:
-			return "__c3_any__";
-		case TYPE_FUNC_PTR:
-		case TYPE_STRUCT:
-		case TYPE_UNION:
-		case TYPE_BITSTRUCT:
-		case TYPE_SLICE:
-		case TYPE_ARRAY:
-		case TYPE_FLEXIBLE_ARRAY:
-		case TYPE_VECTOR:
+		unsigned char ch = (unsigned char)str[i];
+		if (c_string_char_needs_escape(ch)) size += 2;
+		else if (ch < 0x20 || ch > 0x7E) size += 4;
+		else size++;
+	}
+	char *result = malloc_string(size + 1);
+	char *out = result;
+	*out++ = '"';
+	for (size_t i = 0; i < len; i++)
+	{
+		unsigned char ch = (unsigned char)str[i];
+		if (c_string_char_needs_escape(ch))
 		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (!prev) return "NOT_REGISTERED";
-			return prev;
+			*out++ = '\\';
+			*out++ = (char)ch;
+			continue;
 		}
+		if (ch < 0x20 || ch > 0x7E)
+		{
+			// Always use three digits, so that a following digit isn't part of the escape.
+			*out++ = '\\';
+			*out++ = (char)('0' + (ch >> 6));
+			*out++ = (char)('0' + ((ch >> 3) & 7));
+			*out++ = (char)('0' + (ch & 7));
+			continue;
+		}
+		*out++ = (char)ch;
 	}
-	UNREACHABLE
+	*out++ = '"';
+	*out = 0;
+	return result;
 }
-static bool c_emit_type_decl(GenContext *c, Type *type)
+
+/**
+ * GCC passes asm labels through verbatim, so characters the assembler doesn't
+ * accept in a symbol are escaped as $XX, and a leading '$' (an immediate in x86 asm)
+ * gets a prefix. All C3 code in a C backend build goes through here, so the names agree.
+ */
+const char *c_asm_label(const char *name, size_t len)
 {
-	type = type_lowering(type);
-	if (type == type_u128 || type == type_i128)
+	if (name == scratch_buffer.str) name = str_copy(name, len);
+	scratch_buffer_clear();
+	if (name[0] == '$') scratch_buffer_append("__c3");
+	for (size_t i = 0; i < len; i++)
+	{
+		char ch = name[i];
+		if (char_is_alphanum_(ch) || ch == '.' || ch == '$')
+		{
+			scratch_buffer_append_char(ch);
+			continue;
+		}
+		scratch_buffer_printf("$%02x", (unsigned char)ch);
+	}
+	const char *label = scratch_buffer_copy();
+	return str_printf("C3_LABEL(%s)", c_string_literal(label, strlen(label)));
+}
+
+const char *c_sanitized_name(const char *name)
+{
+	if (!name) return "anon";
+	scratch_buffer_clear();
+	for (const char *p = name; *p; p++)
 	{
-		void *prev = htable_get(&c->gen_decl, type);
-		if (prev) return false;
-		PRINT("typedef struct { uint64_t hi; uint64_t lo; } ");
-		PRINT(type == type_u128 ? "__c3_uint128;\n" : "__c3_int128;\n");
-		htable_set(&c->gen_decl, type, type == type_u128 ? "__c3_uint128" : "__c3_int128");
-		return true;
+		char ch = *p;
+		scratch_buffer_append_char(char_is_alphanum_(ch) ? ch : '_');
 	}
+	return scratch_buffer_copy();
+}
+
+/**
+ * Add an internal constant global, it is forward declared, so it may be
+ * referenced from other initializers regardless of the emit order.
+ */
+const char *c_emit_const_global(GenContext *c, Type *type, const char *init)
+{
+	const char *name = str_printf("__c3_c%u", ++c->temp_id);
+	const char *type_name = c_type_name(c, type);
+	cbuffer_printf(&c->decls, "static const %s %s;\n", type_name, name);
+	cbuffer_printf(&c->globals, "static const %s %s = %s;\n", type_name, name, init);
+	return name;
+}
+
+const char *c_emit_string_ptr(GenContext *c, const char *str, size_t len)
+{
+	const char *name = str_printf("__c3_str%u", ++c->temp_id);
+	const char *literal = c_string_literal(str, len);
+	cbuffer_printf(&c->decls, "static const char %s[%llu];\n", name, (unsigned long long)len + 1);
+	cbuffer_printf(&c->globals, "static const char %s[%llu] = %s;\n", name, (unsigned long long)len + 1, literal);
+	return str_printf("((void *)%s)", name);
+}
+
+// -- Types
+
+static const char *c_builtin_type_name(Type *type)
+{
 	switch (type->type_kind)
 	{
-		case TYPE_POISONED:
-		case TYPE_VOID:
-		case TYPE_BOOL:
-		case ALL_INTS:
-		case ALL_FLOATS:
+		case TYPE_VOID: return "void";
+		case TYPE_BOOL: return "bool";
+		case TYPE_I8: return "int8_t";
+		case TYPE_I16: return "int16_t";
+		case TYPE_I32: return "int32_t";
+		case TYPE_I64: return "int64_t";
+		case TYPE_I128: return "__int128";
+		case TYPE_U8: return "uint8_t";
+		case TYPE_U16: return "uint16_t";
+		case TYPE_U32: return "uint32_t";
+		case TYPE_U64: return "uint64_t";
+		case TYPE_U128: return "unsigned __int128";
+		case TYPE_F16: return "_Float16";
+		case TYPE_BF16:
+			error_exit("The C backend does not support 'bfloat'.");
+		case TYPE_F32: return "float";
+		case TYPE_F64: return "double";
+		case TYPE_F128: return "_Float128";
 		case TYPE_POINTER:
-			return false;
-		case TYPE_DISTINCT:
-		case TYPE_FUNC_RAW:
-		case TYPE_TYPEDEF:
-		case TYPE_ENUM:
-		case TYPE_UNTYPED_LIST:
-		case TYPE_INFERRED_ARRAY:
-		case TYPE_INFERRED_VECTOR:
-		case TYPE_OPTIONAL:
-		case TYPE_TYPEINFO:
-		case TYPE_WILDCARD:
-		case TYPE_MEMBER:
-		case TYPE_ANYFAULT:
-		case TYPE_TYPEID:
-		case TYPE_INTERFACE:
-			UNREACHABLE
-		case TYPE_ANY:
-		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (prev) return false;
-			PRINTF("typedef struct { void* ptr; void* typeid; } __c3_any__;\n");
-			htable_set(&c->gen_decl, type, "__c3_any__");
-			return true;
-		}
 		case TYPE_FUNC_PTR:
-		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (prev) return false;
-			Type *base = type;
-			type = type->pointer;
-			FunctionPrototype *proto = type->function.prototype;
-			c_emit_type_decl(c, proto->rtype);
-			FOREACH (Type *, t, proto->param_types)
-			{
-				c_emit_type_decl(c, t);
-			}
-			int id = ++c->typename;
-			PRINTF("typedef %s(*__c3_fn%d)(", c_type_name(c, proto->rtype), id);
-			FOREACH_IDX(i, Type *, t, proto->param_types)
-			{
-				if (i != 0) PRINT(",");
-				PRINT(c_type_name(c, t));
-			}
-			PRINT(");\n");
-			scratch_buffer_clear();
-			scratch_buffer_printf("__c3_fn%d", id);
-			htable_set(&c->gen_decl, base, scratch_buffer_copy());
-			return true;
-		}
+			return "void *";
+		case TYPE_SLICE:
+			return "__c3_slice";
+		case TYPE_ANY:
+			return "__c3_any";
+		default:
+			return NULL;
+	}
+}
+
+static void c_emit_type_layout_check(GenContext *c, const char *name, Type *type)
+{
+	cbuffer_printf(&c->types, "_Static_assert(sizeof(%s) == %llu, \"Unexpected size of %s\");\n",
+	               name, (unsigned long long)type_size(type), name);
+}
+
+static const char *c_aggregate_type_name(GenContext *c, Type *type)
+{
+	// Pointers are all void *, so no aggregate can contain itself by value,
+	// and the member types can be completed before the aggregate.
+	switch (type->type_kind)
+	{
 		case TYPE_STRUCT:
 		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (prev) return false;
-			Decl *d = type->decl;
-			FOREACH(Decl *, m, d->strukt.members)
+			Decl *decl = type->decl;
+			const char **members = NULL;
+			FOREACH(Decl *, member, decl->strukt.members)
 			{
-				c_emit_type_decl(c, m->type);
+				vec_add(members, c_type_name(c, member->type));
 			}
-			PRINTF("typedef struct { ");
-			int id = ++c->typename;
-			FOREACH_IDX(i, Decl *, m, d->strukt.members)
+			const char *name = str_printf("__c3_t%u", ++c->temp_id);
+			// Sema strips the member padding of naturally aligned structs, so only packed structs spell it out.
+			cbuffer_printf(&c->types, "typedef struct __attribute__((%saligned(%u)))\n{\n",
+			               decl->is_packed ? "packed, " : "", (unsigned)decl->alignment);
+			FOREACH_IDX(i, Decl *, member, decl->strukt.members)
 			{
-				PRINTF("%s m%d; ", c_type_name(c, m->type), i);
+				if (member->padding) cbuffer_printf(&c->types, "\tchar __p%u[%u];\n", (unsigned)i, (unsigned)member->padding);
+				Type *member_type = type_lowering(member->type);
+				if (member_type->type_kind == TYPE_FLEXIBLE_ARRAY)
+				{
+					cbuffer_printf(&c->types, "\t%s m%u[0];\n", c_type_name(c, member_type->array.base), (unsigned)i);
+					continue;
+				}
+				cbuffer_printf(&c->types, "\t%s m%u;\n", members[i], (unsigned)i);
 			}
-			PRINTF("} __c3_struct_%d;\n", id);
-			scratch_buffer_clear();
-			scratch_buffer_printf("__c3_struct_%d", id);
-			htable_set(&c->gen_decl, type, scratch_buffer_copy());
-			return true;
+			if (decl->strukt.padding) cbuffer_printf(&c->types, "\tchar __pt[%u];\n", (unsigned)decl->strukt.padding);
+			cbuffer_printf(&c->types, "} %s;\n", name);
+			c_emit_type_layout_check(c, name, type);
+			return name;
 		}
 		case TYPE_UNION:
 		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (prev) return false;
-			Decl *d = type->decl;
-			FOREACH(Decl *, m, d->strukt.members)
+			Decl *decl = type->decl;
+			const char **members = NULL;
+			FOREACH(Decl *, member, decl->strukt.members)
 			{
-				c_emit_type_decl(c, m->type);
+				Type *member_type = type_lowering(member->type);
+				vec_add(members, member_type->type_kind == TYPE_FLEXIBLE_ARRAY ? NULL : c_type_name(c, member_type));
 			}
-			PRINTF("typedef union { ");
-			int id = ++c->typename;
-			FOREACH_IDX(i, Decl *, m, d->strukt.members)
+			const char *name = str_printf("__c3_t%u", ++c->temp_id);
+			cbuffer_printf(&c->types, "typedef union __attribute__((packed, aligned(%u)))\n{\n", (unsigned)decl->alignment);
+			FOREACH_IDX(i, const char *, member, members)
 			{
-				PRINTF("%s m%d; ", c_type_name(c, m->type), i);
+				if (member) cbuffer_printf(&c->types, "\t%s m%u;\n", member, (unsigned)i);
 			}
-			PRINTF("} __c3_union_%d;\n", id);
-			scratch_buffer_clear();
-			scratch_buffer_printf("__c3_union_%d", id);
-			htable_set(&c->gen_decl, type, scratch_buffer_copy());
-			return true;
+			TypeSize size = type_size(type);
+			if (size) cbuffer_printf(&c->types, "\tchar __s[%llu];\n", (unsigned long long)size);
+			cbuffer_printf(&c->types, "} %s;\n", name);
+			c_emit_type_layout_check(c, name, type);
+			return name;
 		}
-		case TYPE_BITSTRUCT:
-			TODO
-			break;
-		case TYPE_SLICE:
+		case TYPE_ARRAY:
+		case TYPE_VECTOR:
 		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (prev) return false;
-			c_emit_type_decl(c, type->array.base);
-			int id = ++c->typename;
-			PRINTF("typedef struct { %s* ptr; void* typeid; } __c3_slice%d;\n", c_type_name(c, type->array.base), id);
-			scratch_buffer_clear();
-			scratch_buffer_printf(" __c3_slice%d", id);
-			htable_set(&c->gen_decl, type, scratch_buffer_copy());
-			return true;
+			const char *base = c_type_name(c, type->array.base);
+			const char *name = str_printf("__c3_t%u", ++c->temp_id);
+			// Vectors may be padded beyond their elements, like float[<3>].
+			TypeSize padding = type_size(type) - type->array.len * type_size(type->array.base);
+			const char *pad = padding ? str_printf(" char __pad[%llu];", (unsigned long long)padding) : "";
+			cbuffer_printf(&c->types, "typedef struct __attribute__((aligned(%u))) { %s a[%llu];%s } %s;\n",
+			               (unsigned)type_abi_alignment(type), base, (unsigned long long)type->array.len, pad, name);
+			c_emit_type_layout_check(c, name, type);
+			return name;
 		}
-		case TYPE_ARRAY:
 		case TYPE_FLEXIBLE_ARRAY:
 		{
-			void *prev = htable_get(&c->gen_decl, type);
-			if (prev) return false;
-			c_emit_type_decl(c, type->array.base);
-			int id = ++c->typename;
-			PRINTF("typedef struct { %s ptr[%u]; } __c3_array%d;\n", c_type_name(c, type->array.base), type->array.len, id);
-			scratch_buffer_clear();
-			scratch_buffer_printf(" __c3_array%d", id);
-			htable_set(&c->gen_decl, type, scratch_buffer_copy());
-			return true;
+			const char *base = c_type_name(c, type->array.base);
+			const char *name = str_printf("__c3_t%u", ++c->temp_id);
+			cbuffer_printf(&c->types, "typedef struct { %s a[0]; } %s;\n", base, name);
+			return name;
 		}
-		case TYPE_VECTOR:
-			error_exit("Vectors are not supported in the C backend yet.");
+		default:
+			UNREACHABLE
 	}
-	UNREACHABLE
 }
-static bool c_emit_function_decl(GenContext *c, Decl *fn)
+
+/**
+ * All pointers are void * in C, so arrays and vectors of different pointers must share their typedef.
+ */
+static Type *c_canonical_type(Type *type)
 {
-	Signature *sig = &fn->func_decl.signature;
-	(void)c_emit_type_decl(c, typeget(sig->rtype));
-	FOREACH(Decl *, d, sig->params)
+	type = type_lowering(type);
+	switch (type->type_kind)
 	{
-		c_emit_type_decl(c, d->type);
+		case TYPE_POINTER:
+		case TYPE_FUNC_PTR:
+			return type_voidptr;
+		case TYPE_ARRAY:
+		case TYPE_VECTOR:
+		{
+			Type *base = c_canonical_type(type->array.base);
+			if (base == type_lowering(type->array.base)) return type;
+			return type->type_kind == TYPE_ARRAY ? type_get_array(base, type->array.len) : type_get_vector(base, type->array.len);
+		}
+		default:
+			return type;
 	}
+}
+
+const char *c_type_name(GenContext *c, Type *type)
+{
+	type = c_canonical_type(type);
+	const char *name = c_builtin_type_name(type);
+	if (name) return name;
+	if ((name = htable_get(&c->type_names, type))) return name;
+	name = c_aggregate_type_name(c, type);
+	htable_set(&c->type_names, type, (void *)name);
+	return name;
+}
 
-	if (fn->is_extern)
+const char *c_func_ptr_type_name(GenContext *c, FunctionPrototype *prototype)
+{
+	void *key = prototype->raw_type;
+	const char *name = htable_get(&c->func_types, key);
+	if (name) return name;
+	const char *params = NULL;
+	bool first = true;
+	CBuffer param_list = { 0 };
+	if (prototype->ret_by_ref)
 	{
-		PRINTF("extern ");
+		cbuffer_append(&param_list, "void *");
+		first = false;
 	}
-	else if (!fn->is_external_visible)
+	FOREACH(Type *, param, prototype->param_types)
 	{
-		PRINTF("static ");
+		if (!first) cbuffer_append(&param_list, ", ");
+		cbuffer_append(&param_list, c_type_name(c, param));
+		first = false;
 	}
-
-	PRINTF("%s ", c_type_name(c, typeget(sig->rtype)));
-
-	fn->is_export = true;
-	scratch_buffer_set_extern_decl_name(fn, true);
-	PRINTF("%s(", scratch_buffer_to_string());
-	FOREACH_IDX(i, Decl *, d, sig->params)
+	if (prototype->raw_variadic)
 	{
-		if (i != 0) PRINT(",");
-		PRINT(c_type_name(c, d->type));
+		cbuffer_append(&param_list, first ? "..." : ", ...");
+		first = false;
 	}
-	PRINT(");\n");
-	return !fn->is_extern;
+	params = first ? "void" : str_copy(param_list.data, param_list.len);
+	cbuffer_free(&param_list);
+	name = str_printf("__c3_fn%u", ++c->temp_id);
+	cbuffer_printf(&c->types, "typedef %s (*%s)(%s);\n", c_type_name(c, prototype->abi_ret_type), name, params);
+	htable_set(&c->func_types, key, (void *)name);
+	return name;
 }
 
-static void c_emit_stmt_chain(GenContext *c, AstId current)
+// -- Declarations
+
+static const char *c_extern_name(Decl *decl)
+{
+	scratch_buffer_set_extern_decl_name(decl, true);
+	return scratch_buffer_copy();
+}
+
+/**
+ * Mirrors llvm_set_decl_linkage, returning the storage class and attributes
+ * to prefix the declaration with, and whether the symbol is local to the file.
+ */
+static const char *c_decl_linkage(GenContext *c, Decl *decl, bool *is_static_ref)
 {
-	while (current)
+	bool is_var = decl->decl_kind == DECL_VAR;
+	bool should_weaken = decl->is_weak || (!decl->is_extern && module_should_weaken(decl->unit->module));
+	bool is_static = is_var && decl->var.is_static;
+	bool same_module = is_static || decl->unit->module == c->code_module;
+	*is_static_ref = false;
+	if (decl->is_extern || !same_module)
 	{
-		c_emit_stmt(c, ast_next(&current));
+		if (compiler.platform.os == OS_TYPE_WIN32) should_weaken = false;
+		return should_weaken ? "extern __attribute__((weak)) " : "extern ";
 	}
+	if (decl_is_externally_visible(decl) && !is_static)
+	{
+		return should_weaken ? "__attribute__((weak)) " : "";
+	}
+	*is_static_ref = true;
+	return "static ";
 }
 
-static int c_create_label(GenContext *c)
+static const char *c_section_attribute(Decl *decl)
 {
-	return ++c->id_gen;
+	if (!decl_attrs_resolved(decl) || !decl_attrs_resolved(decl)->section) return "";
+	const char *section = decl_attrs_resolved(decl)->section;
+	return str_printf(" __attribute__((section(%s)))", c_string_literal(section, strlen(section)));
 }
 
-static int c_create_variable(GenContext *c)
+static const char *c_function_attributes(Decl *decl)
 {
-	return ++c->id_gen;
+	return str_printf("%s%s%s%s", decl->func_decl.attr_noinline ? " __attribute__((noinline))" : "",
+	                  decl->func_decl.signature.attrs.noreturn ? " __attribute__((noreturn))" : "",
+	                  decl->func_decl.attr_naked ? " __attribute__((naked))" : "",
+	                  c_section_attribute(decl));
 }
-static void c_emit_label(GenContext *c, int label)
+
+static const char *c_function_params(GenContext *c, Decl *decl, FunctionPrototype *prototype, bool with_names)
 {
-	PRINTF("__C3_LABEL_%d:;\n", label);
+	CBuffer buffer = { 0 };
+	bool first = true;
+	if (prototype->ret_by_ref)
+	{
+		cbuffer_append(&buffer, with_names ? "void *__retparam" : "void *");
+		first = false;
+	}
+	FOREACH_IDX(i, Type *, param_type, prototype->param_types)
+	{
+		if (!first) cbuffer_append(&buffer, ", ");
+		first = false;
+		cbuffer_append(&buffer, c_type_name(c, param_type));
+		if (with_names) cbuffer_printf(&buffer, " __p%u", (unsigned)i);
+	}
+	if (prototype->raw_variadic)
+	{
+		cbuffer_append(&buffer, first ? "..." : ", ...");
+		first = false;
+	}
+	const char *result = first ? "void" : str_copy(buffer.data, buffer.len);
+	cbuffer_free(&buffer);
+	return result;
 }
 
-static void c_emit_goto_label(GenContext *c, int label)
+static const char *c_declare_function(GenContext *c, Decl *decl)
 {
-	PRINTF("goto __C3_LABEL_%d;\n", label);
+	decl_append_links_to_global(decl);
+	FunctionPrototype *prototype = type_get_resolved_prototype(decl->type);
+	const char *name = str_printf("__c3_%s_%u", c_sanitized_name(decl->name), ++c->temp_id);
+	bool is_static;
+	const char *linkage = c_decl_linkage(c, decl, &is_static);
+	const char *ret = c_type_name(c, prototype->abi_ret_type);
+	const char *params = c_function_params(c, decl, prototype, false);
+	const char *attributes = c_function_attributes(decl);
+	if (is_static)
+	{
+		cbuffer_printf(&c->decls, "%s%s %s(%s)%s;\n", linkage, ret, name, params, attributes);
+		return name;
+	}
+	const char *extern_name = c_extern_name(decl);
+	cbuffer_printf(&c->decls, "%s%s %s(%s) %s%s;\n", linkage, ret, name, params,
+	               c_asm_label(extern_name, strlen(extern_name)), attributes);
+	return name;
 }
 
-static VariableId c_emit_temp(GenContext *c, CValue *value, Type *type)
+static const char *c_declare_global(GenContext *c, Decl *decl)
 {
-	*value = (CValue) { .var = c_create_variable(c), .kind = CV_VALUE, .type = type_lowering(type) };
-	return c->id_gen;
+	ASSERT_SPAN(decl, decl->var.kind == VARDECL_GLOBAL || decl->var.kind == VARDECL_CONST || decl->var.is_static);
+	bool is_static;
+	const char *linkage = c_decl_linkage(c, decl, &is_static);
+	const char *type_name = c_type_name(c, decl->type);
+	const char *tls = decl->var.is_threadlocal ? "_Thread_local " : "";
+	const char *name = str_printf("__c3_%s_%u", c_sanitized_name(decl->name), ++c->temp_id);
+	const char *extern_name = c_extern_name(decl);
+	const char *label = is_static ? "" : str_printf(" %s", c_asm_label(extern_name, strlen(extern_name)));
+	// Statics get a tentative definition, the rest are declared extern and defined later if they are in this module.
+	const char *prefix = is_static ? "static " : (str_start_with(linkage, "extern") ? linkage : "extern ");
+	cbuffer_printf(&c->decls, "%s%s%s %s%s __attribute__((aligned(%u)));\n", prefix, tls, type_name, name, label,
+	               (unsigned)decl->alignment);
+	if (IS_OPTIONAL(decl))
+	{
+		const char *opt_name = str_printf("%s_f", name);
+		const char *opt_label = is_static ? "" : str_printf(" %s", c_asm_label(str_printf("%s.f", extern_name), strlen(extern_name) + 2));
+		cbuffer_printf(&c->decls, "%s%s%s %s%s;\n", prefix, tls, c_type_name(c, type_fault), opt_name, opt_label);
+		decl->var.optional_ref = (void *)opt_name;
+	}
+	return name;
 }
-static void c_emit_const_expr(GenContext *c, CValue *value, Expr *expr)
+
+const char *c_decl_name(GenContext *c, Decl *decl)
 {
-	Type *t = type_lowering(expr->type);
-	switch (expr->const_expr.const_kind)
+	decl = decl_flatten(decl);
+	if (decl->decl_kind == DECL_VAR)
+	{
+		switch (decl->var.kind)
+		{
+			case VARDECL_UNWRAPPED:
+				return c_decl_name(c, decl->var.alias);
+			case VARDECL_GLOBAL:
+			case VARDECL_CONST:
+				break;
+			default:
+				if (decl->var.is_static) break;
+				ASSERT_SPAN(decl, decl->backend_ref);
+				return decl->backend_ref;
+		}
+	}
+	const char *name = htable_get(&c->decl_names, decl);
+	if (name) return name;
+	switch (decl->decl_kind)
 	{
-		case CONST_FLOAT:
-			PRINTF("%s ___var_%d = %20.20g;\n", c_type_name(c, t), c_emit_temp(c, value, t), expr->const_expr.fxx.f);
-			return;
-		case CONST_INTEGER:
-			if (t == type_u128 || t == type_i128)
+		case DECL_VAR:
+			name = c_declare_global(c, decl);
+			break;
+		case DECL_FUNC:
+			if (decl->func_decl.attr_interface_method)
 			{
-				TODO
+				name = c_selector_name(c, decl->name);
+				break;
 			}
-			if (type_is_unsigned(t))
+			name = c_declare_function(c, decl);
+			break;
+		case DECL_FAULT:
+		{
+			// Faults are identified by the address of their name, which is a weak definition in every user.
+			name = str_printf("__c3_%s_%u", c_sanitized_name(decl->name), ++c->temp_id);
+			const char *extern_name = c_extern_name(decl);
+			const char *nameof;
+			if (decl->obfuscate)
 			{
-				PRINTF("%s ___var_%d = %" PRIu64 ";\n", c_type_name(c, t), c_emit_temp(c, value, t), expr->const_expr.ixx.i.low);
+				nameof = "<FAULT>";
 			}
 			else
 			{
-				PRINTF("%s ___var_%d = %" PRId64 ";\n", c_type_name(c, t), c_emit_temp(c, value, t), (int64_t)expr->const_expr.ixx.i.low);
-			}
-			return;
-		case CONST_BOOL:
-			PRINTF("bool ___var_%d = %s;\n", c_emit_temp(c, value, t), expr->const_expr.b ? "true" : "false");
-			return;
-		case CONST_STRING:
-			PRINTF("%s ___var_%d = \"", c_type_name(c, t), c_emit_temp(c, value, t));
-			for (ArraySize i = 0; i < expr->const_expr.bytes.len; i++)
-			{
-				char b = expr->const_expr.bytes.ptr[i];
-				if (b >= ' ' && b < 127)
+				const char *module_name = decl->unit->module->name->module;
+				size_t last = 0;
+				for (size_t i = 0; module_name[i]; i++)
 				{
-					PRINTF("%c", b);
-					continue;
+					if (module_name[i] == ':')
+					{
+						i++;
+						last = i + 1;
+					}
 				}
-				PRINTF("\\%d%d%d", b / 64, (b % 64) / 8, b % 8);
+				nameof = str_printf("%s::%s", &module_name[last], decl->name);
 			}
-			PRINT("\";\n");
-			return;
-		case CONST_FAULT:
-		case CONST_ENUM:
-		case CONST_BYTES:
+			size_t len = strlen(nameof);
+			const char *str = c_emit_string_ptr(c, nameof, len);
+			const char *label = c_asm_label(extern_name, strlen(extern_name));
+			cbuffer_printf(&c->decls, "extern const __c3_slice %s %s __attribute__((weak));\n", name, label);
+			cbuffer_printf(&c->globals, "const __c3_slice %s = { %s, %llu };\n", name, str, (unsigned long long)len);
 			break;
-		case CONST_POINTER:
-			break;
-		case CONST_TYPEID:
-			break;
-		case CONST_SLICE:
-			break;
-		case CONST_INITIALIZER:
-			break;
-		case CONST_REF:
-			break;
-		case CONST_UNTYPED_LIST:
-		case CONST_MEMBER:
+		}
+		default:
 			UNREACHABLE
 	}
-	PRINT("/* CONST EXPR */\n");
+	htable_set(&c->decl_names, decl, (void *)name);
+	return name;
+}
+
+const char *c_decl_optional_name(GenContext *c, Decl *decl)
+{
+	decl = decl_flatten(decl);
+	if (decl->decl_kind != DECL_VAR) return NULL;
+	if (decl->var.kind == VARDECL_UNWRAPPED) return c_decl_optional_name(c, decl->var.alias);
+	c_decl_name(c, decl);
+	return decl->var.optional_ref;
+}
+
+const char *c_fault_value(GenContext *c, Decl *decl)
+{
+	return str_printf("((%s)(uintptr_t)&%s)", c_type_name(c, type_fault), c_decl_name(c, decl));
+}
+
+const char *c_selector_name(GenContext *c, const char *name)
+{
+	const char *sel = htable_get(&c->selector_names, (void *)name);
+	if (sel) return sel;
+	sel = str_printf("__c3_sel%u", ++c->temp_id);
+	size_t len = strlen(name);
+	const char *label = c_asm_label(str_printf("$sel.%s", name), len + 5);
+	cbuffer_printf(&c->decls, "extern const char %s[%llu] %s __attribute__((weak));\n", sel, (unsigned long long)len + 1, label);
+	cbuffer_printf(&c->globals, "const char %s[%llu] = %s;\n", sel, (unsigned long long)len + 1, c_string_literal(name, len));
+	sel = str_printf("((void *)%s)", sel);
+	htable_set(&c->selector_names, (void *)name, (void *)sel);
+	return sel;
+}
+
+// -- Introspection
+
+const char *c_introspect_type_name(GenContext *c, unsigned additional)
+{
+	void *key = (void *)(uintptr_t)(additional + 1);
+	const char *name = htable_get(&c->introspect_types, key);
+	if (name) return name;
+	name = str_printf("__c3_introspect%u", additional);
+	cbuffer_printf(&c->types, "typedef struct { uint8_t kind; %s parent; void *dtable; %s size; %s inner; %s len; %s additional[%u]; } %s;\n",
+	               c_type_name(c, type_typeid), c_type_name(c, type_usz), c_type_name(c, type_typeid),
+	               c_type_name(c, type_usz), additional ? "__c3_slice" : c_type_name(c, type_usz), additional, name);
+	htable_set(&c->introspect_types, key, (void *)name);
+	return name;
 }
-static void c_emit_expr(GenContext *c, CValue *value, Expr *expr)
+
+static const char *c_typeid_global(GenContext *c, Type *type)
 {
-	switch (expr->expr_kind)
+	type = type->canonical;
+	switch (type->type_kind)
 	{
-		case EXPR_VECTOR_TO_ARRAY:
-		case EXPR_SLICE_TO_VEC_ARRAY:
-		case EXPR_SCALAR_TO_VECTOR:
-		case EXPR_ENUM_FROM_ORD:
-		case EXPR_PTR_ACCESS:
-		case EXPR_INT_TO_FLOAT:
-		case EXPR_INT_TO_PTR:
-		case EXPR_PTR_TO_INT:
-		case EXPR_FLOAT_TO_INT:
-		case EXPR_SLICE_LEN:
-		case EXPR_DISCARD:
-		case EXPR_RVALUE:
-		case EXPR_RECAST:
-		case EXPR_ADDR_CONVERSION:
-		case EXPR_EXT_TRUNC:
-		case EXPR_MAKE_ANY:
-		case EXPR_MAKE_SLICE:
-		case EXPR_INT_TO_BOOL:
-		case EXPR_VECTOR_FROM_ARRAY:
-		case EXPR_TWO:
-			break;
-		case NON_RUNTIME_EXPR:
-		case UNRESOLVED_EXPRS:
-			UNREACHABLE
-		case EXPR_ACCESS_RESOLVED:
-			break;
-		case EXPR_ASM:
-			break;
-		case EXPR_BENCHMARK_HOOK:
-			break;
-		case EXPR_BINARY:
-			break;
-		case EXPR_BITACCESS:
-			break;
-		case EXPR_BITASSIGN:
-			break;
-		case EXPR_BUILTIN:
-			break;
-		case EXPR_BUILTIN_ACCESS:
-			break;
-		case EXPR_CALL:
-			break;
-		case EXPR_CATCH:
-			break;
-		case EXPR_COND:
-			break;
-		case EXPR_CONST:
-			c_emit_const_expr(c, value, expr);
-			return;
-		case EXPR_DECL:
-			break;
-		case EXPR_DEFAULT_ARG:
-			break;
-		case EXPR_DESIGNATED_INITIALIZER_LIST:
-			break;
-		case EXPR_DESIGNATOR:
-			break;
-		case EXPR_EXPRESSION_LIST:
-			break;
-		case EXPR_FORCE_UNWRAP:
-			break;
-		case EXPR_IDENTIFIER:
-			break;
-		case EXPR_INITIALIZER_LIST:
-			break;
-		case EXPR_LAMBDA:
-			break;
-		case EXPR_LAST_FAULT:
-			break;
-		case EXPR_MACRO_BLOCK:
-			break;
-		case EXPR_MACRO_BODY_EXPANSION:
-			break;
-		case EXPR_MEMBER_GET:
+		case TYPE_FUNC_PTR:
+			return c_typeid_global(c, type->pointer);
+		case TYPE_FUNC_RAW:
+			if (type->function.prototype->raw_type != type) return c_typeid_global(c, type->function.prototype->raw_type);
 			break;
-		case EXPR_NAMED_ARGUMENT:
+		default:
 			break;
-		case EXPR_NOP:
+	}
+	const char *name = htable_get(&c->typeid_names, type);
+	if (name) return name;
+	name = str_printf("__c3_ct%u", ++c->temp_id);
+	// Register before generating, so that recursive types find it.
+	htable_set(&c->typeid_names, type, (void *)name);
+	c_gen_introspection_global(c, type, name);
+	return name;
+}
+
+const char *c_typeid_value(GenContext *c, Type *type)
+{
+	return str_printf("((%s)(uintptr_t)&%s)", c_type_name(c, type_typeid), c_typeid_global(c, type));
+}
+
+/**
+ * Every call site gets its own cache of the dtable entry it last found, see __c3_dyn_find.
+ */
+const char *c_emit_dynamic_search(GenContext *c, const char *typeid, const char *selector)
+{
+	c->needs_dyn_search = true;
+	c_introspect_type_name(c, 0);
+	const char *cache = str_printf("__c3_dyn_cache%u", ++c->temp_id);
+	cbuffer_printf(&c->globals, "static __c3_dtable *%s = &__c3_dyn_missing;\n", cache);
+	return str_printf("__c3_dyn_find(&%s, (void *)(uintptr_t)%s, %s)", cache, typeid, selector);
+}
+
+const char *c_enum_associated_name(GenContext *c, Decl *enum_decl, Decl *associated)
+{
+	c_typeid_global(c, enum_decl->type);
+	return associated->backend_ref;
+}
+
+static void c_gen_enum_associated(GenContext *c, Decl *decl)
+{
+	Decl **enum_vals = decl->enums.values;
+	unsigned elements = vec_size(enum_vals);
+	FOREACH_IDX(ai, Decl *, associated, decl->enums.parameters)
+	{
+		Type *type = type_get_array(associated->type, elements);
+		CBuffer init = { 0 };
+		cbuffer_append(&init, "{ .a = { ");
+		for (unsigned i = 0; i < elements; i++)
+		{
+			const char *value = c_emit_const_expr_initializer(c, enum_vals[i]->enum_constant.args[ai]);
+			if (!value) error_exit("The C backend can't express the associated value '%s' as a constant.", associated->name);
+			cbuffer_printf(&init, "%s%s", i ? ", " : "", value);
+		}
+		cbuffer_append(&init, " } }");
+		const char *name = str_printf("__c3_assoc%u", ++c->temp_id);
+		scratch_buffer_set_extern_decl_name(decl, true);
+		scratch_buffer_append("$");
+		scratch_buffer_append(associated->name);
+		const char *label = c_asm_label(scratch_buffer_to_string(), scratch_buffer.len);
+		const char *type_name = c_type_name(c, type);
+		cbuffer_printf(&c->decls, "extern const %s %s %s __attribute__((weak));\n", type_name, name, label);
+		cbuffer_printf(&c->globals, "const %s %s = %s;\n", type_name, name, init.data);
+		cbuffer_free(&init);
+		associated->backend_ref = (void *)name;
+	}
+}
+
+static void c_gen_introspection_global(GenContext *c, Type *type, const char *name)
+{
+	Type *parent = type_find_parent_type(type);
+	Type *inner = NULL;
+	IntrospectType kind;
+	ArraySize len = 0;
+	const char **additional = NULL;
+	bool is_external = false;
+	switch (type->type_kind)
+	{
+		case TYPE_OPTIONAL:
+			kind = INTROSPECT_TYPE_OPTIONAL;
+			inner = type->optional;
 			break;
-		case EXPR_OPERATOR_CHARS:
+		case TYPE_FLEXIBLE_ARRAY:
+			kind = INTROSPECT_TYPE_ARRAY;
+			inner = type->array.base;
 			break;
-		case EXPR_OPTIONAL:
+		case TYPE_VECTOR:
+			kind = INTROSPECT_TYPE_VECTOR;
+			inner = type->array.base;
+			len = type->array.len;
 			break;
-		case EXPR_POINTER_OFFSET:
+		case TYPE_ARRAY:
+			kind = INTROSPECT_TYPE_ARRAY;
+			inner = type->array.base;
+			len = type->array.len;
 			break;
-		case EXPR_POST_UNARY:
+		case TYPE_SLICE:
+			kind = INTROSPECT_TYPE_SLICE;
+			inner = type->array.base;
 			break;
-		case EXPR_RETHROW:
+		case TYPE_ANY:
+			kind = INTROSPECT_TYPE_ANY;
 			break;
-		case EXPR_RETVAL:
+		case TYPE_INTERFACE:
+			kind = INTROSPECT_TYPE_INTERFACE;
 			break;
-		case EXPR_SLICE:
+		case TYPE_POINTER:
+			kind = INTROSPECT_TYPE_POINTER;
+			inner = type->pointer;
 			break;
-		case EXPR_SLICE_ASSIGN:
+		case TYPE_DISTINCT:
+			kind = INTROSPECT_TYPE_DISTINCT;
+			inner = type->decl->distinct->type;
 			break;
-		case EXPR_SLICE_COPY:
+		case TYPE_ENUM:
+		{
+			Decl *decl = type->decl;
+			kind = INTROSPECT_TYPE_ENUM;
+			inner = type_base(type);
+			is_external = decl->is_dynamic && decl->unit->module != c->code_module;
+			len = is_external ? 0 : vec_size(decl->enums.values);
+			for (unsigned i = 0; i < len; i++)
+			{
+				const char *enum_name = decl->obfuscate ? str_printf(".enum.%u", i) : decl->enums.values[i]->name;
+				size_t name_len = strlen(enum_name);
+				vec_add(additional, str_printf("{ %s, %llu }", c_emit_string_ptr(c, enum_name, name_len), (unsigned long long)name_len));
+			}
 			break;
-		case EXPR_SUBSCRIPT:
+		}
+		case TYPE_STRUCT:
+		case TYPE_UNION:
+			kind = type->type_kind == TYPE_UNION ? INTROSPECT_TYPE_UNION : INTROSPECT_TYPE_STRUCT;
+			len = vec_size(type->decl->strukt.members);
+			FOREACH(Decl *, member, type->decl->strukt.members)
+			{
+				if (decl_is_struct_type(member)) c_typeid_global(c, member->type);
+			}
 			break;
-		case EXPR_SUBSCRIPT_ADDR:
+		case TYPE_FUNC_RAW:
+			kind = INTROSPECT_TYPE_FUNC;
 			break;
-		case EXPR_SUBSCRIPT_ASSIGN:
+		case TYPE_BITSTRUCT:
+			kind = INTROSPECT_TYPE_BITSTRUCT;
+			inner = type->decl->strukt.container_type->type;
 			break;
-		case EXPR_SWIZZLE:
+		case TYPE_VOID:
+			kind = INTROSPECT_TYPE_VOID;
 			break;
-		case EXPR_TERNARY:
+		case TYPE_BOOL:
+			kind = INTROSPECT_TYPE_BOOL;
 			break;
-		case EXPR_TEST_HOOK:
+		case ALL_SIGNED_INTS:
+			kind = INTROSPECT_TYPE_SIGNED_INT;
 			break;
-		case EXPR_TRY:
+		case ALL_UNSIGNED_INTS:
+			kind = INTROSPECT_TYPE_UNSIGNED_INT;
 			break;
-		case EXPR_TRY_UNWRAP_CHAIN:
+		case ALL_FLOATS:
+			kind = INTROSPECT_TYPE_FLOAT;
 			break;
-		case EXPR_TYPEID_INFO:
+		case TYPE_ANYFAULT:
+			kind = INTROSPECT_TYPE_ANYFAULT;
 			break;
-		case EXPR_UNARY:
+		case TYPE_TYPEID:
+			kind = INTROSPECT_TYPE_TYPEID;
 			break;
+		default:
+			UNREACHABLE
 	}
-	PRINT("/* TODO EXPR */\n");
+	unsigned additional_count = vec_size(additional);
+	const char *type_name = c_introspect_type_name(c, additional_count);
+	scratch_buffer_clear();
+	scratch_buffer_append("$ct.");
+	type_mangle_introspect_name_to_buffer(type);
+	// Anonymous and @local types may share their mangled name, so they get a unique one.
+	if (str_has_suffix(scratch_buffer_to_string(), "$anon")
+	    || (type_is_user_defined(type) && type->decl->visibility == VISIBLE_LOCAL))
+	{
+		scratch_buffer_printf(".%u", ++c->temp_id);
+	}
+	const char *label = c_asm_label(scratch_buffer_to_string(), scratch_buffer.len);
+	AlignSize alignment = type_abi_alignment(type_voidptr);
+	if (is_external)
+	{
+		cbuffer_printf(&c->decls, "extern %s %s %s __attribute__((aligned(%u)));\n", type_name, name, label, (unsigned)alignment);
+		return;
+	}
+	cbuffer_printf(&c->decls, "extern %s %s %s __attribute__((weak, aligned(%u)));\n", type_name, name, label, (unsigned)alignment);
+	CBuffer init = { 0 };
+	cbuffer_printf(&init, "%s %s = { %u, %s, 0, %llu, %s, %llu, { ", type_name, name, (unsigned)kind,
+	               parent ? c_typeid_value(c, parent->canonical) : "0",
+	               (unsigned long long)(type->type_kind == TYPE_FUNC_RAW ? type_size(type_voidptr) : type_size(type)),
+	               inner ? c_typeid_value(c, inner) : "0", (unsigned long long)len);
+	FOREACH_IDX(i, const char *, value, additional)
+	{
+		cbuffer_printf(&init, "%s%s", i ? ", " : "", value);
+	}
+	cbuffer_append(&init, " } };\n");
+	cbuffer_append(&c->globals, init.data);
+	cbuffer_free(&init);
+	if (type->type_kind == TYPE_ENUM && !is_external) c_gen_enum_associated(c, type->decl);
 }
 
-static void c_emit_jump_to_optional_exit(GenContext *c, int value)
+// -- Values
+
+void c_value_set(CValue *value, const char *val, Type *type)
 {
-	TODO
+	type = type_lowering(type);
+	*value = (CValue) { .kind = CV_VALUE, .value = val, .type = type, .alignment = type_abi_alignment(type) };
 }
-static int c_emit_load(GenContext *c, VariableId id)
+
+void c_value_set_address(CValue *value, const char *addr, Type *type, AlignSize alignment)
 {
-	TODO
+	ASSERT(alignment > 0);
+	*value = (CValue) { .kind = CV_ADDRESS, .value = addr, .type = type_lowering(type), .alignment = alignment };
 }
 
-static void c_value_fold_optional(GenContext *c, CValue *value)
+void c_value_set_address_abi_aligned(CValue *value, const char *addr, Type *type)
 {
-	if (value->kind == CV_OPTIONAL_ADDRESS)
-	{
-		c_emit_jump_to_optional_exit(c, c_emit_load(c, value->optional));
-		value->kind = CV_ADDRESS;
-	}
+	c_value_set_address(value, addr, type, type_abi_alignment(type));
 }
 
-static void c_emit_ignored_expr(GenContext *c, Expr *expr)
+void c_value_set_decl(GenContext *c, CValue *value, Decl *decl)
 {
-	CValue value;
-
-	// For a standalone catch, we can ignore storing the value.
-	if (IS_OPTIONAL(expr))
+	decl = decl_flatten(decl);
+	if (decl->decl_kind == DECL_FUNC)
 	{
-		int discard_fail = c_create_label(c);
-		PUSH_CATCH_VAR_BLOCK(NULL, discard_fail);
-		c_emit_expr(c, &value, expr);
-		c_value_fold_optional(c, &value);
-		c_emit_goto_label(c, discard_fail);
-		c_emit_label(c, discard_fail);
-		POP_CATCH();
+		c_value_set(value, str_printf("((void *)%s)", c_decl_name(c, decl)), type_get_func_ptr(decl->type));
 		return;
 	}
-	c_emit_expr(c, &value, expr);
+	const char *name = c_decl_name(c, decl);
+	c_value_set_address(value, str_printf("((void *)&%s)", name), decl->type, decl->alignment);
+	const char *optional = c_decl_optional_name(c, decl);
+	if (optional)
+	{
+		value->kind = CV_ADDRESS_OPTIONAL;
+		value->optional = optional;
+	}
 }
 
-static void c_emit_expr_stmt(GenContext *c, Ast *ast)
+const char *c_temp_with_value(GenContext *c, Type *type, const char *value)
 {
-	PRINT("/*EXPR*/\n");
-	c_emit_ignored_expr(c, ast->expr_stmt);
+	const char *name = c_temp_name(c);
+	c_emit(c, "%s %s = %s;", c_type_name(c, type), name, value);
+	return name;
 }
 
-static void c_emit_local_decl(GenContext *c, Decl *decl, CValue *value)
+const char *c_temp_alloca(GenContext *c, Type *type)
 {
-	switch (decl->var.kind)
+	const char *name = c_temp_name(c);
+	if (!c->cur_func)
 	{
-		case VARDECL_CONST:
-			PRINT("/* LOCAL DECL */\n");
-//			llvm_emit_local_static(c, decl, value);
-			return;
-		case VARDECL_LOCAL:
-			if (decl->var.is_static)
-			{
-				PRINT("/* LOCAL DECL */\n");
-//				llvm_emit_local_static(c, decl, value);
-				return;
-			}
-			break;
-		case VARDECL_PARAM_CT:
-		case VARDECL_PARAM_CT_TYPE:
-		case VARDECL_PARAM_EXPR:
-		case VARDECL_GLOBAL:
-		case VARDECL_MEMBER:
-		case VARDECL_BITMEMBER:
-			UNREACHABLE;
-		case VARDECL_PARAM:
-		case VARDECL_UNWRAPPED:
-		case VARDECL_ERASE:
-		case VARDECL_REWRAPPED:
-			return;
-		case VARDECL_LOCAL_CT:
-		case VARDECL_LOCAL_CT_TYPE:
-			UNREACHABLE
+		// In the global constructor the storage may be referenced by a global, so it must outlive the call.
+		cbuffer_printf(&c->globals, "static %s %s;\n", c_type_name(c, type), name);
+		return str_printf("((void *)&%s)", name);
 	}
+	c_emit(c, "%s %s;", c_type_name(c, type), name);
+	return str_printf("((void *)&%s)", name);
+}
 
-	// Get the declaration and the LLVM type.
-	Type *var_type = type_lowering(decl->type);
+const char *c_offset_addr(const char *addr, ArraySize offset)
+{
+	if (!offset) return addr;
+	return str_printf("((void *)((char *)%s + %llu))", addr, (unsigned long long)offset);
+}
 
-	*value = (CValue) { .var = c_create_variable(c), .kind = CV_VALUE, .type = var_type };
-	decl->backend_id = value->var;
-	PRINTF("%s ___var_%d;\n", c_type_name(c, var_type), value->var);
-	// Create optional storage
-	bool is_optional = IS_OPTIONAL(decl);
-	if (is_optional)
+const char *c_load_raw(GenContext *c, const char *addr, Type *type, AlignSize alignment)
+{
+	const char *type_name = c_type_name(c, type);
+	const char *name = c_temp_name(c);
+	if (type == type_bool)
+	{
+		// Bools are stored as bytes and truncated on load, as the LLVM backend does.
+		c_emit(c, "%s %s = *(const unsigned char *)%s & 1;", type_name, name, addr);
+		return name;
+	}
+	if (alignment && alignment < type_abi_alignment(type))
 	{
-		decl->var.optional_id = value->optional = c_create_variable(c);
-		PRINTF("void* ___var_f_%d;\n", value->optional);
+		c_emit(c, "%s %s;", type_name, name);
+		c_emit(c, "__builtin_memcpy(&%s, %s, sizeof(%s));", name, addr, name);
+		return name;
 	}
+	c_emit(c, "%s %s = *(%s *)%s;", type_name, name, type_name, addr);
+	return name;
+}
 
-	// Grab the init expression
-	Expr *init = decl->var.init_expr;
-	if (init)
+void c_store_raw(GenContext *c, const char *addr, Type *type, AlignSize alignment, const char *value)
+{
+	const char *type_name = c_type_name(c, type);
+	if (type_name[0] == 'v' && str_eq(type_name, "void")) return;
+	if (alignment && alignment < type_abi_alignment(type))
 	{
-		CValue out;
-		c_emit_expr(c, &out, decl->var.init_expr);
-		if (out.kind == CV_OPTIONAL_ADDRESS)
-		{
-			PRINTF("___var_f_%d = __var_%d;\n", value->optional, out.optional);
-		}
-		else if (value->optional)
-		{
-			PRINTF("___var_f_%d = NULL;\n", value->optional);
-		}
-		PRINTF("___var_%d = ___var_%d;\n", value->var, out.var);
+		const char *temp = c_temp_with_value(c, type, value);
+		c_emit(c, "__builtin_memcpy(%s, &%s, sizeof(%s));", addr, temp, temp);
 		return;
 	}
+	c_emit(c, "*(%s *)%s = %s;", type_name, addr, value);
+}
+
+void c_value_rvalue(GenContext *c, CValue *value)
+{
+	if (!c_value_is_addr(value)) return;
+	c_value_fold_optional(c, value);
+	value->value = c_load_raw(c, value->value, value->type, value->alignment);
+	value->kind = CV_VALUE;
+}
 
-	// If the variable has a no-init, then skip
-	if (decl->var.no_init)
+void c_value_addr(GenContext *c, CValue *value)
+{
+	c_value_fold_optional(c, value);
+	if (value->kind == CV_ADDRESS) return;
+	if (!c->cur_func)
 	{
+		const char *addr = c_temp_alloca(c, value->type);
+		c_emit(c, "*(%s *)%s = %s;", c_type_name(c, value->type), addr, value->value);
+		c_value_set_address_abi_aligned(value, addr, value->type);
 		return;
 	}
+	const char *temp = c_temp_with_value(c, value->type, value->value);
+	c_value_set_address_abi_aligned(value, str_printf("((void *)&%s)", temp), value->type);
+}
 
-	if (is_optional)
+void c_emit_jump_to_optional_exit(GenContext *c, const char *fault)
+{
+	if (str_eq(fault, "0")) return;
+	if (!c->catch.block)
 	{
-		PRINTF("___var_f_%d = NULL;\n", value->optional);
-		value->kind = CV_VALUE;
+		c_emit(c, "if (%s) __builtin_unreachable();", fault);
+		return;
 	}
+	// Faults are the unlikely path, keep them out of line like the LLVM backend does.
+	if (c->catch.fault)
+	{
+		c_emit(c, "if (__builtin_expect(%s != 0, 0)) { *(%s *)%s = %s; goto __L%d; }", fault, c_type_name(c, type_fault), c->catch.fault, fault, c->catch.block);
+		return;
+	}
+	c_emit(c, "if (__builtin_expect(%s != 0, 0)) goto __L%d;", fault, c->catch.block);
+}
 
-	PRINT("/* TODO ZERO INIT */\n");
-	//llvm_store_zero(c, value);
-	//llvm_value_set(value, llvm_get_zero(c, var_type), var_type);
+void c_value_fold_optional(GenContext *c, CValue *value)
+{
+	if (value->kind != CV_ADDRESS_OPTIONAL) return;
+	const char *fault = c_temp_with_value(c, type_fault, value->optional);
+	c_emit_jump_to_optional_exit(c, fault);
+	value->kind = CV_ADDRESS;
 }
 
-static void c_emit_return(GenContext *c, Ast *stmt)
+void c_store(GenContext *c, CValue *destination, CValue *value)
 {
-	Expr *expr = stmt->return_stmt.expr;
-	if (expr && expr->expr_kind == EXPR_OPTIONAL)
+	ASSERT(c_value_is_addr(destination));
+	if (value->type == type_void) return;
+	if (c_value_is_addr(value))
 	{
-		PRINT("/* RETURN */\n");
-		/*
-		BEValue be_value;
-		llvm_emit_expr(c, &be_value, expr->inner_expr);
-		if (ast->return_stmt.cleanup_fail)
-		{
-			llvm_value_rvalue(c, &be_value);
-			LLVMValueRef error_out = llvm_emit_alloca_aligned(c, type_fault, "reterr");
-			llvm_store_to_ptr(c, error_out, &be_value);
-			PUSH_DEFER_ERROR(error_out);
-			llvm_emit_statement_chain(c, ast->return_stmt.cleanup_fail);
-			POP_DEFER_ERROR();
-		}
-		llvm_emit_return_abi(c, NULL, &be_value);
-		 */
+		c_value_fold_optional(c, value);
+		TypeSize size = type_size(destination->type);
+		c_emit(c, "__builtin_memmove(%s, %s, %llu);", destination->value, value->value, (unsigned long long)size);
 		return;
 	}
+	c_store_raw(c, destination->value, destination->type, destination->alignment, value->value);
+}
+
+void c_store_zero(GenContext *c, CValue *ref)
+{
+	ASSERT(c_value_is_addr(ref));
+	TypeSize size = type_size(ref->type);
+	if (!size) return;
+	c_emit(c, "__builtin_memset(%s, 0, %llu);", ref->value, (unsigned long long)size);
+}
 
-	PUSH_CATCH();
+const char *c_const_int(Type *type, uint64_t value)
+{
+	type = type_lowering(type);
+	if (type->type_kind == TYPE_BOOL) return value ? "true" : "false";
+	if (type_is_signed(type))
+	{
+		int64_t signed_val = (int64_t)value;
+		if (signed_val == INT64_MIN) return str_printf("((%s)(-0x7FFFFFFFFFFFFFFFLL - 1))", c_builtin_type_name(type));
+		return str_printf("((%s)%lldLL)", c_builtin_type_name(type), (long long)signed_val);
+	}
+	return str_printf("((%s)%lluULL)", c_builtin_type_name(type), (unsigned long long)value);
+}
 
-	int error_return_block = 0;
-	int error_out = 0;
+void c_emit_any_from_value(GenContext *c, CValue *value, Type *type)
+{
+	c_value_addr(c, value);
+	c_value_set(value, c_temp_with_value(c, type_any, str_printf("(__c3_any){ %s, %s }", value->value, c_typeid_value(c, type))), type_any);
+}
 
-	if (!stmt->return_stmt.expr)
+void c_emit_panic(GenContext *c, const char *message, SourceSpan loc, const char *fmt, CValue *args, unsigned arg_count)
+{
+	Decl *panic_var = compiler.context.panic_var;
+	if (no_panic() || !panic_var)
 	{
-		PRINT("return;\n");
+		if (safe_mode_enabled_in(c->cur_func)) c_emit(c, "__builtin_trap();");
+		c_emit(c, "__builtin_unreachable();");
 		return;
 	}
-	PRINT("/* RETURN */\n");
-	return;
-	/*
-	if (c->cur_func.prototype && type_is_optional(c->cur_func.prototype->rtype))
+	File *file = source_file_by_id(loc.file_id);
+	Decl *panicf = fmt ? compiler.context.panicf : NULL;
+	const char *msg = panicf ? fmt : message;
+	const char *func_name = c->cur_func_name ? c->cur_func_name : "";
+	scratch_buffer_clear();
+	const char *msg_slice = str_printf("(__c3_slice){ %s, %llu }", c_emit_string_ptr(c, msg, strlen(msg)), (unsigned long long)strlen(msg));
+	const char *file_slice = str_printf("(__c3_slice){ %s, %llu }", c_emit_string_ptr(c, file->name, strlen(file->name)), (unsigned long long)strlen(file->name));
+	const char *func_slice = str_printf("(__c3_slice){ %s, %llu }", c_emit_string_ptr(c, func_name, strlen(func_name)), (unsigned long long)strlen(func_name));
+	const char *line = str_printf("%uU", span_row(loc));
+	if (panicf)
 	{
-		error_return_block = llvm_basic_block_new(c, "err_retblock");
-		error_out = llvm_emit_alloca_aligned(c, type_fault, "reterr");
-		c->catch = (OptionalCatch) { error_out, error_return_block };
+		FunctionPrototype *prototype = type_get_resolved_prototype(panicf->type);
+		const char *array = "0";
+		if (arg_count)
+		{
+			array = c_temp_alloca(c, type_get_array(type_any, arg_count));
+			for (unsigned i = 0; i < arg_count; i++)
+			{
+				CValue slot;
+				c_value_set_address_abi_aligned(&slot, c_offset_addr(array, i * type_size(type_any)), type_any);
+				c_store(c, &slot, &args[i]);
+			}
+		}
+		c_emit(c, "((%s)%s)(%s, %s, %s, %s, (__c3_slice){ %s, %u });", c_func_ptr_type_name(c, prototype),
+			   c_decl_name(c, panicf), msg_slice, file_slice, func_slice, line, array, arg_count);
+		c_emit(c, "__builtin_unreachable();");
+		return;
 	}
+	FunctionPrototype *prototype = type_get_resolved_prototype(panic_var->type->canonical->pointer);
+	CValue fn;
+	c_value_set_decl(c, &fn, panic_var);
+	c_value_rvalue(c, &fn);
+	c_emit(c, "((%s)%s)(%s, %s, %s, %s);", c_func_ptr_type_name(c, prototype), fn.value, msg_slice, file_slice, func_slice, line);
+	c_emit(c, "__builtin_unreachable();");
+}
 
-	bool has_return_value = ast->return_stmt.expr != NULL;
-	BEValue return_value = { 0 };
-	if (has_return_value)
+void c_emit_panic_if_true(GenContext *c, const char *cond, const char *message, SourceSpan loc, const char *fmt, CValue *arg1, CValue *arg2)
+{
+	if (str_eq(cond, "false")) return;
+	int ok = c_new_label(c);
+	c_emit(c, "if (__builtin_expect(!(%s), 1)) goto __L%d;", cond, ok);
+	CValue args[2];
+	unsigned count = 0;
+	if (arg1)
 	{
-		llvm_emit_expr(c, &return_value, ast->return_stmt.expr);
-		llvm_value_fold_optional(c, &return_value);
-		c->retval = return_value;
+		args[count] = *arg1;
+		c_emit_any_from_value(c, &args[count], args[count].type);
+		count++;
+		if (arg2)
+		{
+			args[count] = *arg2;
+			c_emit_any_from_value(c, &args[count], args[count].type);
+			count++;
+		}
 	}
+	c_emit_panic(c, message, loc, fmt, args, count);
+	c_emit_label(c, ok);
+}
 
-	POP_CATCH();
+// -- Globals
 
-	if (ast->return_stmt.cleanup || ast->return_stmt.cleanup_fail)
+static void c_emit_global_variable_init(GenContext *c, Decl *decl)
+{
+	// Skip real constants.
+	if (!decl->type) return;
+	decl_append_links_to_global(decl);
+	const char *name = c_decl_name(c, decl);
+	if (decl->is_extern) return;
+	bool is_static;
+	const char *linkage = c_decl_linkage(c, decl, &is_static);
+	if (decl->unit->module != c->code_module && !decl->var.is_static) return;
+
+	Expr *init_expr = decl->var.init_expr;
+	// Fold "source" of the init.
+	while (init_expr && init_expr->expr_kind == EXPR_IDENTIFIER)
 	{
-		if (has_return_value)
-		{
-			if (llvm_temp_as_address(c, return_value.type))
-			{
-				LLVMValueRef temp = llvm_emit_alloca_aligned(c, return_value.type, "ret$temp");
-				llvm_store_to_ptr(c, temp, &return_value);
-				llvm_value_set_address_abi_aligned(&return_value, temp, return_value.type);
-			}
-			else
-			{
-				llvm_value_rvalue(c, &return_value);
-			}
-		}
-		llvm_emit_statement_chain(c, ast->return_stmt.cleanup);
+		Decl *inner_decl = decl_flatten(init_expr->ident_expr);
+		if (inner_decl->decl_kind != DECL_VAR) break;
+		if (inner_decl->var.kind != VARDECL_CONST) break;
+		init_expr = inner_decl->var.init_expr;
 	}
-
-	if (llvm_get_current_block_if_in_use(c))
+	const char *init = "{0}";
+	if (init_expr && init_expr->expr_kind != EXPR_OPTIONAL)
 	{
-		// Are we in an expression block?
-		if (!has_return_value)
+		init = expr_is_const_initializer(init_expr)
+				? c_emit_const_initializer(c, init_expr->const_expr.initializer)
+				: c_emit_const_expr_initializer(c, init_expr);
+		if (!init)
 		{
-			llvm_emit_return_implicit(c);
+			// Evaluated by a constructor before anything else runs.
+			init = "{0}";
+			vec_add(c->dynamic_inits, decl);
 		}
-		else
+	}
+	const char *tls = decl->var.is_threadlocal ? "_Thread_local " : "";
+	const char *section = c_section_attribute(decl);
+	cbuffer_printf(&c->globals, "%s%s%s %s%s __attribute__((aligned(%u))) = %s;\n", linkage, tls, c_type_name(c, decl->type),
+	               name, section, (unsigned)decl->alignment, init);
+	const char *optional = decl->var.optional_ref;
+	if (optional)
+	{
+		const char *fault = "0";
+		if (init_expr && init_expr->expr_kind == EXPR_OPTIONAL)
 		{
-			llvm_emit_return_abi(c, &return_value, NULL);
+			Expr *inner = init_expr->inner_expr;
+			ASSERT(expr_is_const(inner) && inner->const_expr.const_kind == CONST_FAULT);
+			Decl *fault_decl = inner->const_expr.fault;
+			if (fault_decl) fault = c_fault_value(c, fault_decl);
 		}
+		cbuffer_printf(&c->globals, "%s%s%s %s = %s;\n", linkage, tls, c_type_name(c, type_fault), optional, fault);
 	}
-	if (error_return_block && LLVMGetFirstUse(LLVMBasicBlockAsValue(error_return_block)))
+}
+
+void c_emit_local_static(GenContext *c, Decl *decl, CValue *value)
+{
+	// In defers we might already have generated this variable.
+	if (!htable_get(&c->decl_names, decl)) c_emit_global_variable_init(c, decl);
+	c_value_set_decl(c, value, decl);
+}
+
+static void c_emit_dynamic_inits(GenContext *c)
+{
+	if (!c->dynamic_inits) return;
+	c->body = (CBuffer) { 0 };
+	c->cur_func = NULL;
+	c->cur_func_name = "";
+	c->cur_proto = NULL;
+	c->catch = (OptionalCatch) { NULL, 0 };
+	FOREACH(Decl *, decl, c->dynamic_inits)
 	{
-		llvm_emit_block(c, error_return_block);
-		PUSH_DEFER_ERROR(error_out);
-		llvm_emit_statement_chain(c, ast->return_stmt.cleanup_fail);
-		POP_DEFER_ERROR();
-		BEValue value;
-		llvm_value_set_address_abi_aligned(&value, error_out, type_fault);
-		llvm_emit_return_abi(c, NULL, &value);
-	}*/
+		Expr *init_expr = decl->var.init_expr;
+		CValue value;
+		c_emit_expr(c, &value, init_expr);
+		CValue ref;
+		c_value_set_decl(c, &ref, decl);
+		ref.kind = CV_ADDRESS;
+		c_store(c, &ref, &value);
+	}
+	cbuffer_printf(&c->functions, "__attribute__((constructor(1))) static void __c3_global_init(void)\n{\n%s}\n", c->body.data);
+	cbuffer_free(&c->body);
 }
 
-static void c_emit_stmt(GenContext *c, Ast *stmt)
+static void c_emit_dynamic_functions(GenContext *c)
 {
-	if (!stmt) return;
-	switch (stmt->ast_kind)
+	if (!c->dynamic_functions) return;
+	c->body = (CBuffer) { 0 };
+	FOREACH(Decl *, decl, c->dynamic_functions)
 	{
-		case AST_POISONED:
-			UNREACHABLE
-		case AST_ASM_STMT:
-			break;
-		case AST_ASM_BLOCK_STMT:
-			break;
-		case AST_ASM_LABEL:
-			break;
-		case AST_ASSERT_STMT:
-			break;
-		case AST_BREAK_STMT:
-			break;
-		case AST_CASE_STMT:
-			break;
-		case AST_COMPOUND_STMT:
-			PRINT("  {\n");
-			c_emit_stmt_chain(c, stmt->compound_stmt.first_stmt);
-			PRINT("  }\n");
-			return;
-		case AST_CONTINUE_STMT:
-			break;
-		case AST_CT_ASSERT:
-			break;
-		case AST_CT_ECHO_STMT:
-			break;
-		case AST_CT_COMPOUND_STMT:
-		case AST_CT_ELSE_STMT:
-			break;
-		case AST_CT_FOREACH_STMT:
-		case AST_CT_FOR_STMT:
-		case AST_CT_IF_STMT:
-		case AST_CT_SWITCH_STMT:
-			UNREACHABLE
-		case AST_DECLARE_STMT:
-		{
-			CValue value;
-			c_emit_local_decl(c, stmt->declare_stmt, &value);
-			return;
-		}
-		case AST_DECLS_STMT:
-			break;
-		case AST_DEFAULT_STMT:
-			break;
-		case AST_DEFER_STMT:
-			break;
-		case AST_EXPR_STMT:
-			c_emit_expr_stmt(c, stmt);
-			return;
-		case AST_FOR_STMT:
-			PRINT("/* FOR */\n");
-			break;
-		case AST_FOREACH_STMT:
-			break;
-		case AST_IF_STMT:
-			break;
-		case AST_NOP_STMT:
-			PRINT(";\n");
-			return;
-		case AST_RETURN_STMT:
-			c_emit_return(c, stmt);
-			return;
-		case AST_BLOCK_EXIT_STMT:
-			break;
-		case AST_SWITCH_STMT:
-			break;
-		case AST_NEXTCASE_STMT:
-			break;
-		case AST_CONTRACT:
-			break;
-		case AST_CONTRACT_FAULT:
-			break;
+		Type *type = typeget(decl->func_decl.type_parent);
+		Decl *proto = declptrzero(decl->func_decl.interface_method);
+		const char *proto_ref = proto ? c_decl_name(c, proto) : c_selector_name(c, decl->name);
+		const char *name = str_printf("__c3_dyn%u", ++c->temp_id);
+		scratch_buffer_clear();
+		scratch_buffer_append("$ct.dyn.");
+		scratch_buffer_set_extern_decl_name(decl, false);
+		const char *label = c_asm_label(scratch_buffer_to_string(), scratch_buffer.len);
+		cbuffer_printf(&c->decls, "extern __c3_dtable %s %s __attribute__((weak));\n", name, label);
+		cbuffer_printf(&c->globals, "__c3_dtable %s = { (void *)%s, %s, (__c3_dtable *)(uintptr_t)-1, (void *)&%s };\n",
+		               name, c_decl_name(c, decl), proto_ref, c_typeid_global(c, type));
+		// The first to register a weak entry links it to the end of the type's dtable chain.
+		c_emit(c, "if (%s.next == (__c3_dtable *)(uintptr_t)-1)", name);
+		c_emit(c, "{");
+		c_emit(c, "\t__c3_dtable **ref = (__c3_dtable **)&((__c3_introspect0 *)(uintptr_t)%s)->dtable;", c_typeid_value(c, type));
+		c_emit(c, "\twhile (*ref) ref = &(*ref)->next;");
+		c_emit(c, "\t*ref = &%s;", name);
+		c_emit(c, "\t%s.next = NULL;", name);
+		c_emit(c, "}");
 	}
-	PRINT("/* TODO */\n");
+	c_introspect_type_name(c, 0);
+	cbuffer_printf(&c->functions, "__attribute__((constructor(1))) static void __c3_dynamic_register(void)\n{\n%s}\n", c->body.data);
+	cbuffer_free(&c->body);
 }
-static void c_emit_function(GenContext *c, Decl *fn)
+
+static void c_emit_function_decl(GenContext *c, Decl *decl)
+{
+	ASSERT_SPAN(decl, decl->decl_kind == DECL_FUNC);
+	c_decl_name(c, decl);
+}
+
+static void c_emit_function(GenContext *c, Decl *decl)
 {
-	Signature *sig = &fn->func_decl.signature;
-	if (!fn->is_external_visible)
+	if (decl->func_decl.attr_dynamic) vec_add(c->dynamic_functions, decl);
+	const char *name = c_decl_name(c, decl);
+	FunctionPrototype *prototype = type_get_resolved_prototype(decl->type);
+	const char *xtor = "";
+	if (decl->func_decl.attr_init && compiler.context.init_audit)
 	{
-		PRINTF("static ");
+		// The stdlib times the call, see --audit-init.
+		cbuffer_printf(&c->functions, "__attribute__((constructor(%u))) static void __c3_init_audit%u(void)\n{\n\t%s(%s, \"%s::%s\", %u);\n}\n",
+		               decl->func_decl.priority, ++c->temp_id, c_decl_name(c, compiler.context.init_audit), name,
+		               decl->unit->module->name->module, decl->name, decl->func_decl.priority);
 	}
+	else if (decl->func_decl.attr_init)
+	{
+		xtor = str_printf("__attribute__((constructor(%u))) ", decl->func_decl.priority);
+	}
+	else if (decl->func_decl.attr_finalizer)
+	{
+		xtor = str_printf("__attribute__((destructor(%u))) ", decl->func_decl.priority);
+	}
+	c->body = (CBuffer) { 0 };
+	c_emit_function_body(c, decl);
+	bool is_static;
+	const char *linkage = c_decl_linkage(c, decl, &is_static);
+	cbuffer_printf(&c->functions, "%s%s%s %s(%s)\n{\n%s}\n", xtor, is_static ? "static " : "",
+	               c_type_name(c, prototype->abi_ret_type), name,
+	               decl->func_decl.attr_naked ? c_function_params(c, decl, prototype, false) : c_function_params(c, decl, prototype, true),
+	               c->body.data ? c->body.data : "");
+	(void)linkage;
+	cbuffer_free(&c->body);
+}
 
-	PRINTF("%s ", c_type_name(c, typeget(sig->rtype)));
+static FILE *c_open_output(const char *base_name, const char **filename_ref)
+{
+	const char *dir;
+	if ((compiler.build.emit_llvm || compiler.build.test_output) && compiler.build.ir_file_dir)
+	{
+		// The C output takes the place of the LLVM IR, so it can be inspected the same way.
+		dir = compiler.build.ir_file_dir;
+	}
+	else
+	{
+		dir = compiler.build.object_file_dir ? compiler.build.object_file_dir : compiler.build.build_dir;
+		dir = dir ? file_append_path(dir, "c_backend") : "c_backend";
+		dir_make_recursive(str_copy(dir, strlen(dir)));
+	}
+	const char *filename = *filename_ref = file_append_path(dir, str_printf("%s.c", base_name));
+	FILE *file = fopen(filename, "w");
+	if (!file) error_exit("Failed to open '%s' for writing.", filename);
+	return file;
+}
 
-	fn->is_export = true;
-	scratch_buffer_set_extern_decl_name(fn, true);
-	PRINTF("%s(", scratch_buffer_to_string());
-	FOREACH_IDX(i, Decl *, d, sig->params)
+/**
+ * Write the test or benchmark tables, which the runner reads as slices of names and functions.
+ */
+static const char *c_gen_hook_tables(Module **modules, unsigned module_count, bool benchmarks)
+{
+	const char *filename;
+	FILE *file = c_open_output(benchmarks ? "_$benchmark" : "_$test", &filename);
+	fputs(c_preamble, file);
+	fprintf(file, "typedef struct { const void *ptr; %s len; } __c3_slice;\n", c_builtin_type_name(type_lowering(type_usz)));
+	unsigned count = 0;
+	for (unsigned i = 0; i < module_count; i++)
+	{
+		Module *module = modules[i];
+		FOREACH(Decl *, decl, benchmarks ? module->benchmarks : module->tests)
+		{
+			const char *extern_name = c_extern_name(decl);
+			fprintf(file, "extern void __c3_fn%u(void) %s;\n", count++, c_asm_label(extern_name, strlen(extern_name)));
+		}
+	}
+	if (count)
 	{
-		if (i != 0) PRINT(",");
-		PRINTF("%s ___arg_%d__", c_type_name(c, d->type), i);
+		fputs("static const __c3_slice __c3_names[] = {\n", file);
+		for (unsigned i = 0; i < module_count; i++)
+		{
+			Module *module = modules[i];
+			FOREACH(Decl *, decl, benchmarks ? module->benchmarks : module->tests)
+			{
+				const char *name = str_printf("%s::%s", module->name->module, decl->name);
+				size_t len = strlen(name);
+				fprintf(file, "\t{ %s, %llu },\n", c_string_literal(name, len), (unsigned long long)len);
+			}
+		}
+		fputs("};\nstatic void *const __c3_fns[] = {\n", file);
+		for (unsigned i = 0; i < count; i++) fprintf(file, "\t(void *)__c3_fn%u,\n", i);
+		fputs("};\n", file);
 	}
-	PRINT(") {\n");
-	c_emit_stmt(c, astptrzero(fn->func_decl.body));
-	PRINT("}\n");
+	const char *names_name = benchmarks ? benchmark_names_var_name : test_names_var_name;
+	const char *fns_name = benchmarks ? benchmark_fns_var_name : test_fns_var_name;
+	fprintf(file, "const __c3_slice __c3_name_list %s = { %s, %u };\n", c_asm_label(names_name, strlen(names_name)),
+	        count ? "__c3_names" : "0", count);
+	fprintf(file, "const __c3_slice __c3_fn_list %s = { %s, %u };\n", c_asm_label(fns_name, strlen(fns_name)),
+	        count ? "__c3_fns" : "0", count);
+	if (fclose(file)) error_exit("Failed to write '%s'.", filename);
+	return filename;
 }
 
-static GenContext *c_gen_module(Module *module, int num)
+static const char *c_gen_module(Module *module)
 {
 	if (!vec_size(module->units)) return NULL;
-	// if (compiler.build.emit_stdlib == EMIT_STDLIB_OFF && module_is_stdlib(module)) return NULL;
+	if (compiler.build.emit_stdlib == EMIT_STDLIB_OFF && module_is_stdlib(module)) return NULL;
 
-	scratch_buffer_clear();
-	scratch_buffer_printf("temp%d.c", num);
-	FILE* f = fopen(scratch_buffer_to_string(), "wb");
-	if (!f) error_exit("Failed to output module.");
-	fputs("#include <stdint.h>\n", f);
-	fputs("#include <stddef.h>\n", f);
-	fputs("#include <stdbool.h>\n", f);
+	GenContext context = { .code_module = module, .weaken = module_should_weaken(module) };
+	GenContext *c = &context;
+	htable_init(&c->type_names, 256);
+	htable_init(&c->decl_names, 1024);
+	htable_init(&c->typeid_names, 256);
+	htable_init(&c->selector_names, 64);
+	htable_init(&c->func_types, 128);
+	htable_init(&c->introspect_types, 16);
 
+	bool only_used = strip_unused();
 	bool has_elements = false;
-	GenContext *c = cmalloc(sizeof(GenContext));
-	*c = (GenContext) { .file = f };
-	htable_init(&c->gen_decl, 1024);
-	htable_init(&c->gen_decl, 1024);
 
-	bool only_used = strip_unused();
 	FOREACH(CompilationUnit *, unit, module->units)
 	{
 		FOREACH(Decl *, method, unit->methods)
 		{
 			if (only_used && !method->is_live) continue;
-			has_elements |= c_emit_function_decl(c, method);
-		}
-		FOREACH(Decl *, func, unit->functions)
-		{
-			if (only_used && !func->is_live) continue;
-			has_elements |= c_emit_function_decl(c, func);
+			c_emit_function_decl(c, method);
 		}
-
 		FOREACH(Decl *, type_decl, unit->types)
 		{
 			if (only_used && !type_decl->is_live) continue;
-			c_emit_type_decl(c, type_decl->type);
-		}
-	}
-	FOREACH(CompilationUnit *, unit, module->units)
-	{
-		FOREACH(Decl *, method, unit->methods)
-		{
-			if (only_used && !method->is_live) continue;
-			has_elements = true;
-			c_emit_function(c, method);
-		}
-		FOREACH(Decl *, func, unit->functions)
-		{
-			if (only_used && !func->is_live) continue;
-			has_elements = true;
-			c_emit_function(c, func);
+			switch (type_decl->decl_kind)
+			{
+				case DECL_DISTINCT:
+				case DECL_STRUCT:
+				case DECL_UNION:
+				case DECL_BITSTRUCT:
+					if (decl_needs_eager_introspection(type_decl)) c_typeid_global(c, type_decl->type);
+					break;
+				default:
+					break;
+			}
 		}
-	}
-/*
-
 		FOREACH(Decl *, enum_decl, unit->enums)
 		{
 			if (only_used && !enum_decl->is_live) continue;
-			llvm_emit_type_decls(gen_context, enum_decl);
+			if (enum_decl->decl_kind == DECL_ENUM && decl_needs_eager_introspection(enum_decl)) c_typeid_global(c, enum_decl->type);
 		}
-
 		FOREACH(Decl *, func, unit->functions)
 		{
 			if (only_used && !func->is_live) continue;
-			if (func->func_decl.attr_test)
-			{
-				if (!compiler.build.testing) continue;
-				vec_add(module->tests, func);
-			}
-			if (func->func_decl.attr_benchmark)
-			{
-				if (!compiler.build.benchmarking) continue;
-				vec_add(module->benchmarks, func);
-			}
-			llvm_emit_function_decl(gen_context, func);
+			if (func->func_decl.attr_test && !compiler.build.testing) continue;
+			if (func->func_decl.attr_benchmark && !compiler.build.benchmarking) continue;
+			c_emit_function_decl(c, func);
 		}
-
-
 		FOREACH(Decl *, func, unit->lambdas)
 		{
 			if (only_used && !func->is_live) continue;
 			has_elements = true;
-			llvm_emit_function_decl(gen_context, func);
+			c_emit_function_decl(c, func);
 		}
-
-		if (compiler.build.type != TARGET_TYPE_TEST && compiler.build.type != TARGET_TYPE_BENCHMARK && unit->main_function && unit->main_function->is_synthetic)
+		if (unit->main_function && unit->main_function->is_synthetic)
 		{
 			has_elements = true;
-			llvm_emit_function_decl(gen_context, unit->main_function);
+			c_emit_function_decl(c, unit->main_function);
 		}
-*/
+	}
 
-/*
 	FOREACH(CompilationUnit *, unit, module->units)
 	{
-		gen_context->debug.compile_unit = unit->llvm.debug_compile_unit;
-		gen_context->debug.file = (DebugFile){
-				.debug_file = unit->llvm.debug_file,
-				.file_id = unit->file->file_id };
-
 		FOREACH(Decl *, var, unit->vars)
 		{
 			if (only_used && !var->is_live) continue;
 			has_elements = true;
-			llvm_get_ref(gen_context, var);
+			c_emit_global_variable_init(c, var);
 		}
-
-		FOREACH(Decl *, var, unit->vars)
-		{
-			if (only_used && !var->is_live) continue;
-			has_elements = true;
-			llvm_emit_global_variable_init(gen_context, var);
-		}
-
 		FOREACH(Decl *, decl, unit->functions)
 		{
 			if (decl->func_decl.attr_test && !compiler.build.testing) continue;
 			if (decl->func_decl.attr_benchmark && !compiler.build.benchmarking) continue;
 			if (only_used && !decl->is_live) continue;
-			if (decl->func_decl.body)
-			{
-				has_elements = true;
-				llvm_emit_function_body(gen_context, decl);
-			}
+			if (!decl->func_decl.body) continue;
+			if (decl->func_decl.attr_test) vec_add(module->tests, decl);
+			if (decl->func_decl.attr_benchmark) vec_add(module->benchmarks, decl);
+			has_elements = true;
+			c_emit_function(c, decl);
 		}
-
 		FOREACH(Decl *, func, unit->lambdas)
 		{
 			if (only_used && !func->is_live) continue;
 			has_elements = true;
-			llvm_emit_function_body(gen_context, func);
+			c_emit_function(c, func);
 		}
-
-		if (compiler.build.type != TARGET_TYPE_TEST && compiler.build.type != TARGET_TYPE_BENCHMARK && unit->main_function && unit->main_function->is_synthetic)
+		if (unit->main_function && unit->main_function->is_synthetic)
 		{
 			has_elements = true;
-			llvm_emit_function_body(gen_context, unit->main_function);
+			c_emit_function(c, unit->main_function);
 		}
-
 		FOREACH(Decl *, decl, unit->methods)
 		{
 			if (only_used && !decl->is_live) continue;
 			if (!decl->func_decl.body) continue;
 			has_elements = true;
-			llvm_emit_function_body(gen_context, decl);
+			c_emit_function(c, decl);
 		}
-
-		gencontext_end_file_emit(gen_context, unit);
-
-	}
-
-	llvm_emit_dynamic_functions(gen_context, gen_context->dynamic_functions);
-
-	llvm_emit_constructors_and_destructors(gen_context);
-
-	if (llvm_use_debug(gen_context))
-	{
-		LLVMDIBuilderFinalize(gen_context->debug.builder);
-		LLVMDisposeDIBuilder(gen_context->debug.builder);
 	}
+	c_emit_dynamic_functions(c);
+	c_emit_dynamic_inits(c);
 
-	// If it's in test or benchmark, then we want to serialize the IR before it is optimized.
-	if (compiler.build.test_output || compiler.build.benchmark_output)
-	{
-		gencontext_print_llvm_ir(gen_context);
-		gencontext_verify_ir(gen_context);
-	}
-	if (!has_elements) return NULL;
-	return gen_context;
-*/
-	fclose(f);
-	if (!has_elements)
+	const char *filename = NULL;
+	if (has_elements)
 	{
-		scratch_buffer_clear();
-		scratch_buffer_printf("temp%d.c", num);
-		file_delete_file(scratch_buffer_to_string());
+		FILE *file = c_open_output(module_create_object_file_name(module), &filename);
+		fputs(c_preamble, file);
+		fprintf(file, "typedef struct { void *ptr; %s len; } __c3_slice;\n", c_builtin_type_name(type_lowering(type_usz)));
+		fprintf(file, "typedef struct { void *ptr; %s type; } __c3_any;\n", c_builtin_type_name(type_lowering(type_typeid)));
+		fputs("typedef struct __c3_dtable_ { void *function; void *selector; struct __c3_dtable_ *next; void *type; } __c3_dtable;\n", file);
+		if (c->types.data) fputs(c->types.data, file);
+		if (c->needs_dyn_search)
+		{
+			// A call site cache points to the last entry found, or to the empty entry whose type never matches.
+			fputs("static __c3_dtable __c3_dyn_missing;\n"
+			      "static __attribute__((noinline)) __c3_dtable *__c3_dyn_search(__c3_dtable *table, void *selector, __c3_dtable **cache)\n"
+			      "{\n"
+			      "\tfor (; table; table = table->next) if (table->selector == selector) break;\n"
+			      "\tif (!table) table = &__c3_dyn_missing;\n"
+			      "\t__atomic_store_n(cache, table, __ATOMIC_RELAXED);\n"
+			      "\treturn table;\n"
+			      "}\n"
+			      "static inline void *__c3_dyn_find(__c3_dtable **cache, void *type, void *selector)\n"
+			      "{\n"
+			      "\t__c3_dtable *entry = __atomic_load_n(cache, __ATOMIC_RELAXED);\n"
+			      "\tif (entry->type != type) entry = __c3_dyn_search((__c3_dtable *)((__c3_introspect0 *)type)->dtable, selector, cache);\n"
+			      "\treturn entry->function;\n"
+			      "}\n", file);
+		}
+		if (c->decls.data) fputs(c->decls.data, file);
+		if (c->globals.data) fputs(c->globals.data, file);
+		if (c->functions.data) fputs(c->functions.data, file);
+		if (fclose(file)) error_exit("Failed to write '%s'.", filename);
 	}
-	return c;
+	cbuffer_free(&c->types);
+	cbuffer_free(&c->decls);
+	cbuffer_free(&c->globals);
+	cbuffer_free(&c->functions);
+	return filename;
 }
 
 void **c_gen(Module** modules, unsigned module_count)
 {
 	if (!module_count) return NULL;
-	void **gen_contexts = NULL;
+	const char **files = NULL;
 	for (unsigned i = 0; i < module_count; i++)
 	{
-		c_gen_module(modules[i], i);
+		const char *file = c_gen_module(modules[i]);
+		if (file) vec_add(files, file);
 	}
-	return NULL;
-}
\ No newline at end of file
+	if (!files) return NULL;
+	if (compiler.build.benchmarking) vec_add(files, c_gen_hook_tables(modules, module_count, true));
+	if (compiler.build.testing) vec_add(files, c_gen_hook_tables(modules, module_count, false));
+	return (void **)files;
+}
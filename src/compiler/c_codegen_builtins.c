@@ -0,0 +1,1043 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
+#include "c_codegen_internal.h"
+
+static void c_builtin_args(GenContext *c, Expr **args, const char **slots, unsigned count)
+{
+	for (unsigned i = 0; i < count; i++)
+	{
+		slots[i] = c_emit_expr_rvalue(c, args[i]);
+	}
+}
+
+static void c_builtin_unsupported(BuiltinFunction func)
+{
+	error_exit("The C backend does not support '$$%s' yet.", builtin_list[func]);
+}
+
+static inline Type *c_element_type(Type *type)
+{
+	return type->type_kind == TYPE_VECTOR ? type->array.base : type;
+}
+
+/**
+ * Refer to an argument in an element-wise expression, for vectors that is the __i:th element.
+ */
+static inline const char *c_elem(Type *type, const char *arg)
+{
+	return type->type_kind == TYPE_VECTOR ? str_printf("%s.a[__i]", arg) : arg;
+}
+
+static void c_builtin_result(GenContext *c, CValue *result, Type *type, const char *element_expr)
+{
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		c_value_set(result, c_emit_vector_op(c, type, element_expr), type);
+		return;
+	}
+	c_value_set(result, c_temp_with_value(c, type, element_expr), type);
+}
+
+static const char *c_atomic_order(uint64_t ordering)
+{
+	switch ((Atomicity)ordering)
+	{
+		case ATOMIC_NONE:
+		case ATOMIC_UNORDERED:
+		case ATOMIC_RELAXED:
+			return "__ATOMIC_RELAXED";
+		case ATOMIC_ACQUIRE:
+			return "__ATOMIC_ACQUIRE";
+		case ATOMIC_RELEASE:
+			return "__ATOMIC_RELEASE";
+		case ATOMIC_ACQUIRE_RELEASE:
+			return "__ATOMIC_ACQ_REL";
+		case ATOMIC_SEQ_CONSISTENT:
+			return "__ATOMIC_SEQ_CST";
+	}
+	UNREACHABLE
+}
+
+/**
+ * Libm style functions are called through their GCC builtins, f16 is computed as a float.
+ */
+static const char *c_float_function(GenContext *c, Type *type, const char *name, const char **args, unsigned count)
+{
+	const char *suffix;
+	switch (type->type_kind)
+	{
+		case TYPE_F64:
+			suffix = "";
+			break;
+		case TYPE_F128:
+			suffix = "f128";
+			break;
+		default:
+			suffix = "f";
+			break;
+	}
+	CBuffer buffer = { 0 };
+	cbuffer_printf(&buffer, "(%s)__builtin_%s%s(", c_type_name(c, type), name, suffix);
+	for (unsigned i = 0; i < count; i++)
+	{
+		cbuffer_printf(&buffer, "%s%s", i ? ", " : "", args[i]);
+	}
+	cbuffer_append(&buffer, ")");
+	const char *result = str_copy(buffer.data, buffer.len);
+	cbuffer_free(&buffer);
+	return result;
+}
+
+static void c_emit_float_builtin(GenContext *c, CValue *result, Expr *expr, const char *name)
+{
+	Expr **args = expr->call_expr.arguments;
+	unsigned count = vec_size(args);
+	ASSERT(count > 0 && count <= 3);
+	const char *slots[3];
+	c_builtin_args(c, args, slots, count);
+	Type *type = type_lowering(expr->type);
+	for (unsigned i = 0; i < count; i++) slots[i] = c_elem(type, slots[i]);
+	c_builtin_result(c, result, type, c_float_function(c, c_element_type(type), name, slots, count));
+}
+
+/**
+ * Bit counting builtins are done on the unsigned value, with 128 bit values split in two.
+ */
+static const char *c_bitcount(GenContext *c, BuiltinFunction func, Type *type, const char *value)
+{
+	BitSize bits = type_size(type) * 8;
+	const char *u = str_printf("((unsigned long long)(%s))", value);
+	const char *type_name = c_type_name(c, type);
+	if (bits == 128)
+	{
+		const char *lo = str_printf("((unsigned long long)(unsigned __int128)(%s))", value);
+		const char *hi = str_printf("((unsigned long long)((unsigned __int128)(%s) >> 64))", value);
+		switch (func)
+		{
+			case BUILTIN_POPCOUNT:
+				return str_printf("(%s)(__builtin_popcountll(%s) + __builtin_popcountll(%s))", type_name, lo, hi);
+			case BUILTIN_CTTZ:
+				return str_printf("(%s)(%s ? __builtin_ctzll(%s) : %s ? 64 + __builtin_ctzll(%s) : 128)", type_name, lo, lo, hi, hi);
+			case BUILTIN_CTLZ:
+				return str_printf("(%s)(%s ? __builtin_clzll(%s) : %s ? 64 + __builtin_clzll(%s) : 128)", type_name, hi, hi, lo, lo);
+			default:
+				UNREACHABLE
+		}
+	}
+	const char *masked = bits == 64 ? u : str_printf("(%s & 0x%llxULL)", u, (unsigned long long)((1ULL << bits) - 1));
+	switch (func)
+	{
+		case BUILTIN_POPCOUNT:
+			return str_printf("(%s)__builtin_popcountll(%s)", type_name, masked);
+		case BUILTIN_CTTZ:
+			return str_printf("(%s)(%s ? __builtin_ctzll(%s) : %u)", type_name, masked, masked, (unsigned)bits);
+		case BUILTIN_CTLZ:
+			return str_printf("(%s)(%s ? __builtin_clzll(%s) - %u : %u)", type_name, masked, masked, 64 - (unsigned)bits, (unsigned)bits);
+		default:
+			UNREACHABLE
+	}
+}
+
+static void c_emit_bitcount_builtin(GenContext *c, CValue *result, Expr *expr, BuiltinFunction func)
+{
+	const char *value = c_emit_expr_rvalue(c, expr->call_expr.arguments[0]);
+	Type *type = type_lowering(expr->type);
+	c_builtin_result(c, result, type, c_bitcount(c, func, c_element_type(type), c_elem(type, value)));
+}
+
+static void c_emit_bswap_builtin(GenContext *c, CValue *result, Expr *expr)
+{
+	const char *value = c_emit_expr_rvalue(c, expr->call_expr.arguments[0]);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	const char *elem = c_elem(type, value);
+	const char *type_name = c_type_name(c, element);
+	const char *swapped;
+	switch (type_size(element))
+	{
+		case 1:
+			swapped = elem;
+			break;
+		case 2:
+			swapped = str_printf("(%s)__builtin_bswap16((uint16_t)%s)", type_name, elem);
+			break;
+		case 4:
+			swapped = str_printf("(%s)__builtin_bswap32((uint32_t)%s)", type_name, elem);
+			break;
+		case 8:
+			swapped = str_printf("(%s)__builtin_bswap64((uint64_t)%s)", type_name, elem);
+			break;
+		case 16:
+			swapped = str_printf("(%s)__c3_bswap128((unsigned __int128)%s)", type_name, elem);
+			break;
+		default:
+			UNREACHABLE
+	}
+	c_builtin_result(c, result, type, swapped);
+}
+
+static void c_emit_min_max_builtin(GenContext *c, CValue *result, Expr *expr, bool is_max)
+{
+	const char *slots[2];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 2);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	const char *a = c_elem(type, slots[0]);
+	const char *b = c_elem(type, slots[1]);
+	if (type_is_float(element))
+	{
+		const char *args[2] = { a, b };
+		c_builtin_result(c, result, type, c_float_function(c, element, is_max ? "fmax" : "fmin", args, 2));
+		return;
+	}
+	c_builtin_result(c, result, type, str_printf("(%s %s %s ? %s : %s)", a, is_max ? ">" : "<", b, a, b));
+}
+
+static void c_emit_abs_builtin(GenContext *c, CValue *result, Expr *expr)
+{
+	const char *value = c_emit_expr_rvalue(c, expr->call_expr.arguments[0]);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	const char *elem = c_elem(type, value);
+	if (type_is_float(element))
+	{
+		c_builtin_result(c, result, type, c_float_function(c, element, "fabs", &elem, 1));
+		return;
+	}
+	if (type_is_unsigned(element))
+	{
+		c_builtin_result(c, result, type, elem);
+		return;
+	}
+	c_builtin_result(c, result, type, str_printf("(%s)(%s < 0 ? -%s : %s)", c_type_name(c, element), elem, elem, elem));
+}
+
+static void c_emit_wrap_builtin(GenContext *c, CValue *result, Expr *expr, BuiltinFunction func)
+{
+	const char *slots[2];
+	c_builtin_args(c, expr->call_expr.arguments, slots, func == BUILTIN_EXACT_NEG ? 1 : 2);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	const char *a = c_elem(type, slots[0]);
+	const char *op;
+	switch (func)
+	{
+		case BUILTIN_EXACT_NEG:
+			c_builtin_result(c, result, type, str_printf("(%s)-%s", c_type_name(c, element), a));
+			return;
+		case BUILTIN_EXACT_SUB: op = "-"; break;
+		case BUILTIN_EXACT_ADD: op = "+"; break;
+		case BUILTIN_EXACT_MUL: op = "*"; break;
+		case BUILTIN_EXACT_DIV: op = "/"; break;
+		case BUILTIN_EXACT_MOD: op = "%"; break;
+		default:
+			UNREACHABLE
+	}
+	c_builtin_result(c, result, type, str_printf("(%s)(%s %s %s)", c_type_name(c, element), a, op, c_elem(type, slots[1])));
+}
+
+static void c_emit_overflow_builtin(GenContext *c, CValue *result, Expr *expr, const char *op)
+{
+	const char *slots[3];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 3);
+	Type *type = type_lowering(expr->call_expr.arguments[0]->type);
+	c_value_set(result, c_temp_with_value(c, type_bool, str_printf("__builtin_%s_overflow(%s, %s, (%s *)%s)", op,
+	                                                               slots[0], slots[1], c_type_name(c, type), slots[2])),
+	            type_bool);
+}
+
+static const char *c_int_limit(GenContext *c, Type *type, bool max)
+{
+	const char *type_name = c_type_name(c, type);
+	if (!type_is_signed(type)) return max ? str_printf("((%s)~(%s)0)", type_name, type_name) : str_printf("((%s)0)", type_name);
+	const char *unsigned_name = c_type_name(c, type_int_unsigned_by_bitsize(type_bit_size(type)));
+	const char *int_max = str_printf("((%s)((%s)~(%s)0 >> 1))", type_name, unsigned_name, unsigned_name);
+	return max ? int_max : str_printf("((%s)(-%s - 1))", type_name, int_max);
+}
+
+/**
+ * Saturating arithmetic uses the overflow builtins inside a statement expression,
+ * picking the limit from the signs of the operands on overflow.
+ */
+static void c_emit_saturating_builtin(GenContext *c, CValue *result, Expr *expr, BuiltinFunction func)
+{
+	const char *slots[2];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 2);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	const char *a = c_elem(type, slots[0]);
+	const char *b = c_elem(type, slots[1]);
+	const char *type_name = c_type_name(c, element);
+	const char *max = c_int_limit(c, element, true);
+	const char *min = c_int_limit(c, element, false);
+	bool is_signed = type_is_signed(element);
+	const char *op;
+	const char *limit;
+	switch (func)
+	{
+		case BUILTIN_SAT_ADD:
+			op = "add";
+			limit = is_signed ? str_printf("(%s < 0 ? %s : %s)", b, min, max) : max;
+			break;
+		case BUILTIN_SAT_SUB:
+			op = "sub";
+			limit = is_signed ? str_printf("(%s < 0 ? %s : %s)", b, max, min) : min;
+			break;
+		case BUILTIN_SAT_MUL:
+			op = "mul";
+			limit = is_signed ? str_printf("((%s < 0) != (%s < 0) ? %s : %s)", a, b, min, max) : max;
+			break;
+		case BUILTIN_SAT_SHL:
+		{
+			// Saturate if shifting back doesn't give the original value.
+			const char *shifted = str_printf("(%s)((%s)%s << %s)", type_name,
+			                                 c_type_name(c, type_int_unsigned_by_bitsize(type_bit_size(element))), a, b);
+			limit = is_signed ? str_printf("(%s < 0 ? %s : %s)", a, min, max) : max;
+			c_builtin_result(c, result, type, str_printf("({ %s __s = %s; (%s)(__s >> %s) == %s ? __s : %s; })",
+			                                             type_name, shifted, type_name, b, a, limit));
+			return;
+		}
+		default:
+			UNREACHABLE
+	}
+	c_builtin_result(c, result, type, str_printf("({ %s __s; __builtin_%s_overflow(%s, %s, &__s) ? %s : __s; })",
+	                                             type_name, op, a, b, limit));
+}
+
+/**
+ * Funnel shifts on the unsigned type, with the shift taken modulo the bit width.
+ */
+static void c_emit_funnel_shift_builtin(GenContext *c, CValue *result, Expr *expr, bool left)
+{
+	const char *slots[3];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 3);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	unsigned bits = (unsigned)type_bit_size(element);
+	const char *u = c_type_name(c, type_int_unsigned_by_bitsize(bits));
+	const char *a = str_printf("(%s)%s", u, c_elem(type, slots[0]));
+	const char *b = str_printf("(%s)%s", u, c_elem(type, slots[1]));
+	const char *shift = str_printf("((%s)%s %% %u)", u, c_elem(type, slots[2]), bits);
+	const char *value = left
+			? str_printf("(%s ? (%s << %s) | (%s >> (%u - %s)) : %s)", shift, a, shift, b, bits, shift, a)
+			: str_printf("(%s ? (%s >> %s) | (%s << (%u - %s)) : %s)", shift, b, shift, a, bits, shift, b);
+	c_builtin_result(c, result, type, str_printf("(%s)%s", c_type_name(c, element), value));
+}
+
+static void c_emit_bitreverse_builtin(GenContext *c, CValue *result, Expr *expr)
+{
+	const char *value = c_emit_expr_rvalue(c, expr->call_expr.arguments[0]);
+	Type *type = type_lowering(expr->type);
+	Type *element = c_element_type(type);
+	c_builtin_result(c, result, type, str_printf("(%s)__c3_bitreverse((unsigned __int128)%s, %u)", c_type_name(c, element),
+	                                             c_elem(type, value), (unsigned)type_bit_size(element)));
+}
+
+/**
+ * Masked loads and gathers pick each element from memory or the passthru vector,
+ * the alignment argument has no use in C.
+ */
+static void c_emit_masked_load_builtin(GenContext *c, CValue *result, Expr *expr, bool gather)
+{
+	const char *slots[3];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 3);
+	Type *type = type_lowering(expr->type);
+	const char *element = c_type_name(c, type->array.base);
+	const char *load = gather
+			? str_printf("*(const %s *)%s.a[__i]", element, slots[0])
+			: str_printf("((const %s *)%s)[__i]", element, slots[0]);
+	c_value_set(result, c_emit_vector_op(c, type, str_printf("%s.a[__i] ? %s : %s.a[__i]", slots[1], load, slots[2])), type);
+}
+
+static void c_emit_masked_store_builtin(GenContext *c, CValue *result, Expr *expr, bool scatter)
+{
+	const char *slots[3];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 3);
+	Type *type = type_lowering(expr->call_expr.arguments[1]->type);
+	const char *element = c_type_name(c, type->array.base);
+	const char *store = scatter
+			? str_printf("*(%s *)%s.a[__i]", element, slots[0])
+			: str_printf("((%s *)%s)[__i]", element, slots[0]);
+	c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) if (%s.a[__i]) %s = %s.a[__i];",
+	       (unsigned long long)type->array.len, slots[2], store, slots[1]);
+	c_value_set(result, "0", type_void);
+}
+
+static void c_emit_select_builtin(GenContext *c, CValue *result, Expr *expr)
+{
+	const char *slots[3];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 3);
+	Type *type = type_lowering(expr->type);
+	Type *mask_type = type_lowering(expr->call_expr.arguments[0]->type);
+	c_builtin_result(c, result, type, str_printf("(%s ? %s : %s)", c_elem(mask_type, slots[0]),
+	                                             c_elem(type, slots[1]), c_elem(type, slots[2])));
+}
+
+static void c_emit_reverse_builtin(GenContext *c, CValue *result, Expr *expr)
+{
+	const char *value = c_emit_expr_rvalue(c, expr->call_expr.arguments[0]);
+	Type *type = type_lowering(expr->type);
+	c_builtin_result(c, result, type, str_printf("%s.a[%llu - __i]", value, (unsigned long long)type->array.len - 1));
+}
+
+static void c_emit_shuffle_builtin(GenContext *c, CValue *result, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	const char *value = c_emit_expr_rvalue(c, args[0]);
+	const char *indices = c_emit_expr_rvalue(c, args[1]);
+	unsigned long long len = type_flatten(args[0]->type)->array.len;
+	Type *type = type_lowering(expr->type);
+	c_builtin_result(c, result, type, str_printf("(unsigned long long)%s.a[__i] < %llu ? %s.a[%s.a[__i]] : 0",
+	                                             indices, len, value, indices));
+}
+
+static void c_emit_swizzle_builtin(GenContext *c, CValue *result, Expr *expr, bool swizzle_two)
+{
+	Expr **args = expr->call_expr.arguments;
+	unsigned count = vec_size(args);
+	const char *first = c_emit_expr_rvalue(c, args[0]);
+	Type *source_type = type_lowering(args[0]->type);
+	const char *second = NULL;
+	unsigned mask_start = 1;
+	if (swizzle_two)
+	{
+		second = c_emit_expr_rvalue(c, args[1]);
+		mask_start = 2;
+	}
+	Type *type = type_lowering(expr->type);
+	const char *temp = c_temp_name(c);
+	c_emit(c, "%s %s;", c_type_name(c, type), temp);
+	ArraySize len = source_type->array.len;
+	for (unsigned i = mask_start; i < count; i++)
+	{
+		Expr *index_expr = args[i];
+		ASSERT(expr_is_const_int(index_expr));
+		uint64_t index = index_expr->const_expr.ixx.i.low;
+		const char *source = index < len ? first : second;
+		c_emit(c, "%s.a[%u] = %s.a[%llu];", temp, i - mask_start, source, (unsigned long long)(index < len ? index : index - len));
+	}
+	c_value_set(result, temp, type);
+}
+
+static void c_emit_reduce_builtin(GenContext *c, CValue *result, Expr *expr, BuiltinFunction func)
+{
+	Expr **args = expr->call_expr.arguments;
+	// The float reductions take the start value first.
+	bool has_start = func == BUILTIN_REDUCE_FADD || func == BUILTIN_REDUCE_FMUL;
+	const char *start = has_start ? c_emit_expr_rvalue(c, args[0]) : NULL;
+	Expr *vector_expr = args[has_start ? 1 : 0];
+	const char *vector = c_emit_expr_rvalue(c, vector_expr);
+	Type *vector_type = type_lowering(vector_expr->type);
+	Type *type = type_lowering(expr->type);
+	const char *acc = c_temp_with_value(c, type, start ? start : str_printf("%s.a[0]", vector));
+	const char *elem = str_printf("%s.a[__i]", vector);
+	const char *combine;
+	switch (func)
+	{
+		case BUILTIN_REDUCE_AND: combine = str_printf("%s & %s", acc, elem); break;
+		case BUILTIN_REDUCE_OR: combine = str_printf("%s | %s", acc, elem); break;
+		case BUILTIN_REDUCE_XOR: combine = str_printf("%s ^ %s", acc, elem); break;
+		case BUILTIN_REDUCE_ADD:
+		case BUILTIN_REDUCE_FADD:
+			combine = str_printf("%s + %s", acc, elem);
+			break;
+		case BUILTIN_REDUCE_MUL:
+		case BUILTIN_REDUCE_FMUL:
+			combine = str_printf("%s * %s", acc, elem);
+			break;
+		case BUILTIN_REDUCE_MIN: combine = str_printf("%s < %s ? %s : %s", elem, acc, elem, acc); break;
+		case BUILTIN_REDUCE_MAX: combine = str_printf("%s > %s ? %s : %s", elem, acc, elem, acc); break;
+		default:
+			UNREACHABLE
+	}
+	c_emit(c, "for (unsigned __i = %u; __i < %llu; __i++) %s = (%s)(%s);", start ? 0 : 1,
+	       (unsigned long long)vector_type->array.len, acc, c_type_name(c, type), combine);
+	c_value_set(result, acc, type);
+}
+
+static void c_emit_pointee_access(GenContext *c, CValue *ref, Expr *pointer)
+{
+	const char *ptr = c_emit_expr_rvalue(c, pointer);
+	Type *type = type_lowering(type_lowering(pointer->type)->pointer);
+	c_value_set_address_abi_aligned(ref, ptr, type);
+}
+
+static void c_emit_volatile_load(GenContext *c, CValue *result, Expr *expr)
+{
+	CValue ref;
+	c_emit_pointee_access(c, &ref, expr->call_expr.arguments[0]);
+	const char *type_name = c_type_name(c, ref.type);
+	c_value_set(result, c_temp_with_value(c, ref.type, str_printf("*(volatile %s *)%s", type_name, ref.value)), ref.type);
+}
+
+static void c_emit_volatile_store(GenContext *c, CValue *result, Expr *expr)
+{
+	CValue ref;
+	c_emit_pointee_access(c, &ref, expr->call_expr.arguments[0]);
+	c_emit_expr(c, result, expr->call_expr.arguments[1]);
+	const char *value = c_rvalue(c, result);
+	c_emit(c, "*(volatile %s *)%s = %s;", c_type_name(c, ref.type), ref.value, value);
+}
+
+// The C backend has no portable non-temporal hint, so these are regular accesses.
+static void c_emit_nontemporal_load(GenContext *c, CValue *result, Expr *expr)
+{
+	CValue ref;
+	c_emit_pointee_access(c, &ref, expr->call_expr.arguments[0]);
+	c_value_set(result, c_load_raw(c, ref.value, ref.type, ref.alignment), ref.type);
+}
+
+static void c_emit_nontemporal_store(GenContext *c, CValue *result, Expr *expr)
+{
+	CValue ref;
+	c_emit_pointee_access(c, &ref, expr->call_expr.arguments[0]);
+	c_emit_expr(c, result, expr->call_expr.arguments[1]);
+	c_store_raw(c, ref.value, ref.type, ref.alignment, c_rvalue(c, result));
+}
+
+static void c_emit_unaligned_load(GenContext *c, CValue *result, Expr *expr)
+{
+	CValue ref;
+	c_emit_pointee_access(c, &ref, expr->call_expr.arguments[0]);
+	AlignSize alignment = expr->call_expr.arguments[1]->const_expr.ixx.i.low;
+	c_value_set(result, c_load_raw(c, ref.value, ref.type, alignment), ref.type);
+}
+
+static void c_emit_unaligned_store(GenContext *c, CValue *result, Expr *expr)
+{
+	CValue ref;
+	c_emit_pointee_access(c, &ref, expr->call_expr.arguments[0]);
+	c_emit_expr(c, result, expr->call_expr.arguments[1]);
+	AlignSize alignment = expr->call_expr.arguments[2]->const_expr.ixx.i.low;
+	c_store_raw(c, ref.value, ref.type, alignment, c_rvalue(c, result));
+}
+
+static inline const char *c_atomic_ptr(GenContext *c, Type *type, const char *ptr, bool is_volatile)
+{
+	return str_printf("(%s%s *)%s", is_volatile ? "volatile " : "", c_type_name(c, type), ptr);
+}
+
+static void c_emit_atomic_load(GenContext *c, CValue *result, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	CValue ref;
+	c_emit_pointee_access(c, &ref, args[0]);
+	const char *temp = c_temp_name(c);
+	c_emit(c, "%s %s;", c_type_name(c, ref.type), temp);
+	c_emit(c, "__atomic_load(%s, &%s, %s);", c_atomic_ptr(c, ref.type, ref.value, args[1]->const_expr.b), temp,
+	       c_atomic_order(args[2]->const_expr.ixx.i.low));
+	c_value_set(result, temp, ref.type);
+}
+
+static void c_emit_atomic_store(GenContext *c, CValue *result, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	CValue ref;
+	c_emit_pointee_access(c, &ref, args[0]);
+	c_emit_expr(c, result, args[1]);
+	const char *value = c_temp_with_value(c, ref.type, c_rvalue(c, result));
+	c_emit(c, "__atomic_store(%s, &%s, %s);", c_atomic_ptr(c, ref.type, ref.value, args[2]->const_expr.b), value,
+	       c_atomic_order(args[3]->const_expr.ixx.i.low));
+}
+
+static void c_emit_compare_exchange(GenContext *c, CValue *result, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	CValue ref;
+	c_emit_pointee_access(c, &ref, args[0]);
+	Type *type = ref.type;
+	// The expected value is updated with the old value on failure, so it is the result either way.
+	const char *expected = c_temp_with_value(c, type, c_emit_expr_rvalue(c, args[1]));
+	const char *desired = c_temp_with_value(c, type, c_emit_expr_rvalue(c, args[2]));
+	c_emit(c, "__atomic_compare_exchange(%s, &%s, &%s, %s, %s, %s);",
+	       c_atomic_ptr(c, type, ref.value, args[3]->const_expr.b), expected, desired,
+	       args[4]->const_expr.b ? "true" : "false",
+	       c_atomic_order(args[5]->const_expr.ixx.i.low), c_atomic_order(args[6]->const_expr.ixx.i.low));
+	c_value_set(result, expected, type);
+}
+
+static void c_emit_atomic_fetch(GenContext *c, BuiltinFunction func, CValue *result, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	CValue ref;
+	c_emit_pointee_access(c, &ref, args[0]);
+	Type *type = ref.type;
+	const char *value = c_emit_expr_rvalue(c, args[1]);
+	const char *ptr = c_atomic_ptr(c, type, ref.value, args[2]->const_expr.b);
+	const char *order = c_atomic_order(args[3]->const_expr.ixx.i.low);
+	bool is_float = type_is_float(type);
+	const char *op = NULL;
+	switch (func)
+	{
+		case BUILTIN_ATOMIC_FETCH_EXCHANGE:
+		{
+			const char *desired = c_temp_with_value(c, type, value);
+			const char *old = c_temp_name(c);
+			c_emit(c, "%s %s;", c_type_name(c, type), old);
+			c_emit(c, "__atomic_exchange(%s, &%s, &%s, %s);", ptr, desired, old, order);
+			c_value_set(result, old, type);
+			return;
+		}
+		case BUILTIN_ATOMIC_FETCH_ADD: op = is_float ? NULL : "add"; break;
+		case BUILTIN_ATOMIC_FETCH_SUB: op = is_float ? NULL : "sub"; break;
+		case BUILTIN_ATOMIC_FETCH_OR: op = "or"; break;
+		case BUILTIN_ATOMIC_FETCH_XOR: op = "xor"; break;
+		case BUILTIN_ATOMIC_FETCH_NAND: op = "nand"; break;
+		case BUILTIN_ATOMIC_FETCH_AND: op = "and"; break;
+		default:
+			break;
+	}
+	if (op)
+	{
+		// The atomic builtins reject bool, so those are done on the byte.
+		if (type->type_kind == TYPE_BOOL)
+		{
+			ptr = c_atomic_ptr(c, type_char, ref.value, args[2]->const_expr.b);
+			value = str_printf("(uint8_t)%s", value);
+		}
+		c_value_set(result, c_temp_with_value(c, type, str_printf("(%s)__atomic_fetch_%s(%s, %s, %s)", c_type_name(c, type),
+		                                                          op, ptr, value, order)), type);
+		return;
+	}
+	// Everything else is a compare exchange loop.
+	const char *old = c_temp_name(c);
+	const char *new_value = c_temp_name(c);
+	const char *type_name = c_type_name(c, type);
+	const char *update;
+	switch (func)
+	{
+		case BUILTIN_ATOMIC_FETCH_ADD: update = str_printf("%s + %s", old, value); break;
+		case BUILTIN_ATOMIC_FETCH_SUB: update = str_printf("%s - %s", old, value); break;
+		case BUILTIN_ATOMIC_FETCH_MAX: update = str_printf("%s > %s ? %s : %s", old, value, old, value); break;
+		case BUILTIN_ATOMIC_FETCH_MIN: update = str_printf("%s < %s ? %s : %s", old, value, old, value); break;
+		case BUILTIN_ATOMIC_FETCH_INC_WRAP: update = str_printf("%s >= %s ? 0 : %s + 1", old, value, old); break;
+		case BUILTIN_ATOMIC_FETCH_DEC_WRAP: update = str_printf("%s == 0 || %s > %s ? %s : %s - 1", old, old, value, value, old); break;
+		default:
+			UNREACHABLE
+	}
+	c_emit(c, "%s %s, %s;", type_name, old, new_value);
+	c_emit(c, "__atomic_load(%s, &%s, __ATOMIC_RELAXED);", ptr, old);
+	c_emit(c, "do { %s = (%s)(%s); } while (!__atomic_compare_exchange(%s, &%s, &%s, false, %s, __ATOMIC_RELAXED));",
+	       new_value, type_name, update, ptr, old, new_value, order);
+	c_value_set(result, old, type);
+}
+
+static void c_emit_memory_builtin(GenContext *c, CValue *result, Expr *expr, const char *name)
+{
+	const char *slots[3];
+	c_builtin_args(c, expr->call_expr.arguments, slots, 3);
+	c_emit(c, "__builtin_%s(%s, %s, %s);", name, slots[0], slots[1], slots[2]);
+	c_value_set(result, "0", type_void);
+}
+
+static bool c_emit_sysclock(GenContext *c, CValue *result, bool fenced)
+{
+	switch (compiler.platform.arch)
+	{
+		case ARCH_TYPE_X86:
+		case ARCH_TYPE_X86_64:
+			if (fenced) c_emit(c, "__asm__ volatile (\"lfence\" ::: \"memory\");");
+			c_value_set(result, c_temp_with_value(c, type_ulong, "__builtin_ia32_rdtsc()"), type_ulong);
+			if (fenced) c_emit(c, "__asm__ volatile (\"lfence\" ::: \"memory\");");
+			return true;
+		case ARCH_TYPE_AARCH64:
+		case ARCH_TYPE_AARCH64_BE:
+		{
+			const char *out = c_temp_name(c);
+			c_emit(c, "%s %s;", c_type_name(c, type_ulong), out);
+			if (fenced)
+			{
+				c_emit(c, "__asm__ volatile (\"isb\\n\\tmrs %%0, cntvct_el0\\n\\tisb\" : \"=r\"(%s) :: \"memory\");", out);
+			}
+			else
+			{
+				c_emit(c, "__asm__ volatile (\"mrs %%0, cntvct_el0\" : \"=r\"(%s));", out);
+			}
+			c_value_set(result, out, type_ulong);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+static void c_emit_syscall(GenContext *c, CValue *result, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	unsigned arguments = vec_size(args);
+	ASSERT(arguments < 8);
+	static const char *x64_regs[] = { "rax", "rdi", "rsi", "rdx", "r10", "r8", "r9" };
+	static const char *aarch64_regs[] = { "x8", "x0", "x1", "x2", "x3", "x4", "x5" };
+	static const char *aarch64_apple_regs[] = { "x16", "x0", "x1", "x2", "x3", "x4", "x5" };
+	const char **regs;
+	const char *instr;
+	const char *clobbers;
+	const char *result_reg;
+	switch (compiler.platform.arch)
+	{
+		case ARCH_TYPE_X86_64:
+			regs = x64_regs;
+			instr = "syscall";
+			clobbers = "\"rcx\", \"r11\", \"memory\"";
+			result_reg = "rax";
+			break;
+		case ARCH_TYPE_AARCH64:
+		case ARCH_TYPE_AARCH64_BE:
+			regs = os_is_apple(compiler.platform.os) ? aarch64_apple_regs : aarch64_regs;
+			instr = "svc #0x80";
+			clobbers = "\"memory\"";
+			result_reg = "x0";
+			break;
+		default:
+			error_exit("The C backend does not support '$$syscall' on this architecture.");
+	}
+	const char *slots[8];
+	c_builtin_args(c, args, slots, arguments);
+	const char *uptr = c_type_name(c, type_uptr);
+	const char *names[8];
+	for (unsigned i = 0; i < arguments; i++)
+	{
+		names[i] = c_temp_name(c);
+		c_emit(c, "register %s %s __asm__(\"%s\") = (%s)%s;", uptr, names[i], regs[i], uptr, slots[i]);
+	}
+	const char *out = c_temp_name(c);
+	bool result_is_arg = str_eq(result_reg, regs[0]);
+	if (!result_is_arg) c_emit(c, "register %s %s __asm__(\"%s\");", uptr, out, result_reg);
+	CBuffer buffer = { 0 };
+	for (unsigned i = result_is_arg ? 1 : 0; i < arguments; i++)
+	{
+		cbuffer_printf(&buffer, "%s\"r\"(%s)", buffer.len ? ", " : "", names[i]);
+	}
+	c_emit(c, "__asm__ volatile (\"%s\" : \"%s\"(%s) : %s : %s);", instr, result_is_arg ? "+r" : "=r",
+	       result_is_arg ? names[0] : out, buffer.data ? buffer.data : "", clobbers);
+	cbuffer_free(&buffer);
+	c_value_set(result, c_temp_with_value(c, type_uptr, result_is_arg ? names[0] : out), type_uptr);
+}
+
+void c_emit_builtin_call(GenContext *c, CValue *result_value, Expr *expr)
+{
+	BuiltinFunction func = exprptr(expr->call_expr.function)->builtin_expr.builtin;
+	Expr **args = expr->call_expr.arguments;
+	switch (func)
+	{
+		case BUILTIN_ANY_MAKE:
+			// Folded in the frontend.
+			UNREACHABLE
+		case BUILTIN_UNREACHABLE:
+			c_emit(c, "__builtin_unreachable();");
+			c_value_set(result_value, "0", type_void);
+			return;
+		case BUILTIN_SWIZZLE:
+			c_emit_swizzle_builtin(c, result_value, expr, false);
+			return;
+		case BUILTIN_SWIZZLE2:
+			c_emit_swizzle_builtin(c, result_value, expr, true);
+			return;
+		case BUILTIN_COMPARE_EXCHANGE:
+			c_emit_compare_exchange(c, result_value, expr);
+			return;
+		case BUILTIN_FRAMEADDRESS:
+			c_value_set(result_value, c_temp_with_value(c, type_voidptr, str_printf("__builtin_frame_address(%s)",
+			                                                                          c_emit_expr_rvalue(c, args[0]))), expr->type);
+			return;
+		case BUILTIN_RETURNADDRESS:
+			c_value_set(result_value, c_temp_with_value(c, type_voidptr, str_printf("__builtin_return_address(%s)",
+			                                                                          c_emit_expr_rvalue(c, args[0]))), expr->type);
+			return;
+		case BUILTIN_SELECT:
+			c_emit_select_builtin(c, result_value, expr);
+			return;
+		case BUILTIN_VECCOMPLT:
+		case BUILTIN_VECCOMPLE:
+		case BUILTIN_VECCOMPNE:
+		case BUILTIN_VECCOMPEQ:
+		case BUILTIN_VECCOMPGT:
+		case BUILTIN_VECCOMPGE:
+			UNREACHABLE
+		case BUILTIN_REVERSE:
+			c_emit_reverse_builtin(c, result_value, expr);
+			return;
+		case BUILTIN_SHUFFLE:
+			c_emit_shuffle_builtin(c, result_value, expr);
+			return;
+		case BUILTIN_VOLATILE_STORE:
+			c_emit_volatile_store(c, result_value, expr);
+			return;
+		case BUILTIN_VOLATILE_LOAD:
+			c_emit_volatile_load(c, result_value, expr);
+			return;
+		case BUILTIN_NONTEMPORAL_STORE:
+			c_emit_nontemporal_store(c, result_value, expr);
+			return;
+		case BUILTIN_NONTEMPORAL_LOAD:
+			c_emit_nontemporal_load(c, result_value, expr);
+			return;
+		case BUILTIN_ATOMIC_STORE:
+			c_emit_atomic_store(c, result_value, expr);
+			return;
+		case BUILTIN_ATOMIC_FETCH_ADD:
+		case BUILTIN_ATOMIC_FETCH_INC_WRAP:
+		case BUILTIN_ATOMIC_FETCH_NAND:
+		case BUILTIN_ATOMIC_FETCH_AND:
+		case BUILTIN_ATOMIC_FETCH_OR:
+		case BUILTIN_ATOMIC_FETCH_XOR:
+		case BUILTIN_ATOMIC_FETCH_MAX:
+		case BUILTIN_ATOMIC_FETCH_MIN:
+		case BUILTIN_ATOMIC_FETCH_SUB:
+		case BUILTIN_ATOMIC_FETCH_DEC_WRAP:
+		case BUILTIN_ATOMIC_FETCH_EXCHANGE:
+			c_emit_atomic_fetch(c, func, result_value, expr);
+			return;
+		case BUILTIN_UNALIGNED_LOAD:
+			c_emit_unaligned_load(c, result_value, expr);
+			return;
+		case BUILTIN_UNALIGNED_STORE:
+			c_emit_unaligned_store(c, result_value, expr);
+			return;
+		case BUILTIN_ATOMIC_LOAD:
+			c_emit_atomic_load(c, result_value, expr);
+			return;
+		case BUILTIN_SYSCALL:
+			c_emit_syscall(c, result_value, expr);
+			return;
+		case BUILTIN_MEMCOPY:
+		case BUILTIN_MEMCOPY_INLINE:
+			c_emit_memory_builtin(c, result_value, expr, "memcpy");
+			return;
+		case BUILTIN_MEMMOVE:
+			c_emit_memory_builtin(c, result_value, expr, "memmove");
+			return;
+		case BUILTIN_MEMSET:
+		case BUILTIN_MEMSET_INLINE:
+			c_emit_memory_builtin(c, result_value, expr, "memset");
+			return;
+		case BUILTIN_SYSCLOCK:
+		case BUILTIN_SYSCLOCK_FENCED:
+			if (!c_emit_sysclock(c, result_value, func == BUILTIN_SYSCLOCK_FENCED)) break;
+			return;
+		case BUILTIN_TRAP:
+			c_emit(c, "__builtin_trap();");
+			c_value_set(result_value, "0", type_void);
+			return;
+		case BUILTIN_BREAKPOINT:
+			switch (compiler.platform.arch)
+			{
+				case ARCH_TYPE_X86:
+				case ARCH_TYPE_X86_64:
+					c_emit(c, "__asm__ volatile (\"int3\");");
+					break;
+				case ARCH_TYPE_AARCH64:
+				case ARCH_TYPE_AARCH64_BE:
+					c_emit(c, "__asm__ volatile (\"brk #0xf000\");");
+					break;
+				default:
+					c_emit(c, "__builtin_trap();");
+					break;
+			}
+			c_value_set(result_value, "0", type_void);
+			return;
+		case BUILTIN_PREFETCH:
+		{
+			const char *slots[3];
+			c_builtin_args(c, args, slots, 3);
+			c_emit(c, "__builtin_prefetch(%s, %s, %s);", slots[0], slots[1], slots[2]);
+			c_value_set(result_value, "0", type_void);
+			return;
+		}
+		case BUILTIN_REDUCE_AND:
+		case BUILTIN_REDUCE_OR:
+		case BUILTIN_REDUCE_MIN:
+		case BUILTIN_REDUCE_MAX:
+		case BUILTIN_REDUCE_XOR:
+		case BUILTIN_REDUCE_ADD:
+		case BUILTIN_REDUCE_MUL:
+		case BUILTIN_REDUCE_FADD:
+		case BUILTIN_REDUCE_FMUL:
+			c_emit_reduce_builtin(c, result_value, expr, func);
+			return;
+		case BUILTIN_EXACT_DIV:
+		case BUILTIN_EXACT_ADD:
+		case BUILTIN_EXACT_MUL:
+		case BUILTIN_EXACT_SUB:
+		case BUILTIN_EXACT_MOD:
+		case BUILTIN_EXACT_NEG:
+			c_emit_wrap_builtin(c, result_value, expr, func);
+			return;
+		case BUILTIN_OVERFLOW_ADD:
+			c_emit_overflow_builtin(c, result_value, expr, "add");
+			return;
+		case BUILTIN_OVERFLOW_SUB:
+			c_emit_overflow_builtin(c, result_value, expr, "sub");
+			return;
+		case BUILTIN_OVERFLOW_MUL:
+			c_emit_overflow_builtin(c, result_value, expr, "mul");
+			return;
+		case BUILTIN_CTTZ:
+		case BUILTIN_CTLZ:
+		case BUILTIN_POPCOUNT:
+			c_emit_bitcount_builtin(c, result_value, expr, func);
+			return;
+		case BUILTIN_BSWAP:
+			c_emit_bswap_builtin(c, result_value, expr);
+			return;
+		case BUILTIN_EXPECT:
+		{
+			const char *slots[2];
+			c_builtin_args(c, args, slots, 2);
+			c_value_set(result_value, c_temp_with_value(c, expr->type, str_printf("__builtin_expect((long)(%s), (long)(%s))",
+			                                                                      slots[0], slots[1])), expr->type);
+			return;
+		}
+		case BUILTIN_EXPECT_WITH_PROBABILITY:
+		{
+			c_emit_expr(c, result_value, args[0]);
+			c_emit_ignored_expr(c, args[1]);
+			return;
+		}
+		case BUILTIN_MAX:
+			c_emit_min_max_builtin(c, result_value, expr, true);
+			return;
+		case BUILTIN_MIN:
+			c_emit_min_max_builtin(c, result_value, expr, false);
+			return;
+		case BUILTIN_ABS:
+			c_emit_abs_builtin(c, result_value, expr);
+			return;
+		case BUILTIN_POW_INT:
+		{
+			const char *slots[2];
+			c_builtin_args(c, args, slots, 2);
+			Type *type = type_lowering(expr->type);
+			Type *element = c_element_type(type);
+			// The exponent is a scalar even for vectors.
+			const char *pow_args[2] = { c_elem(type, slots[0]), str_printf("(int)%s", c_elem(type_lowering(args[1]->type), slots[1])) };
+			c_builtin_result(c, result_value, type, c_float_function(c, element, "powi", pow_args, 2));
+			return;
+		}
+		case BUILTIN_CEIL:
+			c_emit_float_builtin(c, result_value, expr, "ceil");
+			return;
+		case BUILTIN_COS:
+			c_emit_float_builtin(c, result_value, expr, "cos");
+			return;
+		case BUILTIN_COPYSIGN:
+			c_emit_float_builtin(c, result_value, expr, "copysign");
+			return;
+		case BUILTIN_FLOOR:
+			c_emit_float_builtin(c, result_value, expr, "floor");
+			return;
+		case BUILTIN_EXP:
+			c_emit_float_builtin(c, result_value, expr, "exp");
+			return;
+		case BUILTIN_EXP2:
+			c_emit_float_builtin(c, result_value, expr, "exp2");
+			return;
+		case BUILTIN_FMA:
+		case BUILTIN_FMULADD:
+			c_emit_float_builtin(c, result_value, expr, "fma");
+			return;
+		case BUILTIN_LOG:
+			c_emit_float_builtin(c, result_value, expr, "log");
+			return;
+		case BUILTIN_LOG2:
+			c_emit_float_builtin(c, result_value, expr, "log2");
+			return;
+		case BUILTIN_LOG10:
+			c_emit_float_builtin(c, result_value, expr, "log10");
+			return;
+		case BUILTIN_POW:
+			c_emit_float_builtin(c, result_value, expr, "pow");
+			return;
+		case BUILTIN_NEARBYINT:
+			c_emit_float_builtin(c, result_value, expr, "nearbyint");
+			return;
+		case BUILTIN_RINT:
+			c_emit_float_builtin(c, result_value, expr, "rint");
+			return;
+		case BUILTIN_ROUND:
+			c_emit_float_builtin(c, result_value, expr, "round");
+			return;
+		case BUILTIN_ROUNDEVEN:
+			c_emit_float_builtin(c, result_value, expr, "roundeven");
+			return;
+		case BUILTIN_SIN:
+			c_emit_float_builtin(c, result_value, expr, "sin");
+			return;
+		case BUILTIN_SQRT:
+			c_emit_float_builtin(c, result_value, expr, "sqrt");
+			return;
+		case BUILTIN_TRUNC:
+			c_emit_float_builtin(c, result_value, expr, "trunc");
+			return;
+		case BUILTIN_LRINT:
+		case BUILTIN_LROUND:
+		case BUILTIN_LLRINT:
+		case BUILTIN_LLROUND:
+		{
+			const char *arg = c_emit_expr_rvalue(c, args[0]);
+			Type *arg_type = type_lowering(args[0]->type);
+			const char *name = func == BUILTIN_LRINT ? "lrint" : func == BUILTIN_LROUND ? "lround"
+			                 : func == BUILTIN_LLRINT ? "llrint" : "llround";
+			c_value_set(result_value, c_temp_with_value(c, expr->type, c_float_function(c, arg_type, name, &arg, 1)), expr->type);
+			return;
+		}
+		case BUILTIN_WASM_MEMORY_GROW:
+			// -1 on non-wasm
+			if (!arch_is_wasm(compiler.platform.arch))
+			{
+				c_value_set(result_value, c_const_int(expr->type, (uint64_t)-1), expr->type);
+				return;
+			}
+			c_value_set(result_value, c_temp_with_value(c, expr->type, str_printf("__builtin_wasm_memory_grow(0, %s)",
+			                                                                      c_emit_expr_rvalue(c, args[0]))), expr->type);
+			return;
+		case BUILTIN_WASM_MEMORY_SIZE:
+			// 0 (no mem) on non-wasm.
+			if (!arch_is_wasm(compiler.platform.arch))
+			{
+				c_value_set(result_value, c_const_int(expr->type, 0), expr->type);
+				return;
+			}
+			c_value_set(result_value, c_temp_with_value(c, expr->type, "__builtin_wasm_memory_size(0)"), expr->type);
+			return;
+		case BUILTIN_MATRIX_MUL:
+		case BUILTIN_MATRIX_TRANSPOSE:
+		case BUILTIN_GET_ROUNDING_MODE:
+		case BUILTIN_SET_ROUNDING_MODE:
+			break;
+		case BUILTIN_MASKED_LOAD:
+		case BUILTIN_GATHER:
+			c_emit_masked_load_builtin(c, result_value, expr, func == BUILTIN_GATHER);
+			return;
+		case BUILTIN_MASKED_STORE:
+		case BUILTIN_SCATTER:
+			c_emit_masked_store_builtin(c, result_value, expr, func == BUILTIN_SCATTER);
+			return;
+		case BUILTIN_SAT_SHL:
+		case BUILTIN_SAT_ADD:
+		case BUILTIN_SAT_SUB:
+		case BUILTIN_SAT_MUL:
+			c_emit_saturating_builtin(c, result_value, expr, func);
+			return;
+		case BUILTIN_BITREVERSE:
+			c_emit_bitreverse_builtin(c, result_value, expr);
+			return;
+		case BUILTIN_FSHL:
+		case BUILTIN_FSHR:
+			c_emit_funnel_shift_builtin(c, result_value, expr, func == BUILTIN_FSHL);
+			return;
+		case BUILTIN_STR_HASH:
+		case BUILTIN_STR_LOWER:
+		case BUILTIN_STR_UPPER:
+		case BUILTIN_STR_FIND:
+		case BUILTIN_WIDESTRING_16:
+		case BUILTIN_WIDESTRING_32:
+		case BUILTIN_RND:
+		case BUILTIN_SPRINTF:
+		case BUILTIN_NONE:
+			UNREACHABLE
+	}
+	c_builtin_unsupported(func);
+}
@@ -0,0 +1,3856 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
+#include "c_codegen_internal.h"
+#include <math.h>
+
+static void c_emit_initialize_reference(GenContext *c, CValue *ref, Expr *expr);
+static void c_emit_const_initialize_reference(GenContext *c, CValue *ref, Expr *expr);
+static void c_emit_initialize_bitstruct_member(GenContext *c, CValue *ref, Decl *bitstruct, Decl *member, Expr *expr);
+static void c_emit_finish_bitstruct_init(GenContext *c, CValue *ref, Decl *bitstruct);
+static void c_emit_binary(GenContext *c, CValue *value, Expr *expr, CValue *lhs_loaded, BinaryOp binary_op);
+static void c_emit_call_expr(GenContext *c, CValue *result, Expr *expr);
+static void c_emit_const_expr(GenContext *c, CValue *value, Expr *expr);
+static void c_emit_return_block(GenContext *c, CValue *value, Type *type, AstId current, BlockExit **block_exit);
+
+const char *c_emit_expr_rvalue(GenContext *c, Expr *expr)
+{
+	CValue value;
+	c_emit_expr(c, &value, expr);
+	c_value_rvalue(c, &value);
+	return value.value;
+}
+
+void c_emit_exprid(GenContext *c, CValue *value, ExprId expr)
+{
+	ASSERT(expr);
+	c_emit_expr(c, value, exprptr(expr));
+}
+
+static inline const char *c_cast(GenContext *c, Type *type, const char *value)
+{
+	return str_printf("((%s)(%s))", c_type_name(c, type), value);
+}
+
+static Expr *c_expr_remove_recast(Expr *expr)
+{
+	Type *main_type = type_lowering(expr->type);
+	while (expr->expr_kind == EXPR_RECAST && main_type == type_lowering(expr->inner_expr->type))
+	{
+		expr = expr->inner_expr;
+	}
+	return expr;
+}
+
+static const char *c_element_addr(const char *addr, const char *index, Type *element_type)
+{
+	return str_printf("((void *)((char *)%s + (ptrdiff_t)(%s) * %llu))", addr, index,
+	                  (unsigned long long)type_size(element_type));
+}
+
+static void c_value_element_addr(CValue *result, CValue *parent, ArrayIndex index, Type *element_type)
+{
+	ArraySize offset = (ArraySize)index * type_size(element_type);
+	c_value_set_address(result, c_offset_addr(parent->value, offset), element_type,
+	                    type_min_alignment(offset, parent->alignment));
+}
+
+static void c_value_member_addr(CValue *result, CValue *parent, Decl *member)
+{
+	c_value_set_address(result, c_offset_addr(parent->value, member->offset), member->type,
+	                    type_min_alignment(member->offset, parent->alignment));
+}
+
+static bool c_bitstruct_requires_bitswap(Decl *decl)
+{
+	ASSERT(decl->decl_kind == DECL_BITSTRUCT);
+	bool big_endian = compiler.platform.big_endian;
+	if (decl->strukt.big_endian) return !big_endian;
+	if (decl->strukt.little_endian) return big_endian;
+	return false;
+}
+
+static const char *c_bswap(GenContext *c, Type *type, const char *value)
+{
+	const char *name = c_type_name(c, type);
+	switch (type_size(type))
+	{
+		case 1:
+			return value;
+		case 2:
+			return str_printf("((%s)__builtin_bswap16((uint16_t)(%s)))", name, value);
+		case 4:
+			return str_printf("((%s)__builtin_bswap32((uint32_t)(%s)))", name, value);
+		case 8:
+			return str_printf("((%s)__builtin_bswap64((uint64_t)(%s)))", name, value);
+		case 16:
+			return str_printf("((%s)__c3_bswap128((unsigned __int128)(%s)))", name, value);
+		default:
+			UNREACHABLE
+	}
+}
+
+/**
+ * Assign a value to a reference, writing the fault to the optional if it isn't NULL.
+ */
+CValue c_emit_assign_expr(GenContext *c, CValue *ref, Expr *expr, const char *optional, bool is_init)
+{
+	ASSERT(c_value_is_addr(ref));
+	assert((optional || !IS_OPTIONAL(expr)) && "Assumed an optional address if it's an optional expression.");
+
+	expr = c_expr_remove_recast(expr);
+
+	if (expr->expr_kind == EXPR_OPTIONAL)
+	{
+		PUSH_CLEAR_CATCH();
+		CValue result;
+		const char *fault = c_emit_expr_rvalue(c, expr->inner_expr);
+		c_emit(c, "%s = %s;", optional, fault);
+		POP_CATCH();
+		if (c->catch.block) c_emit_jump_to_optional_exit(c, fault);
+		c_value_set(&result, "0", type_void);
+		return result;
+	}
+
+	PUSH_CATCH();
+
+	int assign_block = 0;
+	int rejump_block = 0;
+	if (IS_OPTIONAL(expr))
+	{
+		assign_block = c_new_label(c);
+		ASSERT(optional);
+		c->catch.block = c->catch.fault ? (rejump_block = c_new_label(c)) : assign_block;
+		c->catch.fault = str_printf("((void *)&%s)", optional);
+	}
+	else
+	{
+		c->catch = (OptionalCatch) { NULL, 0 };
+	}
+
+	CValue value;
+	if (type_flat_is_vector(expr->type))
+	{
+		c_emit_expr(c, &value, expr);
+		c_store(c, ref, &value);
+	}
+	else if (expr_is_const_initializer(expr))
+	{
+		c_emit_const_initialize_reference(c, ref, expr);
+		value = *ref;
+	}
+	else if (expr_is_init_list(expr))
+	{
+		if (is_init)
+		{
+			c_emit_initialize_reference(c, ref, expr);
+		}
+		else
+		{
+			CValue temp;
+			c_value_set_address(&temp, c_temp_alloca(c, ref->type), ref->type, type_abi_alignment(ref->type));
+			c_emit_initialize_reference(c, &temp, expr);
+			c_store(c, ref, &temp);
+		}
+		value = *ref;
+	}
+	else
+	{
+		c_emit_expr(c, &value, expr);
+		if (value.type != type_void) c_store(c, ref, &value);
+	}
+
+	if (optional) c_emit(c, "%s = 0;", optional);
+	POP_CATCH();
+
+	if (assign_block)
+	{
+		c_emit_goto(c, assign_block);
+		if (rejump_block)
+		{
+			c_emit_label(c, rejump_block);
+			c_emit(c, "*(%s *)%s = %s;", c_type_name(c, type_fault), c->catch.fault, optional);
+			c_emit_goto(c, c->catch.block);
+		}
+		c_emit_label(c, assign_block);
+	}
+	return value;
+}
+
+void c_emit_ignored_expr(GenContext *c, Expr *expr)
+{
+	CValue value;
+	if (IS_OPTIONAL(expr))
+	{
+		int discard_fail = c_new_label(c);
+		PUSH_CATCH_VAR_BLOCK(NULL, discard_fail);
+		c_emit_expr(c, &value, expr);
+		c_value_fold_optional(c, &value);
+		c_emit_label(c, discard_fail);
+		POP_CATCH();
+		return;
+	}
+	c_emit_expr(c, &value, expr);
+}
+
+// -- Subscripts
+
+static void c_emit_array_bounds_check(GenContext *c, CValue *index, const char *len, SourceSpan loc)
+{
+	c_value_rvalue(c, index);
+	if (type_is_signed(index->type))
+	{
+		c_emit_panic_if_true(c, str_printf("%s < 0", index->value), "Negative array indexing", loc,
+		                     "Negative array indexing (index was %d)", index, NULL);
+	}
+	CValue max;
+	c_value_set(&max, c_cast(c, index->type, len), index->type);
+	c_emit_panic_if_true(c, str_printf("(%s)%s >= (%s)%s", c_type_name(c, type_u128), index->value,
+	                                   c_type_name(c, type_u128), max.value),
+	                     "Array index out of bounds", loc,
+	                     "Array index out of bounds (array had size %d, index was %d)", &max, index);
+}
+
+static void c_emit_slice_len(GenContext *c, CValue *slice, CValue *len)
+{
+	if (c_value_is_addr(slice))
+	{
+		c_value_fold_optional(c, slice);
+		c_value_set_address(len, c_offset_addr(slice->value, type_size(type_voidptr)), type_usz,
+		                    type_min_alignment(type_size(type_voidptr), slice->alignment));
+		return;
+	}
+	c_value_set(len, str_printf("(%s).len", slice->value), type_usz);
+}
+
+static const char *c_emit_slice_ptr(GenContext *c, CValue *slice)
+{
+	if (c_value_is_addr(slice))
+	{
+		c_value_fold_optional(c, slice);
+		return c_load_raw(c, slice->value, type_voidptr, slice->alignment);
+	}
+	return str_printf("(%s).ptr", slice->value);
+}
+
+/**
+ * Turn a slice or pointer into the address of its elements, arrays are already addresses.
+ */
+static void c_emit_ptr_from_array(GenContext *c, CValue *value)
+{
+	switch (value->type->type_kind)
+	{
+		case TYPE_POINTER:
+			c_value_rvalue(c, value);
+			c_value_set_address_abi_aligned(value, value->value, value->type);
+			return;
+		case TYPE_ARRAY:
+		case TYPE_VECTOR:
+		case TYPE_FLEXIBLE_ARRAY:
+			return;
+		case TYPE_SLICE:
+		{
+			Type *type = value->type;
+			const char *ptr = c_emit_slice_ptr(c, value);
+			c_value_set_address_abi_aligned(value, ptr, type);
+			return;
+		}
+		default:
+			UNREACHABLE
+	}
+}
+
+static void c_emit_subscript_addr_with_base(GenContext *c, CValue *result, CValue *parent, CValue *index)
+{
+	ASSERT(c_value_is_addr(parent));
+	Type *type = type_lowering(parent->type);
+	Type *element;
+	switch (type->type_kind)
+	{
+		case TYPE_POINTER:
+			element = type->pointer;
+			break;
+		case TYPE_ARRAY:
+		case TYPE_FLEXIBLE_ARRAY:
+		case TYPE_VECTOR:
+		case TYPE_SLICE:
+			element = type->array.base;
+			break;
+		default:
+			UNREACHABLE
+	}
+	AlignSize alignment = type_abi_alignment(element);
+	if (type->type_kind != TYPE_POINTER && type->type_kind != TYPE_SLICE)
+	{
+		alignment = type_min_alignment(type_size(element), parent->alignment);
+	}
+	c_value_set_address(result, c_element_addr(parent->value, index->value, element), element, alignment);
+}
+
+static void c_emit_vector_subscript(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_exprid(c, value, expr->subscript_expr.expr);
+	Type *vec = value->type;
+	ASSERT(vec->type_kind == TYPE_VECTOR);
+	const char *vector = c_rvalue(c, value);
+	c_emit_exprid(c, value, expr->subscript_expr.index.expr);
+	const char *index = c_rvalue(c, value);
+	if (expr->subscript_expr.index.start_from_end)
+	{
+		index = str_printf("(%llu - (%s))", (unsigned long long)vec->array.len, index);
+	}
+	c_value_set(value, c_temp_with_value(c, vec->array.base, str_printf("%s.a[%s]", vector, index)), vec->array.base);
+}
+
+static void c_emit_subscript_addr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *parent_expr = exprptr(expr->subscript_expr.expr);
+	Expr *index_expr = exprptr(expr->subscript_expr.index.expr);
+	Type *parent_type = type_lowering(parent_expr->type);
+	c_emit_expr(c, value, parent_expr);
+	const char *len = NULL;
+	TypeKind parent_type_kind = parent_type->type_kind;
+	bool needs_len = false;
+	bool start_from_end = expr->subscript_expr.index.start_from_end;
+	bool check_bounds = safe_mode_enabled_in(c->cur_func) && !expr_subscript_in_range(expr);
+	if (parent_type_kind == TYPE_SLICE)
+	{
+		needs_len = check_bounds || start_from_end;
+		if (needs_len)
+		{
+			CValue len_value;
+			c_emit_slice_len(c, value, &len_value);
+			len = c_rvalue(c, &len_value);
+		}
+	}
+	else if (parent_type_kind == TYPE_ARRAY || parent_type_kind == TYPE_VECTOR)
+	{
+		ASSERT(!expr_is_const(expr) || !start_from_end);
+		needs_len = (check_bounds && !expr_is_const(expr)) || start_from_end;
+		if (needs_len) len = str_printf("%lluULL", (unsigned long long)value->type->array.len);
+	}
+	c_emit_ptr_from_array(c, value);
+	c_value_addr(c, value);
+	CValue index;
+	c_emit_expr(c, &index, index_expr);
+	c_value_rvalue(c, &index);
+	if (start_from_end)
+	{
+		ASSERT(needs_len);
+		index.value = c_temp_with_value(c, index.type, c_cast(c, index.type, str_printf("%s - %s", len, index.value)));
+	}
+	if (needs_len && check_bounds && c->cur_func)
+	{
+		c_emit_array_bounds_check(c, &index, len, index_expr->span);
+	}
+	c_emit_subscript_addr_with_base(c, value, value, &index);
+	c_value_fold_optional(c, value);
+}
+
+static void c_emit_subscript(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *parent_expr = exprptr(expr->subscript_expr.expr);
+	if (type_lowering(parent_expr->type)->type_kind == TYPE_VECTOR)
+	{
+		c_emit_vector_subscript(c, value, expr);
+		return;
+	}
+	c_emit_subscript_addr(c, value, expr);
+}
+
+static void c_emit_pointer_offset(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *pointer = exprptr(expr->pointer_offset_expr.ptr);
+	Expr *offset_expr = exprptr(expr->pointer_offset_expr.offset);
+	c_emit_expr(c, value, pointer);
+	c_value_rvalue(c, value);
+	CValue offset;
+	c_emit_expr(c, &offset, offset_expr);
+	c_value_rvalue(c, &offset);
+	Type *type = type_lowering(pointer->type);
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		Type *element = type_lowering(type->array.base);
+		TypeSize size = expr->pointer_offset_expr.raw_offset ? 1 : type_size(element->pointer);
+		bool vec_offset = type_lowering(offset.type)->type_kind == TYPE_VECTOR;
+		const char *result = c_temp_name(c);
+		c_emit(c, "%s %s;", c_type_name(c, type), result);
+		c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) %s.a[__i] = (char *)%s.a[__i] + (ptrdiff_t)%s%s * %llu;",
+		       (unsigned long long)type->array.len, result, value->value, offset.value, vec_offset ? ".a[__i]" : "",
+		       (unsigned long long)size);
+		c_value_set(value, result, type);
+		return;
+	}
+	TypeSize size = expr->pointer_offset_expr.raw_offset ? 1 : type_size(type->pointer);
+	c_value_set(value, c_temp_with_value(c, type, str_printf("(char *)%s + (ptrdiff_t)%s * %llu", value->value,
+	                                                              offset.value, (unsigned long long)size)), type);
+}
+
+// -- Member access
+
+static ArrayIndex find_member_index(Decl *parent, Decl *member)
+{
+	FOREACH_IDX(i, Decl *, maybe_member, parent->strukt.members)
+	{
+		if (member == maybe_member) return (int)i;
+		if (!maybe_member->name)
+		{
+			if (find_member_index(maybe_member, member) != -1) return (int)i;
+		}
+	}
+	return -1;
+}
+
+static void c_emit_member_addr(GenContext *c, CValue *value, Decl *parent, Decl *member)
+{
+	ASSERT(member->resolve_status == RESOLVE_DONE);
+	Decl *found = NULL;
+	do
+	{
+		ArrayIndex index = find_member_index(parent, member);
+		ASSERT(index > -1);
+		found = parent->strukt.members[index];
+		ASSERT(parent->type->canonical->type_kind == TYPE_STRUCT || parent->type->canonical->type_kind == TYPE_UNION);
+		c_value_addr(c, value);
+		c_value_member_addr(value, value, found);
+		parent = found;
+	} while (found != member);
+}
+
+static Decl *c_emit_bitstruct_member(GenContext *c, CValue *value, Decl *parent, Decl *member)
+{
+	ASSERT(member->resolve_status == RESOLVE_DONE);
+	Decl *found = parent;
+	Decl *last = NULL;
+	do
+	{
+		ArrayIndex index = find_member_index(parent, member);
+		ASSERT(index > -1);
+		last = found;
+		found = parent->strukt.members[index];
+		switch (parent->type->canonical->type_kind)
+		{
+			case TYPE_UNION:
+			case TYPE_STRUCT:
+				c_value_addr(c, value);
+				c_value_member_addr(value, value, found);
+				break;
+			case TYPE_BITSTRUCT:
+				break;
+			default:
+				UNREACHABLE
+		}
+		parent = found;
+	} while (found != member);
+	return last ? last : parent;
+}
+
+/**
+ * Byte swap the low bits of a value so that they end up as the low bits.
+ */
+static const char *c_bswap_non_integral(GenContext *c, Type *type, const char *value, unsigned bitsize)
+{
+	if (bitsize <= 8) return value;
+	ASSERT(is_power_of_two(bitsize));
+	Type *unsigned_type = type_int_unsigned_by_bitsize(type_bit_size(type));
+	const char *shifted = str_printf("((%s)(%s) << %u)", c_type_name(c, unsigned_type), value,
+	                                 (unsigned)(type_bit_size(type) - bitsize));
+	return c_cast(c, type, c_bswap(c, unsigned_type, shifted));
+}
+
+static void c_extract_bitvalue_from_array(GenContext *c, CValue *value, Decl *member, Decl *parent_decl)
+{
+	c_value_addr(c, value);
+	Type *member_type = type_lowering(member->type);
+	unsigned start = member->var.start_bit;
+	unsigned end = member->var.end_bit;
+	if (member_type == type_bool)
+	{
+		c_value_set(value, c_temp_with_value(c, type_bool, str_printf("(((const unsigned char *)%s)[%u] >> %u) & 1",
+		                                                               value->value, start / 8, start % 8)), type_bool);
+		return;
+	}
+	const char *res = c_cast(c, member_type, str_printf("__c3_bits_get(%s, %u, %u)", value->value, start, end));
+	if (c_bitstruct_requires_bitswap(parent_decl)) res = c_bswap_non_integral(c, member_type, res, end - start + 1);
+	TypeSize bitsize = type_bit_size(member_type);
+	if (type_is_signed(member_type))
+	{
+		TypeSize top_bits_to_clear = bitsize - end + start - 1;
+		if (top_bits_to_clear)
+		{
+			Type *unsigned_type = type_int_unsigned_by_bitsize(bitsize);
+			res = str_printf("((%s)((%s)%s << %u) >> %u)", c_type_name(c, member_type), c_type_name(c, unsigned_type),
+			                 res, (unsigned)top_bits_to_clear, (unsigned)top_bits_to_clear);
+		}
+	}
+	c_value_set(value, c_temp_with_value(c, member_type, res), member_type);
+}
+
+static void c_extract_bitvalue(GenContext *c, CValue *value, Decl *parent_decl, Decl *member)
+{
+	if (value->type->type_kind == TYPE_ARRAY)
+	{
+		c_extract_bitvalue_from_array(c, value, member, parent_decl);
+		return;
+	}
+	Type *container = value->type;
+	const char *current = c_rvalue(c, value);
+	if (c_bitstruct_requires_bitswap(parent_decl)) current = c_bswap(c, container, current);
+	BitSize container_bit_size = type_bit_size(container);
+	unsigned start = member->var.start_bit;
+	unsigned end = member->var.end_bit;
+	Type *member_type = type_lowering(member->type);
+	Type *unsigned_type = type_int_unsigned_by_bitsize(container_bit_size);
+	const char *result;
+	if (type_is_signed(member_type))
+	{
+		// Shift all the way left, so the top bit is at the top, then shift it back down.
+		unsigned left_shift = (unsigned)(container_bit_size - end - 1);
+		Type *signed_type = type_int_signed_by_bitsize(container_bit_size);
+		result = str_printf("(%s)((%s)((%s)%s << %u) >> %u)", c_type_name(c, member_type),
+		                    c_type_name(c, signed_type), c_type_name(c, unsigned_type), current, left_shift,
+		                    left_shift + start);
+	}
+	else
+	{
+		unsigned bits_needed = end - start + 1;
+		const char *mask = bits_needed >= container_bit_size
+				? str_printf("~(%s)0", c_type_name(c, unsigned_type))
+				: str_printf("(((%s)1 << %u) - 1)", c_type_name(c, unsigned_type), bits_needed);
+		result = str_printf("(%s)(((%s)%s >> %u) & %s)", c_type_name(c, member_type), c_type_name(c, unsigned_type),
+		                    current, start, mask);
+	}
+	c_value_set(value, c_temp_with_value(c, member_type, result), member_type);
+}
+
+static void c_emit_update_bitstruct_array(GenContext *c, const char *array_ptr, bool need_bitswap, Decl *member, CValue *value)
+{
+	unsigned start_bit = member->var.start_bit;
+	unsigned end_bit = member->var.end_bit;
+	const char *val = c_rvalue(c, value);
+	Type *member_type = type_lowering(member->type);
+	if (need_bitswap && member_type != type_bool)
+	{
+		val = c_bswap_non_integral(c, member_type, val, end_bit - start_bit + 1);
+	}
+	c_emit(c, "__c3_bits_set(%s, %u, %u, (unsigned __int128)(%s));", array_ptr, start_bit, end_bit, val);
+}
+
+/**
+ * Return the container value with the member bits replaced: (current & ~mask) | ((value << start) & mask)
+ */
+static const char *c_bitstruct_value_update(GenContext *c, const char *current, Type *container, Decl *member, const char *value)
+{
+	BitSize bits = type_bit_size(container);
+	unsigned start_bit = member->var.start_bit;
+	unsigned end_bit = member->var.end_bit;
+	const char *unsigned_type = c_type_name(c, type_int_unsigned_by_bitsize(bits));
+	unsigned bits_needed = end_bit - start_bit + 1;
+	// Build the mask in the container type, narrow containers would otherwise be promoted to int.
+	const char *mask = bits_needed >= bits
+			? str_printf("((%s)~(%s)0)", unsigned_type, unsigned_type)
+			: str_printf("((%s)((((%s)1 << %u) - 1) << %u))", unsigned_type, unsigned_type, bits_needed, start_bit);
+	return str_printf("(%s)(((%s)%s & ~%s) | (((%s)%s << %u) & %s))", c_type_name(c, container), unsigned_type, current,
+	                  mask, unsigned_type, value, start_bit, mask);
+}
+
+static void c_emit_bitassign_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *lhs = exprptr(expr->binary_expr.left);
+	Expr *parent_expr = lhs->access_resolved_expr.parent;
+	CValue parent;
+	Decl *member = lhs->access_resolved_expr.ref;
+	c_emit_expr(c, &parent, parent_expr);
+	Decl *parent_decl = c_emit_bitstruct_member(c, &parent, type_flatten(parent_expr->type)->decl, member);
+	c_value_addr(c, &parent);
+
+	if (expr->binary_expr.operator != BINARYOP_ASSIGN)
+	{
+		CValue current = parent;
+		c_extract_bitvalue(c, &current, parent_decl, member);
+		c_emit_binary(c, value, expr, &current, binaryop_assign_base_op(expr->binary_expr.operator));
+	}
+	else
+	{
+		c_emit_expr(c, value, exprptr(expr->binary_expr.right));
+	}
+	c_value_rvalue(c, value);
+
+	Type *parent_type = type_flatten(parent_expr->type);
+	if (type_lowering(parent_type)->type_kind == TYPE_ARRAY)
+	{
+		c_emit_update_bitstruct_array(c, parent.value, c_bitstruct_requires_bitswap(parent_type->decl), member, value);
+		return;
+	}
+	CValue current = parent;
+	const char *current_value = c_rvalue(c, &current);
+	bool bswap = c_bitstruct_requires_bitswap(parent_decl);
+	if (bswap) current_value = c_bswap(c, parent.type, current_value);
+	current_value = c_bitstruct_value_update(c, current_value, parent.type, member, value->value);
+	if (bswap) current_value = c_bswap(c, parent.type, current_value);
+	c_store_raw(c, parent.value, parent.type, parent.alignment, current_value);
+}
+
+static void c_emit_bitaccess(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *parent = expr->access_resolved_expr.parent;
+	c_emit_expr(c, value, parent);
+	Decl *member = expr->access_resolved_expr.ref;
+	Decl *parent_decl = c_emit_bitstruct_member(c, value, type_flatten(parent->type)->decl, member);
+	c_extract_bitvalue(c, value, parent_decl, member);
+}
+
+static void c_emit_access_addr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *parent = expr->access_resolved_expr.parent;
+	Type *flat_type = type_flatten(parent->type);
+	Decl *member = expr->access_resolved_expr.ref;
+	if (flat_type->type_kind == TYPE_ENUM)
+	{
+		c_emit_expr(c, value, parent);
+		c_value_rvalue(c, value);
+		const char *array = c_enum_associated_name(c, flat_type->decl, member);
+		c_value_set_address_abi_aligned(value, c_element_addr(str_printf("((void *)&%s)", array), value->value, member->type),
+		                                member->type);
+		return;
+	}
+	if (expr_is_deref(parent))
+	{
+		c_emit_expr(c, value, parent->unary_expr.expr);
+		c_value_rvalue(c, value);
+		c_value_set_address_abi_aligned(value, value->value, parent->type);
+	}
+	else
+	{
+		c_emit_expr(c, value, parent);
+	}
+	c_emit_member_addr(c, value, type_lowering(parent->type)->decl, member);
+}
+
+// -- Initialization
+
+/**
+ * Copy the initializer from a constant global, returns false if it can't be expressed as a C constant.
+ */
+static bool c_emit_initialize_reference_temporary_const(GenContext *c, CValue *ref, ConstInitializer *initializer)
+{
+	const char *init = c_emit_const_initializer(c, initializer);
+	if (!init) return false;
+	const char *global = c_emit_const_global(c, initializer->type, init);
+	c_value_addr(c, ref);
+	c_emit(c, "__builtin_memcpy(%s, &%s, %llu);", ref->value, global, (unsigned long long)type_size(initializer->type));
+	return true;
+}
+
+static void c_emit_const_init_ref(GenContext *c, CValue *ref, ConstInitializer *const_init, bool top)
+{
+	if (const_init->kind == CONST_INIT_ZERO)
+	{
+		c_store_zero(c, ref);
+		return;
+	}
+	if (const_init->type->type_kind == TYPE_BITSTRUCT)
+	{
+		if (c_emit_initialize_reference_temporary_const(c, ref, const_init)) return;
+		Decl *decl = const_init->type->decl;
+		c_value_addr(c, ref);
+		c_store_zero(c, ref);
+		FOREACH_IDX(i, ConstInitializer *, init, const_init->init_struct)
+		{
+			if (init->kind == CONST_INIT_ZERO) continue;
+			c_emit_initialize_bitstruct_member(c, ref, decl, decl->strukt.members[i], init->init_value);
+		}
+		c_emit_finish_bitstruct_init(c, ref, decl);
+		return;
+	}
+	if (const_init->type->type_kind == TYPE_VECTOR || const_init->kind == CONST_INIT_ARRAY_FULL
+		|| const_init->kind == CONST_INIT_ARRAY_BYTES || type_size(const_init->type) <= 32)
+	{
+		if ((top || const_init->type->type_kind == TYPE_VECTOR) && const_init_local_init_may_be_global(const_init)
+		    && c_emit_initialize_reference_temporary_const(c, ref, const_init)) return;
+	}
+	c_value_addr(c, ref);
+	switch (const_init->kind)
+	{
+		case CONST_INIT_ZERO:
+		case CONST_INIT_ARRAY_VALUE:
+			UNREACHABLE
+		case CONST_INIT_ARRAY_FULL:
+		{
+			Type *element_type = const_init->type->array.base;
+			ArrayIndex size = (ArrayIndex)const_init->type->array.len;
+			for (ArrayIndex i = 0; i < size; i++)
+			{
+				CValue value;
+				c_value_element_addr(&value, ref, i, element_type);
+				c_emit_const_init_ref(c, &value, const_init->init_array_full[i], false);
+			}
+			return;
+		}
+		case CONST_INIT_ARRAY_BYTES:
+		{
+			Type *element_type = const_init->type->array.base;
+			ArrayIndex size = (ArrayIndex)const_init->type->array.len;
+			Expr element = { .expr_kind = EXPR_CONST };
+			ConstInitializer element_init = { .kind = CONST_INIT_VALUE, .type = type_flatten(element_type), .init_value = &element };
+			for (ArrayIndex i = 0; i < size; i++)
+			{
+				CValue value;
+				const_init_bytes_rewrite_expr_at(const_init, i, &element);
+				c_value_element_addr(&value, ref, i, element_type);
+				c_emit_const_init_ref(c, &value, &element_init, false);
+			}
+			return;
+		}
+		case CONST_INIT_ARRAY:
+		{
+			c_store_zero(c, ref);
+			Type *element_type = const_init->type->array.base;
+			FOREACH(ConstInitializer *, element, const_init->init_array.elements)
+			{
+				ASSERT(element->kind == CONST_INIT_ARRAY_VALUE);
+				CValue value;
+				c_value_element_addr(&value, ref, element->init_array_value.index, element_type);
+				c_emit_const_init_ref(c, &value, element->init_array_value.element, false);
+			}
+			return;
+		}
+		case CONST_INIT_UNION:
+		{
+			Decl *member = const_init->type->decl->strukt.members[const_init->init_union.index];
+			CValue value;
+			c_value_member_addr(&value, ref, member);
+			c_emit_const_init_ref(c, &value, const_init->init_union.element, false);
+			return;
+		}
+		case CONST_INIT_STRUCT:
+		{
+			Decl *decl = const_init->type->decl;
+			ASSERT(vec_size(decl->strukt.members) == vec_size(const_init->init_struct));
+			FOREACH_IDX(i, ConstInitializer *, init, const_init->init_struct)
+			{
+				CValue value;
+				c_value_member_addr(&value, ref, decl->strukt.members[i]);
+				c_emit_const_init_ref(c, &value, init, false);
+			}
+			return;
+		}
+		case CONST_INIT_VALUE:
+		{
+			CValue value;
+			c_emit_expr(c, &value, const_init->init_value);
+			c_store(c, ref, &value);
+			return;
+		}
+	}
+	UNREACHABLE
+}
+
+static void c_emit_const_initialize_reference(GenContext *c, CValue *ref, Expr *expr)
+{
+	ASSERT(expr_is_const_initializer(expr));
+	c_emit_const_init_ref(c, ref, expr->const_expr.initializer, true);
+}
+
+static void c_emit_initialize_element(GenContext *c, CValue *ref, Expr *expr)
+{
+	if (expr_is_const_initializer(expr))
+	{
+		c_emit_const_initialize_reference(c, ref, expr);
+		return;
+	}
+	if (expr_is_init_list(expr))
+	{
+		c_emit_initialize_reference(c, ref, expr);
+		return;
+	}
+	CValue value;
+	c_emit_expr(c, &value, expr);
+	c_store(c, ref, &value);
+}
+
+static void c_emit_initialize_bitstruct_member(GenContext *c, CValue *ref, Decl *bitstruct, Decl *member, Expr *expr)
+{
+	CValue value;
+	c_emit_expr(c, &value, expr);
+	c_value_rvalue(c, &value);
+	if (ref->type->type_kind == TYPE_ARRAY)
+	{
+		c_emit_update_bitstruct_array(c, ref->value, c_bitstruct_requires_bitswap(bitstruct), member, &value);
+		return;
+	}
+	// Integer containers are kept in host order until all members are written.
+	CValue current = *ref;
+	const char *current_value = c_rvalue(c, &current);
+	c_store_raw(c, ref->value, ref->type, ref->alignment, c_bitstruct_value_update(c, current_value, ref->type, member, value.value));
+}
+
+static void c_emit_finish_bitstruct_init(GenContext *c, CValue *ref, Decl *bitstruct)
+{
+	if (ref->type->type_kind == TYPE_ARRAY || !c_bitstruct_requires_bitswap(bitstruct)) return;
+	CValue current = *ref;
+	const char *current_value = c_rvalue(c, &current);
+	c_store_raw(c, ref->value, ref->type, ref->alignment, c_bswap(c, ref->type, current_value));
+}
+
+static void c_emit_initialize_reference_list(GenContext *c, CValue *ref, Expr *expr)
+{
+	Type *type = type_flatten(expr->type);
+	Expr **elements = expr->initializer_list;
+	ASSERT(type->type_kind != TYPE_SLICE);
+	c_value_addr(c, ref);
+	if (type->type_kind == TYPE_BITSTRUCT)
+	{
+		c_store_zero(c, ref);
+		FOREACH_IDX(i, Expr *, init, elements)
+		{
+			c_emit_initialize_bitstruct_member(c, ref, type->decl, type->decl->strukt.members[i], init);
+		}
+		c_emit_finish_bitstruct_init(c, ref, type->decl);
+		return;
+	}
+	Type *real_type = type_lowering(ref->type);
+	bool is_struct = type_is_union_or_strukt(real_type);
+	bool is_array = real_type->type_kind == TYPE_ARRAY || real_type->type_kind == TYPE_VECTOR;
+	FOREACH_IDX(i, Expr *, element, elements)
+	{
+		CValue pointer;
+		if (is_struct)
+		{
+			c_value_member_addr(&pointer, ref, real_type->decl->strukt.members[i]);
+		}
+		else if (is_array)
+		{
+			c_value_element_addr(&pointer, ref, (ArrayIndex)i, real_type->array.base);
+		}
+		else
+		{
+			c_value_set_address(&pointer, ref->value, element->type, ref->alignment);
+		}
+		c_emit_initialize_element(c, &pointer, element);
+	}
+}
+
+static void c_emit_initialize_designated_element(GenContext *c, CValue *ref, DesignatorElement **current,
+                                                 DesignatorElement **last, Expr *expr, CValue *emitted_value)
+{
+	if (current > last)
+	{
+		if (emitted_value)
+		{
+			c_store(c, ref, emitted_value);
+			return;
+		}
+		c_emit_initialize_element(c, ref, expr);
+		return;
+	}
+	DesignatorElement *curr = current[0];
+	CValue value;
+	switch (curr->kind)
+	{
+		case DESIGNATOR_FIELD:
+		{
+			Decl *decl = ref->type->canonical->decl->strukt.members[curr->index];
+			c_value_member_addr(&value, ref, decl);
+			Type *type = type_flatten(decl->type);
+			if (type->type_kind == TYPE_BITSTRUCT && last == current + 1)
+			{
+				ASSERT(!emitted_value);
+				Decl *member = type->decl->strukt.members[last[0]->index];
+				bool bswap = c_bitstruct_requires_bitswap(type->decl);
+				if (value.type->type_kind != TYPE_ARRAY && bswap)
+				{
+					// Swap to host order, update and then swap back.
+					CValue current_value = value;
+					c_store_raw(c, value.value, value.type, value.alignment, c_bswap(c, value.type, c_rvalue(c, &current_value)));
+					c_emit_initialize_bitstruct_member(c, &value, type->decl, member, expr);
+					c_emit_finish_bitstruct_init(c, &value, type->decl);
+					break;
+				}
+				c_emit_initialize_bitstruct_member(c, &value, type->decl, member, expr);
+				break;
+			}
+			c_emit_initialize_designated_element(c, &value, current + 1, last, expr, emitted_value);
+			break;
+		}
+		case DESIGNATOR_ARRAY:
+			c_value_element_addr(&value, ref, curr->index, ref->type->array.base);
+			c_emit_initialize_designated_element(c, &value, current + 1, last, expr, emitted_value);
+			break;
+		case DESIGNATOR_RANGE:
+		{
+			CValue emitted_local;
+			if (!emitted_value)
+			{
+				c_emit_expr(c, &emitted_local, expr);
+				c_value_rvalue(c, &emitted_local);
+				emitted_value = &emitted_local;
+			}
+			for (ArrayIndex i = curr->index; i <= curr->index_end; i++)
+			{
+				c_value_element_addr(&value, ref, i, type_get_indexed_type(ref->type));
+				c_emit_initialize_designated_element(c, &value, current + 1, last, expr, emitted_value);
+			}
+			break;
+		}
+		default:
+			UNREACHABLE
+	}
+}
+
+static void c_emit_initialize_reference_designated(GenContext *c, CValue *ref, Expr *expr)
+{
+	Expr **elements = expr->designated_init_list;
+	ASSERT(vec_size(elements));
+	Type *type = type_flatten(expr->type);
+	ASSERT(type->type_kind != TYPE_SLICE);
+	c_value_addr(c, ref);
+	c_store_zero(c, ref);
+	if (type->type_kind == TYPE_BITSTRUCT)
+	{
+		FOREACH(Expr *, designator, elements)
+		{
+			ASSERT(vec_size(designator->designator_expr.path) == 1);
+			DesignatorElement *element = designator->designator_expr.path[0];
+			ASSERT(element->kind == DESIGNATOR_FIELD);
+			c_emit_initialize_bitstruct_member(c, ref, type->decl, type->decl->strukt.members[element->index],
+			                                   designator->designator_expr.value);
+		}
+		c_emit_finish_bitstruct_init(c, ref, type->decl);
+		return;
+	}
+	FOREACH(Expr *, designator, elements)
+	{
+		DesignatorElement **last_element = designator->designator_expr.path + vec_size(designator->designator_expr.path) - 1;
+		c_emit_initialize_designated_element(c, ref, designator->designator_expr.path, last_element,
+		                                     designator->designator_expr.value, NULL);
+	}
+}
+
+static void c_emit_initialize_reference(GenContext *c, CValue *ref, Expr *expr)
+{
+	switch (expr->expr_kind)
+	{
+		case EXPR_INITIALIZER_LIST:
+			c_emit_initialize_reference_list(c, ref, expr);
+			return;
+		case EXPR_DESIGNATED_INITIALIZER_LIST:
+			c_emit_initialize_reference_designated(c, ref, expr);
+			return;
+		default:
+			UNREACHABLE
+	}
+}
+
+static void c_emit_initializer_list_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Type *type = type_lowering(expr->type);
+	ASSERT(!IS_OPTIONAL(expr) || c->catch.block);
+	c_value_set_address_abi_aligned(value, c_temp_alloca(c, type), type);
+	c_emit_initialize_reference(c, value, expr);
+}
+
+// -- Unary operators
+
+static const char *c_vector_temp(GenContext *c, Type *type)
+{
+	const char *name = c_temp_name(c);
+	c_emit(c, "%s %s;", c_type_name(c, type), name);
+	return name;
+}
+
+/**
+ * Emit an element-wise operation, the element expression may use __i as the index.
+ */
+const char *c_emit_vector_op(GenContext *c, Type *type, const char *element_expr)
+{
+	const char *result = c_vector_temp(c, type);
+	c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) %s.a[__i] = %s;", (unsigned long long)type->array.len,
+	       result, element_expr);
+	return result;
+}
+
+static const char *c_emit_add_int(GenContext *c, Type *type, const char *left, const char *right, SourceSpan loc)
+{
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		return c_emit_vector_op(c, type, str_printf("(%s)(%s.a[__i] + %s.a[__i])", c_type_name(c, type->array.base), left, right));
+	}
+	if (compiler.build.feature.trap_on_wrap)
+	{
+		const char *result = c_vector_temp(c, type);
+		c_emit_panic_if_true(c, str_printf("__builtin_add_overflow(%s, %s, &%s)", left, right, result),
+		                     "Addition overflow", loc, NULL, NULL, NULL);
+		return result;
+	}
+	return c_temp_with_value(c, type, c_cast(c, type, str_printf("%s + %s", left, right)));
+}
+
+static const char *c_emit_sub_int(GenContext *c, Type *type, const char *left, const char *right, SourceSpan loc)
+{
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		return c_emit_vector_op(c, type, str_printf("(%s)(%s.a[__i] - %s.a[__i])", c_type_name(c, type->array.base), left, right));
+	}
+	if (compiler.build.feature.trap_on_wrap)
+	{
+		const char *result = c_vector_temp(c, type);
+		c_emit_panic_if_true(c, str_printf("__builtin_sub_overflow(%s, %s, &%s)", left, right, result),
+		                     "Subtraction overflow", loc, NULL, NULL, NULL);
+		return result;
+	}
+	return c_temp_with_value(c, type, c_cast(c, type, str_printf("%s - %s", left, right)));
+}
+
+static const char *c_emit_inc_dec_value(GenContext *c, SourceSpan span, CValue *original, int diff, bool allow_wrap)
+{
+	ASSERT(!c_value_is_addr(original));
+	Type *type = original->type;
+	switch (type->type_kind)
+	{
+		case TYPE_POINTER:
+			return c_temp_with_value(c, type, str_printf("(char *)%s %s %llu", original->value, diff < 0 ? "-" : "+",
+			                                             (unsigned long long)type_size(type->pointer)));
+		case ALL_FLOATS:
+			return c_temp_with_value(c, type, str_printf("%s %s 1", original->value, diff < 0 ? "-" : "+"));
+		case ALL_INTS:
+			if (!allow_wrap)
+			{
+				return c_temp_with_value(c, type, c_cast(c, type, str_printf("%s %s 1", original->value, diff < 0 ? "-" : "+")));
+			}
+			return diff > 0
+			       ? c_emit_add_int(c, type, original->value, c_const_int(type, 1), span)
+			       : c_emit_sub_int(c, type, original->value, c_const_int(type, 1), span);
+		case TYPE_VECTOR:
+			return c_emit_vector_op(c, type, str_printf("(%s)(%s.a[__i] %s 1)", c_type_name(c, type->array.base),
+			                                            original->value, diff < 0 ? "-" : "+"));
+		default:
+			UNREACHABLE
+	}
+}
+
+static void c_emit_inc_dec_change(GenContext *c, CValue *addr, CValue *after, CValue *before, Expr *expr, int diff, bool allow_wrap)
+{
+	CValue value = *addr;
+	c_value_rvalue(c, &value);
+	if (before) *before = value;
+	const char *after_value = c_emit_inc_dec_value(c, expr->span, &value, diff, allow_wrap);
+	c_store_raw(c, addr->value, addr->type, addr->alignment, after_value);
+	if (after) c_value_set(after, after_value, addr->type);
+}
+
+static inline bool expr_is_vector_subscript(Expr *expr)
+{
+	if (expr->expr_kind != EXPR_SUBSCRIPT) return false;
+	return type_lowering(exprptr(expr->subscript_expr.expr)->type)->type_kind == TYPE_VECTOR;
+}
+
+static void c_emit_pre_post_inc_dec_bitstruct(GenContext *c, CValue *value, Expr *lhs, int diff, bool pre)
+{
+	Expr *parent_expr = lhs->access_resolved_expr.parent;
+	CValue parent;
+	Decl *member = lhs->access_resolved_expr.ref;
+	c_emit_expr(c, &parent, parent_expr);
+	Decl *parent_decl = c_emit_bitstruct_member(c, &parent, type_flatten(parent_expr->type)->decl, member);
+	c_value_addr(c, &parent);
+
+	CValue current = parent;
+	c_extract_bitvalue(c, &current, parent_decl, member);
+	const char *result = c_emit_add_int(c, current.type, current.value, c_const_int(current.type, (uint64_t)(int64_t)diff), lhs->span);
+	CValue result_value;
+	c_value_set(&result_value, result, current.type);
+	*value = pre ? result_value : current;
+
+	if (type_lowering(parent_decl->type)->type_kind == TYPE_ARRAY)
+	{
+		c_emit_update_bitstruct_array(c, parent.value, c_bitstruct_requires_bitswap(parent_decl), member, &result_value);
+		return;
+	}
+	CValue container = parent;
+	const char *current_value = c_rvalue(c, &container);
+	bool bswap = c_bitstruct_requires_bitswap(parent_decl);
+	if (bswap) current_value = c_bswap(c, parent.type, current_value);
+	current_value = c_bitstruct_value_update(c, current_value, parent.type, member, result);
+	if (bswap) current_value = c_bswap(c, parent.type, current_value);
+	c_store_raw(c, parent.value, parent.type, parent.alignment, current_value);
+}
+
+static void c_emit_pre_post_inc_dec_vector(GenContext *c, CValue *value, Expr *expr, int diff, bool pre)
+{
+	CValue addr;
+	c_emit_exprid(c, &addr, expr->subscript_expr.expr);
+	c_value_addr(c, &addr);
+	Type *vec = addr.type;
+	ASSERT(vec->type_kind == TYPE_VECTOR);
+	Type *element = vec->array.base;
+	c_emit_exprid(c, value, expr->subscript_expr.index.expr);
+	const char *index = c_rvalue(c, value);
+	if (expr->subscript_expr.index.start_from_end)
+	{
+		index = c_temp_with_value(c, type_usz, str_printf("%llu - (%s)", (unsigned long long)vec->array.len, index));
+	}
+	CValue current;
+	c_value_set_address(&current, c_element_addr(addr.value, index, element), element,
+	                    type_min_alignment(type_size(element), addr.alignment));
+	CValue old_value;
+	CValue new_value;
+	c_emit_inc_dec_change(c, &current, &new_value, &old_value, expr, diff, false);
+	*value = pre ? new_value : old_value;
+}
+
+static void c_emit_pre_inc_dec(GenContext *c, CValue *value, Expr *expr, int diff, bool allow_wrap)
+{
+	if (expr_is_vector_subscript(expr))
+	{
+		c_emit_pre_post_inc_dec_vector(c, value, expr, diff, true);
+		return;
+	}
+	if (expr->expr_kind == EXPR_BITACCESS)
+	{
+		c_emit_pre_post_inc_dec_bitstruct(c, value, expr, diff, true);
+		return;
+	}
+	CValue addr;
+	c_emit_expr(c, &addr, expr);
+	c_value_addr(c, &addr);
+	c_emit_inc_dec_change(c, &addr, value, NULL, expr, diff, allow_wrap);
+}
+
+static void c_emit_post_inc_dec(GenContext *c, CValue *value, Expr *expr, int diff, bool allow_wrap)
+{
+	if (expr_is_vector_subscript(expr))
+	{
+		c_emit_pre_post_inc_dec_vector(c, value, expr, diff, false);
+		return;
+	}
+	if (expr->expr_kind == EXPR_BITACCESS)
+	{
+		c_emit_pre_post_inc_dec_bitstruct(c, value, expr, diff, false);
+		return;
+	}
+	CValue addr;
+	c_emit_expr(c, &addr, expr);
+	c_value_addr(c, &addr);
+	c_emit_inc_dec_change(c, &addr, NULL, value, expr, diff, allow_wrap);
+}
+
+static void c_emit_deref(GenContext *c, CValue *value, Expr *inner, Type *type)
+{
+	switch (inner->expr_kind)
+	{
+		case EXPR_UNARY:
+			switch (inner->unary_expr.operator)
+			{
+				case UNARYOP_ADDR:
+					c_emit_expr(c, value, inner->unary_expr.expr);
+					return;
+				case UNARYOP_TADDR:
+					c_emit_expr(c, value, inner->unary_expr.expr);
+					c_value_addr(c, value);
+					return;
+				default:
+					break;
+			}
+			break;
+		case EXPR_SUBSCRIPT_ADDR:
+			c_emit_subscript_addr(c, value, inner);
+			return;
+		default:
+			break;
+	}
+	c_emit_expr(c, value, inner);
+	c_value_rvalue(c, value);
+	AlignSize alignment = type_abi_alignment(type);
+	if (safe_mode_enabled_in(c->cur_func))
+	{
+		scratch_buffer_clear();
+		scratch_buffer_append("Dereference of null pointer, '");
+		span_to_scratch(inner->span);
+		scratch_buffer_append("' was null.");
+		c_emit_panic_if_true(c, str_printf("%s == 0", value->value), scratch_buffer_copy(), inner->span, NULL, NULL, NULL);
+		if (alignment > 1)
+		{
+			CValue align;
+			CValue rem;
+			c_value_set(&align, c_const_int(type_usz, alignment), type_usz);
+			c_value_set(&rem, c_temp_with_value(c, type_usz, str_printf("(uintptr_t)%s %% %u", value->value, (unsigned)alignment)), type_usz);
+			c_emit_panic_if_true(c, str_printf("%s != 0", rem.value), "Unaligned pointer access detected", inner->span,
+			                     "Unaligned access: ptr %% %s = %s, use @unaligned_load / @unaligned_store for unaligned access.",
+			                     &align, &rem);
+		}
+	}
+	c_value_set_address(value, value->value, type, alignment);
+}
+
+static void c_emit_type_from_any(GenContext *c, CValue *value)
+{
+	if (c_value_is_addr(value))
+	{
+		c_value_fold_optional(c, value);
+		AlignSize offset = type_size(type_voidptr);
+		c_value_set_address(value, c_offset_addr(value->value, offset), type_typeid,
+		                    type_min_alignment(offset, value->alignment));
+		return;
+	}
+	c_value_set(value, str_printf("(%s).type", value->value), type_typeid);
+}
+
+static void c_emit_dynamic_method_addr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *parent = expr->access_resolved_expr.parent;
+	Decl *dyn_fn = expr->access_resolved_expr.ref;
+	c_emit_expr(c, value, parent);
+	Decl *target_method = expr_find_dynamic_target(parent, dyn_fn, c->cur_func);
+	if (target_method)
+	{
+		c_value_set(value, str_printf("((void *)%s)", c_decl_name(c, target_method)), type_get_func_ptr(dyn_fn->type));
+		return;
+	}
+	c_emit_type_from_any(c, value);
+	c_value_rvalue(c, value);
+	const char *func = c_emit_dynamic_search(c, value->value, c_decl_name(c, dyn_fn));
+	c_value_set(value, c_temp_with_value(c, type_voidptr, func), type_get_func_ptr(dyn_fn->type));
+}
+
+static void c_emit_unary_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Type *type = type_lowering(expr->unary_expr.expr->type);
+	Expr *inner = expr->unary_expr.expr;
+	switch (expr->unary_expr.operator)
+	{
+		case UNARYOP_ERROR:
+			FATAL_ERROR("Illegal unary op %s", expr->unary_expr.operator);
+		case UNARYOP_PLUS:
+			UNREACHABLE
+		case UNARYOP_NOT:
+			c_emit_expr(c, value, inner);
+			c_value_rvalue(c, value);
+			if (type_flat_is_vector(type))
+			{
+				Type *res_type = type_get_vector_bool(type);
+				const char *result = c_emit_vector_op(c, res_type, str_printf("-(%s)(%s.a[__i] == 0)",
+				                                                             c_type_name(c, res_type->array.base), value->value));
+				c_value_set(value, result, res_type);
+				return;
+			}
+			value->value = c_temp_with_value(c, value->type, str_printf("!%s", value->value));
+			return;
+		case UNARYOP_BITNEG:
+			c_emit_expr(c, value, inner);
+			if (value->type->type_kind == TYPE_ARRAY)
+			{
+				c_value_addr(c, value);
+				Type *array_type = value->type;
+				const char *result = c_temp_alloca(c, array_type);
+				c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) ((unsigned char *)%s)[__i] = ~((unsigned char *)%s)[__i];",
+				       (unsigned long long)type_size(array_type), result, value->value);
+				c_value_set_address_abi_aligned(value, result, array_type);
+				return;
+			}
+			c_value_rvalue(c, value);
+			if (value->type->type_kind == TYPE_VECTOR)
+			{
+				value->value = c_emit_vector_op(c, value->type, str_printf("(%s)~%s.a[__i]", c_type_name(c, value->type->array.base), value->value));
+				return;
+			}
+			value->value = c_temp_with_value(c, value->type, c_cast(c, value->type, str_printf("~%s", value->value)));
+			return;
+		case UNARYOP_NEG:
+			c_emit_expr(c, value, inner);
+			c_value_rvalue(c, value);
+			ASSERT(type->canonical != type_bool);
+			if (value->type->type_kind == TYPE_VECTOR)
+			{
+				const char *base = c_type_name(c, value->type->array.base);
+				const char *element = type_is_float(value->type->array.base)
+						? str_printf("-%s.a[__i]", value->value)
+						: str_printf("(%s)(0 - %s.a[__i])", base, value->value);
+				value->value = c_emit_vector_op(c, value->type, element);
+				return;
+			}
+			if (type_is_floatlike(type))
+			{
+				value->value = c_temp_with_value(c, value->type, str_printf("-%s", value->value));
+				return;
+			}
+			if (compiler.build.feature.trap_on_wrap)
+			{
+				const char *result = c_vector_temp(c, value->type);
+				c_emit_panic_if_true(c, str_printf("__builtin_sub_overflow((%s)0, %s, &%s)", c_type_name(c, value->type),
+				                                   value->value, result),
+				                     "Signed negation overflow", expr->span, NULL, NULL, NULL);
+				value->value = result;
+				return;
+			}
+			value->value = c_temp_with_value(c, value->type, c_cast(c, value->type, str_printf("0 - %s", value->value)));
+			return;
+		case UNARYOP_ADDR:
+			if (inner->expr_kind == EXPR_ACCESS_RESOLVED && inner->access_resolved_expr.ref->decl_kind == DECL_FUNC)
+			{
+				c_emit_dynamic_method_addr(c, value, inner);
+				return;
+			}
+			if (inner->expr_kind == EXPR_IDENTIFIER && decl_flatten(inner->ident_expr)->decl_kind == DECL_FUNC)
+			{
+				// A function identifier is already emitted as its pointer.
+				c_emit_expr(c, value, inner);
+				value->type = type_lowering(expr->type);
+				return;
+			}
+			FALLTHROUGH;
+		case UNARYOP_TADDR:
+			c_emit_expr(c, value, inner);
+			c_value_addr(c, value);
+			value->kind = CV_VALUE;
+			value->type = type_lowering(expr->type);
+			return;
+		case UNARYOP_DEREF:
+			c_emit_deref(c, value, inner, expr->type);
+			return;
+		case UNARYOP_INC:
+			c_emit_pre_inc_dec(c, value, inner, 1, !expr->unary_expr.no_wrap);
+			return;
+		case UNARYOP_DEC:
+			c_emit_pre_inc_dec(c, value, inner, -1, !expr->unary_expr.no_wrap);
+			return;
+	}
+	UNREACHABLE
+}
+
+// -- Comparisons
+
+static const char *c_comparison_operator(BinaryOp op)
+{
+	switch (op)
+	{
+		case BINARYOP_EQ:
+		case BINARYOP_VEC_EQ:
+			return "==";
+		case BINARYOP_NE:
+		case BINARYOP_VEC_NE:
+			return "!=";
+		case BINARYOP_GE:
+		case BINARYOP_VEC_GE:
+			return ">=";
+		case BINARYOP_GT:
+		case BINARYOP_VEC_GT:
+			return ">";
+		case BINARYOP_LE:
+		case BINARYOP_VEC_LE:
+			return "<=";
+		case BINARYOP_LT:
+		case BINARYOP_VEC_LT:
+			return "<";
+		default:
+			UNREACHABLE
+	}
+}
+
+/**
+ * Compare two integers, where a signed value compared with an unsigned one
+ * is compared by value, so -1 < 0u.
+ */
+static const char *c_int_comp_element(Type *lhs_type, Type *rhs_type, const char *lhs, const char *rhs, BinaryOp op)
+{
+	bool lhs_signed = type_is_signed(lhs_type);
+	bool rhs_signed = type_is_signed(rhs_type);
+	bool wide = type_size(lhs_type) > 8 || type_size(rhs_type) > 8;
+	const char *op_str = c_comparison_operator(op);
+	if (lhs_signed == rhs_signed)
+	{
+		const char *wide_type = lhs_signed ? (wide ? "__int128" : "int64_t") : (wide ? "unsigned __int128" : "uint64_t");
+		return str_printf("((%s)%s %s (%s)%s)", wide_type, lhs, op_str, wide_type, rhs);
+	}
+	const char *unsigned_type = wide ? "unsigned __int128" : "uint64_t";
+	const char *compare = str_printf("((%s)%s %s (%s)%s)", unsigned_type, lhs, op_str, unsigned_type, rhs);
+	// A negative signed value is less than any unsigned value.
+	bool lhs_less;
+	switch (op)
+	{
+		case BINARYOP_EQ:
+		case BINARYOP_VEC_EQ:
+			return str_printf("(%s >= 0 && %s)", lhs_signed ? lhs : rhs, compare);
+		case BINARYOP_NE:
+		case BINARYOP_VEC_NE:
+			return str_printf("(%s < 0 || %s)", lhs_signed ? lhs : rhs, compare);
+		case BINARYOP_LT:
+		case BINARYOP_LE:
+		case BINARYOP_VEC_LT:
+		case BINARYOP_VEC_LE:
+			lhs_less = true;
+			break;
+		default:
+			lhs_less = false;
+			break;
+	}
+	bool result_if_negative = lhs_signed ? lhs_less : !lhs_less;
+	return str_printf("(%s < 0 ? %s : %s)", lhs_signed ? lhs : rhs, result_if_negative ? "true" : "false", compare);
+}
+
+static void c_emit_int_comp_raw(GenContext *c, CValue *result, Type *lhs_type, Type *rhs_type, const char *lhs, const char *rhs, BinaryOp op)
+{
+	if (lhs_type->type_kind == TYPE_VECTOR)
+	{
+		Type *lhs_base = lhs_type->array.base;
+		Type *rhs_base = type_lowering(rhs_type)->array.base;
+		const char *element = c_int_comp_element(lhs_base, rhs_base, str_printf("%s.a[__i]", lhs), str_printf("%s.a[__i]", rhs), op);
+		bool is_eq = op == BINARYOP_EQ;
+		const char *res = c_temp_with_value(c, type_bool, is_eq ? "true" : "false");
+		c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) %s = %s %s %s;", (unsigned long long)lhs_type->array.len,
+		       res, res, is_eq ? "&&" : "||", element);
+		c_value_set(result, res, type_bool);
+		return;
+	}
+	c_value_set(result, c_temp_with_value(c, type_bool, c_int_comp_element(lhs_type, rhs_type, lhs, rhs, op)), type_bool);
+}
+
+static void c_emit_int_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op)
+{
+	c_value_rvalue(c, lhs);
+	c_value_rvalue(c, rhs);
+	c_emit_int_comp_raw(c, result, lhs->type, rhs->type, lhs->value, rhs->value, op);
+}
+
+// -- Slices
+
+static void c_emit_trap_negative(GenContext *c, Expr *expr, CValue *value, const char *error)
+{
+	if (!safe_mode_enabled_in(c->cur_func)) return;
+	if (type_is_integer_unsigned(expr->type->canonical)) return;
+	c_emit_panic_if_true(c, str_printf("%s < 0", value->value), "Negative value", expr->span, error, value, NULL);
+}
+
+static void c_emit_trap_zero(GenContext *c, Type *type, const char *value, const char *error, SourceSpan loc)
+{
+	if (!safe_mode_enabled_in(c->cur_func)) return;
+	if (type_flat_is_vector(type))
+	{
+		const char *any_zero = c_temp_with_value(c, type_bool, "false");
+		c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) %s = %s || %s.a[__i] == 0;",
+		       (unsigned long long)type->array.len, any_zero, any_zero, value);
+		c_emit_panic_if_true(c, any_zero, error, loc, NULL, NULL, NULL);
+		return;
+	}
+	c_emit_panic_if_true(c, str_printf("%s == 0", value), error, loc, NULL, NULL, NULL);
+}
+
+/**
+ * Trap if the shift amount in 'value' is negative or not less than the bit width of 'shifted'.
+ */
+static void c_emit_trap_invalid_shift(GenContext *c, const char *value, Type *type, Type *shifted, const char *error, SourceSpan loc)
+{
+	if (!safe_mode_enabled_in(c->cur_func)) return;
+	type = type_lowering(type);
+	shifted = type_lowering(shifted);
+	if (type_flat_is_vector(shifted)) shifted = shifted->array.base;
+	unsigned bits = (unsigned)type_bit_size(shifted);
+	CValue val;
+	c_value_set(&val, value, type);
+	if (type_flat_is_vector(type))
+	{
+		Type *base = type->array.base;
+		const char *invalid = c_temp_with_value(c, type_bool, "false");
+		c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) %s = %s || %s.a[__i] %s|| %s.a[__i] >= %u;",
+		       (unsigned long long)type->array.len, invalid, invalid, value,
+		       type_is_signed(base) ? "< 0 " : "!= 0 && 0 ", value, bits);
+		c_emit_panic_if_true(c, invalid, "Invalid shift", loc, error, &val, NULL);
+		return;
+	}
+	if (type_is_signed(type))
+	{
+		c_emit_panic_if_true(c, str_printf("%s < 0", value), "Invalid shift", loc, error, &val, NULL);
+	}
+	c_emit_panic_if_true(c, str_printf("%s >= %u", value, bits), "Invalid shift", loc, error, &val, NULL);
+}
+
+static void c_emit_slice_values(GenContext *c, Expr *slice, CValue *parent_ref, CValue *start_ref, CValue *end_ref, bool *is_exclusive)
+{
+	ASSERT(slice->expr_kind == EXPR_SLICE);
+	Expr *parent_expr = exprptr(slice->subscript_expr.expr);
+	Type *parent_type = type_no_optional(type_flatten(parent_expr->type));
+	CValue parent_addr;
+	c_emit_expr(c, &parent_addr, parent_expr);
+	c_value_addr(c, &parent_addr);
+	const char *parent_base;
+	const char *slice_len = NULL;
+	switch (parent_type->type_kind)
+	{
+		case TYPE_POINTER:
+			parent_base = c_load_raw(c, parent_addr.value, parent_type, parent_addr.alignment);
+			break;
+		case TYPE_SLICE:
+		{
+			const char *loaded = c_load_raw(c, parent_addr.value, parent_type, parent_addr.alignment);
+			parent_base = str_printf("%s.ptr", loaded);
+			slice_len = str_printf("%s.len", loaded);
+			break;
+		}
+		case TYPE_FLEXIBLE_ARRAY:
+		case TYPE_ARRAY:
+		case TYPE_VECTOR:
+			parent_base = parent_addr.value;
+			break;
+		default:
+			UNREACHABLE
+	}
+
+	Type *start_type = (Type*)INVALID_PTR;
+	Range range = slice->slice_expr.range;
+	CValue start_index;
+	switch (range.range_type)
+	{
+		case RANGE_DYNAMIC:
+		case RANGE_CONST_LEN:
+		case RANGE_CONST_END:
+			c_emit_exprid(c, &start_index, range.start);
+			c_value_rvalue(c, &start_index);
+			start_type = start_index.type;
+			break;
+		case RANGE_CONST_RANGE:
+			start_type = type_lowering(type_isz);
+			c_value_set(&start_index, c_const_int(start_type, (uint64_t)range.start_index), start_type);
+			break;
+	}
+
+	CValue len = { .value = NULL };
+	bool check_end = true;
+	bool start_from_end = range.start_from_end;
+	bool end_from_end = range.end_from_end;
+	bool has_end = range.range_type != RANGE_DYNAMIC || range.end;
+	if (!has_end || start_from_end || end_from_end || safe_mode_enabled_in(c->cur_func))
+	{
+		switch (parent_type->type_kind)
+		{
+			case TYPE_POINTER:
+			case TYPE_FLEXIBLE_ARRAY:
+				check_end = false;
+				break;
+			case TYPE_SLICE:
+				c_value_set(&len, c_cast(c, start_type, slice_len), start_type);
+				break;
+			case TYPE_ARRAY:
+			case TYPE_VECTOR:
+				c_value_set(&len, c_const_int(start_type, parent_type->array.len), start_type);
+				break;
+			default:
+				UNREACHABLE
+		}
+	}
+
+	if (start_from_end)
+	{
+		start_index.value = c_emit_sub_int(c, start_index.type, len.value, start_index.value, slice->span);
+	}
+
+	if (check_end && safe_mode_enabled_in(c->cur_func))
+	{
+		ASSERT(len.value);
+		CValue exceeds_size;
+		c_emit_int_comp(c, &exceeds_size, &start_index, &len, BINARYOP_GT);
+		c_emit_panic_if_true(c, exceeds_size.value, "Index exceeds array len", slice->span,
+		                     "Index exceeds array length (array had size %d, index was %d).", &len, &start_index);
+	}
+
+	if (parent_type->type_kind != TYPE_POINTER && range.range_type != RANGE_CONST_RANGE)
+	{
+		c_emit_trap_negative(c, exprptr(range.start), &start_index, "Negative indexing (%d)");
+	}
+
+	CValue end_index;
+	bool is_len_range = *is_exclusive = range.is_len;
+	Type *end_type = start_type;
+	if (has_end)
+	{
+		switch (range.range_type)
+		{
+			case RANGE_DYNAMIC:
+				c_emit_exprid(c, &end_index, range.end);
+				c_value_rvalue(c, &end_index);
+				end_type = end_index.type;
+				break;
+			case RANGE_CONST_LEN:
+			case RANGE_CONST_END:
+				c_value_set(&end_index, c_const_int(end_type, (uint64_t)range.const_end), end_type);
+				break;
+			case RANGE_CONST_RANGE:
+				c_value_set(&end_index, c_const_int(end_type, (uint64_t)range.len_index), end_type);
+				break;
+		}
+		if (end_from_end)
+		{
+			ASSERT(range.range_type == RANGE_DYNAMIC);
+			end_index.value = c_emit_sub_int(c, end_index.type, c_cast(c, end_index.type, len.value), end_index.value, slice->span);
+		}
+		if (is_len_range)
+		{
+			end_index.value = c_emit_add_int(c, end_index.type, c_cast(c, end_index.type, start_index.value), end_index.value, slice->span);
+		}
+		if (safe_mode_enabled_in(c->cur_func))
+		{
+			CValue excess;
+			if (is_len_range)
+			{
+				c_emit_int_comp(c, &excess, &start_index, &end_index, BINARYOP_GT);
+				CValue actual_end_len = end_index;
+				actual_end_len.value = c_temp_with_value(c, end_index.type, c_cast(c, end_index.type, str_printf("%s - %s", end_index.value, start_index.value)));
+				c_emit_panic_if_true(c, excess.value, "Negative slice length", slice->span,
+				                     "Negative value (%d) given for slice length.", &actual_end_len, NULL);
+				if (len.value)
+				{
+					c_emit_int_comp(c, &excess, &len, &end_index, BINARYOP_LT);
+					CValue actual_end_index = end_index;
+					actual_end_index.value = c_temp_with_value(c, end_index.type, c_cast(c, end_index.type, str_printf("%s - 1", end_index.value)));
+					c_emit_panic_if_true(c, excess.value, "End index out of bounds", slice->span,
+					                     "End index out of bounds (end index of %d exceeds size of %d)", &actual_end_index, &len);
+				}
+			}
+			else
+			{
+				c_emit_int_comp(c, &excess, &start_index, &end_index, BINARYOP_GT);
+				c_emit_panic_if_true(c, excess.value, "Negative size", slice->span,
+				                     "Negative size (start %d is less than end %d)", &start_index, &end_index);
+				if (len.value)
+				{
+					c_emit_int_comp(c, &excess, &len, &end_index, BINARYOP_LE);
+					c_emit_panic_if_true(c, excess.value, "End index out of bounds", slice->span,
+					                     "End index out of bounds (end index of %d exceeds size of %d)", &end_index, &len);
+				}
+			}
+		}
+	}
+	else
+	{
+		ASSERT(len.value && "Pointer should never end up here.");
+		end_index = len;
+		end_type = start_type;
+		*is_exclusive = true;
+	}
+	c_value_set(end_ref, end_index.value, end_type);
+	c_value_set(start_ref, start_index.value, end_type);
+	c_value_set_address(parent_ref, parent_base, parent_type, type_abi_alignment(parent_type));
+}
+
+static Type *c_slice_parent_element(Type *type)
+{
+	type = type_lowering(type);
+	return type->type_kind == TYPE_POINTER ? type->pointer : type->array.base;
+}
+
+static void c_emit_slice(GenContext *c, CValue *value, Expr *expr)
+{
+	CValue parent;
+	CValue start;
+	CValue end;
+	bool is_exclusive;
+	c_emit_slice_values(c, expr, &parent, &start, &end, &is_exclusive);
+	const char *size = is_exclusive
+			? str_printf("%s - %s", end.value, start.value)
+			: str_printf("%s + 1 - %s", end.value, start.value);
+	const char *start_pointer = c_element_addr(parent.value, start.value, c_slice_parent_element(parent.type));
+	Type *type = type_lowering(expr->type);
+	c_value_set(value, c_temp_with_value(c, type, str_printf("(__c3_slice){ %s, (%s)(%s) }", start_pointer,
+	                                                              c_type_name(c, type_usz), size)), type);
+}
+
+static void c_emit_slice_copy(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_exprid(c, value, expr->slice_assign_expr.right);
+	c_value_rvalue(c, value);
+	CValue assigned_to;
+	c_emit_exprid(c, &assigned_to, expr->slice_assign_expr.left);
+	c_value_rvalue(c, &assigned_to);
+	Type *element = type_lowering(assigned_to.type)->array.base;
+	CValue from_len;
+	c_value_set(&from_len, str_printf("%s.len", value->value), type_usz);
+	if (safe_mode_enabled_in(c->cur_func))
+	{
+		CValue to_len;
+		c_value_set(&to_len, str_printf("%s.len", assigned_to.value), type_usz);
+		c_emit_panic_if_true(c, str_printf("%s != %s", to_len.value, from_len.value), "Length mismatch", expr->span,
+		                     "Slice copy length mismatch (%d != %d).", &to_len, &from_len);
+	}
+	c_emit(c, "__builtin_memmove(%s.ptr, %s.ptr, %s * %llu);", assigned_to.value, value->value, from_len.value,
+	       (unsigned long long)type_size(element));
+}
+
+static void c_emit_slice_assign(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *assigned_value = exprptr(expr->slice_assign_expr.right);
+	c_emit_expr(c, value, assigned_value);
+	ASSERT(!IS_OPTIONAL(assigned_value));
+	// Copy big values first, to ensure value semantics even if the value aliases the slice.
+	if (c_value_is_addr(value) && type_size(assigned_value->type) > 16)
+	{
+		CValue temp;
+		c_value_set_address(&temp, c_temp_alloca(c, value->type), value->type, type_abi_alignment(value->type));
+		c_store(c, &temp, value);
+		*value = temp;
+	}
+	else
+	{
+		c_value_rvalue(c, value);
+	}
+	CValue parent;
+	CValue start;
+	CValue end;
+	bool is_exclusive;
+	c_emit_slice_values(c, exprptr(expr->slice_assign_expr.left), &parent, &start, &end, &is_exclusive);
+	const char *offset = c_temp_with_value(c, start.type, start.value);
+	int cond_block = c_new_label(c);
+	int exit_block = c_new_label(c);
+	c_emit_label(c, cond_block);
+	CValue comp;
+	c_emit_int_comp_raw(c, &comp, start.type, end.type, offset, end.value, is_exclusive ? BINARYOP_LT : BINARYOP_LE);
+	c_emit(c, "if (!%s) goto __L%d;", comp.value, exit_block);
+	CValue addr;
+	Type *element = c_slice_parent_element(parent.type);
+	c_value_set_address_abi_aligned(&addr, c_element_addr(parent.value, offset, element), element);
+	CValue stored = *value;
+	c_store(c, &addr, &stored);
+	c_emit(c, "%s = %s;", offset, c_emit_add_int(c, start.type, offset, c_const_int(start.type, 1), expr->span));
+	c_emit_goto(c, cond_block);
+	c_emit_label(c, exit_block);
+}
+
+static void c_emit_logical_and_or(GenContext *c, CValue *value, Expr *expr, BinaryOp op)
+{
+	const char *result = c_temp_name(c);
+	c_emit(c, "bool %s;", result);
+	c_emit(c, "%s = %s;", result, c_emit_expr_rvalue(c, exprptr(expr->binary_expr.left)));
+	int phi_block = c_new_label(c);
+	c_emit(c, "if (%s%s) goto __L%d;", op == BINARYOP_AND ? "!" : "", result, phi_block);
+	c_emit(c, "%s = %s;", result, c_emit_expr_rvalue(c, exprptr(expr->binary_expr.right)));
+	c_emit_label(c, phi_block);
+	c_value_set(value, result, type_bool);
+}
+
+static void c_emit_comp_loop(GenContext *c, CValue *result, const char *lhs_ptr, const char *rhs_ptr,
+                             const char *len, Type *element, const char *len_mismatch, BinaryOp op)
+{
+	bool want_match = op == BINARYOP_EQ;
+	const char *res = c_temp_with_value(c, type_bool, want_match ? "false" : "true");
+	int exit_block = c_new_label(c);
+	int loop_block = c_new_label(c);
+	int match_block = c_new_label(c);
+	if (len_mismatch) c_emit(c, "if (%s) goto __L%d;", len_mismatch, exit_block);
+	const char *index = c_temp_with_value(c, type_usz, "0");
+	c_emit_label(c, loop_block);
+	c_emit(c, "if (%s >= %s) goto __L%d;", index, len, match_block);
+	CValue lhs_elem;
+	CValue rhs_elem;
+	c_value_set_address_abi_aligned(&lhs_elem, c_element_addr(lhs_ptr, index, element), element);
+	c_value_set_address_abi_aligned(&rhs_elem, c_element_addr(rhs_ptr, index, element), element);
+	CValue cmp;
+	c_emit_comp(c, &cmp, &lhs_elem, &rhs_elem, BINARYOP_EQ);
+	c_emit(c, "if (!%s) goto __L%d;", cmp.value, exit_block);
+	c_emit(c, "%s++;", index);
+	c_emit_goto(c, loop_block);
+	c_emit_label(c, match_block);
+	c_emit(c, "%s = %s;", res, want_match ? "true" : "false");
+	c_emit_label(c, exit_block);
+	c_value_set(result, res, type_bool);
+}
+
+static void c_emit_memcmp_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op)
+{
+	c_value_addr(c, lhs);
+	c_value_addr(c, rhs);
+	c_value_set(result, c_temp_with_value(c, type_bool, str_printf("__builtin_memcmp(%s, %s, %llu) %s 0", lhs->value, rhs->value,
+	                                                                (unsigned long long)type_size(lhs->type), c_comparison_operator(op))), type_bool);
+}
+
+static void c_emit_array_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op)
+{
+	Type *array_base = type_flatten(lhs->type->array.base);
+	switch (array_base->type_kind)
+	{
+		case ALL_INTS:
+		case TYPE_POINTER:
+		case TYPE_ENUM:
+		case TYPE_FUNC_PTR:
+		case TYPE_INTERFACE:
+		case TYPE_ANY:
+		case TYPE_ANYFAULT:
+		case TYPE_TYPEID:
+			c_emit_memcmp_comp(c, result, lhs, rhs, op);
+			return;
+		case TYPE_VECTOR:
+			if (is_power_of_two(array_base->array.len))
+			{
+				c_emit_memcmp_comp(c, result, lhs, rhs, op);
+				return;
+			}
+			break;
+		case TYPE_UNION:
+		case TYPE_STRUCT:
+		case TYPE_BITSTRUCT:
+			if (array_base->decl->attr_compact)
+			{
+				c_emit_memcmp_comp(c, result, lhs, rhs, op);
+				return;
+			}
+			break;
+		default:
+			break;
+	}
+	c_value_addr(c, lhs);
+	c_value_addr(c, rhs);
+	c_emit_comp_loop(c, result, lhs->value, rhs->value, str_printf("%llu", (unsigned long long)lhs->type->array.len),
+	                 type_lowering(array_base), NULL, op);
+}
+
+static void c_emit_slice_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op)
+{
+	Type *element = type_lowering(lhs->type->array.base);
+	const char *left = c_rvalue(c, lhs);
+	const char *right = c_rvalue(c, rhs);
+	c_emit_comp_loop(c, result, str_printf("%s.ptr", left), str_printf("%s.ptr", right), str_printf("%s.len", left),
+	                 element, str_printf("%s.len != %s.len", left, right), op);
+}
+
+static const char *c_float_comp_element(const char *lhs, const char *rhs, BinaryOp op)
+{
+	switch (op)
+	{
+		case BINARYOP_NE:
+		case BINARYOP_VEC_NE:
+			// Ordered not equal, so false for NaN.
+			return str_printf("(%s < %s || %s > %s)", lhs, rhs, lhs, rhs);
+		default:
+			return str_printf("(%s %s %s)", lhs, c_comparison_operator(op), rhs);
+	}
+}
+
+static void c_emit_float_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op)
+{
+	const char *left = c_rvalue(c, lhs);
+	const char *right = c_rvalue(c, rhs);
+	if (lhs->type->type_kind == TYPE_VECTOR)
+	{
+		bool is_eq = op == BINARYOP_EQ;
+		const char *res = c_temp_with_value(c, type_bool, is_eq ? "true" : "false");
+		c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) %s = %s %s %s;", (unsigned long long)lhs->type->array.len,
+		       res, res, is_eq ? "&&" : "||",
+		       c_float_comp_element(str_printf("%s.a[__i]", left), str_printf("%s.a[__i]", right), op));
+		c_value_set(result, res, type_bool);
+		return;
+	}
+	c_value_set(result, c_temp_with_value(c, type_bool, c_float_comp_element(left, right, op)), type_bool);
+}
+
+static void c_emit_vec_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op, Type *type)
+{
+	type = type_lowering(type);
+	const char *left = c_rvalue(c, lhs);
+	const char *right = c_rvalue(c, rhs);
+	Type *base = lhs->type->array.base;
+	const char *l = str_printf("%s.a[__i]", left);
+	const char *r = str_printf("%s.a[__i]", right);
+	const char *element = type_is_float(base)
+			? c_float_comp_element(l, r, op)
+			: c_int_comp_element(base, rhs->type->array.base, l, r, op);
+	Type *result_base = type->array.base;
+	if (result_base != type_bool) element = str_printf("-(%s)%s", c_type_name(c, result_base), element);
+	c_value_set(result, c_emit_vector_op(c, type, element), type);
+}
+
+void c_emit_lhs_is_subtype(GenContext *c, CValue *result, CValue *lhs, CValue *rhs)
+{
+	const char *target = c_rvalue(c, lhs);
+	const char *current = c_temp_with_value(c, type_typeid, c_rvalue(c, rhs));
+	const char *res = c_temp_with_value(c, type_bool, "true");
+	int retry_block = c_new_label(c);
+	int result_block = c_new_label(c);
+	c_introspect_type_name(c, 0);
+	c_emit_label(c, retry_block);
+	c_emit(c, "if (%s == %s) goto __L%d;", target, current, result_block);
+	c_emit(c, "%s = ((__c3_introspect0 *)(uintptr_t)%s)->parent;", current, current);
+	c_emit(c, "if (%s) goto __L%d;", current, retry_block);
+	c_emit(c, "%s = false;", res);
+	c_emit_label(c, result_block);
+	c_value_set(result, res, type_bool);
+}
+
+void c_emit_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op)
+{
+	ASSERT(type_lowering(lhs->type) == lhs->type);
+	ASSERT(op >= BINARYOP_GT && op <= BINARYOP_EQ);
+	switch (lhs->type->type_kind)
+	{
+		case TYPE_BOOL:
+		case ALL_INTS:
+			c_emit_int_comp(c, result, lhs, rhs, op);
+			return;
+		case ALL_FLOATS:
+			c_emit_float_comp(c, result, lhs, rhs, op);
+			return;
+		case TYPE_POINTER:
+		case TYPE_FUNC_PTR:
+		{
+			const char *left = c_rvalue(c, lhs);
+			const char *right = c_rvalue(c, rhs);
+			c_value_set(result, c_temp_with_value(c, type_bool, str_printf("(uintptr_t)%s %s (uintptr_t)%s", left,
+			                                                                c_comparison_operator(op), right)), type_bool);
+			return;
+		}
+		case TYPE_ARRAY:
+			c_emit_array_comp(c, result, lhs, rhs, op);
+			return;
+		case TYPE_ANY:
+		{
+			const char *left = c_rvalue(c, lhs);
+			const char *right = c_rvalue(c, rhs);
+			const char *cmp = op == BINARYOP_EQ
+					? str_printf("%s.ptr == %s.ptr && %s.type == %s.type", left, right, left, right)
+					: str_printf("%s.ptr != %s.ptr || %s.type != %s.type", left, right, left, right);
+			c_value_set(result, c_temp_with_value(c, type_bool, cmp), type_bool);
+			return;
+		}
+		case TYPE_STRUCT:
+		case TYPE_UNION:
+			c_value_fold_optional(c, lhs);
+			c_value_fold_optional(c, rhs);
+			c_emit_memcmp_comp(c, result, lhs, rhs, op);
+			return;
+		case TYPE_SLICE:
+			c_emit_slice_comp(c, result, lhs, rhs, op);
+			return;
+		case TYPE_VECTOR:
+			if (type_is_float(type_vector_type(lhs->type)))
+			{
+				c_emit_float_comp(c, result, lhs, rhs, op);
+				return;
+			}
+			c_emit_int_comp(c, result, lhs, rhs, op);
+			return;
+		default:
+			UNREACHABLE
+	}
+}
+
+// -- Binary operators
+
+static void c_emit_else(GenContext *c, CValue *value, Expr *expr)
+{
+	int else_block = c_new_label(c);
+	int phi_block = c_new_label(c);
+	Type *type = type_lowering(expr->type);
+	const char *result = type == type_void ? NULL : c_temp_alloca(c, type);
+	CValue result_ref;
+	if (result) c_value_set_address_abi_aligned(&result_ref, result, type);
+
+	PUSH_CATCH_VAR_BLOCK(NULL, else_block);
+	CValue real_value;
+	c_emit_exprid(c, &real_value, expr->binary_expr.left);
+	c_value_fold_optional(c, &real_value);
+	POP_CATCH();
+	if (result) c_store(c, &result_ref, &real_value);
+	c_emit_goto(c, phi_block);
+
+	c_emit_label(c, else_block);
+	CValue else_value;
+	c_emit_exprid(c, &else_value, expr->binary_expr.right);
+	c_value_fold_optional(c, &else_value);
+	if (result && else_value.type != type_void) c_store(c, &result_ref, &else_value);
+	c_emit_label(c, phi_block);
+
+	if (!result)
+	{
+		c_value_set(value, "0", type_void);
+		return;
+	}
+	*value = result_ref;
+}
+
+static const char *c_emit_mult_int(GenContext *c, Type *type, const char *left, const char *right, SourceSpan loc)
+{
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		return c_emit_vector_op(c, type, str_printf("(%s)(%s.a[__i] * %s.a[__i])", c_type_name(c, type->array.base), left, right));
+	}
+	if (compiler.build.feature.trap_on_wrap)
+	{
+		const char *result = c_vector_temp(c, type);
+		c_emit_panic_if_true(c, str_printf("__builtin_mul_overflow(%s, %s, &%s)", left, right, result),
+		                     "Integer multiplication overflow", loc, NULL, NULL, NULL);
+		return result;
+	}
+	return c_temp_with_value(c, type, c_cast(c, type, str_printf("%s * %s", left, right)));
+}
+
+static void c_emit_bitstruct_binary_op(GenContext *c, CValue *value, CValue *lhs, CValue *rhs, const char *op)
+{
+	c_value_addr(c, lhs);
+	c_value_addr(c, rhs);
+	Type *type = lhs->type;
+	const char *result = c_temp_alloca(c, type);
+	c_emit(c, "for (unsigned __i = 0; __i < %llu; __i++) ((unsigned char *)%s)[__i] = ((unsigned char *)%s)[__i] %s ((unsigned char *)%s)[__i];",
+	       (unsigned long long)type_size(type), result, lhs->value, op, rhs->value);
+	c_value_set_address_abi_aligned(value, result, type);
+}
+
+static void c_fold_for_compare(GenContext *c, CValue *value)
+{
+	switch (value->type->type_kind)
+	{
+		case TYPE_ARRAY:
+		case TYPE_STRUCT:
+		case TYPE_UNION:
+			break;
+		default:
+			c_value_rvalue(c, value);
+			break;
+	}
+}
+
+/**
+ * The element of an arithmetic op, with the vector element access when the operands are vectors.
+ */
+static const char *c_binary_element(GenContext *c, Type *type, const char *lhs, const char *op, const char *rhs)
+{
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		Type *base = type->array.base;
+		const char *element = str_printf("%s.a[__i] %s %s.a[__i]", lhs, op, rhs);
+		return c_emit_vector_op(c, type, type_is_float(base) ? element : c_cast(c, base, element));
+	}
+	const char *element = str_printf("%s %s %s", lhs, op, rhs);
+	return c_temp_with_value(c, type, type_is_float(type) ? element : c_cast(c, type, element));
+}
+
+static const char *c_shift_element(GenContext *c, Type *type, const char *lhs, const char *rhs, bool left)
+{
+	unsigned bits = (unsigned)type_bit_size(type);
+	const char *type_name = c_type_name(c, type);
+	if (left)
+	{
+		// Shift through the unsigned type to avoid signed overflow.
+		const char *unsigned_name = c_type_name(c, type_int_unsigned_by_bitsize(bits));
+		return str_printf("((%s)%s < %u ? (%s)((%s)%s << %s) : (%s)0)", c_type_name(c, type_ulong), rhs, bits, type_name,
+		                  unsigned_name, lhs, rhs, type_name);
+	}
+	// An out of range arithmetic shift gives the sign, otherwise zero.
+	return str_printf("((%s)%s < %u ? (%s)(%s >> %s) : (%s)%s)", c_type_name(c, type_ulong), rhs, bits, type_name,
+	                  lhs, rhs, type_name, type_is_signed(type) ? str_printf("(%s < 0 ? -1 : 0)", lhs) : "0");
+}
+
+static void c_emit_binary(GenContext *c, CValue *value, Expr *expr, CValue *lhs_loaded, BinaryOp binary_op)
+{
+	if (binary_op == BINARYOP_ELSE)
+	{
+		c_emit_else(c, value, expr);
+		return;
+	}
+	if (binary_op == BINARYOP_AND || binary_op == BINARYOP_OR)
+	{
+		c_emit_logical_and_or(c, value, expr, binary_op);
+		return;
+	}
+	CValue lhs;
+	if (lhs_loaded)
+	{
+		lhs = *lhs_loaded;
+	}
+	else
+	{
+		c_emit_expr(c, &lhs, exprptr(expr->binary_expr.left));
+	}
+	c_fold_for_compare(c, &lhs);
+
+	CValue rhs;
+	c_emit_expr(c, &rhs, exprptr(expr->binary_expr.right));
+	c_fold_for_compare(c, &rhs);
+
+	if (binary_op >= BINARYOP_GT && binary_op <= BINARYOP_EQ)
+	{
+		c_emit_comp(c, value, &lhs, &rhs, binary_op);
+		return;
+	}
+	if (binary_op >= BINARYOP_VEC_GT && binary_op <= BINARYOP_VEC_EQ)
+	{
+		c_emit_vec_comp(c, value, &lhs, &rhs, binary_op, expr->type);
+		return;
+	}
+	Type *lhs_type = lhs.type;
+	Type *rhs_type = rhs.type;
+	Type *vector_type = lhs_type->type_kind == TYPE_VECTOR ? lhs_type->array.base : NULL;
+	bool is_float = type_is_float(lhs_type) || (vector_type && type_is_float(vector_type));
+	const char *l = lhs.value;
+	const char *r = rhs.value;
+	const char *val;
+	switch (binary_op)
+	{
+		case BINARYOP_MULT:
+			val = is_float ? c_binary_element(c, lhs_type, l, "*", r) : c_emit_mult_int(c, lhs_type, l, r, expr->span);
+			break;
+		case BINARYOP_SUB:
+			if (type_is_pointer_vector(lhs_type))
+			{
+				TypeSize size = type_size(lhs_type->array.base->pointer);
+				if (lhs_type == rhs_type)
+				{
+					Type *diff_type = type_get_vector(type_isz, lhs_type->array.len);
+					val = c_emit_vector_op(c, diff_type, str_printf("(%s)((char *)%s.a[__i] - (char *)%s.a[__i]) / %llu",
+					                                                c_type_name(c, type_isz), l, r, (unsigned long long)size));
+					lhs_type = diff_type;
+					break;
+				}
+				val = c_emit_vector_op(c, lhs_type, str_printf("(char *)%s.a[__i] - (ptrdiff_t)%s.a[__i] * %llu", l, r,
+				                                               (unsigned long long)size));
+				break;
+			}
+			if (lhs_type->type_kind == TYPE_POINTER)
+			{
+				TypeSize size = type_size(lhs_type->pointer);
+				if (lhs_type == rhs_type)
+				{
+					val = c_temp_with_value(c, type_isz, str_printf("(%s)((char *)%s - (char *)%s) / %llu", c_type_name(c, type_isz),
+					                                                l, r, (unsigned long long)size));
+					lhs_type = type_isz;
+					break;
+				}
+				val = c_temp_with_value(c, lhs_type, str_printf("(char *)%s - (ptrdiff_t)%s * %llu", l, r, (unsigned long long)size));
+				break;
+			}
+			val = is_float ? c_binary_element(c, lhs_type, l, "-", r) : c_emit_sub_int(c, lhs_type, l, r, expr->span);
+			break;
+		case BINARYOP_ADD:
+			if (type_is_pointer_vector(lhs_type))
+			{
+				val = c_emit_vector_op(c, lhs_type, str_printf("(char *)%s.a[__i] + (ptrdiff_t)%s.a[__i] * %llu", l, r,
+				                                               (unsigned long long)type_size(lhs_type->array.base->pointer)));
+				break;
+			}
+			if (lhs_type->type_kind == TYPE_POINTER)
+			{
+				ASSERT(type_is_integer(rhs_type));
+				val = c_temp_with_value(c, lhs_type, str_printf("(char *)%s + (ptrdiff_t)%s * %llu", l, r,
+				                                                (unsigned long long)type_size(lhs_type->pointer)));
+				break;
+			}
+			val = is_float ? c_binary_element(c, lhs_type, l, "+", r) : c_emit_add_int(c, lhs_type, l, r, expr->span);
+			break;
+		case BINARYOP_DIV:
+			if (!is_float) c_emit_trap_zero(c, rhs_type, r, "Division by zero.", expr->span);
+			val = c_binary_element(c, lhs_type, l, "/", r);
+			break;
+		case BINARYOP_MOD:
+			if (!is_float)
+			{
+				c_emit_trap_zero(c, rhs_type, r, "% by zero.", expr->span);
+				val = c_binary_element(c, lhs_type, l, "%", r);
+				break;
+			}
+			{
+				Type *float_type = vector_type ? vector_type : lhs_type;
+				const char *fmod = float_type == type_float ? "__builtin_fmodf" : "__builtin_fmod";
+				if (float_type->type_kind == TYPE_F128) fmod = "__builtin_fmodl";
+				val = vector_type
+						? c_emit_vector_op(c, lhs_type, str_printf("%s(%s.a[__i], %s.a[__i])", fmod, l, r))
+						: c_temp_with_value(c, lhs_type, str_printf("%s(%s, %s)", fmod, l, r));
+			}
+			break;
+		case BINARYOP_SHR:
+		case BINARYOP_SHL:
+		{
+			bool left = binary_op == BINARYOP_SHL;
+			c_emit_trap_invalid_shift(c, r, rhs_type, lhs_type, "Shift amount out of range (was %s).", expr->span);
+			val = vector_type
+					? c_emit_vector_op(c, lhs_type, c_shift_element(c, vector_type, str_printf("%s.a[__i]", l), str_printf("%s.a[__i]", r), left))
+					: c_temp_with_value(c, lhs_type, c_shift_element(c, lhs_type, l, r, left));
+			break;
+		}
+		case BINARYOP_BIT_AND:
+		case BINARYOP_BIT_OR:
+		case BINARYOP_BIT_XOR:
+		{
+			const char *op = binary_op == BINARYOP_BIT_AND ? "&" : (binary_op == BINARYOP_BIT_OR ? "|" : "^");
+			if (lhs_type->type_kind == TYPE_ARRAY)
+			{
+				c_emit_bitstruct_binary_op(c, value, &lhs, &rhs, op);
+				return;
+			}
+			val = c_binary_element(c, lhs_type, l, op, r);
+			break;
+		}
+		default:
+			UNREACHABLE
+	}
+	c_value_set(value, val, lhs_type);
+}
+
+static void c_emit_swizzle_from_value(GenContext *c, const char *vector, CValue *value, Expr *expr)
+{
+	Type *type = type_lowering(expr->type);
+	const char *result = c_vector_temp(c, type);
+	const char *sw_ptr = expr->swizzle_expr.swizzle;
+	for (unsigned i = 0; i < type->array.len; i++)
+	{
+		int index = (swizzle[(int)sw_ptr[i]] - 1) & 0xF;
+		c_emit(c, "%s.a[%u] = %s.a[%d];", result, i, vector, index);
+	}
+	c_value_set(value, result, type);
+}
+
+static void c_emit_swizzle(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_exprid(c, value, expr->swizzle_expr.parent);
+	c_emit_swizzle_from_value(c, c_rvalue(c, value), value, expr);
+}
+
+static void c_emit_vector_assign_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *left = exprptr(expr->binary_expr.left);
+	BinaryOp binary_op = expr->binary_expr.operator;
+	CValue addr;
+	bool is_swizzle = left->expr_kind == EXPR_SWIZZLE;
+	c_emit_exprid(c, &addr, is_swizzle ? left->swizzle_expr.parent : left->subscript_expr.expr);
+	c_value_addr(c, &addr);
+	Type *vec = addr.type;
+	if (is_swizzle)
+	{
+		if (binary_op > BINARYOP_ASSIGN)
+		{
+			CValue lhs;
+			CValue loaded = addr;
+			c_emit_swizzle_from_value(c, c_rvalue(c, &loaded), &lhs, left);
+			BinaryOp base_op = binaryop_assign_base_op(binary_op);
+			ASSERT(base_op != BINARYOP_ERROR);
+			c_emit_binary(c, value, expr, &lhs, base_op);
+		}
+		else
+		{
+			c_emit_expr(c, value, exprptr(expr->binary_expr.right));
+		}
+		const char *result = c_rvalue(c, value);
+		const char *sw_ptr = left->swizzle_expr.swizzle;
+		unsigned vec_len = value->type->array.len;
+		Type *base = vec->array.base;
+		for (unsigned i = 0; i < vec_len; i++)
+		{
+			int index = (swizzle[(int)sw_ptr[i]] - 1) & 0xF;
+			CValue element;
+			c_value_element_addr(&element, &addr, index, base);
+			c_store_raw(c, element.value, base, element.alignment, str_printf("%s.a[%u]", result, i));
+		}
+		c_value_set(value, result, expr->type);
+		return;
+	}
+	CValue index;
+	c_emit_exprid(c, &index, left->subscript_expr.index.expr);
+	const char *index_val = c_temp_with_value(c, type_usz, c_rvalue(c, &index));
+	Type *base = vec->array.base;
+	CValue element;
+	c_value_set_address(&element, c_element_addr(addr.value, index_val, base), base,
+	                    type_min_alignment(type_size(base), addr.alignment));
+	if (binary_op > BINARYOP_ASSIGN)
+	{
+		BinaryOp base_op = binaryop_assign_base_op(binary_op);
+		ASSERT(base_op != BINARYOP_ERROR);
+		CValue lhs = element;
+		c_value_rvalue(c, &lhs);
+		c_emit_binary(c, value, expr, &lhs, base_op);
+	}
+	else
+	{
+		c_emit_expr(c, value, exprptr(expr->binary_expr.right));
+	}
+	c_value_rvalue(c, value);
+	c_store(c, &element, value);
+}
+
+static void c_emit_binary_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	BinaryOp binary_op = expr->binary_expr.operator;
+	if (binary_op >= BINARYOP_ASSIGN && expr_is_vector_index_or_swizzle(exprptr(expr->binary_expr.left)))
+	{
+		c_emit_vector_assign_expr(c, value, expr);
+		return;
+	}
+	if (binary_op > BINARYOP_ASSIGN)
+	{
+		BinaryOp base_op = binaryop_assign_base_op(binary_op);
+		ASSERT(base_op != BINARYOP_ERROR);
+		CValue addr;
+		c_emit_expr(c, &addr, exprptr(expr->binary_expr.left));
+		ASSERT(c_value_is_addr(&addr));
+		c_value_fold_optional(c, &addr);
+		c_emit_binary(c, value, expr, &addr, base_op);
+		c_store(c, &addr, value);
+		return;
+	}
+	if (binary_op == BINARYOP_ASSIGN)
+	{
+		Expr *left = exprptr(expr->binary_expr.left);
+		c_emit_expr(c, value, left);
+		ASSERT(c_value_is_addr(value));
+		const char *optional = NULL;
+		if (left->expr_kind == EXPR_IDENTIFIER)
+		{
+			optional = c_decl_optional_name(c, left->ident_expr);
+			value->kind = CV_ADDRESS;
+		}
+		*value = c_emit_assign_expr(c, value, exprptr(expr->binary_expr.right), optional, false);
+		return;
+	}
+	c_emit_binary(c, value, expr, NULL, binary_op);
+}
+
+static void c_emit_ternary_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *cond = exprptr(expr->ternary_expr.cond);
+	Expr *then_expr = exprptr(expr->ternary_expr.then_expr);
+	Expr *else_expr = exprptr(expr->ternary_expr.else_expr);
+	const char *cond_value = c_emit_expr_rvalue(c, cond);
+	Type *type = type_lowering(expr->type);
+	const char *result = NULL;
+	if (type != type_void)
+	{
+		result = c_temp_name(c);
+		c_emit(c, "%s %s;", c_type_name(c, type), result);
+	}
+	int else_block = c_new_label(c);
+	int phi_block = c_new_label(c);
+	c_emit(c, "if (!%s) goto __L%d;", cond_value, else_block);
+	CValue branch;
+	c_emit_expr(c, &branch, then_expr);
+	c_value_rvalue(c, &branch);
+	if (result && branch.type != type_void) c_emit(c, "%s = %s;", result, branch.value);
+	c_emit_goto(c, phi_block);
+	c_emit_label(c, else_block);
+	c_emit_expr(c, &branch, else_expr);
+	c_value_rvalue(c, &branch);
+	if (result && branch.type != type_void) c_emit(c, "%s = %s;", result, branch.value);
+	c_emit_label(c, phi_block);
+	c_value_set(value, result ? result : "0", type);
+}
+
+// -- Constants
+
+static bool c_type_is_aggregate(Type *type)
+{
+	switch (type_lowering(type)->type_kind)
+	{
+		case TYPE_STRUCT:
+		case TYPE_UNION:
+		case TYPE_ARRAY:
+		case TYPE_VECTOR:
+		case TYPE_SLICE:
+		case TYPE_ANY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static const char *c_zero_value(GenContext *c, Type *type)
+{
+	return str_printf(c_type_is_aggregate(type) ? "((%s){ 0 })" : "((%s)0)", c_type_name(c, type));
+}
+
+/**
+ * Set an undefined value of the type, which is an uninitialized temporary.
+ */
+static void c_value_set_undef(GenContext *c, CValue *value, Type *type)
+{
+	type = type_lowering(type);
+	if (type == type_void)
+	{
+		c_value_set(value, "0", type_void);
+		return;
+	}
+	c_value_set_address_abi_aligned(value, c_temp_alloca(c, type), type);
+}
+
+static const char *c_int128_literal(GenContext *c, Type *type, Int128 value)
+{
+	if (type_size(type) <= 8) return c_const_int(type, value.low);
+	return str_printf("((%s)(((unsigned __int128)0x%llxULL << 64) | 0x%llxULL))", c_type_name(c, type),
+	                  (unsigned long long)value.high, (unsigned long long)value.low);
+}
+
+static const char *c_float_literal(GenContext *c, Type *type, Real f)
+{
+	const char *name = c_type_name(c, type);
+	if (isnan(f)) return str_printf("((%s)__builtin_nan(\"\"))", name);
+	if (isinf(f)) return str_printf("((%s)%s__builtin_inf())", name, f < 0 ? "-" : "");
+	return str_printf("((%s)%a)", name, f);
+}
+
+static const char *c_const_ref(GenContext *c, Decl *decl)
+{
+	decl = decl_flatten(decl);
+	if (decl->decl_kind == DECL_FUNC) return str_printf("((void *)%s)", c_decl_name(c, decl));
+	return str_printf("((void *)&%s)", c_decl_name(c, decl));
+}
+
+/**
+ * A private global holding string data, padded with zeros to at least 'size' bytes.
+ */
+static const char *c_emit_string_global(GenContext *c, const char *str, ArraySize len, ArraySize size)
+{
+	const char *name = str_printf("__c3_str%u", ++c->temp_id);
+	const char *literal = c_string_literal(str, len);
+	cbuffer_printf(&c->decls, "static const char %s[%llu];\n", name, (unsigned long long)size);
+	cbuffer_printf(&c->globals, "static const char %s[%llu] = %s;\n", name, (unsigned long long)size, literal);
+	return name;
+}
+
+static bool c_const_int_value(Expr *expr, Int128 *value)
+{
+	if (!expr_is_const(expr)) return false;
+	switch (expr->const_expr.const_kind)
+	{
+		case CONST_INTEGER:
+			*value = expr->const_expr.ixx.i;
+			return true;
+		case CONST_BOOL:
+			*value = i128_from_unsigned(expr->const_expr.b ? 1 : 0);
+			return true;
+		case CONST_ENUM:
+			*value = i128_from_signed(expr->const_expr.enum_val->enum_constant.ordinal);
+			return true;
+		default:
+			return false;
+	}
+}
+
+static Int128 c_int128_mask_low_bits(Int128 value, unsigned bits)
+{
+	if (bits >= 128) return value;
+	Int128 mask = bits > 64
+			? (Int128) { .high = (1ULL << (bits - 64)) - 1, .low = UINT64_MAX }
+			: (Int128) { .high = 0, .low = bits == 64 ? UINT64_MAX : (1ULL << bits) - 1 };
+	return i128_and(value, mask);
+}
+
+static Int128 c_int128_bswap(Int128 value, unsigned bytes)
+{
+	Int128 result = { 0, 0 };
+	for (unsigned i = 0; i < bytes; i++)
+	{
+		uint64_t byte = i128_lshr64(value, i * 8).low & 0xFF;
+		result = i128_or(result, i128_shl64(i128_from_unsigned(byte), (bytes - 1 - i) * 8));
+	}
+	return result;
+}
+
+/**
+ * Bitstructs with constant members are folded at compile time, either into
+ * the container integer or into the bytes of the container array.
+ */
+static const char *c_emit_const_bitstruct(GenContext *c, ConstInitializer *initializer)
+{
+	Decl *decl = initializer->type->decl;
+	Type *base_type = type_lowering(decl->strukt.container_type->type);
+	if (initializer->kind == CONST_INIT_ZERO) return c_zero_value(c, base_type);
+	Decl **members = decl->strukt.members;
+	ASSERT(vec_size(members) == vec_size(initializer->init_struct));
+	bool bswap = c_bitstruct_requires_bitswap(decl);
+	if (base_type->type_kind == TYPE_ARRAY)
+	{
+		ArraySize len = base_type->array.len;
+		uint8_t *bytes = CALLOC(len);
+		FOREACH_IDX(i, ConstInitializer *, init, initializer->init_struct)
+		{
+			if (init->kind == CONST_INIT_ZERO) continue;
+			ASSERT(init->kind == CONST_INIT_VALUE);
+			Int128 value;
+			if (!c_const_int_value(init->init_value, &value)) return NULL;
+			Decl *member = members[i];
+			unsigned start_bit = member->var.start_bit;
+			unsigned bit_size = member->var.end_bit - start_bit + 1;
+			value = c_int128_mask_low_bits(value, bit_size);
+			if (bswap && bit_size > 8) value = c_int128_bswap(value, bit_size / 8);
+			for (unsigned bit = 0; bit < bit_size; bit++)
+			{
+				if (!(i128_lshr64(value, bit).low & 1)) continue;
+				unsigned pos = start_bit + bit;
+				bytes[pos / 8] |= (uint8_t)(1u << (pos % 8));
+			}
+		}
+		CBuffer buffer = { 0 };
+		cbuffer_append(&buffer, "{ .a = { ");
+		for (ArraySize i = 0; i < len; i++)
+		{
+			cbuffer_printf(&buffer, "%s%u", i ? ", " : "", (unsigned)bytes[i]);
+		}
+		cbuffer_append(&buffer, " } }");
+		const char *result = str_copy(buffer.data, buffer.len);
+		cbuffer_free(&buffer);
+		return result;
+	}
+	TypeSize base_bitsize = type_size(base_type) * 8;
+	Int128 result = { 0, 0 };
+	FOREACH_IDX(i, ConstInitializer *, init, initializer->init_struct)
+	{
+		if (init->kind == CONST_INIT_ZERO) continue;
+		ASSERT(init->kind == CONST_INIT_VALUE);
+		Int128 value;
+		if (!c_const_int_value(init->init_value, &value)) return NULL;
+		Decl *member = members[i];
+		unsigned start_bit = member->var.start_bit;
+		value = c_int128_mask_low_bits(value, member->var.end_bit - start_bit + 1);
+		result = i128_or(result, i128_shl64(value, start_bit));
+	}
+	result = c_int128_mask_low_bits(result, (unsigned)base_bitsize);
+	if (bswap) result = c_int128_bswap(result, (unsigned)(base_bitsize / 8));
+	if (base_bitsize <= 64) return str_printf("((%s)0x%llxULL)", c_type_name(c, base_type), (unsigned long long)result.low);
+	return c_int128_literal(c, base_type, result);
+}
+
+static const char *c_emit_const_slice_global(GenContext *c, ConstInitializer *init)
+{
+	const char *init_str = c_emit_const_initializer(c, init);
+	if (!init_str) return NULL;
+	// Slices may be written through, so unlike other constants this isn't const.
+	const char *name = str_printf("__c3_c%u", ++c->temp_id);
+	const char *type_name = c_type_name(c, init->type);
+	cbuffer_printf(&c->decls, "static %s %s;\n", type_name, name);
+	cbuffer_printf(&c->globals, "static %s %s = %s;\n", type_name, name, init_str);
+	return str_printf("((void *)&%s)", name);
+}
+
+const char *c_emit_const_initializer(GenContext *c, ConstInitializer *const_init)
+{
+	ASSERT(const_init->type == type_flatten(const_init->type));
+	switch (const_init->kind)
+	{
+		case CONST_INIT_ZERO:
+			return c_type_is_aggregate(const_init->type) ? "{ 0 }" : "0";
+		case CONST_INIT_ARRAY_VALUE:
+			UNREACHABLE
+		case CONST_INIT_ARRAY_FULL:
+		{
+			CBuffer buffer = { 0 };
+			cbuffer_append(&buffer, "{ .a = { ");
+			FOREACH_IDX(i, ConstInitializer *, element, const_init->init_array_full)
+			{
+				const char *value = c_emit_const_initializer(c, element);
+				if (!value)
+				{
+					cbuffer_free(&buffer);
+					return NULL;
+				}
+				cbuffer_printf(&buffer, "%s%s", i ? ", " : "", value);
+			}
+			cbuffer_append(&buffer, " } }");
+			const char *result = str_copy(buffer.data, buffer.len);
+			cbuffer_free(&buffer);
+			return result;
+		}
+		case CONST_INIT_ARRAY_BYTES:
+		{
+			Type *element_type = type_lowering(const_init->type->array.base);
+			bool is_bool = element_type == type_bool;
+			CBuffer buffer = { 0 };
+			cbuffer_append(&buffer, "{ .a = { ");
+			for (ArraySize i = 0; i < const_init->type->array.len; i++)
+			{
+				Int value = const_init_bytes_int_at(const_init, i);
+				const char *element = is_bool ? (value.i.low ? "true" : "false") : c_int128_literal(c, element_type, value.i);
+				cbuffer_printf(&buffer, "%s%s", i ? ", " : "", element);
+			}
+			cbuffer_append(&buffer, " } }");
+			const char *result = str_copy(buffer.data, buffer.len);
+			cbuffer_free(&buffer);
+			return result;
+		}
+		case CONST_INIT_ARRAY:
+		{
+			CBuffer buffer = { 0 };
+			cbuffer_append(&buffer, "{ .a = { ");
+			FOREACH_IDX(i, ConstInitializer *, element, const_init->init_array.elements)
+			{
+				ASSERT(element->kind == CONST_INIT_ARRAY_VALUE);
+				const char *value = c_emit_const_initializer(c, element->init_array_value.element);
+				if (!value)
+				{
+					cbuffer_free(&buffer);
+					return NULL;
+				}
+				cbuffer_printf(&buffer, "%s[%llu] = %s", i ? ", " : "",
+				               (unsigned long long)element->init_array_value.index, value);
+			}
+			cbuffer_append(&buffer, " } }");
+			const char *result = str_copy(buffer.data, buffer.len);
+			cbuffer_free(&buffer);
+			return result;
+		}
+		case CONST_INIT_UNION:
+		{
+			const char *value = c_emit_const_initializer(c, const_init->init_union.element);
+			if (!value) return NULL;
+			return str_printf("{ .m%u = %s }", (unsigned)const_init->init_union.index, value);
+		}
+		case CONST_INIT_STRUCT:
+		{
+			if (const_init->type->type_kind == TYPE_BITSTRUCT) return c_emit_const_bitstruct(c, const_init);
+			Decl *decl = const_init->type->decl;
+			Decl **members = decl->strukt.members;
+			unsigned count = vec_size(members);
+			if (decl->decl_kind == DECL_UNION && count) count = 1;
+			CBuffer buffer = { 0 };
+			cbuffer_append(&buffer, "{ ");
+			for (unsigned i = 0; i < count; i++)
+			{
+				if (type_lowering(members[i]->type)->type_kind == TYPE_FLEXIBLE_ARRAY) continue;
+				const char *value = c_emit_const_initializer(c, const_init->init_struct[i]);
+				if (!value)
+				{
+					cbuffer_free(&buffer);
+					return NULL;
+				}
+				cbuffer_printf(&buffer, "%s.m%u = %s", i ? ", " : "", i, value);
+			}
+			cbuffer_append(&buffer, " }");
+			const char *result = str_copy(buffer.data, buffer.len);
+			cbuffer_free(&buffer);
+			return result;
+		}
+		case CONST_INIT_VALUE:
+			return c_emit_const_expr_initializer(c, const_init->init_value);
+	}
+	UNREACHABLE
+}
+
+/**
+ * Return a C constant expression suitable for a static initializer,
+ * or NULL if the value must be computed at runtime.
+ */
+const char *c_emit_const_expr_initializer(GenContext *c, Expr *expr)
+{
+	// An interface to a global is still static data, this matters for tlocals
+	// which cannot use the global constructor.
+	if (expr->expr_kind == EXPR_MAKE_ANY)
+	{
+		const char *ptr = c_emit_const_expr_initializer(c, expr->make_any_expr.inner);
+		const char *typeid = c_emit_const_expr_initializer(c, expr->make_any_expr.typeid);
+		if (!ptr || !typeid) return NULL;
+		return str_printf("{ %s, %s }", ptr, typeid);
+	}
+	if (!expr_is_const(expr)) return NULL;
+	Type *type = type_lowering(expr->type);
+	switch (expr->const_expr.const_kind)
+	{
+		case CONST_REF:
+			return c_const_ref(c, expr->const_expr.global_ref);
+		case CONST_INTEGER:
+			return c_int128_literal(c, type, expr->const_expr.ixx.i);
+		case CONST_FLOAT:
+			return c_float_literal(c, type, expr->const_expr.fxx.f);
+		case CONST_BOOL:
+			return expr->const_expr.b ? "true" : "false";
+		case CONST_POINTER:
+			return str_printf("((void *)(uintptr_t)%lluULL)", (unsigned long long)expr->const_expr.ptr);
+		case CONST_ENUM:
+			return c_const_int(type, expr->const_expr.enum_val->enum_constant.ordinal);
+		case CONST_TYPEID:
+			return c_typeid_value(c, expr->const_expr.typeid);
+		case CONST_FAULT:
+			return c_fault_value(c, expr->const_expr.fault);
+		case CONST_BYTES:
+		case CONST_STRING:
+		{
+			ArraySize len = expr->const_expr.bytes.len;
+			switch (type->type_kind)
+			{
+				case TYPE_ARRAY:
+					return str_printf("{ .a = %s }", c_string_literal(expr->const_expr.bytes.ptr,
+					                                                   len < type->array.len ? len : type->array.len));
+				case TYPE_SLICE:
+					return str_printf("{ %s, %llu }", c_emit_string_ptr(c, expr->const_expr.bytes.ptr, len), (unsigned long long)len);
+				default:
+					return c_emit_string_ptr(c, expr->const_expr.bytes.ptr, len);
+			}
+		}
+		case CONST_INITIALIZER:
+			return c_emit_const_initializer(c, expr->const_expr.initializer);
+		case CONST_SLICE:
+		{
+			ConstInitializer *init = expr->const_expr.slice_init;
+			if (!init) return "{ 0 }";
+			const char *global = c_emit_const_slice_global(c, init);
+			if (!global) return NULL;
+			return str_printf("{ %s, %llu }", global, (unsigned long long)init->type->array.len);
+		}
+		case CONST_MEMBER:
+		case CONST_UNTYPED_LIST:
+			return "0";
+	}
+	UNREACHABLE
+}
+
+static void c_emit_const_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Type *type = type_lowering(expr->type);
+	switch (expr->const_expr.const_kind)
+	{
+		case CONST_REF:
+			c_value_set(value, c_const_ref(c, expr->const_expr.global_ref), expr->type);
+			return;
+		case CONST_INTEGER:
+			c_value_set(value, c_int128_literal(c, type, expr->const_expr.ixx.i), type);
+			return;
+		case CONST_FLOAT:
+			c_value_set(value, c_float_literal(c, type, expr->const_expr.fxx.f), type);
+			return;
+		case CONST_BOOL:
+			c_value_set(value, expr->const_expr.b ? "true" : "false", type_bool);
+			return;
+		case CONST_POINTER:
+			c_value_set(value, str_printf("((void *)(uintptr_t)%lluULL)", (unsigned long long)expr->const_expr.ptr), type);
+			return;
+		case CONST_ENUM:
+			c_value_set(value, c_const_int(type, expr->const_expr.enum_val->enum_constant.ordinal), type);
+			return;
+		case CONST_TYPEID:
+			c_value_set(value, c_typeid_value(c, expr->const_expr.typeid), type_typeid);
+			return;
+		case CONST_FAULT:
+			c_value_set(value, c_fault_value(c, expr->const_expr.fault), type_fault);
+			return;
+		case CONST_BYTES:
+		case CONST_STRING:
+		{
+			ArraySize len = expr->const_expr.bytes.len;
+			if (type->type_kind == TYPE_ARRAY)
+			{
+				ArraySize size = len + 1;
+				if (type->array.len > size) size = type->array.len;
+				const char *global = c_emit_string_global(c, expr->const_expr.bytes.ptr, len, size);
+				c_value_set_address(value, str_printf("((void *)%s)", global), type, 1);
+				return;
+			}
+			const char *ptr = c_emit_string_ptr(c, expr->const_expr.bytes.ptr, len);
+			if (type->type_kind == TYPE_SLICE)
+			{
+				c_value_set(value, str_printf("((__c3_slice){ %s, %llu })", ptr, (unsigned long long)len), type);
+				return;
+			}
+			c_value_set(value, ptr, type);
+			return;
+		}
+		case CONST_INITIALIZER:
+			c_value_set_address_abi_aligned(value, c_temp_alloca(c, type), type);
+			c_emit_const_init_ref(c, value, expr->const_expr.initializer, true);
+			return;
+		case CONST_SLICE:
+		{
+			ConstInitializer *init = expr->const_expr.slice_init;
+			if (!init)
+			{
+				c_value_set(value, c_zero_value(c, type), type);
+				return;
+			}
+			ASSERT(type_is_arraylike(init->type));
+			CValue array;
+			c_value_set_address_abi_aligned(&array, c_temp_alloca(c, init->type), init->type);
+			c_emit_const_init_ref(c, &array, init, true);
+			c_value_set(value, str_printf("((__c3_slice){ %s, %llu })", array.value, (unsigned long long)init->type->array.len), type);
+			return;
+		}
+		case CONST_MEMBER:
+		case CONST_UNTYPED_LIST:
+			// This is valid in the case that this will be discarded anyway.
+			c_value_set(value, "0", type_void);
+			return;
+	}
+	UNREACHABLE
+}
+
+// -- Calls
+
+static Type *c_call_result_type(FunctionPrototype *prototype)
+{
+	if (prototype->is_optional) return prototype->ret_by_ref ? type_lowering(prototype->ret_by_ref_type) : type_void;
+	return type_lowering(prototype->abi_ret_type);
+}
+
+static void c_emit_call_invocation(GenContext *c, CValue *result, FunctionPrototype *prototype, const char *func,
+                                   CValue *values, unsigned value_count, bool no_return)
+{
+	const char *retparam = NULL;
+	if (prototype->ret_by_ref) retparam = c_temp_alloca(c, type_lowering(prototype->ret_by_ref_type));
+	const char **args = NULL;
+	for (unsigned i = 0; i < value_count; i++)
+	{
+		CValue value_copy = values[i];
+		vec_add(args, c_rvalue(c, &value_copy));
+	}
+	CBuffer buffer = { 0 };
+	cbuffer_printf(&buffer, "%s(", func);
+	if (retparam) cbuffer_append(&buffer, retparam);
+	FOREACH_IDX(i, const char *, arg, args)
+	{
+		if (i || retparam) cbuffer_append(&buffer, ", ");
+		cbuffer_append(&buffer, arg);
+	}
+	cbuffer_append(&buffer, ")");
+	const char *call = str_copy(buffer.data, buffer.len);
+	cbuffer_free(&buffer);
+
+	Type *result_type = c_call_result_type(prototype);
+	if (prototype->is_optional)
+	{
+		c_emit_jump_to_optional_exit(c, c_temp_with_value(c, type_fault, call));
+		if (retparam)
+		{
+			c_value_set_address_abi_aligned(result, retparam, result_type);
+		}
+		else
+		{
+			c_value_set(result, "0", type_void);
+		}
+	}
+	else if (result_type == type_void)
+	{
+		c_emit(c, "%s;", call);
+		c_value_set(result, "0", type_void);
+	}
+	else
+	{
+		c_value_set(result, c_temp_with_value(c, result_type, call), result_type);
+	}
+	if (no_return) c_emit(c, "__builtin_unreachable();");
+}
+
+static void c_emit_varargs_expr(GenContext *c, CValue *value, Expr **varargs, Type *param)
+{
+	Type *pointee_type = param->array.base;
+	unsigned elements = vec_size(varargs);
+	Type *array_type = type_get_array(pointee_type, elements);
+	CValue array;
+	c_value_set_address(&array, c_temp_alloca(c, array_type), array_type, type_alloca_alignment(array_type));
+	FOREACH_IDX(i, Expr *, val, varargs)
+	{
+		CValue element;
+		c_emit_expr(c, &element, val);
+		c_value_fold_optional(c, &element);
+		CValue slot;
+		c_value_element_addr(&slot, &array, (ArrayIndex)i, pointee_type);
+		c_store(c, &slot, &element);
+	}
+	c_value_set(value, str_printf("((__c3_slice){ %s, %u })", array.value, elements), param);
+}
+
+static void c_emit_vasplat_expr(GenContext *c, CValue *value, Expr *vasplat, Type *param)
+{
+	c_emit_expr(c, value, vasplat);
+	c_value_fold_optional(c, value);
+	Type *type = value->type;
+	switch (type->type_kind)
+	{
+		case TYPE_ARRAY:
+			c_value_addr(c, value);
+			c_value_set(value, str_printf("((__c3_slice){ %s, %llu })", value->value, (unsigned long long)type->array.len), param);
+			return;
+		case TYPE_POINTER:
+			c_value_rvalue(c, value);
+			c_value_set(value, str_printf("((__c3_slice){ %s, %llu })", value->value, (unsigned long long)type->pointer->array.len), param);
+			return;
+		case TYPE_SLICE:
+			return;
+		default:
+			UNREACHABLE
+	}
+}
+
+static void c_emit_any_pointer(GenContext *c, CValue *any, CValue *pointer)
+{
+	c_value_rvalue(c, any);
+	c_value_set(pointer, str_printf("(%s).ptr", any->value), type_voidptr);
+}
+
+static void c_emit_call_expr(GenContext *c, CValue *result, Expr *expr)
+{
+	if (expr->call_expr.is_builtin)
+	{
+		c_emit_builtin_call(c, result, expr);
+		return;
+	}
+
+	CValue values[256];
+	Expr **args = expr->call_expr.arguments;
+	unsigned arg_count = vec_size(args);
+	FunctionPrototype *prototype;
+	const char *func;
+	if (!expr->call_expr.is_func_ref)
+	{
+		// Call through a pointer.
+		Expr *function = exprptr(expr->call_expr.function);
+		ASSERT(type_flatten(function->type)->type_kind == TYPE_FUNC_PTR);
+		prototype = type_get_resolved_prototype(type_flatten(function->type)->pointer);
+		const char *func_value = c_emit_expr_rvalue(c, function);
+		if (safe_mode_enabled_in(c->cur_func))
+		{
+			scratch_buffer_clear();
+			scratch_buffer_append("Calling null function pointer, '");
+			span_to_scratch(function->span);
+			scratch_buffer_append("' was null.");
+			c_emit_panic_if_true(c, str_printf("%s == 0", func_value), scratch_buffer_copy(), function->span, NULL, NULL, NULL);
+		}
+		func = str_printf("((%s)%s)", c_func_ptr_type_name(c, prototype), func_value);
+	}
+	else
+	{
+		Decl *function_decl = declptr(expr->call_expr.func_ref);
+		prototype = type_get_resolved_prototype(function_decl->type);
+		func = c_decl_name(c, function_decl);
+	}
+	bool no_return = expr->call_expr.no_return;
+
+	Expr *vararg_splat = NULL;
+	Expr **varargs = NULL;
+	if (expr->call_expr.va_is_splat)
+	{
+		vararg_splat = expr->call_expr.vasplat;
+	}
+	else
+	{
+		varargs = expr->call_expr.varargs;
+	}
+
+	for (unsigned i = 0; i < arg_count; i++)
+	{
+		CValue *value_ref = &values[i];
+		Expr *arg = args[i];
+		if (arg)
+		{
+			c_emit_expr(c, value_ref, arg);
+			c_value_fold_optional(c, value_ref);
+			continue;
+		}
+		Type *param = prototype->param_types[i];
+		if (vararg_splat)
+		{
+			c_emit_vasplat_expr(c, value_ref, vararg_splat, param);
+			continue;
+		}
+		if (varargs)
+		{
+			c_emit_varargs_expr(c, value_ref, varargs, param);
+			continue;
+		}
+		// Just set the size to zero.
+		c_value_set(value_ref, c_zero_value(c, param), param);
+	}
+	unsigned value_count = arg_count;
+	// Raw varargs are passed through C's own varargs.
+	if (prototype->raw_variadic && varargs)
+	{
+		FOREACH(Expr *, vararg, varargs)
+		{
+			CValue *value_ref = &values[value_count++];
+			c_emit_expr(c, value_ref, vararg);
+			c_value_fold_optional(c, value_ref);
+		}
+	}
+
+	if (safe_mode_enabled_in(c->cur_func))
+	{
+		c_emit_statement_chain(c, expr->call_expr.function_contracts);
+	}
+
+	if (expr->call_expr.is_dynamic_dispatch)
+	{
+		ASSERT(arg_count);
+		CValue any = values[0];
+		// If the type behind the interface is known, call the method directly.
+		Decl *target_method = expr_find_dynamic_target(args[0], declptr(expr->call_expr.func_ref), c->cur_func);
+		if (target_method)
+		{
+			c_emit_any_pointer(c, &any, &values[0]);
+			prototype = type_get_resolved_prototype(target_method->type);
+			func = c_decl_name(c, target_method);
+			goto CALL;
+		}
+		CValue typeid = any;
+		c_emit_type_from_any(c, &typeid);
+		c_value_rvalue(c, &typeid);
+		CValue pointer;
+		c_emit_any_pointer(c, &any, &pointer);
+		Decl *dyn_fn = declptr(expr->call_expr.func_ref);
+		prototype = type_get_resolved_prototype(dyn_fn->type);
+		const char *found = c_temp_with_value(c, type_voidptr, c_emit_dynamic_search(c, typeid.value, c_decl_name(c, dyn_fn)));
+		func = str_printf("((%s)%s)", c_func_ptr_type_name(c, prototype), found);
+		int match = c_new_label(c);
+		c_emit(c, "if (%s) goto __L%d;", found, match);
+		Decl *default_method = declptrzero(dyn_fn->func_decl.interface_method);
+		if (default_method)
+		{
+			Type *result_type = c_call_result_type(prototype);
+			CValue merged;
+			c_value_set_undef(c, &merged, result_type);
+			int after = c_new_label(c);
+			CValue res;
+			values[0] = any;
+			c_emit_call_invocation(c, &res, type_get_resolved_prototype(default_method->type), c_decl_name(c, default_method),
+			                       values, value_count, no_return);
+			if (result_type != type_void) c_store(c, &merged, &res);
+			c_emit_goto(c, after);
+			c_emit_label(c, match);
+			values[0] = pointer;
+			c_emit_call_invocation(c, &res, prototype, func, values, value_count, no_return);
+			if (result_type != type_void) c_store(c, &merged, &res);
+			c_emit_label(c, after);
+			*result = merged;
+			return;
+		}
+		scratch_buffer_clear();
+		scratch_buffer_printf("No method '%s' could be found on target", dyn_fn->name);
+		c_emit_panic(c, scratch_buffer_copy(), expr->span, NULL, NULL, 0);
+		c_emit_label(c, match);
+		values[0] = pointer;
+	}
+CALL:
+	c_emit_call_invocation(c, result, prototype, func, values, value_count, no_return);
+}
+
+// -- Blocks
+
+static void c_emit_expression_list_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr **list = expr->expression_list;
+	unsigned count = vec_size(list);
+	ASSERT(count);
+	unsigned last = count - 1;
+	for (unsigned i = 0; i < last; i++)
+	{
+		c_emit_ignored_expr(c, list[i]);
+	}
+	c_emit_expr(c, value, list[last]);
+}
+
+static void c_emit_return_block(GenContext *c, CValue *value, Type *type, AstId current, BlockExit **block_exit)
+{
+	Type *type_lowered = type_lowering(type);
+
+	// First case - an empty block
+	if (!current)
+	{
+		c_value_set_undef(c, value, type_lowered);
+		return;
+	}
+
+	Ast *first = astptr(current);
+
+	// Just a return statement, in this case we can just do the expression.
+	if (first->ast_kind == AST_BLOCK_EXIT_STMT && !first->return_stmt.cleanup && !first->return_stmt.cleanup_fail)
+	{
+		Expr *expr = first->return_stmt.expr;
+		if (!expr)
+		{
+			c_value_set(value, "0", type_void);
+			return;
+		}
+		// We can only do this if there is no potential optional
+		if (!type_is_optional(type))
+		{
+			c_emit_expr(c, value, expr);
+			return;
+		}
+	}
+
+	const char *old_ret_out = c->return_out;
+	OptionalCatch old_catch = c->catch;
+	int expr_block = c_new_label(c);
+	BlockExit exit = {
+			.block_return_exit = C_LABEL_TO_PTR(expr_block),
+			.block_optional_exit = C_LABEL_TO_PTR(old_catch.block),
+			.block_error_var = (void *)old_catch.fault,
+			.block_return_out = NULL,
+	};
+	*block_exit = &exit;
+	if (type_lowered != type_void)
+	{
+		exit.block_return_out = (void *)c_temp_alloca(c, type_lowered);
+	}
+	c->catch = (OptionalCatch) { NULL, 0 };
+
+	c_emit_statement_chain(c, current);
+
+	c_emit_label(c, expr_block);
+	if (exit.block_return_out)
+	{
+		c_value_set_address_abi_aligned(value, exit.block_return_out, type_lowered);
+	}
+	else
+	{
+		c_value_set(value, "0", type_void);
+	}
+	c->return_out = old_ret_out;
+	c->catch = old_catch;
+}
+
+static void c_emit_macro_block(GenContext *c, CValue *value, Expr *expr)
+{
+	FOREACH(Decl *, val, expr->macro_block.params)
+	{
+		// Skip vararg
+		if (!val) continue;
+		// In case we have a constant, we never do an emit. The value is already folded.
+		switch (val->var.kind)
+		{
+			case VARDECL_CONST:
+			case VARDECL_GLOBAL:
+			case VARDECL_LOCAL:
+			case VARDECL_MEMBER:
+			case VARDECL_LOCAL_CT:
+			case VARDECL_LOCAL_CT_TYPE:
+			case VARDECL_UNWRAPPED:
+			case VARDECL_REWRAPPED:
+			case VARDECL_ERASE:
+			case VARDECL_BITMEMBER:
+				UNREACHABLE
+			case VARDECL_PARAM_CT:
+			case VARDECL_PARAM_CT_TYPE:
+			case VARDECL_PARAM_EXPR:
+				continue;
+			case VARDECL_PARAM:
+				break;
+		}
+		CValue init;
+		c_emit_expr(c, &init, val->var.init_expr);
+		c_emit_local_var_alloca(c, val);
+		CValue ref;
+		c_value_set_decl(c, &ref, val);
+		ref.kind = CV_ADDRESS;
+		c_store(c, &ref, &init);
+	}
+	c_emit_return_block(c, value, expr->type, expr->macro_block.first_stmt, expr->macro_block.block_exit);
+	if (expr->macro_block.is_noreturn) c_emit(c, "__builtin_unreachable();");
+}
+
+static void c_emit_macro_body_expansion(GenContext *c, CValue *value, Expr *body_expr)
+{
+	Decl **declarations = body_expr->body_expansion_expr.declarations;
+	Expr **values = body_expr->body_expansion_expr.values;
+
+	// Create backend refs on demand.
+	FOREACH_IDX(i, Decl *, decl, declarations)
+	{
+		if (!values[i]) continue;
+		if (!decl->backend_ref) c_emit_local_var_alloca(c, decl);
+	}
+
+	// Set the values
+	FOREACH_IDX(j, Expr *, expr, values)
+	{
+		if (!expr) continue;
+		CValue val;
+		c_emit_expr(c, &val, expr);
+		CValue ref;
+		c_value_set_decl(c, &ref, declarations[j]);
+		ref.kind = CV_ADDRESS;
+		c_store(c, &ref, &val);
+	}
+
+	AstId body = body_expr->body_expansion_expr.first_stmt;
+	if (body) c_emit_stmt(c, astptr(body));
+	c_value_set(value, "0", type_void);
+}
+
+// -- Optionals
+
+static void c_emit_optional(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *fail = expr->inner_expr;
+	// If there is an error value, assign to it.
+	if (c->catch.fault)
+	{
+		const char *fault = c_emit_expr_rvalue(c, fail);
+		c_store_raw(c, c->catch.fault, type_fault, type_abi_alignment(type_fault), fault);
+	}
+	if (c->catch.block)
+	{
+		c_emit_goto(c, c->catch.block);
+	}
+	else
+	{
+		c_emit(c, "__builtin_unreachable();");
+	}
+	// The result is never used, but must still be well formed.
+	c_value_set_undef(c, value, expr->type);
+}
+
+static void c_emit_try_assign_try_catch(GenContext *c, bool is_try, CValue *value, CValue *var_addr, CValue *catch_addr, Expr *rhs)
+{
+	ASSERT(!catch_addr || c_value_is_addr(catch_addr));
+	ASSERT(!var_addr || c_value_is_addr(var_addr));
+
+	int catch_block = c_new_label(c);
+	int end_block = c_new_label(c);
+	const char *result = c_temp_name(c);
+	c_emit(c, "bool %s;", result);
+
+	PUSH_CATCH_VAR_BLOCK(catch_addr ? catch_addr->value : NULL, catch_block);
+	c_emit_expr(c, value, rhs);
+	c_value_fold_optional(c, value);
+	if (var_addr)
+	{
+		ASSERT(is_try && "Storing will only happen on try.");
+		c_store(c, var_addr, value);
+	}
+	POP_CATCH();
+
+	c_emit(c, "%s = %s;", result, is_try ? "true" : "false");
+	c_emit_goto(c, end_block);
+	c_emit_label(c, catch_block);
+	c_emit(c, "%s = %s;", result, is_try ? "false" : "true");
+	c_emit_label(c, end_block);
+	c_value_set(value, result, type_bool);
+}
+
+static void c_emit_try_unwrap(GenContext *c, CValue *value, Expr *expr)
+{
+	if (!expr->try_expr.optional)
+	{
+		const char *fault = c_decl_optional_name(c, expr->try_expr.decl);
+		c_value_set(value, c_temp_with_value(c, type_bool, str_printf("%s == 0", fault)), type_bool);
+		return;
+	}
+	CValue addr;
+	if (expr->try_expr.assign_existing)
+	{
+		Expr *lhs = expr->try_expr.lhs;
+		if (!lhs)
+		{
+			c_emit_try_assign_try_catch(c, true, value, NULL, NULL, expr->try_expr.optional);
+			return;
+		}
+		c_emit_expr(c, &addr, lhs);
+	}
+	else
+	{
+		c_emit_local_decl(c, expr->try_expr.decl, &addr);
+		c_value_set_decl(c, &addr, expr->try_expr.decl);
+		addr.kind = CV_ADDRESS;
+	}
+	ASSERT(c_value_is_addr(&addr));
+	c_emit_try_assign_try_catch(c, true, value, &addr, NULL, expr->try_expr.optional);
+}
+
+static void c_emit_catch_unwrap(GenContext *c, CValue *value, Expr *expr)
+{
+	CValue addr;
+	if (expr->catch_expr.decl)
+	{
+		c_emit_local_decl(c, expr->catch_expr.decl, &addr);
+		c_value_set_decl(c, &addr, expr->catch_expr.decl);
+		addr.kind = CV_ADDRESS;
+	}
+	else
+	{
+		c_value_set_address_abi_aligned(&addr, c_temp_alloca(c, type_fault), type_fault);
+	}
+
+	int catch_block = c_new_label(c);
+	PUSH_CATCH_VAR_BLOCK(addr.value, catch_block);
+	FOREACH(Expr *, e, expr->catch_expr.exprs)
+	{
+		CValue val;
+		c_emit_expr(c, &val, e);
+		c_value_fold_optional(c, &val);
+	}
+	POP_CATCH();
+
+	c_store_raw(c, addr.value, type_fault, addr.alignment, "0");
+	c_emit_label(c, catch_block);
+	c_value_rvalue(c, &addr);
+	c_value_set(value, addr.value, type_fault);
+}
+
+/**
+ * This is the foo! instruction.
+ */
+static void c_emit_rethrow_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	int guard_block = c_new_label(c);
+	int no_err_block = c_new_label(c);
+	const char *error_var = c_temp_alloca(c, type_fault);
+
+	PUSH_CATCH_VAR_BLOCK(error_var, guard_block);
+	c_emit_expr(c, value, expr->rethrow_expr.inner);
+	c_value_fold_optional(c, value);
+	POP_CATCH();
+
+	c_emit_goto(c, no_err_block);
+	c_emit_label(c, guard_block);
+
+	PUSH_DEFER_ERROR(error_var);
+	c_emit_statement_chain(c, expr->rethrow_expr.cleanup);
+	POP_DEFER_ERROR();
+	CValue fault;
+	c_value_set_address_abi_aligned(&fault, error_var, type_fault);
+	if (expr->rethrow_expr.in_block)
+	{
+		BlockExit *exit = *expr->rethrow_expr.in_block;
+		if (exit->block_error_var)
+		{
+			c_store_raw(c, exit->block_error_var, type_fault, type_abi_alignment(type_fault), c_rvalue(c, &fault));
+		}
+		int optional_exit = C_PTR_TO_LABEL(exit->block_optional_exit);
+		if (optional_exit)
+		{
+			c_emit_goto(c, optional_exit);
+		}
+		else
+		{
+			c_emit(c, "__builtin_unreachable();");
+		}
+	}
+	else
+	{
+		c_emit_return_value(c, NULL, &fault);
+	}
+	c_emit_label(c, no_err_block);
+}
+
+/**
+ * This is the foo? instruction.
+ */
+static void c_emit_force_unwrap_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	int panic_block = c_new_label(c);
+	int no_err_block = c_new_label(c);
+	const char *error_var = c_temp_alloca(c, type_fault);
+
+	PUSH_CATCH_VAR_BLOCK(error_var, panic_block);
+	c_emit_expr(c, value, expr->inner_expr);
+	c_value_fold_optional(c, value);
+	POP_CATCH();
+
+	c_emit_goto(c, no_err_block);
+	c_emit_label(c, panic_block);
+	CValue fault_arg;
+	c_value_set_address_abi_aligned(&fault_arg, error_var, type_fault);
+	c_emit_any_from_value(c, &fault_arg, type_fault);
+	c_emit_panic(c, "Force unwrap failed!", expr->span, "Unexpected fault '%s' was unwrapped!", &fault_arg, 1);
+	c_emit_label(c, no_err_block);
+}
+
+static void c_emit_try_unwrap_chain(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr **exprs = expr->try_unwrap_chain_expr;
+	unsigned elements = vec_size(exprs);
+	ASSERT(elements > 0);
+	if (elements == 1)
+	{
+		c_emit_expr(c, value, exprs[0]);
+		return;
+	}
+	const char *result = c_temp_with_value(c, type_bool, "false");
+	int fail_block = c_new_label(c);
+	FOREACH(Expr *, link, exprs)
+	{
+		const char *res = c_emit_expr_rvalue(c, link);
+		c_emit(c, "if (!%s) goto __L%d;", res, fail_block);
+	}
+	c_emit(c, "%s = true;", result);
+	c_emit_label(c, fail_block);
+	c_value_set(value, result, type_bool);
+}
+
+// -- Introspection
+
+static void c_emit_kind_check(GenContext *c, const char *kind, IntrospectType *kinds, unsigned count, const char *error, SourceSpan loc)
+{
+	CBuffer buffer = { 0 };
+	for (unsigned i = 0; i < count; i++)
+	{
+		cbuffer_printf(&buffer, "%s%s != %u", i ? " && " : "", kind, (unsigned)kinds[i]);
+	}
+	const char *cond = str_copy(buffer.data, buffer.len);
+	cbuffer_free(&buffer);
+	c_emit_panic_if_true(c, cond, error, loc, NULL, NULL, NULL);
+}
+
+static void c_emit_typeid_info(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_exprid(c, value, expr->typeid_info_expr.parent);
+	c_value_rvalue(c, value);
+	const char *ref = str_printf("((%s *)(uintptr_t)%s)", c_introspect_type_name(c, 0), value->value);
+	TypeIdInfoKind info_kind = expr->typeid_info_expr.kind;
+	if (info_kind == TYPEID_INFO_PARENTOF)
+	{
+		const char *parent = c_temp_with_value(c, type_typeid, str_printf("%s->parent", ref));
+		c_value_set(value, c_temp_with_value(c, type_typeid, str_printf("%s ? %s : %s", parent, parent, c_typeid_value(c, type_void))),
+		            expr->type);
+		return;
+	}
+	bool safe_mode = safe_mode_enabled_in(c->cur_func);
+	const char *kind = NULL;
+	if (safe_mode || info_kind == TYPEID_INFO_KIND)
+	{
+		kind = c_temp_with_value(c, type_char, str_printf("%s->kind", ref));
+	}
+	switch (info_kind)
+	{
+		case TYPEID_INFO_KIND:
+			c_value_set(value, kind, expr->type);
+			return;
+		case TYPEID_INFO_INNER:
+			if (safe_mode)
+			{
+				IntrospectType checks[8] = { INTROSPECT_TYPE_ARRAY, INTROSPECT_TYPE_POINTER,
+				                             INTROSPECT_TYPE_VECTOR, INTROSPECT_TYPE_ENUM,
+				                             INTROSPECT_TYPE_SLICE, INTROSPECT_TYPE_DISTINCT,
+				                             INTROSPECT_TYPE_OPTIONAL, INTROSPECT_TYPE_BITSTRUCT };
+				c_emit_kind_check(c, kind, checks, 8, "Attempted to access 'inner' on non composite type", expr->span);
+			}
+			c_value_set(value, c_temp_with_value(c, type_typeid, str_printf("%s->inner", ref)), expr->type);
+			return;
+		case TYPEID_INFO_NAMES:
+			if (safe_mode)
+			{
+				IntrospectType checks[1] = { INTROSPECT_TYPE_ENUM };
+				c_emit_kind_check(c, kind, checks, 1, "Attempted to access 'names' on non enum/fault type.", expr->span);
+			}
+			c_value_set(value, c_temp_with_value(c, type_get_slice(type_chars),
+			                                     str_printf("(__c3_slice){ (void *)%s->additional, %s->len }", ref, ref)),
+			            type_get_slice(type_chars));
+			return;
+		case TYPEID_INFO_LEN:
+			if (safe_mode)
+			{
+				IntrospectType checks[4] = { INTROSPECT_TYPE_ARRAY, INTROSPECT_TYPE_VECTOR,
+				                             INTROSPECT_TYPE_ENUM, INTROSPECT_TYPE_SLICE };
+				c_emit_kind_check(c, kind, checks, 4, "Attempted to access 'len' on non array type", expr->span);
+			}
+			c_value_set(value, c_temp_with_value(c, type_usz, str_printf("%s->len", ref)), expr->type);
+			return;
+		case TYPEID_INFO_SIZEOF:
+			c_value_set(value, c_temp_with_value(c, type_usz, str_printf("%s->size", ref)), expr->type);
+			return;
+		case TYPEID_INFO_PARENTOF:
+			UNREACHABLE
+	}
+	UNREACHABLE
+}
+
+static void c_emit_builtin_access(GenContext *c, CValue *value, Expr *expr)
+{
+	Expr *inner = exprptr(expr->builtin_access_expr.inner);
+	c_emit_expr(c, value, inner);
+	c_value_fold_optional(c, value);
+	switch (expr->builtin_access_expr.kind)
+	{
+		case ACCESS_FAULTNAME:
+		{
+			ASSERT(type_no_optional(inner->type)->canonical->type_kind == TYPE_ANYFAULT);
+			c_value_rvalue(c, value);
+			const char *zero = c_temp_alloca(c, type_chars);
+			c_emit(c, "__builtin_memset(%s, 0, sizeof(__c3_slice));", zero);
+			const char *name = c_temp_with_value(c, type_voidptr, str_printf("%s ? (void *)(uintptr_t)%s : %s", value->value, value->value, zero));
+			c_value_set_address_abi_aligned(value, name, type_chars);
+			return;
+		}
+		case ACCESS_ENUMNAME:
+		{
+			Type *inner_type = type_no_optional(inner->type)->canonical;
+			ASSERT(inner_type->type_kind == TYPE_ENUM);
+			c_value_rvalue(c, value);
+			const char *names = str_printf("((void *)((%s *)(uintptr_t)%s)->additional)", c_introspect_type_name(c, 0),
+			                               c_typeid_value(c, inner_type));
+			c_value_set_address_abi_aligned(value, c_element_addr(names, value->value, type_chars), type_chars);
+			return;
+		}
+		case ACCESS_TYPEOFANYFAULT:
+		{
+			c_value_addr(c, value);
+			const char *ptr = c_load_raw(c, value->value, type_voidptr, value->alignment);
+			c_value_set_address(value, ptr, type_typeid, type_alloca_alignment(type_typeid));
+			return;
+		}
+		case ACCESS_TYPEOFANY:
+			c_emit_type_from_any(c, value);
+			return;
+	}
+	UNREACHABLE
+}
+
+// -- Conversions
+
+static const char *c_convert_element(GenContext *c, ExprKind kind, Type *from, Type *to, const char *value, bool is_signed)
+{
+	const char *to_name = c_type_name(c, to);
+	switch (kind)
+	{
+		case EXPR_EXT_TRUNC:
+			if (type_is_float(to)) return str_printf("((%s)(%s))", to_name, value);
+			if (from == type_bool) return str_printf(is_signed ? "((%s)-(int)(%s))" : "((%s)(%s))", to_name, value);
+			{
+				BitSize bits = type_size(from) * 8;
+				Type *via = is_signed ? type_int_signed_by_bitsize(bits) : type_int_unsigned_by_bitsize(bits);
+				return str_printf("((%s)(%s)(%s))", to_name, c_type_name(c, via), value);
+			}
+		case EXPR_PTR_TO_INT:
+			return str_printf("((%s)(uintptr_t)(%s))", to_name, value);
+		case EXPR_INT_TO_PTR:
+			return str_printf("((void *)(uintptr_t)(%s))", value);
+		case EXPR_FLOAT_TO_INT:
+		case EXPR_INT_TO_FLOAT:
+			return str_printf("((%s)(%s))", to_name, value);
+		default:
+			UNREACHABLE
+	}
+}
+
+/**
+ * Convert a scalar, or a vector element by element.
+ */
+static void c_emit_conversion(GenContext *c, CValue *value, Expr *expr, Expr *inner, bool is_signed)
+{
+	c_emit_expr(c, value, inner);
+	c_value_rvalue(c, value);
+	Type *from = value->type;
+	Type *to = type_lowering(expr->type);
+	if (to->type_kind == TYPE_VECTOR)
+	{
+		const char *element = c_convert_element(c, expr->expr_kind, from->array.base, to->array.base,
+		                                        str_printf("%s.a[__i]", value->value), is_signed);
+		c_value_set(value, c_emit_vector_op(c, to, element), to);
+		return;
+	}
+	c_value_set(value, c_temp_with_value(c, to, c_convert_element(c, expr->expr_kind, from, to, value->value, is_signed)), to);
+}
+
+static void c_emit_int_to_bool(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_expr(c, value, expr->int_to_bool_expr.inner);
+	const char *op = expr->int_to_bool_expr.negate ? "==" : "!=";
+	Type *inner_type = value->type;
+	if (inner_type->type_kind == TYPE_ARRAY)
+	{
+		ASSERT(inner_type->array.base == type_char || inner_type->array.base == type_ichar);
+		c_value_addr(c, value);
+		TypeSize len = type_size(inner_type);
+		ASSERT(len > 0);
+		CBuffer buffer = { 0 };
+		for (TypeSize i = 0; i < len; i++)
+		{
+			cbuffer_printf(&buffer, "%s((unsigned char *)%s)[%llu]", i ? " | " : "", value->value, (unsigned long long)i);
+		}
+		const char *total = str_copy(buffer.data, buffer.len);
+		cbuffer_free(&buffer);
+		c_value_set(value, c_temp_with_value(c, type_bool, str_printf("(%s) %s 0", total, op)), expr->type);
+		return;
+	}
+	c_value_rvalue(c, value);
+	Type *type = type_lowering(expr->type);
+	if (type->type_kind == TYPE_VECTOR)
+	{
+		c_value_set(value, c_emit_vector_op(c, type, str_printf("%s.a[__i] %s 0", value->value, op)), type);
+		return;
+	}
+	c_value_set(value, c_temp_with_value(c, type_bool, str_printf("%s %s 0", value->value, op)), expr->type);
+}
+
+static void c_emit_vector_array_conversion(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_expr(c, value, expr->inner_expr);
+	c_value_rvalue(c, value);
+	// Vectors may be larger than the array, so copy element by element.
+	Type *to_type = type_lowering(expr->type);
+	c_value_set(value, c_emit_vector_op(c, to_type, str_printf("%s.a[__i]", value->value)), to_type);
+}
+
+static void c_emit_ptr_access(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_expr(c, value, expr->inner_expr);
+	c_value_fold_optional(c, value);
+	if (value->kind == CV_ADDRESS)
+	{
+		c_value_set_address(value, value->value, expr->type, value->alignment);
+		return;
+	}
+	c_value_set(value, str_printf("(%s).ptr", value->value), expr->type);
+}
+
+static void c_emit_make_any(GenContext *c, CValue *value, Expr *expr)
+{
+	const char *ptr = c_emit_expr_rvalue(c, expr->make_any_expr.inner);
+	const char *typeid = c_emit_expr_rvalue(c, expr->make_any_expr.typeid);
+	c_value_set(value, str_printf("((__c3_any){ %s, %s })", ptr, typeid), expr->type);
+}
+
+static void c_emit_enum_from_ord(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_expr(c, value, expr->inner_expr);
+	if (safe_mode_enabled_in(c->cur_func))
+	{
+		c_value_rvalue(c, value);
+		Decl *decl = type_flatten(expr->type)->decl;
+		unsigned max = vec_size(decl->enums.values);
+		if (type_is_signed(value->type))
+		{
+			scratch_buffer_clear();
+			scratch_buffer_printf("Attempt to convert a negative value (%%d) to enum '%s' failed.", decl->name);
+			c_emit_panic_if_true(c, str_printf("%s < 0", value->value), "Attempt to convert negative value to enum failed.",
+			                     expr->span, scratch_buffer_copy(), value, NULL);
+		}
+		scratch_buffer_clear();
+		scratch_buffer_printf("Attempting to convert %%d to enum '%s' failed as the value exceeds the max ordinal (%u).", decl->name, max - 1);
+		c_emit_panic_if_true(c, str_printf("%s >= %s", value->value, c_const_int(value->type, max)), "Failed integer to enum conversion",
+		                     expr->span, scratch_buffer_copy(), value, NULL);
+	}
+	// We might need to extend or truncate.
+	Type *to_type = type_lowering(expr->type);
+	if (type_size(to_type) != type_size(value->type))
+	{
+		c_value_rvalue(c, value);
+		c_value_set(value, c_temp_with_value(c, to_type, c_convert_element(c, EXPR_EXT_TRUNC, value->type, to_type, value->value, false)), to_type);
+		return;
+	}
+	value->type = to_type;
+}
+
+static void c_emit_scalar_to_vector(GenContext *c, CValue *value, Expr *expr)
+{
+	const char *element = c_emit_expr_rvalue(c, expr->inner_expr);
+	Type *type = type_lowering(expr->type);
+	c_value_set(value, c_emit_vector_op(c, type, element), type);
+}
+
+static void c_emit_slice_to_vec_array(GenContext *c, CValue *value, Expr *expr)
+{
+	const char *slice = c_emit_expr_rvalue(c, expr->inner_expr);
+	Type *to_type = type_lowering(expr->type);
+	const char *temp = c_temp_alloca(c, to_type);
+	c_emit(c, "__builtin_memcpy(%s, (%s).ptr, %llu);", temp, slice,
+	       (unsigned long long)(to_type->array.len * type_size(to_type->array.base)));
+	c_value_set_address_abi_aligned(value, temp, to_type);
+}
+
+static void c_emit_make_slice(GenContext *c, CValue *value, Expr *expr)
+{
+	ArraySize size = expr->make_slice_expr.len;
+	const char *pointer = "0";
+	if (size)
+	{
+		pointer = c_emit_expr_rvalue(c, expr->make_slice_expr.ptr);
+	}
+	else
+	{
+		ASSERT(!expr->make_slice_expr.ptr);
+	}
+	c_value_set(value, str_printf("((__c3_slice){ %s, %llu })", pointer, (unsigned long long)size), expr->type);
+}
+
+static void c_emit_default_arg(GenContext *c, CValue *value, Expr *expr)
+{
+	c_emit_expr(c, value, expr->default_arg_expr.inner);
+	c_value_fold_optional(c, value);
+}
+
+/**
+ * The test and benchmark lists are defined by the runner tables, see c_gen_hook_tables.
+ */
+static void c_emit_hook_global(GenContext *c, CValue *value, Expr *expr, const char *extern_name)
+{
+	const char *name = str_printf("__c3_hook%u", ++c->temp_id);
+	cbuffer_printf(&c->decls, "extern const %s %s %s;\n", c_type_name(c, expr->type), name,
+	               c_asm_label(extern_name, strlen(extern_name)));
+	c_value_set_address_abi_aligned(value, str_printf("((void *)&%s)", name), expr->type);
+}
+
+void c_emit_expr(GenContext *c, CValue *value, Expr *expr)
+{
+	switch (expr->expr_kind)
+	{
+		case NON_RUNTIME_EXPR:
+		case UNRESOLVED_EXPRS:
+		case EXPR_SUBSCRIPT_ASSIGN:
+			// These are folded in the semantic analysis step.
+			UNREACHABLE
+		case EXPR_LAMBDA:
+		case EXPR_COND:
+		case EXPR_ASM:
+		case EXPR_DESIGNATOR:
+		case EXPR_MEMBER_GET:
+		case EXPR_NAMED_ARGUMENT:
+		case EXPR_BUILTIN:
+		case EXPR_OPERATOR_CHARS:
+			UNREACHABLE
+		case EXPR_TWO:
+			c_emit_expr(c, value, expr->two_expr.first);
+			c_emit_expr(c, value, expr->two_expr.last);
+			return;
+		case EXPR_VECTOR_TO_ARRAY:
+		case EXPR_VECTOR_FROM_ARRAY:
+			c_emit_vector_array_conversion(c, value, expr);
+			return;
+		case EXPR_SLICE_TO_VEC_ARRAY:
+			c_emit_slice_to_vec_array(c, value, expr);
+			return;
+		case EXPR_SCALAR_TO_VECTOR:
+			c_emit_scalar_to_vector(c, value, expr);
+			return;
+		case EXPR_MAKE_SLICE:
+			c_emit_make_slice(c, value, expr);
+			return;
+		case EXPR_ENUM_FROM_ORD:
+			c_emit_enum_from_ord(c, value, expr);
+			return;
+		case EXPR_MAKE_ANY:
+			c_emit_make_any(c, value, expr);
+			return;
+		case EXPR_FLOAT_TO_INT:
+		case EXPR_INT_TO_FLOAT:
+		case EXPR_PTR_TO_INT:
+		case EXPR_INT_TO_PTR:
+			c_emit_conversion(c, value, expr, expr->inner_expr, false);
+			return;
+		case EXPR_EXT_TRUNC:
+			c_emit_conversion(c, value, expr, expr->ext_trunc_expr.inner, expr->ext_trunc_expr.is_signed);
+			return;
+		case EXPR_DISCARD:
+			c_emit_ignored_expr(c, expr->inner_expr);
+			c_value_set(value, "0", type_void);
+			return;
+		case EXPR_ADDR_CONVERSION:
+			c_emit_expr(c, value, expr->inner_expr);
+			c_value_addr(c, value);
+			value->type = type_lowering(expr->type);
+			return;
+		case EXPR_RECAST:
+			c_emit_expr(c, value, expr->inner_expr);
+			value->type = type_lowering(expr->type);
+			return;
+		case EXPR_RVALUE:
+			c_emit_expr(c, value, expr->inner_expr);
+			c_value_rvalue(c, value);
+			value->type = type_lowering(expr->type);
+			return;
+		case EXPR_SLICE_LEN:
+			c_emit_expr(c, value, expr->inner_expr);
+			c_emit_slice_len(c, value, value);
+			return;
+		case EXPR_PTR_ACCESS:
+			c_emit_ptr_access(c, value, expr);
+			return;
+		case EXPR_INT_TO_BOOL:
+			c_emit_int_to_bool(c, value, expr);
+			return;
+		case EXPR_DEFAULT_ARG:
+			c_emit_default_arg(c, value, expr);
+			return;
+		case EXPR_SWIZZLE:
+			c_emit_swizzle(c, value, expr);
+			return;
+		case EXPR_BENCHMARK_HOOK:
+			c_emit_hook_global(c, value, expr, expr->benchmark_hook_expr == BUILTIN_DEF_BENCHMARK_FNS
+			                                   ? benchmark_fns_var_name : benchmark_names_var_name);
+			return;
+		case EXPR_TEST_HOOK:
+			c_emit_hook_global(c, value, expr, expr->test_hook_expr == BUILTIN_DEF_TEST_FNS
+			                                   ? test_fns_var_name : test_names_var_name);
+			return;
+		case EXPR_LAST_FAULT:
+			ASSERT(c->defer_error_var);
+			c_value_set_address_abi_aligned(value, c->defer_error_var, type_fault);
+			return;
+		case EXPR_BUILTIN_ACCESS:
+			c_emit_builtin_access(c, value, expr);
+			return;
+		case EXPR_RETVAL:
+			*value = c->retval;
+			return;
+		case EXPR_TRY_UNWRAP_CHAIN:
+			c_emit_try_unwrap_chain(c, value, expr);
+			return;
+		case EXPR_MACRO_BLOCK:
+			c_emit_macro_block(c, value, expr);
+			return;
+		case EXPR_TRY:
+			c_emit_try_unwrap(c, value, expr);
+			return;
+		case EXPR_CATCH:
+			c_emit_catch_unwrap(c, value, expr);
+			return;
+		case EXPR_TYPEID_INFO:
+			c_emit_typeid_info(c, value, expr);
+			return;
+		case EXPR_DECL:
+			c_emit_local_decl(c, expr->decl_expr, value);
+			return;
+		case EXPR_SLICE_COPY:
+			c_emit_slice_copy(c, value, expr);
+			return;
+		case EXPR_SLICE_ASSIGN:
+			c_emit_slice_assign(c, value, expr);
+			return;
+		case EXPR_SLICE:
+			c_emit_slice(c, value, expr);
+			return;
+		case EXPR_POINTER_OFFSET:
+			c_emit_pointer_offset(c, value, expr);
+			return;
+		case EXPR_OPTIONAL:
+			c_emit_optional(c, value, expr);
+			return;
+		case EXPR_NOP:
+			c_value_set(value, "0", type_void);
+			return;
+		case EXPR_INITIALIZER_LIST:
+		case EXPR_DESIGNATED_INITIALIZER_LIST:
+			c_emit_initializer_list_expr(c, value, expr);
+			return;
+		case EXPR_UNARY:
+			c_emit_unary_expr(c, value, expr);
+			return;
+		case EXPR_CONST:
+			c_emit_const_expr(c, value, expr);
+			return;
+		case EXPR_MACRO_BODY_EXPANSION:
+			c_emit_macro_body_expansion(c, value, expr);
+			return;
+		case EXPR_BITASSIGN:
+			c_emit_bitassign_expr(c, value, expr);
+			return;
+		case EXPR_BINARY:
+			c_emit_binary_expr(c, value, expr);
+			return;
+		case EXPR_TERNARY:
+			c_emit_ternary_expr(c, value, expr);
+			return;
+		case EXPR_POST_UNARY:
+			c_emit_post_inc_dec(c, value, expr->unary_expr.expr, expr->unary_expr.operator == UNARYOP_INC ? 1 : -1,
+			                    !expr->unary_expr.no_wrap);
+			return;
+		case EXPR_FORCE_UNWRAP:
+			c_emit_force_unwrap_expr(c, value, expr);
+			return;
+		case EXPR_RETHROW:
+			c_emit_rethrow_expr(c, value, expr);
+			return;
+		case EXPR_IDENTIFIER:
+			c_value_set_decl(c, value, expr->ident_expr);
+			return;
+		case EXPR_SUBSCRIPT:
+			c_emit_subscript(c, value, expr);
+			return;
+		case EXPR_SUBSCRIPT_ADDR:
+			c_emit_subscript_addr(c, value, expr);
+			ASSERT(c_value_is_addr(value));
+			c_value_fold_optional(c, value);
+			value->kind = CV_VALUE;
+			value->type = type_get_ptr(value->type);
+			return;
+		case EXPR_ACCESS_RESOLVED:
+			c_emit_access_addr(c, value, expr);
+			return;
+		case EXPR_CALL:
+			c_emit_call_expr(c, value, expr);
+			return;
+		case EXPR_EXPRESSION_LIST:
+			c_emit_expression_list_expr(c, value, expr);
+			return;
+		case EXPR_BITACCESS:
+			c_emit_bitaccess(c, value, expr);
+			return;
+	}
+	UNREACHABLE
+}
@@ -1 +1,185 @@
+#pragma once
+
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
 #include "codegen_internal.h"
+
+// The C backend emits one C file per module, which is then compiled with
+// the system C compiler. The output only relies on <stdint.h>, <stddef.h>
+// and <stdbool.h> together with a few GNU extensions (asm labels,
+// attributes and __builtin functions), so a GCC compatible compiler is needed.
+//
+// Function bodies are emitted as flat lists of statements using labels
+// and goto, with every intermediate value stored in a temporary. All
+// pointers are void *, and values are loaded and stored through casts
+// to the C type of the C3 type, which has the same size and alignment.
+
+typedef enum
+{
+	CV_VALUE,
+	CV_ADDRESS,
+	CV_ADDRESS_OPTIONAL,
+} CValueKind;
+
+typedef struct
+{
+	CValueKind kind;
+	AlignSize alignment;
+	Type *type;
+	// A C expression without side effects: the value itself, or a void * to it for addresses.
+	const char *value;
+	// An lvalue holding the fault for optional addresses.
+	const char *optional;
+} CValue;
+
+typedef struct
+{
+	// A void * to the fault slot, may be NULL.
+	const char *fault;
+	// The label to jump to on a fault.
+	int block;
+} OptionalCatch;
+
+typedef struct
+{
+	char *data;
+	size_t len;
+	size_t capacity;
+} CBuffer;
+
+typedef struct
+{
+	Module *code_module;
+	// Typedefs, in the order they are needed.
+	CBuffer types;
+	// Forward declarations of functions and globals.
+	CBuffer decls;
+	// Global definitions.
+	CBuffer globals;
+	// Function definitions.
+	CBuffer functions;
+	// The body of the current function.
+	CBuffer body;
+	// Type -> C type name
+	HTable type_names;
+	// Decl -> C identifier, for globals, functions and faults.
+	HTable decl_names;
+	// Type -> C identifier of the introspection global.
+	HTable typeid_names;
+	// Selector names -> C identifier.
+	HTable selector_names;
+	// Raw function type -> C function pointer typedef.
+	HTable func_types;
+	// Number of additional slots -> introspection struct typedef.
+	HTable introspect_types;
+	unsigned temp_id;
+	Decl *cur_func;
+	const char *cur_func_name;
+	FunctionPrototype *cur_proto;
+	// The out parameter for the return value of optional functions.
+	const char *return_out;
+	OptionalCatch catch;
+	const char *defer_error_var;
+	CValue retval;
+	Decl **dynamic_functions;
+	// Globals with initializers that can't be expressed as C constants.
+	Decl **dynamic_inits;
+	bool weaken;
+	bool needs_dyn_search;
+} GenContext;
+
+#define PUSH_CATCH() OptionalCatch _old_catch = c->catch
+#define PUSH_CATCH_VAR_BLOCK(fault_, block_) OptionalCatch _old_catch = c->catch; c->catch = (OptionalCatch) { fault_, block_ }
+#define PUSH_CLEAR_CATCH() OptionalCatch _old_catch = c->catch; c->catch = (OptionalCatch) { NULL, 0 }
+#define POP_CATCH() c->catch = _old_catch
+#define PUSH_DEFER_ERROR(val__) const char *def_err__ = c->defer_error_var; c->defer_error_var = val__
+#define POP_DEFER_ERROR() c->defer_error_var = def_err__
+
+// Labels are stored in AST codegen slots as pointer sized integers.
+#define C_LABEL_TO_PTR(label__) ((void *)(intptr_t)(label__))
+#define C_PTR_TO_LABEL(ptr__) ((int)(intptr_t)(ptr__))
+
+// -- Output
+void cbuffer_printf(CBuffer *buffer, const char *format, ...);
+void cbuffer_append(CBuffer *buffer, const char *string);
+void cbuffer_append_len(CBuffer *buffer, const char *string, size_t len);
+void cbuffer_free(CBuffer *buffer);
+void c_emit(GenContext *c, const char *format, ...);
+const char *c_temp_name(GenContext *c);
+int c_new_label(GenContext *c);
+void c_emit_label(GenContext *c, int label);
+void c_emit_goto(GenContext *c, int label);
+const char *c_string_literal(const char *str, size_t len);
+const char *c_asm_label(const char *name, size_t len);
+const char *c_emit_string_ptr(GenContext *c, const char *str, size_t len);
+const char *c_emit_const_global(GenContext *c, Type *type, const char *init);
+
+// -- Types and symbols
+const char *c_sanitized_name(const char *name);
+const char *c_type_name(GenContext *c, Type *type);
+const char *c_func_ptr_type_name(GenContext *c, FunctionPrototype *prototype);
+const char *c_decl_name(GenContext *c, Decl *decl);
+const char *c_decl_optional_name(GenContext *c, Decl *decl);
+const char *c_typeid_value(GenContext *c, Type *type);
+const char *c_introspect_type_name(GenContext *c, unsigned additional);
+const char *c_emit_dynamic_search(GenContext *c, const char *typeid, const char *selector);
+const char *c_selector_name(GenContext *c, const char *name);
+const char *c_fault_value(GenContext *c, Decl *decl);
+const char *c_enum_associated_name(GenContext *c, Decl *enum_decl, Decl *associated);
+void c_emit_local_static(GenContext *c, Decl *decl, CValue *value);
+
+// -- Values
+void c_value_set(CValue *value, const char *val, Type *type);
+void c_value_set_address(CValue *value, const char *addr, Type *type, AlignSize alignment);
+void c_value_set_address_abi_aligned(CValue *value, const char *addr, Type *type);
+void c_value_set_decl(GenContext *c, CValue *value, Decl *decl);
+void c_value_rvalue(GenContext *c, CValue *value);
+void c_value_addr(GenContext *c, CValue *value);
+void c_value_fold_optional(GenContext *c, CValue *value);
+const char *c_temp_with_value(GenContext *c, Type *type, const char *value);
+const char *c_temp_alloca(GenContext *c, Type *type);
+const char *c_offset_addr(const char *addr, ArraySize offset);
+void c_store(GenContext *c, CValue *destination, CValue *value);
+void c_store_raw(GenContext *c, const char *addr, Type *type, AlignSize alignment, const char *value);
+void c_store_zero(GenContext *c, CValue *ref);
+const char *c_load_raw(GenContext *c, const char *addr, Type *type, AlignSize alignment);
+const char *c_const_int(Type *type, uint64_t value);
+void c_emit_jump_to_optional_exit(GenContext *c, const char *fault);
+void c_emit_panic(GenContext *c, const char *message, SourceSpan loc, const char *fmt, CValue *args, unsigned arg_count);
+void c_emit_panic_if_true(GenContext *c, const char *cond, const char *message, SourceSpan loc, const char *fmt, CValue *arg1, CValue *arg2);
+void c_emit_any_from_value(GenContext *c, CValue *value, Type *type);
+
+// -- Expressions
+void c_emit_expr(GenContext *c, CValue *value, Expr *expr);
+void c_emit_exprid(GenContext *c, CValue *value, ExprId expr);
+const char *c_emit_expr_rvalue(GenContext *c, Expr *expr);
+const char *c_emit_vector_op(GenContext *c, Type *type, const char *element_expr);
+CValue c_emit_assign_expr(GenContext *c, CValue *ref, Expr *expr, const char *optional, bool is_init);
+void c_emit_lhs_is_subtype(GenContext *c, CValue *result, CValue *lhs, CValue *rhs);
+void c_emit_ignored_expr(GenContext *c, Expr *expr);
+void c_emit_local_var_alloca(GenContext *c, Decl *decl);
+void c_emit_local_decl(GenContext *c, Decl *decl, CValue *value);
+const char *c_emit_const_initializer(GenContext *c, ConstInitializer *init);
+const char *c_emit_const_expr_initializer(GenContext *c, Expr *expr);
+void c_emit_comp(GenContext *c, CValue *result, CValue *lhs, CValue *rhs, BinaryOp op);
+void c_emit_builtin_call(GenContext *c, CValue *result, Expr *expr);
+
+// -- Statements
+void c_emit_stmt(GenContext *c, Ast *ast);
+void c_emit_statement_chain(GenContext *c, AstId current);
+void c_emit_return_implicit(GenContext *c);
+void c_emit_return_value(GenContext *c, CValue *value, CValue *fault);
+void c_emit_function_body(GenContext *c, Decl *decl);
+
+INLINE bool c_value_is_addr(CValue *value)
+{
+	return value->kind != CV_VALUE;
+}
+
+INLINE const char *c_rvalue(GenContext *c, CValue *value)
+{
+	c_value_rvalue(c, value);
+	return value->value;
+}
@@ -0,0 +1,767 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
+#include "c_codegen_internal.h"
+
+void c_emit_statement_chain(GenContext *c, AstId current)
+{
+	while (current)
+	{
+		c_emit_stmt(c, ast_next(&current));
+	}
+}
+
+void c_emit_local_var_alloca(GenContext *c, Decl *decl)
+{
+	ASSERT(!decl->var.is_static && decl->var.kind != VARDECL_CONST);
+	Type *type = type_lowering(decl->type);
+	const char *name = str_printf("%s_%u", c_sanitized_name(decl->name), ++c->temp_id);
+	AlignSize alignment = decl->alignment ? decl->alignment : type_alloca_alignment(type);
+	c_emit(c, "%s %s __attribute__((aligned(%u)));", c_type_name(c, type), name, (unsigned)alignment);
+	decl->backend_ref = (void *)name;
+}
+
+/**
+ * This emits a local declaration.
+ */
+void c_emit_local_decl(GenContext *c, Decl *decl, CValue *value)
+{
+	switch (decl->var.kind)
+	{
+		case VARDECL_CONST:
+			c_emit_local_static(c, decl, value);
+			return;
+		case VARDECL_LOCAL:
+			if (decl->var.is_static)
+			{
+				c_emit_local_static(c, decl, value);
+				return;
+			}
+			break;
+		case VARDECL_PARAM_CT:
+		case VARDECL_PARAM_CT_TYPE:
+		case VARDECL_PARAM_EXPR:
+		case VARDECL_GLOBAL:
+		case VARDECL_MEMBER:
+		case VARDECL_BITMEMBER:
+			UNREACHABLE;
+		case VARDECL_PARAM:
+		{
+			CValue init;
+			c_emit_expr(c, &init, decl->var.init_expr);
+			c_emit_local_var_alloca(c, decl);
+			c_value_set_decl(c, value, decl);
+			value->kind = CV_ADDRESS;
+			c_store(c, value, &init);
+			return;
+		}
+		case VARDECL_UNWRAPPED:
+		case VARDECL_ERASE:
+		case VARDECL_REWRAPPED:
+			return;
+		case VARDECL_LOCAL_CT:
+		case VARDECL_LOCAL_CT_TYPE:
+			UNREACHABLE
+	}
+
+	ASSERT(!decl->backend_ref);
+	Type *var_type = type_lowering(decl->type);
+	c_emit_local_var_alloca(c, decl);
+
+	// Create optional storage
+	bool is_optional = IS_OPTIONAL(decl);
+	if (is_optional)
+	{
+		const char *fault = str_printf("%s_f", (const char *)decl->backend_ref);
+		c_emit(c, "%s %s;", c_type_name(c, type_fault), fault);
+		decl->var.optional_ref = (void *)fault;
+	}
+
+	Expr *init = decl->var.init_expr;
+	if (init)
+	{
+		c_value_set_decl(c, value, decl);
+		value->kind = CV_ADDRESS;
+		CValue res = c_emit_assign_expr(c, value, init, decl->var.optional_ref, true);
+		if (!is_optional && res.value) *value = res;
+		return;
+	}
+
+	// A no-init variable is simply left uninitialized.
+	c_value_set_decl(c, value, decl);
+	value->kind = CV_ADDRESS;
+	if (decl->var.no_init) return;
+
+	// Normal case, zero init.
+	if (is_optional) c_emit(c, "%s = 0;", (const char *)decl->var.optional_ref);
+	c_store_zero(c, value);
+	ASSERT(var_type != type_void);
+}
+
+/**
+ * Emit the 'cond' in something like: "while (int a = foo(), int bar = a * a, bar > baz)"
+ * But also the switch value in switches.
+ */
+static void c_emit_cond(GenContext *c, CValue *value, Expr *expr)
+{
+	ASSERT(expr->expr_kind == EXPR_COND);
+	unsigned size = vec_size(expr->cond_expr);
+
+	// First emit everything up to the last element.
+	unsigned last_index = size - 1;
+	for (unsigned i = 0; i < last_index; i++)
+	{
+		CValue discard;
+		c_emit_expr(c, &discard, expr->cond_expr[i]);
+	}
+
+	// Emit the last element.
+	Expr *last = expr->cond_expr[last_index];
+	c_emit_expr(c, value, last);
+
+	// If it is a declaration, set it to the address of the variable.
+	if (last->expr_kind == EXPR_DECL)
+	{
+		c_value_set_decl(c, value, last->decl_expr);
+		value->kind = CV_ADDRESS;
+	}
+}
+
+void c_emit_return_value(GenContext *c, CValue *value, CValue *fault)
+{
+	FunctionPrototype *prototype = c->cur_proto;
+
+	// If there is no prototype, this is a static initializer.
+	if (!prototype)
+	{
+		c_emit(c, "return;");
+		return;
+	}
+
+	// Optionals return the fault, and pass the value through the return parameter.
+	if (prototype->is_optional)
+	{
+		if (value && value->type != type_void)
+		{
+			ASSERT(c->return_out);
+			c_store_raw(c, c->return_out, value->type, type_alloca_alignment(value->type), c_rvalue(c, value));
+		}
+		c_emit(c, "return %s;", fault ? c_rvalue(c, fault) : "0");
+		return;
+	}
+	if (!value || type_lowering(prototype->abi_ret_type) == type_void)
+	{
+		c_emit(c, "return;");
+		return;
+	}
+	c_emit(c, "return %s;", c_rvalue(c, value));
+}
+
+void c_emit_return_implicit(GenContext *c)
+{
+	Type *rtype_real = c->cur_proto ? c->cur_proto->rtype : type_void;
+	if (type_lowering(type_no_optional(rtype_real)) != type_void)
+	{
+		c_emit(c, "__builtin_unreachable();");
+		return;
+	}
+	c_emit_return_value(c, NULL, NULL);
+}
+
+static void c_emit_return(GenContext *c, Ast *ast)
+{
+	Expr *expr = ast->return_stmt.expr;
+	if (expr && expr->expr_kind == EXPR_OPTIONAL)
+	{
+		CValue value;
+		c_emit_expr(c, &value, expr->inner_expr);
+		if (ast->return_stmt.cleanup_fail)
+		{
+			const char *error_out = c_temp_alloca(c, type_fault);
+			c_store_raw(c, error_out, type_fault, type_abi_alignment(type_fault), c_rvalue(c, &value));
+			PUSH_DEFER_ERROR(error_out);
+			c_emit_statement_chain(c, ast->return_stmt.cleanup_fail);
+			POP_DEFER_ERROR();
+			c_value_set_address_abi_aligned(&value, error_out, type_fault);
+		}
+		c_emit_return_value(c, NULL, &value);
+		return;
+	}
+
+	PUSH_CATCH();
+
+	int error_return_block = 0;
+	const char *error_out = NULL;
+	if (c->cur_proto && type_is_optional(c->cur_proto->rtype))
+	{
+		error_return_block = c_new_label(c);
+		error_out = c_temp_alloca(c, type_fault);
+		c->catch = (OptionalCatch) { error_out, error_return_block };
+	}
+
+	bool has_return_value = expr != NULL;
+	CValue return_value = { 0 };
+	if (has_return_value)
+	{
+		c_emit_expr(c, &return_value, expr);
+		c_value_fold_optional(c, &return_value);
+		c->retval = return_value;
+	}
+
+	POP_CATCH();
+
+	if (ast->return_stmt.cleanup || ast->return_stmt.cleanup_fail)
+	{
+		// Snapshot the value, the defers might change what it refers to.
+		if (has_return_value && return_value.type != type_void)
+		{
+			c_value_set(&return_value, c_temp_with_value(c, return_value.type, c_rvalue(c, &return_value)), return_value.type);
+		}
+		c_emit_statement_chain(c, ast->return_stmt.cleanup);
+	}
+
+	if (has_return_value)
+	{
+		c_emit_return_value(c, &return_value, NULL);
+	}
+	else
+	{
+		c_emit_return_implicit(c);
+	}
+
+	if (error_return_block)
+	{
+		c_emit_label(c, error_return_block);
+		PUSH_DEFER_ERROR(error_out);
+		c_emit_statement_chain(c, ast->return_stmt.cleanup_fail);
+		POP_DEFER_ERROR();
+		CValue value;
+		c_value_set_address_abi_aligned(&value, error_out, type_fault);
+		c_emit_return_value(c, NULL, &value);
+	}
+}
+
+static void c_emit_block_exit_return(GenContext *c, Ast *ast)
+{
+	BlockExit *exit = *ast->return_stmt.block_exit_ref;
+
+	PUSH_CATCH_VAR_BLOCK((const char *)exit->block_error_var, C_PTR_TO_LABEL(exit->block_optional_exit));
+
+	int err_cleanup_block = 0;
+	Expr *ret_expr = ast->return_stmt.expr;
+
+	CValue return_value = { 0 };
+	if (ret_expr)
+	{
+		if (ast->return_stmt.cleanup_fail && IS_OPTIONAL(ret_expr))
+		{
+			ASSERT(c->catch.block);
+			err_cleanup_block = c_new_label(c);
+			c->catch.block = err_cleanup_block;
+		}
+		c_emit_expr(c, &return_value, ret_expr);
+		c_value_fold_optional(c, &return_value);
+	}
+
+	POP_CATCH();
+
+	AstId cleanup = ast->return_stmt.cleanup;
+	AstId cleanup_fail = ast->return_stmt.cleanup_fail;
+	AstId err_cleanup = err_cleanup_block && cleanup_fail ? astid(copy_ast_defer(astptr(cleanup_fail))) : 0;
+	if (exit->block_return_out && return_value.value && return_value.type != type_void)
+	{
+		c_store_raw(c, exit->block_return_out, return_value.type, type_alloca_alignment(return_value.type),
+		            c_rvalue(c, &return_value));
+	}
+	c_emit_statement_chain(c, cleanup);
+	c_emit_goto(c, C_PTR_TO_LABEL(exit->block_return_exit));
+
+	if (err_cleanup_block)
+	{
+		c_emit_label(c, err_cleanup_block);
+		PUSH_DEFER_ERROR((const char *)exit->block_error_var);
+		c_emit_statement_chain(c, err_cleanup);
+		POP_DEFER_ERROR();
+		c_emit_goto(c, C_PTR_TO_LABEL(exit->block_optional_exit));
+	}
+}
+
+static void c_emit_if_stmt(GenContext *c, Ast *ast)
+{
+	// Read everything before the codegen fields overwrite them.
+	Ast *then_body = astptr(ast->if_stmt.then_body);
+	AstId else_id = ast->if_stmt.else_body;
+	Ast *else_body = else_id ? astptr(else_id) : NULL;
+	Expr *cond = exprptr(ast->if_stmt.cond);
+
+	int exit_block = c_new_label(c);
+	int else_block = ast_is_not_empty(else_body) ? c_new_label(c) : exit_block;
+	ast->if_stmt.codegen.break_block = C_LABEL_TO_PTR(exit_block);
+	Decl *label = declptrzero(ast->if_stmt.flow.label);
+	if (label) label->label.break_target = C_LABEL_TO_PTR(exit_block);
+
+	CValue value;
+	c_emit_cond(c, &value, cond);
+	const char *cond_value = c_rvalue(c, &value);
+	c_emit(c, "if (!%s) goto __L%d;", cond_value, else_block);
+
+	if (ast_is_not_empty(then_body)) c_emit_stmt(c, then_body);
+	if (else_block != exit_block)
+	{
+		c_emit_goto(c, exit_block);
+		c_emit_label(c, else_block);
+		c_emit_stmt(c, else_body);
+	}
+	c_emit_label(c, exit_block);
+}
+
+typedef enum
+{
+	LOOP_NORMAL,
+	LOOP_INFINITE,
+	LOOP_NONE
+} LoopType;
+
+static inline LoopType loop_type_for_cond(Expr *cond, bool do_while)
+{
+	if (!cond)
+	{
+		// We may have do-while (0)
+		if (do_while) return LOOP_NONE;
+
+		// OR we have for (int x;;x++)
+		return LOOP_INFINITE;
+	}
+
+	// Fold simple conds
+	if (cond->expr_kind == EXPR_COND && vec_size(cond->cond_expr) == 1)
+	{
+		cond = cond->cond_expr[0];
+	}
+
+	// Do we have a constant cond?
+	if (expr_is_const(cond))
+	{
+		ASSERT(cond->const_expr.const_kind == CONST_BOOL);
+		// The result is either infinite or no loop
+		return cond->const_expr.b ? LOOP_INFINITE : LOOP_NONE;
+	}
+
+	// Otherwise we have a normal loop.
+	return LOOP_NORMAL;
+}
+
+static void c_emit_for_stmt(GenContext *c, Ast *ast)
+{
+	// First, emit all inits.
+	if (ast->for_stmt.init)
+	{
+		c_emit_ignored_expr(c, exprptr(ast->for_stmt.init));
+	}
+	ExprId incr = ast->for_stmt.incr;
+	Ast *body = astptr(ast->for_stmt.body);
+	bool has_body = ast_is_not_empty(body);
+	bool skip_first = ast->for_stmt.flow.skip_first;
+	ExprId cond_id = ast->for_stmt.cond;
+	Expr *cond = cond_id ? exprptr(cond_id) : NULL;
+	LoopType loop = loop_type_for_cond(cond, skip_first);
+
+	if (!incr && !has_body && loop != LOOP_NORMAL)
+	{
+		if (loop == LOOP_INFINITE) c_emit_panic(c, "Infinite loop found", ast->span, NULL, NULL, 0);
+		return;
+	}
+
+	int start_block = c_new_label(c);
+	int body_block = loop == LOOP_NORMAL ? c_new_label(c) : start_block;
+	int inc_block = incr ? c_new_label(c) : 0;
+	int exit_block = c_new_label(c);
+
+	// Break always jumps out, continue goes to the inc, or the
+	// start of the loop, or the exit if this is not looping.
+	int continue_block = inc_block;
+	if (!continue_block) continue_block = loop == LOOP_NONE ? exit_block : start_block;
+	ast->for_stmt.codegen.continue_block = C_LABEL_TO_PTR(continue_block);
+	ast->for_stmt.codegen.exit_block = C_LABEL_TO_PTR(exit_block);
+
+	if (loop == LOOP_NORMAL)
+	{
+		// Do-while semantics skip the initial cond.
+		if (skip_first) c_emit_goto(c, body_block);
+		c_emit_label(c, start_block);
+		CValue value;
+		ASSERT(cond);
+		if (cond->expr_kind == EXPR_COND)
+		{
+			c_emit_cond(c, &value, cond);
+		}
+		else
+		{
+			c_emit_expr(c, &value, cond);
+		}
+		const char *cond_value = c_rvalue(c, &value);
+		c_emit(c, "if (!%s) goto __L%d;", cond_value, exit_block);
+	}
+	c_emit_label(c, body_block);
+	if (has_body) c_emit_stmt(c, body);
+	if (incr)
+	{
+		c_emit_label(c, inc_block);
+		c_emit_ignored_expr(c, exprptr(incr));
+	}
+	if (loop != LOOP_NONE) c_emit_goto(c, start_block);
+	c_emit_label(c, exit_block);
+}
+
+static const char *c_emit_case_value(GenContext *c, ExprId expr)
+{
+	CValue value;
+	c_emit_exprid(c, &value, expr);
+	return c_rvalue(c, &value);
+}
+
+static void c_emit_switch_body_if_chain(GenContext *c, Ast **cases, Ast *default_case, CValue *switch_value,
+                                        int exit_block, bool is_type_switch)
+{
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		if (case_stmt == default_case) continue;
+		CValue value;
+		c_emit_exprid(c, &value, case_stmt->case_stmt.expr);
+		c_value_rvalue(c, &value);
+		CValue equals;
+		ExprId to_expr = case_stmt->case_stmt.to_expr;
+		if (to_expr)
+		{
+			ASSERT(!is_type_switch);
+			CValue to_value;
+			c_emit_exprid(c, &to_value, to_expr);
+			c_value_rvalue(c, &to_value);
+			CValue le;
+			c_emit_comp(c, &le, &value, switch_value, BINARYOP_LE);
+			CValue ge;
+			c_emit_comp(c, &ge, &to_value, switch_value, BINARYOP_GE);
+			c_value_set(&equals, str_printf("(%s && %s)", c_rvalue(c, &le), c_rvalue(c, &ge)), type_bool);
+		}
+		else if (is_type_switch)
+		{
+			c_emit_lhs_is_subtype(c, &equals, &value, switch_value);
+		}
+		else
+		{
+			c_emit_comp(c, &equals, &value, switch_value, BINARYOP_EQ);
+		}
+		c_emit(c, "if (%s) goto __L%d;", c_rvalue(c, &equals), C_PTR_TO_LABEL(case_stmt->case_stmt.backend_block));
+	}
+	c_emit_goto(c, default_case ? C_PTR_TO_LABEL(default_case->case_stmt.backend_block) : exit_block);
+}
+
+/**
+ * Integer and enum switches with constant cases map directly onto a C switch,
+ * leaving jump tables and search trees to the C compiler.
+ */
+static void c_emit_switch_body_native(GenContext *c, Ast **cases, Ast *default_case, CValue *switch_value, int exit_block)
+{
+	CBuffer buffer = { 0 };
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		if (case_stmt == default_case) continue;
+		int target = C_PTR_TO_LABEL(case_stmt->case_stmt.backend_block);
+		const char *from = c_emit_case_value(c, case_stmt->case_stmt.expr);
+		if (case_stmt->case_stmt.to_expr)
+		{
+			cbuffer_printf(&buffer, "\tcase %s ... %s: goto __L%d;\n", from, c_emit_case_value(c, case_stmt->case_stmt.to_expr), target);
+			continue;
+		}
+		cbuffer_printf(&buffer, "\tcase %s: goto __L%d;\n", from, target);
+	}
+	c_emit(c, "switch (%s)", c_rvalue(c, switch_value));
+	c_emit(c, "{");
+	if (buffer.data) cbuffer_append(&c->body, buffer.data);
+	c_emit(c, "\tdefault: goto __L%d;", default_case ? C_PTR_TO_LABEL(default_case->case_stmt.backend_block) : exit_block);
+	c_emit(c, "}");
+	cbuffer_free(&buffer);
+}
+
+static void c_emit_switch_body(GenContext *c, CValue *switch_value, Ast *switch_ast, bool is_typeid)
+{
+	bool is_if_chain = switch_ast->switch_stmt.flow.if_chain;
+	Type *switch_type = switch_value->type;
+	Ast **cases = switch_ast->switch_stmt.cases;
+	unsigned case_count = vec_size(cases);
+	if (!case_count)
+	{
+		// No body or default is empty, just exit after the value.
+		return;
+	}
+
+	Ast *default_case = NULL;
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		case_stmt->case_stmt.backend_block = NULL;
+		if (!case_stmt->case_stmt.expr) default_case = case_stmt;
+		if (case_stmt->case_stmt.body) case_stmt->case_stmt.backend_block = C_LABEL_TO_PTR(c_new_label(c));
+	}
+
+	int exit_block = c_new_label(c);
+	int switch_block = c_new_label(c);
+	SwitchCodegen codegen = { .exit_block = C_LABEL_TO_PTR(exit_block), .retry.block = C_LABEL_TO_PTR(switch_block) };
+	switch_ast->switch_stmt.codegen = &codegen;
+
+	// Empty cases fall through to the next case with a body.
+	void *next_block = C_LABEL_TO_PTR(exit_block);
+	for (unsigned i = case_count; i > 0; i--)
+	{
+		Ast *case_stmt = cases[i - 1];
+		if (case_stmt->case_stmt.backend_block)
+		{
+			next_block = case_stmt->case_stmt.backend_block;
+			continue;
+		}
+		case_stmt->case_stmt.backend_block = next_block;
+	}
+
+	CValue switch_var;
+	c_value_set_address_abi_aligned(&switch_var, c_temp_alloca(c, switch_type), switch_type);
+	codegen.retry.var = &switch_var;
+	c_store(c, &switch_var, switch_value);
+
+	c_emit_label(c, switch_block);
+	CValue switch_current_val = switch_var;
+	c_value_rvalue(c, &switch_current_val);
+
+	if (is_if_chain)
+	{
+		c_emit_switch_body_if_chain(c, cases, default_case, &switch_current_val, exit_block, is_typeid);
+	}
+	else
+	{
+		c_emit_switch_body_native(c, cases, default_case, &switch_current_val, exit_block);
+	}
+
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		Ast *body = case_stmt->case_stmt.body;
+		if (!body) continue;
+		c_emit_label(c, C_PTR_TO_LABEL(case_stmt->case_stmt.backend_block));
+		c_emit_stmt(c, body);
+		c_emit_goto(c, exit_block);
+	}
+	c_emit_label(c, exit_block);
+}
+
+static void c_emit_switch(GenContext *c, Ast *ast)
+{
+	CValue switch_value;
+	Expr *expr = exprptrzero(ast->switch_stmt.cond);
+	bool is_typeid = expr && expr->type->canonical == type_typeid;
+	if (expr)
+	{
+		// Regular switch
+		c_emit_cond(c, &switch_value, expr);
+		c_value_rvalue(c, &switch_value);
+	}
+	else
+	{
+		// Match switch, so set the value to true
+		c_value_set(&switch_value, "true", type_bool);
+	}
+	c_emit_switch_body(c, &switch_value, ast, is_typeid);
+}
+
+static void c_emit_break(GenContext *c, Ast *ast)
+{
+	c_emit_statement_chain(c, ast->contbreak_stmt.defers);
+	Ast *jump_target = astptr(ast->contbreak_stmt.ast);
+	void *jump;
+	switch (jump_target->ast_kind)
+	{
+		case AST_IF_STMT:
+			jump = jump_target->if_stmt.codegen.break_block;
+			break;
+		case AST_FOR_STMT:
+			jump = jump_target->for_stmt.codegen.exit_block;
+			break;
+		case AST_SWITCH_STMT:
+			jump = jump_target->switch_stmt.codegen->exit_block;
+			break;
+		default:
+			UNREACHABLE
+	}
+	c_emit_goto(c, C_PTR_TO_LABEL(jump));
+}
+
+static void c_emit_continue(GenContext *c, Ast *ast)
+{
+	ASSERT(ast->contbreak_stmt.is_resolved);
+	c_emit_statement_chain(c, ast->contbreak_stmt.defers);
+	Ast *jump_target = astptr(ast->contbreak_stmt.ast);
+	ASSERT(jump_target->ast_kind == AST_FOR_STMT);
+	c_emit_goto(c, C_PTR_TO_LABEL(jump_target->for_stmt.codegen.continue_block));
+}
+
+static void c_emit_next_stmt(GenContext *c, Ast *ast)
+{
+	Ast *jump_target = astptr(ast->nextcase_stmt.case_switch_stmt);
+	if (jump_target->ast_kind != AST_SWITCH_STMT)
+	{
+		c_emit_statement_chain(c, ast->nextcase_stmt.defer_id);
+		c_emit_goto(c, C_PTR_TO_LABEL(jump_target->case_stmt.backend_block));
+		return;
+	}
+	CValue value;
+	c_emit_expr(c, &value, ast->nextcase_stmt.switch_expr);
+	c_store(c, jump_target->switch_stmt.codegen->retry.var, &value);
+	c_emit_statement_chain(c, ast->nextcase_stmt.defer_id);
+	c_emit_goto(c, C_PTR_TO_LABEL(jump_target->switch_stmt.codegen->retry.block));
+}
+
+static void c_emit_assume(GenContext *c, Expr *expr)
+{
+	// Only pure expressions can be assumed without changing the program.
+	if (!expr_is_pure(expr)) return;
+	const char *value = c_emit_expr_rvalue(c, expr);
+	c_emit(c, "if (!%s) __builtin_unreachable();", value);
+}
+
+static void c_emit_assert_stmt(GenContext *c, Ast *ast)
+{
+	Expr *assert_expr = exprptr(ast->assert_stmt.expr);
+	if (!compile_asserts())
+	{
+		c_emit_assume(c, assert_expr);
+		return;
+	}
+	const char *value = c_emit_expr_rvalue(c, assert_expr);
+	int on_ok = c_new_label(c);
+	c_emit(c, "if (__builtin_expect(%s, 1)) goto __L%d;", value, on_ok);
+	const char *error = "Assert violation";
+	const char *fmt = NULL;
+	Expr *message_expr = exprptrzero(ast->assert_stmt.message);
+	CValue *values = NULL;
+	if (message_expr)
+	{
+		const char *err_msg = message_expr->const_expr.bytes.ptr;
+		Expr **args = ast->assert_stmt.args;
+		if (vec_size(args))
+		{
+			fmt = err_msg;
+			FOREACH(Expr *, arg, args)
+			{
+				CValue var;
+				c_emit_expr(c, &var, arg);
+				c_emit_any_from_value(c, &var, arg->type);
+				vec_add(values, var);
+			}
+		}
+		else
+		{
+			error = err_msg;
+		}
+	}
+	c_emit_panic(c, error, assert_expr->span, fmt, values, vec_size(values));
+	c_emit_label(c, on_ok);
+}
+
+void c_emit_stmt(GenContext *c, Ast *ast)
+{
+	switch (ast->ast_kind)
+	{
+		case AST_POISONED:
+		case AST_FOREACH_STMT:
+		case AST_CONTRACT:
+		case AST_ASM_STMT:
+		case AST_ASM_LABEL:
+		case AST_CONTRACT_FAULT:
+		case AST_CASE_STMT:
+		case AST_DEFAULT_STMT:
+		case CT_AST:
+			UNREACHABLE
+		case AST_EXPR_STMT:
+			c_emit_ignored_expr(c, ast->expr_stmt);
+			return;
+		case AST_DECLARE_STMT:
+		{
+			CValue value;
+			c_emit_local_decl(c, ast->declare_stmt, &value);
+			return;
+		}
+		case AST_DECLS_STMT:
+		{
+			CValue value;
+			FOREACH(Decl *, decl, ast->decls_stmt)
+			{
+				if (!decl) continue;
+				c_emit_local_decl(c, decl, &value);
+			}
+			return;
+		}
+		case AST_BREAK_STMT:
+			c_emit_break(c, ast);
+			return;
+		case AST_CONTINUE_STMT:
+			c_emit_continue(c, ast);
+			return;
+		case AST_IF_STMT:
+			c_emit_if_stmt(c, ast);
+			return;
+		case AST_RETURN_STMT:
+			c_emit_return(c, ast);
+			return;
+		case AST_BLOCK_EXIT_STMT:
+			c_emit_block_exit_return(c, ast);
+			return;
+		case AST_CT_COMPOUND_STMT:
+			c_emit_statement_chain(c, ast->ct_compound_stmt);
+			return;
+		case AST_COMPOUND_STMT:
+			c_emit_statement_chain(c, ast->compound_stmt.first_stmt);
+			return;
+		case AST_FOR_STMT:
+			c_emit_for_stmt(c, ast);
+			return;
+		case AST_NEXTCASE_STMT:
+			c_emit_next_stmt(c, ast);
+			return;
+		case AST_DEFER_STMT:
+		case AST_NOP_STMT:
+			return;
+		case AST_ASM_BLOCK_STMT:
+			error_exit("Inline asm is not supported by the C backend yet.");
+		case AST_ASSERT_STMT:
+			c_emit_assert_stmt(c, ast);
+			return;
+		case AST_SWITCH_STMT:
+			c_emit_switch(c, ast);
+			return;
+	}
+	UNREACHABLE
+}
+
+void c_emit_function_body(GenContext *c, Decl *decl)
+{
+	FunctionPrototype *prototype = type_get_resolved_prototype(decl->type);
+	c->catch = (OptionalCatch) { NULL, 0 };
+	c->defer_error_var = NULL;
+	c->cur_func = decl;
+	c->cur_func_name = decl->name;
+	c->cur_proto = prototype;
+	c->return_out = prototype->ret_by_ref ? "__retparam" : NULL;
+
+	// Parameters are copied into locals, so that they can be written and have their address taken.
+	if (!decl->func_decl.attr_naked)
+	{
+		FOREACH_IDX(i, Decl *, param, decl->func_decl.signature.params)
+		{
+			c_emit_local_var_alloca(c, param);
+			Type *type = type_lowering(param->type);
+			AlignSize alignment = param->alignment ? param->alignment : type_alloca_alignment(type);
+			c_store_raw(c, str_printf("((void *)&%s)", (const char *)param->backend_ref), type, alignment,
+			            str_printf("__p%u", (unsigned)i));
+		}
+	}
+
+	c_emit_statement_chain(c, astptr(decl->func_decl.body)->compound_stmt.first_stmt);
+	c_emit_return_implicit(c);
+}
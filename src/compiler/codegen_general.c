@@ -331,3 +331,20 @@ void codegen_setup_object_names(Module *module, const char **ir_filename, const
 		if (compiler.build.asm_file_dir) *asm_filename = file_append_path(compiler.build.asm_file_dir, *asm_filename);
 	}
 }
+
+bool module_should_weaken(Module *module)
+{
+	if (module->generic_module) return true;
+	Module *top = module->top_module;
+	return top && (top->name->module == kw_std || top->name->module == kw_libc);
+}
+
+bool module_is_stdlib(Module *module)
+{
+	if (module->name->len < 3) return false;
+	if (module->name->len == 3 && strcmp(module->name->module, "std") == 0) return true;
+	if (module->name->len > 5 && memcmp(module->name->module, "std::", 5) == 0) return true;
+	if (module->name->len == 4 && strcmp(module->name->module, "libc") == 0) return true;
+	if (module->name->len > 6 && memcmp(module->name->module, "libc::", 6) == 0) return true;
+	return false;
+}
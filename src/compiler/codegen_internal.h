@@ -119,6 +119,8 @@ static inline bool expr_is_vector_index_or_swizzle(Expr *expr)
 }
 
 const char *codegen_create_asm(Ast *ast);
+bool module_should_weaken(Module *module);
+bool module_is_stdlib(Module *module);
 
 extern const char * const benchmark_fns_var_name;
 extern const char * const benchmark_names_var_name;
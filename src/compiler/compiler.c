@@ -2,7 +2,7 @@
 // Use of this source code is governed by the GNU LGPLv3.0 license
 // a copy of which can be found in the LICENSE file.
 
-#include "compiler_internal.h"
+#include "c_codegen_internal.h"
 #include "../build/project.h"
 #include <compiler_tests/benchmark.h>
 #include "../utils/whereami.h"
@@ -11,6 +11,9 @@
 #endif
 #include "git_hash.h"
 #include <errno.h>
+#if !PLATFORM_WINDOWS
+#include <sys/wait.h>
+#endif
 
 #define MAX_OUTPUT_FILES 1000000
 #define MAX_MODULES 100000
@@ -24,11 +27,17 @@ Vmem decl_arena;
 Vmem type_info_arena;
 
 static double compiler_init_time;
+static double compiler_loading_time;
 static double compiler_parsing_time;
 static double compiler_sema_time;
 static double compiler_ir_gen_time;
 static double compiler_codegen_time;
 static double compiler_link_time;
+// Node arena use, recorded before the arenas are freed.
+static size_t compiler_ast_memory;
+static size_t compiler_decl_memory;
+static size_t compiler_expr_memory;
+static size_t compiler_type_info_memory;
 
 const char* c3_suffix_list[3] = { ".c3", ".c3t", ".c3i" };
 
@@ -42,6 +51,9 @@ static const char *out_name(void)
 
 void compiler_init(BuildOptions *build_options)
 {
+	// The workers are only started once there is parallel work.
+	taskqueue_set_threads(build_options->build_threads);
+
 	// Process --path
 	if (build_options->path && !dir_change(build_options->path))
 	{
@@ -54,6 +66,7 @@ void compiler_init(BuildOptions *build_options)
 	}
 
 	compiler_init_time = -1;
+	compiler_loading_time = -1;
 	compiler_parsing_time = -1;
 	compiler_sema_time = -1;
 	compiler_ir_gen_time = -1;
@@ -66,12 +79,13 @@ void compiler_init(BuildOptions *build_options)
 	// Skip library detection.
 	//compiler.lib_dir = find_lib_dir();
 	//DEBUG_LOG("Found std library: %s", compiler.lib_dir);
-	htable_init(&compiler.context.modules, 16 * 1024);
+	htable_init(&compiler.context.modules, 1024);
 	decltable_init(&compiler.context.symbols, INITIAL_SYMBOL_MAP);
 	decltable_init(&compiler.context.generic_symbols, INITIAL_GENERIC_SYMBOL_MAP);
 
 	htable_init(&compiler.context.features, 1024);
-	htable_init(&compiler.context.compiler_defines, 16 * 1024);
+	htable_init(&compiler.context.compiler_defines, 256);
+	htable_init(&compiler.context.macro_memos, 256);
 	compiler.context.module_list = NULL;
 	compiler.context.generic_module_list = NULL;
 	compiler.context.method_extensions = NULL;
@@ -271,8 +285,85 @@ static const char *static_lib_name(void)
 	}
 }
 
+#define MAX_GENERIC_STATS 20
+
+static int generic_stats_compare(const void *a, const void *b)
+{
+	double time_a = (*(Module **)a)->generic_instantiation_time;
+	double time_b = (*(Module **)b)->generic_instantiation_time;
+	return time_a < time_b ? 1 : (time_a > time_b ? -1 : 0);
+}
+
+static void print_generic_stats(void)
+{
+	Module **generics = NULL;
+	unsigned instances = 0;
+	size_t nodes = 0;
+	FOREACH(Module *, module, compiler.context.generic_module_list)
+	{
+		if (!module->generic_instances) continue;
+		instances += module->generic_instances;
+		nodes += module->generic_copied_nodes;
+		vec_add(generics, module);
+	}
+	unsigned count = vec_size(generics);
+	printf("-- GENERIC INSTANTIATIONS -- \n");
+	printf(" * Instances: %u of %u generic module(s), %llu nodes copied\n",
+	       instances, count, (unsigned long long)nodes);
+	if (!count) return;
+	qsort(generics, count, sizeof(Module *), generic_stats_compare);
+	if (count > MAX_GENERIC_STATS) count = MAX_GENERIC_STATS;
+	for (unsigned i = 0; i < count; i++)
+	{
+		Module *module = generics[i];
+		printf(" * %s: %u instance(s), %llu nodes, %.3f ms\n", module->name->module, module->generic_instances,
+		       (unsigned long long)module->generic_copied_nodes, module->generic_instantiation_time * 1000);
+	}
+}
+
+static void print_vmem_use(const char *name, Vmem *vmem, size_t element_size)
+{
+	// The arenas are never rewound, so what is allocated is also the peak.
+	printf(" * %s memory use: %llukb (%u elements, %.1f%% of %llumb reserved)\n", name,
+		   (unsigned long long)vmem->allocated / 1024,
+		   (unsigned)(vmem->allocated / element_size),
+		   vmem->size ? vmem->allocated * 100.0 / vmem->size : 0.0,
+		   (unsigned long long)vmem->size / (1024 * 1024));
+}
+
+static void print_table_stats(void)
+{
+	printf("-- SYMBOL TABLE INFO -- \n");
+	symtab_print_stats();
+	DeclTable *symbols = &compiler.context.symbols;
+	DeclTable *generic_symbols = &compiler.context.generic_symbols;
+	printf(" * Global symbols: %u (capacity %u)\n", symbols->count, symbols->capacity);
+	printf(" * Generic symbols: %u (capacity %u)\n", generic_symbols->count, generic_symbols->capacity);
+	HTable *modules = &compiler.context.modules;
+	printf(" * Modules: %u in %u slots\n", htable_count(modules), modules->capacity);
+	uint32_t module_symbols = 0;
+	uint32_t module_slots = 0;
+	FOREACH(Module *, module, compiler.context.module_list)
+	{
+		module_symbols += htable_count(&module->symbols);
+		module_slots += module->symbols.capacity;
+	}
+	FOREACH(Module *, module, compiler.context.generic_module_list)
+	{
+		module_symbols += htable_count(&module->symbols);
+		module_slots += module->symbols.capacity;
+	}
+	printf(" * Module symbols: %u in %u slots\n", module_symbols, module_slots);
+	HTable *sources = &compiler.context.loaded_sources_by_path;
+	printf(" * Loaded sources: %u in %u slots\n", htable_count(sources), sources->capacity);
+}
+
 static void free_arenas(void)
 {
+	compiler_ast_memory = ast_arena.allocated;
+	compiler_decl_memory = decl_arena.allocated;
+	compiler_expr_memory = expr_arena.allocated;
+	compiler_type_info_memory = type_info_arena.allocated;
 	if (compiler.build.print_stats)
 	{
 		printf("-- AST/EXPR/TYPE INFO -- \n");
@@ -280,18 +371,13 @@ static void free_arenas(void)
 		printf(" * Decl size: %u bytes\n", (unsigned)sizeof(Decl));
 		printf(" * Expr size: %u bytes\n", (unsigned)sizeof(Expr));
 		printf(" * TypeInfo size: %u bytes\n", (unsigned)sizeof(TypeInfo));
-		printf(" * Ast memory use: %llukb (%u elements)\n",
-			   (unsigned long long)ast_arena.allocated / 1024,
-			   (unsigned)(ast_arena.allocated / sizeof(Ast)));
-		printf(" * Decl memory use: %llukb (%u elements)\n",
-			   (unsigned long long)decl_arena.allocated / 1024,
-			   (unsigned)(decl_arena.allocated / sizeof(Decl)));
-		printf(" * Expr memory use: %llukb (%u elements)\n",
-			   (unsigned long long)expr_arena.allocated / 1024,
-			   (unsigned)(expr_arena.allocated / sizeof(Expr)));
-		printf(" * TypeInfo memory use: %llukb (%u elements)\n",
-			   (unsigned long long)type_info_arena.allocated / 1024,
-			   (unsigned)(type_info_arena.allocated / sizeof(TypeInfo)));
+		print_vmem_use("Ast", &ast_arena, sizeof(Ast));
+		print_vmem_use("Decl", &decl_arena, sizeof(Decl));
+		print_vmem_use("Expr", &expr_arena, sizeof(Expr));
+		print_vmem_use("TypeInfo", &type_info_arena, sizeof(TypeInfo));
+		printf(" * Copy fix-ups performed: %llu\n", (unsigned long long)copy_total_fixups());
+		print_table_stats();
+		print_generic_stats();
 
 	}
 
@@ -303,25 +389,115 @@ static void free_arenas(void)
 	if (compiler.build.print_stats) print_arena_status();
 }
 
+// Prepare the C compiles, the ones not found in the cache are added as tasks.
+static void deps_append_escaped(CBuffer *out, const char *path)
+{
+	for (const char *c = path; *c; c++)
+	{
+		switch (*c)
+		{
+			case ' ':
+			case '#':
+				cbuffer_append(out, "\\");
+				break;
+			case '$':
+				cbuffer_append(out, "$");
+				break;
+			default:
+				break;
+		}
+		cbuffer_append_len(out, c, 1);
+	}
+}
+
+/**
+ * Write the inputs of the build as a Makefile dependency file, so that Make,
+ * Ninja and similar tools only invoke the compiler when one of them changed.
+ * Without a linked output, the dependency file itself is the target.
+ */
+static void compiler_emit_deps(const char *target)
+{
+	const char *deps_file = compiler.build.deps_file;
+	if (!deps_file) return;
+	if (!target) target = compiler.obj_output ? compiler.obj_output : deps_file;
+	CBuffer out = { 0 };
+	deps_append_escaped(&out, target);
+	cbuffer_append(&out, ":");
+	FOREACH(const char *, path, compiler_input_files())
+	{
+		cbuffer_append(&out, " \\\n  ");
+		deps_append_escaped(&out, path);
+	}
+	cbuffer_append(&out, "\n");
+	if (!file_write_if_changed(deps_file, out.data, out.len))
+	{
+		error_exit("Failed to write the dependency file '%s'.", deps_file);
+	}
+	cbuffer_free(&out);
+}
+
 static int compile_cfiles(const char *cc, const char **files, const char *flags, const char **include_dirs,
-                          const char **out_files, const char *output_subdir)
+                          const char **out_files, const char *output_subdir, CCompile ***compiles_ref, Task ***tasks_ref)
 {
 	if (!cc) cc = default_c_compiler();
 	int total = 0;
 	FOREACH(const char *, file, files)
 	{
-		out_files[total++] = cc_compiler(cc, file, flags, include_dirs, output_subdir);
+		CCompile *compile = cc_compiler_prepare(cc, file, flags, include_dirs, output_subdir);
+		out_files[total++] = compile->out_name;
+		vec_add(*compiles_ref, compile);
+		if (!compile->cached) vec_add(*tasks_ref, &compile->task);
 	}
 	return total;
 }
 
+static void json_phase(FILE *file, const char *name, double end, double start)
+{
+	if (end < 0) return;
+	fprintf(file, ",\n  \"%s_ms\": %.3f", name, (end - (start >= 0 ? start : 0)) * 1000);
+}
+
+// The same numbers as --print-stats, for tools tracking compile time regressions.
+static void compiler_write_stats_json(void)
+{
+	const char *path = compiler.build.stats_json;
+	if (!path) return;
+	FILE *file = fopen(path, "w");
+	if (!file) error_exit("Failed to open '%s' for writing the statistics.", path);
+	double last = compiler_init_time;
+	double times[] = { compiler_parsing_time, compiler_sema_time, compiler_ir_gen_time, compiler_codegen_time, compiler_link_time };
+	for (unsigned i = 0; i < ELEMENTLEN(times); i++)
+	{
+		if (times[i] >= 0) last = times[i];
+	}
+	fprintf(file, "{\n  \"init_ms\": %.3f", compiler_init_time * 1000);
+	json_phase(file, "loading", compiler_loading_time, compiler_init_time);
+	json_phase(file, "parsing", compiler_parsing_time, compiler_loading_time >= 0 ? compiler_loading_time : compiler_init_time);
+	json_phase(file, "sema", compiler_sema_time, compiler_parsing_time);
+	json_phase(file, "ir_gen", compiler_ir_gen_time, compiler_sema_time);
+	json_phase(file, "codegen", compiler_codegen_time, compiler_ir_gen_time);
+	json_phase(file, "link", compiler_link_time, compiler_codegen_time);
+	fprintf(file, ",\n  \"total_ms\": %.3f,\n  \"threads\": %d", last * 1000, compiler.build.build_threads);
+	size_t memory;
+	size_t string_memory;
+	size_t allocations;
+	arena_usage(&memory, &string_memory, &allocations);
+	fprintf(file, ",\n  \"peak_rss_kb\": %zu,\n  \"arena_kb\": %zu,\n  \"string_arena_kb\": %zu,\n  \"allocations\": %zu",
+	        peak_rss_kb(), memory / 1024, string_memory / 1024, allocations);
+	fprintf(file, ",\n  \"ast_kb\": %zu,\n  \"decl_kb\": %zu,\n  \"expr_kb\": %zu,\n  \"type_info_kb\": %zu\n}\n",
+	        compiler_ast_memory / 1024, compiler_decl_memory / 1024, compiler_expr_memory / 1024, compiler_type_info_memory / 1024);
+	fclose(file);
+}
+
 static void compiler_print_bench(void)
 {
+	compiler_write_stats_json();
 	if (compiler.build.print_stats)
 	{
 		puts("--------- Compilation time statistics --------\n");
 		double last = compiler_init_time;
-		double parse_time = compiler_parsing_time - compiler_init_time;
+		double load_time = compiler_loading_time - compiler_init_time;
+		double parse_time = compiler_parsing_time - (compiler_loading_time >= 0 ? compiler_loading_time : compiler_init_time);
 		if (compiler_parsing_time >= 0) last = compiler_parsing_time;
 		double sema_time = compiler_sema_time - compiler_parsing_time;
 		if (compiler_sema_time >= 0) last = compiler_sema_time;
@@ -333,6 +509,7 @@ static void compiler_print_bench(void)
 		if (compiler_link_time >= 0) last = compiler_link_time;
 		printf("Frontend -------------------- Time --- %% total\n");
 		if (compiler_init_time >= 0) printf("Initialization took: %10.3f ms  %8.1f %%\n", compiler_init_time * 1000, compiler_init_time * 100 / last);
+		if (compiler_loading_time >= 0) printf("Loading took:        %10.3f ms  %8.1f %%\n", load_time * 1000, load_time * 100 / last);
 		if (compiler_parsing_time >= 0) printf("Parsing took:        %10.3f ms  %8.1f %%\n", parse_time * 1000, parse_time * 100 / last);
 		if (compiler_sema_time >= 0)
 		{
@@ -365,6 +542,8 @@ static void compiler_print_bench(void)
 		{
 			puts("----------------------------------------------");
 			printf("TOTAL compile time: %.3f ms.\n", last * 1000);
+			size_t peak_rss = peak_rss_kb();
+			if (peak_rss) printf("Peak memory use (RSS): %zu Kb.\n", peak_rss);
 			puts("----------------------------------------------");
 		}
 	}
@@ -379,6 +558,71 @@ void delete_object_files(const char **files, size_t count)
 	}
 }
 
+#if PLATFORM_WINDOWS
+static void compiler_lsp_server(void)
+{
+	error_exit("--lsp-server is not supported on Windows.");
+}
+#else
+/**
+ * Parse the standard library once, then fork for every 'check' read from stdin.
+ * The child returns and continues with parsing and analysing the project files,
+ * which are read from disk each time, while the server keeps the parsed library.
+ * Since the library is only parsed here, 'changed <file>' for one of its files
+ * makes the server exit with LSP-RESTART so that it can be started again.
+ */
+static void compiler_lsp_server(void)
+{
+	const char **lib_files = NULL;
+	file_add_wildcard_files(&lib_files, compiler.context.lib_dir, true, c3_suffix_list, 3);
+	File **files = source_files_load(lib_files, compiler.build.build_threads);
+	FOREACH(File *, file, files)
+	{
+		if (parse_file(file)) continue;
+		eprintf("> ENDLSP-ERROR\n");
+		exit_compiler(COMPILER_SUCCESS_EXIT);
+	}
+	char line[PATH_MAX + 16];
+	while (fgets(line, sizeof(line), stdin))
+	{
+		str_trim_end(line);
+		if (str_eq(line, "quit")) break;
+		if (str_start_with(line, "changed "))
+		{
+			const char *full_path = realpath(line + 8, NULL);
+			if (!full_path) continue;
+			FOREACH(File *, file, files)
+			{
+				if (!str_eq(file->full_path, full_path)) continue;
+				eprintf("> LSP-RESTART\n");
+				exit_compiler(COMPILER_SUCCESS_EXIT);
+			}
+			continue;
+		}
+		if (!str_eq(line, "check"))
+		{
+			eprintf("> LSP-UNKNOWN|%s\n", line);
+			continue;
+		}
+		fflush(stdout);
+		fflush(stderr);
+		pid_t pid = fork();
+		if (pid < 0) error_exit("Failed to start a check: %s.", strerror(errno));
+		if (!pid)
+		{
+			// The worker threads were not forked along with us.
+			taskqueue_after_fork();
+			return;
+		}
+		int status;
+		while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+		// A crash in the child must still end the response.
+		if (!WIFEXITED(status)) eprintf("> ENDLSP-ERROR\n");
+	}
+	exit_compiler(COMPILER_SUCCESS_EXIT);
+}
+#endif
+
 void compiler_parse(void)
 {
 	// Cleanup any errors (could there really be one here?!)
@@ -387,7 +631,14 @@ void compiler_parse(void)
 	// Add the standard library
 	if (compiler.context.lib_dir && !no_stdlib())
 	{
-		file_add_wildcard_files(&compiler.context.sources, compiler.context.lib_dir, true, c3_suffix_list, 3);
+		if (compiler.build.lsp_server)
+		{
+			compiler_lsp_server();
+		}
+		else
+		{
+			file_add_wildcard_files(&compiler.context.sources, compiler.context.lib_dir, true, c3_suffix_list, 3);
+		}
 	}
 
 	// Load and parse all files.
@@ -396,14 +647,15 @@ void compiler_parse(void)
 	{
 		puts("# input-files-begin");
 	}
-	FOREACH(const char *, source, compiler.context.sources)
+	double start = trace_begin();
+	File **files = source_files_load(compiler.context.sources, compiler.build.build_threads);
+	trace_end("load", "source_files_load", NULL, start);
+	compiler_loading_time = bench_mark();
+	FOREACH(File *, file, files)
 	{
-		bool loaded = false;
-		const char *error;
-		File *file = source_file_load(source, &loaded, &error);
-		if (!file) error_exit(error);
-		if (loaded) continue;
+		start = trace_begin();
 		if (!parse_file(file)) has_error = true;
+		trace_end("parse", "parse_file", file->full_path, start);
 		if (compiler.build.print_input) puts(file->full_path);
 	}
 	if (compiler.build.print_input)
@@ -444,6 +696,67 @@ static void create_output_dir(const char *dir)
 }
 
 
+static bool compiler_use_system_linker(void)
+{
+	switch (compiler.build.type)
+	{
+		case TARGET_TYPE_EXECUTABLE:
+		case TARGET_TYPE_TEST:
+		case TARGET_TYPE_BENCHMARK:
+			break;
+		default:
+			return false;
+	}
+	bool system_linker_available = link_libc() && compiler.platform.os != OS_TYPE_WIN32;
+	bool use_system_linker = system_linker_available && compiler.build.arch_os_target == default_target;
+	switch (compiler.build.linker_type)
+	{
+		case LINKER_TYPE_CC:
+			if (!system_linker_available)
+			{
+				eprintf("System linker is not supported, defaulting to built-in linker\n");
+				break;
+			}
+			use_system_linker = true;
+			break;
+		case LINKER_TYPE_BUILTIN:
+			use_system_linker = false;
+			break;
+		default:
+			break;
+	}
+	return use_system_linker || compiler.build.linker_type == LINKER_TYPE_CC;
+}
+
+/**
+ * Module objects that are only handed to the built-in linker and then deleted
+ * can be kept in memory, which skips the round trip through the file system.
+ */
+static bool compiler_objects_in_memory(bool use_system_linker)
+{
+	if (compiler.build.backend != BACKEND_LLVM || !compiler.build.emit_object_files) return false;
+	if (compiler.build.test_output || compiler.build.benchmark_output) return false;
+	switch (compiler.build.type)
+	{
+		case TARGET_TYPE_EXECUTABLE:
+		case TARGET_TYPE_TEST:
+		case TARGET_TYPE_BENCHMARK:
+		case TARGET_TYPE_DYNAMIC_LIB:
+			break;
+		default:
+			// Static libraries name their members after the object files.
+			return false;
+	}
+	// The objects must outlive the build, or be read by another process.
+	if (incremental_build() || compiler.build.object_cache_dir || compiler.build.print_output) return false;
+	if (use_system_linker || compiler.build.linker_type == LINKER_TYPE_CUSTOM) return false;
+	// Thin LTO uses the object names to identify the modules.
+	if (thin_lto()) return false;
+	// The .dwo files are named after the objects and must outlive the build.
+	if (split_dwarf()) return false;
+	return obj_format_linking_supported(compiler.platform.object_format);
+}
+
 void compiler_compile(void)
 {
 	if (compiler.build.lsp_output)
@@ -478,12 +791,15 @@ void compiler_compile(void)
 
 	if (compiler.build.check_only)
 	{
+		compiler_emit_deps(NULL);
 		free_arenas();
+		compiler_print_bench();
 		return;
 	}
 
-	void **gen_contexts;
+	void **gen_contexts = NULL;
 	void (*task)(void *);
+	size_t (*task_cost)(void *) = NULL;
 
 
 	if (compiler.build.asm_file_dir || compiler.build.ir_file_dir || compiler.build.emit_object_files)
@@ -502,6 +818,15 @@ void compiler_compile(void)
 	{
 		create_output_dir(compiler.build.object_file_dir);
 	}
+	if (compiler.build.object_cache_dir && compiler.build.emit_object_files)
+	{
+		create_output_dir(compiler.build.object_cache_dir);
+	}
+	if (compiler.build.pgo_profile)
+	{
+		if (pgo_instrument()) error_exit("A PGO profile cannot be used when building an instrumented binary.");
+		if (!file_exists(compiler.build.pgo_profile)) error_exit("The PGO profile '%s' could not be found.", compiler.build.pgo_profile);
+	}
 	if (compiler.build.type == TARGET_TYPE_EXECUTABLE && !compiler.context.main && !compiler.build.no_entry)
 	{
 		error_exit("The 'main' function for the executable could not found, did you forget to add it?\n\n"
@@ -514,16 +839,26 @@ void compiler_compile(void)
 	{
 		compiler.build.single_module = SINGLE_MODULE_ON;
 	}
+	if (split_dwarf())
+	{
+		if (compiler.platform.object_format != OBJ_FORMAT_ELF) error_exit("Split DWARF is only supported for ELF targets.");
+		if (thin_lto()) error_exit("Split DWARF cannot be combined with ThinLTO.");
+	}
+	bool use_system_linker = compiler_use_system_linker();
+	compiler.build.objects_in_memory = compiler_objects_in_memory(use_system_linker);
+	const char **c_backend_files = NULL;
 	switch (compiler.build.backend)
 	{
 		case BACKEND_C:
-			gen_contexts = c_gen(modules, module_count);
-			(void)gen_contexts;
-			error_exit("Unfinished C backend!");
+			// Each module becomes a C file, which is compiled together with the other C sources.
+			c_backend_files = (const char **)c_gen(modules, module_count);
+			use_system_linker = true;
+			break;
 		case BACKEND_LLVM:
 #if LLVM_AVAILABLE
 			gen_contexts = llvm_gen(modules, module_count);
 			task = &thread_compile_task_llvm;
+			task_cost = &llvm_codegen_cost;
 #else 
             error_exit("C3C compiled without LLVM!");
 #endif
@@ -585,9 +920,18 @@ void compiler_compile(void)
 	}
 	free_arenas();
 
+	if (compiler.build.backend == BACKEND_C && !compiler.build.emit_object_files)
+	{
+		// The generated C is the only output, like the IR when no objects are emitted.
+		compiler_emit_deps(NULL);
+		compiler_print_bench();
+		return;
+	}
+
 	uint32_t output_file_count = vec_size(gen_contexts);
 	unsigned external_objfile_count = vec_size(compiler.build.object_files);
-	unsigned cfiles = vec_size(compiler.build.csources);
+	unsigned cfiles_backend = vec_size(c_backend_files);
+	unsigned cfiles = vec_size(compiler.build.csources) + cfiles_backend;
 	unsigned cfiles_library = 0;
 	FOREACH(LibraryTarget *, lib, compiler.build.ccompiling_libraries)
 	{
@@ -616,10 +960,15 @@ void compiler_compile(void)
 	CompileData *compile_data = ccalloc(sizeof(CompileData), output_file_count);
 	const char **obj_files = cmalloc(sizeof(char*) * total_output);
 
+	CCompile **ccompiles = NULL;
+	Task **ctasks = NULL;
 	if (cfiles)
 	{
-		int compiled = compile_cfiles(compiler.build.cc, compiler.build.csources,
-		                              compiler.build.cflags, compiler.build.cinclude_dirs, &obj_files[output_file_count], "tmp_c_compile");
+		int compiled = compile_cfiles(compiler.build.cc, c_backend_files, "-fwrapv -fno-strict-aliasing -w -Wno-psabi",
+		                              NULL, &obj_files[output_file_count], "c_backend", &ccompiles, &ctasks);
+		compiled += compile_cfiles(compiler.build.cc, compiler.build.csources,
+		                           compiler.build.cflags, compiler.build.cinclude_dirs, &obj_files[output_file_count + compiled], "tmp_c_compile",
+		                           &ccompiles, &ctasks);
 		ASSERT(cfiles == compiled);
 		(void)compiled;
 	}
@@ -627,8 +976,12 @@ void compiler_compile(void)
 	FOREACH(LibraryTarget *, lib, compiler.build.ccompiling_libraries)
 	{
 		obj_file_next += compile_cfiles(lib->cc ? lib->cc : compiler.build.cc, lib->csources,
-		                                lib->cflags, lib->cinclude_dirs, obj_file_next, lib->parent->provides);
+		                                lib->cflags, lib->cinclude_dirs, obj_file_next, lib->parent->provides,
+		                                &ccompiles, &ctasks);
 	}
+	// The C compiles run alongside the codegen.
+	TaskBatch cbatch;
+	taskqueue_submit(&cbatch, ctasks);
 	for (unsigned i = 0; i < external_objfile_count; i++)
 	{
 		obj_file_next[0] = compiler.build.object_files[i];
@@ -642,22 +995,21 @@ void compiler_compile(void)
 		compile_data[i].task = (Task) { task, &compile_data[i] };
 		vec_add(tasks, &compile_data[i].task);
 	}
-
-#if USE_PTHREAD
-	INFO_LOG("Will use %d thread(s).\n", compiler.build.build_threads);
-#endif
 	unsigned task_count = vec_size(tasks);
-	if (task_count > 0)
+	if (task_cost && task_count > 1 && compiler.build.build_threads > 1)
 	{
-		Task *task_last = VECLAST(tasks);
-		vec_pop(tasks);
-		task_last->task(task_last->arg);
-		task_count--;
-		if (task_count)
+		for (unsigned i = 0; i < task_count; i++)
 		{
-			taskqueue_run((int)(compiler.build.build_threads > task_count ? task_count : compiler.build.build_threads), tasks);
+			tasks[i]->cost = task_cost(compile_data[i].context);
 		}
 	}
+
+#if USE_PTHREAD
+	INFO_LOG("Will use %d thread(s).\n", compiler.build.build_threads);
+#endif
+	taskqueue_run(tasks);
+	taskqueue_wait(&cbatch);
+	FOREACH(CCompile *, compile, ccompiles) cc_compiler_finish(compile);
 	if (compiler.build.print_output)
 	{
 		puts("# output-files-begin");
@@ -678,8 +1030,16 @@ void compiler_compile(void)
 		puts("# output-files-end");
 	}
 
+	unsigned module_objfile_count = output_file_count;
 	output_file_count += cfiles + cfiles_library + external_objfile_count;
 	unsigned objfile_delete_count = output_file_count - external_objfile_count;
+	const char **objfiles_to_delete = obj_files;
+	if (incremental_build())
+	{
+		// Keep the module object files, so that the next build can reuse them.
+		objfiles_to_delete += module_objfile_count;
+		objfile_delete_count -= module_objfile_count;
+	}
 	free(compile_data);
 	compiler_codegen_time = bench_mark();
 
@@ -691,6 +1051,9 @@ void compiler_compile(void)
 		}
 		error_exit("Compilation produced no object files, maybe there was no code?");
 	}
+	const char *deps_target = output_exe ? output_exe : (output_static ? output_static : output_dynamic);
+	if (deps_target && compiler.build.output_dir) deps_target = file_append_path(compiler.build.output_dir, deps_target);
+	compiler_emit_deps(deps_target);
 	if (output_exe)
 	{
 		if (compiler.build.output_dir)
@@ -709,43 +1072,30 @@ void compiler_compile(void)
 			error_exit("Cannot create exe with the name '%s' - there is already a directory with that name.", output_exe);
 		}
 
-		bool system_linker_available = link_libc() && compiler.platform.os != OS_TYPE_WIN32;
-		bool use_system_linker = system_linker_available && compiler.build.arch_os_target == default_target;
-		switch (compiler.build.linker_type)
-		{
-			case LINKER_TYPE_CC:
-				if (!system_linker_available)
-				{
-					eprintf("System linker is not supported, defaulting to built-in linker\n");
-					break;
-				}
-				use_system_linker = true;
-				break;
-			case LINKER_TYPE_BUILTIN:
-				use_system_linker = false;
-				break;
-			default:
-				break;
-		}
-		if (use_system_linker || compiler.build.linker_type == LINKER_TYPE_CC)
+		if (use_system_linker)
 		{
+			double start = trace_begin();
 			platform_linker(output_exe, obj_files, output_file_count);
+			trace_end("link", "platform_linker", output_exe, start);
 			compiler_link_time = bench_mark();
 			compiler_print_bench();
-			delete_object_files(obj_files, objfile_delete_count);
+			delete_object_files(objfiles_to_delete, objfile_delete_count);
 		}
 		else
 		{
 			compiler_print_bench();
-			if (!obj_format_linking_supported(compiler.platform.object_format) || !linker(output_exe, obj_files,
-																						output_file_count))
+			double start = trace_begin();
+			bool linked = obj_format_linking_supported(compiler.platform.object_format)
+			              && linker(output_exe, obj_files, output_file_count);
+			trace_end("link", "linker", output_exe, start);
+			if (!linked)
 			{
 				eprintf("No linking is performed due to missing linker support.\n");
 				compiler.build.run_after_compile = false;
 			}
 			else
 			{
-				delete_object_files(obj_files, objfile_delete_count);
+				delete_object_files(objfiles_to_delete, objfile_delete_count);
 			}
 		}
 
@@ -817,11 +1167,14 @@ void compiler_compile(void)
 		{
 			error_exit("Cannot create a static library with the name '%s' - there is already a directory with that name.", output_exe);
 		}
-		if (!static_lib_linker(output_static, obj_files, output_file_count))
+		double start = trace_begin();
+		bool linked = static_lib_linker(output_static, obj_files, output_file_count);
+		trace_end("link", "static_lib_linker", output_static, start);
+		if (!linked)
 		{
 			error_exit("Failed to produce static library '%s'.", output_static);
 		}
-		delete_object_files(obj_files, objfile_delete_count);
+		delete_object_files(objfiles_to_delete, objfile_delete_count);
 		compiler_link_time = bench_mark();
 		compiler_print_bench();
 		OUTF("Static library '%s' created.\n", output_static);
@@ -842,11 +1195,14 @@ void compiler_compile(void)
 		{
 			error_exit("Cannot create a dynamic library with the name '%s' - there is already a directory with that name.", output_exe);
 		}
-		if (!dynamic_lib_linker(output_dynamic, obj_files, output_file_count))
+		double start = trace_begin();
+		bool linked = dynamic_lib_linker(output_dynamic, obj_files, output_file_count);
+		trace_end("link", "dynamic_lib_linker", output_dynamic, start);
+		if (!linked)
 		{
 			error_exit("Failed to produce dynamic library '%s'.", output_dynamic);
 		}
-		delete_object_files(obj_files, objfile_delete_count);
+		delete_object_files(objfiles_to_delete, objfile_delete_count);
 		OUTF("Dynamic library '%s' created.\n", output_dynamic);
 		compiler_link_time = bench_mark();
 		compiler_print_bench();
@@ -888,6 +1244,7 @@ void clean_obj_files(void)
 	file_delete_all_files_in_dir_with_suffix(compiler.build.asm_file_dir, ".s");
 	file_delete_all_files_in_dir_with_suffix(compiler.build.object_file_dir, ".obj");
 	file_delete_all_files_in_dir_with_suffix(compiler.build.object_file_dir, ".o");
+	file_delete_all_files_in_dir_with_suffix(compiler.build.object_file_dir, ".hash");
 }
 void compile_clean(BuildOptions *options)
 {
@@ -918,7 +1275,7 @@ void compile_file_list(BuildOptions *options)
 static inline void setup_define(const char *id, Expr *expr)
 {
 	TokenType token_type = TOKEN_CONST_IDENT;
-	id = symtab_add(id, (uint32_t) strlen(id), fnv1a(id, (uint32_t) strlen(id)), &token_type);
+	id = symtab_add(id, (uint32_t) strlen(id), symtab_hash(id, (uint32_t) strlen(id)), &token_type);
 	void *previous = htable_set(&compiler.context.compiler_defines, (void*)id, expr);
 	if (previous)
 	{
@@ -949,12 +1306,20 @@ static void setup_bool_define(const char *id, bool value)
 }
 
 #if FETCH_AVAILABLE
-const char * vendor_fetch_single(const char* lib, const char* path) 
+static void vendor_fetch_download(Download *download, const char *lib, const char *path)
+{
+	*download = (Download) {
+		.url = str_printf("https://github.com/c3lang/vendor/releases/download/latest/%s.c3l", lib),
+		.file_path = file_append_path(path, str_printf("%s.c3l", lib))
+	};
+}
+
+const char *vendor_fetch_single(const char *lib, const char *path, const char *cache_dir)
 {
-	const char *resource = str_printf("/c3lang/vendor/releases/download/latest/%s.c3l", lib);
-	const char *destination = file_append_path(path, str_printf("%s.c3l", lib));
-	const char *error = download_file("https://github.com", resource, destination);
-	return error;	
+	Download download;
+	vendor_fetch_download(&download, lib, path);
+	download_files(&download, 1, cache_dir, NULL);
+	return download.error;
 }
 
 static bool use_ansi(void)
@@ -991,9 +1356,35 @@ void update_progress_bar(const char* lib, int current_step, int total_steps)
 	(void)fflush(stdout);
 }
 
+static bool vendor_fetch_ansi;
+static const char **vendor_fetch_names;
+static Download *vendor_fetch_downloads;
+
+static void vendor_fetch_done(Download *download, unsigned done, unsigned total)
+{
+	const char *lib = vendor_fetch_names[download - vendor_fetch_downloads];
+	if (download->error)
+	{
+		if (vendor_fetch_ansi)
+		{
+			printf("\033[2K\033[31mFailed to fetch library '%s': %s\033[0m\n", lib, download->error);
+		}
+		else
+		{
+			printf("Failed: '%s'\n", download->error);
+		}
+	}
+	else if (!vendor_fetch_ansi || total == 1)
+	{
+		printf("Fetching library '%s'... finished.\n", lib);
+	}
+	if (vendor_fetch_ansi && total > 1) update_progress_bar(lib, (int)done, (int)total);
+	(void)fflush(stdout);
+}
+
 void vendor_fetch(BuildOptions *options)
 {
-	bool ansi = use_ansi();
+	bool ansi = vendor_fetch_ansi = use_ansi();
 
 	if (str_eq(options->path, DEFAULT_PATH))
 	{
@@ -1008,48 +1399,24 @@ void vendor_fetch(BuildOptions *options)
 
 	unsigned count = 0;
 	const char** fetched_libraries = NULL;
-	int total_libraries = (int)vec_size(options->libraries_to_fetch);
-	
-	for(int i = 0; i < total_libraries; i++)
-	{
-		const char *lib = options->libraries_to_fetch[i];
-		if (!ansi || total_libraries == 1)
-		{
-			printf("Fetching library '%s'...", lib);
-			(void)fflush(stdout);
-		}
-		else
-		{
-			update_progress_bar(lib, i, total_libraries);
-		}
-		const char *error = vendor_fetch_single(lib, options->vendor_download_path);
+	unsigned total_libraries = vec_size(options->libraries_to_fetch);
 
-		if (!error)
-		{
-			if (!ansi || total_libraries == 1)
-			{
-				puts("finished.");
-			}
-			else
-			{
-				update_progress_bar(lib, i + 1, total_libraries);
-			}
-			vec_add(fetched_libraries, lib);
-			count++;
-		}
-		else
-		{
-			if (ansi)
-			{
-				printf("\033[2K\033[31mFailed to fetch library '%s': %s\033[0m\n", lib, error);
-			}
-			else
-			{
-				printf("Failed: '%s'\n", error);
-			}
-			(void)fflush(stdout);
-		}
+	// All libraries are downloaded at the same time.
+	vendor_fetch_names = options->libraries_to_fetch;
+	vendor_fetch_downloads = ccalloc(sizeof(Download), total_libraries);
+	for (unsigned i = 0; i < total_libraries; i++)
+	{
+		vendor_fetch_download(&vendor_fetch_downloads[i], options->libraries_to_fetch[i], options->vendor_download_path);
+	}
+	if (ansi && total_libraries > 1) update_progress_bar("", 0, (int)total_libraries);
+	download_files(vendor_fetch_downloads, total_libraries, options->download_cache_dir, vendor_fetch_done);
+	for (unsigned i = 0; i < total_libraries; i++)
+	{
+		if (vendor_fetch_downloads[i].error) continue;
+		vec_add(fetched_libraries, options->libraries_to_fetch[i]);
+		count++;
 	}
+	free(vendor_fetch_downloads);
 
 	if (ansi && total_libraries > 1) printf("\033[2K");
 
@@ -1239,8 +1606,33 @@ static int jump_buffer_size()
 	UNREACHABLE
 }
 
+// Compiled scripts are kept here, by a key derived from their sources, so they are only built once.
+static const char *exec_cache_dir = NULL;
+#define EXEC_CACHE_MAX_ENTRIES 64
+#if PLATFORM_WINDOWS
+#define EXEC_CACHE_SUFFIX ".exe"
+#else
+#define EXEC_CACHE_SUFFIX ".bin"
+#endif
+
+static void exec_cache_init(void)
+{
+	if (exec_cache_dir || !compiler.build.build_dir) return;
+	// Scripts may run from the script dir, so keep an absolute path.
+	const char *build_dir = compiler.build.build_dir;
+	bool is_absolute = build_dir[0] == '/' || build_dir[0] == '\\' || (build_dir[0] && build_dir[1] == ':');
+	if (!is_absolute)
+	{
+		char cwd[PATH_MAX + 1];
+		if (!getcwd(cwd, PATH_MAX)) return;
+		build_dir = file_append_path(cwd, build_dir);
+	}
+	exec_cache_dir = file_append_path(build_dir, "exec");
+}
+
 void execute_scripts(void)
 {
+	exec_cache_init();
 	if (!vec_size(compiler.build.exec)) return;
 	if (compiler.build.trust_level < TRUST_FULL)
 	{
@@ -1269,7 +1661,7 @@ void execute_scripts(void)
 		}
 		scratch_buffer_clear();
 		scratch_buffer_append_len(call.ptr, call.len);
-		script = compile_and_invoke(scratch_buffer_copy(), execs.len ? execs.ptr : "", NULL, 2048);
+		script = compile_and_invoke(scratch_buffer_copy(), execs.len ? execs.ptr : "", NULL, 2048, false);
 PRINT_SCRIPT:;
 		size_t out_len = script->content_len;
 		const char *out = script->contents;
@@ -1459,6 +1851,7 @@ void compile()
 	compiler.context.core_module = compiler_find_or_create_module(core_path, NULL);
 	CompilationUnit *unit = CALLOCS(CompilationUnit);
 	unit->file = source_file_generate("core_internal.c3");
+	unit->safe_mode = SAFETY_NOT_SET;
 	unit->module = compiler.context.core_module;
 	compiler.context.core_unit = unit;
 	target_setup(&compiler.build);
@@ -1487,6 +1880,8 @@ void compile()
 	setup_int_define("C_LONG_LONG_SIZE", compiler.platform.width_c_long_long, type_int);
 	setup_int_define("REGISTER_SIZE", compiler.platform.width_register, type_int);
 	setup_int_define("MAX_VECTOR_SIZE", compiler.build.max_vector_size, type_int);
+	setup_bool_define("VECTOR_BYTE_SHUFFLE", target_has_byte_shuffle());
+	setup_int_define("INT_VECTOR_SIZE", target_int_vector_bits(), type_int);
 	setup_bool_define("C_CHAR_IS_SIGNED", compiler.platform.signed_c_char);
 	setup_bool_define("PLATFORM_BIG_ENDIAN", compiler.platform.big_endian);
 	setup_bool_define("PLATFORM_I128_SUPPORTED", compiler.platform.int128);
@@ -1606,7 +2001,7 @@ Module *compiler_find_or_create_module(Path *module_name, const char **parameter
 	module->stage = ANALYSIS_NOT_BEGUN;
 	module->parameters = parameters;
 	module->is_generic = vec_size(parameters) > 0;
-	htable_init(&module->symbols, 0x1000);
+	htable_init(&module->symbols, 256);
 	htable_set(&compiler.context.modules, (void *)module_name->module, module);
 	if (parameters)
 	{
@@ -1630,7 +2025,7 @@ const char *scratch_buffer_interned(void)
 const char *scratch_buffer_interned_as(TokenType* type)
 {
 	return symtab_add(scratch_buffer.str, scratch_buffer.len,
-	                  fnv1a(scratch_buffer.str, scratch_buffer.len), type);
+	                  symtab_hash(scratch_buffer.str, scratch_buffer.len), type);
 }
 
 void scratch_buffer_append_native_safe_path(const char *data, int len)
@@ -1657,7 +2052,170 @@ void scratch_buffer_append_native_safe_path(const char *data, int len)
 #endif
 }
 
-File *compile_and_invoke(const char *file, const char *args, const char *stdin_data, size_t limit)
+/**
+ * Record a file read during compilation that isn't a source file, like an
+ * $embed file or an $exec script. Files that can't be found are ignored.
+ */
+void compiler_add_input_file(const char *path)
+{
+	char *full_path = realpath(path, NULL);
+	if (!full_path) return;
+	vec_add(compiler.context.input_paths, str_copy(full_path, strlen(full_path)));
+	free(full_path);
+}
+
+/**
+ * The absolute paths of all files the build depends on: the sources, $include,
+ * $embed and $exec files and the project file.
+ */
+const char **compiler_input_files(void)
+{
+	const char **files = NULL;
+	FOREACH(File *, file, compiler.context.loaded_sources)
+	{
+		if (source_file_is_on_disk(file)) vec_add(files, file->full_path);
+	}
+	FOREACH(const char *, path, compiler.context.input_paths) vec_add(files, path);
+	const char *project_files[2] = { PROJECT_JSON5, PROJECT_JSON };
+	for (int i = 0; i < 2; i++)
+	{
+		char *full_path = realpath(project_files[i], NULL);
+		if (!full_path) continue;
+		vec_add(files, str_copy(full_path, strlen(full_path)));
+		free(full_path);
+	}
+	return files;
+}
+
+static int exec_compare_paths(const void *a, const void *b)
+{
+	return strcmp(*(const char **)a, *(const char **)b);
+}
+
+// The scripts are compiled against the standard library the compiler finds, so it is part of the key.
+static uint64_t exec_stdlib_hash(void)
+{
+	static uint64_t stdlib_hash = 0;
+	if (stdlib_hash) return stdlib_hash;
+	uint64_t hash = FNV1_64_SEED;
+	const char *lib_dir = find_lib_dir();
+	if (lib_dir)
+	{
+		const char **files = NULL;
+		file_add_wildcard_files(&files, lib_dir, true, c3_suffix_list, 3);
+		unsigned count = vec_size(files);
+		// Directory order differs between file systems.
+		if (count) qsort(files, count, sizeof(const char *), exec_compare_paths);
+		hash = fnv1a_64(lib_dir, strlen(lib_dir) + 1, hash);
+		FOREACH(const char *, path, files)
+		{
+			size_t size;
+			char *source = file_read_all(path, &size);
+			hash = fnv1a_64(path, strlen(path) + 1, hash);
+			hash = fnv1a_64(source, size, hash);
+		}
+	}
+	stdlib_hash = hash ? hash : 1;
+	return stdlib_hash;
+}
+
+static uint64_t exec_script_hash(const char *compiler_path, const char *files)
+{
+	uint64_t hash = FNV1_64_SEED;
+	const char *identity[] = { COMPILER_VERSION, GIT_HASH, compiler_path };
+	for (unsigned i = 0; i < ELEMENTLEN(identity); i++)
+	{
+		hash = fnv1a_64(identity[i], strlen(identity[i]) + 1, hash);
+	}
+	uint64_t stdlib_hash = exec_stdlib_hash();
+	hash = fnv1a_64(&stdlib_hash, sizeof(stdlib_hash), hash);
+	StringSlice slice = slice_from_string(files);
+	while (slice.len > 0)
+	{
+		StringSlice file_name = slice_next_token(&slice, ';');
+		if (!file_name.len) continue;
+		const char *path = str_copy(file_name.ptr, file_name.len);
+		size_t size;
+		char *source = file_read_all(path, &size);
+		hash = fnv1a_64(path, file_name.len + 1, hash);
+		hash = fnv1a_64(source, size, hash);
+	}
+	return hash;
+}
+
+static const char *exec_output_cache_name(uint64_t script_hash, const char *args, const char *stdin_data)
+{
+	uint64_t hash = fnv1a_64(&script_hash, sizeof(script_hash), FNV1_64_SEED);
+	hash = fnv1a_64(args, strlen(args) + 1, hash);
+	// Separate "no stdin" from an empty stdin.
+	hash = fnv1a_64(stdin_data ? "1" : "0", 1, hash);
+	if (stdin_data) hash = fnv1a_64(stdin_data, strlen(stdin_data), hash);
+	return file_append_path(exec_cache_dir, str_printf("c3out_%016llx.txt", (unsigned long long)hash));
+}
+
+static void exec_output_cache_store(const char *cache_name, const char *out)
+{
+	// Write to a temporary first, so a concurrent build never sees a partial result.
+	char *temp_name = file_temp_name(cache_name);
+	FILE *file = fopen(temp_name, "wb");
+	if (file)
+	{
+		size_t len = strlen(out);
+		bool written = fwrite(out, 1, len, file) == len;
+		written = !fclose(file) && written;
+		if (!written || rename(temp_name, cache_name)) file_delete_file(temp_name);
+	}
+	free(temp_name);
+}
+
+typedef struct
+{
+	const char *path;
+	int64_t mtime;
+} ExecCacheEntry;
+
+static int exec_cache_entry_compare(const void *a, const void *b)
+{
+	int64_t mtime_a = ((const ExecCacheEntry *)a)->mtime;
+	int64_t mtime_b = ((const ExecCacheEntry *)b)->mtime;
+	return mtime_a < mtime_b ? 1 : (mtime_a > mtime_b ? -1 : 0);
+}
+
+// Only keep the most recently used scripts and outputs, as every edit of a script adds an entry.
+static void exec_cache_prune(void)
+{
+	const char *suffixes[2] = { EXEC_CACHE_SUFFIX, ".txt" };
+	const char **files = NULL;
+	file_add_wildcard_files(&files, exec_cache_dir, false, suffixes, 2);
+	if (vec_size(files) <= EXEC_CACHE_MAX_ENTRIES) return;
+	ExecCacheEntry *entries = NULL;
+	FOREACH(const char *, path, files)
+	{
+		const char *name = strrchr(path, '/');
+#if PLATFORM_WINDOWS
+		const char *win_name = strrchr(path, '\\');
+		if (win_name > name) name = win_name;
+#endif
+		name = name ? name + 1 : path;
+		// Leave temporaries alone, they belong to builds in progress.
+		if (strstr(name, ".tmp")) continue;
+		if (!str_start_with(name, "c3exec_") && !str_start_with(name, "c3out_")) continue;
+		size_t size;
+		int64_t mtime;
+		if (!file_size_and_mtime(path, &size, &mtime)) continue;
+		vec_add(entries, ((ExecCacheEntry) { path, mtime }));
+	}
+	unsigned count = vec_size(entries);
+	if (count <= EXEC_CACHE_MAX_ENTRIES) return;
+	qsort(entries, count, sizeof(ExecCacheEntry), exec_cache_entry_compare);
+	for (unsigned i = EXEC_CACHE_MAX_ENTRIES; i < count; i++)
+	{
+		DEBUG_LOG("Pruning '%s' from the exec cache.", entries[i].path);
+		file_delete_file(entries[i].path);
+	}
+}
+
+File *compile_and_invoke(const char *file, const char *args, const char *stdin_data, size_t limit, bool cache_output)
 {
 	char *name;
 	if (!file_namesplit(compiler_exe_name, &name, NULL))
@@ -1665,13 +2223,52 @@ File *compile_and_invoke(const char *file, const char *args, const char *stdin_d
 		error_exit("Failed to extract file name from '%s'", compiler_exe_name);
 	}
 	const char *compiler_path = file_append_path(find_executable_path(), name);
+	StringSlice scripts = slice_from_string(file);
+	while (scripts.len > 0)
+	{
+		StringSlice file_name = slice_next_token(&scripts, ';');
+		if (file_name.len) compiler_add_input_file(str_copy(file_name.ptr, file_name.len));
+	}
+
+	// Reuse the executable if the same script was already compiled, in this build or an earlier one.
+	const char *output = "__c3exec__";
+	const char *compile_output = output;
+	const char *output_cache = NULL;
+	bool cached = false;
+	if (exec_cache_dir && (file_is_dir(exec_cache_dir) || dir_make_recursive(str_copy(exec_cache_dir, strlen(exec_cache_dir)))))
+	{
+		uint64_t hash = exec_script_hash(compiler_path, file);
+		if (cache_output)
+		{
+			output_cache = exec_output_cache_name(hash, args, stdin_data);
+			if (file_exists(output_cache))
+			{
+				DEBUG_LOG("Reusing the output of '%s' from '%s'.", file, output_cache);
+				file_touch(output_cache);
+				size_t size;
+				return source_file_text_load(file, file_read_all(output_cache, &size));
+			}
+		}
+		output = file_append_path(exec_cache_dir, str_printf("c3exec_%016llx" EXEC_CACHE_SUFFIX, (unsigned long long)hash));
+		cached = true;
+		if (file_exists(output))
+		{
+			DEBUG_LOG("Reusing compiled script '%s'.", output);
+			file_touch(output);
+			goto INVOKE;
+		}
+		// Compile to a name of our own and rename it into place, so a concurrent build
+		// never runs a partially written executable.
+		char *temp_name = file_temp_name(output);
+		compile_output = str_cat(temp_name, EXEC_CACHE_SUFFIX);
+		free(temp_name);
+	}
 
 	scratch_buffer_clear();
 #if PLATFORM_WINDOWS
 	scratch_buffer_append_char('"');
 #endif
 	scratch_buffer_append_native_safe_path(compiler_path, (int)strlen(compiler_path));
-	const char *output = "__c3exec__";
 	scratch_buffer_append(" compile -g0 --single-module=yes");
 	StringSlice slice = slice_from_string(file);
 	while (slice.len > 0)
@@ -1681,13 +2278,15 @@ File *compile_and_invoke(const char *file, const char *args, const char *stdin_d
 		scratch_buffer_append(" ");
 		scratch_buffer_append_native_safe_path(file_name.ptr, (int)file_name.len);
 	}
-	scratch_buffer_printf(" -o %s", output);
+	scratch_buffer_append(" -o ");
+	scratch_buffer_append_native_safe_path(compile_output, (int)strlen(compile_output));
 	char *out;
 #if PLATFORM_WINDOWS
 	scratch_buffer_append_char('"');
 #endif
 	if (!execute_cmd_failable(scratch_buffer_to_string(), &out, NULL, limit))
 	{
+		if (cached) file_delete_file(compile_output);
 		if (strlen(out))
 		{
 			eprintf("+-- Script compilation output ---------+\n");
@@ -1697,11 +2296,22 @@ File *compile_and_invoke(const char *file, const char *args, const char *stdin_d
 		error_exit("Failed to compile script '%s'.", file);
 	}
 	DEBUG_LOG("EXEC OUT: %s", out);
+	if (cached)
+	{
+		// If another build got there first, its executable is just as good.
+		if (rename(compile_output, output) != 0)
+		{
+			if (!file_exists(output)) error_exit("Failed to move the compiled script to '%s'.", output);
+			file_delete_file(compile_output);
+		}
+		exec_cache_prune();
+	}
+INVOKE:
 	scratch_buffer_clear();
 #if (!PLATFORM_WINDOWS)
-	scratch_buffer_append("./");
+	if (!cached) scratch_buffer_append("./");
 #endif
-	scratch_buffer_append(output);
+	scratch_buffer_append_native_safe_path(output, (int)strlen(output));
 	scratch_buffer_append(" ");
 	scratch_buffer_append(args);
 	if (!execute_cmd_failable(scratch_buffer_to_string(), &out, stdin_data, limit))
@@ -1714,7 +2324,12 @@ File *compile_and_invoke(const char *file, const char *args, const char *stdin_d
 		}
 		error_exit("Error invoking script '%s' with arguments %s.", file, args);
 	}
-	file_delete_file(output);
+	if (!cached) file_delete_file(output);
+	if (output_cache)
+	{
+		exec_output_cache_store(output_cache, out);
+		exec_cache_prune();
+	}
 	return source_file_text_load(file, out);
 }
 
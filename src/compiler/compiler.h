@@ -17,5 +17,9 @@ void symtab_init(uint32_t max_size);
 void symtab_destroy();
 void print_syntax(BuildOptions *options);
 void vendor_fetch(BuildOptions *options);
+void compiler_daemon(BuildOptions *options, int *argc_ref, const char ***argv_ref);
+int compiler_daemon_request(const char *socket_path, int argc, const char **argv);
+void compiler_watch(BuildOptions *options);
+void compiler_watch_report(void);
 
 extern const char* c3_suffix_list[3];
@@ -37,13 +37,15 @@ typedef uint16_t FileId;
 #define MAX_ARRAYINDEX INT32_MAX
 #define MAX_FIXUPS 0xFFFFF
 #define MAX_HASH_SIZE (512 * 1024 * 1024)
-#define INVALID_SPAN ((SourceSpan){ .row = 0 })
+#define INVALID_SPAN ((SourceSpan){ .pos = 0 })
 #define MAX_SCOPE_DEPTH 0x100
 #define MAX_STRING_BUFFER 0x10000
 #define INITIAL_SYMBOL_MAP 0x10000
 #define INITIAL_GENERIC_SYMBOL_MAP 0x1000
 #define MAX_INCLUDE_DIRECTIVES 2048
+#define EMBED_INCBIN_MIN_SIZE (64 * 1024)
 #define MAX_MACRO_ITERATIONS 0xFFFFFF
+#define MAX_MACRO_MEMOS 64
 #define MAX_PARAMS 255
 #define MAX_BITSTRUCT 0x1000
 #define MAX_MEMBERS ((StructIndex)1) << 15
@@ -52,6 +54,7 @@ typedef uint16_t FileId;
 #define MAX_TYPE_SIZE UINT32_MAX
 #define MAX_GLOBAL_DECL_STACK (65536)
 #define MEMCMP_INLINE_REGS 8
+#define MIN_STRING_DISPATCH_CASES 4
 #define UINT128_MAX ((Int128) { UINT64_MAX, UINT64_MAX })
 #define INT128_MAX ((Int128) { INT64_MAX, UINT64_MAX })
 #define INT128_MIN ((Int128) { (uint64_t)INT64_MIN, 0 })
@@ -65,7 +68,7 @@ typedef uint16_t FileId;
 #define PRINT_ERROR_LAST(...) print_error_at(c->prev_span, __VA_ARGS__)
 #define RETURN_PRINT_ERROR_LAST(...) do { print_error_at(c->prev_span, __VA_ARGS__); return false; } while (0)
 #define SEMA_NOTE(_node, ...) sema_note_prev_at((_node)->span, __VA_ARGS__)
-#define SEMA_DEPRECATED(_node, ...) do { if (compiler.build.test_output && !compiler.build.silence_deprecation) print_error_at((_node)->span, __VA_ARGS__); if (!compiler.build.silence_deprecation) \
+#define SEMA_DEPRECATED(_node, ...) do { compiler.context.warnings_found++; if (compiler.build.test_output && !compiler.build.silence_deprecation) print_error_at((_node)->span, __VA_ARGS__); if (!compiler.build.silence_deprecation) \
  sema_note_prev_at((_node)->span, __VA_ARGS__); } while (0)
 
 #define EXPAND_EXPR_STRING(str_) (str_)->const_expr.bytes.len, (str_)->const_expr.bytes.ptr
@@ -128,6 +131,8 @@ struct ConstInitializer_
 			ConstInitializer **elements;
 		} init_array;
 		ConstInitializer **init_array_full;
+		// Packed little-endian integer or bool elements, the length is given by the array type.
+		const char *init_array_bytes;
 		struct
 		{
 			ConstInitializer *element;
@@ -179,20 +184,31 @@ typedef struct
 	char *name;
 	char *dir_path;
 	const char *full_path;
+	// The offsets where each line starts, built when a location is first decoded.
+	uint32_t *line_offsets;
+	uint32_t last_line;
 } File;
 
+// Spans only hold the byte position, the row and column are decoded
+// from the file with span_location when they are needed.
 typedef union
 {
 	struct
 	{
 		FileId file_id;
-		unsigned char length;
-		unsigned char col;
-		uint32_t row;
+		uint16_t length;
+		// The byte offset in the file plus one, 0 means there is no location.
+		uint32_t pos;
 	};
 	uint64_t a;
 } SourceSpan;
 
+typedef struct
+{
+	uint32_t row;
+	uint32_t col;
+} SourceLoc;
+
 
 static_assert(sizeof(SourceSpan) == 8, "Expected 8 bytes");
 
@@ -210,17 +226,18 @@ typedef struct
 	SEntry *entries;
 } STable;
 
-typedef struct SEntry2_
+typedef struct
 {
 	void *key;
 	void *value;
-	struct SEntry2_ *next;
 } HTEntry;
 
 typedef struct
 {
-	uint32_t mask;
-	HTEntry **entries;
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t max_load;
+	HTEntry *entries;
 } HTable;
 
 
@@ -270,11 +287,6 @@ struct Type_
 	CanonicalType *canonical;
 	const char *name;
 	union
-	{
-		Type **type_cache;
-		Type *func_ptr;
-	};
-	union
 	{
 		void *backend_type;
 		struct
@@ -353,6 +365,7 @@ typedef struct
 	const char **links;
 	const char *section;
 	const char *wasm_module;
+	const char **target_clones;
 	SourceSpan overload;
 } ResolvedAttrData;
 
@@ -417,6 +430,7 @@ typedef struct VarDecl_
 	bool in_param : 1;
 	bool is_written : 1;
 	bool is_addr : 1;
+	bool ref_taken : 1; // The address of the variable itself was taken, rather than that of an element.
 	bool self_addr : 1;
 	bool is_threadlocal : 1;
 	bool no_init : 1;
@@ -495,6 +509,13 @@ struct Signature_
 	Decl** params;
 };
 
+typedef struct MacroMemo_
+{
+	Expr **args;
+	Expr *result;
+	struct MacroMemo_ *next;
+} MacroMemo;
+
 typedef struct
 {
 	TypeInfoId type_parent;
@@ -522,8 +543,11 @@ typedef struct
 			bool attr_nosanitize_address : 1;
 			bool attr_nosanitize_memory : 1;
 			bool attr_nosanitize_thread : 1;
+			bool safety_override : 1; // Set by @safe, on the function or its module.
+			bool safe_mode : 1;
 			bool is_lambda : 1;
 			bool in_macro : 1;
+			bool has_temp_new : 1;
 			union
 			{
 				uint32_t priority;
@@ -583,10 +607,20 @@ typedef struct
 	AstId parent;
 } LabelDecl;
 
+// Fields most declarations don't have, allocated on demand.
+typedef struct
+{
+	const char *extname;
+	union
+	{
+		Attr **attributes;
+		ResolvedAttrData *attrs_resolved;
+	};
+} DeclCold;
+
 typedef struct Decl_
 {
 	const char *name;
-	const char *extname;
 	SourceSpan span;
 	DeclKind decl_kind : 7;
 	ResolveStatus resolve_status : 3;
@@ -615,6 +649,7 @@ typedef struct Decl_
 	bool attr_nopadding : 1;
 	bool attr_compact : 1;
 	bool resolved_attributes : 1;
+	bool debug_type_emitted : 1;
 	union
 	{
 		void *backend_ref;
@@ -628,11 +663,7 @@ typedef struct Decl_
 	AlignSize padding;
 	AlignSize alignment;
 	struct CompilationUnit_ *unit;
-	union
-	{
-		Attr **attributes;
-		ResolvedAttrData *attrs_resolved;
-	};
+	DeclCold *cold;
 	Type *type;
 	union
 	{
@@ -671,7 +702,7 @@ typedef struct Decl_
 	};
 } Decl;
 
-static_assert(sizeof(void*) != 8 || sizeof(Decl) == 136, "Decl has unexpected size.");
+static_assert(sizeof(void*) != 8 || sizeof(Decl) == 128, "Decl has unexpected size.");
 
 typedef enum RangeType
 {
@@ -775,6 +806,7 @@ typedef struct
 
 typedef struct {
 	bool start_from_end : 1;
+	bool in_range : 1; // Proven to be in range by the enclosing loop.
 	ExprId expr;
 } SubscriptIndex;
 
@@ -1220,7 +1252,11 @@ typedef struct
 	bool no_exit : 1;
 	bool skip_first : 1;
 	bool if_chain : 1;
+	bool clustered : 1;
+	bool string_dispatch : 1;
 	bool jump : 1;
+	bool vectorize : 1;
+	uint8_t unroll;
 } FlowCommon;
 
 typedef struct
@@ -1254,6 +1290,24 @@ typedef struct
 	void *backend_block;
 } AstCaseStmt;
 
+typedef struct
+{
+	void *exit_block;
+	union
+	{
+		struct {
+			void *block;
+			void *var;
+		} retry;
+		struct {
+			uint16_t count;
+			int16_t min_index;
+			int16_t default_index;
+			void *jmptable;
+		} jump;
+	};
+} SwitchCodegen;
+
 
 typedef struct
 {
@@ -1267,23 +1321,8 @@ typedef struct
 			AstId defer;
 			Ast *scope_defer;
 		};
-		struct
-		{
-			void *exit_block;
-			union
-			{
-				struct {
-					void *block;
-					void *var;
-				} retry;
-				struct {
-					uint16_t count;
-					int16_t min_index;
-					int16_t default_index;
-					void *jmptable;
-				} jump;
-			};
-		} codegen;
+		// Only valid while the switch body is emitted.
+		SwitchCodegen *codegen;
 	};
 } AstSwitchStmt;
 
@@ -1504,7 +1543,7 @@ typedef struct Ast_
 } Ast;
 
 
-static_assert(sizeof(void*) != 8 || sizeof(Ast) == 56, "Not expected Ast size");
+static_assert(sizeof(void*) != 8 || sizeof(Ast) == 48, "Not expected Ast size");
 
 typedef struct Module_
 {
@@ -1532,6 +1571,10 @@ typedef struct Module_
 	Decl **tests;
 	Decl **lambdas_to_evaluate;
 	const char *generic_suffix;
+	// Instantiation statistics, only kept on the generic module.
+	unsigned generic_instances;
+	size_t generic_copied_nodes;
+	double generic_instantiation_time;
 } Module;
 
 
@@ -1587,10 +1630,6 @@ typedef struct
 	const char *file_begin;
 	const char *lexing_start;
 	const char *current;
-	uint32_t current_row;
-	uint32_t start_row;
-	const char *line_start;
-	const char *start_row_start;
 	File *file;
 	TokenData data;
 	SourceSpan tok_span;
@@ -1626,6 +1665,7 @@ struct CompilationUnit_
 	bool is_interface_file;
 	bool benchmark_by_default;
 	bool test_by_default;
+	SafetyLevel safe_mode;
 	Attr **attr_links;
 	Decl **generic_defines;
 	Decl **ct_asserts;
@@ -1642,6 +1682,8 @@ struct CompilationUnit_
 	Decl *main_function;
 	HTable local_symbols;
 	int lambda_count;
+	// The part of a split module this file is generated in, see --codegen-units.
+	unsigned codegen_unit;
 	Decl **local_method_extensions;
 	TypeInfo **check_type_variable_array;
 	struct
@@ -1812,12 +1854,25 @@ typedef struct
 {
 	void *original;
 	void *new_ptr;
+	uint32_t shadowed; // Earlier fixup (index + 1) for the same original, 0 if none.
 } CopyFixup;
 
+typedef struct
+{
+	void *original;
+	uint32_t generation;
+	uint32_t fixup; // Index + 1 of the innermost fixup, 0 if it went out of scope.
+} CopyFixupSlot;
+
 typedef struct CopyStruct_
 {
 	CopyFixup fixups[MAX_FIXUPS];
 	CopyFixup *current_fixup;
+	CopyFixupSlot *slots;
+	uint32_t slot_mask;
+	uint32_t slots_used;
+	uint32_t generation;
+	uint64_t total_fixups;
 	bool single_static;
 	bool copy_in_use;
 	bool is_template;
@@ -1828,6 +1883,44 @@ typedef struct
 	const char **links;
 } Linking;
 
+// A C source compile, prepared on the main thread and run as a task.
+typedef struct
+{
+	const char *file;
+	const char *out_name;
+	const char *command;
+	const char **argv;
+	const char *dep_file;
+	char *cache_key;
+	size_t cache_key_len;
+	uint64_t cache_hash;
+	bool cached;
+	int status;
+	Task task;
+} CCompile;
+
+// A large $embed, which is mapped rather than read and can be emitted with .incbin.
+typedef struct
+{
+	const char *data;
+	size_t len;
+	const char *path;
+	uint64_t hash;
+} EmbedFile;
+
+/**
+ * A loop where `index` stays below the length of the local slice `slice`,
+ * or, when there is no slice, below `len`.
+ */
+typedef struct
+{
+	Decl *index;
+	Decl *slice;
+	ArraySize len;
+	Expr **subscripts;
+	bool modified;
+} LoopRange;
+
 typedef struct
 {
 	bool should_print_environment;
@@ -1842,10 +1935,13 @@ typedef struct
 	const char *lib_dir;
 	const char **sources;
 	File **loaded_sources;
+	HTable loaded_sources_by_path;
 	bool in_panic_mode : 1;
 	unsigned errors_found;
 	unsigned warnings_found;
 	unsigned includes_used;
+	unsigned call_site_evals;
+	HTable macro_memos;
 	Decl ***locals_list;
 	HTable compiler_defines;
 	HTable features;
@@ -1856,11 +1952,17 @@ typedef struct
 	Type *string_type;
 	Decl *panic_var;
 	Decl *panicf;
+	Decl *target_clones_resolver;
+	Decl *init_audit;
+	bool uses_target_clones;
 	Decl *io_error_file_not_found;
+	EmbedFile *embeds;
+	const char **input_paths;
 	Decl *main;
 	Decl *decl_stack[MAX_GLOBAL_DECL_STACK];
 	Decl **decl_stack_bottom;
 	Decl **decl_stack_top;
+	LoopRange **loop_ranges;
 } GlobalContext;
 
 typedef struct
@@ -1903,6 +2005,7 @@ extern const char *type_property_list[NUMBER_OF_TYPE_PROPERTIES];
 extern const char *kw_std__core;
 extern const char *kw_std__core__types;
 extern const char *kw_std__core__runtime;
+extern const char *kw_std__core__mem;
 extern const char *kw_std__io;
 extern const char *kw_typekind;
 extern const char *kw_FILE_NOT_FOUND;
@@ -1930,6 +2033,7 @@ extern const char *kw_out;
 extern const char *kw_ptr;
 extern const char *kw_return;
 extern const char *kw_self;
+extern const char *kw_tnew;
 extern const char *kw_std;
 extern const char *kw_type;
 extern const char *kw_winmain;
@@ -1963,6 +2067,15 @@ INLINE bool safe_mode_enabled(void)
 	return compiler.build.feature.safe_mode != SAFETY_OFF;
 }
 
+/**
+ * Whether runtime checks are emitted in a function, which may be overridden by @safe.
+ */
+INLINE bool safe_mode_enabled_in(Decl *func)
+{
+	if (func && func->decl_kind == DECL_FUNC && func->func_decl.safety_override) return func->func_decl.safe_mode;
+	return safe_mode_enabled();
+}
+
 INLINE bool link_libc(void)
 {
 	return compiler.build.link_libc != LINK_LIBC_OFF;
@@ -1973,6 +2086,38 @@ INLINE bool strip_unused(void)
 	return compiler.build.strip_unused != STRIP_UNUSED_OFF;
 }
 
+INLINE bool strip_introspection(void)
+{
+	return compiler.build.strip_introspection == STRIP_INTROSPECTION_ON;
+}
+
+INLINE bool incremental_build(void)
+{
+	return compiler.build.incremental == INCREMENTAL_ON;
+}
+
+INLINE bool thin_lto(void)
+{
+	return compiler.build.thin_lto == THIN_LTO_ON;
+}
+
+INLINE bool debug_dedup(void)
+{
+	// A static library member is only linked in when it's referenced, so it can't be trusted to hold the type.
+	return compiler.build.debug_dedup == DEBUG_DEDUP_ON && compiler.build.debug_info == DEBUG_INFO_FULL
+		&& compiler.build.type != TARGET_TYPE_STATIC_LIB;
+}
+
+INLINE bool split_dwarf(void)
+{
+	return compiler.build.split_dwarf == SPLIT_DWARF_ON && compiler.build.debug_info != DEBUG_INFO_NONE;
+}
+
+INLINE bool pgo_instrument(void)
+{
+	return compiler.build.pgo_instrument == PGO_INSTRUMENT_ON;
+}
+
 INLINE bool no_stdlib(void)
 {
 	return compiler.build.use_stdlib == USE_STDLIB_OFF;
@@ -1997,11 +2142,22 @@ INLINE Ast *ast_next(AstId *current_ptr);
 
 const char *span_to_string(SourceSpan span);
 void span_to_scratch(SourceSpan span);
+File *source_file_by_id(FileId file);
+SourceLoc span_location(SourceSpan span);
+INLINE uint32_t span_row(SourceSpan span)
+{
+	return span_location(span).row;
+}
 
 static inline SourceSpan extend_span_with_token(SourceSpan loc, SourceSpan after)
 {
-	if (loc.row != after.row) return loc;
-	loc.length = after.col + after.length - loc.col;
+	if (!loc.pos || loc.file_id != after.file_id || after.pos < loc.pos) return loc;
+	uint32_t end = after.pos + after.length;
+	if (end - loc.pos > UINT16_MAX) return loc;
+	// Spans over several lines keep the length of the first token.
+	const char *start = source_file_by_id(loc.file_id)->contents + loc.pos - 1;
+	if (memchr(start, '\n', end - loc.pos)) return loc;
+	loc.length = (uint16_t)(end - loc.pos);
 	return loc;
 }
 
@@ -2108,6 +2264,7 @@ UNUSED bool i128_get_bit(const Int128 *op, int bit);
 
 void copy_begin(void);
 void copy_end(void);
+uint64_t copy_total_fixups(void);
 Expr *copy_expr_single(Expr *source_expr);
 Decl **copy_decl_list_single(Decl **decl_list);
 Decl **copy_decl_list_single_for_unit(Decl **decl_list);
@@ -2149,9 +2306,11 @@ void cast_no_check(Expr *expr, Type *to_type, bool add_optional);
 bool cast_to_index_len(SemaContext *context, Expr *index, bool is_len);
 
 const char *llvm_codegen(void *context);
+size_t llvm_codegen_cost(void *context);
 const char *tilde_codegen(void *context);
 void **c_gen(Module** modules, unsigned module_count);
 void **llvm_gen(Module** modules, unsigned module_count);
+void llvm_codegen_warm_up(void);
 void **tilde_gen(Module** modules, unsigned module_count);
 
 void header_gen(Module **modules, unsigned module_count);
@@ -2195,6 +2354,7 @@ void decl_append_links_to_global(Decl *decl);
 INLINE bool decl_ok(Decl *decl);
 INLINE bool decl_poison(Decl *decl);
 INLINE bool decl_is_struct_type(Decl *decl);
+INLINE bool decl_needs_eager_introspection(Decl *decl);
 INLINE bool decl_is_user_defined_type(Decl *decl);
 INLINE Decl *decl_flatten(Decl *decl);
 static inline Decl *decl_raw(Decl *decl);
@@ -2224,6 +2384,7 @@ const char *expr_kind_to_string(ExprKind kind);
 bool expr_is_simple(Expr *expr, bool to_float);
 bool expr_is_pure(Expr *expr);
 bool expr_is_runtime_const(Expr *expr);
+Decl *expr_find_dynamic_target(Expr *expr, Decl *dyn_fn, Decl *func);
 Expr *expr_generate_decl(Decl *decl, Expr *assign);
 Expr *expr_new_two(Expr *first, Expr *second);
 void expr_rewrite_two(Expr *original, Expr *first, Expr *second);
@@ -2292,6 +2453,8 @@ bool lexer_next_token(Lexer *lexer);
 void scratch_buffer_append_module(Module *module, bool is_export);
 Decl *module_find_symbol(Module *module, const char *symbol);
 const char *module_create_object_file_name(Module *module);
+const char *module_setting_lookup(Module *module, const char **entries);
+SafetyLevel module_safe_mode(Module *module);
 
 bool parse_file(File *file);
 Decl **parse_include_file(File *file, CompilationUnit *unit);
@@ -2312,6 +2475,10 @@ Decl *sema_decl_stack_find_decl_member(SemaContext *context, Decl *decl_owner, c
 Decl *sema_decl_stack_resolve_symbol(const char *symbol);
 void sema_decl_stack_restore(Decl **state);
 void sema_decl_stack_push(Decl *decl);
+void sema_var_assigned(Decl *decl);
+void sema_var_ref_taken(Decl *decl);
+void sema_loop_range_add_subscript(Expr *subscript, Expr *parent, Expr *index);
+void sema_loop_range_move_subscript(Expr *from, Expr *to);
 
 bool sema_error_failed_cast(SemaContext *context, Expr *expr, Type *from, Type *to);
 bool sema_add_local(SemaContext *context, Decl *decl);
@@ -2380,12 +2547,15 @@ void sema_shadow_error(SemaContext *context, Decl *decl, Decl *old);
 
 bool sema_type_error_on_binop(SemaContext *context, Expr *expr);
 
-File *source_file_by_id(FileId file);
 File *source_file_load(const char *filename, bool *already_loaded, const char **error);
+File **source_files_load(const char **filenames, int threads);
 File *source_file_generate(const char *filename);
 File *source_file_text_load(const char *filename, char *content);
+bool source_file_is_on_disk(File *file);
 
-File *compile_and_invoke(const char *file, const char *args, const char *stdin_data, size_t limit);
+void compiler_add_input_file(const char *path);
+const char **compiler_input_files(void);
+File *compile_and_invoke(const char *file, const char *args, const char *stdin_data, size_t limit, bool cache_output);
 void compiler_parse(void);
 void emit_json(void);
 
@@ -2396,6 +2566,7 @@ void *stable_get(STable *table, const char *key);
 void htable_init(HTable *table, uint32_t initial_size);
 void *htable_set(HTable *table, void *key, void *value);
 void *htable_get(HTable *table, void *key);
+uint32_t htable_count(HTable *table);
 
 UNUSED void stable_clear(STable *table);
 
@@ -2407,12 +2578,44 @@ const char *scratch_buffer_interned(void);
 const char *scratch_buffer_interned_as(TokenType *type);
 
 const char *symtab_preset(const char *data, TokenType type);
-const char *symtab_add(const char *symbol, uint32_t len, uint32_t fnv1hash, TokenType *type);
-const char *symtab_find(const char *symbol, uint32_t len, uint32_t fnv1hash, TokenType *type);
+void symtab_print_stats(void);
+const char *symtab_add(const char *symbol, uint32_t len, uint32_t hash, TokenType *type);
+const char *symtab_find(const char *symbol, uint32_t len, uint32_t hash, TokenType *type);
+
+// The hash used for the symtab. It consumes the symbol a word at a time,
+// which is much cheaper than FNV1a for long identifiers.
+INLINE uint32_t symtab_hash(const char *symbol, uint32_t len)
+{
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ len;
+	while (len >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, symbol, 8);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 32;
+		symbol += 8;
+		len -= 8;
+	}
+	if (len)
+	{
+		uint64_t word = 0;
+		memcpy(&word, symbol, len);
+		hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+	}
+	hash ^= hash >> 29;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 32;
+	return (uint32_t)hash;
+}
+
+void llvm_target_init(void);
 void *llvm_target_machine_create(void);
 void codegen_setup_object_names(Module *module, const char **ir_filename, const char **asm_filename, const char **object_filename);
 void target_setup(BuildTarget *build_target);
+bool x86_feature_name_is_valid(const char *name);
 int target_alloca_addr_space();
+bool target_has_byte_shuffle(void);
+int target_int_vector_bits(void);
 bool os_is_apple(OsType os_type);
 bool os_supports_stacktrace(OsType os_type);
 bool arch_is_wasm(ArchType type);
@@ -3206,6 +3409,40 @@ INLINE bool decl_poison(Decl *decl)
 	decl->decl_kind = DECL_POISONED; decl->resolve_status = RESOLVE_DONE; return false;
 }
 
+INLINE DeclCold *decl_cold(Decl *decl)
+{
+	if (!decl->cold) decl->cold = CALLOCS(DeclCold);
+	return decl->cold;
+}
+
+INLINE const char *decl_extname(Decl *decl)
+{
+	return decl->cold ? decl->cold->extname : NULL;
+}
+
+INLINE void decl_set_extname(Decl *decl, const char *extname)
+{
+	if (extname || decl->cold) decl_cold(decl)->extname = extname;
+}
+
+// Once resolved, the raw attributes are replaced by the resolved data.
+INLINE Attr **decl_attributes(Decl *decl)
+{
+	if (decl->resolved_attributes || !decl->cold) return NULL;
+	return decl->cold->attributes;
+}
+
+INLINE void decl_set_attributes(Decl *decl, Attr **attributes)
+{
+	ASSERT(!decl->resolved_attributes);
+	if (attributes || decl->cold) decl_cold(decl)->attributes = attributes;
+}
+
+INLINE ResolvedAttrData *decl_attrs_resolved(Decl *decl)
+{
+	return decl->resolved_attributes && decl->cold ? decl->cold->attrs_resolved : NULL;
+}
+
 static inline Decl *decl_raw(Decl *decl)
 {
 	while (decl->decl_kind == DECL_ALIAS)
@@ -3224,6 +3461,12 @@ INLINE bool decl_is_struct_type(Decl *decl)
 	return (kind == DECL_UNION) | (kind == DECL_STRUCT);
 }
 
+// Dynamic enums are referenced as external from other modules, so they are always emitted.
+INLINE bool decl_needs_eager_introspection(Decl *decl)
+{
+	return !strip_introspection() || (decl->decl_kind == DECL_ENUM && decl->is_dynamic);
+}
+
 INLINE bool decl_is_user_defined_type(Decl *decl)
 {
 	DeclKind kind = decl->decl_kind;
@@ -3306,6 +3549,11 @@ ConstInitializer *const_init_new_value(Expr *value);
 ConstInitializer *const_init_new_array(Type *type, ConstInitializer **elements) UNUSED;
 ConstInitializer *const_init_new_struct(Type *type, Expr **elements);
 ConstInitializer *const_init_new_array_full(Type *type, ConstInitializer **elements);
+ConstInitializer *const_init_new_array_bytes(Type *type, const char *bytes);
+bool const_init_type_may_be_packed(Type *flattened);
+Int const_init_bytes_int_at(ConstInitializer *init, ArrayIndex index);
+void const_init_bytes_rewrite_expr_at(ConstInitializer *init, ArrayIndex index, Expr *expr);
+void const_init_expand_bytes(ConstInitializer *init);
 ConstInitializer *const_init_new_zero_array_value(Type *type, ArrayIndex index);
 ConstInitializer *const_init_new_array_value(Expr *expr, ArrayIndex index);
 bool const_init_is_zero(ConstInitializer *init);
@@ -3319,6 +3567,7 @@ static inline void const_init_set_span(ConstInitializer *init, SourceSpan loc)
 	switch (init->kind)
 	{
 		case CONST_INIT_ZERO:
+		case CONST_INIT_ARRAY_BYTES:
 			return;
 		case CONST_INIT_STRUCT:
 		{
@@ -3574,7 +3823,8 @@ bool static_lib_linker(const char *output_file, const char **files, unsigned fil
 bool dynamic_lib_linker(const char *output_file, const char **files, unsigned file_count);
 bool linker(const char *output_file, const char **files, unsigned file_count);
 void platform_linker(const char *output_file, const char **files, unsigned file_count);
-const char *cc_compiler(const char *cc, const char *file, const char *flags, const char **include_dirs, const char *output_subdir);
+CCompile *cc_compiler_prepare(const char *cc, const char *file, const char *flags, const char **include_dirs, const char *output_subdir);
+void cc_compiler_finish(CCompile *compile);
 const char *arch_to_linker_arch(ArchType arch);
 extern char swizzle[256];
 
@@ -3789,6 +4039,20 @@ INLINE void expr_rewrite_enum_from_ord(Expr *expr, Type *type)
 }
 
 
+/**
+ * A subscript needs no bounds check if its loop proved it in range, and neither the
+ * indexed variable nor the index had its address taken anywhere in the function.
+ */
+INLINE bool expr_subscript_in_range(Expr *expr)
+{
+	if (!expr->subscript_expr.index.in_range) return false;
+	Expr *parent = exprptr(expr->subscript_expr.expr);
+	Expr *index = exprptr(expr->subscript_expr.index.expr);
+	if (parent->expr_kind == EXPR_IDENTIFIER && parent->ident_expr->decl_kind == DECL_VAR && parent->ident_expr->var.ref_taken) return false;
+	if (index->expr_kind == EXPR_IDENTIFIER && index->ident_expr->decl_kind == DECL_VAR && index->ident_expr->var.ref_taken) return false;
+	return true;
+}
+
 INLINE void expr_rewrite_slice_len(Expr *expr, Expr *inner, Type *type)
 {
 	ASSERT(inner->resolve_status == RESOLVE_DONE);
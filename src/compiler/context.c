@@ -9,7 +9,8 @@ CompilationUnit *unit_create(File *file)
 	CompilationUnit *unit = CALLOCS(CompilationUnit);
 	unit->file = file;
 	unit->is_interface_file = str_has_suffix(file->name, ".c3i");
-	htable_init(&unit->local_symbols, 1024);
+	unit->safe_mode = SAFETY_NOT_SET;
+	htable_init(&unit->local_symbols, 256);
 	return unit;
 }
 
@@ -1,10 +1,13 @@
 #include "compiler_internal.h"
 
 #define SCOPE_FIXUP_START do { CopyFixup *current = c->current_fixup;
-#define SCOPE_FIXUP_END c->current_fixup = current; } while (0)
+#define SCOPE_FIXUP_END copy_pop_fixups(c, current); } while (0)
+
+#define COPY_FIXUP_INITIAL_SLOTS 4096
 
 static inline void copy_const_initializer(CopyStruct *c, ConstInitializer **initializer_ref);
 static inline void copy_reg_ref(CopyStruct *c, void *original, void *result);
+static inline void copy_pop_fixups(CopyStruct *c, CopyFixup *current);
 static inline void *fixup(CopyStruct *c, void *original);
 INLINE void fixup_decl(CopyStruct *c, Decl **decl_ref);
 INLINE void fixup_declid(CopyStruct *c, DeclId *declid_ref);
@@ -18,30 +21,79 @@ static Decl *copy_decl(CopyStruct *c, Decl *decl);
 static Decl **copy_decl_list(CopyStruct *c, Decl **decl_list);
 static TypeInfo *copy_type_info(CopyStruct *c, TypeInfo *source);
 
+/**
+ * Find the slot for the original pointer, this is either the slot already holding it
+ * or the empty slot where it should be inserted. Slots from earlier copies count as empty.
+ */
+static inline CopyFixupSlot *copy_find_slot(CopyStruct *c, void *original)
+{
+	uint32_t mask = c->slot_mask;
+	uint32_t index = (uint32_t)((((uintptr_t)original) >> 3) * 0x9E3779B97F4A7C15ull >> 32) & mask;
+	while (true)
+	{
+		CopyFixupSlot *slot = &c->slots[index];
+		if (slot->generation != c->generation || slot->original == original) return slot;
+		index = (index + 1) & mask;
+	}
+}
+
+static void copy_grow_slots(CopyStruct *c)
+{
+	uint32_t slot_count = c->slots ? (c->slot_mask + 1) * 2 : COPY_FIXUP_INITIAL_SLOTS;
+	free(c->slots);
+	c->slots = ccalloc(sizeof(CopyFixupSlot), slot_count);
+	c->slot_mask = slot_count - 1;
+	c->generation = 1;
+	c->slots_used = 0;
+	// Re-insert the live fixups, the shadow chains are kept in the fixups themselves.
+	for (CopyFixup *entry = c->fixups; entry != c->current_fixup; entry++)
+	{
+		CopyFixupSlot *slot = copy_find_slot(c, entry->original);
+		if (slot->generation != c->generation)
+		{
+			*slot = (CopyFixupSlot) { .original = entry->original, .generation = c->generation };
+			c->slots_used++;
+		}
+		slot->fixup = (uint32_t)(entry - c->fixups) + 1;
+	}
+}
+
 static inline void copy_reg_ref(CopyStruct *c, void *original, void *result)
 {
+	CopyFixupSlot *slot = copy_find_slot(c, original);
+	if (slot->generation != c->generation)
+	{
+		*slot = (CopyFixupSlot) { .original = original, .generation = c->generation };
+		c->slots_used++;
+	}
 	c->current_fixup->new_ptr = result;
 	c->current_fixup->original = original;
+	c->current_fixup->shadowed = slot->fixup;
+	slot->fixup = (uint32_t)(c->current_fixup - c->fixups) + 1;
 	c->current_fixup++;
 	if (c->current_fixup == &c->fixups[MAX_FIXUPS])
 	{
 		error_exit("Too many fix-ups for macros.");
 	}
+	// Keep the load factor below 1/2, slots of out of scope fixups included.
+	if (c->slots_used * 2 > c->slot_mask) copy_grow_slots(c);
 }
 
-static inline void *fixup(CopyStruct *c, void *original)
+static inline void copy_pop_fixups(CopyStruct *c, CopyFixup *current)
 {
-	CopyFixup *fixup_entry = c->current_fixup;
-	CopyFixup *first = &c->fixups[0];
-	while (fixup_entry != first)
+	while (c->current_fixup != current)
 	{
-		fixup_entry--;
-		if (original == fixup_entry->original)
-		{
-			return fixup_entry->new_ptr;
-		}
+		CopyFixup *entry = --c->current_fixup;
+		copy_find_slot(c, entry->original)->fixup = entry->shadowed;
 	}
-	return NULL;
+}
+
+static inline void *fixup(CopyStruct *c, void *original)
+{
+	c->total_fixups++;
+	CopyFixupSlot *slot = copy_find_slot(c, original);
+	if (slot->generation != c->generation || !slot->fixup) return NULL;
+	return c->fixups[slot->fixup - 1].new_ptr;
 }
 
 INLINE void fixup_decl(CopyStruct *c, Decl **decl_ref)
@@ -244,6 +296,9 @@ static inline void copy_const_initializer(CopyStruct *c, ConstInitializer **init
 		case CONST_INIT_ARRAY_FULL:
 			copy->init_array_full = copy_const_initializer_list(c, copy->init_array_full);
 			return;
+		case CONST_INIT_ARRAY_BYTES:
+			// The packed bytes are never mutated, so they can be shared.
+			return;
 		case CONST_INIT_ARRAY_VALUE:
 			copy_const_initializer(c, &copy->init_array_value.element);
 			return;
@@ -801,6 +856,17 @@ Ast **copy_ast_list(CopyStruct *c, Ast **to_copy)
 void copy_begin(void)
 {
 	copy_struct.current_fixup = copy_struct.fixups;
+	if (!copy_struct.slots)
+	{
+		copy_grow_slots(&copy_struct);
+	}
+	else if (!++copy_struct.generation)
+	{
+		// Bumping the generation empties all slots without touching them, unless it wraps.
+		memset(copy_struct.slots, 0, sizeof(CopyFixupSlot) * (copy_struct.slot_mask + 1));
+		copy_struct.generation = 1;
+	}
+	copy_struct.slots_used = 0;
 	ASSERT(!copy_struct.copy_in_use);
 	copy_struct.copy_in_use = true;
 	copy_struct.single_static = false;
@@ -812,6 +878,11 @@ void copy_end(void)
 	copy_struct.copy_in_use = false;
 }
 
+uint64_t copy_total_fixups(void)
+{
+	return copy_struct.total_fixups;
+}
+
 Decl **copy_decl_list_macro(Decl **decl_list)
 {
 	ASSERT(copy_struct.copy_in_use);
@@ -951,7 +1022,6 @@ void copy_decl_type(Decl *decl)
 	if (!type) return;
 	Type *copy = type_new(type->type_kind, type->name);
 	*copy = *type;
-	copy->type_cache = NULL;
 	copy->decl = decl;
 	copy->canonical = copy;
 	decl->type = copy;
@@ -972,13 +1042,18 @@ Decl *copy_decl(CopyStruct *c, Decl *decl)
 	if (c->single_static && decl_is_resolved_static_var(decl)) return decl;
 	Decl *copy = decl_copy(decl);
 	copy_reg_ref(c, decl, copy);
-	if (decl->resolved_attributes)
-	{
-		copy->attrs_resolved = copy_attrs_resolved(c, copy->attrs_resolved);
-	}
-	else
+	if (decl->cold)
 	{
-		copy->attributes = copy_attributes(c, copy->attributes);
+		copy->cold = MALLOCS(DeclCold);
+		*copy->cold = *decl->cold;
+		if (decl->resolved_attributes)
+		{
+			copy->cold->attrs_resolved = copy_attrs_resolved(c, copy->cold->attrs_resolved);
+		}
+		else
+		{
+			copy->cold->attributes = copy_attributes(c, copy->cold->attributes);
+		}
 	}
 	switch (decl->decl_kind)
 	{
@@ -0,0 +1,276 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
+#include "compiler_internal.h"
+#include <errno.h>
+
+// The daemon loads the compiler and sets up the LLVM targets and intrinsic
+// tables once, then forks for every request, so each request starts from a
+// copy of that state.
+//
+// A request is a uint32_t byte count, sent together with the client's stdin,
+// stdout and stderr, followed by the client's working directory, environment
+// and arguments as zero terminated strings, with an empty string ending the
+// environment. When the request is done, its exit code is sent back as an int32_t.
+
+#if PLATFORM_WINDOWS
+
+void compiler_daemon(BuildOptions *options, int *argc_ref, const char ***argv_ref)
+{
+	error_exit("The daemon is not supported on Windows.");
+}
+
+int compiler_daemon_request(const char *socket_path, int argc, const char **argv)
+{
+	return -1;
+}
+
+#else
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+static const char *daemon_exe;
+
+static bool daemon_socket_address(struct sockaddr_un *addr, const char *path)
+{
+	if (strlen(path) >= sizeof(addr->sun_path)) return false;
+	*addr = (struct sockaddr_un) { .sun_family = AF_UNIX };
+	strcpy(addr->sun_path, path);
+	return true;
+}
+
+static bool daemon_write(int fd, const void *data, size_t len)
+{
+	const char *ptr = data;
+	while (len)
+	{
+		ssize_t written = write(fd, ptr, len);
+		if (written < 0 && errno == EINTR) continue;
+		if (written <= 0) return false;
+		ptr += written;
+		len -= (size_t)written;
+	}
+	return true;
+}
+
+static bool daemon_read(int fd, void *data, size_t len)
+{
+	char *ptr = data;
+	while (len)
+	{
+		ssize_t read_len = read(fd, ptr, len);
+		if (read_len < 0 && errno == EINTR) continue;
+		if (read_len <= 0) return false;
+		ptr += read_len;
+		len -= (size_t)read_len;
+	}
+	return true;
+}
+
+int compiler_daemon_request(const char *socket_path, int argc, const char **argv)
+{
+	// This runs before the compiler is set up, so only use malloc and return -1
+	// on failure, in which case the request is compiled locally instead.
+	struct sockaddr_un addr;
+	if (!daemon_socket_address(&addr, socket_path)) return -1;
+	char cwd[PATH_MAX];
+	if (!getcwd(cwd, sizeof(cwd))) return -1;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	// Pack the directory, the environment and the arguments, leaving out the --daemon option.
+	size_t size = strlen(cwd) + 2;
+	for (char **env = environ; *env; env++) size += strlen(*env) + 1;
+	for (int i = 0; i < argc; i++) size += strlen(argv[i]) + 1;
+	char *payload = malloc(size);
+	size_t used = strlen(cwd) + 1;
+	memcpy(payload, cwd, used);
+	for (char **env = environ; *env; env++)
+	{
+		// An empty string ends the environment, so it can't be sent.
+		size_t len = strlen(*env) + 1;
+		if (len == 1) continue;
+		memcpy(payload + used, *env, len);
+		used += len;
+	}
+	payload[used++] = 0;
+	for (int i = 0; i < argc; i++)
+	{
+		if (i > 0 && str_eq(argv[i], "--daemon"))
+		{
+			i++;
+			continue;
+		}
+		size_t len = strlen(argv[i]) + 1;
+		memcpy(payload + used, argv[i], len);
+		used += len;
+	}
+
+	uint32_t len = (uint32_t)used;
+	int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	char control[CMSG_SPACE(sizeof(fds))];
+	memset(control, 0, sizeof(control));
+	struct iovec iov = { .iov_base = &len, .iov_len = sizeof(len) };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control) };
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+	if (sendmsg(fd, &msg, 0) != sizeof(len))
+	{
+		free(payload);
+		close(fd);
+		return -1;
+	}
+	int32_t result;
+	bool success = daemon_write(fd, payload, used) && daemon_read(fd, &result, sizeof(result));
+	free(payload);
+	close(fd);
+	if (!success)
+	{
+		fprintf(stderr, "The daemon at '%s' failed to complete the request.\n", socket_path);
+		return EXIT_FAILURE;
+	}
+	return result;
+}
+
+/**
+ * Handle a connection in its own process. This forks once more and only returns
+ * in the new child, which compiles the request with the client's stdin, stdout
+ * and stderr. The first child waits for it and sends the exit code to the client.
+ */
+static void daemon_serve(int conn, int *argc_ref, const char ***argv_ref)
+{
+	signal(SIGCHLD, SIG_DFL);
+	uint32_t len = 0;
+	int fds[3];
+	char control[CMSG_SPACE(sizeof(fds))];
+	struct iovec iov = { .iov_base = &len, .iov_len = sizeof(len) };
+	struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control, .msg_controllen = sizeof(control) };
+	if (recvmsg(conn, &msg, 0) != sizeof(len)) _exit(EXIT_FAILURE);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) _exit(EXIT_FAILURE);
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+	char *payload = malloc(len + 1);
+	if (!len || !daemon_read(conn, payload, len)) _exit(EXIT_FAILURE);
+	payload[len] = 0;
+
+	fflush(stdout);
+	fflush(stderr);
+	pid_t pid = fork();
+	if (pid < 0) _exit(EXIT_FAILURE);
+	if (!pid)
+	{
+		close(conn);
+		for (int i = 0; i < 3; i++)
+		{
+			dup2(fds[i], i);
+			close(fds[i]);
+		}
+		const char *cwd = payload;
+		if (chdir(cwd)) error_exit("Failed to change the directory to '%s'.", cwd);
+		// Use the client's environment, so that things like C3C_CC and PATH match a local compile.
+		char **env = NULL;
+		char *arg = payload + strlen(cwd) + 1;
+		for (; arg < payload + len && *arg; arg += strlen(arg) + 1)
+		{
+			vec_add(env, arg);
+		}
+		vec_add(env, NULL);
+		environ = env;
+		const char **args = NULL;
+		for (arg++; arg < payload + len; arg += strlen(arg) + 1)
+		{
+			vec_add(args, arg);
+		}
+		if (!args) error_exit("The request had no arguments.");
+		args[0] = daemon_exe;
+		*argc_ref = (int)vec_size(args);
+		vec_add(args, NULL);
+		*argv_ref = args;
+		return;
+	}
+	for (int i = 0; i < 3; i++) close(fds[i]);
+	int status;
+	while (waitpid(pid, &status, 0) < 0)
+	{
+		if (errno != EINTR) _exit(EXIT_FAILURE);
+	}
+	int32_t result = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+	daemon_write(conn, &result, sizeof(result));
+	_exit(EXIT_SUCCESS);
+}
+
+void compiler_daemon(BuildOptions *options, int *argc_ref, const char ***argv_ref)
+{
+	if (daemon_exe) error_exit("A daemon request cannot start another daemon.");
+	struct sockaddr_un addr;
+	if (!daemon_socket_address(&addr, options->daemon_socket)) error_exit("The socket path '%s' is too long.", options->daemon_socket);
+
+	// The requests change directory, so resolve the executable name first.
+	daemon_exe = compiler_exe_name;
+	if (strchr(compiler_exe_name, '/'))
+	{
+		const char *full_path = realpath(compiler_exe_name, NULL);
+		if (full_path) daemon_exe = full_path;
+	}
+
+#if LLVM_AVAILABLE
+	llvm_codegen_warm_up();
+#endif
+
+	int server = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server < 0) error_exit("Failed to create the daemon socket: %s.", strerror(errno));
+	// Only remove a socket left behind by a daemon that is gone, never one that still answers.
+	struct stat st;
+	if (!lstat(addr.sun_path, &st))
+	{
+		if (!S_ISSOCK(st.st_mode)) error_exit("'%s' exists and is not a socket.", options->daemon_socket);
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		bool answered = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+		if (probe >= 0) close(probe);
+		if (answered) error_exit("A daemon is already listening on '%s'.", options->daemon_socket);
+		unlink(addr.sun_path);
+	}
+	if (bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server, 64) < 0)
+	{
+		error_exit("Failed to listen on '%s': %s.", options->daemon_socket, strerror(errno));
+	}
+	// Each connection is answered by its own process, so they never need to be waited for.
+	signal(SIGCHLD, SIG_IGN);
+	printf("Daemon listening on '%s'.\n", options->daemon_socket);
+	fflush(stdout);
+	while (1)
+	{
+		int conn = accept(server, NULL, NULL);
+		if (conn < 0)
+		{
+			if (errno == EINTR) continue;
+			error_exit("Failed to accept a request: %s.", strerror(errno));
+		}
+		pid_t pid = fork();
+		if (pid < 0) error_exit("Failed to start a request: %s.", strerror(errno));
+		if (!pid)
+		{
+			close(server);
+			daemon_serve(conn, argc_ref, argv_ref);
+			return;
+		}
+		close(conn);
+	}
+}
+
+#endif
@@ -43,12 +43,13 @@ static void eprint_escaped_string(const char *message)
 
 static void print_error_type_at(SourceSpan location, const char *message, PrintType print_type)
 {
-	if (!location.a)
+	if (!location.pos)
 	{
 		eprintf("Unlocalized error: %s.\n", message);
 		return;
 	}
 	File *file = source_file_by_id(location.file_id);
+	SourceLoc loc = span_location(location);
 	if (compiler.build.lsp_output)
 	{
 		eprintf("> LSPERR|");
@@ -68,7 +69,7 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 		}
 		eprintf("|");
 		eprint_escaped_string(file->full_path);
-		eprintf("|%d|%d|", location.row, location.col);
+		eprintf("|%d|%d|", loc.row, loc.col);
 		eprint_escaped_string(message);
 		eprintf("\n");
 		return;
@@ -78,19 +79,19 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 		switch (print_type)
 		{
 			case PRINT_TYPE_ERROR:
-				eprintf("Error|%s|%d|%d|%s\n", file->full_path, location.row, location.col, message);
+				eprintf("Error|%s|%d|%d|%s\n", file->full_path, loc.row, loc.col, message);
 				return;
 			case PRINT_TYPE_NOTE:
 				// Note should not be passed on.
 				return;
 			case PRINT_TYPE_WARN:
-				eprintf("Warning|%s|%d|%d|%s\n", file->full_path, location.row, location.col, message);
+				eprintf("Warning|%s|%d|%d|%s\n", file->full_path, loc.row, loc.col, message);
 				return;
 			default:
 				UNREACHABLE
 		}
 	}
-	unsigned max_line_length = (unsigned)round(log10(location.row)) + 1;
+	unsigned max_line_length = (unsigned)round(log10(loc.row)) + 1;
 	unsigned max_lines_for_display = MAX_WIDTH - max_line_length - 2;
 	char number_buffer[20];
 	char number_buffer_elided[20];
@@ -102,7 +103,7 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 	// Insert end in case it's not yet there.
 
 	const char *file_contents = file->contents;
-	int64_t display_row = location.row;
+	int64_t display_row = loc.row;
 	int64_t row_start = display_row - LINES_SHOWN + 1;
 	if (row_start < 1) row_start = 1;
 	int64_t row = 1;
@@ -136,7 +137,7 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 	{
 		eprintf(" ");
 	}
-	unsigned col_location = location.col;
+	unsigned col_location = loc.col;
 	if (!col_location || col_location > max_lines_for_display) col_location = 0;
 	unsigned space_to = col_location ? col_location : max_lines_for_display - 1;
 	for (unsigned i = 0; i < space_to - 1; i++)
@@ -153,6 +154,11 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 	}
 	unsigned len = location.length;
 	if (!len) len = 1;
+	// Don't underline past the end of the line.
+	if (col_location && col_location - 1 + len > (unsigned)row_len)
+	{
+		len = (unsigned)row_len >= col_location ? (unsigned)row_len - col_location + 1 : 1;
+	}
 	if (col_location)
 	{
 		for (uint32_t i = 0; i < len; i++)
@@ -167,13 +173,13 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 		switch (print_type)
 		{
 			case PRINT_TYPE_ERROR:
-				eprintf("(%s:%d:%d) Error: %s\n\n", file->full_path, location.row, col_location, message);
+				eprintf("(%s:%d:%d) Error: %s\n\n", file->full_path, loc.row, col_location, message);
 				break;
 			case PRINT_TYPE_NOTE:
-				eprintf("(%s:%d:%d) Note: %s\n\n", file->full_path, location.row, col_location, message);
+				eprintf("(%s:%d:%d) Note: %s\n\n", file->full_path, loc.row, col_location, message);
 				break;
 			case PRINT_TYPE_WARN:
-				eprintf("(%s:%d:%d) Warning: %s\n\n", file->full_path, location.row, col_location, message);
+				eprintf("(%s:%d:%d) Warning: %s\n\n", file->full_path, loc.row, col_location, message);
 				break;
 			default:
 				UNREACHABLE
@@ -184,13 +190,13 @@ static void print_error_type_at(SourceSpan location, const char *message, PrintT
 		switch (print_type)
 		{
 			case PRINT_TYPE_ERROR:
-				eprintf("(%s:%d) Error: %s\n\n", file->full_path, location.row, message);
+				eprintf("(%s:%d) Error: %s\n\n", file->full_path, loc.row, message);
 				break;
 			case PRINT_TYPE_NOTE:
-				eprintf("(%s:%d) Note: %s\n\n", file->full_path, location.row, message);
+				eprintf("(%s:%d) Note: %s\n\n", file->full_path, loc.row, message);
 				break;
 			case PRINT_TYPE_WARN:
-				eprintf("(%s:%d) Warning: %s\n\n", file->full_path, location.row, message);
+				eprintf("(%s:%d) Warning: %s\n\n", file->full_path, loc.row, message);
 				break;
 			default:
 				UNREACHABLE
@@ -215,6 +221,7 @@ void sema_verror_range(SourceSpan location, const char *message, va_list args)
 void sema_vwarn_range(SourceSpan location, const char *message, va_list args)
 {
 	vprint_msg(location, message, args, PRINT_TYPE_WARN);
+	compiler.context.warnings_found++;
 }
 
 void sema_warning_at(SourceSpan loc, const char *message, ...)
@@ -223,6 +230,7 @@ void sema_warning_at(SourceSpan loc, const char *message, ...)
 	va_start(list, message);
 	print_error_type_at(loc, str_vprintf(message, list), PRINT_TYPE_NOTE);
 	va_end(list);
+	compiler.context.warnings_found++;
 }
 
 
@@ -236,7 +244,7 @@ void print_error_at(SourceSpan loc, const char *message, ...)
 
 void print_error_after(SourceSpan loc, const char *message, ...)
 {
-	loc.col += loc.length;
+	loc.pos += loc.length;
 	loc.length = 1;
 	va_list list;
 	va_start(list, message);
@@ -285,31 +293,11 @@ void print_error(ParseContext *context, const char *message, ...)
 	va_end(list);
 }
 
-// This function is fairly slow, which is a reflection on how
-// often it is supposed to be used.
 void span_to_scratch(SourceSpan span)
 {
-	File *file = source_file_by_id(span.file_id);
-	const char *current = file->contents;
-	uint32_t row = 1;
-	uint32_t row_to_find = span.row;
 	uint32_t length = span.length;
-	uint32_t col = span.col;
-	if (!row_to_find || !length || !col) return;
-	while (row < row_to_find)
-	{
-		switch (current++[0])
-		{
-			case '\0':
-				return;
-			case '\n':
-				row++;
-			default:
-				break;
-		}
-	}
-	ASSERT(row == row_to_find);
-	const char *start = current + col - 1;
+	if (!span.pos || !length) return;
+	const char *start = source_file_by_id(span.file_id)->contents + span.pos - 1;
 	bool last_was_whitespace = false;
 	for (uint32_t i = 0; i < length; i++)
 	{
@@ -325,41 +313,22 @@ void span_to_scratch(SourceSpan span)
 	}
 }
 
-// This function is fairly slow, which is a reflection on how
-// often it is supposed to be used.
 const char *span_to_string(SourceSpan span)
 {
-	File *file = source_file_by_id(span.file_id);
-	const char *current = file->contents;
-	uint32_t row = 1;
-	uint32_t row_to_find = span.row;
 	uint32_t length = span.length;
-	uint32_t col = span.col;
-	if (!row_to_find || !length || !col) return NULL;
-	while (row < row_to_find)
-	{
-		switch (current++[0])
-		{
-			case '\0':
-				return NULL;
-			case '\n':
-				row++;
-			default:
-				break;
-		}
-	}
-	ASSERT(row == row_to_find);
-	const char *start = current + col - 1;
+	if (!span.pos || !length) return NULL;
+	const char *start = source_file_by_id(span.file_id)->contents + span.pos - 1;
 	return str_copy(start, length);
 }
 
 void assert_print_line(SourceSpan span)
 {
-	if (span.row == 0)
+	if (!span.pos)
 	{
 		eprintf("Assert analysing code at unknown location:\n");
 		return;
 	}
 	File *file = source_file_by_id(span.file_id);
-	eprintf("Assert analysing '%s' at row %d, col %d.\n", file->name, span.row, span.col);
+	SourceLoc loc = span_location(span);
+	eprintf("Assert analysing '%s' at row %d, col %d.\n", file->name, loc.row, loc.col);
 }
@@ -305,12 +305,16 @@ typedef enum
 	ATTRIBUTE_PUBLIC,
 	ATTRIBUTE_PURE,
 	ATTRIBUTE_REFLECT,
+	ATTRIBUTE_SAFE,
 	ATTRIBUTE_SAFEMACRO,
 	ATTRIBUTE_SECTION,
 	ATTRIBUTE_TAG,
+	ATTRIBUTE_TARGET_CLONES,
 	ATTRIBUTE_TEST,
+	ATTRIBUTE_UNROLL,
 	ATTRIBUTE_UNUSED,
 	ATTRIBUTE_USED,
+	ATTRIBUTE_VECTORIZE,
 	ATTRIBUTE_WASM,
 	ATTRIBUTE_WEAK,
 	ATTRIBUTE_WINMAIN,
@@ -471,6 +475,8 @@ typedef enum
 	BUILTIN_MEMSET_INLINE,
 	BUILTIN_MIN,
 	BUILTIN_NEARBYINT,
+	BUILTIN_NONTEMPORAL_LOAD,
+	BUILTIN_NONTEMPORAL_STORE,
 	BUILTIN_OVERFLOW_ADD,
 	BUILTIN_OVERFLOW_MUL,
 	BUILTIN_OVERFLOW_SUB,
@@ -500,6 +506,7 @@ typedef enum
 	BUILTIN_SCATTER,
 	BUILTIN_SELECT,
 	BUILTIN_SET_ROUNDING_MODE,
+	BUILTIN_SHUFFLE,
 	BUILTIN_SPRINTF,
 	BUILTIN_STR_HASH,
 	BUILTIN_STR_UPPER,
@@ -511,6 +518,7 @@ typedef enum
 	BUILTIN_SQRT,
 	BUILTIN_SYSCALL,
 	BUILTIN_SYSCLOCK,
+	BUILTIN_SYSCLOCK_FENCED,
 	BUILTIN_TRAP,
 	BUILTIN_TRUNC,
 	BUILTIN_UNALIGNED_LOAD,
@@ -583,6 +591,7 @@ typedef enum
 	CONST_INIT_VALUE,
 	CONST_INIT_ARRAY,
 	CONST_INIT_ARRAY_FULL,
+	CONST_INIT_ARRAY_BYTES,
 	CONST_INIT_ARRAY_VALUE,
 } ConstInitType;
 
@@ -576,6 +576,7 @@ void expr_insert_addr(Expr *original)
 		*original = *original->unary_expr.expr;
 		return;
 	}
+	if (original->expr_kind == EXPR_IDENTIFIER) sema_var_ref_taken(original->ident_expr);
 	Expr *inner = expr_copy(original);
 	original->expr_kind = EXPR_UNARY;
 	Type *inner_type = inner->type;
@@ -605,6 +606,8 @@ static inline ConstInitializer *initializer_for_index(ConstInitializer *initiali
 		case CONST_INIT_UNION:
 		case CONST_INIT_VALUE:
 			return initializer;
+		case CONST_INIT_ARRAY_BYTES:
+			UNREACHABLE
 		case CONST_INIT_ARRAY_FULL:
 		{
 			unsigned len = vec_size(initializer->init_array_full);
@@ -737,6 +740,21 @@ Expr *expr_from_const_expr_at_index(Expr *expr, ArrayIndex index)
 }
 bool expr_rewrite_to_const_initializer_index(Type *list_type, ConstInitializer *list, Expr *result, unsigned index, bool from_back)
 {
+	if (list->kind == CONST_INIT_ARRAY_BYTES)
+	{
+		ArraySize len = list->type->array.len;
+		if (from_back)
+		{
+			if (index > len || !index)
+			{
+				expr_rewrite_to_const_zero(result, list->type->array.base);
+				return true;
+			}
+			index = len - index;
+		}
+		const_init_bytes_rewrite_expr_at(list, index, result);
+		return true;
+	}
 	ConstInitializer *initializer = initializer_for_index(list, index, from_back);
 	ConstInitType kind = initializer ? initializer->kind : CONST_INIT_ZERO;
 	switch (kind)
@@ -752,6 +770,7 @@ bool expr_rewrite_to_const_initializer_index(Type *list_type, ConstInitializer *
 		case CONST_INIT_UNION:
 		case CONST_INIT_ARRAY:
 		case CONST_INIT_ARRAY_FULL:
+		case CONST_INIT_ARRAY_BYTES:
 		case CONST_INIT_ARRAY_VALUE:
 			return false;
 		case CONST_INIT_VALUE:
@@ -920,6 +939,71 @@ bool expr_is_pure(Expr *expr)
 }
 
 
+static bool expr_var_is_func_param(Decl *var, Decl *func)
+{
+	if (!func) return true;
+	FOREACH(Decl *, param, func->func_decl.signature.params)
+	{
+		if (param == var) return true;
+	}
+	return false;
+}
+
+/**
+ * Find the method an interface call will end up in, when the type behind the
+ * interface value is known at the call site. This is the case when the value is
+ * made from a pointer, either directly or through locals and macro parameters
+ * that are never changed.
+ *
+ * @param expr the interface value the method is called on.
+ * @param dyn_fn the interface method.
+ * @param func the function containing the call, used to tell parameters apart from macro parameters.
+ * @return the implementing method or NULL if it isn't known.
+ */
+Decl *expr_find_dynamic_target(Expr *expr, Decl *dyn_fn, Decl *func)
+{
+	for (int depth = 0; depth < 16; depth++)
+	{
+		switch (expr->expr_kind)
+		{
+			case EXPR_RECAST:
+			case EXPR_RVALUE:
+				expr = expr->inner_expr;
+				continue;
+			case EXPR_IDENTIFIER:
+			{
+				Decl *var = expr->ident_expr;
+				if (var->decl_kind != DECL_VAR) return NULL;
+				VarDecl *decl = &var->var;
+				if (decl->is_written || decl->is_addr || decl->ref_taken || decl->is_static) return NULL;
+				if (decl->kind != VARDECL_LOCAL && decl->kind != VARDECL_PARAM) return NULL;
+				if (decl->kind == VARDECL_PARAM && expr_var_is_func_param(var, func)) return NULL;
+				if (!decl->init_expr) return NULL;
+				expr = decl->init_expr;
+				continue;
+			}
+			case EXPR_MAKE_ANY:
+			{
+				Expr *typeid = expr->make_any_expr.typeid;
+				if (!expr_is_const_typeid(typeid)) return NULL;
+				Type *type = typeid->const_expr.typeid->canonical;
+				if (!type_is_user_defined(type) || !type->decl) return NULL;
+				// Dynamic methods are looked up by name at runtime, so do the same here.
+				FOREACH(Decl *, method, type->decl->methods)
+				{
+					if (method->decl_kind != DECL_FUNC || !method->func_decl.attr_dynamic) continue;
+					if (method->name == dyn_fn->name) return method;
+				}
+				return NULL;
+			}
+			default:
+				return NULL;
+		}
+	}
+	return NULL;
+}
+
+
 bool expr_is_simple(Expr *expr, bool to_float)
 {
 	RETRY:
@@ -2,10 +2,10 @@
 // Use of this source code is governed by a LGPLv3.0
 // a copy of which can be found in the LICENSE file.
 
-#include "compiler_internal.h"
+#include "c_codegen_internal.h"
 
-#define PRINTF(x, ...) fprintf(c->file, x, ## __VA_ARGS__) /* NOLINT */
-#define INDENT() indent_line(c->file, indent)
+#define PRINTF(x, ...) cbuffer_printf(&c->out, x, ## __VA_ARGS__) /* NOLINT */
+#define INDENT() indent_line(&c->out, indent)
 
 typedef enum
 {
@@ -17,7 +17,7 @@ typedef enum
 
 typedef struct HeaderContext__
 {
-	FILE *file;
+	CBuffer out;
 	HTable *gen_decl;
 	HTable *gen_def;
 	Decl **type_queue;
@@ -55,13 +55,13 @@ INLINE bool header_try_gen_both(HeaderContext *c, Type *type)
 
 INLINE const char *decl_get_extname(Decl *decl)
 {
-	if (!decl->extname)
+	if (!decl_extname(decl))
 	{
 		decl->is_export = true;
 		scratch_buffer_set_extern_decl_name(decl, true);
-		decl->extname = scratch_buffer_copy();
+		decl_set_extname(decl, scratch_buffer_copy());
 	}
-	return decl->extname;
+	return decl_extname(decl);
 }
 
 static bool type_is_func_pointer(Type *type)
@@ -71,11 +71,11 @@ static bool type_is_func_pointer(Type *type)
 	return type->type_kind == TYPE_FUNC_PTR;
 }
 
-static void indent_line(FILE *file, int indent)
+static void indent_line(CBuffer *out, int indent)
 {
 	for (int i = 0; i < indent; i++)
 	{
-		fputc('\t', file);
+		cbuffer_append_len(out, "\t", 1);
 	}
 }
 
@@ -390,7 +390,7 @@ static void header_gen_struct_union_top(HeaderContext *c, Decl *decl, GenType ge
 		return;
 	}
 	header_ensure_member_types_exist(c, decl->strukt.members);
-	PRINTF("%s %s__\n", struct_union_str(decl), decl->extname);
+	PRINTF("%s %s__\n", struct_union_str(decl), decl_extname(decl));
 	PRINTF("{\n");
 	header_gen_members(c, 1, decl->strukt.members);
 	PRINTF("};\n");
@@ -400,12 +400,12 @@ static void header_gen_struct_union(HeaderContext *c, int indent, Decl *decl)
 {
 	if (!indent)
 	{
-		PRINTF("typedef %s %s__ %s;\n", struct_union_str(decl), decl->extname, decl->extname);
+		PRINTF("typedef %s %s__ %s;\n", struct_union_str(decl), decl_extname(decl), decl_extname(decl));
 	}
 	INDENT();
 	if (decl->name)
 	{
-		PRINTF("%s %s__\n", struct_union_str(decl), decl->extname);
+		PRINTF("%s %s__\n", struct_union_str(decl), decl_extname(decl));
 	}
 	else
 	{
@@ -636,13 +636,13 @@ static void header_gen_global_var(HeaderContext *c, Decl *decl, bool fn_globals,
 				PRINTF("(void*)0x%llx\n", (unsigned long long)init->const_expr.ptr);
 				return;
 			case CONST_STRING:
-				putc('\"', c->file);
+				cbuffer_append_len(&c->out, "\"", 1);
 				for (unsigned i = 0; i < init->const_expr.bytes.len; i++)
 				{
 					char ch = init->const_expr.bytes.ptr[i];
 					if (ch >= ' ' && ch <= 127 && ch != '"')
 					{
-						fputc(ch, c->file);
+						cbuffer_append_len(&c->out, &ch, 1);
 						continue;
 					}
 					PRINTF("\\x%02x", ch);
@@ -774,8 +774,7 @@ void header_gen(Module **modules, unsigned module_count)
 	{
 		filename = str_printf("%s.h", name);
 	}
-	FILE *file = fopen(filename, "w");
-	HeaderContext context = { .file = file, .gen_def = &table1, .gen_decl = &table2 };
+	HeaderContext context = { .gen_def = &table1, .gen_decl = &table2 };
 	HeaderContext *c = &context;
 	PRINTF("#include <stdint.h>\n");
 	PRINTF("#include <stddef.h>\n");
@@ -807,7 +806,12 @@ void header_gen(Module **modules, unsigned module_count)
 	header_gen_global_decls(c, modules, module_count, false);
 	process_queue(c);
 	header_gen_global_decls(c, modules, module_count, true);
-	fclose(file);
+	// Leave an unchanged header untouched, so that C code including it isn't rebuilt.
+	if (!file_write_if_changed(filename, c->out.data, c->out.len))
+	{
+		error_exit("Failed to write the header file '%s'.", filename);
+	}
+	cbuffer_free(&c->out);
 
 }
 
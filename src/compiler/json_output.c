@@ -1,4 +1,4 @@
-#include "compiler_internal.h"
+#include "c_codegen_internal.h"
 
 #define FOREACH_DECL(a__, modules__) \
 	unsigned module_count_ = vec_size(modules__); \
@@ -12,12 +12,17 @@
 	for (unsigned k_ = 0; k_ < decl_count_ + decl_cond_count_; k_++) { \
 	a__ = k_ < decl_count_ ? unit->global_decls[k_] : unit->global_cond_decls[k_ - decl_count_];
 
-#define PRINTF(string__, ...) fprintf(file, string__, ##__VA_ARGS__) /* NOLINT */
-#define PRINT(string__) fputs(string__, file) /* NOLINT */
+#define PRINTF(string__, ...) cbuffer_printf(out, string__, ##__VA_ARGS__) /* NOLINT */
+#define PRINT(string__) cbuffer_append(out, string__) /* NOLINT */
 #define FOREACH_DECL_END } } }
-#define INSERT_COMMA do { if (first) { first = false; } else { fputs(",\n", file); } } while(0)
+#define INSERT_COMMA do { if (first) { first = false; } else { cbuffer_append(out, ",\n"); } } while(0)
 
-static bool emit_docs(FILE *file, AstId contracts, int tabs)
+INLINE void json_putc(CBuffer *out, char c)
+{
+	cbuffer_append_len(out, &c, 1);
+}
+
+static bool emit_docs(CBuffer *out, AstId contracts, int tabs)
 {
 	if (!contracts) return false;
 	Ast *ast = astptr(contracts);
@@ -31,7 +36,7 @@ static bool emit_docs(FILE *file, AstId contracts, int tabs)
 		if (char_is_whitespace(c) || c < 31)
 		{
 			if (last_is_whitespace) continue;
-			fputc(' ', file);
+			json_putc(out, ' ');
 			last_is_whitespace = true;
 			continue;
 		}
@@ -51,30 +56,30 @@ static bool emit_docs(FILE *file, AstId contracts, int tabs)
 				}
 				else
 				{
-					fputc(c, file);
+					json_putc(out, c);
 				}
 		}
 	}
 	PRINT("\"");
 	return true;
 }
-static inline void emit_modules(FILE *file)
+static inline void emit_modules(CBuffer *out, Module **modules, Module **generic_modules)
 {
 
 	PRINT("\t\"modules\": [\n");
-	FOREACH_IDX(i, Module *, module, compiler.context.module_list)
+	FOREACH_IDX(i, Module *, module, modules)
 	{
-		if (i != 0) fputs(",\n", file);
+		if (i != 0) cbuffer_append(out, ",\n");
 		PRINTF("\t\t\"%s\"", module->name->module);
 	}
 	PRINT("\n\t],\n");
 	PRINT("\t\"generic_modules\": [\n");
-	FOREACH_IDX(j, Module *, module, compiler.context.generic_module_list)
+	FOREACH_IDX(j, Module *, module, generic_modules)
 	{
-		if (j != 0) fputs(",\n", file);
+		if (j != 0) cbuffer_append(out, ",\n");
 		PRINTF("\t\t\"%s\"", module->name->module);
 	}
-	fputs("\n\t],\n", file);
+	cbuffer_append(out, "\n\t],\n");
 }
 
 static inline const char *decl_type_to_string(Decl *type)
@@ -112,11 +117,11 @@ static inline const char *decl_type_to_string(Decl *type)
 	UNREACHABLE
 }
 
-void print_type(FILE *file, TypeInfo *type)
+void print_type(CBuffer *out, TypeInfo *type)
 {
 	if (type->resolve_status == RESOLVE_DONE)
 	{
-		fputs(type->type->name, file);
+		cbuffer_append(out, type->type->name);
 		return;
 	}
 	switch (type->kind)
@@ -129,7 +134,7 @@ void print_type(FILE *file, TypeInfo *type)
 			{
 				PRINTF("%s::", type->unresolved.path->module);
 			}
-			fputs(type->unresolved.name, file);
+			cbuffer_append(out, type->unresolved.name);
 			break;
 		case TYPE_INFO_TYPEOF:
 			scratch_buffer_clear();
@@ -146,36 +151,36 @@ void print_type(FILE *file, TypeInfo *type)
 			PRINTF("$typefrom(...)");
 			break;
 		case TYPE_INFO_ARRAY:
-			print_type(file, type->array.base);
+			print_type(out, type->array.base);
 			scratch_buffer_clear();
 			span_to_scratch(type->array.len->span);
 			PRINTF("[%s]", scratch_buffer_to_string());
 			break;
 		case TYPE_INFO_VECTOR:
-			print_type(file, type->array.base);
+			print_type(out, type->array.base);
 			scratch_buffer_clear();
 			span_to_scratch(type->array.len->span);
 			PRINTF("[<%s>]", scratch_buffer_to_string());
 			break;
 		case TYPE_INFO_INFERRED_ARRAY:
-			print_type(file, type->array.base);
-			fputs("[*]", file);
+			print_type(out, type->array.base);
+			cbuffer_append(out, "[*]");
 			break;
 		case TYPE_INFO_INFERRED_VECTOR:
-			print_type(file, type->array.base);
-			fputs("[<*>]", file);
+			print_type(out, type->array.base);
+			cbuffer_append(out, "[<*>]");
 			break;
 		case TYPE_INFO_SLICE:
-			print_type(file, type->array.base);
-			fputs("[]", file);
+			print_type(out, type->array.base);
+			cbuffer_append(out, "[]");
 			break;
 		case TYPE_INFO_POINTER:
-			print_type(file, type->array.base);
-			fputs("*", file);
+			print_type(out, type->array.base);
+			cbuffer_append(out, "*");
 			break;
 		case TYPE_INFO_GENERIC:
-			print_type(file, type->array.base);
-			fputs("{...}", file);
+			print_type(out, type->array.base);
+			cbuffer_append(out, "{...}");
 			break;
 	}
 	switch (type->subtype)
@@ -183,30 +188,30 @@ void print_type(FILE *file, TypeInfo *type)
 		case TYPE_COMPRESSED_NONE:
 			break;
 		case TYPE_COMPRESSED_PTR:
-			fputs("*", file);
+			cbuffer_append(out, "*");
 			break;
 		case TYPE_COMPRESSED_SUB:
-			fputs("[]", file);
+			cbuffer_append(out, "[]");
 			break;
 		case TYPE_COMPRESSED_SUBPTR:
-			fputs("[]*", file);
+			cbuffer_append(out, "[]*");
 			break;
 		case TYPE_COMPRESSED_PTRPTR:
-			fputs("**", file);
+			cbuffer_append(out, "**");
 			break;
 		case TYPE_COMPRESSED_PTRSUB:
-			fputs("*[]", file);
+			cbuffer_append(out, "*[]");
 			break;
 		case TYPE_COMPRESSED_SUBSUB:
-			fputs("[][]", file);
+			cbuffer_append(out, "[][]");
 			break;
 	}
 }
 
-void print_var_expr(FILE *file, Expr *expr);
+void print_var_expr(CBuffer *out, Expr *expr);
 
 
-void print_var_expr(FILE *file, Expr *expr)
+void print_var_expr(CBuffer *out, Expr *expr)
 {
 	scratch_buffer_clear();
 	span_to_scratch(expr->span);
@@ -219,65 +224,65 @@ void print_var_expr(FILE *file, Expr *expr)
 			case '\r':
 				break;
 			case '\\':
-				fputs("\\\\", file);
+				cbuffer_append(out, "\\\\");
 				break;
 			case '\n':
-				fputs("\\n", file);
+				cbuffer_append(out, "\\n");
 				break;
 			case '\"':
-				fputs("\\\"", file);
+				cbuffer_append(out, "\\\"");
 				break;
 			default:
-				fputc(c, file);
+				json_putc(out, c);
 				break;
 		}
 		++str;
 	}
 }
 
-INLINE void print_indent(FILE *file, int indent)
+INLINE void print_indent(CBuffer *out, int indent)
 {
 	for (int j = 0; j < indent; j++) PRINT("\t");
 }
-static inline void emit_members(FILE *file, Decl **members, int indent)
+static inline void emit_members(CBuffer *out, Decl **members, int indent)
 {
 	FOREACH_IDX(i, Decl *, member, members)
 	{
-		if (i != 0) fputs(",\n", file);
-		print_indent(file, indent);
+		if (i != 0) cbuffer_append(out, ",\n");
+		print_indent(out, indent);
 		PRINTF("\t\t\t\t{\n");
 		if (member->name)
 		{
-			print_indent(file, indent);
+			print_indent(out, indent);
 			PRINTF("\t\t\t\t\t\"name\": \"%s\",\n", member->name);
 		}
 		if (member->decl_kind == DECL_VAR)
 		{
-			print_indent(file, indent);
+			print_indent(out, indent);
 			PRINTF("\t\t\t\t\t\"type\": \"");
 			ASSERT(member->var.type_info);
-			print_type(file, type_infoptr(member->var.type_info));
+			print_type(out, type_infoptr(member->var.type_info));
 			PRINT("\"\n");
-			print_indent(file, indent);
+			print_indent(out, indent);
 			PRINTF("\t\t\t\t}");
 			continue;
 		}
-		print_indent(file, indent);
+		print_indent(out, indent);
 		PRINTF("\t\t\t\t\t\"inner\": ");
 		PRINT(member->decl_kind == DECL_STRUCT ? "\"struct\"" : "\"union\"");
 		PRINT(",\n");
-		print_indent(file, indent);
+		print_indent(out, indent);
 		PRINT("\t\t\t\t\t\"members\": [\n");
-		emit_members(file, member->strukt.members, indent + 2);
+		emit_members(out, member->strukt.members, indent + 2);
 		PRINT("\n");
-		print_indent(file, indent);
+		print_indent(out, indent);
 		PRINT("\t\t\t\t\t]\n");
-		print_indent(file, indent);
+		print_indent(out, indent);
 		PRINTF("\t\t\t\t}");
 	}
 
 }
-static inline void emit_type_data(FILE *file, Module *module, Decl *type)
+static inline void emit_type_data(CBuffer *out, Module *module, Decl *type)
 {
 	PRINT("\t\t{\n");
 	PRINTF("\t\t\t\"name\": \"%s::%s\",\n", module->name->module, type->name);
@@ -286,13 +291,13 @@ static inline void emit_type_data(FILE *file, Module *module, Decl *type)
 	{
 		case DECL_UNION:
 		case DECL_STRUCT:
-			fputs(",\n\t\t\t\"members\": [\n", file);
-			emit_members(file, type->strukt.members, 0);
-			fputs("\n\t\t\t]", file);
+			cbuffer_append(out, ",\n\t\t\t\"members\": [\n");
+			emit_members(out, type->strukt.members, 0);
+			cbuffer_append(out, "\n\t\t\t]");
 			break;
 		case DECL_DISTINCT:
 			PRINT(",\n\t\t\t\"type\": \"");
-			print_type(file, type->distinct);
+			print_type(out, type->distinct);
 			PRINTF("\",\n\t\t\t\"inline\": \"%s\"", type->is_substruct ? "true" : "false");
 			break;
 		default:
@@ -301,14 +306,14 @@ static inline void emit_type_data(FILE *file, Module *module, Decl *type)
 	PRINT("\n\t\t}");
 }
 
-static inline void emit_param(FILE *file, Decl *decl)
+static inline void emit_param(CBuffer *out, Decl *decl)
 {
-	fputs("\t\t\t\t{\n", file);
+	cbuffer_append(out, "\t\t\t\t{\n");
 	PRINTF("\t\t\t\t\t\"kind\": \"");
 	if (!decl)
 	{
 		PRINT("vaarg\"\n");
-		fputs("\t\t\t\t}", file);
+		cbuffer_append(out, "\t\t\t\t}");
 		return;
 	}
 	assert(decl->decl_kind == DECL_VAR);
@@ -333,60 +338,60 @@ static inline void emit_param(FILE *file, Decl *decl)
 	PRINTF("\t\t\t\t\t\"type\": \"");
 	if (decl->var.type_info)
 	{
-		print_type(file, type_infoptr(decl->var.type_info));
+		print_type(out, type_infoptr(decl->var.type_info));
 	}
 	else
 	{
-		fputs("", file);
+		cbuffer_append(out, "");
 	}
-	fputs("\"\n", file);
-	fputs("\t\t\t\t}", file);
+	cbuffer_append(out, "\"\n");
+	cbuffer_append(out, "\t\t\t\t}");
 }
-static inline void emit_func_data(FILE *file, Module *module, Decl *func)
+static inline void emit_func_data(CBuffer *out, Module *module, Decl *func)
 {
 	PRINT("\t\t{\n");
 	PRINTF("\t\t\t\"name\": \"%s::%s\",\n", module->name->module, func->name);
-	if (emit_docs(file, func->func_decl.docs, 3))
+	if (emit_docs(out, func->func_decl.docs, 3))
 	{
 		PRINTF(",\n");
 	}
 	PRINTF("\t\t\t\"rtype\": \"");
-	print_type(file, type_infoptr(func->func_decl.signature.rtype));
+	print_type(out, type_infoptr(func->func_decl.signature.rtype));
 	PRINTF("\",\n");
 	PRINT("\t\t\t\"params\": [\n");
 	FOREACH_IDX(i, Decl *, decl, func->func_decl.signature.params)
 	{
-		if (i != 0) fputs(",\n", file);
-		emit_param(file, decl);
+		if (i != 0) cbuffer_append(out, ",\n");
+		emit_param(out, decl);
 	}
-	fputs("\n\t\t\t]\n", file);
+	cbuffer_append(out, "\n\t\t\t]\n");
 
-	fputs("\n\t\t}", file);
+	cbuffer_append(out, "\n\t\t}");
 }
 
-static inline void emit_macro_data(FILE *file, Module *module, Decl *macro)
+static inline void emit_macro_data(CBuffer *out, Module *module, Decl *macro)
 {
 	PRINT("\t\t{\n");
 	PRINTF("\t\t\t\"name\": \"%s::%s\",\n", module->name->module, macro->name);
-	if (emit_docs(file, macro->func_decl.docs, 3))
+	if (emit_docs(out, macro->func_decl.docs, 3))
 	{
 		PRINTF(",\n");
 	}
 	if (macro->func_decl.signature.rtype)
 	{
 		PRINTF("\t\t\t\"rtype\": \"");
-		print_type(file, type_infoptr(macro->func_decl.signature.rtype));
+		print_type(out, type_infoptr(macro->func_decl.signature.rtype));
 		PRINTF("\",\n");
 	}
-	fputs("\t\t\t\"params\": [\n", file);
+	cbuffer_append(out, "\t\t\t\"params\": [\n");
 	FOREACH_IDX(i, Decl *, decl, macro->func_decl.signature.params)
 	{
-		if (i != 0) fputs(",\n", file);
-		emit_param(file, decl);
+		if (i != 0) cbuffer_append(out, ",\n");
+		emit_param(out, decl);
 	}
-	fputs("\n\t\t\t]\n", file);
+	cbuffer_append(out, "\n\t\t\t]\n");
 
-	fputs("\n\t\t}", file);
+	cbuffer_append(out, "\n\t\t}");
 }
 
 static inline bool decl_is_hidden(Decl *decl)
@@ -394,153 +399,191 @@ static inline bool decl_is_hidden(Decl *decl)
 	return decl->visibility > VISIBLE_PUBLIC;
 }
 
-static inline void emit_types(FILE *file)
+static inline void emit_types(CBuffer *out, Module **modules, Module **generic_modules)
 {
-	fputs("\t\"types\": [\n", file);
+	cbuffer_append(out, "\t\"types\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *type, compiler.context.module_list)
+		FOREACH_DECL(Decl *type, modules)
 					if (!decl_is_user_defined_type(type) && type->decl_kind != DECL_TYPEDEF) continue;
 					if (decl_is_hidden(type)) continue;
 					INSERT_COMMA;
-					emit_type_data(file, module, type);
+					emit_type_data(out, module, type);
 		FOREACH_DECL_END;
 	}
 
-	fputs("\n\t],\n", file);
-	fputs("\t\"generic_types\": [\n", file);
+	cbuffer_append(out, "\n\t],\n");
+	cbuffer_append(out, "\t\"generic_types\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *type, compiler.context.generic_module_list)
+		FOREACH_DECL(Decl *type, generic_modules)
 					if (!decl_is_user_defined_type(type) && type->decl_kind != DECL_TYPEDEF) continue;
 					if (decl_is_hidden(type)) continue;
 					INSERT_COMMA;
-					emit_type_data(file, module, type);
+					emit_type_data(out, module, type);
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t],\n", file);
+	cbuffer_append(out, "\n\t],\n");
 }
 
-static inline void emit_globals(FILE *file)
+static inline void emit_globals(CBuffer *out, Module **modules, Module **generic_modules)
 {
-	fputs("\t\"globals\": {\n", file);
+	cbuffer_append(out, "\t\"globals\": {\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *decl, compiler.context.module_list)
+		FOREACH_DECL(Decl *decl, modules)
 					if (decl->decl_kind != DECL_VAR || decl->var.kind != VARDECL_GLOBAL) continue;
 					if (decl_is_hidden(decl)) continue;
 					INSERT_COMMA;
                     PRINTF("\t\t\"%s::%s\": {\n", module->name->module, decl->name);
-                    fputs("\t\t\t\"type\": \"", file);
+                    cbuffer_append(out, "\t\t\t\"type\": \"");
                     if (decl->var.type_info)
                     {
-                        print_type(file, type_infoptr(decl->var.type_info));
+                        print_type(out, type_infoptr(decl->var.type_info));
                     }
                     else
                     {
-                        fputs("", file);
+                        cbuffer_append(out, "");
                     }
-                    fputs("\",\n", file);
-                    fputs("\t\t\t\"value\": \"", file);
-                    if (decl->var.init_expr) print_var_expr(file, decl->var.init_expr);
-                    fputs("\"\n\t\t}", file);
+                    cbuffer_append(out, "\",\n");
+                    cbuffer_append(out, "\t\t\t\"value\": \"");
+                    if (decl->var.init_expr) print_var_expr(out, decl->var.init_expr);
+                    cbuffer_append(out, "\"\n\t\t}");
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t},\n", file);
+	cbuffer_append(out, "\n\t},\n");
 }
 
-static inline void emit_constants(FILE *file)
+static inline void emit_constants(CBuffer *out, Module **modules, Module **generic_modules)
 {
-	fputs("\t\"constants\": [\n", file);
+	cbuffer_append(out, "\t\"constants\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *decl, compiler.context.module_list)
+		FOREACH_DECL(Decl *decl, modules)
                     if (decl->decl_kind != DECL_VAR || decl->var.kind != VARDECL_CONST) continue;
 					if (decl_is_hidden(decl)) continue;
 					INSERT_COMMA;
 					PRINT("\t\t{\n");
                     PRINTF("\t\t\"name\": \"%s::%s\",\n", module->name->module, decl->name);
-                    fputs("\t\t\t\"type\": \"", file);
+                    cbuffer_append(out, "\t\t\t\"type\": \"");
                     if (decl->var.type_info)
                     {
-                        print_type(file, type_infoptr(decl->var.type_info));
+                        print_type(out, type_infoptr(decl->var.type_info));
                     }
                     else
                     {
-                        fputs("", file);
+                        cbuffer_append(out, "");
                     }
-                    fputs("\",\n", file);
-                    fputs("\t\t\t\"value\": \"", file);
-                    print_var_expr(file, decl->var.init_expr);
-                    fputs("\"\n\t\t}", file);
+                    cbuffer_append(out, "\",\n");
+                    cbuffer_append(out, "\t\t\t\"value\": \"");
+                    print_var_expr(out, decl->var.init_expr);
+                    cbuffer_append(out, "\"\n\t\t}");
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t]", file);
+	cbuffer_append(out, "\n\t]");
 }
 
-static inline void emit_functions(FILE *file)
+static inline void emit_functions(CBuffer *out, Module **modules, Module **generic_modules)
 {
-	fputs("\t\"functions\": [\n", file);
+	cbuffer_append(out, "\t\"functions\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *func, compiler.context.module_list)
+		FOREACH_DECL(Decl *func, modules)
 					if (func->decl_kind != DECL_FUNC) continue;
 					if (decl_is_hidden(func)) continue;
 					INSERT_COMMA;
-					emit_func_data(file, module, func);
+					emit_func_data(out, module, func);
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t],\n", file);
-	fputs("\t\"macros\": [\n", file);
+	cbuffer_append(out, "\n\t],\n");
+	cbuffer_append(out, "\t\"macros\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *func, compiler.context.module_list)
+		FOREACH_DECL(Decl *func, modules)
 					if (func->decl_kind != DECL_MACRO) continue;
 					if (decl_is_hidden(func)) continue;
 					INSERT_COMMA;
-					emit_macro_data(file, module, func);
+					emit_macro_data(out, module, func);
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t],\n", file);
+	cbuffer_append(out, "\n\t],\n");
 
-	fputs("\t\"generic_functions\": [\n", file);
+	cbuffer_append(out, "\t\"generic_functions\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *func, compiler.context.generic_module_list)
+		FOREACH_DECL(Decl *func, generic_modules)
 					if (func->decl_kind != DECL_FUNC) continue;
 					if (decl_is_hidden(func)) continue;
 					INSERT_COMMA;
-					emit_func_data(file, module, func);
+					emit_func_data(out, module, func);
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t],\n", file);
+	cbuffer_append(out, "\n\t],\n");
 
-	fputs("\t\"generic_macros\": [\n", file);
+	cbuffer_append(out, "\t\"generic_macros\": [\n");
 	{
 		bool first = true;
-		FOREACH_DECL(Decl *func, compiler.context.generic_module_list)
+		FOREACH_DECL(Decl *func, generic_modules)
 					if (func->decl_kind != DECL_MACRO) continue;
 					if (decl_is_hidden(func)) continue;
 					INSERT_COMMA;
-					emit_macro_data(file, module, func);
+					emit_macro_data(out, module, func);
 		FOREACH_DECL_END;
 	}
-	fputs("\n\t],\n", file);
+	cbuffer_append(out, "\n\t],\n");
+
+}
 
+static inline void emit_json_to_buffer(CBuffer *out, Module **modules, Module **generic_modules)
+{
+	cbuffer_append(out, "{\n");
+	emit_modules(out, modules, generic_modules);
+	emit_types(out, modules, generic_modules);
+	emit_functions(out, modules, generic_modules);
+	emit_globals(out, modules, generic_modules);
+	emit_constants(out, modules, generic_modules);
+	cbuffer_append(out, "\n}");
 }
 
-static inline void emit_json_to_file(FILE *file)
+/**
+ * Write one JSON file per module, in the same format as the full output.
+ * Files whose content is unchanged are not rewritten, so tools can
+ * reindex only the modules with a newer file.
+ */
+static void emit_json_shards(const char *dir)
 {
-	fputs("{\n", file);
-	emit_modules(file);
-	emit_types(file);
-	emit_functions(file);
-	emit_globals(file);
-	emit_constants(file);
-	fputs("\n}", file);
+	dir_make(dir);
+	CBuffer out = { 0 };
+	for (int generic = 0; generic < 2; generic++)
+	{
+		FOREACH(Module *, module, generic ? compiler.context.generic_module_list : compiler.context.module_list)
+		{
+			Module **list = NULL;
+			vec_add(list, module);
+			emit_json_to_buffer(&out, generic ? NULL : list, generic ? list : NULL);
+			scratch_buffer_clear();
+			scratch_buffer_append_module(module, false);
+			scratch_buffer_append(".json");
+			const char *filename = file_append_path(dir, scratch_buffer_to_string());
+			if (!file_write_if_changed(filename, out.data, out.len))
+			{
+				error_exit("Failed to write the JSON output '%s'.", filename);
+			}
+			out.len = 0;
+		}
+	}
+	cbuffer_free(&out);
 }
 
 void emit_json(void)
 {
-	emit_json_to_file(stdout);
+	if (compiler.build.json_dir)
+	{
+		emit_json_shards(compiler.build.json_dir);
+		return;
+	}
+	CBuffer out = { 0 };
+	emit_json_to_buffer(&out, compiler.context.module_list, compiler.context.generic_module_list);
+	fwrite(out.data, 1, out.len, stdout);
+	cbuffer_free(&out);
 }
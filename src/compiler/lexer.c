@@ -4,15 +4,23 @@
 
 #include "compiler_internal.h"
 
-static inline uint16_t check_col(intptr_t col)
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LEXER_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define LEXER_NEON 1
+#endif
+
+static inline uint16_t check_length(intptr_t len)
 {
-	if (col > 255) return 0;
-	return (uint16_t)col;
+	return len > MAX_SOURCE_LOCATION_LEN ? 0 : (uint16_t)len;
 }
 
-static inline unsigned check_row(intptr_t line)
+// Spans store the position plus one, so that 0 can mean no location.
+static inline uint32_t lexer_pos(Lexer *lexer, const char *loc)
 {
-	return line > MAX_SOURCE_LOCATION_LEN ? 0 : (unsigned)line;
+	return (uint32_t)(loc - lexer->file_begin + 1);
 }
 
 // --- Lexing general methods.
@@ -22,8 +30,6 @@ static bool lexer_scan_token_inner(Lexer *lexer);
 static inline void begin_new_token(Lexer *lexer)
 {
 	lexer->lexing_start = lexer->current;
-	lexer->start_row = lexer->current_row;
-	lexer->start_row_start = lexer->line_start;
 }
 
 // Peek at the current character in the buffer.
@@ -41,10 +47,6 @@ static inline void begin_new_token(Lexer *lexer)
 // Step one character forward and return that character
 INLINE char next(Lexer *lexer)
 {
-	if (*lexer->current == '\n')
-	{
-		lexer->line_start = lexer->current + 1, lexer->current_row++;
-	}
 	return (++lexer->current)[0];
 }
 
@@ -52,10 +54,6 @@ INLINE char next(Lexer *lexer)
 static inline void backtrack(Lexer *lexer)
 {
 	lexer->current--;
-	if (lexer->current[0] == '\n')
-	{
-		lexer->current_row--;
-	}
 }
 
 // Skip the x next characters.
@@ -90,26 +88,10 @@ static inline void set_generic_token(Lexer *lexer, TokenType type)
 	// Set the location.
 	lexer->data.lex_len = lexer->current - lexer->lexing_start;
 	lexer->data.lex_start = lexer->lexing_start;
-	uint32_t line = lexer->start_row;
-	uint32_t col;
-	uint32_t length;
-	if (line == lexer->current_row)
-	{
-		// Col is simple difference.
-		col = check_col(lexer->lexing_start - lexer->line_start + 1);
-		// Length is diff between current and start.
-		length = check_row(lexer->current - lexer->lexing_start);
-	}
-	else
-	{
-		// For multiline, we grab the diff from the starting line.
-		col = check_col(lexer->lexing_start - lexer->start_row_start + 1);
-		// But always set a single token length.
-		length = 1;
-	}
-	lexer->tok_span.length = length;
-	lexer->tok_span.col = col;
-	lexer->tok_span.row = line;
+	size_t len = (size_t)(lexer->current - lexer->lexing_start);
+	lexer->tok_span.pos = lexer_pos(lexer, lexer->lexing_start);
+	// Multiline tokens always get a single token length.
+	lexer->tok_span.length = memchr(lexer->lexing_start, '\n', len) ? 1 : check_length((intptr_t)len);
 }
 
 // Error? We simply generate an invalid token and print out the error.
@@ -130,9 +112,8 @@ static bool add_error_token_at_start(Lexer *lexer, const char *message, ...)
 	va_start(list, message);
 	SourceSpan location = {
 			.file_id = lexer->file->file_id,
-			.row = lexer->start_row,
 			.length = 1,
-			.col = check_col((lexer->lexing_start - lexer->start_row_start) + 1),
+			.pos = lexer_pos(lexer, lexer->lexing_start),
 	};
 	sema_verror_range(location, message, list);
 	va_end(list);
@@ -146,13 +127,10 @@ static bool add_error_token_at(Lexer *lexer, const char *loc, uint32_t len, cons
 {
 	va_list list;
 	va_start(list, message);
-	uint32_t current_line = lexer->current_row;
-	if (len > MAX_SOURCE_LOCATION_LEN) len = 0;
 	SourceSpan location = {
 			.file_id = lexer->file->file_id,
-			.row = current_line,
-			.length = len,
-			.col = check_col((loc - lexer->line_start) + 1),
+			.length = check_length(len),
+			.pos = lexer_pos(lexer, loc),
 	};
 	sema_verror_range(location, message, list);
 	va_end(list);
@@ -165,12 +143,10 @@ static bool add_error_token_at_current(Lexer *lexer, const char *message, ...)
 {
 	va_list list;
 	va_start(list, message);
-	uint32_t current_line = lexer->current_row;
 	SourceSpan location = {
 			.file_id = lexer->file->file_id,
-			.row = current_line,
 			.length = 1,
-			.col = check_col((lexer->current - lexer->line_start) + 1),
+			.pos = lexer_pos(lexer, lexer->current),
 	};
 	sema_verror_range(location, message, list);
 	va_end(list);
@@ -188,6 +164,155 @@ static inline bool new_token(Lexer *lexer, TokenType type, const char *string)
 
 
 
+// --- Fast scanning
+
+// The scanners below find the end of a run of characters that need no
+// special handling, so that the lexer can move past it in one step. They use
+// aligned 16 byte loads, which never cross a page, and always stop at
+// the terminating '\0', so they don't read past the end of the buffer.
+
+#if LEXER_SSE2 || LEXER_NEON
+
+#if LEXER_SSE2
+typedef __m128i LexVec;
+#define LEXVEC_BITS 1
+#define LEXVEC_FULL 0xFFFFull
+#define lexvec_load(p_) _mm_load_si128((const __m128i *)(p_))
+#define lexvec_eq(v_, c_) _mm_cmpeq_epi8(v_, _mm_set1_epi8((char)(c_)))
+#define lexvec_or(a_, b_) _mm_or_si128(a_, b_)
+#define lexvec_mask(v_) ((uint64_t)(unsigned)_mm_movemask_epi8(v_))
+static inline LexVec lexvec_in_range(LexVec v, char low, char high)
+{
+	LexVec diff = _mm_sub_epi8(v, _mm_set1_epi8(low));
+	return _mm_cmpeq_epi8(_mm_min_epu8(diff, _mm_set1_epi8((char)(high - low))), diff);
+}
+#else
+typedef uint8x16_t LexVec;
+// NEON has no movemask, so we narrow to 4 bits per byte instead.
+#define LEXVEC_BITS 4
+#define LEXVEC_FULL (~0ull)
+#define lexvec_load(p_) vld1q_u8((const uint8_t *)(p_))
+#define lexvec_eq(v_, c_) vceqq_u8(v_, vdupq_n_u8((uint8_t)(c_)))
+#define lexvec_or(a_, b_) vorrq_u8(a_, b_)
+#define lexvec_mask(v_) vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v_), 4)), 0)
+static inline LexVec lexvec_in_range(LexVec v, char low, char high)
+{
+	return vcleq_u8(vsubq_u8(v, vdupq_n_u8((uint8_t)low)), vdupq_n_u8((uint8_t)(high - low)));
+}
+#endif
+
+typedef uint64_t (*LexVecMatch)(LexVec v);
+
+// The aligned loads may read past the end of the buffer, though never into
+// the next page, so keep the address sanitizer from flagging them.
+#if defined(__GNUC__) || defined(__clang__)
+#define LEXVEC_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define LEXVEC_NO_SANITIZE
+#endif
+
+// Return the first character that matches, starting at 'p'.
+LEXVEC_NO_SANITIZE static inline const char *lexer_find(const char *p, LexVecMatch match)
+{
+	uintptr_t offset = (uintptr_t)p & 15;
+	const char *block = p - offset;
+	uint64_t mask = match(lexvec_load(block)) >> (offset * LEXVEC_BITS);
+	if (mask) return p + ctz(mask) / LEXVEC_BITS;
+	while (1)
+	{
+		block += 16;
+		mask = match(lexvec_load(block));
+		if (mask) return block + ctz(mask) / LEXVEC_BITS;
+	}
+}
+
+static inline uint64_t match_line_end(LexVec v)
+{
+	return lexvec_mask(lexvec_or(lexvec_eq(v, '\n'), lexvec_eq(v, '\0')));
+}
+
+static inline uint64_t match_comment_special(LexVec v)
+{
+	return lexvec_mask(lexvec_or(lexvec_or(lexvec_eq(v, '*'), lexvec_eq(v, '/')), lexvec_eq(v, '\0')));
+}
+
+static inline uint64_t match_string_special(LexVec v)
+{
+	LexVec special = lexvec_or(lexvec_eq(v, '"'), lexvec_eq(v, '\\'));
+	return lexvec_mask(lexvec_or(special, lexvec_or(lexvec_eq(v, '\n'), lexvec_eq(v, '\0'))));
+}
+
+static inline uint64_t match_not_blank(LexVec v)
+{
+	return lexvec_mask(lexvec_or(lexvec_eq(v, ' '), lexvec_eq(v, '\t'))) ^ LEXVEC_FULL;
+}
+
+static inline uint64_t match_not_ident(LexVec v)
+{
+	LexVec letter = lexvec_or(lexvec_in_range(v, 'a', 'z'), lexvec_in_range(v, 'A', 'Z'));
+	LexVec ident = lexvec_or(letter, lexvec_or(lexvec_in_range(v, '0', '9'), lexvec_eq(v, '_')));
+	return lexvec_mask(ident) ^ LEXVEC_FULL;
+}
+
+static inline uint64_t match_bidi_lead(LexVec v)
+{
+	return lexvec_mask(lexvec_or(lexvec_eq(v, 0xE2), lexvec_eq(v, '\0')));
+}
+
+#define FIND_LINE_END(p_) lexer_find(p_, match_line_end)
+#define FIND_COMMENT_SPECIAL(p_) lexer_find(p_, match_comment_special)
+#define FIND_STRING_SPECIAL(p_) lexer_find(p_, match_string_special)
+#define SKIP_BLANKS(p_) lexer_find(p_, match_not_blank)
+#define SKIP_IDENT_CHARS(p_) lexer_find(p_, match_not_ident)
+#define FIND_BIDI_LEAD(p_) lexer_find(p_, match_bidi_lead)
+
+#else
+
+static inline const char *lexer_find_line_end(const char *p)
+{
+	while (*p && *p != '\n') p++;
+	return p;
+}
+
+static inline const char *lexer_find_comment_special(const char *p)
+{
+	while (*p && *p != '*' && *p != '/') p++;
+	return p;
+}
+
+static inline const char *lexer_find_string_special(const char *p)
+{
+	while (*p && *p != '\n' && *p != '"' && *p != '\\') p++;
+	return p;
+}
+
+static inline const char *lexer_skip_blanks(const char *p)
+{
+	while (*p == ' ' || *p == '\t') p++;
+	return p;
+}
+
+static inline const char *lexer_skip_ident_chars(const char *p)
+{
+	while (char_is_alphanum_(*p)) p++;
+	return p;
+}
+
+static inline const char *lexer_find_bidi_lead(const char *p)
+{
+	while (*p && (unsigned char)*p != 0xE2) p++;
+	return p;
+}
+
+#define FIND_LINE_END(p_) lexer_find_line_end(p_)
+#define FIND_COMMENT_SPECIAL(p_) lexer_find_comment_special(p_)
+#define FIND_STRING_SPECIAL(p_) lexer_find_string_special(p_)
+#define SKIP_BLANKS(p_) lexer_skip_blanks(p_)
+#define SKIP_IDENT_CHARS(p_) lexer_skip_ident_chars(p_)
+#define FIND_BIDI_LEAD(p_) lexer_find_bidi_lead(p_)
+
+#endif
+
 // --- Comment parsing
 
 /**
@@ -195,10 +320,7 @@ static inline bool new_token(Lexer *lexer, TokenType type, const char *string)
  */
 static inline void parse_line_comment(Lexer *lexer)
 {
-	while (!reached_end(lexer) && peek(lexer) != '\n')
-	{
-		next(lexer);
-	}
+	lexer->current = FIND_LINE_END(lexer->current);
 	// If we found EOL, then walk past '\n'
 	if (peek(lexer) == '\n') next(lexer);
 }
@@ -211,6 +333,7 @@ static inline void parse_multiline_comment(Lexer *lexer)
 	int nesting = 1;
 	while (1)
 	{
+		lexer->current = FIND_COMMENT_SPECIAL(lexer->current);
 		switch (peek(lexer))
 		{
 			case '*':
@@ -271,11 +394,13 @@ static void skip_whitespace(Lexer *lexer)
 				// Contract lexing sees '\n' as a token.
 				if (lexer->mode == LEX_CONTRACTS) return;
 				FALLTHROUGH;
-			case ' ':
-			case '\t':
 			case '\f':
 				next(lexer);
 				break;
+			case ' ':
+			case '\t':
+				lexer->current = SKIP_BLANKS(lexer->current);
+				break;
 			case '\r':
 				// Already filtered out.
 				UNREACHABLE
@@ -292,15 +417,9 @@ static void skip_whitespace(Lexer *lexer)
 static inline bool scan_ident(Lexer *lexer, TokenType normal, TokenType const_token, TokenType type_token, char prefix)
 {
 	TokenType type = (TokenType)0;
-	uint32_t hash = FNV1_SEED;
-	if (prefix)
-	{
-		hash = FNV1a(prefix, hash);
-	}
 	char c;
 	while ((c = peek(lexer)) == '_')
 	{
-		hash = FNV1a(c, hash);
 		next(lexer);
 	}
 	while (1)
@@ -328,8 +447,13 @@ static inline bool scan_ident(Lexer *lexer, TokenType normal, TokenType const_to
 			default:
 				goto EXIT;
 		}
-		hash = FNV1a(c, hash);
 		next(lexer);
+		// Once the kind can't change any more, we only need to find the end.
+		if (type == normal || type == type_token)
+		{
+			lexer->current = SKIP_IDENT_CHARS(lexer->current);
+			break;
+		}
 	}
 EXIT:;
 	uint32_t len = (uint32_t)(lexer->current - lexer->lexing_start);
@@ -342,7 +466,7 @@ EXIT:;
 		}
 		return add_error_token(lexer, "An identifier may not consist of only '_' characters.");
 	}
-	const char* interned_string = symtab_add(lexer->lexing_start, len, hash, &type);
+	const char* interned_string = symtab_add(lexer->lexing_start, len, symtab_hash(lexer->lexing_start, len), &type);
 	switch (type)
 	{
 		case TOKEN_RETURN:
@@ -935,24 +1059,36 @@ static inline bool scan_string(Lexer *lexer)
 {
 	char c = 0;
 	const char *current = lexer->current;
-	while ((c = *(current++)) != '"')
+	while (1)
 	{
+		current = FIND_STRING_SPECIAL(current);
+		c = *(current++);
+		if (c == '"') break;
 		if (c == '\n' || c == '\0')
 		{
 			current++;
 			break;
 		}
-		if (c == '\\')
-		{
-			c = *current;
-			if (c != '\n' && c != '\0') current++;
-		}
+		// This is a '\'
+		c = *current;
+		if (c != '\n' && c != '\0') current++;
 	}
 	const char *end = current - 1;
 	char *destination = malloc_string((size_t)(end - lexer->current + 1));
 	size_t len = 0;
 	while (lexer->current < end)
 	{
+		// Copy plain characters in one go.
+		const char *run_end = FIND_STRING_SPECIAL(lexer->current);
+		if (run_end > end) run_end = end;
+		if (run_end > lexer->current)
+		{
+			size_t run = (size_t)(run_end - lexer->current);
+			memcpy(destination + len, lexer->current, run);
+			len += run;
+			lexer->current = run_end;
+			continue;
+		}
 		c = peek(lexer);
 		next(lexer);
 		if (c == '\0' || (c == '\\' && peek(lexer) == '\0'))
@@ -1401,12 +1537,13 @@ INLINE void check_bidirectional_markers(Lexer *lexer)
 {
 	// First we check for bidirectional markers.
 	const unsigned char *check = (const unsigned char *)lexer->current;
-	unsigned c;
 	int balance = 0;
 	// Loop until end.
-	while ((c = *(check++)) != '\0')
+	while (1)
 	{
-		if (c != 0xE2) continue;
+		check = (const unsigned char *)FIND_BIDI_LEAD((const char *)check);
+		if (!check[0]) break;
+		check++;
 		// Possible marker.
 		unsigned char next = check[0];
 		if (next == 0) break;
@@ -1454,10 +1591,6 @@ void lexer_init(Lexer *lexer)
 	lexer->file_begin = lexer->file->contents;
 	// Set current to beginning.
 	lexer->current = lexer->file_begin;
-	// Line start is current.
-	lexer->line_start = lexer->current;
-	// Row number starts at 1
-	lexer->current_row = 1;
 	// File id is the current file.
 	lexer->tok_span.file_id = lexer->file->file_id;
 	// Mode is NORMAL
@@ -1,5 +1,7 @@
 #include "compiler_internal.h"
 #include "../utils/whereami.h"
+#include "compiler_tests/benchmark.h"
+#include "subprocess.h"
 #if LLVM_AVAILABLE
 #include "c3_llvm.h"
 #endif
@@ -193,6 +195,10 @@ static void linker_setup_windows(const char ***args_ref, Linker linker_type, con
 			file_copy_file(asan_dll_src_path, asan_dll_dst_path, true);
 		}
 	}
+	if (pgo_instrument())
+	{
+		add_concat_file_arg(compiler_path, "c3c_rt/clang_rt.profile-x86_64.lib");
+	}
 
 	linking_add_link(&compiler.linking, "kernel32");
 	linking_add_link(&compiler.linking, "ntdll");
@@ -620,6 +626,136 @@ static void add_linked_libs(const char ***args_ref, const char **libs, bool is_w
 	}
 }
 
+static void linker_setup_thin_lto(const char ***args_ref, Linker linker_type)
+{
+	int lto_level;
+	switch (compiler.build.optlevel)
+	{
+		case OPTIMIZATION_NOT_SET:
+		case OPTIMIZATION_NONE:
+			lto_level = 0;
+			break;
+		case OPTIMIZATION_LESS:
+			lto_level = 1;
+			break;
+		case OPTIMIZATION_MORE:
+			lto_level = 2;
+			break;
+		default:
+			lto_level = 3;
+			break;
+	}
+	// The ThinLTO backends run in parallel inside the linker, one per module.
+	int jobs = compiler.build.build_threads;
+	switch (linker_type)
+	{
+		case LINKER_LD:
+		case LINKER_LD64:
+		case LINKER_WASM:
+			add_plain_arg(str_printf("--thinlto-jobs=%d", jobs));
+			add_plain_arg(str_printf("--lto-O%d", lto_level));
+			break;
+		case LINKER_LINK_EXE:
+			add_plain_arg(str_printf("/opt:lldltojobs=%d", jobs));
+			add_plain_arg(str_printf("/opt:lldlto=%d", lto_level));
+			break;
+		case LINKER_CC:
+			// This requires the system cc to be clang, or a gcc using lld or the LLVM gold plugin.
+			add_plain_arg("-flto=thin");
+			add_plain_arg(str_printf("-flto-jobs=%d", jobs));
+			add_plain_arg(str_printf("-O%d", lto_level));
+			break;
+		case LINKER_UNKNOWN:
+			break;
+		default:
+			UNREACHABLE
+	}
+}
+
+// Threads and identical code folding for the built-in linker.
+static void linker_setup_lld(const char ***args_ref, Linker linker_type)
+{
+	int threads = compiler.build.link_threads;
+	LinkerIcf icf = compiler.build.linker_icf;
+	switch (linker_type)
+	{
+		case LINKER_LD:
+		case LINKER_LD64:
+			add_plain_arg(str_printf("--threads=%d", threads));
+			switch (icf)
+			{
+				case LINKER_ICF_NONE:
+					add_plain_arg("--icf=none");
+					break;
+				case LINKER_ICF_SAFE:
+					add_plain_arg("--icf=safe");
+					break;
+				case LINKER_ICF_ALL:
+					add_plain_arg("--icf=all");
+					break;
+				case LINKER_ICF_NOT_SET:
+					break;
+			}
+			break;
+		case LINKER_WASM:
+			// wasm-ld doesn't fold identical code.
+			add_plain_arg(str_printf("--threads=%d", threads));
+			break;
+		case LINKER_LINK_EXE:
+			add_plain_arg(str_printf("/threads:%d", threads));
+			switch (icf)
+			{
+				case LINKER_ICF_NONE:
+					add_plain_arg("/opt:noicf");
+					break;
+				case LINKER_ICF_SAFE:
+					add_plain_arg("/opt:safeicf");
+					break;
+				case LINKER_ICF_ALL:
+					add_plain_arg("/opt:icf");
+					break;
+				case LINKER_ICF_NOT_SET:
+					break;
+			}
+			break;
+		case LINKER_CC:
+		case LINKER_UNKNOWN:
+			break;
+		default:
+			UNREACHABLE
+	}
+}
+
+/**
+ * The profile runtime writes the .profraw file when an instrumented binary exits. Prefer the one
+ * copied next to the compiler, as only clang understands -fprofile-instr-generate, and the
+ * system C compiler is often gcc.
+ */
+static void linker_add_linux_profile_runtime(const char ***args_ref, Linker linker_type)
+{
+	const char *compiler_path = find_executable_path();
+	const char *triple = compiler.platform.target_triple;
+	const char *arch_end = strchr(triple, '-');
+	const char *arch = arch_end ? str_copy(triple, arch_end - triple) : triple;
+	const char *runtimes[2] = { str_printf("c3c_rt/libclang_rt.profile-%s.a", arch), "c3c_rt/libclang_rt.profile.a" };
+	for (unsigned i = 0; i < 2; i++)
+	{
+		const char *path = file_append_path(compiler_path, runtimes[i]);
+		if (!file_exists(path)) continue;
+		add_quote_arg(path);
+		return;
+	}
+	const char *cc = compiler.build.cc ? compiler.build.cc : default_c_compiler();
+	if (linker_type == LINKER_CC && strstr(cc, "clang"))
+	{
+		add_plain_arg("-fprofile-instr-generate");
+		return;
+	}
+	error_exit("'--pgo-instrument' needs the LLVM profile runtime, but 'libclang_rt.profile-%s.a' was not "
+	           "found in '%s'. Link with clang using '--cc clang', or copy the runtime there.",
+	           arch, file_append_path(compiler_path, "c3c_rt"));
+}
+
 static bool linker_setup(const char ***args_ref, const char **files_to_link, unsigned file_count,
                          const char *output_file, Linker linker_type, Linking *linking)
 {
@@ -658,6 +794,8 @@ static bool linker_setup(const char ***args_ref, const char **files_to_link, uns
 		default:
 			UNREACHABLE
 	}
+	if (thin_lto()) linker_setup_thin_lto(args_ref, linker_type);
+	if (compiler.build.linker_type != LINKER_TYPE_CUSTOM) linker_setup_lld(args_ref, linker_type);
 	const char *lib_path_opt = use_win ? "/LIBPATH:" : "-L";
 
 	switch (compiler.platform.os)
@@ -737,12 +875,15 @@ static bool linker_setup(const char ***args_ref, const char **files_to_link, uns
 			add_plain_arg("-rpath");
 			add_concat_file_arg(compiler_path, "c3c_rt");
 		}
+		// The profile runtime writes the .profraw file when an instrumented binary exits.
+		if (pgo_instrument()) add_concat_file_arg(find_executable_path(), "c3c_rt/libclang_rt.profile_osx.a");
 	}
 	else if (compiler.platform.os == OS_TYPE_LINUX)
 	{
 		if (compiler.build.feature.sanitize_address) add_plain_arg("-fsanitize=address");
 		if (compiler.build.feature.sanitize_memory) add_plain_arg("-fsanitize=memory");
 		if (compiler.build.feature.sanitize_thread) add_plain_arg("-fsanitize=thread");
+		if (pgo_instrument()) linker_add_linux_profile_runtime(args_ref, linker_type);
 	}
 
 	return true;
@@ -995,7 +1136,212 @@ void platform_linker(const char *output_file, const char **files, unsigned file_
 	OUTF("Program linked to executable '%s'.\n", output_file);
 }
 
-const char *cc_compiler(const char *cc, const char *file, const char *flags, const char **include_dirs, const char *output_subdir)
+static const char *cc_cache_filename(uint64_t key, const char *suffix)
+{
+	return str_printf("%s/cc_%016llx%s", compiler.build.object_cache_dir, (unsigned long long)key, suffix);
+}
+
+// Parse the make style dependency file written by -MD.
+static const char **cc_parse_dependency_file(const char *dep_file)
+{
+	size_t size;
+	char *data = file_try_read_all(dep_file, &size);
+	if (!data) return NULL;
+	const char **deps = NULL;
+	char *c = strchr(data, ':');
+	// Skip the target, taking care not to stop at a Windows drive letter.
+	while (c && c[1] && c[1] != ' ' && c[1] != '\t' && c[1] != '\n' && c[1] != '\r') c = strchr(c + 1, ':');
+	if (!c) goto DONE;
+	c++;
+	while (*c)
+	{
+		if (*c == ' ' || *c == '\t' || *c == '\n' || *c == '\r')
+		{
+			c++;
+			continue;
+		}
+		if (c[0] == '\\' && (c[1] == '\n' || c[1] == '\r'))
+		{
+			c++;
+			continue;
+		}
+		scratch_buffer_clear();
+		while (*c && *c != ' ' && *c != '\t' && *c != '\n' && *c != '\r')
+		{
+			if (c[0] == '\\' && c[1] == ' ')
+			{
+				c++;
+			}
+			else if (c[0] == '$' && c[1] == '$')
+			{
+				c++;
+			}
+			else if (c[0] == '\\' && (c[1] == '\n' || c[1] == '\r'))
+			{
+				break;
+			}
+			scratch_buffer_append_char(*c++);
+		}
+		if (scratch_buffer.len) vec_add(deps, scratch_buffer_copy());
+	}
+DONE:
+	free(data);
+	return deps;
+}
+
+// The data of a cache entry is the list of headers the object was compiled with,
+// each as "<size> <path>\n" followed by its contents at the time, then an empty
+// line and the object itself.
+static bool cc_cache_fetch(const char *key, size_t key_len, uint64_t hash, const char *out_name)
+{
+	size_t size;
+	char *entry = file_cache_fetch(cc_cache_filename(hash, get_object_extension()), key, key_len, &size);
+	if (!entry) return false;
+	char *end = entry + size;
+	char *c = entry;
+	bool success = false;
+	while (c < end && *c != '\n')
+	{
+		char *path = strchr(c, ' ');
+		char *path_end = path ? strchr(path, '\n') : NULL;
+		if (!path_end) goto DONE;
+		size_t dep_size = (size_t)strtoull(c, NULL, 10);
+		c = path_end + 1;
+		if ((size_t)(end - c) < dep_size) goto DONE;
+		*path_end = 0;
+		size_t current_size;
+		char *current = file_try_read_all(path + 1, &current_size);
+		// A header that is gone or has changed can't match.
+		bool match = current && current_size == dep_size && memcmp(current, c, dep_size) == 0;
+		free(current);
+		if (!match) goto DONE;
+		c += dep_size;
+	}
+	if (c == end) goto DONE;
+	c++;
+	success = file_write_all(out_name, c, end - c);
+DONE:
+	free(entry);
+	return success;
+}
+
+static void cc_cache_store(const char *key, size_t key_len, uint64_t hash, const char *out_name, const char *dep_file)
+{
+	const char **deps = cc_parse_dependency_file(dep_file);
+	file_delete_file(dep_file);
+	if (!deps) return;
+	size_t size;
+	char *data = file_try_read_all(out_name, &size);
+	if (!data) return;
+	char *entry = NULL;
+	size_t entry_len = 0;
+	FOREACH(const char *, dep, deps)
+	{
+		size_t dep_size;
+		char *contents = file_try_read_all(dep, &dep_size);
+		if (!contents) goto DONE;
+		const char *header = str_printf("%llu %s\n", (unsigned long long)dep_size, dep);
+		size_t header_len = strlen(header);
+		entry = realloc(entry, entry_len + header_len + dep_size);
+		memcpy(entry + entry_len, header, header_len);
+		memcpy(entry + entry_len + header_len, contents, dep_size);
+		entry_len += header_len + dep_size;
+		free(contents);
+	}
+	entry = realloc(entry, entry_len + 1 + size);
+	entry[entry_len] = '\n';
+	memcpy(entry + entry_len + 1, data, size);
+	file_cache_store(cc_cache_filename(hash, get_object_extension()), key, key_len, entry, entry_len + 1 + size);
+DONE:
+	free(entry);
+	free(data);
+}
+
+#if PLATFORM_POSIX
+// Split a plain argument, such as the user's cflags, into words the way the shell would.
+static void cc_split_args(const char ***argv_ref, const char *arg)
+{
+	while (*arg)
+	{
+		if (char_is_whitespace(*arg))
+		{
+			arg++;
+			continue;
+		}
+		scratch_buffer_clear();
+		char quote = 0;
+		for (; *arg && (quote || !char_is_whitespace(*arg)); arg++)
+		{
+			char c = *arg;
+			if (quote)
+			{
+				if (c == quote)
+				{
+					quote = 0;
+					continue;
+				}
+				if (quote == '"' && c == '\\' && (arg[1] == '"' || arg[1] == '\\')) c = *++arg;
+			}
+			else if (c == '"' || c == '\'')
+			{
+				quote = c;
+				continue;
+			}
+			else if (c == '\\' && arg[1])
+			{
+				c = *++arg;
+			}
+			scratch_buffer_append_char(c);
+		}
+		vec_add(*argv_ref, scratch_buffer_copy());
+	}
+}
+
+// Turn the parts of a command into the argument list of the program.
+static const char **cc_argv_from_parts(const char **parts)
+{
+	const char **argv = NULL;
+	unsigned count = vec_size(parts);
+	for (unsigned i = 0; i < count; i++)
+	{
+		const char *arg = parts[i];
+		if (arg == quote_arg)
+		{
+			vec_add(argv, parts[++i]);
+			continue;
+		}
+		if (arg == concat_arg || arg == concat_quote_arg)
+		{
+			const char *a = parts[++i];
+			vec_add(argv, str_cat(a, parts[++i]));
+			continue;
+		}
+		if (arg == concat_file_arg)
+		{
+			const char *a = parts[++i];
+			vec_add(argv, file_append_path(a, parts[++i]));
+			continue;
+		}
+		cc_split_args(&argv, arg);
+	}
+	vec_add(argv, NULL);
+	return argv;
+}
+#endif
+
+static void cc_compile_task(void *arg)
+{
+	CCompile *compile = arg;
+	double start = trace_begin();
+#if PLATFORM_POSIX
+	compile->status = subprocess_spawn_and_wait(compile->argv[0], compile->argv);
+#else
+	compile->status = system(compile->command);
+#endif
+	trace_end("cc", "cc_compiler", compile->file, start);
+}
+
+CCompile *cc_compiler_prepare(const char *cc, const char *file, const char *flags, const char **include_dirs, const char *output_subdir)
 {
 	const char *dir = compiler.build.object_file_dir;
 	if (!dir) dir = compiler.build.build_dir;
@@ -1017,9 +1363,13 @@ const char *cc_compiler(const char *cc, const char *file, const char *flags, con
 		len -= 2;
 		filename[len] = 0;
 	}
-	const char *out_name = dir
-	                      ? str_printf("%s/%s%s", dir, filename, get_object_extension())
-	                      : str_printf("%s%s", filename, get_object_extension());
+	CCompile *compile = CALLOCS(CCompile);
+	compile->file = file;
+	compile->out_name = dir
+	                    ? str_printf("%s/%s%s", dir, filename, get_object_extension())
+	                    : str_printf("%s%s", filename, get_object_extension());
+	compile->task = (Task) { &cc_compile_task, compile };
+	const char *out_name = compile->out_name;
 	const char **parts = NULL;
 	const char ***args_ref = &parts;
 	add_quote_arg(cc);
@@ -1043,6 +1393,36 @@ const char *cc_compiler(const char *cc, const char *file, const char *flags, con
 	add_plain_arg(is_cl_exe ? "/c" : "-c");
 	if (flags) add_plain_arg(flags);
 	add_quote_arg(file);
+
+	// The header list comes from -MD, which cl.exe doesn't have.
+	if (compiler.build.object_cache_dir && !is_cl_exe)
+	{
+		size_t size;
+		char *source = file_try_read_all(file, &size);
+		if (source)
+		{
+			// The key is the command without the output, followed by the source.
+			const char *key_command = assemble_linker_command(parts, false);
+			size_t command_len = strlen(key_command) + 1;
+			size_t key_len = command_len + size;
+			char *key = malloc(key_len);
+			memcpy(key, key_command, command_len);
+			memcpy(key + command_len, source, size);
+			free(source);
+			uint64_t hash = fnv1a_64(key, key_len, FNV1_64_SEED);
+			if (cc_cache_fetch(key, key_len, hash, out_name))
+			{
+				free(key);
+				compile->cached = true;
+				return compile;
+			}
+			compile->cache_key = key;
+			compile->cache_key_len = key_len;
+			compile->cache_hash = hash;
+			compile->dep_file = str_printf("%s.d", out_name);
+		}
+	}
+
 	if (is_cl_exe)
 	{
 		add_concat_quote_arg("/Fo:", out_name);
@@ -1052,14 +1432,32 @@ const char *cc_compiler(const char *cc, const char *file, const char *flags, con
 		add_plain_arg("-o");
 		add_quote_arg(out_name);
 	}
+	if (compile->dep_file)
+	{
+		add_plain_arg("-MD");
+		add_plain_arg("-MF");
+		add_quote_arg(compile->dep_file);
+	}
 
-	const char *output = assemble_linker_command(parts, PLATFORM_WINDOWS);
-	DEBUG_LOG("Compiling c sources using '%s'", output);
-	if (system(output) != 0)
+#if PLATFORM_POSIX
+	compile->argv = cc_argv_from_parts(parts);
+#endif
+	assemble_linker_command(parts, PLATFORM_WINDOWS);
+	compile->command = scratch_buffer_copy();
+	DEBUG_LOG("Compiling c sources using '%s'", compile->command);
+	return compile;
+}
+
+void cc_compiler_finish(CCompile *compile)
+{
+	if (compile->cached) return;
+	if (compile->status != 0)
 	{
-		error_exit("Failed to compile c sources using command '%s'.\n", output);
+		error_exit("Failed to compile c sources using command '%s'.\n", compile->command);
 	}
-	return out_name;
+	if (!compile->dep_file) return;
+	cc_cache_store(compile->cache_key, compile->cache_key_len, compile->cache_hash, compile->out_name, compile->dep_file);
+	free(compile->cache_key);
 }
 
 bool dynamic_lib_linker(const char *output_file, const char **files, unsigned file_count)
@@ -5,15 +5,19 @@
 #include "llvm_codegen_internal.h"
 #include "compiler_tests/benchmark.h"
 #include "c3_llvm.h"
+#include <llvm-c/BitWriter.h>
 #include <llvm-c/Comdat.h>
 #include <llvm-c/Linker.h>
 #include <llvm-c/Transforms/PassBuilder.h>
+#include "git_hash.h"
+#define CODEGEN_UNIT_MIN_FUNCTIONS 64
+
 const char *varargslots_name = "varargslots";
 const char *temp_name = "$$temp";
 
 static void llvm_emit_constructors_and_destructors(GenContext *c);
 static void llvm_codegen_setup();
-static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context);
+static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context, unsigned codegen_unit, bool split_module);
 
 const char* llvm_version = LLVM_VERSION_STRING;
 const char* llvm_target = LLVM_DEFAULT_TARGET_TRIPLE;
@@ -48,18 +52,13 @@ static void diagnostics_handler(LLVMDiagnosticInfoRef ref, void *context)
 	LLVMDisposeMessage(message);
 }
 
-bool module_should_weaken(Module *module)
-{
-	if (module->generic_module) return true;
-	Module *top = module->top_module;
-	return top && (top->name->module == kw_std || top->name->module == kw_libc);
-}
 
 static void gencontext_init(GenContext *context, Module *module, LLVMContextRef shared_context)
 {
 	ASSERT(LLVMIsMultithreaded());
 	memset(context, 0, sizeof(GenContext));
 	context->weaken = module_should_weaken(module);
+	context->cur_func.safe_mode = safe_mode_enabled();
 
 	if (shared_context)
 	{
@@ -266,6 +265,35 @@ LLVMValueRef llvm_emit_const_initializer(GenContext *c, ConstInitializer *const_
 			}
 			return llvm_get_array(element_type_llvm, parts, vec_size(parts));
 		}
+		case CONST_INIT_ARRAY_BYTES:
+		{
+			Type *array_type = const_init->type;
+			Type *element_type = array_type->array.base;
+			ArraySize size = array_type->array.len;
+			// Byte sized integers can use the packed data as is.
+			if (type_is_integer(type_flatten(element_type)) && type_size(element_type) == 1)
+			{
+				return llvm_get_bytes(c, const_init->init_array_bytes, size);
+			}
+			bool was_modified = false;
+			LLVMTypeRef element_type_llvm = llvm_get_type(c, element_type);
+			LLVMValueRef *parts = VECNEW(LLVMValueRef, size);
+			Expr element = { .expr_kind = EXPR_CONST };
+			for (ArrayIndex i = 0; i < (ArrayIndex)size; i++)
+			{
+				BEValue value;
+				const_init_bytes_rewrite_expr_at(const_init, i, &element);
+				llvm_emit_expr_global_value(c, &value, &element);
+				LLVMValueRef part = llvm_load_value_store(c, &value);
+				if (element_type_llvm != LLVMTypeOf(part)) was_modified = true;
+				vec_add(parts, part);
+			}
+			if (was_modified)
+			{
+				return llvm_get_unnamed_struct(c, parts, true);
+			}
+			return llvm_get_array(element_type_llvm, parts, vec_size(parts));
+		}
 
 		case CONST_INIT_ARRAY:
 		{
@@ -483,6 +511,12 @@ static void llvm_set_external_reference(LLVMValueRef ref, bool is_weak)
 	LLVMSetVisibility(ref, LLVMDefaultVisibility);
 }
 
+static void llvm_set_hidden_definition(LLVMValueRef ref, bool is_weak)
+{
+	LLVMSetLinkage(ref, is_weak ? LLVMWeakAnyLinkage : LLVMExternalLinkage);
+	LLVMSetVisibility(ref, LLVMHiddenVisibility);
+}
+
 void llvm_set_decl_linkage(GenContext *c, Decl *decl)
 {
 	bool is_var = decl->decl_kind == DECL_VAR;
@@ -492,7 +526,7 @@ void llvm_set_decl_linkage(GenContext *c, Decl *decl)
 	LLVMValueRef opt_ref = is_var ? decl->var.optional_ref : NULL;
 	bool is_static = is_var && decl->var.is_static;
 	// Static variables in a different modules should be copied to the current module.
-	bool same_module = is_static || decl->unit->module == c->code_module;
+	bool same_module = is_static || llvm_decl_in_codegen_unit(c, decl);
 	if (decl->is_extern || !same_module)
 	{
 		llvm_set_external_reference(ref, should_weaken);
@@ -516,10 +550,19 @@ void llvm_set_decl_linkage(GenContext *c, Decl *decl)
 		return;
 	}
 
+	// Module private symbols may be used from the other codegen units of a split module,
+	// @local ones stay with their file, so those can remain internal.
+	if (c->split_module && !is_static && decl->visibility != VISIBLE_LOCAL)
+	{
+		llvm_set_hidden_definition(ref, is_weak);
+		if (opt_ref) llvm_set_hidden_definition(opt_ref, false);
+		return;
+	}
 	LLVMSetLinkage(ref, decl->is_weak ? LLVMLinkerPrivateWeakLinkage : LLVMInternalLinkage);
 	if (opt_ref) LLVMSetLinkage(opt_ref, LLVMInternalLinkage);
 }
 
+
 void llvm_set_internal_linkage(LLVMValueRef alloc)
 {
 	LLVMSetLinkage(alloc, LLVMInternalLinkage);
@@ -533,6 +576,27 @@ void llvm_set_private_declaration(LLVMValueRef alloc)
 	LLVMSetUnnamedAddress(alloc, LLVMGlobalUnnamedAddr);
 }
 
+/**
+ * Add a private unnamed_addr constant, or reuse the one in the pool with the same
+ * initializer. LLVM uniques constants, so the initializer itself is the key.
+ */
+LLVMValueRef llvm_add_private_constant(GenContext *c, HTable *pool, const char *name, LLVMValueRef init, AlignSize alignment)
+{
+	if (!pool->entries) htable_init(pool, 64);
+	LLVMValueRef global = htable_get(pool, init);
+	if (global)
+	{
+		if (alignment > LLVMGetAlignment(global)) LLVMSetAlignment(global, (unsigned)alignment);
+		return global;
+	}
+	global = llvm_add_global_raw(c, name, LLVMTypeOf(init), alignment);
+	llvm_set_private_declaration(global);
+	LLVMSetGlobalConstant(global, true);
+	LLVMSetInitializer(global, init);
+	htable_set(pool, init, global);
+	return global;
+}
+
 void llvm_emit_global_variable_init(GenContext *c, Decl *decl)
 {
 	ASSERT(decl->var.kind == VARDECL_GLOBAL || decl->var.kind == VARDECL_CONST || decl->var.is_static);
@@ -591,7 +655,7 @@ void llvm_emit_global_variable_init(GenContext *c, Decl *decl)
 				name,
 				strlen(name),
 				c->debug.file.debug_file,
-				loc.row ? loc.row : 1,
+				span_row(loc) ? span_row(loc) : 1,
 				llvm_get_debug_type(c, decl->type),
 				decl_is_local(decl),
 				LLVMDIBuilderCreateExpression(c->debug.builder, NULL, 0),
@@ -609,9 +673,9 @@ void llvm_emit_global_variable_init(GenContext *c, Decl *decl)
 		LLVMSetUnnamedAddress(decl->backend_ref,
 							  decl_is_local(decl) ? LLVMGlobalUnnamedAddr : LLVMLocalUnnamedAddr);
 	}
-	if (decl->attrs_resolved && decl->attrs_resolved->section)
+	if (decl_attrs_resolved(decl) && decl_attrs_resolved(decl)->section)
 	{
-		LLVMSetSection(global_ref, decl->attrs_resolved->section);
+		LLVMSetSection(global_ref, decl_attrs_resolved(decl)->section);
 	}
 	llvm_set_global_tls(decl);
 
@@ -889,6 +953,7 @@ static void llvm_codegen_setup()
 	attribute_id.alwaysinline = lookup_attribute("alwaysinline");
 	attribute_id.arcp = lookup_attribute("arcp");
 	attribute_id.byval = lookup_attribute("byval");
+	attribute_id.cold = lookup_attribute("cold");
 	attribute_id.contract = lookup_attribute("contract");
 	attribute_id.elementtype = lookup_attribute("elementtype");
 	attribute_id.fast = lookup_attribute("fast");
@@ -1004,13 +1069,14 @@ static void llvm_emit_type_decls(GenContext *context, Decl *decl)
 		case DECL_UNION:
 		case DECL_ENUM:
 		case DECL_BITSTRUCT:
+			if (!decl_needs_eager_introspection(decl)) break;
 			llvm_get_typeid(context, decl->type);
 			break;
 	}
 }
 
 
-static inline void llvm_optimize(GenContext *c)
+static inline void llvm_setup_passes(LLVMPasses *passes)
 {
 	bool should_debug = false;
 #ifndef NDEBUG
@@ -1045,11 +1111,16 @@ static inline void llvm_optimize(GenContext *c)
 			}
 			break;
 	}
-	LLVMPasses passes = {
+	*passes = (LLVMPasses) {
 			.opt_level = level,
-			.should_verify = compiler.build.emit_llvm,
+			.should_verify = compiler.build.llvm_verify == LLVM_VERIFY_NOT_SET
+				? compiler.build.emit_llvm
+				: compiler.build.llvm_verify == LLVM_VERIFY_ON,
 			.should_debug = should_debug,
 			.is_kernel = compiler.build.kernel_build,
+			.thin_lto = thin_lto(),
+			.pgo.instrument = pgo_instrument(),
+			.pgo.profile = compiler.build.pgo_profile,
 			.opt.vectorize_loops = compiler.build.loop_vectorization == VECTORIZATION_ON,
 			.opt.slp_vectorize = compiler.build.slp_vectorization == VECTORIZATION_ON,
 			.opt.unroll_loops = compiler.build.unroll_loops == UNROLL_LOOPS_ON,
@@ -1059,16 +1130,318 @@ static inline void llvm_optimize(GenContext *c)
 			.sanitizer.mem_sanitize = compiler.build.feature.sanitize_memory,
 			.sanitizer.thread_sanitize = compiler.build.feature.sanitize_thread
 	};
-	if (!llvm_run_passes(c->module, c->machine, &passes))
+}
+
+/**
+ * Find the pass pipeline of a module. The last matching --module-llvm-passes wins,
+ * where 'foo::*' matches foo and its submodules, and an empty pipeline means the
+ * default one. Otherwise it's the --llvm-passes pipeline, if any.
+ */
+static const char *llvm_module_pipeline(Module *module)
+{
+	const char *pipeline = module_setting_lookup(module, compiler.build.module_llvm_passes);
+	if (!pipeline) return compiler.build.llvm_passes;
+	return pipeline[0] ? pipeline : NULL;
+}
+
+// Hash of the PGO profile contents, so that objects are rebuilt when the profile changes.
+static uint64_t pgo_profile_hash = 0;
+
+/**
+ * Build the cache key of a module: the unoptimized bitcode together with everything that
+ * affects how it is turned into an object file. Only uses thread-safe calls, since codegen
+ * runs on the task queue. The key is malloc'ed.
+ */
+static char *llvm_module_cache_key(GenContext *c, LLVMPasses *passes, size_t *key_len)
+{
+	int settings[] = {
+			compiler.platform.llvm_opt_level, compiler.platform.reloc_model, compiler.build.kernel_build,
+			passes->opt_level, passes->is_kernel, passes->thin_lto, passes->pgo.instrument,
+			passes->opt.vectorize_loops, passes->opt.slp_vectorize, passes->opt.unroll_loops,
+			passes->opt.interleave_loops, passes->opt.merge_functions,
+			passes->sanitizer.address_sanitize, passes->sanitizer.mem_sanitize, passes->sanitizer.thread_sanitize };
+	const char *pipeline = passes->pipeline ? passes->pipeline : "";
+	const char *cpu = compiler.platform.cpu ? compiler.platform.cpu : "";
+	const char *features = compiler.platform.features ? compiler.platform.features : "";
+	const char *format = "%s\n%s\n%s\n%s\n%s\n%s\n%s\n%016llx\n";
+	int header_len = snprintf(NULL, 0, format, COMPILER_VERSION, GIT_HASH, llvm_version,
+	                          compiler.platform.target_triple, cpu, features, pipeline,
+	                          (unsigned long long)pgo_profile_hash);
+	LLVMMemoryBufferRef buffer = LLVMWriteBitcodeToMemoryBuffer(c->module);
+	size_t bitcode_len = LLVMGetBufferSize(buffer);
+	size_t len = (size_t)header_len + sizeof(settings) + bitcode_len;
+	char *key = malloc(len + 1);
+	snprintf(key, (size_t)header_len + 1, format, COMPILER_VERSION, GIT_HASH, llvm_version,
+	         compiler.platform.target_triple, cpu, features, pipeline, (unsigned long long)pgo_profile_hash);
+	memcpy(key + header_len, settings, sizeof(settings));
+	memcpy(key + header_len + sizeof(settings), LLVMGetBufferStart(buffer), bitcode_len);
+	LLVMDisposeMemoryBuffer(buffer);
+	*key_len = len;
+	return key;
+}
+
+static inline const char *llvm_fingerprint_filename(const char *object_name)
+{
+	size_t len = strlen(object_name);
+	char *name = malloc(len + sizeof(".hash"));
+	memcpy(name, object_name, len);
+	memcpy(name + len, ".hash", sizeof(".hash"));
+	return name;
+}
+
+static bool llvm_object_is_current(const char *object_name, uint64_t fingerprint)
+{
+	if (!file_exists(object_name)) return false;
+	const char *fingerprint_name = llvm_fingerprint_filename(object_name);
+	FILE *file = fopen(fingerprint_name, "rb");
+	free((void *)fingerprint_name);
+	if (!file) return false;
+	unsigned long long stored = 0;
+	bool match = fscanf(file, "%llx", &stored) == 1 && stored == fingerprint;
+	fclose(file);
+	return match;
+}
+
+static void llvm_object_clear_fingerprint(const char *object_name)
+{
+	const char *fingerprint_name = llvm_fingerprint_filename(object_name);
+	remove(fingerprint_name);
+	free((void *)fingerprint_name);
+}
+
+static void llvm_object_write_fingerprint(const char *object_name, uint64_t fingerprint)
+{
+	const char *fingerprint_name = llvm_fingerprint_filename(object_name);
+	FILE *file = fopen(fingerprint_name, "wb");
+	free((void *)fingerprint_name);
+	// Failing to write the fingerprint only means the object is rebuilt next time.
+	if (!file) return;
+	fprintf(file, "%016llx\n", (unsigned long long)fingerprint);
+	fclose(file);
+}
+
+static const char *llvm_object_cache_filename(uint64_t fingerprint)
+{
+	const char *dir = compiler.build.object_cache_dir;
+	const char *ext = get_object_extension();
+	size_t len = strlen(dir) + strlen(ext) + 18;
+	char *name = malloc(len);
+	snprintf(name, len, "%s/%016llx%s", dir, (unsigned long long)fingerprint, ext);
+	return name;
+}
+
+static bool llvm_object_cache_fetch(const char *object_name, uint64_t fingerprint, const char *key, size_t key_len)
+{
+	const char *cache_name = llvm_object_cache_filename(fingerprint);
+	size_t size;
+	char *data = file_cache_fetch(cache_name, key, key_len, &size);
+	free((void *)cache_name);
+	if (!data) return false;
+	bool success = file_write_all(object_name, data, size);
+	free(data);
+	return success;
+}
+
+static void llvm_object_cache_store(const char *object_name, uint64_t fingerprint, const char *key, size_t key_len)
+{
+	size_t size;
+	char *data = file_try_read_all(object_name, &size);
+	if (!data) return;
+	const char *cache_name = llvm_object_cache_filename(fingerprint);
+	file_cache_store(cache_name, key, key_len, data, size);
+	free((void *)cache_name);
+	free(data);
+}
+
+size_t llvm_codegen_cost(void *context)
+{
+	GenContext *c = context;
+	size_t instructions = 0;
+	for (LLVMValueRef func = LLVMGetFirstFunction(c->module); func; func = LLVMGetNextFunction(func))
 	{
-		error_exit("Failed to run passes.");
+		for (LLVMBasicBlockRef block = LLVMGetFirstBasicBlock(func); block; block = LLVMGetNextBasicBlock(block))
+		{
+			for (LLVMValueRef inst = LLVMGetFirstInstruction(block); inst; inst = LLVMGetNextInstruction(inst))
+			{
+				instructions++;
+			}
+		}
 	}
+	return instructions;
+}
+
+#if PLATFORM_WINDOWS
+#define OPT_STATS_LOCK(file_) _lock_file(file_)
+#define OPT_STATS_UNLOCK(file_) _unlock_file(file_)
+#else
+#define OPT_STATS_LOCK(file_) flockfile(file_)
+#define OPT_STATS_UNLOCK(file_) funlockfile(file_)
+#endif
+
+typedef struct
+{
+	char *name;
+	unsigned instructions;
+} OptStatsFunction;
+
+static unsigned llvm_count_instructions(LLVMValueRef function)
+{
+	unsigned count = 0;
+	for (LLVMBasicBlockRef block = LLVMGetFirstBasicBlock(function); block; block = LLVMGetNextBasicBlock(block))
+	{
+		for (LLVMValueRef inst = LLVMGetFirstInstruction(block); inst; inst = LLVMGetNextInstruction(inst)) count++;
+	}
+	return count;
+}
+
+/**
+ * Record the size of every function defined in the module before it is optimized.
+ * The names are copied, since optimization may delete the functions.
+ */
+static OptStatsFunction *llvm_opt_stats_collect(LLVMModuleRef module, unsigned *count_ref)
+{
+	unsigned count = 0;
+	for (LLVMValueRef function = LLVMGetFirstFunction(module); function; function = LLVMGetNextFunction(function))
+	{
+		if (!LLVMIsDeclaration(function)) count++;
+	}
+	OptStatsFunction *functions = ccalloc(sizeof(OptStatsFunction), count ? count : 1);
+	unsigned index = 0;
+	for (LLVMValueRef function = LLVMGetFirstFunction(module); function; function = LLVMGetNextFunction(function))
+	{
+		if (LLVMIsDeclaration(function)) continue;
+		size_t len;
+		const char *name = LLVMGetValueName2(function, &len);
+		char *copy = cmalloc(len + 1);
+		memcpy(copy, name, len);
+		copy[len] = 0;
+		functions[index++] = (OptStatsFunction) { .name = copy, .instructions = llvm_count_instructions(function) };
+	}
+	*count_ref = count;
+	return functions;
+}
+
+static void llvm_opt_stats_print_string(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (const char *c = str; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', file);
+			fputc(*c, file);
+			continue;
+		}
+		if ((unsigned char)*c < 0x20)
+		{
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+			continue;
+		}
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+/**
+ * Print the --print-opt-stats line for a module: the time of each pass, slowest first,
+ * and the instruction count of each function before and after optimization, where
+ * a function removed by the optimizer has 0 after. This runs on the task queue, so
+ * the line is written while holding the stdout lock, to keep the lines whole.
+ */
+static void llvm_opt_stats_print(GenContext *c, LLVMPasses *passes, OptStatsFunction *functions, unsigned count, double seconds)
+{
+	FILE *file = stdout;
+	OPT_STATS_LOCK(file);
+	fputs("{\"module\":", file);
+	llvm_opt_stats_print_string(file, c->code_module->name->module);
+	fprintf(file, ",\"unit\":%u,\"optimize_ms\":%.3f,\"passes\":[", c->codegen_unit, seconds * 1000);
+	for (unsigned i = 0; i < passes->timing.count; i++)
+	{
+		LLVMPassTiming *timing = &passes->timing.entries[i];
+		fputs(i ? ",{\"name\":" : "{\"name\":", file);
+		llvm_opt_stats_print_string(file, timing->name);
+		fprintf(file, ",\"runs\":%u,\"ms\":%.3f}", timing->runs, timing->seconds * 1000);
+		free(timing->name);
+	}
+	free(passes->timing.entries);
+	fputs("],\"functions\":[", file);
+	for (unsigned i = 0; i < count; i++)
+	{
+		LLVMValueRef function = LLVMGetNamedFunction(c->module, functions[i].name);
+		unsigned after = function && !LLVMIsDeclaration(function) ? llvm_count_instructions(function) : 0;
+		fputs(i ? ",{\"name\":" : "{\"name\":", file);
+		llvm_opt_stats_print_string(file, functions[i].name);
+		fprintf(file, ",\"before\":%u,\"after\":%u}", functions[i].instructions, after);
+		free(functions[i].name);
+	}
+	free(functions);
+	fputs("]}\n", file);
+	fflush(file);
+	OPT_STATS_UNLOCK(file);
 }
 
 const char *llvm_codegen(void *context)
 {
 	GenContext *c = context;
-	llvm_optimize(c);
+	LLVMPasses passes;
+	llvm_setup_passes(&passes);
+	passes.pipeline = llvm_module_pipeline(c->code_module);
+
+	// Reuse the object file from an earlier build if neither the module nor the options changed.
+	// The optimization stats need the optimizer to run, so never reuse objects then.
+	bool can_reuse = compiler.build.emit_object_files && !compiler.build.emit_llvm && !compiler.build.emit_asm
+		&& !compiler.build.print_opt_stats;
+	bool reuse_object = can_reuse && incremental_build();
+	// The cache only stores the object, not the .dwo next to it.
+	bool use_cache = can_reuse && compiler.build.object_cache_dir && !split_dwarf();
+	uint64_t fingerprint = 0;
+	char *cache_key = NULL;
+	size_t cache_key_len = 0;
+	if (reuse_object || use_cache)
+	{
+		cache_key = llvm_module_cache_key(c, &passes, &cache_key_len);
+		fingerprint = fnv1a_64(cache_key, cache_key_len, FNV1_64_SEED);
+		const char *object_name = c->object_filename;
+		bool reused = reuse_object && llvm_object_is_current(object_name, fingerprint);
+		if (!reused && reuse_object)
+		{
+			// Invalidate the old fingerprint in case emitting the object fails halfway.
+			llvm_object_clear_fingerprint(object_name);
+		}
+		if (!reused && use_cache && llvm_object_cache_fetch(object_name, fingerprint, cache_key, cache_key_len))
+		{
+			reused = true;
+			if (reuse_object) llvm_object_write_fingerprint(object_name, fingerprint);
+		}
+		if (reused)
+		{
+			free(cache_key);
+			gencontext_end_module(c);
+			gencontext_destroy(c);
+			return object_name;
+		}
+	}
+
+	const char *module_name = c->code_module->name->module;
+	double start = trace_begin();
+	OptStatsFunction *stats_functions = NULL;
+	unsigned stats_function_count = 0;
+	double stats_start = 0;
+	if (compiler.build.print_opt_stats)
+	{
+		stats_functions = llvm_opt_stats_collect(c->module, &stats_function_count);
+		passes.timing.enabled = true;
+		stats_start = bench_mark();
+	}
+	if (!llvm_run_passes(c->module, c->machine, &passes))
+	{
+		error_exit("Failed to run passes.");
+	}
+	trace_end("codegen", "llvm_optimize", module_name, start);
+	if (stats_functions)
+	{
+		llvm_opt_stats_print(c, &passes, stats_functions, stats_function_count, bench_mark() - stats_start);
+	}
 
 	// Serialize the LLVM IR, if requested, also verify the IR in this case
 	if (compiler.build.emit_llvm)
@@ -1081,14 +1454,39 @@ const char *llvm_codegen(void *context)
 	if (compiler.build.emit_asm)
 	{
 		// Clone if there will be object file output.
+		start = trace_begin();
 		llvm_emit_file(c, c->asm_filename, LLVMAssemblyFile, compiler.build.emit_object_files);
+		trace_end("codegen", "llvm_emit_file (asm)", module_name, start);
 	}
 
 	if (compiler.build.emit_object_files)
 	{
-		llvm_emit_file(c, c->object_filename, LLVMObjectFile, false);
+		start = trace_begin();
+		if (passes.thin_lto)
+		{
+			// The "object" is bitcode with a summary, machine code is generated when linking.
+			if (!llvm_write_thin_lto_bitcode(c->module, c->object_filename))
+			{
+				error_exit("Could not emit '%s'.", c->object_filename);
+			}
+		}
+		else if (c->dwo_filename)
+		{
+			if (!llvm_emit_object_split_dwarf(c->machine, c->module, c->object_filename, c->dwo_filename))
+			{
+				error_exit("Could not emit '%s' with its debug info in '%s'.", c->object_filename, c->dwo_filename);
+			}
+		}
+		else
+		{
+			llvm_emit_file(c, c->object_filename, LLVMObjectFile, false);
+		}
+		trace_end("codegen", "llvm_emit_file", module_name, start);
 		object_name = c->object_filename;
+		if (reuse_object) llvm_object_write_fingerprint(object_name, fingerprint);
+		if (use_cache) llvm_object_cache_store(object_name, fingerprint, cache_key, cache_key_len);
 	}
+	free(cache_key);
 
 	gencontext_end_module(c);
 	gencontext_destroy(c);
@@ -1101,7 +1499,7 @@ void llvm_add_global_decl(GenContext *c, Decl *decl)
 {
 	ASSERT_SPAN(decl, decl->var.kind == VARDECL_GLOBAL || decl->var.kind == VARDECL_CONST);
 
-	bool same_module = decl->unit->module == c->code_module;
+	bool same_module = llvm_decl_in_codegen_unit(c, decl);
 	LLVMTypeRef type = llvm_get_type(c, decl->type);
 	if (same_module)
 	{
@@ -1209,6 +1607,14 @@ void llvm_append_function_attributes(GenContext *c, Decl *decl)
 	}
 	llvm_attribute_add_string(c, function, "stack-protector-buffer-size", "8", -1);
 	llvm_attribute_add_string(c, function, "no-trapping-math", "true", -1);
+	if (thin_lto())
+	{
+		// The link time backends only see the bitcode, so the cpu has to be recorded on each function.
+		const char *cpu = compiler.platform.cpu;
+		const char *features = compiler.platform.features;
+		if (cpu && cpu[0]) llvm_attribute_add_string(c, function, "target-cpu", cpu, -1);
+		if (features && features[0]) llvm_attribute_add_string(c, function, "target-features", features, -1);
+	}
 
 	if (prototype->ret_by_ref)
 	{
@@ -1232,7 +1638,7 @@ void llvm_append_function_attributes(GenContext *c, Decl *decl)
 	}
 	if (decl->is_export && arch_is_wasm(compiler.platform.arch))
 	{
-		if (c->code_module == decl->unit->module)
+		if (llvm_decl_in_codegen_unit(c, decl))
 		{
 			scratch_buffer_set_extern_decl_name(decl, true);
 			llvm_attribute_add_string(c, function, "wasm-export-name", scratch_buffer_to_string(), -1);
@@ -1242,9 +1648,9 @@ void llvm_append_function_attributes(GenContext *c, Decl *decl)
 	{
 		scratch_buffer_set_extern_decl_name(decl, true);
 		llvm_attribute_add_string(c, function, "wasm-import-name", scratch_buffer_to_string(), -1);
-		if (decl->attrs_resolved && decl->attrs_resolved->wasm_module)
+		if (decl_attrs_resolved(decl) && decl_attrs_resolved(decl)->wasm_module)
 		{
-			llvm_attribute_add_string(c, function, "wasm-import-module", decl->attrs_resolved->wasm_module, -1);
+			llvm_attribute_add_string(c, function, "wasm-import-module", decl_attrs_resolved(decl)->wasm_module, -1);
 		}
 	}
 	if (decl->alignment != type_abi_alignment(decl->type))
@@ -1515,17 +1921,90 @@ INLINE GenContext *llvm_gen_benchmarks(Module** modules, unsigned module_count,
 	return c;
 }
 
+static unsigned llvm_unit_function_count(CompilationUnit *unit)
+{
+	return vec_size(unit->functions) + vec_size(unit->methods) + vec_size(unit->lambdas);
+}
+
+/**
+ * Spread the files of a large module over up to --codegen-units parts, balanced by their number
+ * of functions. The split is by file rather than by function, since @local symbols and lambdas
+ * only have to be unique within their file and must therefore keep internal linkage.
+ *
+ * @return the number of codegen units the module uses.
+ */
+static unsigned llvm_partition_module(Module *module)
+{
+	unsigned file_count = vec_size(module->units);
+	unsigned total = 0;
+	FOREACH(CompilationUnit *, unit, module->units)
+	{
+		unit->codegen_unit = 0;
+		total += llvm_unit_function_count(unit);
+	}
+	unsigned units = compiler.build.codegen_units;
+	// Don't bother splitting modules which are quick to compile anyway.
+	if (units > total / CODEGEN_UNIT_MIN_FUNCTIONS) units = total / CODEGEN_UNIT_MIN_FUNCTIONS;
+	if (units > file_count) units = file_count;
+	if (units < 2) return 1;
+
+	// Place the largest remaining file in the smallest unit so far.
+	unsigned *sizes = ccalloc(sizeof(unsigned), units);
+	bool *placed = ccalloc(sizeof(bool), file_count);
+	for (unsigned i = 0; i < file_count; i++)
+	{
+		unsigned largest = 0;
+		unsigned largest_size = 0;
+		bool found = false;
+		for (unsigned j = 0; j < file_count; j++)
+		{
+			if (placed[j]) continue;
+			unsigned size = llvm_unit_function_count(module->units[j]);
+			if (found && size <= largest_size) continue;
+			found = true;
+			largest = j;
+			largest_size = size;
+		}
+		unsigned smallest = 0;
+		for (unsigned j = 1; j < units; j++)
+		{
+			if (sizes[j] < sizes[smallest]) smallest = j;
+		}
+		placed[largest] = true;
+		module->units[largest]->codegen_unit = smallest;
+		sizes[smallest] += largest_size;
+	}
+	free(sizes);
+	free(placed);
+	return units;
+}
+
+// Set up the parts of LLVM that don't depend on the build, see compiler_daemon.
+void llvm_codegen_warm_up(void)
+{
+	llvm_target_init();
+	llvm_codegen_setup();
+}
+
 void **llvm_gen(Module** modules, unsigned module_count)
 {
 	if (!module_count) return NULL;
 	GenContext **gen_contexts = NULL;
 	llvm_codegen_setup();
+	if (compiler.build.pgo_profile)
+	{
+		size_t size;
+		char *profile = file_read_all(compiler.build.pgo_profile, &size);
+		pgo_profile_hash = fnv1a_64(profile, size, FNV1_64_SEED);
+	}
 	if (compiler.build.single_module == SINGLE_MODULE_ON)
 	{
 		LLVMContextRef context = LLVMGetGlobalContext();
 		for (int i = 0; i < module_count; i++)
 		{
-			GenContext *result = llvm_gen_module(modules[i], context);
+			double start = trace_begin();
+			GenContext *result = llvm_gen_module(modules[i], context, 0, false);
+			trace_end("irgen", "llvm_gen_module", modules[i]->name->module, start);
 			if (!result) continue;
 			vec_add(gen_contexts, result);
 		}
@@ -1551,9 +2030,16 @@ void **llvm_gen(Module** modules, unsigned module_count)
 	}
 	for (unsigned i = 0; i < module_count; i++)
 	{
-		GenContext *result = llvm_gen_module(modules[i], NULL);
-		if (!result) continue;
-		vec_add(gen_contexts, result);
+		Module *module = modules[i];
+		unsigned codegen_units = llvm_partition_module(module);
+		for (unsigned unit = 0; unit < codegen_units; unit++)
+		{
+			double start = trace_begin();
+			GenContext *result = llvm_gen_module(module, NULL, unit, codegen_units > 1);
+			trace_end("irgen", "llvm_gen_module", module->name->module, start);
+			if (!result) continue;
+			vec_add(gen_contexts, result);
+		}
 	}
 	if (compiler.build.benchmarking)
 	{
@@ -1583,17 +2069,8 @@ LLVMMetadataRef llvm_get_debug_file(GenContext *c, FileId file_id)
 	return file;
 }
 
-static bool module_is_stdlib(Module *module)
-{
-	if (module->name->len < 3) return false;
-	if (module->name->len == 3 && strcmp(module->name->module, "std") == 0) return true;
-	if (module->name->len > 5 && memcmp(module->name->module, "std::", 5) == 0) return true;
-	if (module->name->len == 4 && strcmp(module->name->module, "libc") == 0) return true;
-	if (module->name->len > 6 && memcmp(module->name->module, "libc::", 6) == 0) return true;
-	return false;
-}
 
-static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context)
+static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context, unsigned codegen_unit, bool split_module)
 {
 	if (!vec_size(module->units)) return NULL;
 	if (compiler.build.emit_stdlib == EMIT_STDLIB_OFF && module_is_stdlib(module)) return NULL;
@@ -1603,12 +2080,15 @@ static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context
 	bool has_elements = false;
 	GenContext *gen_context = cmalloc(sizeof(GenContext));
 	gencontext_init(gen_context, module, shared_context);
+	gen_context->codegen_unit = codegen_unit;
+	gen_context->split_module = split_module;
 	gencontext_begin_module(gen_context);
 
 	bool only_used = strip_unused();
 
 	FOREACH(CompilationUnit *, unit, module->units)
 	{
+		if (unit->codegen_unit != codegen_unit) continue;
 		gencontext_init_file_emit(gen_context, unit);
 		gen_context->debug.compile_unit = unit->llvm.debug_compile_unit;
 		gen_context->debug.file = (DebugFile){ .debug_file = unit->llvm.debug_file, .file_id = unit->file->file_id };
@@ -1665,6 +2145,7 @@ static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context
 
 	FOREACH(CompilationUnit *, unit, module->units)
 	{
+		if (unit->codegen_unit != codegen_unit) continue;
 		gen_context->debug.compile_unit = unit->llvm.debug_compile_unit;
 		gen_context->debug.file = (DebugFile){
 				.debug_file = unit->llvm.debug_file,
@@ -1737,7 +2218,12 @@ static GenContext *llvm_gen_module(Module *module, LLVMContextRef shared_context
 		gencontext_print_llvm_ir(gen_context);
 		gencontext_verify_ir(gen_context);
 	}
-	if (!has_elements) return NULL;
+	if (!has_elements)
+	{
+		// Nothing is emitted for this module, so let the next module describe its types.
+		FOREACH(Decl *, decl, gen_context->debug.owned_types) decl->debug_type_emitted = false;
+		return NULL;
+	}
 	return gen_context;
 }
 
@@ -26,6 +26,35 @@ INLINE void llvm_emit_reverse(GenContext *c, BEValue *result_value, Expr *expr)
 	llvm_value_set(result_value, LLVMBuildShuffleVector(c->builder, arg1, arg2, mask, "reverse"), rtype);
 }
 
+INLINE void llvm_emit_shuffle(GenContext *c, BEValue *result_value, Expr *expr)
+{
+	Expr **args = expr->call_expr.arguments;
+	LLVMValueRef arg_slots[2];
+	llvm_emit_intrinsic_args(c, args, arg_slots, 2);
+	LLVMValueRef vec = arg_slots[0];
+	LLVMValueRef indices = arg_slots[1];
+	Type *index_type = type_lowering(type_flatten(args[1]->type)->array.base);
+	unsigned len = type_flatten(args[0]->type)->array.len;
+	unsigned elements = type_flatten(expr->type)->array.len;
+	LLVMTypeRef element_type = LLVMGetElementType(LLVMTypeOf(vec));
+	LLVMValueRef zero = llvm_get_zero_raw(element_type);
+	LLVMValueRef len_val = llvm_const_int(c, index_type, len);
+	LLVMValueRef index_zero = llvm_const_int(c, index_type, 0);
+	LLVMValueRef result = LLVMGetPoison(llvm_get_type(c, expr->type));
+	// Lanes with an out of range index are zeroed, like pshufb and tbl.
+	for (unsigned i = 0; i < elements; i++)
+	{
+		LLVMValueRef lane = llvm_const_int(c, type_uint, i);
+		LLVMValueRef index = LLVMBuildExtractElement(c->builder, indices, lane, "");
+		LLVMValueRef in_range = LLVMBuildICmp(c->builder, LLVMIntULT, index, len_val, "");
+		index = LLVMBuildSelect(c->builder, in_range, index, index_zero, "");
+		LLVMValueRef val = LLVMBuildExtractElement(c->builder, vec, index, "");
+		val = LLVMBuildSelect(c->builder, in_range, val, zero, "");
+		result = LLVMBuildInsertElement(c->builder, result, val, lane, "");
+	}
+	llvm_value_set(result_value, result, expr->type);
+}
+
 INLINE void llvm_emit_select(GenContext *c, BEValue *result_value, Expr *expr)
 {
 	Expr **args = expr->call_expr.arguments;
@@ -142,6 +171,32 @@ INLINE void llvm_emit_volatile_load(GenContext *c, BEValue *result_value, Expr *
 	LLVMSetVolatile(result_value->value, true);
 }
 
+static void llvm_set_nontemporal(GenContext *c, LLVMValueRef inst)
+{
+	if (!inst || (!LLVMIsAStoreInst(inst) && !LLVMIsALoadInst(inst))) return;
+	LLVMMetadataRef one = LLVMValueAsMetadata(llvm_const_int(c, type_int, 1));
+	LLVMMetadataRef node = LLVMMDNodeInContext2(c->context, &one, 1);
+	LLVMSetMetadata(inst, LLVMGetMDKindIDInContext(c->context, "nontemporal", 11), LLVMMetadataAsValue(c->context, node));
+}
+
+INLINE void llvm_emit_nontemporal_store(GenContext *c, BEValue *result_value, Expr *expr)
+{
+	BEValue value;
+	llvm_emit_expr(c, &value, expr->call_expr.arguments[0]);
+	llvm_emit_expr(c, result_value, expr->call_expr.arguments[1]);
+	llvm_value_deref(c, &value);
+	BEValue store_value = *result_value;
+	llvm_set_nontemporal(c, llvm_store(c, &value, &store_value));
+}
+
+INLINE void llvm_emit_nontemporal_load(GenContext *c, BEValue *result_value, Expr *expr)
+{
+	llvm_emit_expr(c, result_value, expr->call_expr.arguments[0]);
+	llvm_value_deref(c, result_value);
+	llvm_value_rvalue(c, result_value);
+	llvm_set_nontemporal(c, result_value->value);
+}
+
 INLINE void llvm_emit_atomic_store(GenContext *c, BEValue *result_value, Expr *expr)
 {
 	BEValue value;
@@ -342,6 +397,48 @@ static inline void llvm_emit_syscall(GenContext *c, BEValue *be_value, Expr *exp
 	llvm_value_set(be_value, result, type_uptr);
 }
 
+static inline void llvm_emit_asm_fence(GenContext *c, const char *instr)
+{
+	LLVMTypeRef func_type = LLVMFunctionType(llvm_get_type(c, type_void), NULL, 0, false);
+	LLVMValueRef fence = LLVMGetInlineAsm(func_type, (char *)instr, strlen(instr), "~{memory}", 9,
+	                                      true, false, LLVMInlineAsmDialectATT, /* can throw */ false);
+	LLVMBuildCall2(c->builder, func_type, fence, NULL, 0, "");
+}
+
+/**
+ * Read the time stamp counter. AArch64 reads the virtual counter, which unlike the
+ * cycle counter that readcyclecounter uses, can be read from user mode. The fenced
+ * version waits for earlier instructions to finish and keeps later ones from
+ * starting before the read.
+ */
+static inline void llvm_emit_sysclock(GenContext *c, BEValue *result_value, bool fenced)
+{
+	switch (compiler.platform.arch)
+	{
+		case ARCH_TYPE_AARCH64:
+		case ARCH_TYPE_AARCH64_BE:
+		{
+			LLVMTypeRef type = llvm_get_type(c, type_ulong);
+			LLVMTypeRef func_type = LLVMFunctionType(type, NULL, 0, false);
+			const char *instr = fenced ? "isb\n\tmrs $0, cntvct_el0\n\tisb" : "mrs $0, cntvct_el0";
+			const char *constraints = fenced ? "=r,~{memory}" : "=r";
+			LLVMValueRef read = LLVMGetInlineAsm(func_type, (char *)instr, strlen(instr), (char *)constraints, strlen(constraints),
+			                                     true, false, LLVMInlineAsmDialectATT, /* can throw */ false);
+			llvm_value_set(result_value, LLVMBuildCall2(c->builder, func_type, read, NULL, 0, "sysclock"), type_ulong);
+			return;
+		}
+		case ARCH_TYPE_X86:
+		case ARCH_TYPE_X86_64:
+			if (fenced) llvm_emit_asm_fence(c, "lfence");
+			llvm_value_set(result_value, llvm_emit_call_intrinsic(c, intrinsic_id.readcyclecounter, NULL, 0, NULL, 0), type_ulong);
+			if (fenced) llvm_emit_asm_fence(c, "lfence");
+			return;
+		default:
+			llvm_value_set(result_value, llvm_emit_call_intrinsic(c, intrinsic_id.readcyclecounter, NULL, 0, NULL, 0), type_ulong);
+			return;
+	}
+}
+
 INLINE unsigned llvm_intrinsic_by_type(Type *type, unsigned int_intrinsic, unsigned uint_intrinsic, unsigned float_intrinsic)
 {
 	type = type_flatten(type);
@@ -767,12 +864,21 @@ void llvm_emit_builtin_call(GenContext *c, BEValue *result_value, Expr *expr)
 		case BUILTIN_REVERSE:
 			llvm_emit_reverse(c, result_value, expr);
 			return;
+		case BUILTIN_SHUFFLE:
+			llvm_emit_shuffle(c, result_value, expr);
+			return;
 		case BUILTIN_VOLATILE_STORE:
 			llvm_emit_volatile_store(c, result_value, expr);
 			return;
 		case BUILTIN_VOLATILE_LOAD:
 			llvm_emit_volatile_load(c, result_value, expr);
 			return;
+		case BUILTIN_NONTEMPORAL_STORE:
+			llvm_emit_nontemporal_store(c, result_value, expr);
+			return;
+		case BUILTIN_NONTEMPORAL_LOAD:
+			llvm_emit_nontemporal_load(c, result_value, expr);
+			return;
 		case BUILTIN_ATOMIC_STORE:
 			llvm_emit_atomic_store(c, result_value, expr);
 			return;
@@ -823,7 +929,8 @@ void llvm_emit_builtin_call(GenContext *c, BEValue *result_value, Expr *expr)
 			llvm_emit_simple_builtin(c, result_value, expr, intrinsic_id.matrix_transpose);
 			return;
 		case BUILTIN_SYSCLOCK:
-			llvm_value_set(result_value, llvm_emit_call_intrinsic(c, intrinsic_id.readcyclecounter, NULL, 0, NULL, 0), expr->type);
+		case BUILTIN_SYSCLOCK_FENCED:
+			llvm_emit_sysclock(c, result_value, func == BUILTIN_SYSCLOCK_FENCED);
 			return;
 		case BUILTIN_TRAP:
 			llvm_value_set(result_value, llvm_emit_call_intrinsic(c, intrinsic_id.trap, NULL, 0, NULL, 0), type_void);
@@ -21,6 +21,9 @@ static LLVMMetadataRef llvm_debug_errunion_type(GenContext *c, Type *type);
 static LLVMMetadataRef llvm_debug_slice_type(GenContext *c, Type *type);
 static LLVMMetadataRef llvm_debug_any_type(GenContext *c, Type *type);
 static LLVMMetadataRef llvm_debug_enum_type(GenContext *c, Type *type, LLVMMetadataRef scope);
+static bool llvm_debug_use_declaration(GenContext *c, Type *type);
+static LLVMMetadataRef llvm_debug_declaration(GenContext *c, Type *type, LLVMMetadataRef scope);
+static LLVMMetadataRef llvm_debug_retain(GenContext *c, LLVMMetadataRef debug_type);
 
 INLINE LLVMMetadataRef llvm_create_debug_location_with_inline(GenContext *c, unsigned row, unsigned col, LLVMMetadataRef scope)
 {
@@ -36,7 +39,7 @@ static inline LLVMMetadataRef llvm_get_debug_struct(GenContext *c, Type *type, c
 	if (loc)
 	{
 		file = c->debug.file.debug_file;
-		row = loc->row;
+		row = span_row(*loc);
 		if (!row) row = 1;
 	}
 	LLVMMetadataRef real = LLVMDIBuilderCreateStructType(c->debug.builder,
@@ -67,7 +70,7 @@ static inline LLVMMetadataRef llvm_get_debug_member(GenContext *c, Type *type, c
 			scope,
 			name, strlen(name),
 			loc ? c->debug.file.debug_file : NULL,
-			loc ? loc->row : 0,
+			loc ? span_row(*loc) : 0,
 			type_size(type) * 8,
 			(uint32_t)(type_abi_alignment(type) * 8),
 			offset * 8, flags, llvm_get_debug_type_internal(c, type, scope));
@@ -88,7 +91,7 @@ void llvm_emit_debug_function(GenContext *c, Decl *decl)
 	flags |= LLVMDIFlagPrototyped;
 	if (decl->func_decl.signature.attrs.noreturn) flags |= LLVMDIFlagNoReturn;
 
-	uint32_t row = decl->span.row;
+	uint32_t row = span_row(decl->span);
 	if (!row) row = 1;
 	ASSERT(decl->name);
 	ASSERT(c->debug.file.debug_file);
@@ -147,8 +150,9 @@ void llvm_emit_debug_local_var(GenContext *c, Decl *decl)
 {
 	ASSERT(llvm_is_local_eval(c));
 	EMIT_EXPR_LOC(c, decl);
-	uint32_t row = decl->span.row;
-	uint32_t col = decl->span.col;
+	SourceLoc loc = span_location(decl->span);
+	uint32_t row = loc.row;
+	uint32_t col = loc.col;
 	if (!row) row = 1;
 	if (!col) col = 1;
 	const char *name = decl->name;
@@ -183,9 +187,10 @@ void llvm_emit_debug_parameter(GenContext *c, Decl *parameter, unsigned index)
 	const char *name = parameter->name ? parameter->name : ".anon";
 	bool always_preserve = false;
 
-	unsigned row = parameter->span.row;
+	SourceLoc loc = span_location(parameter->span);
+	unsigned row = loc.row;
 	if (row == 0) row = 1;
-	unsigned col = parameter->span.col;
+	unsigned col = loc.col;
 	if (col == 0) col = 1;
 
 	parameter->var.backend_debug_ref = LLVMDIBuilderCreateParameterVariable(
@@ -212,8 +217,9 @@ void llvm_emit_debug_parameter(GenContext *c, Decl *parameter, unsigned index)
 LLVMMetadataRef llvm_create_debug_location(GenContext *c, SourceSpan location)
 {
 	LLVMMetadataRef scope = llvm_debug_current_scope(c);
-	unsigned row = location.row;
-	unsigned col = location.col;
+	SourceLoc loc = span_location(location);
+	unsigned row = loc.row;
+	unsigned col = loc.col;
 	return llvm_create_debug_location_with_inline(c, row ? row : 1, col ? col : 1, scope);
 }
 
@@ -222,9 +228,15 @@ void llvm_emit_debug_location(GenContext *c, SourceSpan location)
 	if (llvm_is_global_eval(c)) return;
 	// Avoid re-emitting the same location.
 	LLVMMetadataRef oldloc = LLVMGetCurrentDebugLocation2(c->builder);
+	if (!c->debug.emit_expr_loc && location.pos)
+	{
+		// Without columns, only a change of row needs a new location.
+		SourceLoc line_start = span_location(location);
+		location.pos -= line_start.col - 1;
+		location.length = 0;
+	}
 	if (oldloc && c->last_emitted_loc.a == location.a) return;
 	LLVMMetadataRef loc = c->last_loc = llvm_create_debug_location(c, location);
-	if (!c->debug.emit_expr_loc) location.col = 0;
 	c->last_emitted_loc.a = location.a;
 	LLVMSetCurrentDebugLocation2(c->builder, loc);
 
@@ -235,7 +247,7 @@ static LLVMMetadataRef llvm_debug_forward_comp(GenContext *c, Type *type, const
 	unsigned row = 0;
 	if (loc)
 	{
-		row = loc->row;
+		row = span_row(*loc);
 		if (!row) row = 1;
 	}
 	return LLVMDIBuilderCreateReplaceableCompositeType(c->debug.builder, id_counter++,
@@ -258,8 +270,9 @@ LLVMMetadataRef llvm_debug_create_macro(GenContext *c, Decl *macro)
 	size_t namelen = strlen(name);
 	LLVMMetadataRef file = llvm_get_debug_file(c, location.file_id);
 	LLVMMetadataRef macro_type = NULL;
+	uint32_t row = span_row(location);
 	return LLVMDIBuilderCreateFunction(c->debug.builder, file, name, namelen, name, namelen,
-	                            file, location.row, macro_type, true, true, location.row, LLVMDIFlagZero, false);
+	                            file, row, macro_type, true, true, row, LLVMDIFlagZero, false);
 }
 
 DebugScope llvm_debug_create_lexical_scope(GenContext *context, SourceSpan location)
@@ -280,8 +293,9 @@ DebugScope llvm_debug_create_lexical_scope(GenContext *context, SourceSpan locat
 		outline_at = NULL;
 	}
 
-	unsigned row = location.row;
-	unsigned col = location.col;
+	SourceLoc loc = span_location(location);
+	unsigned row = loc.row;
+	unsigned col = loc.col;
 	LLVMMetadataRef debug_file = context->debug.file.debug_file;
 	if (location.file_id != context->debug.file.file_id)
 	{
@@ -350,7 +364,7 @@ static LLVMMetadataRef llvm_debug_enum_type(GenContext *c, Type *type, LLVMMetad
 		vec_add(elements, debug_info);
 	}
 
-	unsigned row = decl->span.row;
+	unsigned row = span_row(decl->span);
 	LLVMMetadataRef real = LLVMDIBuilderCreateEnumerationType(c->debug.builder,
 															  scope,
 															  type->decl->name, strlen(type->decl->name),
@@ -401,7 +415,7 @@ static LLVMMetadataRef llvm_debug_structlike_type(GenContext *c, Type *type, LLV
 	}
 	if (type->type_kind == TYPE_UNION)
 	{
-		unsigned row = decl->span.row;
+		unsigned row = span_row(decl->span);
 		real = LLVMDIBuilderCreateUnionType(c->debug.builder,
 											scope,
 											decl->name ? decl->name : "",
@@ -419,6 +433,61 @@ static LLVMMetadataRef llvm_debug_structlike_type(GenContext *c, Type *type, LLV
 	return llvm_get_debug_struct(c, type, extname, elements, vec_size(elements), &decl->span, scope, LLVMDIFlagZero);
 }
 
+/**
+ * When deduplicating, a named type is only described in full by the first module
+ * that needs it, every other module refers to it with a declaration which the
+ * debugger resolves by name.
+ */
+static bool llvm_debug_use_declaration(GenContext *c, Type *type)
+{
+	if (!debug_dedup()) return false;
+	Decl *decl = type->decl;
+	// Anonymous types are only described as part of the enclosing type.
+	if (!decl->name) return false;
+	if (decl->debug_type_emitted) return true;
+	decl->debug_type_emitted = true;
+	vec_add(c->debug.owned_types, decl);
+	return false;
+}
+
+static LLVMMetadataRef llvm_debug_declaration(GenContext *c, Type *type, LLVMMetadataRef scope)
+{
+	Decl *decl = type->decl;
+	unsigned tag = DW_TAG_structure_type;
+	const char *extname = "";
+	unsigned extname_len = 0;
+	switch (type->type_kind)
+	{
+		case TYPE_ENUM:
+			tag = DW_TAG_enumeration_type;
+			break;
+		case TYPE_UNION:
+			tag = DW_TAG_union_type;
+			FALLTHROUGH;
+		default:
+			// Use the same identifier as the full description.
+			scratch_buffer_set_extern_decl_name(decl, true);
+			extname = scratch_buffer_to_string();
+			extname_len = scratch_buffer.len;
+			break;
+	}
+	unsigned row = span_row(decl->span);
+	return LLVMDIBuilderCreateForwardDecl(c->debug.builder, tag,
+										  decl->name, strlen(decl->name),
+										  scope, c->debug.file.debug_file, row ? row : 1,
+										  c->debug.runtime_version,
+										  type_size(type) * 8,
+										  type_abi_alignment(type) * 8,
+										  extname, extname_len);
+}
+
+static LLVMMetadataRef llvm_debug_retain(GenContext *c, LLVMMetadataRef debug_type)
+{
+	// This module owns the description, so it must survive even if optimization removes every use.
+	if (debug_dedup()) LLVMDIBuilderRetainType(c->debug.builder, debug_type);
+	return debug_type;
+}
+
 static LLVMMetadataRef llvm_debug_slice_type(GenContext *c, Type *type)
 {
 	LLVMMetadataRef forward = llvm_debug_forward_comp(c, type, type->name, NULL, NULL, LLVMDIFlagZero);
@@ -499,7 +568,7 @@ static LLVMMetadataRef llvm_debug_typedef_type(GenContext *c, Type *type)
 	{
 		type->backend_debug_type = llvm_debug_forward_comp(c, type, type->name, &decl->span, NULL, LLVMDIFlagZero);
 	}
-	unsigned row = decl->span.row;
+	unsigned row = span_row(decl->span);
 	LLVMMetadataRef real = LLVMDIBuilderCreateTypedef(c->debug.builder,
 													  llvm_get_debug_type(c, original_type),
 													  decl->name, strlen(decl->name),
@@ -615,12 +684,14 @@ static inline LLVMMetadataRef llvm_get_debug_type_internal(GenContext *c, Type *
 		case TYPE_FUNC_PTR:
 			return type->backend_debug_type = llvm_debug_pointer_type(c, type);
 		case TYPE_ENUM:
-			return type->backend_debug_type = llvm_debug_enum_type(c, type, scope);
+			if (llvm_debug_use_declaration(c, type)) return type->backend_debug_type = llvm_debug_declaration(c, type, scope);
+			return type->backend_debug_type = llvm_debug_retain(c, llvm_debug_enum_type(c, type, scope));
 		case TYPE_FUNC_RAW:
 			return type->backend_debug_type = llvm_debug_func_type(c, type);
 		case TYPE_STRUCT:
 		case TYPE_UNION:
-			return type->backend_debug_type = llvm_debug_structlike_type(c, type, scope);
+			if (llvm_debug_use_declaration(c, type)) return type->backend_debug_type = llvm_debug_declaration(c, type, scope);
+			return type->backend_debug_type = llvm_debug_retain(c, llvm_debug_structlike_type(c, type, scope));
 		case TYPE_DISTINCT:
 		case TYPE_TYPEDEF:
 			return type->backend_debug_type = llvm_debug_typedef_type(c, type);
@@ -12,7 +12,7 @@ static inline LLVMValueRef llvm_const_high_bitmask(GenContext *c, LLVMTypeRef ty
 static inline LLVMValueRef llvm_const_low_bitmask(GenContext *c, LLVMTypeRef type, int type_bits, int low_bits);
 static inline LLVMValueRef llvm_update_vector(GenContext *c, LLVMValueRef vector, LLVMValueRef value, ArrayIndex index);
 static inline void llvm_emit_expression_list_expr(GenContext *c, BEValue *be_value, Expr *expr);
-static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id_ptr, LLVMValueRef selector);
+static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id, LLVMValueRef selector);
 static inline void llvm_emit_bitassign_array(GenContext *c, LLVMValueRef result, BEValue parent, Decl *parent_decl, Decl *member);
 static inline void llvm_emit_builtin_access(GenContext *c, BEValue *be_value, Expr *expr);
 static inline void llvm_emit_const_initialize_reference(GenContext *c, BEValue *ref, Expr *expr);
@@ -46,7 +46,6 @@ static void llvm_emit_initialize_designated_element(GenContext *c, BEValue *ref,
 static void llvm_emit_macro_body_expansion(GenContext *c, BEValue *value, Expr *body_expr);
 static void llvm_emit_post_unary_expr(GenContext *context, BEValue *be_value, Expr *expr);
 static void llvm_emit_unary_expr(GenContext *c, BEValue *value, Expr *expr);
-static inline void llvm_emit_memcmp(GenContext *c, BEValue *be_value, LLVMValueRef ptr, LLVMValueRef other_ptr, LLVMValueRef size);
 static LLVMTypeRef llvm_find_inner_struct_type_for_coerce(GenContext *c, LLVMTypeRef struct_type, ByteSize dest_size);
 static void llvm_expand_type_to_args(GenContext *context, Type *param_type, LLVMValueRef expand_ptr, LLVMValueRef *args, unsigned *arg_count_ref, AlignSize alignment);
 static inline void llvm_emit_initialize_reference_designated_bitstruct(GenContext *c, BEValue *ref, Decl *bitstruct, Expr **elements);
@@ -706,9 +705,10 @@ static inline void llvm_emit_subscript_addr(GenContext *c, BEValue *value, Expr
 	// See if we need the length.
 	bool needs_len = false;
 	bool start_from_end = expr->subscript_expr.index.start_from_end;
+	bool check_bounds = c->cur_func.safe_mode && !expr_subscript_in_range(expr);
 	if (parent_type_kind == TYPE_SLICE)
 	{
-		needs_len = safe_mode_enabled() || start_from_end;
+		needs_len = check_bounds || start_from_end;
 		if (needs_len)
 		{
 			llvm_emit_slice_len(c, value, &len);
@@ -719,7 +719,7 @@ static inline void llvm_emit_subscript_addr(GenContext *c, BEValue *value, Expr
 	{
 		// From back should always be folded.
 		ASSERT(!expr_is_const(expr) || !start_from_end);
-		needs_len = (safe_mode_enabled() && !expr_is_const(expr)) || start_from_end;
+		needs_len = (check_bounds && !expr_is_const(expr)) || start_from_end;
 		if (needs_len)
 		{
 			llvm_value_set_int(c, &len, type_isz, value->type->array.len);
@@ -739,7 +739,7 @@ static inline void llvm_emit_subscript_addr(GenContext *c, BEValue *value, Expr
 		ASSERT(needs_len);
 		index.value = LLVMBuildNUWSub(c->builder, llvm_zext_trunc(c, len.value, llvm_get_type(c, index.type)), index.value, "");
 	}
-	if (needs_len && safe_mode_enabled() && !llvm_is_global_eval(c))
+	if (needs_len && check_bounds && !llvm_is_global_eval(c))
 	{
 		llvm_emit_array_bounds_check(c, &index, len.value, index_expr->span);
 	}
@@ -1367,13 +1367,7 @@ void llvm_emit_initialize_reference_temporary_const(GenContext *c, BEValue *ref,
 
 	// Create a global const.
 	AlignSize alignment = type_alloca_alignment(initializer->type);
-	LLVMTypeRef type = LLVMTypeOf(value);
-	LLVMValueRef global_copy = llvm_add_global_raw(c, ".__const", type, alignment);
-	llvm_set_private_declaration(global_copy);
-
-	// Set the value and make it constant
-	LLVMSetInitializer(global_copy, value);
-	LLVMSetGlobalConstant(global_copy, true);
+	LLVMValueRef global_copy = llvm_add_private_constant(c, &c->const_pool, ".__const", value, alignment);
 
 	// Ensure we have a reference.
 	llvm_value_addr(c, ref);
@@ -1413,7 +1407,8 @@ static void llvm_emit_const_init_ref(GenContext *c, BEValue *ref, ConstInitializ
 		return;
 	}
 	// In case of small const initializers, or full arrays - use copy.
-	if (const_init->kind == CONST_INIT_ARRAY_FULL || type_size(const_init->type) <= 32)
+	if (const_init->kind == CONST_INIT_ARRAY_FULL || const_init->kind == CONST_INIT_ARRAY_BYTES
+		|| type_size(const_init->type) <= 32)
 	{
 		if (top && const_init_local_init_may_be_global(const_init))
 		{
@@ -1455,6 +1450,27 @@ static void llvm_emit_const_init_ref(GenContext *c, BEValue *ref, ConstInitializ
 			}
 			return;
 		}
+		case CONST_INIT_ARRAY_BYTES:
+		{
+			LLVMValueRef array_ref = ref->value;
+			Type *array_type = const_init->type;
+			Type *element_type = array_type->array.base;
+			ArrayIndex size = (ArrayIndex)array_type->array.len;
+			LLVMTypeRef array_type_llvm = llvm_get_type(c, array_type);
+			ASSERT(size <= UINT32_MAX);
+			Expr element = { .expr_kind = EXPR_CONST };
+			ConstInitializer element_init = { .kind = CONST_INIT_VALUE, .type = type_flatten(element_type), .init_value = &element };
+			for (ArrayIndex i = 0; i < size; i++)
+			{
+				AlignSize alignment;
+				LLVMValueRef array_pointer = llvm_emit_array_gep_raw(c, array_ref, array_type_llvm, (unsigned)i, ref->alignment, &alignment);
+				BEValue value;
+				llvm_value_set_address(&value, array_pointer, element_type, alignment);
+				const_init_bytes_rewrite_expr_at(const_init, i, &element);
+				llvm_emit_const_init_ref(c, &value, &element_init, false);
+			}
+			return;
+		}
 		case CONST_INIT_ARRAY:
 		{
 			LLVMValueRef array_ref = ref->value;
@@ -2302,7 +2318,7 @@ static inline void llvm_emit_deref(GenContext *c, BEValue *value, Expr *inner, T
 	llvm_emit_expr(c, value, inner);
 	llvm_value_rvalue(c, value);
 	AlignSize alignment = type_abi_alignment(type);
-	if (safe_mode_enabled())
+	if (c->cur_func.safe_mode)
 	{
 		LLVMValueRef check = LLVMBuildICmp(c->builder, LLVMIntEQ, value->value, llvm_get_zero(c, inner->type), "checknull");
 		scratch_buffer_clear();
@@ -2362,13 +2378,19 @@ static inline void llvm_emit_post_inc_dec(GenContext *c, BEValue *value, Expr *e
 
 static void llvm_emit_dynamic_method_addr(GenContext *c, BEValue *value, Expr *expr)
 {
-	llvm_emit_expr(c, value, expr->access_resolved_expr.parent);
+	Expr *parent = expr->access_resolved_expr.parent;
+	Decl *dyn_fn = expr->access_resolved_expr.ref;
+	llvm_emit_expr(c, value, parent);
+	Decl *target_method = expr_find_dynamic_target(parent, dyn_fn, c->cur_func.decl);
+	if (target_method)
+	{
+		llvm_value_set(value, llvm_get_ref(c, target_method), type_get_func_ptr(dyn_fn->type));
+		return;
+	}
 	llvm_emit_type_from_any(c, value);
 	llvm_value_rvalue(c, value);
-	LLVMValueRef introspect = LLVMBuildIntToPtr(c->builder, value->value, c->ptr_type, "");
 
-	Decl *dyn_fn = expr->access_resolved_expr.ref;
-	LLVMValueRef func = llvm_emit_dynamic_search(c, introspect, llvm_get_ref(c, dyn_fn));
+	LLVMValueRef func = llvm_emit_dynamic_search(c, value->value, llvm_get_ref(c, dyn_fn));
 
 	llvm_value_set(value, func, type_get_func_ptr(dyn_fn->type));
 }
@@ -2479,7 +2501,7 @@ static void llvm_emit_unary_expr(GenContext *c, BEValue *value, Expr *expr)
 static void llvm_emit_trap_negative(GenContext *c, Expr *expr, LLVMValueRef value, const char *error,
 									BEValue *index_val)
 {
-	if (!safe_mode_enabled()) return;
+	if (!c->cur_func.safe_mode) return;
 	if (type_is_integer_unsigned(expr->type->canonical)) return;
 
 	LLVMValueRef zero = llvm_const_int(c, expr->type, 0);
@@ -2489,7 +2511,7 @@ static void llvm_emit_trap_negative(GenContext *c, Expr *expr, LLVMValueRef valu
 
 static void llvm_emit_trap_zero(GenContext *c, Type *type, LLVMValueRef value, const char *error, SourceSpan loc)
 {
-	if (!safe_mode_enabled()) return;
+	if (!c->cur_func.safe_mode) return;
 
 	ASSERT(type == type_flatten(type));
 
@@ -2518,7 +2540,7 @@ static void llvm_emit_trap_zero(GenContext *c, Type *type, LLVMValueRef value, c
 
 static void llvm_emit_trap_invalid_shift(GenContext *c, LLVMValueRef value, Type *type, const char *error, SourceSpan loc)
 {
-	if (!safe_mode_enabled()) return;
+	if (!c->cur_func.safe_mode) return;
 	BEValue val;
 	type = type_flatten(type);
 	llvm_value_set(&val, value, type);
@@ -2620,7 +2642,7 @@ static void llvm_emit_slice_values(GenContext *c, Expr *slice, BEValue *parent_r
 	bool start_from_end = range.start_from_end;
 	bool end_from_end = range.end_from_end;
 	bool has_end = range.range_type != RANGE_DYNAMIC || range.end;
-	if (!has_end || start_from_end || end_from_end || safe_mode_enabled())
+	if (!has_end || start_from_end || end_from_end || c->cur_func.safe_mode)
 	{
 		switch (parent_type->type_kind)
 		{
@@ -2649,7 +2671,7 @@ static void llvm_emit_slice_values(GenContext *c, Expr *slice, BEValue *parent_r
 	}
 
 	// Check that index does not extend beyond the length.
-	if (check_end && safe_mode_enabled())
+	if (check_end && c->cur_func.safe_mode)
 	{
 		ASSERT(len.value);
 		BEValue exceeds_size;
@@ -2702,7 +2724,7 @@ static void llvm_emit_slice_values(GenContext *c, Expr *slice, BEValue *parent_r
 		}
 
 		// This will trap any bad negative index, so we're fine.
-		if (safe_mode_enabled())
+		if (c->cur_func.safe_mode)
 		{
 			BEValue excess;
 			if (is_len_range)
@@ -2814,7 +2836,7 @@ static void llvm_emit_slice_copy(GenContext *c, BEValue *be_value, Expr *expr)
 	llvm_emit_slice_len(c, be_value, &from_len);
 	llvm_value_rvalue(c, &from_len);
 
-	if (safe_mode_enabled())
+	if (c->cur_func.safe_mode)
 	{
 		BEValue to_len;
 		llvm_emit_slice_len(c, &assigned_to, &to_len);
@@ -3409,7 +3431,7 @@ INLINE bool should_inline_array_comp(ArraySize len, Type *base_type_lowered)
 	}
 }
 
-static inline void llvm_emit_memcmp(GenContext *c, BEValue *be_value, LLVMValueRef ptr, LLVMValueRef other_ptr, LLVMValueRef size)
+void llvm_emit_memcmp(GenContext *c, BEValue *be_value, LLVMValueRef ptr, LLVMValueRef other_ptr, LLVMValueRef size)
 {
 	if (!c->memcmp_function)
 	{
@@ -4015,6 +4037,7 @@ void llvm_emit_binary(GenContext *c, BEValue *be_value, Expr *expr, BEValue *lhs
 	Type *rhs_type = rhs.type;
 	Type *vector_type = lhs_type->type_kind == TYPE_VECTOR ? lhs_type->array.base : NULL;
 	bool is_float = type_is_float(lhs_type) || (vector_type && type_is_float(vector_type));
+	bool is_unsigned = type_is_unsigned(vector_type ? vector_type : lhs_type);
 	LLVMValueRef val = NULL;
 	LLVMValueRef lhs_value = lhs.value;
 	LLVMValueRef rhs_value = rhs.value;
@@ -4090,7 +4113,7 @@ void llvm_emit_binary(GenContext *c, BEValue *be_value, Expr *expr, BEValue *lhs
 				val = LLVMBuildFDiv(c->builder, lhs_value, rhs_value, "fdiv");
 				break;
 			}
-			val = type_is_unsigned(lhs_type)
+			val = is_unsigned
 				  ? LLVMBuildUDiv(c->builder, lhs_value, rhs_value, "udiv")
 				  : LLVMBuildSDiv(c->builder, lhs_value, rhs_value, "sdiv");
 			break;
@@ -4101,14 +4124,14 @@ void llvm_emit_binary(GenContext *c, BEValue *be_value, Expr *expr, BEValue *lhs
 				val = LLVMBuildFRem(c->builder, lhs_value, rhs_value, "fmod");
 				break;
 			}
-			val = type_is_unsigned(lhs_type)
+			val = is_unsigned
 				  ? LLVMBuildURem(c->builder, lhs_value, rhs_value, "umod")
 				  : LLVMBuildSRem(c->builder, lhs_value, rhs_value, "smod");
 			break;
 		case BINARYOP_SHR:
 			rhs_value = llvm_zext_trunc(c, rhs_value, LLVMTypeOf(lhs_value));
 			llvm_emit_trap_invalid_shift(c, rhs_value, lhs_type, "Shift amount out of range (was %s).", expr->span);
-			val = type_is_unsigned(lhs_type)
+			val = is_unsigned
 				  ? LLVMBuildLShr(c->builder, lhs_value, rhs_value, "lshr")
 				  : LLVMBuildAShr(c->builder, lhs_value, rhs_value, "ashr");
 			val = LLVMBuildFreeze(c->builder, val, "");
@@ -4584,6 +4607,55 @@ static inline void llvm_emit_const_initializer_list_expr(GenContext *c, BEValue
 	llvm_emit_const_initialize_reference(c, value, expr);
 }
 
+/**
+ * Large $embed data is not copied into the module, instead the assembler
+ * pulls it in straight from the file using .incbin. This only works when
+ * we emit a native object, so it's skipped for ThinLTO bitcode and wasm.
+ */
+static LLVMValueRef llvm_emit_embed_incbin(GenContext *c, const char *data, ArraySize len)
+{
+	if (len < EMBED_INCBIN_MIN_SIZE || thin_lto()) return NULL;
+	const char *section;
+	switch (compiler.platform.object_format)
+	{
+		case OBJ_FORMAT_ELF:
+			section = ".section .rodata";
+			break;
+		case OBJ_FORMAT_MACHO:
+			section = ".section __TEXT,__const";
+			break;
+		case OBJ_FORMAT_COFF:
+			section = ".section .rdata,\"dr\"";
+			break;
+		default:
+			return NULL;
+	}
+	FOREACH(EmbedFile, embed, compiler.context.embeds)
+	{
+		if (embed.data != data || embed.len != len) continue;
+		// The content hash is part of the name, so changed data also changes the module.
+		scratch_buffer_clear();
+		scratch_buffer_printf("\01c3.embed.%016llx", (unsigned long long)embed.hash);
+		const char *name = scratch_buffer_copy();
+		LLVMValueRef global = LLVMGetNamedGlobal(c->module, name);
+		if (global) return global;
+		global = LLVMAddGlobal(c->module, LLVMArrayType(c->byte_type, len + 1), name);
+		LLVMSetGlobalConstant(global, true);
+		LLVMSetDSOLocal(global, true);
+		scratch_buffer_clear();
+		scratch_buffer_printf("%s\n.p2align 4\n%s:\n.incbin \"", section, name + 1);
+		for (const char *p = embed.path; *p; p++)
+		{
+			if (*p == '"' || *p == '\\') scratch_buffer_append_char('\\');
+			scratch_buffer_append_char(*p);
+		}
+		scratch_buffer_printf("\", 0, %llu\n.byte 0\n.text\n", (unsigned long long)len);
+		LLVMAppendModuleInlineAsm(c->module, scratch_buffer.str, scratch_buffer.len);
+		return global;
+	}
+	return NULL;
+}
+
 static void llvm_emit_const_expr(GenContext *c, BEValue *be_value, Expr *expr)
 {
 	Type *type = type_lowering(expr->type)->canonical;
@@ -4708,24 +4780,25 @@ static void llvm_emit_const_expr(GenContext *c, BEValue *be_value, Expr *expr)
 				llvm_value_set(be_value, llvm_get_struct_named(c->chars_type, data, 2), expr->type);
 				return;
 			}
-			ArraySize size = expr->const_expr.bytes.len;
-			size++;
-			if (is_array && type->array.len > size) size = type->array.len;
-			LLVMValueRef global_name = llvm_add_global_raw(c, is_bytes ? ".bytes" : ".str", LLVMArrayType(llvm_get_type(c, type_char), size), 1);
-			llvm_set_private_declaration(global_name);
-			LLVMSetGlobalConstant(global_name, 1);
-			LLVMValueRef data = llvm_get_zstring(c, expr->const_expr.bytes.ptr, expr->const_expr.bytes.len);
-			LLVMValueRef trailing_zeros = NULL;
-			if (size > len + 1)
-			{
-				trailing_zeros = llvm_get_zero_raw(LLVMArrayType(c->byte_type, size - len - 1));
-			}
-			if (trailing_zeros)
+			LLVMValueRef global_name = is_bytes && !is_array ? llvm_emit_embed_incbin(c, expr->const_expr.bytes.ptr, len) : NULL;
+			if (!global_name)
 			{
-				LLVMValueRef values[2] = { data, trailing_zeros };
-				data = llvm_get_packed_struct(c, values, 2);
+				ArraySize size = expr->const_expr.bytes.len;
+				size++;
+				if (is_array && type->array.len > size) size = type->array.len;
+				LLVMValueRef data = llvm_get_zstring(c, expr->const_expr.bytes.ptr, expr->const_expr.bytes.len);
+				LLVMValueRef trailing_zeros = NULL;
+				if (size > len + 1)
+				{
+					trailing_zeros = llvm_get_zero_raw(LLVMArrayType(c->byte_type, size - len - 1));
+				}
+				if (trailing_zeros)
+				{
+					LLVMValueRef values[2] = { data, trailing_zeros };
+					data = llvm_get_packed_struct(c, values, 2);
+				}
+				global_name = llvm_add_private_constant(c, &c->const_pool, is_bytes ? ".bytes" : ".str", data, 1);
 			}
-			LLVMSetInitializer(global_name, data);
 			if (is_array)
 			{
 				llvm_value_set_address(be_value, global_name, type, 1);
@@ -5393,15 +5466,26 @@ void llvm_emit_raw_call(GenContext *c, BEValue *result_value, FunctionPrototype
 	//      In this case be_value already holds the result
 }
 
-static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id_ptr, LLVMValueRef selector)
+/**
+ * Every call site keeps the dtable entry it last found in a global cache, so while
+ * a site sees the same type, finding the method is a compare and a load. The cache
+ * is a single pointer, which keeps it consistent between threads without locks.
+ * It starts out pointing to an empty entry, whose type never matches.
+ */
+static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id, LLVMValueRef selector)
 {
 	LLVMTypeRef type = c->dyn_find_function_type;
 	LLVMValueRef func = c->dyn_find_function;
 	if (!c->dyn_find_function)
 	{
+		c->dyn_missing_entry = llvm_add_global_raw(c, ".dyn_missing", c->dtable_type, 0);
+		LLVMSetInitializer(c->dyn_missing_entry, LLVMConstNull(c->dtable_type));
+		LLVMSetGlobalConstant(c->dyn_missing_entry, true);
+		llvm_set_weak(c, c->dyn_missing_entry);
+
 		LLVMTypeRef types[2] = { c->ptr_type, c->ptr_type };
 		type = c->dyn_find_function_type = LLVMFunctionType(c->ptr_type, types, 2, false);
-		func = c->dyn_find_function = LLVMAddFunction(c->module, ".dyn_search", c->dyn_find_function_type);
+		func = c->dyn_find_function = LLVMAddFunction(c->module, ".dyn_lookup", c->dyn_find_function_type);
 
 		LLVMSetUnnamedAddress(func, LLVMGlobalUnnamedAddr);
 		LLVMSetLinkage(func, LLVMWeakAnyLinkage);
@@ -5432,10 +5516,10 @@ static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id
 		// if (cmp) goto missing_function else compare
 		LLVMBuildCondBr(builder, cmp, missing_function, compare);
 
-		// missing_function: return null
+		// missing_function: return the empty entry
 		LLVMAppendExistingBasicBlock(func, missing_function);
 		LLVMPositionBuilderAtEnd(builder, missing_function);
-		LLVMBuildRet(builder, LLVMConstNull(c->ptr_type));
+		LLVMBuildRet(builder, c->dyn_missing_entry);
 
 		// function_type = dtable_ptr.function_type
 		LLVMAppendExistingBasicBlock(func, compare);
@@ -5451,14 +5535,10 @@ static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id
 		// if (cmp) goto match else no_match
 		LLVMBuildCondBr(builder, cmp, match, no_match);
 
-		// match: function_ptr = dtable_ptr.function_ptr
+		// match: return dtable_ptr
 		LLVMAppendExistingBasicBlock(func, match);
 		LLVMPositionBuilderAtEnd(builder, match);
-
-		// Offset = 0
-		LLVMValueRef function_ptr = LLVMBuildLoad2(builder, c->ptr_type, dtable_ptr, "");
-		LLVMSetAlignment(function_ptr, llvm_abi_alignment(c, c->ptr_type));
-		LLVMBuildRet(builder, function_ptr);
+		LLVMBuildRet(builder, dtable_ptr);
 
 		// no match: next = dtable_ptr.next
 		LLVMAppendExistingBasicBlock(func, no_match);
@@ -5473,28 +5553,26 @@ static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id
 		llvm_set_phi(dtable_ptr, dtable_ptr_in, entry, next, no_match);
 		LLVMDisposeBuilder(builder);
 	}
-	// Insert cache.
-	LLVMValueRef cache_fn_ptr = llvm_emit_alloca_aligned(c, type_voidptr, ".inlinecache");
-	LLVMValueRef cache_type_id_ptr = llvm_emit_alloca_aligned(c, type_voidptr, ".cachedtype");
-	LLVMBasicBlockRef current_block = LLVMGetInsertBlock(c->builder);
-	LLVMValueRef next_after_alloca = LLVMGetNextInstruction(c->alloca_point);
-	if (next_after_alloca)
-	{
-		LLVMPositionBuilderBefore(c->builder, next_after_alloca);
-	}
-	else
-	{
-		LLVMPositionBuilderAtEnd(c->builder, LLVMGetInstructionParent(c->alloca_point));
-	}
-	llvm_store_to_ptr_zero(c, cache_type_id_ptr, type_voidptr);
-	LLVMPositionBuilderAtEnd(c->builder, current_block);
+	AlignSize alignment = type_abi_alignment(type_voidptr);
+	LLVMValueRef cache = llvm_add_global_raw(c, ".dyn_cache", c->ptr_type, 0);
+	llvm_set_internal_linkage(cache);
+	LLVMSetInitializer(cache, c->dyn_missing_entry);
+
+	// Compare the type of the cached entry.
+	LLVMValueRef cached = LLVMBuildLoad2(c->builder, c->ptr_type, cache, "");
+	LLVMSetOrdering(cached, LLVMAtomicOrderingMonotonic);
+	llvm_set_alignment(cached, alignment);
+	LLVMValueRef cached_type = LLVMBuildStructGEP2(c->builder, c->dtable_type, cached, 3, "");
+	cached_type = llvm_load(c, c->typeid_type, cached_type, alignment, "");
+	LLVMValueRef compare = LLVMBuildICmp(c->builder, LLVMIntEQ, type_id, cached_type, "");
+	LLVMBasicBlockRef cache_hit = c->current_block;
 	LLVMBasicBlockRef cache_miss = llvm_basic_block_new(c, "cache_miss");
-	LLVMBasicBlockRef cache_hit = llvm_basic_block_new(c, "cache_hit");
 	LLVMBasicBlockRef exit = llvm_basic_block_new(c, "");
-	LLVMValueRef cached_type_id = llvm_load_abi_alignment(c, type_voidptr, cache_type_id_ptr, "type");
-	LLVMValueRef compare = LLVMBuildICmp(c->builder, LLVMIntEQ, type_id_ptr, cached_type_id, "");
-	llvm_emit_cond_br_raw(c, compare, cache_hit, cache_miss);
+	llvm_emit_cond_br_raw(c, compare, exit, cache_miss);
+
+	// On a miss, search the dtable of the type and update the cache.
 	llvm_emit_block(c, cache_miss);
+	LLVMValueRef type_id_ptr = LLVMBuildIntToPtr(c->builder, type_id, c->ptr_type, "");
 	AlignSize align;
 	LLVMValueRef dtable_ref = llvm_emit_struct_gep_raw(c,
 													   type_id_ptr,
@@ -5504,18 +5582,17 @@ static LLVMValueRef llvm_emit_dynamic_search(GenContext *c, LLVMValueRef type_id
 													   &align);
 	LLVMValueRef dtable_ptr = llvm_load(c, c->ptr_type, dtable_ref, align, "");
 	LLVMValueRef params[2] = { dtable_ptr, selector };
-	LLVMValueRef call = LLVMBuildCall2(c->builder, type, func, params, 2, "");
-	// Store in cache.
-	llvm_store_to_ptr_raw(c, cache_fn_ptr, call, type_voidptr);
-	llvm_store_to_ptr_raw(c, cache_type_id_ptr, type_id_ptr, type_voidptr);
-	llvm_emit_br(c, exit);
-	llvm_emit_block(c, cache_hit);
-	LLVMValueRef cached_val = llvm_load_abi_alignment(c, type_voidptr, cache_fn_ptr, "cache_hit_fn");
+	LLVMValueRef found = LLVMBuildCall2(c->builder, type, func, params, 2, "");
+	LLVMValueRef store = LLVMBuildStore(c->builder, found, cache);
+	LLVMSetOrdering(store, LLVMAtomicOrderingMonotonic);
+	llvm_set_alignment(store, alignment);
 	llvm_emit_br(c, exit);
+
 	llvm_emit_block(c, exit);
-	LLVMValueRef phi = LLVMBuildPhi(c->builder, c->ptr_type, "fn_phi");
-	llvm_set_phi(phi, cached_val, cache_hit, call, cache_miss);
-	return phi;
+	LLVMValueRef phi = LLVMBuildPhi(c->builder, c->ptr_type, "dyn_entry");
+	llvm_set_phi(phi, cached, cache_hit, found, cache_miss);
+	// The function is the first field, it is null for the empty entry.
+	return llvm_load(c, c->ptr_type, phi, alignment, "dyn_fn");
 }
 
 /**
@@ -5763,7 +5840,7 @@ static void llvm_emit_call_expr(GenContext *c, BEValue *result_value, Expr *expr
 		// 1d. Load it as a value
 		func = llvm_load_value_store(c, &func_value);
 
-		if (safe_mode_enabled())
+		if (c->cur_func.safe_mode)
 		{
 			LLVMValueRef check = LLVMBuildICmp(c->builder, LLVMIntEQ, func, LLVMConstNull(c->ptr_type), "checknull");
 			scratch_buffer_clear();
@@ -5845,7 +5922,7 @@ static void llvm_emit_call_expr(GenContext *c, BEValue *result_value, Expr *expr
 		}
 	}
 
-	if (safe_mode_enabled())
+	if (c->cur_func.safe_mode)
 	{
 		llvm_emit_statement_chain(c, expr->call_expr.function_contracts);
 	}
@@ -5854,12 +5931,23 @@ static void llvm_emit_call_expr(GenContext *c, BEValue *result_value, Expr *expr
 	if (expr->call_expr.is_dynamic_dispatch)
 	{
 		ASSERT(arg_count);
+		// If the type behind the interface is known, call the method directly.
+		Decl *interface_fn = declptr(expr->call_expr.func_ref);
+		Decl *target_method = expr_find_dynamic_target(args[0], interface_fn, c->cur_func.decl);
+		if (target_method)
+		{
+			// Pass the arguments as for the interface method, with self as a plain pointer.
+			llvm_emit_any_pointer(c, &values[0], &values[0]);
+			prototype = type_get_resolved_prototype(interface_fn->type);
+			func_type = llvm_get_type(c, interface_fn->type);
+			func = llvm_get_ref(c, target_method);
+			goto CALL;
+		}
 		BEValue result = values[0];
 		BEValue typeid = result;
 		llvm_emit_type_from_any(c, &typeid);
 		llvm_value_rvalue(c, &typeid);
 		llvm_emit_any_pointer(c, &result, &result);
-		LLVMValueRef introspect = LLVMBuildIntToPtr(c->builder, typeid.value, c->ptr_type, "");
 
 		LLVMBasicBlockRef missing_function = llvm_basic_block_new(c, "missing_function");
 		LLVMBasicBlockRef match = llvm_basic_block_new(c, "match");
@@ -5867,7 +5955,7 @@ static void llvm_emit_call_expr(GenContext *c, BEValue *result_value, Expr *expr
 		Decl *dyn_fn = declptr(expr->call_expr.func_ref);
 		prototype = type_get_resolved_prototype(dyn_fn->type);
 		func_type = llvm_get_type(c, dyn_fn->type);
-		func = llvm_emit_dynamic_search(c, introspect, llvm_get_ref(c, dyn_fn));
+		func = llvm_emit_dynamic_search(c, typeid.value, llvm_get_ref(c, dyn_fn));
 		LLVMValueRef cmp = LLVMBuildICmp(c->builder, LLVMIntEQ, func, LLVMConstNull(c->ptr_type), "");
 		llvm_emit_cond_br_raw(c, cmp, missing_function, match);
 		llvm_emit_block(c, missing_function);
@@ -5913,7 +6001,7 @@ static void llvm_emit_call_expr(GenContext *c, BEValue *result_value, Expr *expr
 		values[0] = result;
 
 	}
-
+CALL:
 	llvm_emit_call_invocation(c, result_value, target, expr->span, prototype, args, values, inline_flag, no_return, func, func_type,
 							  varargs);
 }
@@ -6376,7 +6464,7 @@ static inline void llvm_emit_typeid_info(GenContext *c, BEValue *value, Expr *ex
 		llvm_value_set(value, parent_value, expr->type);
 		return;
 	}
-	bool safe_mode = safe_mode_enabled();
+	bool safe_mode = c->cur_func.safe_mode;
 	if (safe_mode || info_kind == TYPEID_INFO_KIND)
 	{
 		kind = llvm_emit_struct_gep_raw(c, ref, c->introspect_type, INTROSPECT_INDEX_KIND, align, &alignment);
@@ -6726,8 +6814,9 @@ static void llvm_emit_default_arg(GenContext *c, BEValue *value, Expr *expr)
 		const char *name = "[DEFAULT INIT]";
 		size_t namelen = strlen(name);
 		LLVMMetadataRef file = llvm_get_debug_file(c, location.file_id);
+		uint32_t row = span_row(location);
 		LLVMMetadataRef init_def = LLVMDIBuilderCreateFunction(c->debug.builder, file, name, namelen, name, namelen,
-																 file, location.row, NULL, true, true, location.row, LLVMDIFlagZero, false);
+																 file, row, NULL, true, true, row, LLVMDIFlagZero, false);
 		llvm_emit_debug_location(c, expr->default_arg_expr.loc);
 		DebugScope scope = { .lexical_block = init_def, .inline_loc = c->last_loc };
 		DebugScope *old = c->debug.block_stack;
@@ -6858,7 +6947,7 @@ void llvm_emit_enum_from_ord(GenContext *c, BEValue *value, Expr *expr)
 {
 	llvm_emit_expr(c, value, expr->inner_expr);
 
-	if (safe_mode_enabled() && c->builder != c->global_builder)
+	if (c->cur_func.safe_mode && c->builder != c->global_builder)
 	{
 		llvm_value_rvalue(c, value);
 		BEValue check;
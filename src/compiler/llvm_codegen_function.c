@@ -4,6 +4,7 @@
 
 
 #include "llvm_codegen_internal.h"
+#include <llvm-c/Comdat.h>
 
 static void llvm_append_xxlizer(GenContext *c, unsigned  priority, bool is_initializer, LLVMValueRef function);
 static inline void llvm_emit_return_value(GenContext *context, LLVMValueRef value);
@@ -171,7 +172,7 @@ static inline void llvm_process_parameter_value(GenContext *c, Decl *decl, ABIAr
 	DIRECT_FROM_COERCE:
 		{
 			LLVMValueRef param_value = llvm_get_next_param(c, index);
-			if (decl->var.not_null && safe_mode_enabled())
+			if (decl->var.not_null && c->cur_func.safe_mode)
 			{
 				LLVMValueRef is_null = LLVMBuildIsNull(c->builder, param_value, "");
 				scratch_buffer_clear();
@@ -403,6 +404,148 @@ void llvm_emit_return_implicit(GenContext *c)
 	llvm_emit_return_abi(c, NULL, &value);
 }
 
+static LLVMValueRef llvm_emit_target_clone(GenContext *c, LLVMValueRef function, const char *name, const char *features)
+{
+	scratch_buffer_clear();
+	scratch_buffer_printf("%s.", name);
+	if (!features)
+	{
+		scratch_buffer_append("default");
+		return LLVMCloneFunctionInternal(function, scratch_buffer_to_string());
+	}
+	for (const char *ch = features; *ch; ch++) scratch_buffer_append_char(*ch == ',' ? '_' : *ch);
+	LLVMValueRef clone = LLVMCloneFunctionInternal(function, scratch_buffer_to_string());
+	scratch_buffer_clear();
+	const char *base_features = compiler.platform.features;
+	if (base_features && base_features[0])
+	{
+		scratch_buffer_append(base_features);
+		scratch_buffer_append_char(',');
+	}
+	scratch_buffer_append_char('+');
+	for (const char *ch = features; *ch; ch++)
+	{
+		scratch_buffer_append_char(*ch);
+		if (*ch == ',') scratch_buffer_append_char('+');
+	}
+	llvm_attribute_add_string(c, clone, "target-features", scratch_buffer_to_string(), -1);
+	return clone;
+}
+
+/**
+ * Split a @target_clones function into one internal clone per feature list plus ".default",
+ * and turn the original into a dispatcher. The first call asks the stdlib which is the
+ * first feature list the CPU supports, the choice is cached and the rest tail call it.
+ */
+static void llvm_emit_target_clones(GenContext *c, Decl *decl)
+{
+	LLVMValueRef function = decl->backend_ref;
+	size_t name_len;
+	const char *name = LLVMGetValueName2(function, &name_len);
+	name = str_copy(name, name_len);
+	const char **clone_features = decl_attrs_resolved(decl)->target_clones;
+	unsigned count = vec_size(clone_features);
+	LLVMValueRef *clones = MALLOC(sizeof(LLVMValueRef) * count);
+	for (unsigned i = 0; i < count; i++) clones[i] = llvm_emit_target_clone(c, function, name, clone_features[i]);
+	LLVMValueRef default_clone = llvm_emit_target_clone(c, function, name, NULL);
+
+	// Keep the symbol as it was, only the body is replaced.
+	LLVMLinkage linkage = LLVMGetLinkage(function);
+	LLVMComdatRef comdat = LLVMGetComdat(function);
+	LLVMDeleteFunctionBody(function);
+	LLVMSetLinkage(function, linkage);
+	if (comdat) LLVMSetComdat(function, comdat);
+
+	scratch_buffer_clear();
+	scratch_buffer_printf("%s.resolved", name);
+	LLVMValueRef cache = llvm_add_global_raw(c, scratch_buffer_to_string(), c->ptr_type, 0);
+	llvm_set_internal_linkage(cache);
+	LLVMSetInitializer(cache, LLVMConstNull(c->ptr_type));
+	AlignSize alignment = type_abi_alignment(type_voidptr);
+
+	LLVMBasicBlockRef entry;
+	LLVMBuilderRef builder = llvm_create_function_entry(c, function, &entry);
+	LLVMBasicBlockRef resolve_block = llvm_append_basic_block(c, function, "resolve");
+	LLVMBasicBlockRef call_block = llvm_append_basic_block(c, function, "call");
+	LLVMValueRef cached = LLVMBuildLoad2(builder, c->ptr_type, cache, "");
+	LLVMSetOrdering(cached, LLVMAtomicOrderingMonotonic);
+	llvm_set_alignment(cached, alignment);
+	LLVMBuildCondBr(builder, LLVMBuildIsNull(builder, cached, ""), resolve_block, call_block);
+
+	// Check the lists last to first, so that the first supported one wins.
+	LLVMPositionBuilderAtEnd(builder, resolve_block);
+	Decl *resolver = compiler.context.target_clones_resolver;
+	LLVMValueRef resolver_ref = llvm_get_ref(c, resolver);
+	LLVMTypeRef resolver_type = llvm_func_type(c, type_get_resolved_prototype(resolver->type));
+	LLVMValueRef selected = default_clone;
+	for (unsigned i = count; i > 0; i--)
+	{
+		LLVMValueRef arg = llvm_emit_zstring_named(c, clone_features[i - 1], ".target_clones");
+		LLVMValueRef supported = LLVMBuildCall2(builder, resolver_type, resolver_ref, &arg, 1, "");
+		supported = LLVMBuildICmp(builder, LLVMIntNE, supported, LLVMConstNull(LLVMTypeOf(supported)), "");
+		selected = LLVMBuildSelect(builder, supported, clones[i - 1], selected, "");
+	}
+	LLVMValueRef store = LLVMBuildStore(builder, selected, cache);
+	LLVMSetOrdering(store, LLVMAtomicOrderingMonotonic);
+	llvm_set_alignment(store, alignment);
+	LLVMBuildBr(builder, call_block);
+
+	LLVMPositionBuilderAtEnd(builder, call_block);
+	LLVMValueRef target = LLVMBuildPhi(builder, c->ptr_type, "");
+	LLVMValueRef incoming[2] = { cached, selected };
+	LLVMBasicBlockRef incoming_blocks[2] = { entry, resolve_block };
+	LLVMAddIncoming(target, incoming, incoming_blocks, 2);
+	unsigned param_count = LLVMCountParams(function);
+	LLVMValueRef *args = MALLOC(sizeof(LLVMValueRef) * (param_count + 1));
+	for (unsigned i = 0; i < param_count; i++) args[i] = LLVMGetParam(function, i);
+	LLVMTypeRef function_type = LLVMGlobalGetValueType(function);
+	LLVMValueRef call = LLVMBuildCall2(builder, function_type, target, args, param_count, "");
+	LLVMSetInstructionCallConv(call, LLVMGetFunctionCallConv(function));
+	LLVMSetTailCall(call, true);
+	// The call must pass the arguments the same way, so copy sret, byval etc.
+	for (unsigned index = LLVMAttributeReturnIndex; index <= param_count; index++)
+	{
+		unsigned attr_count = LLVMGetAttributeCountAtIndex(function, index);
+		if (!attr_count) continue;
+		LLVMAttributeRef *attrs = MALLOC(sizeof(LLVMAttributeRef) * attr_count);
+		LLVMGetAttributesAtIndex(function, index, attrs);
+		for (unsigned i = 0; i < attr_count; i++) LLVMAddCallSiteAttribute(call, index, attrs[i]);
+	}
+	if (LLVMGetTypeKind(LLVMGetReturnType(function_type)) == LLVMVoidTypeKind)
+	{
+		LLVMBuildRetVoid(builder);
+	}
+	else
+	{
+		LLVMBuildRet(builder, call);
+	}
+	LLVMDisposeBuilder(builder);
+}
+
+/**
+ * With --audit-init the constructor list holds a wrapper instead, which lets the stdlib
+ * time the @init function.
+ */
+static LLVMValueRef llvm_emit_init_audit(GenContext *c, Decl *decl)
+{
+	scratch_buffer_clear();
+	scratch_buffer_append(".__c3_init_audit_");
+	scratch_buffer_set_extern_decl_name(decl, false);
+	LLVMValueRef func = LLVMAddFunction(c->module, scratch_buffer_to_string(), c->xtor_func_type);
+	llvm_set_internal_linkage(func);
+	scratch_buffer_clear();
+	scratch_buffer_printf("%s::%s", decl->unit->module->name->module, decl->name);
+	Decl *audit = compiler.context.init_audit;
+	LLVMBuilderRef builder = llvm_create_function_entry(c, func, NULL);
+	LLVMValueRef args[3] = { decl->backend_ref,
+	                         llvm_emit_zstring_named(c, scratch_buffer_to_string(), ".init_name"),
+	                         llvm_const_int(c, type_uint, decl->func_decl.priority) };
+	LLVMBuildCall2(builder, llvm_func_type(c, type_get_resolved_prototype(audit->type)), llvm_get_ref(c, audit), args, 3, "");
+	LLVMBuildRetVoid(builder);
+	LLVMDisposeBuilder(builder);
+	return func;
+}
+
 void llvm_emit_function_body(GenContext *c, Decl *decl)
 {
 	DEBUG_LOG("Generating function %s.", decl->name);
@@ -410,7 +553,9 @@ void llvm_emit_function_body(GenContext *c, Decl *decl)
 	ASSERT(decl->backend_ref);
 	if (decl->func_decl.attr_init || (decl->func_decl.attr_finalizer && compiler.platform.object_format == OBJ_FORMAT_MACHO))
 	{
-		llvm_append_xxlizer(c, decl->func_decl.priority, decl->func_decl.attr_init, decl->backend_ref);
+		LLVMValueRef xxlizer = decl->backend_ref;
+		if (decl->func_decl.attr_init && compiler.context.init_audit) xxlizer = llvm_emit_init_audit(c, decl);
+		llvm_append_xxlizer(c, decl->func_decl.priority, decl->func_decl.attr_init, xxlizer);
 	}
 	if (decl->func_decl.attr_finalizer && compiler.platform.object_format != OBJ_FORMAT_MACHO)
 	{
@@ -433,6 +578,11 @@ void llvm_emit_function_body(GenContext *c, Decl *decl)
 	               type_get_resolved_prototype(decl->type),
 	               decl->func_decl.attr_naked ? NULL : &decl->func_decl.signature,
 	               astptr(decl->func_decl.body), decl);
+	if (decl_attrs_resolved(decl) && decl_attrs_resolved(decl)->target_clones && compiler.context.target_clones_resolver
+		&& !decl->func_decl.attr_naked)
+	{
+		llvm_emit_target_clones(c, decl);
+	}
 }
 
 
@@ -444,6 +594,8 @@ void llvm_emit_body(GenContext *c, LLVMValueRef function, FunctionPrototype *pro
 
 	bool emit_debug = llvm_use_debug(c);
 	LLVMValueRef prev_function = c->cur_func.ref;
+	Decl *prev_decl = c->cur_func.decl;
+	bool prev_safe_mode = c->cur_func.safe_mode;
 	LLVMBuilderRef prev_builder = c->builder;
 
 	c->catch = NO_CATCH;
@@ -454,9 +606,12 @@ void llvm_emit_body(GenContext *c, LLVMValueRef function, FunctionPrototype *pro
 	}
 
 	c->panic_blocks = NULL;
+	c->panic_thunks = NULL;
 	c->cur_func.ref = function;
+	c->cur_func.decl = decl;
 	c->cur_func.name = decl->name;
 	c->cur_func.prototype = prototype;
+	c->cur_func.safe_mode = safe_mode_enabled_in(decl);
 	c->builder = llvm_create_function_entry(c, function, &c->current_block);
 	c->first_block = c->current_block;
 
@@ -548,6 +703,8 @@ void llvm_emit_body(GenContext *c, LLVMValueRef function, FunctionPrototype *pro
 
 	c->builder = prev_builder;
 	c->cur_func.ref = prev_function;
+	c->cur_func.decl = prev_decl;
+	c->cur_func.safe_mode = prev_safe_mode;
 }
 
 static void llvm_append_xxlizer(GenContext *c, unsigned  priority, bool is_initializer, LLVMValueRef function)
@@ -564,16 +721,15 @@ void llvm_emit_dynamic_functions(GenContext *c, Decl **funcs)
 	if (!len) return;
 	if (compiler.platform.object_format == OBJ_FORMAT_MACHO)
 	{
-		LLVMTypeRef types[3] = { c->ptr_type, c->ptr_type, c->typeid_type };
-		LLVMTypeRef entry_type = LLVMStructType(types, 3, false);
+		LLVMTypeRef entry_type = c->dtable_type;
 		LLVMValueRef *entries = VECNEW(LLVMValueRef, len);
 		FOREACH(Decl *, func, funcs)
 		{
 			Type *type = typeget(func->func_decl.type_parent);
 			Decl *proto = declptrzero(func->func_decl.interface_method);
 			LLVMValueRef proto_ref = proto ? llvm_get_ref(c, proto) : llvm_get_selector(c, func->name);
-			LLVMValueRef vals[3] = {llvm_get_ref(c, func), proto_ref, llvm_get_typeid(c, type)};
-			LLVMValueRef entry = LLVMConstNamedStruct(entry_type, vals, 3);
+			LLVMValueRef vals[4] = {llvm_get_ref(c, func), proto_ref, LLVMConstNull(c->ptr_type), llvm_get_typeid(c, type)};
+			LLVMValueRef entry = LLVMConstNamedStruct(entry_type, vals, 4);
 			vec_add(entries, entry);
 		}
 		LLVMValueRef array = LLVMConstArray(entry_type, entries, len);
@@ -607,8 +763,8 @@ void llvm_emit_dynamic_functions(GenContext *c, Decl **funcs)
 
 		LLVMValueRef all_one_ptr = LLVMConstAllOnes(llvm_get_type(c, type_uptr));
 		all_one_ptr = LLVMBuildIntToPtr(builder, all_one_ptr, c->ptr_type, "");
-		LLVMValueRef vals[3] = {llvm_get_ref(c, decl), proto_ref, all_one_ptr};
-		LLVMSetInitializer(global, LLVMConstNamedStruct(c->dtable_type, vals, 3));
+		LLVMValueRef vals[4] = {llvm_get_ref(c, decl), proto_ref, all_one_ptr, llvm_get_typeid(c, type)};
+		LLVMSetInitializer(global, LLVMConstNamedStruct(c->dtable_type, vals, 4));
 
 		LLVMBasicBlockRef check = llvm_basic_block_new(c, "dtable_check");
 		LLVMBasicBlockRef skip = llvm_basic_block_new(c, "dtable_skip");
@@ -668,9 +824,9 @@ void llvm_emit_function_decl(GenContext *c, Decl *decl)
 	decl_append_links_to_global(decl);
 	LLVMValueRef function = llvm_get_ref(c, decl);
 	decl->backend_ref = function;
-	if (decl->attrs_resolved && decl->attrs_resolved->section)
+	if (decl_attrs_resolved(decl) && decl_attrs_resolved(decl)->section)
 	{
-		LLVMSetSection(function, decl->attrs_resolved->section);
+		LLVMSetSection(function, decl_attrs_resolved(decl)->section);
 	}
 	if (llvm_use_debug(c))
 	{
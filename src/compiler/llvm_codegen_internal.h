@@ -60,16 +60,21 @@ typedef struct
 	LLVMMetadataRef compile_unit;
 	LLVMMetadataRef function;
 	DebugScope *block_stack;
+	// Types fully described by this module when deduplicating debug types.
+	Decl **owned_types;
 } DebugContext;
 
+typedef struct
+{
+	const char *message;
+	const char *fmt;
+	FileId file_id;
+	uint32_t row;
+	Type *types[2];
+	LLVMValueRef function;
+} PanicThunk;
 
 
-typedef struct ReusableConstant_
-{
-	const char *string;
-	const char *name;
-	LLVMValueRef value;
-} ReusableConstant;
 
 typedef struct OptionalCatch_
 {
@@ -92,9 +97,12 @@ typedef struct GenContext_
 	LLVMContextRef context;
 	LLVMValueRef *constructors;
 	LLVMValueRef *destructors;
-	ReusableConstant *reusable_constants;
+	// Private constants keyed by their initializer, for deduplication.
+	HTable const_pool;
+	HTable zstring_pool;
 	const char *ir_filename;
 	const char *object_filename;
+	const char *dwo_filename;
 	const char *asm_filename;
 	LLVMTypeRef bool_type;
 	LLVMTypeRef byte_type;
@@ -113,9 +121,11 @@ typedef struct GenContext_
 	struct
 	{
 		LLVMValueRef ref;
+		Decl *decl;
 		const char *name;
 		FunctionPrototype *prototype;
 		Type *rtype;
+		bool safe_mode;
 	} cur_func;
 	struct {
 		LLVMBuilderRef builder;
@@ -141,16 +151,23 @@ typedef struct GenContext_
 		LLVMBasicBlockRef current_block;
 		// The panic blocks to emit at the end.
 		LLVMBasicBlockRef *panic_blocks;
+		// The outlined panics of the function, shared by checks on the same line.
+		PanicThunk *panic_thunks;
 		// Debug data
 		DebugContext debug;
 	};
 	int ast_alloca_addr_space;
 	Module *code_module;
+	// Set when the module is split over several contexts, one per codegen unit.
+	bool split_module;
+	unsigned codegen_unit;
 	Decl **dynamic_functions;
 	// The dynamic find function, if one has been emitted yet.
 	LLVMValueRef dyn_find_function;
 	// The type of the find function.
 	LLVMTypeRef dyn_find_function_type;
+	// The empty dtable entry that dynamic call caches start out with.
+	LLVMValueRef dyn_missing_entry;
 	LLVMValueRef memcmp_function;
 	LLVMTypeRef memcmp_function_type;
 } GenContext;
@@ -269,6 +286,7 @@ typedef struct
 	unsigned alwaysinline;    // Force inlining
 	unsigned arcp;            // allow reciprocal
 	unsigned byval;           // ByVal (param)
+	unsigned cold;            // Rarely called
 	unsigned contract;        // allow fused multiply-and-add
 	unsigned elementtype;     // elementtype (type)
 	unsigned fast;            // fast fp
@@ -323,6 +341,7 @@ static inline LLVMValueRef decl_optional_ref(Decl *decl)
 
 INLINE bool llvm_is_global_eval(GenContext *c);
 INLINE bool llvm_is_local_eval(GenContext *c);
+INLINE bool llvm_decl_in_codegen_unit(GenContext *c, Decl *decl);
 
 
 // -- BE value --
@@ -383,6 +402,7 @@ void llvm_set_global_tls(Decl *decl);
 INLINE LLVMValueRef llvm_add_global_raw(GenContext *c, const char *name, LLVMTypeRef type, AlignSize alignment);
 INLINE LLVMValueRef llvm_add_global(GenContext *c, const char *name, Type *type, AlignSize alignment);
 void llvm_add_global_decl(GenContext *c, Decl *decl);
+LLVMValueRef llvm_add_private_constant(GenContext *c, HTable *pool, const char *name, LLVMValueRef init, AlignSize alignment);
 void llvm_emit_global_variable_init(GenContext *c, Decl *decl);
 
 // -- Alloca --
@@ -439,6 +459,7 @@ bool llvm_emit_check_block_branch(GenContext *c);
 // -- Comparisons ---
 void llvm_emit_lhs_is_subtype(GenContext *c, BEValue *result, BEValue *lhs, BEValue *rhs);
 void llvm_emit_comp(GenContext *c, BEValue *result, BEValue *lhs, BEValue *rhs, BinaryOp binary_op);
+void llvm_emit_memcmp(GenContext *c, BEValue *be_value, LLVMValueRef ptr, LLVMValueRef other_ptr, LLVMValueRef size);
 void llvm_emit_int_comp(GenContext *c, BEValue *result, BEValue *lhs, BEValue *rhs, BinaryOp binary_op);
 void llvm_emit_int_comp_zero(GenContext *c, BEValue *result, BEValue *lhs, BinaryOp binary_op);
 void llvm_emit_int_comp_raw(GenContext *c, BEValue *result, Type *lhs_type, Type *rhs_type, LLVMValueRef lhs_value, LLVMValueRef rhs_value, BinaryOp binary_op);
@@ -586,7 +607,6 @@ void llvm_emit_debug_local_var(GenContext *c, Decl *var);
 
 LLVMAtomicOrdering llvm_atomic_ordering(Atomicity atomicity);
 
-bool module_should_weaken(Module *module);
 
 // Implementations
 
@@ -219,6 +219,11 @@ INLINE bool llvm_is_global_eval(GenContext *c)
 	return c->builder == c->global_builder;
 }
 
+INLINE bool llvm_decl_in_codegen_unit(GenContext *c, Decl *decl)
+{
+	return decl->unit->module == c->code_module && decl->unit->codegen_unit == c->codegen_unit;
+}
+
 INLINE bool llvm_is_local_eval(GenContext *c)
 {
 	return c->builder != c->global_builder;
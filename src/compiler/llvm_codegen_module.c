@@ -55,11 +55,47 @@ static void llvm_set_module_flag(GenContext *c, LLVMModuleFlagBehavior flag_beha
 	LLVMAddModuleFlag(c->module, flag_behavior, flag, strlen(flag), val);
 }
 
+/**
+ * Turn "foo.o" into "foo.cgu2.o" for the later codegen units of a split module.
+ */
+static const char *codegen_unit_filename(const char *filename, unsigned codegen_unit)
+{
+	if (!filename) return NULL;
+	const char *ext = strrchr(filename, '.');
+	const char *sep = strrchr(filename, '/');
+	const char *win_sep = strrchr(filename, '\\');
+	if (win_sep > sep) sep = win_sep;
+	if (!ext || (sep && sep > ext)) return str_printf("%s.cgu%u", filename, codegen_unit);
+	return str_printf("%.*s.cgu%u%s", (int)(ext - filename), filename, codegen_unit, ext);
+}
+
 void gencontext_begin_module(GenContext *c)
 {
 	ASSERT(!c->module && "Expected no module");
 
 	codegen_setup_object_names(c->code_module, &c->ir_filename, &c->asm_filename, &c->object_filename);
+	if (c->codegen_unit)
+	{
+		c->ir_filename = codegen_unit_filename(c->ir_filename, c->codegen_unit);
+		c->asm_filename = codegen_unit_filename(c->asm_filename, c->codegen_unit);
+		c->object_filename = codegen_unit_filename(c->object_filename, c->codegen_unit);
+	}
+	if (split_dwarf() && c->object_filename)
+	{
+		// The linked binary refers to the .dwo by this path, so make it absolute.
+		const char *name = c->object_filename;
+		const char *ext = strrchr(name, '.');
+		const char *sep = strrchr(name, '/');
+		int base_len = ext && (!sep || ext > sep) ? (int)(ext - name) : (int)strlen(name);
+		c->dwo_filename = str_printf("%.*s.dwo", base_len, name);
+		char cwd[PATH_MAX];
+		if (name[0] != '/' && getcwd(cwd, PATH_MAX)) c->dwo_filename = file_append_path(cwd, c->dwo_filename);
+	}
+	if (compiler.build.objects_in_memory && c->object_filename)
+	{
+		const char *in_memory = file_create_in_memory(c->object_filename);
+		if (in_memory) c->object_filename = in_memory;
+	}
 	DEBUG_LOG("Emit module %s.", c->code_module->name->module);
 	c->panic_var = compiler.context.panic_var;
 	c->panicf = compiler.context.panicf;
@@ -111,8 +147,9 @@ void gencontext_begin_module(GenContext *c)
 	c->size_type = llvm_get_type(c, type_usz);
 	c->typeid_type = llvm_get_type(c, type_typeid);
 	LLVMTypeRef void_type = LLVMVoidTypeInContext(c->context);
-	LLVMTypeRef dtable_type[3] = { c->ptr_type, c->ptr_type, c->ptr_type };
-	c->dtable_type = LLVMStructTypeInContext(c->context, dtable_type, 3, false);
+	// { void* function, void* selector, dtable* next, typeid type }
+	LLVMTypeRef dtable_type[4] = { c->ptr_type, c->ptr_type, c->ptr_type, c->typeid_type };
+	c->dtable_type = LLVMStructTypeInContext(c->context, dtable_type, 4, false);
 	c->chars_type = llvm_get_type(c, type_chars);
 	LLVMTypeRef ctor_type[3] = { LLVMInt32TypeInContext(c->context), c->ptr_type, c->ptr_type };
 	c->xtor_entry_type = LLVMStructTypeInContext(c->context, ctor_type, 3, false);
@@ -193,7 +230,7 @@ void gencontext_init_file_emit(GenContext *c, CompilationUnit *unit)
 		unsigned runtime_version = 0;
 		LLVMDWARFEmissionKind emission_kind =
 				compiler.build.debug_info == DEBUG_INFO_FULL ? LLVMDWARFEmissionFull : LLVMDWARFEmissionLineTablesOnly;
-		const char *debug_output_file = "";
+		const char *debug_output_file = c->dwo_filename ? c->dwo_filename : "";
 		bool emit_debug_info_for_profiling = false;
 		bool split_debug_inlining = false;
 		const char *sysroot = "";
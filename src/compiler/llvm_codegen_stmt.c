@@ -496,6 +496,41 @@ static inline LoopType loop_type_for_cond(Expr *cond, bool do_while)
 	return LOOP_NORMAL;
 }
 
+static LLVMMetadataRef llvm_loop_hint(GenContext *c, const char *name, LLVMValueRef value)
+{
+	LLVMMetadataRef hint[2] = {
+			LLVMMDStringInContext2(c->context, name, strlen(name)),
+			LLVMValueAsMetadata(value)
+	};
+	return LLVMMDNodeInContext2(c->context, hint, 2);
+}
+
+/**
+ * Branch back to the start of the loop, attaching the '@vectorize' and '@unroll(n)'
+ * hints as 'llvm.loop' metadata on the backedge.
+ */
+static void llvm_emit_loop_backedge(GenContext *c, FlowCommon *flow, LLVMBasicBlockRef loop_start_block)
+{
+	if (!flow->vectorize && !flow->unroll)
+	{
+		llvm_emit_br(c, loop_start_block);
+		return;
+	}
+	if (!llvm_emit_check_block_branch(c)) return;
+	c->current_block = NULL;
+	LLVMValueRef branch = LLVMBuildBr(c->builder, loop_start_block);
+	LLVMMetadataRef ops[3];
+	unsigned count = 1;
+	if (flow->vectorize) ops[count++] = llvm_loop_hint(c, "llvm.loop.vectorize.enable", LLVMConstInt(c->bool_type, 1, false));
+	if (flow->unroll) ops[count++] = llvm_loop_hint(c, "llvm.loop.unroll.count", llvm_const_int(c, type_uint, flow->unroll));
+	// The loop id refers to itself; replacing the temporary node also frees it.
+	LLVMMetadataRef self = LLVMTemporaryMDNode(c->context, NULL, 0);
+	ops[0] = self;
+	LLVMMetadataRef loop_id = LLVMMDNodeInContext2(c->context, ops, count);
+	LLVMMetadataReplaceAllUsesWith(self, loop_id);
+	LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(c->context, "llvm.loop", 9), LLVMMetadataAsValue(c->context, loop_id));
+}
+
 void llvm_emit_for_stmt(GenContext *c, Ast *ast)
 {
 	DEBUG_PUSH_LEXICAL_SCOPE(c, ast->span);
@@ -505,6 +540,7 @@ void llvm_emit_for_stmt(GenContext *c, Ast *ast)
 		llvm_emit_ignored_expr(c, exprptr(ast->for_stmt.init));
 	}
 	ExprId incr = ast->for_stmt.incr;
+	FlowCommon flow = ast->for_stmt.flow;
 
 	LLVMBasicBlockRef inc_block = incr ? llvm_basic_block_new(c, "loop.inc") : NULL;
 	Ast *body = astptr(ast->for_stmt.body);
@@ -661,7 +697,7 @@ void llvm_emit_for_stmt(GenContext *c, Ast *ast)
 	// Loop back.
 	if (loop != LOOP_NONE)
 	{
-		llvm_emit_br(c, loop_start_block);
+		llvm_emit_loop_backedge(c, &flow, loop_start_block);
 	}
 	else
 	{
@@ -864,11 +900,11 @@ static void llvm_emit_switch_jump_table(GenContext *c,
 			max = to_value;
 		}
 	}
-	switch_ast->switch_stmt.codegen.jump.default_index = default_index;
-	switch_ast->switch_stmt.codegen.jump.min_index = min_index;
+	switch_ast->switch_stmt.codegen->jump.default_index = default_index;
+	switch_ast->switch_stmt.codegen->jump.min_index = min_index;
 	max = int_sub(max, min);
 	ASSERT(max.i.low <= 0xFFFF);
-	uint64_t count = switch_ast->switch_stmt.codegen.jump.count = max.i.low + 1;
+	uint64_t count = switch_ast->switch_stmt.codegen->jump.count = max.i.low + 1;
 	ASSERT(!max.i.high && "Should never exceed 64 bytes");
 
 	Type *goto_array_type = type_get_array(type_voidptr, count);
@@ -876,7 +912,7 @@ static void llvm_emit_switch_jump_table(GenContext *c,
 	AlignSize alignment = type_alloca_alignment(switch_value->type);
 
 	LLVMValueRef jmptable = llvm_add_global_raw(c, "jumptable", llvm_array_type, alignment);
-	switch_ast->switch_stmt.codegen.jump.jmptable = jmptable;
+	switch_ast->switch_stmt.codegen->jump.jmptable = jmptable;
 
 	llvm_set_private_declaration(jmptable);
 	LLVMSetGlobalConstant(jmptable, 1);
@@ -932,6 +968,288 @@ static void llvm_emit_switch_jump_table(GenContext *c,
 	llvm_emit_block(c, exit_block);
 }
 
+static void llvm_add_switch_cases(GenContext *c, LLVMValueRef switch_stmt, Ast *case_stmt)
+{
+	LLVMBasicBlockRef block = case_stmt->case_stmt.backend_block;
+	BEValue be_value;
+	Expr *from = exprptr(case_stmt->case_stmt.expr);
+	ASSERT(expr_is_const(from));
+	llvm_emit_expr(c, &be_value, from);
+	llvm_value_rvalue(c, &be_value);
+	LLVMValueRef case_value = be_value.value;
+	LLVMAddCase(switch_stmt, case_value, block);
+	Expr *to_expr = exprptrzero(case_stmt->case_stmt.to_expr);
+	if (!to_expr) return;
+	BEValue to_value;
+	llvm_emit_expr(c, &to_value, to_expr);
+	llvm_value_rvalue(c, &to_value);
+	LLVMValueRef to = to_value.value;
+	ASSERT(LLVMIsAConstant(to));
+	LLVMValueRef one = llvm_const_int(c, to_value.type, 1);
+	while (LLVMConstIntGetZExtValue(LLVMBuildICmp(c->builder, LLVMIntEQ, to, case_value, "")) != 1)
+	{
+		case_value = LLVMBuildAdd(c->builder, case_value, one, "");
+		LLVMAddCase(switch_stmt, case_value, block);
+	}
+}
+
+static void llvm_emit_switch_case_bodies(GenContext *c, Ast **cases, LLVMBasicBlockRef exit_block)
+{
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		// Skip fallthroughs.
+		if (!case_stmt->case_stmt.body) continue;
+
+		llvm_emit_block(c, case_stmt->case_stmt.backend_block);
+
+		llvm_emit_stmt(c, case_stmt->case_stmt.body);
+		llvm_emit_br(c, exit_block);
+	}
+	llvm_emit_block(c, exit_block);
+}
+
+typedef struct
+{
+	Int low;
+	Int high;
+	// Either a single range too large to expand, or a run of cases placed in one LLVM switch.
+	Ast **cases;
+	bool is_range;
+} SwitchCluster;
+
+static int switch_cluster_compare(const void *a, const void *b)
+{
+	const SwitchCluster *left = a;
+	const SwitchCluster *right = b;
+	if (int_comp(left->low, right->low, BINARYOP_LT)) return -1;
+	return int_comp(left->low, right->low, BINARYOP_GT) ? 1 : 0;
+}
+
+static LLVMValueRef llvm_switch_cluster_bound(GenContext *c, Int value, Type *type)
+{
+	return LLVMConstIntOfArbitraryPrecision(llvm_get_type(c, type), 2, (uint64_t[2]) { value.i.low, value.i.high });
+}
+
+static void llvm_emit_switch_cluster(GenContext *c, SwitchCluster *cluster, BEValue *switch_value, LLVMBasicBlockRef next_block)
+{
+	if (!cluster->is_range)
+	{
+		LLVMValueRef switch_stmt = LLVMBuildSwitch(c->builder, switch_value->value, next_block, vec_size(cluster->cases));
+		c->current_block = NULL;
+		FOREACH(Ast *, case_stmt, cluster->cases) llvm_add_switch_cases(c, switch_stmt, case_stmt);
+		return;
+	}
+	// low <= x <= high as a single unsigned compare of x - low.
+	Type *type = switch_value->type;
+	LLVMValueRef offset = LLVMBuildSub(c->builder, switch_value->value, llvm_switch_cluster_bound(c, cluster->low, type), "");
+	LLVMValueRef size = llvm_switch_cluster_bound(c, int_sub(cluster->high, cluster->low), type);
+	BEValue in_range;
+	llvm_value_set(&in_range, LLVMBuildICmp(c->builder, LLVMIntULE, offset, size, ""), type_bool);
+	llvm_emit_cond_br(c, &in_range, cluster->cases[0]->case_stmt.backend_block, next_block);
+}
+
+static void llvm_emit_switch_cluster_tree(GenContext *c, SwitchCluster *clusters, unsigned count, BEValue *switch_value,
+                                          LLVMBasicBlockRef default_block)
+{
+	// A few clusters are just tested in order, otherwise split on the middle one.
+	if (count <= 3)
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			LLVMBasicBlockRef next_block = i == count - 1 ? default_block : llvm_basic_block_new(c, "switch.next");
+			llvm_emit_switch_cluster(c, &clusters[i], switch_value, next_block);
+			if (next_block != default_block) llvm_emit_block(c, next_block);
+		}
+		return;
+	}
+	unsigned mid = count / 2;
+	LLVMBasicBlockRef lower_block = llvm_basic_block_new(c, "switch.lower");
+	LLVMBasicBlockRef upper_block = llvm_basic_block_new(c, "switch.upper");
+	LLVMValueRef pivot = llvm_switch_cluster_bound(c, clusters[mid].low, switch_value->type);
+	BEValue is_lower;
+	LLVMIntPredicate predicate = type_is_signed(type_lowering(switch_value->type)) ? LLVMIntSLT : LLVMIntULT;
+	llvm_value_set(&is_lower, LLVMBuildICmp(c->builder, predicate, switch_value->value, pivot, ""), type_bool);
+	llvm_emit_cond_br(c, &is_lower, lower_block, upper_block);
+	llvm_emit_block(c, lower_block);
+	llvm_emit_switch_cluster_tree(c, clusters, mid, switch_value, default_block);
+	llvm_emit_block(c, upper_block);
+	llvm_emit_switch_cluster_tree(c, clusters + mid, count - mid, switch_value, default_block);
+}
+
+/**
+ * A switch over constants where some range is too large to expand into
+ * individual cases. The ranges are tested with a single compare each, while
+ * runs of the remaining cases go into an LLVM switch, which LLVM turns into jump
+ * tables or comparisons depending on how dense they are. The clusters are then
+ * searched with a balanced tree of comparisons.
+ */
+static void llvm_emit_switch_clustered(GenContext *c, Ast **cases, Ast *default_case, BEValue *switch_value,
+                                       LLVMBasicBlockRef exit_block)
+{
+	unsigned case_count = vec_size(cases);
+	SwitchCluster *ranges = MALLOC(sizeof(SwitchCluster) * case_count);
+	unsigned range_count = 0;
+	Int max_size = { .i.low = compiler.build.switchrange_max_size, .type = TYPE_U64 };
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		if (case_stmt == default_case) continue;
+		SwitchCluster *range = &ranges[range_count++];
+		*range = (SwitchCluster) { .cases = NULL };
+		llvm_set_jump_table_values(case_stmt->case_stmt.expr, case_stmt->case_stmt.to_expr, &range->low, &range->high);
+		Int size = int_sub(range->high, range->low);
+		size.type = TYPE_U64;
+		range->is_range = size.i.high || int_comp(size, max_size, BINARYOP_GT);
+		vec_add(range->cases, case_stmt);
+	}
+	qsort(ranges, range_count, sizeof(SwitchCluster), switch_cluster_compare);
+
+	// Merge the neighbouring small cases.
+	SwitchCluster *clusters = MALLOC(sizeof(SwitchCluster) * range_count);
+	unsigned cluster_count = 0;
+	for (unsigned i = 0; i < range_count; i++)
+	{
+		SwitchCluster *range = &ranges[i];
+		if (!range->is_range && cluster_count && !clusters[cluster_count - 1].is_range)
+		{
+			SwitchCluster *last = &clusters[cluster_count - 1];
+			last->high = range->high;
+			vec_add(last->cases, range->cases[0]);
+			continue;
+		}
+		clusters[cluster_count++] = *range;
+	}
+	LLVMBasicBlockRef default_block = default_case ? default_case->case_stmt.backend_block : exit_block;
+	llvm_emit_switch_cluster_tree(c, clusters, cluster_count, switch_value, default_block);
+	llvm_emit_switch_case_bodies(c, cases, exit_block);
+}
+
+typedef struct
+{
+	const char *str;
+	ArraySize len;
+	Ast *case_stmt;
+} StringCase;
+
+static int string_case_compare(const void *a, const void *b)
+{
+	const StringCase *left = a;
+	const StringCase *right = b;
+	if (left->len != right->len) return left->len < right->len ? -1 : 1;
+	return memcmp(left->str, right->str, left->len);
+}
+
+/**
+ * Dispatch strings of the same length. The byte that has the most distinct values
+ * among them is switched on, and this repeats until each string is alone, where
+ * a memcmp confirms the match.
+ */
+static void llvm_emit_switch_string_group(GenContext *c, StringCase *strings, unsigned count, LLVMValueRef ptr,
+                                          LLVMBasicBlockRef default_block)
+{
+	ArraySize len = strings[0].len;
+	if (count == 1)
+	{
+		Ast *case_stmt = strings[0].case_stmt;
+		if (!len)
+		{
+			llvm_emit_br(c, case_stmt->case_stmt.backend_block);
+			return;
+		}
+		BEValue case_value;
+		llvm_emit_expr(c, &case_value, exprptr(case_stmt->case_stmt.expr));
+		llvm_value_rvalue(c, &case_value);
+		BEValue cmp;
+		llvm_emit_memcmp(c, &cmp, ptr, llvm_emit_extract_value(c, case_value.value, 0), llvm_const_int(c, type_usz, len));
+		BEValue match;
+		llvm_value_set(&match, LLVMBuildICmp(c->builder, LLVMIntEQ, cmp.value, llvm_get_zero(c, cmp.type), ""), type_bool);
+		llvm_emit_cond_br(c, &match, case_stmt->case_stmt.backend_block, default_block);
+		return;
+	}
+	ArraySize best_index = 0;
+	unsigned best_distinct = 0;
+	for (ArraySize i = 0; i < len; i++)
+	{
+		bool seen[256] = { false };
+		unsigned distinct = 0;
+		for (unsigned j = 0; j < count; j++)
+		{
+			unsigned char ch = (unsigned char)strings[j].str[i];
+			if (seen[ch]) continue;
+			seen[ch] = true;
+			distinct++;
+		}
+		if (distinct <= best_distinct) continue;
+		best_distinct = distinct;
+		best_index = i;
+		if (distinct == count) break;
+	}
+	// Sema rejects duplicate cases, so the strings always differ somewhere.
+	ASSERT(best_distinct > 1);
+	LLVMValueRef byte_ptr = llvm_emit_pointer_inbounds_gep_raw(c, c->byte_type, ptr, llvm_const_int(c, type_usz, best_index));
+	LLVMValueRef byte = llvm_load(c, c->byte_type, byte_ptr, 1, "");
+	LLVMValueRef switch_stmt = LLVMBuildSwitch(c->builder, byte, default_block, best_distinct);
+	c->current_block = NULL;
+	StringCase *sorted = MALLOC(sizeof(StringCase) * count);
+	LLVMBasicBlockRef *blocks = MALLOC(sizeof(LLVMBasicBlockRef) * best_distinct);
+	unsigned *starts = MALLOC(sizeof(unsigned) * (best_distinct + 1));
+	unsigned group_count = 0;
+	unsigned used = 0;
+	for (unsigned ch = 0; ch < 256; ch++)
+	{
+		unsigned start = used;
+		for (unsigned j = 0; j < count; j++)
+		{
+			if ((unsigned char)strings[j].str[best_index] == ch) sorted[used++] = strings[j];
+		}
+		if (used == start) continue;
+		blocks[group_count] = llvm_basic_block_new(c, "switch.string");
+		LLVMAddCase(switch_stmt, LLVMConstInt(c->byte_type, ch, false), blocks[group_count]);
+		starts[group_count++] = start;
+	}
+	starts[group_count] = used;
+	for (unsigned i = 0; i < group_count; i++)
+	{
+		llvm_emit_block(c, blocks[i]);
+		llvm_emit_switch_string_group(c, sorted + starts[i], starts[i + 1] - starts[i], ptr, default_block);
+	}
+}
+
+/**
+ * Switch over constant strings: an LLVM switch over the length picks the strings
+ * of that length, which are then told apart by their bytes.
+ */
+static void llvm_emit_switch_string_dispatch(GenContext *c, Ast **cases, Ast *default_case, BEValue *switch_value,
+                                             LLVMBasicBlockRef exit_block)
+{
+	unsigned case_count = vec_size(cases);
+	StringCase *strings = MALLOC(sizeof(StringCase) * case_count);
+	unsigned count = 0;
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		if (case_stmt == default_case) continue;
+		Expr *expr = exprptr(case_stmt->case_stmt.expr);
+		strings[count++] = (StringCase) { expr->const_expr.bytes.ptr, expr->const_expr.bytes.len, case_stmt };
+	}
+	qsort(strings, count, sizeof(StringCase), string_case_compare);
+
+	LLVMBasicBlockRef default_block = default_case ? default_case->case_stmt.backend_block : exit_block;
+	LLVMValueRef ptr = llvm_emit_extract_value(c, switch_value->value, 0);
+	LLVMValueRef len = llvm_emit_extract_value(c, switch_value->value, 1);
+	LLVMValueRef switch_stmt = LLVMBuildSwitch(c->builder, len, default_block, count);
+	c->current_block = NULL;
+	for (unsigned i = 0; i < count;)
+	{
+		unsigned end = i + 1;
+		while (end < count && strings[end].len == strings[i].len) end++;
+		LLVMBasicBlockRef block = llvm_basic_block_new(c, "switch.len");
+		LLVMAddCase(switch_stmt, llvm_const_int(c, type_usz, strings[i].len), block);
+		llvm_emit_block(c, block);
+		llvm_emit_switch_string_group(c, strings + i, end - i, ptr, default_block);
+		i = end;
+	}
+	llvm_emit_switch_case_bodies(c, cases, exit_block);
+}
+
 static void llvm_emit_switch_body(GenContext *c, BEValue *switch_value, Ast *switch_ast, bool is_typeid)
 {
 	bool is_if_chain = switch_ast->switch_stmt.flow.if_chain;
@@ -964,8 +1282,8 @@ static void llvm_emit_switch_body(GenContext *c, BEValue *switch_value, Ast *swi
 
 	LLVMBasicBlockRef exit_block = llvm_basic_block_new(c, "switch.exit");
 	LLVMBasicBlockRef switch_block = llvm_basic_block_new(c, "switch.entry");
-	switch_ast->switch_stmt.codegen.retry.block = switch_block;
-	switch_ast->switch_stmt.codegen.exit_block = exit_block;
+	SwitchCodegen codegen = { .exit_block = exit_block, .retry.block = switch_block };
+	switch_ast->switch_stmt.codegen = &codegen;
 
 	// We will now treat the fallthrough cases:
 	// switch (i)
@@ -989,7 +1307,7 @@ static void llvm_emit_switch_body(GenContext *c, BEValue *switch_value, Ast *swi
 
 	BEValue switch_var;
 	llvm_value_set_address_abi_aligned(&switch_var, llvm_emit_alloca_aligned(c, switch_type, "switch"), switch_type);
-	switch_ast->switch_stmt.codegen.retry.var = &switch_var;
+	codegen.retry.var = &switch_var;
 	llvm_store(c, &switch_var, switch_value);
 
 	llvm_emit_br(c, switch_block);
@@ -998,6 +1316,12 @@ static void llvm_emit_switch_body(GenContext *c, BEValue *switch_value, Ast *swi
 	BEValue switch_current_val = switch_var;
 	llvm_value_rvalue(c, &switch_current_val);
 
+	if (switch_ast->switch_stmt.flow.string_dispatch)
+	{
+		llvm_emit_switch_string_dispatch(c, cases, default_case, &switch_current_val, exit_block);
+		return;
+	}
+
 	if (is_if_chain)
 	{
 		llvm_emit_switch_body_if_chain(c, cases, default_case, &switch_current_val, exit_block, is_typeid);
@@ -1011,48 +1335,20 @@ static void llvm_emit_switch_body(GenContext *c, BEValue *switch_value, Ast *swi
 	}
 	ASSERT(!is_typeid);
 
+	if (switch_ast->switch_stmt.flow.clustered)
+	{
+		llvm_emit_switch_clustered(c, cases, default_case, &switch_current_val, exit_block);
+		return;
+	}
+
 	LLVMValueRef switch_stmt = LLVMBuildSwitch(c->builder, switch_current_val.value, default_case ? default_case->case_stmt.backend_block : exit_block, case_count);
 	c->current_block = NULL;
 	for (unsigned i = 0; i < case_count; i++)
 	{
 		Ast *case_stmt = cases[i];
-		LLVMBasicBlockRef block = case_stmt->case_stmt.backend_block;
-		if (case_stmt != default_case)
-		{
-			LLVMValueRef case_value;
-			BEValue be_value;
-			Expr *from = exprptr(case_stmt->case_stmt.expr);
-			ASSERT(expr_is_const(from));
-			llvm_emit_expr(c, &be_value, from);
-			llvm_value_rvalue(c, &be_value);
-			case_value = be_value.value;
-			LLVMAddCase(switch_stmt, case_value, block);
-			Expr *to_expr = exprptrzero(case_stmt->case_stmt.to_expr);
-			if (to_expr)
-			{
-				BEValue to_value;
-				llvm_emit_expr(c, &to_value, to_expr);
-				llvm_value_rvalue(c, &to_value);
-				LLVMValueRef to = to_value.value;
-				ASSERT(LLVMIsAConstant(to));
-				LLVMValueRef one = llvm_const_int(c, to_value.type, 1);
-				while (LLVMConstIntGetZExtValue(LLVMBuildICmp(c->builder, LLVMIntEQ, to, case_value, "")) != 1)
-				{
-					case_value = LLVMBuildAdd(c->builder, case_value, one, "");
-					LLVMAddCase(switch_stmt, case_value, block);
-				}
-			}
-		}
-
-		// Skip fallthroughs.
-		if (!case_stmt->case_stmt.body) continue;
-
-		llvm_emit_block(c, block);
-
-		llvm_emit_stmt(c, case_stmt->case_stmt.body);
-		llvm_emit_br(c, exit_block);
+		if (case_stmt != default_case) llvm_add_switch_cases(c, switch_stmt, case_stmt);
 	}
-	llvm_emit_block(c, exit_block);
+	llvm_emit_switch_case_bodies(c, cases, exit_block);
 }
 
 void llvm_emit_switch(GenContext *c, Ast *ast)
@@ -1090,7 +1386,7 @@ void llvm_emit_break(GenContext *c, Ast *ast)
 			jump = jump_target->for_stmt.codegen.exit_block;
 			break;
 		case AST_SWITCH_STMT:
-			jump = jump_target->switch_stmt.codegen.exit_block;
+			jump = jump_target->switch_stmt.codegen->exit_block;
 			break;
 		case AST_FOREACH_STMT:
 		default:
@@ -1136,12 +1432,12 @@ void gencontext_emit_next_stmt(GenContext *context, Ast *ast)
 	{
 		llvm_emit_statement_chain(context, ast->nextcase_stmt.defer_id);
 		Ast **cases = jump_target->switch_stmt.cases;
-		int default_index = jump_target->switch_stmt.codegen.jump.default_index;
-		LLVMBasicBlockRef exit_block = jump_target->switch_stmt.codegen.exit_block;
+		int default_index = jump_target->switch_stmt.codegen->jump.default_index;
+		LLVMBasicBlockRef exit_block = jump_target->switch_stmt.codegen->exit_block;
 		LLVMValueRef instr = llvm_emit_switch_jump_stmt(context, jump_target, cases,
-		                                                jump_target->switch_stmt.codegen.jump.count,
-		                                                jump_target->switch_stmt.codegen.jump.min_index,
-		                                                jump_target->switch_stmt.codegen.jump.jmptable,
+		                                                jump_target->switch_stmt.codegen->jump.count,
+		                                                jump_target->switch_stmt.codegen->jump.min_index,
+		                                                jump_target->switch_stmt.codegen->jump.jmptable,
 		                                                default_index < 0
 														? exit_block
 		                                                : cases[default_index]->case_stmt.backend_block,
@@ -1155,9 +1451,9 @@ void gencontext_emit_next_stmt(GenContext *context, Ast *ast)
 
 		return;
 	}
-	llvm_store(context, jump_target->switch_stmt.codegen.retry.var, &be_value);
+	llvm_store(context, jump_target->switch_stmt.codegen->retry.var, &be_value);
 	llvm_emit_statement_chain(context, ast->nextcase_stmt.defer_id);
-	llvm_emit_jmp(context, jump_target->switch_stmt.codegen.retry.block);
+	llvm_emit_jmp(context, jump_target->switch_stmt.codegen->retry.block);
 }
 
 
@@ -1480,25 +1776,11 @@ LLVMValueRef llvm_emit_empty_string_const(GenContext *c)
 
 LLVMValueRef llvm_emit_zstring_named(GenContext *c, const char *str, const char *extname)
 {
-	FOREACH(ReusableConstant, constant, c->reusable_constants)
-	{
-		if (str_eq(str, constant.string) && str_eq(extname, constant.name))
-		{
-			return constant.value;
-		}
-	}
-
 	unsigned len = (unsigned)strlen(str);
-	LLVMTypeRef char_array_type = LLVMArrayType(c->byte_type, len + 1);
-	LLVMValueRef global_string = llvm_add_global_raw(c, extname, char_array_type, 0);
-	llvm_set_internal_linkage(global_string);
-	LLVMSetGlobalConstant(global_string, 1);
-	LLVMSetInitializer(global_string, llvm_get_zstring(c, str, len));
+	LLVMValueRef init = llvm_get_zstring(c, str, len);
+	LLVMValueRef global_string = llvm_add_private_constant(c, &c->zstring_pool, extname, init, 1);
 	AlignSize alignment;
-	LLVMValueRef string = llvm_emit_array_gep_raw(c, global_string, char_array_type, 0, 1, &alignment);
-	ReusableConstant reuse = { .string = str_copy(str, len), .name = str_copy(extname, strlen(extname)), .value = string };
-	vec_add(c->reusable_constants, reuse);
-	return string;
+	return llvm_emit_array_gep_raw(c, global_string, LLVMTypeOf(init), 0, 1, &alignment);
 }
 
 void llvm_emit_unreachable(GenContext *c)
@@ -1514,7 +1796,7 @@ void llvm_emit_panic(GenContext *c, const char *message, SourceSpan loc, const c
 	Decl *panic_var = c->panic_var;
 	if (no_panic() || !panic_var )
 	{
-		if (safe_mode_enabled())
+		if (c->cur_func.safe_mode)
 		{
 			llvm_emit_call_intrinsic(c, intrinsic_id.trap, NULL, 0, NULL, 0);
 		}
@@ -1530,7 +1812,7 @@ void llvm_emit_panic(GenContext *c, const char *message, SourceSpan loc, const c
 			llvm_emit_string_const(c, panicf ? fmt : message, ".panic_msg"),
 			llvm_emit_string_const(c, file->name, ".file"),
 			llvm_emit_string_const(c, c->cur_func.name, ".func"),
-			llvm_const_int(c, type_uint, loc.row)
+			llvm_const_int(c, type_uint, span_row(loc))
 	};
 	FunctionPrototype *prototype = panicf
 			? type_get_resolved_prototype(panicf->type)
@@ -1591,21 +1873,9 @@ void llvm_emit_panic(GenContext *c, const char *message, SourceSpan loc, const c
 	llvm_emit_unreachable(c);
 }
 
-void llvm_emit_panic_if_true(GenContext *c, BEValue *value, const char *panic_name, SourceSpan loc, const char *fmt, BEValue *value_1,
-							 BEValue *value_2)
+static void llvm_emit_panic_inline(GenContext *c, const char *panic_name, SourceSpan loc, const char *fmt,
+                                   BEValue *value_1, BEValue *value_2)
 {
-	if (LLVMIsAConstantInt(value->value))
-	{
-		ASSERT(!LLVMConstIntGetZExtValue(value->value) && "Unexpected bounds check failed.");
-		return;
-	}
-	LLVMBasicBlockRef panic_block = llvm_basic_block_new(c, "panic");
-	LLVMBasicBlockRef ok_block = llvm_basic_block_new(c, "checkok");
-	value->value = llvm_emit_expect_false(c, value);
-	llvm_emit_cond_br(c, value, panic_block, ok_block);
-
-	llvm_emit_block(c, panic_block);
-	vec_add(c->panic_blocks, panic_block);
 	BEValue *values = NULL;
 	if (value_1)
 	{
@@ -1620,6 +1890,133 @@ void llvm_emit_panic_if_true(GenContext *c, BEValue *value, const char *panic_na
 		}
 	}
 	llvm_emit_panic(c, panic_name, loc, fmt, values);
+}
+
+static LLVMValueRef llvm_emit_panic_thunk(GenContext *c, const char *panic_name, SourceSpan loc, const char *fmt,
+                                          LLVMTypeRef *param_types, Type **types, unsigned count)
+{
+	LLVMTypeRef type = LLVMFunctionType(LLVMVoidTypeInContext(c->context), param_types, count, false);
+	LLVMValueRef thunk = LLVMAddFunction(c->module, ".panic", type);
+	LLVMSetLinkage(thunk, LLVMInternalLinkage);
+	LLVMSetUnnamedAddress(thunk, LLVMGlobalUnnamedAddr);
+	llvm_attribute_add(c, thunk, attribute_id.noinline, -1);
+	llvm_attribute_add(c, thunk, attribute_id.cold, -1);
+	llvm_attribute_add(c, thunk, attribute_id.noreturn, -1);
+	llvm_attribute_add(c, thunk, attribute_id.nounwind, -1);
+	llvm_attribute_add_int(c, thunk, attribute_id.uwtable, UWTABLE, -1);
+	if (c->debug.enable_stacktrace) llvm_attribute_add_string(c, thunk, "frame-pointer", "all", -1);
+	if (thin_lto())
+	{
+		const char *cpu = compiler.platform.cpu;
+		const char *features = compiler.platform.features;
+		if (cpu && cpu[0]) llvm_attribute_add_string(c, thunk, "target-cpu", cpu, -1);
+		if (features && features[0]) llvm_attribute_add_string(c, thunk, "target-features", features, -1);
+	}
+	if (compiler.platform.object_format == OBJ_FORMAT_ELF) LLVMSetSection(thunk, ".text.unlikely");
+
+	// Emit the body with the thunk as the current function. It has no debug info of its own,
+	// the call site carries the location.
+	LLVMBuilderRef prev_builder = c->builder;
+	LLVMBasicBlockRef prev_block = c->current_block;
+	LLVMValueRef prev_function = c->cur_func.ref;
+	LLVMValueRef prev_alloca_point = c->alloca_point;
+	LLVMDIBuilderRef prev_debug_builder = c->debug.builder;
+	c->debug.builder = NULL;
+	c->cur_func.ref = thunk;
+	c->builder = llvm_create_function_entry(c, thunk, &c->current_block);
+	c->alloca_point = LLVMBuildAlloca(c->builder, LLVMInt32TypeInContext(c->context), "alloca_point");
+
+	BEValue *values = NULL;
+	for (unsigned i = 0; i < count; i++)
+	{
+		BEValue value;
+		llvm_value_set(&value, LLVMGetParam(thunk, i), types[i]);
+		llvm_emit_any_from_value(c, &value, types[i]);
+		vec_add(values, value);
+	}
+	llvm_emit_panic(c, panic_name, loc, fmt, values);
+
+	LLVMInstructionEraseFromParent(c->alloca_point);
+	LLVMDisposeBuilder(c->builder);
+	c->debug.builder = prev_debug_builder;
+	c->alloca_point = prev_alloca_point;
+	c->cur_func.ref = prev_function;
+	c->current_block = prev_block;
+	c->builder = prev_builder;
+	return thunk;
+}
+
+/**
+ * Call the panic from an outlined cold thunk, so that the check itself is only a compare and a branch.
+ * Checks with the same message, format and values on the same line share a thunk. Without
+ * optimizations the panic is emitted inline, which keeps the IR simple to follow.
+ */
+static void llvm_emit_panic_outlined(GenContext *c, const char *panic_name, SourceSpan loc, const char *fmt,
+                                     BEValue *value_1, BEValue *value_2)
+{
+	if (no_panic() || !c->panic_var || compiler.build.optlevel == OPTIMIZATION_NONE)
+	{
+		llvm_emit_panic_inline(c, panic_name, loc, fmt, value_1, value_2);
+		return;
+	}
+	if (!fmt || !c->panicf) value_1 = value_2 = NULL;
+	if (!value_1) value_2 = NULL;
+
+	BEValue *values[2] = { value_1, value_2 };
+	LLVMValueRef args[2];
+	LLVMTypeRef param_types[2];
+	Type *types[2] = { NULL, NULL };
+	unsigned count = 0;
+	for (unsigned i = 0; i < 2 && values[i]; i++)
+	{
+		BEValue value = *values[i];
+		types[i] = value.type;
+		llvm_value_rvalue(c, &value);
+		args[i] = value.value;
+		param_types[i] = LLVMTypeOf(value.value);
+		count++;
+	}
+
+	uint32_t row = span_row(loc);
+	LLVMValueRef thunk = NULL;
+	FOREACH(PanicThunk, entry, c->panic_thunks)
+	{
+		if (entry.row != row || entry.file_id != loc.file_id) continue;
+		if (entry.types[0] != types[0] || entry.types[1] != types[1]) continue;
+		if (strcmp(entry.message, panic_name) != 0) continue;
+		if (entry.fmt != fmt && (!entry.fmt || !fmt || strcmp(entry.fmt, fmt) != 0)) continue;
+		thunk = entry.function;
+		break;
+	}
+	if (!thunk)
+	{
+		thunk = llvm_emit_panic_thunk(c, panic_name, loc, fmt, param_types, types, count);
+		PanicThunk entry = { .message = panic_name, .fmt = fmt, .file_id = loc.file_id, .row = row,
+		                     .types = { types[0], types[1] }, .function = thunk };
+		vec_add(c->panic_thunks, entry);
+	}
+
+	if (c->debug.builder) llvm_emit_debug_location(c, loc);
+	LLVMBuildCall2(c->builder, LLVMGlobalGetValueType(thunk), thunk, args, count, "");
+	llvm_emit_unreachable(c);
+}
+
+void llvm_emit_panic_if_true(GenContext *c, BEValue *value, const char *panic_name, SourceSpan loc, const char *fmt, BEValue *value_1,
+							 BEValue *value_2)
+{
+	if (LLVMIsAConstantInt(value->value))
+	{
+		ASSERT(!LLVMConstIntGetZExtValue(value->value) && "Unexpected bounds check failed.");
+		return;
+	}
+	LLVMBasicBlockRef panic_block = llvm_basic_block_new(c, "panic");
+	LLVMBasicBlockRef ok_block = llvm_basic_block_new(c, "checkok");
+	value->value = llvm_emit_expect_false(c, value);
+	llvm_emit_cond_br(c, value, panic_block, ok_block);
+
+	llvm_emit_block(c, panic_block);
+	vec_add(c->panic_blocks, panic_block);
+	llvm_emit_panic_outlined(c, panic_name, loc, fmt, value_1, value_2);
 	llvm_emit_block(c, ok_block);
 	EMIT_SPAN(c, loc);
 }
@@ -71,6 +71,43 @@ const char *module_create_object_file_name(Module *module)
 	return scratch_buffer_to_string();
 }
 
+/**
+ * Find the value of the last '<module>=<value>' entry matching the module,
+ * where 'foo::*' matches foo and its submodules. NULL if none matches.
+ */
+const char *module_setting_lookup(Module *module, const char **entries)
+{
+	const char *value = NULL;
+	const char *name = module->name->module;
+	FOREACH(const char *, entry, entries)
+	{
+		const char *eq = strchr(entry, '=');
+		size_t len = (size_t)(eq - entry);
+		bool match;
+		if (len >= 3 && memcmp(entry + len - 3, "::*", 3) == 0)
+		{
+			size_t prefix = len - 3;
+			match = strncmp(name, entry, prefix) == 0 && (!name[prefix] || (name[prefix] == ':' && name[prefix + 1] == ':'));
+		}
+		else
+		{
+			match = strlen(name) == len && memcmp(name, entry, len) == 0;
+		}
+		if (match) value = eq + 1;
+	}
+	return value;
+}
+
+/**
+ * The safety set for the module with --module-safe, generic instances use the generic module.
+ */
+SafetyLevel module_safe_mode(Module *module)
+{
+	if (module->generic_module) module = module->generic_module;
+	const char *value = module_setting_lookup(module, compiler.build.module_safe);
+	if (!value) return SAFETY_NOT_SET;
+	return str_eq(value, "yes") ? SAFETY_ON : SAFETY_OFF;
+}
 
 Path *path_create_from_string(const char *string, uint32_t len, SourceSpan span)
 {
@@ -78,7 +115,7 @@ Path *path_create_from_string(const char *string, uint32_t len, SourceSpan span)
 	Path *path = CALLOCS(Path);
 	path->span = span;
 	TokenType type = TOKEN_IDENT;
-	path->module = symtab_add(string, len, fnv1a(string, len), &type);
+	path->module = symtab_add(string, len, symtab_hash(string, len), &type);
 	path->len = len;
 	if (type != TOKEN_IDENT)
 	{
@@ -92,6 +92,17 @@ void expr_contract_array(ExprConst *expr_const, ConstKind contract_type)
 			}
 			break;
 		}
+		case CONST_INIT_ARRAY_BYTES:
+			if (type_size(type->array.base) == 1)
+			{
+				memcpy(arr, initializer->init_array_bytes, len);
+				break;
+			}
+			for (ArraySize i = 0; i < len; i++)
+			{
+				arr[i] = (char)int_to_i64(const_init_bytes_int_at(initializer, i));
+			}
+			break;
 	}
 	*expr_const = (ExprConst) { .const_kind = contract_type, .bytes.ptr = arr, .bytes.len = len };
 }
@@ -342,6 +353,19 @@ void const_init_to_scratch_buffer(ConstInitializer *init)
 			scratch_buffer_append(" }");
 			return;
 		}
+		case CONST_INIT_ARRAY_BYTES:
+		{
+			scratch_buffer_append("{ ");
+			Expr element = { .expr_kind = EXPR_CONST };
+			for (ArraySize i = 0; i < init->type->array.len; i++)
+			{
+				if (i != 0) scratch_buffer_append(", ");
+				const_init_bytes_rewrite_expr_at(init, i, &element);
+				expr_const_to_scratch_buffer(&element.const_expr);
+			}
+			scratch_buffer_append(" }");
+			return;
+		}
 		case CONST_INIT_ARRAY_VALUE:
 			scratch_buffer_printf("[%lld] = ", (long long)init->init_array_value.index);
 			const_init_to_scratch_buffer(init->init_array_value.element);
@@ -428,7 +428,7 @@ static Expr *parse_lambda(ParseContext *c, Expr *left)
 	sig->params = decls;
 	sig->rtype = return_type ? type_infoid(return_type) : 0;
 	sig->variadic = variadic;
-	if (!parse_attributes(c, &func->attributes, NULL, NULL, NULL)) return poisoned_expr;
+	if (!parse_decl_attributes(c, func, NULL, NULL, NULL)) return poisoned_expr;
 	RANGE_EXTEND_PREV(func);
 	if (tok_is(c, TOKEN_IMPLIES))
 	{
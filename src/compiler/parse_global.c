@@ -68,7 +68,7 @@ void recover_top_level(ParseContext *c)
 			case TOKEN_STATIC:
 			case TYPELIKE_TOKENS:
 				// Only recover if this is in the first col.
-				if (c->span.col == 1) return;
+				if (span_location(c->span).col == 1) return;
 				advance(c);
 				break;
 			default:
@@ -279,6 +279,17 @@ bool parse_module(ParseContext *c, AstId contracts)
 			case ATTRIBUTE_TEST:
 				c->unit->test_by_default = true;
 				continue;
+			case ATTRIBUTE_SAFE:
+			{
+				Expr *expr = vec_size(attr->exprs) == 1 ? attr->exprs[0] : NULL;
+				if (!expr || expr->expr_kind != EXPR_CONST || expr->const_expr.const_kind != CONST_BOOL)
+				{
+					RETURN_PRINT_ERROR_AT(false, attr, "Expected '@safe(true)' or '@safe(false)'.");
+				}
+				if (c->unit->safe_mode != SAFETY_NOT_SET) RETURN_PRINT_ERROR_AT(false, attr, "'@safe' appeared more than once.");
+				c->unit->safe_mode = expr->const_expr.b ? SAFETY_ON : SAFETY_OFF;
+				continue;
+			}
 			case ATTRIBUTE_EXPORT:
 				if (attr->exprs) RETURN_PRINT_ERROR_AT(false, attr, "Expected no arguments to '@export'");
 				if (c->unit->export_by_default)
@@ -825,7 +836,7 @@ Decl *parse_local_decl_after_type(ParseContext *c, TypeInfo *type)
 	advance(c);
 
 	bool is_cond;
-	if (!parse_attributes(c, &decl->attributes, NULL, NULL, &is_cond)) return poisoned_decl;
+	if (!parse_decl_attributes(c, decl, NULL, NULL, &is_cond)) return poisoned_decl;
 	decl->is_cond = true;
 	if (tok_is(c, TOKEN_EQ))
 	{
@@ -896,7 +907,7 @@ Decl *parse_const_declaration(ParseContext *c, bool is_global, bool is_extern)
 	else
 	{
 		bool is_cond;
-		if (!parse_attributes(c, &decl->attributes, NULL, NULL, &is_cond)) return poisoned_decl;
+		if (!parse_decl_attributes(c, decl, NULL, NULL, &is_cond)) return poisoned_decl;
 		decl->is_cond = is_cond;
 	}
 
@@ -1185,7 +1196,7 @@ static bool parse_attributes_for_global(ParseContext *c, Decl *decl)
 	decl->is_export = c->unit->export_by_default;
 	bool is_builtin = false;
 	bool is_cond;
-	if (!parse_attributes(c, &decl->attributes, &visibility, decl_needs_prefix(decl) ? &is_builtin : NULL, &is_cond)) return false;
+	if (!parse_decl_attributes(c, decl, &visibility, decl_needs_prefix(decl) ? &is_builtin : NULL, &is_cond)) return false;
 	decl->is_cond = is_cond;
 	decl->is_autoimport = is_builtin;
 	decl->visibility = visibility;
@@ -1266,6 +1277,14 @@ bool parse_attributes(ParseContext *c, Attr ***attributes_ref, Visibility *visib
 	return parse_attribute_list(c, attributes_ref, visibility_ref, builtin_ref, cond_ref, false);
 }
 
+bool parse_decl_attributes(ParseContext *c, Decl *decl, Visibility *visibility_ref, bool *builtin_ref, bool *cond_ref)
+{
+	Attr **attributes = decl_attributes(decl);
+	if (!parse_attributes(c, &attributes, visibility_ref, builtin_ref, cond_ref)) return false;
+	decl_set_attributes(decl, attributes);
+	return true;
+}
+
 /**
  * global_declaration ::= TLOCAL? optional_type IDENT (('=' expression)? | (',' IDENT)* opt_attributes) ';'
  *
@@ -1327,7 +1346,7 @@ static inline Decl *parse_global_declaration(ParseContext *c)
 		}
 		if (!parse_decl_initializer(c, decl)) return poisoned_decl;
 	}
-	else if (!decl->attributes)
+	else if (!decl_attributes(decl))
 	{
 		if (tok_is(c, TOKEN_LPAREN) && !threadlocal)
 		{
@@ -1344,14 +1363,14 @@ static inline Decl *parse_global_declaration(ParseContext *c)
 		}
 	}
 	CONSUME_EOS_OR_RET(poisoned_decl);
-	Attr **attributes = decl->attributes;
+	Attr **attributes = decl_attributes(decl);
 	// Copy the attributes to the other variables.
 	if (attributes)
 	{
 		FOREACH(Decl *, d, decls)
 		{
 			if (d == decl) continue;
-			d->attributes = copy_attributes_single(attributes);
+			decl_set_attributes(d, copy_attributes_single(attributes));
 		}
 	}
 	// If we have multiple decls, then we return that as a bundled decl_globals
@@ -1381,7 +1400,7 @@ static inline bool parse_enum_param_decl(ParseContext *c, Decl*** parameters)
 		if (token_is_some_ident(c->tok)) RETURN_PRINT_ERROR_HERE("Expected a name starting with a lower-case letter.");
 		RETURN_PRINT_ERROR_HERE("Expected a member name here.");
 	}
-	if (!parse_attributes(c, &param->attributes, NULL, NULL, NULL)) return false;
+	if (!parse_decl_attributes(c, param, NULL, NULL, NULL)) return false;
 	vec_add(*parameters, param);
 	RANGE_EXTEND_PREV(param);
 	return true;
@@ -1623,7 +1642,7 @@ bool parse_parameters(ParseContext *c, Decl ***params_ref, Variadic *variadic, i
 		Decl *param = decl_new_var(name, span, type, param_kind);
 		param->var.type_info = type ? type_infoid(type) : 0;
 		param->var.self_addr = ref;
-		if (!parse_attributes(c, &param->attributes, NULL, NULL, NULL)) return false;
+		if (!parse_decl_attributes(c, param, NULL, NULL, NULL)) return false;
 		if (!no_name)
 		{
 			if (try_consume(c, TOKEN_EQ))
@@ -1723,7 +1742,7 @@ static bool parse_struct_body(ParseContext *c, Decl *parent)
 			else
 			{
 				bool is_cond;
-				if (!parse_attributes(c, &member->attributes, NULL, NULL, &is_cond)) return false;
+				if (!parse_decl_attributes(c, member, NULL, NULL, &is_cond)) return false;
 				member->is_cond = true;
 				if (!parse_struct_body(c, member)) return decl_poison(parent);
 			}
@@ -1766,7 +1785,7 @@ static bool parse_struct_body(ParseContext *c, Decl *parent)
 			}
 			advance(c);
 			bool is_cond;
-			if (!parse_attributes(c, &member->attributes, NULL, NULL, &is_cond)) return false;
+			if (!parse_decl_attributes(c, member, NULL, NULL, &is_cond)) return false;
 			member->is_cond = true;
 			if (!try_consume(c, TOKEN_COMMA)) break;
 			if (was_inline)
@@ -1783,7 +1802,7 @@ static bool parse_struct_body(ParseContext *c, Decl *parent)
 		if (last_index != first_member_index)
 		{
 			Decl *last_member = members[last_index];
-			Attr **attributes = last_member->attributes;
+			Attr **attributes = decl_attributes(last_member);
 			if (attributes)
 			{
 				// Copy attributes
@@ -1792,8 +1811,8 @@ static bool parse_struct_body(ParseContext *c, Decl *parent)
 				{
 					Decl *member = members[i];
 					if (is_cond) member->is_cond = true;
-					ASSERT(!member->attributes);
-					member->attributes = copy_attributes_single(attributes);
+					ASSERT(!decl_attributes(member));
+					decl_set_attributes(member, copy_attributes_single(attributes));
 				}
 			}
 		}
@@ -1899,7 +1918,7 @@ static inline bool parse_bitstruct_body(ParseContext *c, Decl *decl)
 				is_consecutive = true;
 			}
 			bool is_cond = false;
-			if (!parse_attributes(c, &member_decl->attributes, NULL, NULL, &is_cond)) return false;
+			if (!parse_decl_attributes(c, member_decl, NULL, NULL, &is_cond)) return false;
 			member_decl->is_cond = is_cond;
 			CONSUME_OR_RET(TOKEN_EOS, false);
 			unsigned index = vec_size(decl->strukt.members);
@@ -1920,7 +1939,7 @@ static inline bool parse_bitstruct_body(ParseContext *c, Decl *decl)
 			member_decl->var.end = NULL;
 		}
 		bool is_cond = false;
-		if (!parse_attributes(c, &member_decl->attributes, NULL, NULL, &is_cond)) return false;
+		if (!parse_decl_attributes(c, member_decl, NULL, NULL, &is_cond)) return false;
 		member_decl->is_cond = is_cond;
 		CONSUME_EOS_OR_RET(false);
 		if (is_consecutive)
@@ -2100,7 +2119,7 @@ static inline Decl *parse_alias_type(ParseContext *c)
 		{
 			return poisoned_decl;
 		}
-		if (!parse_attributes(c, &decl_type->attributes, NULL, NULL, NULL)) return poisoned_decl;
+		if (!parse_decl_attributes(c, decl_type, NULL, NULL, NULL)) return poisoned_decl;
 		RANGE_EXTEND_PREV(decl_type);
 		RANGE_EXTEND_PREV(decl);
 		CONSUME_EOS_OR_RET(poisoned_decl);
@@ -34,7 +34,7 @@ static Ast *parse_decl_stmt_after_type(ParseContext *c, TypeInfo *type)
 			break;
 	}
 
-	if (decl->attributes || decl->var.init_expr)
+	if (decl_attributes(decl) || decl->var.init_expr)
 	{
 		if (tok_is(c, TOKEN_COMMA) && peek(c) == TOKEN_IDENT)
 		{
@@ -43,10 +43,10 @@ static Ast *parse_decl_stmt_after_type(ParseContext *c, TypeInfo *type)
 				PRINT_ERROR_AT(decl->var.init_expr, "Multiple variable declarations cannot use initialization.");
 				return poisoned_ast;
 			}
-			if (decl->attributes)
+			if (decl_attributes(decl))
 			{
-				ASSERT(VECLAST(decl->attributes));
-				PRINT_ERROR_AT(VECLAST(decl->attributes), "Multiple variable declarations must have attributes at the end.");
+				ASSERT(VECLAST(decl_attributes(decl)));
+				PRINT_ERROR_AT(VECLAST(decl_attributes(decl)), "Multiple variable declarations must have attributes at the end.");
 				return poisoned_ast;
 			}
 		}
@@ -63,15 +63,15 @@ static Ast *parse_decl_stmt_after_type(ParseContext *c, TypeInfo *type)
 			PRINT_ERROR_AT(decl->var.init_expr, "Multiple variable declarations cannot use initialization.");
 			return poisoned_ast;
 		}
-		if (decl->attributes)
+		if (decl_attributes(decl))
 		{
 			if (tok_is(c, TOKEN_COMMA))
 			{
-				ASSERT(VECLAST(decl->attributes));
-				PRINT_ERROR_AT(VECLAST(decl->attributes), "Multiple variable declarations must have attributes at the end.");
+				ASSERT(VECLAST(decl_attributes(decl)));
+				PRINT_ERROR_AT(VECLAST(decl_attributes(decl)), "Multiple variable declarations must have attributes at the end.");
 				return poisoned_ast;
 			}
-			attributes = decl->attributes;
+			attributes = decl_attributes(decl);
 		}
 		vec_add(decls, decl);
 	}
@@ -80,7 +80,7 @@ static Ast *parse_decl_stmt_after_type(ParseContext *c, TypeInfo *type)
 		FOREACH(Decl *, d, decls)
 		{
 			if (d == decl) continue;
-			d->attributes = copy_attributes_single(attributes);
+			decl_set_attributes(d, copy_attributes_single(attributes));
 		}
 	}
 	ast->decls_stmt = decls;
@@ -515,7 +515,7 @@ static inline Ast *parse_case_stmts(ParseContext *c, TokenType case_type, TokenT
 {
 	if (token_type_ends_case(c->tok, case_type, default_type))
 	{
-		if (c->span.row > row + 1 && (c->tok == TOKEN_CASE || c->tok == TOKEN_DEFAULT))
+		if (span_row(c->span) > row + 1 && (c->tok == TOKEN_CASE || c->tok == TOKEN_DEFAULT))
 		{
 			PRINT_ERROR_LAST("Fallthrough cases with empty rows or comments have unclear meaning, an explicit 'break' or 'nextcase' is needed (or remove the spacing!).");
 			return poisoned_ast;
@@ -572,7 +572,37 @@ static inline Ast* parse_defer_stmt(ParseContext *c)
 }
 
 /**
- * while_stmt ::= WHILE optional_label '(' cond ')' statement
+ * loop_attributes ::= ('@vectorize' | '@unroll' '(' INTEGER ')')*
+ */
+static inline bool parse_loop_attributes(ParseContext *c, FlowCommon *flow)
+{
+	while (tok_is(c, TOKEN_AT_IDENT))
+	{
+		const char *name = symstr(c);
+		if (name == attribute_list[ATTRIBUTE_VECTORIZE])
+		{
+			flow->vectorize = true;
+			advance(c);
+			continue;
+		}
+		// Anything else is the start of the body.
+		if (name != attribute_list[ATTRIBUTE_UNROLL]) return true;
+		advance(c);
+		CONSUME_OR_RET(TOKEN_LPAREN, false);
+		ASSIGN_EXPR_OR_RET(Expr *count, parse_expr(c), false);
+		if (!expr_is_const_int(count) || int_ucomp(count->const_expr.ixx, 0, BINARYOP_EQ)
+			|| int_ucomp(count->const_expr.ixx, UINT8_MAX, BINARYOP_GT))
+		{
+			RETURN_PRINT_ERROR_AT(false, count, "Expected an unroll count between 1 and 255.");
+		}
+		flow->unroll = (uint8_t)int_to_u64(count->const_expr.ixx);
+		CONSUME_OR_RET(TOKEN_RPAREN, false);
+	}
+	return true;
+}
+
+/**
+ * while_stmt ::= WHILE optional_label '(' cond ')' loop_attributes statement
  *
  * Note that during parsing we rewrite this as a for loop.
  */
@@ -585,9 +615,10 @@ static inline Ast* parse_while_stmt(ParseContext *c)
 	CONSUME_OR_RET(TOKEN_LPAREN, poisoned_ast);
 	ASSIGN_EXPRID_OR_RET(while_ast->for_stmt.cond, parse_cond(c), poisoned_ast);
 	CONSUME_OR_RET(TOKEN_RPAREN, poisoned_ast);
-	unsigned row = c->prev_span.row;
+	if (!parse_loop_attributes(c, &while_ast->for_stmt.flow)) return poisoned_ast;
+	unsigned row = span_row(c->prev_span);
 	ASSIGN_AST_OR_RET(Ast *body, parse_stmt(c), poisoned_ast);
-	if (body->ast_kind != AST_COMPOUND_STMT && row != body->span.row)
+	if (body->ast_kind != AST_COMPOUND_STMT && row != span_row(body->span))
 	{
 		PRINT_ERROR_AT(body, "A single statement after 'while' must be placed on the same line, or be enclosed in {}.");
 		return poisoned_ast;
@@ -609,7 +640,7 @@ static inline Ast* parse_if_stmt(ParseContext *c)
 	ASSIGN_DECLID_OR_RET(if_ast->if_stmt.flow.label, parse_optional_label(c, if_ast), poisoned_ast);
 	CONSUME_OR_RET(TOKEN_LPAREN, poisoned_ast);
 	ASSIGN_EXPRID_OR_RET(if_ast->if_stmt.cond, parse_cond(c), poisoned_ast);
-	unsigned row = c->span.row;
+	unsigned row = span_row(c->span);
 	if (!tok_is(c, TOKEN_RPAREN))
 	{
 		switch (c->tok)
@@ -624,7 +655,7 @@ static inline Ast* parse_if_stmt(ParseContext *c)
 	}
 	CONSUME_OR_RET(TOKEN_RPAREN, poisoned_ast);
 
-	unsigned next_row = c->span.row;
+	unsigned next_row = span_row(c->span);
 	ASSIGN_ASTID_OR_RET(if_ast->if_stmt.then_body, parse_stmt(c), poisoned_ast);
 	if (row != next_row && astptr(if_ast->if_stmt.then_body)->ast_kind != AST_COMPOUND_STMT)
 	{
@@ -674,7 +705,7 @@ static inline Ast *parse_case_stmt(ParseContext *c, TokenType case_type, TokenTy
 	{
 		ASSIGN_EXPRID_OR_RET(ast->case_stmt.to_expr, parse_expr(c), poisoned_ast);
 	}
-	uint32_t row = c->span.row;
+	uint32_t row = span_row(c->span);
 	if (!try_consume(c, TOKEN_COLON))
 	{
 		print_error_at(c->prev_span, "Missing ':' after case");
@@ -694,7 +725,7 @@ static inline Ast *parse_default_stmt(ParseContext *c, TokenType case_type, Toke
 	Ast *ast = new_ast(AST_DEFAULT_STMT, c->span);
 	advance(c);
 	TRY_CONSUME_OR_RET(TOKEN_COLON, "Expected ':' after 'default'.", poisoned_ast);
-	uint32_t row = c->span.row;
+	uint32_t row = span_row(c->span);
 	RANGE_EXTEND_PREV(ast);
 	ASSIGN_AST_OR_RET(ast->case_stmt.body, parse_case_stmts(c, case_type, default_type, row), poisoned_ast);
 	ast->case_stmt.expr = 0;
@@ -769,7 +800,7 @@ static inline Ast* parse_switch_stmt(ParseContext *c)
 
 
 /**
- * for_stmt ::= IF optional_label '(' expression_list? ';' cond? ';' expression_list? ')' statement
+ * for_stmt ::= IF optional_label '(' expression_list? ';' cond? ';' expression_list? ')' loop_attributes statement
  */
 static inline Ast* parse_for_stmt(ParseContext *c)
 {
@@ -809,12 +840,13 @@ static inline Ast* parse_for_stmt(ParseContext *c)
 		ASSIGN_EXPRID_OR_RET(ast->for_stmt.incr, parse_expression_list(c, false), poisoned_ast);
 		CONSUME_OR_RET(TOKEN_RPAREN, poisoned_ast);
 	}
+	if (!parse_loop_attributes(c, &ast->for_stmt.flow)) return poisoned_ast;
 
 	// Ast range does not include the body
 	RANGE_EXTEND_PREV(ast);
-	unsigned row = c->prev_span.row;
+	unsigned row = span_row(c->prev_span);
 	ASSIGN_AST_OR_RET(Ast *body, parse_stmt(c), poisoned_ast);
-	if (body->ast_kind != AST_COMPOUND_STMT && row != body->span.row)
+	if (body->ast_kind != AST_COMPOUND_STMT && row != span_row(body->span))
 	{
 		PRINT_ERROR_AT(body, "A single statement after 'for' must be placed on the same line, or be enclosed in {}.");
 		return poisoned_ast;
@@ -852,7 +884,7 @@ static inline bool parse_foreach_var(ParseContext *c, Ast *foreach)
 	return true;
 }
 /**
- * foreach_stmt ::= (FOREACH | FOREACH_R) optional_label '(' foreach_vars ':' expression ')' statement
+ * foreach_stmt ::= (FOREACH | FOREACH_R) optional_label '(' foreach_vars ':' expression ')' loop_attributes statement
  * foreach_vars ::= foreach_var (',' foreach_var)?
  */
 static inline Ast* parse_foreach_stmt(ParseContext *c)
@@ -887,6 +919,7 @@ static inline Ast* parse_foreach_stmt(ParseContext *c)
 	ASSIGN_EXPRID_OR_RET(ast->foreach_stmt.enumeration, parse_expr(c), poisoned_ast);
 
 	CONSUME_OR_RET(TOKEN_RPAREN, poisoned_ast);
+	if (!parse_loop_attributes(c, &ast->foreach_stmt.flow)) return poisoned_ast;
 
 	RANGE_EXTEND_PREV(ast);
 	ASSIGN_ASTID_OR_RET(ast->foreach_stmt.body, parse_stmt(c), poisoned_ast);
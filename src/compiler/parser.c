@@ -205,11 +205,12 @@ bool parse_stdin(void)
 		}
 		data[len++] = (char)c;
 	}
-	buffer[len] = 0;
+	data[len] = 0;
 	char *stdin_data = MALLOC(len + 1);
 	memcpy(stdin_data, data, len + 1);
 	if (data != buffer) free(data);
 	stdin_file.contents = stdin_data;
+	stdin_file.content_len = len;
 	CompilationUnit *unit = unit_create(&stdin_file);
 	ParseContext parse_context = { .unit = unit };
 	parse_context.lexer = (Lexer) { .file = &stdin_file, .context =  &parse_context };
@@ -378,6 +378,7 @@ static inline bool sema_check_asm_var(SemaContext *context, AsmInlineBlock *bloc
 	if (is_write)
 	{
 		decl->var.is_written = true;
+		sema_var_assigned(decl);
 		if (decl->var.in_param)
 		{
 			SEMA_ERROR(expr, "An 'in' variable may not be written to.");
@@ -468,6 +469,7 @@ static inline bool sema_check_asm_memvar(SemaContext *context, AsmInlineBlock *b
 	if (is_write)
 	{
 		decl->var.is_written = true;
+		sema_var_assigned(decl);
 		if (decl->var.in_param && !decl->var.out_param)
 		{
 			RETURN_SEMA_ERROR(expr, "An 'in' variable may not be written to.");
@@ -556,6 +556,7 @@ bool sema_expr_analyse_builtin_call(SemaContext *context, Expr *expr)
 			expr->type = type_void;
 			return true;
 		case BUILTIN_SYSCLOCK:
+		case BUILTIN_SYSCLOCK_FENCED:
 			expr->type = type_ulong;
 			return true;
 		case BUILTIN_GET_ROUNDING_MODE:
@@ -756,6 +757,11 @@ bool sema_expr_analyse_builtin_call(SemaContext *context, Expr *expr)
 			if (!sema_check_builtin_args_match(context, args, 2)) return false;
 			rtype = args[0]->type;
 			break;
+		case BUILTIN_SHUFFLE:
+			ASSERT(arg_count == 2);
+			if (!sema_check_builtin_args(context, args, (BuiltinArg[]) {BA_VEC, BA_INTVEC}, 2)) return false;
+			rtype = type_get_vector(type_flatten(args[0]->type)->array.base, type_flatten(args[1]->type)->array.len);
+			break;
 		case BUILTIN_REVERSE:
 			ASSERT(arg_count == 1);
 			if (!sema_check_builtin_args(context, args, (BuiltinArg[]) {BA_VEC}, 1)) return false;
@@ -1050,6 +1056,7 @@ bool sema_expr_analyse_builtin_call(SemaContext *context, Expr *expr)
 			rtype = args[1]->type;
 			break;
 		}
+		case BUILTIN_NONTEMPORAL_LOAD:
 		case BUILTIN_VOLATILE_LOAD:
 		{
 			ASSERT(arg_count == 1);
@@ -1059,6 +1066,7 @@ bool sema_expr_analyse_builtin_call(SemaContext *context, Expr *expr)
 			rtype = original->pointer;
 			break;
 		}
+		case BUILTIN_NONTEMPORAL_STORE:
 		case BUILTIN_VOLATILE_STORE:
 		{
 			ASSERT(arg_count == 2);
@@ -1188,6 +1196,7 @@ bool sema_expr_analyse_builtin_call(SemaContext *context, Expr *expr)
 		case BUILTIN_SWIZZLE:
 		case BUILTIN_SWIZZLE2:
 		case BUILTIN_SYSCLOCK:
+		case BUILTIN_SYSCLOCK_FENCED:
 		case BUILTIN_TRAP:
 		case BUILTIN_BREAKPOINT:
 		case BUILTIN_UNREACHABLE:
@@ -1213,6 +1222,7 @@ static inline int builtin_expected_args(BuiltinFunction func)
 			return -3;
 		case BUILTIN_GET_ROUNDING_MODE:
 		case BUILTIN_SYSCLOCK:
+		case BUILTIN_SYSCLOCK_FENCED:
 		case BUILTIN_TRAP:
 		case BUILTIN_BREAKPOINT:
 		case BUILTIN_UNREACHABLE:
@@ -1258,6 +1268,7 @@ static inline int builtin_expected_args(BuiltinFunction func)
 		case BUILTIN_STR_UPPER:
 		case BUILTIN_STR_LOWER:
 		case BUILTIN_TRUNC:
+		case BUILTIN_NONTEMPORAL_LOAD:
 		case BUILTIN_VOLATILE_LOAD:
 		case BUILTIN_WASM_MEMORY_SIZE:
 			return 1;
@@ -1279,6 +1290,8 @@ static inline int builtin_expected_args(BuiltinFunction func)
 		case BUILTIN_SAT_SHL:
 		case BUILTIN_SAT_SUB:
 		case BUILTIN_SAT_MUL:
+		case BUILTIN_SHUFFLE:
+		case BUILTIN_NONTEMPORAL_STORE:
 		case BUILTIN_VOLATILE_STORE:
 		case BUILTIN_VECCOMPNE:
 		case BUILTIN_VECCOMPLT:
@@ -1589,6 +1589,9 @@ static void vector_const_initializer_convert_to_type(ConstInitializer *initializ
 			}
 			break;
 		}
+		case CONST_INIT_ARRAY_BYTES:
+			const_init_expand_bytes(initializer);
+			FALLTHROUGH;
 		case CONST_INIT_ARRAY_FULL:
 		{
 			Type *element_type = type_flatten(to_type)->array.base;
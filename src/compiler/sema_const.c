@@ -262,6 +262,9 @@ static bool sema_append_const_array_one(SemaContext *context, Expr *expr, Expr *
 			expr_replace(expr, list);
 			expr->type = new_outer_type;
 			break;
+		case CONST_INIT_ARRAY_BYTES:
+			const_init_expand_bytes(init);
+			FALLTHROUGH;
 		case CONST_INIT_ARRAY_FULL:
 			init->type = new_inner_type;
 			vec_add(init->init_array_full, const_init_new_value(element));
@@ -415,12 +418,14 @@ bool sema_expr_analyse_ct_concat(SemaContext *context, Expr *concat_expr, Expr *
 			ConstInitializer *init = expr_const_initializer_from_expr(single_expr);
 			// Skip zero arrays from slices.
 			if (!init) continue;
+			const_init_expand_bytes(init);
 			switch (init->kind)
 			{
 				case CONST_INIT_UNION:
 				case CONST_INIT_STRUCT:
 				case CONST_INIT_ARRAY_VALUE:
 				case CONST_INIT_VALUE:
+				case CONST_INIT_ARRAY_BYTES:
 					UNREACHABLE
 				case CONST_INIT_ARRAY_FULL:
 				{
@@ -466,6 +471,7 @@ bool sema_expr_analyse_ct_concat(SemaContext *context, Expr *concat_expr, Expr *
 							case CONST_INIT_UNION:
 							case CONST_INIT_ARRAY:
 							case CONST_INIT_ARRAY_FULL:
+							case CONST_INIT_ARRAY_BYTES:
 							case CONST_INIT_ARRAY_VALUE:
 								expr_rewrite_const_initializer(inner_expr, index_type, inner_element);
 								break;
@@ -507,11 +513,27 @@ bool sema_expr_analyse_ct_concat(SemaContext *context, Expr *concat_expr, Expr *
 		expr_rewrite_const_initializer(concat_expr, type, rhs_init);
 		return true;
 	}
+	if (lhs_init->kind == CONST_INIT_ARRAY_BYTES && rhs_init->kind == CONST_INIT_ARRAY_BYTES
+		&& const_init_type_may_be_packed(type)
+		&& type_flatten(lhs_init->type->array.base) == type_flatten(indexed_type)
+		&& type_flatten(rhs_init->type->array.base) == type_flatten(indexed_type))
+	{
+		// Packed + packed => packed
+		ByteSize element_size = type_size(indexed_type);
+		char *bytes = MALLOC(len * element_size);
+		memcpy(bytes, lhs_init->init_array_bytes, len_lhs * element_size);
+		memcpy(bytes + len_lhs * element_size, rhs_init->init_array_bytes, len_rhs * element_size);
+		expr_rewrite_const_initializer(concat_expr, type, const_init_new_array_bytes(type, bytes));
+		return true;
+	}
+	const_init_expand_bytes(lhs_init);
+	const_init_expand_bytes(rhs_init);
 
 	switch (lhs_init->kind)
 	{
 		case CONST_INIT_UNION:
 		case CONST_INIT_STRUCT:
+		case CONST_INIT_ARRAY_BYTES:
 		case CONST_INIT_ARRAY_VALUE:
 		case CONST_INIT_VALUE:
 			UNREACHABLE
@@ -552,6 +574,7 @@ bool sema_expr_analyse_ct_concat(SemaContext *context, Expr *concat_expr, Expr *
 				case CONST_INIT_STRUCT:
 				case CONST_INIT_UNION:
 				case CONST_INIT_VALUE:
+				case CONST_INIT_ARRAY_BYTES:
 				case CONST_INIT_ARRAY_VALUE:
 					UNREACHABLE
 			}
@@ -562,6 +585,7 @@ bool sema_expr_analyse_ct_concat(SemaContext *context, Expr *concat_expr, Expr *
 			{
 				case CONST_INIT_UNION:
 				case CONST_INIT_STRUCT:
+				case CONST_INIT_ARRAY_BYTES:
 				case CONST_INIT_ARRAY_VALUE:
 				case CONST_INIT_VALUE:
 					UNREACHABLE
@@ -624,6 +648,7 @@ bool sema_expr_analyse_ct_concat(SemaContext *context, Expr *concat_expr, Expr *
 			{
 				case CONST_INIT_UNION:
 				case CONST_INIT_STRUCT:
+				case CONST_INIT_ARRAY_BYTES:
 				case CONST_INIT_ARRAY_VALUE:
 				case CONST_INIT_VALUE:
 					UNREACHABLE
@@ -0,0 +1,644 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by a LGPLv3.0
+// a copy of which can be found in the LICENSE file.
+
+#include "sema_internal.h"
+
+// A small stack based bytecode VM for "$for" loops that only compute compile time integers and bools.
+// The regular path copies and re-analyses the condition, body and increment for every iteration,
+// allocating fresh Expr/Ast nodes on each step. Loops whose bodies just update "$" variables are instead
+// compiled once into bytecode, run with fixed value slots, and the final values are written back.
+// Anything outside of the supported subset makes the compiler bail out, and the regular path is used,
+// which also takes care of reporting any errors.
+
+#define CT_VM_MAX_SLOTS 64
+#define CT_VM_MAX_STACK 64
+
+typedef enum
+{
+	CT_OP_PUSH,           // Push constant[arg]
+	CT_OP_LOAD,           // Push slot[arg]
+	CT_OP_STORE,          // Store the top of the stack in slot[arg], leaving the value on the stack
+	CT_OP_POP,
+	CT_OP_CONV,           // Convert the top of the stack to the type kind in arg
+	CT_OP_ADD,
+	CT_OP_SUB,
+	CT_OP_MUL,
+	CT_OP_DIV,
+	CT_OP_REM,
+	CT_OP_BIT_AND,
+	CT_OP_BIT_OR,
+	CT_OP_BIT_XOR,
+	CT_OP_SHL,
+	CT_OP_SHR,
+	CT_OP_CMP,            // Compare using the BinaryOp in arg
+	CT_OP_AND,
+	CT_OP_OR,
+	CT_OP_NEG,
+	CT_OP_BIT_NEG,
+	CT_OP_NOT,
+	CT_OP_INC,            // Add 1 to the top of the stack
+	CT_OP_DEC,            // Subtract 1 from the top of the stack
+	CT_OP_JUMP,           // Jump to arg
+	CT_OP_JUMP_IF_FALSE,  // Pop and jump to arg if false
+	CT_OP_LOOP,           // Jump back to arg, counting the iteration
+	CT_OP_HALT,
+} CtOpcode;
+
+typedef struct
+{
+	CtOpcode op;
+	uint32_t arg;
+	Type *type;           // For CT_OP_STORE, the type the variable has after the store.
+} CtInstr;
+
+typedef struct
+{
+	SemaContext *context;
+	CtInstr *code;
+	Int *constants;
+	Decl *slots[CT_VM_MAX_SLOTS];
+	Type *slot_types[CT_VM_MAX_SLOTS];
+	unsigned slot_count;
+	unsigned depth;
+	unsigned max_depth;
+	bool iteration_limit;
+} CtCompiler;
+
+static Type *ct_compile_expr(CtCompiler *c, Expr *expr);
+static bool ct_compile_stmt_list(CtCompiler *c, AstId current);
+
+static inline unsigned ct_emit(CtCompiler *c, CtOpcode op, uint32_t arg)
+{
+	vec_add(c->code, ((CtInstr) { .op = op, .arg = arg }));
+	return vec_size(c->code) - 1;
+}
+
+static inline void ct_patch(CtCompiler *c, unsigned instr)
+{
+	c->code[instr].arg = vec_size(c->code);
+}
+
+static inline bool ct_push(CtCompiler *c)
+{
+	if (++c->depth > CT_VM_MAX_STACK) return false;
+	if (c->depth > c->max_depth) c->max_depth = c->depth;
+	return true;
+}
+
+static inline bool ct_type_is_int(Type *type)
+{
+	return type_kind_is_any_integer(type->canonical->type_kind);
+}
+
+static inline bool ct_expr_is_literal(Expr *expr)
+{
+	return expr->expr_kind == EXPR_CONST && expr->const_expr.const_kind == CONST_INTEGER;
+}
+
+/**
+ * Find the slot for a "$" variable, only plain compile time variables holding an integer or bool qualify.
+ */
+static int ct_slot_for_ident(CtCompiler *c, Expr *expr)
+{
+	if (expr->expr_kind != EXPR_CT_IDENT) return -1;
+	const char *name = expr->ct_ident_expr.identifier;
+	for (unsigned i = 0; i < c->slot_count; i++)
+	{
+		if (c->slots[i]->name == name) return (int)i;
+	}
+	Decl *decl = NULL;
+	FOREACH(Decl *, local, c->context->ct_locals)
+	{
+		if (local->name == name)
+		{
+			decl = local;
+			break;
+		}
+	}
+	if (!decl || decl->decl_kind != DECL_VAR || decl->var.kind != VARDECL_LOCAL_CT) return -1;
+	Expr *value = decl->var.init_expr;
+	if (!value || value->expr_kind != EXPR_CONST) return -1;
+	switch (value->const_expr.const_kind)
+	{
+		case CONST_INTEGER:
+			if (!ct_type_is_int(value->type)) return -1;
+			break;
+		case CONST_BOOL:
+			if (value->type->canonical != type_bool) return -1;
+			break;
+		default:
+			return -1;
+	}
+	if (c->slot_count == CT_VM_MAX_SLOTS) return -1;
+	c->slots[c->slot_count] = decl;
+	c->slot_types[c->slot_count] = value->type;
+	return (int)c->slot_count++;
+}
+
+static Type *ct_compile_literal(CtCompiler *c, Expr *expr)
+{
+	if (!ct_push(c)) return NULL;
+	Int value;
+	switch (expr->const_expr.const_kind)
+	{
+		case CONST_INTEGER:
+			if (!ct_type_is_int(expr->type)) return NULL;
+			value = expr->const_expr.ixx;
+			break;
+		case CONST_BOOL:
+			value = (Int) { .i = { 0, expr->const_expr.b }, .type = TYPE_BOOL };
+			break;
+		default:
+			return NULL;
+	}
+	vec_add(c->constants, value);
+	ct_emit(c, CT_OP_PUSH, vec_size(c->constants) - 1);
+	return expr->type;
+}
+
+/**
+ * Compile both sides of a binary expression with the usual arithmetic promotion, returning
+ * the common type or NULL if the combination is not something we can mirror exactly.
+ */
+static Type *ct_compile_promoted_operands(CtCompiler *c, Expr *left, Expr *right, bool is_comparison)
+{
+	Type *left_type = ct_compile_expr(c, left);
+	if (!left_type || !ct_type_is_int(left_type)) return NULL;
+	unsigned left_conv = ct_emit(c, CT_OP_CONV, 0);
+	Type *right_type = ct_compile_expr(c, right);
+	if (!right_type || !ct_type_is_int(right_type)) return NULL;
+	left_type = cast_numeric_arithmetic_promotion(left_type);
+	right_type = cast_numeric_arithmetic_promotion(right_type);
+	Type *left_canonical = left_type->canonical;
+	Type *right_canonical = right_type->canonical;
+	Type *common;
+	if (left_canonical == right_canonical)
+	{
+		common = left_type == right_type ? left_type : left_canonical;
+	}
+	else if (type_is_signed(left_canonical) == type_is_signed(right_canonical))
+	{
+		common = type_size(left_canonical) > type_size(right_canonical) ? left_type : right_type;
+	}
+	else if (is_comparison && ct_expr_is_literal(right) && int_fits(right->const_expr.ixx, left_canonical->type_kind))
+	{
+		common = left_type;
+	}
+	else if (is_comparison && ct_expr_is_literal(left) && int_fits(left->const_expr.ixx, right_canonical->type_kind))
+	{
+		common = right_type;
+	}
+	else
+	{
+		return NULL;
+	}
+	TypeKind kind = common->canonical->type_kind;
+	c->code[left_conv].arg = kind;
+	ct_emit(c, CT_OP_CONV, kind);
+	return common;
+}
+
+static Type *ct_compile_store(CtCompiler *c, int slot, Type *value_type)
+{
+	if (value_type->canonical != c->slot_types[slot]->canonical) return NULL;
+	unsigned store = ct_emit(c, CT_OP_STORE, (uint32_t)slot);
+	c->code[store].type = value_type;
+	return value_type;
+}
+
+static Type *ct_compile_assign(CtCompiler *c, Expr *left, Expr *right)
+{
+	int slot = ct_slot_for_ident(c, left);
+	if (slot < 0) return NULL;
+	Type *var_type = c->slot_types[slot];
+	Type *type = ct_compile_expr(c, right);
+	if (!type) return NULL;
+	// Literals are inferred from the type of the variable.
+	if (ct_expr_is_literal(right) && ct_type_is_int(var_type) && type->canonical != var_type->canonical)
+	{
+		TypeKind kind = var_type->canonical->type_kind;
+		if (!int_fits(right->const_expr.ixx, kind)) return NULL;
+		c->constants[vec_size(c->constants) - 1] = int_conv(right->const_expr.ixx, kind);
+		type = var_type;
+	}
+	if (type->canonical == var_type->canonical) type = var_type;
+	return ct_compile_store(c, slot, type);
+}
+
+static Type *ct_compile_op_assign(CtCompiler *c, Expr *expr, BinaryOp op)
+{
+	Expr *left = exprptr(expr->binary_expr.left);
+	int slot = ct_slot_for_ident(c, left);
+	if (slot < 0) return NULL;
+	Expr binary = *expr;
+	binary.binary_expr.operator = op;
+	Type *type = ct_compile_expr(c, &binary);
+	if (!type) return NULL;
+	return ct_compile_store(c, slot, type);
+}
+
+static Type *ct_compile_binary(CtCompiler *c, Expr *expr)
+{
+	Expr *left = exprptr(expr->binary_expr.left);
+	Expr *right = exprptr(expr->binary_expr.right);
+	BinaryOp op = expr->binary_expr.operator;
+	CtOpcode opcode;
+	switch (op)
+	{
+		case BINARYOP_ASSIGN:
+			return ct_compile_assign(c, left, right);
+		case BINARYOP_ADD_ASSIGN:
+		case BINARYOP_SUB_ASSIGN:
+		case BINARYOP_MULT_ASSIGN:
+		case BINARYOP_DIV_ASSIGN:
+		case BINARYOP_MOD_ASSIGN:
+		case BINARYOP_BIT_AND_ASSIGN:
+		case BINARYOP_BIT_OR_ASSIGN:
+		case BINARYOP_BIT_XOR_ASSIGN:
+		case BINARYOP_SHL_ASSIGN:
+		case BINARYOP_SHR_ASSIGN:
+			return ct_compile_op_assign(c, expr, binaryop_assign_base_op(op));
+		case BINARYOP_AND:
+		case BINARYOP_OR:
+		{
+			// Both sides are always analysed by sema, so we evaluate both as well.
+			Type *left_type = ct_compile_expr(c, left);
+			if (!left_type || left_type->canonical != type_bool) return NULL;
+			Type *right_type = ct_compile_expr(c, right);
+			if (!right_type || right_type->canonical != type_bool) return NULL;
+			ct_emit(c, op == BINARYOP_AND ? CT_OP_AND : CT_OP_OR, 0);
+			c->depth--;
+			return type_bool;
+		}
+		case BINARYOP_GT:
+		case BINARYOP_GE:
+		case BINARYOP_LT:
+		case BINARYOP_LE:
+		case BINARYOP_NE:
+		case BINARYOP_EQ:
+		{
+			if (!ct_compile_promoted_operands(c, left, right, true)) return NULL;
+			ct_emit(c, CT_OP_CMP, op);
+			c->depth--;
+			return type_bool;
+		}
+		case BINARYOP_SHL:
+		case BINARYOP_SHR:
+		{
+			Type *left_type = ct_compile_expr(c, left);
+			if (!left_type || !ct_type_is_int(left_type)) return NULL;
+			left_type = cast_numeric_arithmetic_promotion(left_type);
+			ct_emit(c, CT_OP_CONV, left_type->canonical->type_kind);
+			Type *right_type = ct_compile_expr(c, right);
+			if (!right_type || !ct_type_is_int(right_type)) return NULL;
+			ct_emit(c, op == BINARYOP_SHL ? CT_OP_SHL : CT_OP_SHR, 0);
+			c->depth--;
+			return left_type;
+		}
+		case BINARYOP_MULT: opcode = CT_OP_MUL; break;
+		case BINARYOP_SUB: opcode = CT_OP_SUB; break;
+		case BINARYOP_ADD: opcode = CT_OP_ADD; break;
+		case BINARYOP_DIV: opcode = CT_OP_DIV; break;
+		case BINARYOP_MOD: opcode = CT_OP_REM; break;
+		case BINARYOP_BIT_AND: opcode = CT_OP_BIT_AND; break;
+		case BINARYOP_BIT_OR: opcode = CT_OP_BIT_OR; break;
+		case BINARYOP_BIT_XOR: opcode = CT_OP_BIT_XOR; break;
+		default:
+			return NULL;
+	}
+	Type *type = ct_compile_promoted_operands(c, left, right, false);
+	if (!type) return NULL;
+	ct_emit(c, opcode, 0);
+	c->depth--;
+	return type;
+}
+
+static Type *ct_compile_incdec(CtCompiler *c, Expr *expr, bool post)
+{
+	Expr *inner = expr->unary_expr.expr;
+	int slot = ct_slot_for_ident(c, inner);
+	if (slot < 0) return NULL;
+	Type *type = c->slot_types[slot];
+	if (!ct_type_is_int(type) || !ct_push(c)) return NULL;
+	CtOpcode op = expr->unary_expr.operator == UNARYOP_INC ? CT_OP_INC : CT_OP_DEC;
+	ct_emit(c, CT_OP_LOAD, (uint32_t)slot);
+	ct_emit(c, op, 0);
+	ct_compile_store(c, slot, type);
+	if (post) ct_emit(c, op == CT_OP_INC ? CT_OP_DEC : CT_OP_INC, 0);
+	return type;
+}
+
+static Type *ct_compile_unary(CtCompiler *c, Expr *expr)
+{
+	Type *type;
+	switch (expr->unary_expr.operator)
+	{
+		case UNARYOP_INC:
+		case UNARYOP_DEC:
+			return ct_compile_incdec(c, expr, false);
+		case UNARYOP_NOT:
+			type = ct_compile_expr(c, expr->unary_expr.expr);
+			if (!type || type->canonical != type_bool) return NULL;
+			ct_emit(c, CT_OP_NOT, 0);
+			return type_bool;
+		case UNARYOP_NEG:
+		case UNARYOP_BITNEG:
+			type = ct_compile_expr(c, expr->unary_expr.expr);
+			if (!type || !ct_type_is_int(type)) return NULL;
+			type = cast_numeric_arithmetic_promotion(type);
+			if (expr->unary_expr.operator == UNARYOP_NEG && !type_is_signed(type->canonical)) return NULL;
+			ct_emit(c, CT_OP_CONV, type->canonical->type_kind);
+			ct_emit(c, expr->unary_expr.operator == UNARYOP_NEG ? CT_OP_NEG : CT_OP_BIT_NEG, 0);
+			return type;
+		default:
+			return NULL;
+	}
+}
+
+static Type *ct_compile_expr(CtCompiler *c, Expr *expr)
+{
+	switch (expr->expr_kind)
+	{
+		case EXPR_CONST:
+			return ct_compile_literal(c, expr);
+		case EXPR_CT_IDENT:
+		{
+			int slot = ct_slot_for_ident(c, expr);
+			if (slot < 0 || !ct_push(c)) return NULL;
+			c->slots[slot]->var.is_read = true;
+			ct_emit(c, CT_OP_LOAD, (uint32_t)slot);
+			return c->slot_types[slot];
+		}
+		case EXPR_BINARY:
+			return ct_compile_binary(c, expr);
+		case EXPR_UNARY:
+			return ct_compile_unary(c, expr);
+		case EXPR_POST_UNARY:
+			return ct_compile_incdec(c, expr, true);
+		default:
+			return NULL;
+	}
+}
+
+/**
+ * Compile an expression whose value is discarded, only updates to "$" variables are allowed.
+ */
+static bool ct_compile_effect(CtCompiler *c, Expr *expr)
+{
+	switch (expr->expr_kind)
+	{
+		case EXPR_BINARY:
+			if (expr->binary_expr.operator < BINARYOP_ASSIGN) return false;
+			break;
+		case EXPR_UNARY:
+			if (expr->unary_expr.operator != UNARYOP_INC && expr->unary_expr.operator != UNARYOP_DEC) return false;
+			break;
+		case EXPR_POST_UNARY:
+			break;
+		default:
+			return false;
+	}
+	if (!ct_compile_expr(c, expr)) return false;
+	ct_emit(c, CT_OP_POP, 0);
+	c->depth--;
+	return true;
+}
+
+static bool ct_compile_cond(CtCompiler *c, Expr *expr)
+{
+	Type *type = ct_compile_expr(c, expr);
+	if (!type || type->canonical != type_bool) return false;
+	c->depth--;
+	return true;
+}
+
+static bool ct_compile_stmt(CtCompiler *c, Ast *stmt)
+{
+	switch (stmt->ast_kind)
+	{
+		case AST_NOP_STMT:
+			return true;
+		case AST_EXPR_STMT:
+			return ct_compile_effect(c, stmt->expr_stmt);
+		case AST_CT_COMPOUND_STMT:
+			return ct_compile_stmt_list(c, stmt->ct_compound_stmt);
+		case AST_CT_IF_STMT:
+		{
+			if (!ct_compile_cond(c, stmt->ct_if_stmt.expr)) return false;
+			unsigned jump_else = ct_emit(c, CT_OP_JUMP_IF_FALSE, 0);
+			if (!ct_compile_stmt_list(c, stmt->ct_if_stmt.then)) return false;
+			if (!stmt->ct_if_stmt.elif)
+			{
+				ct_patch(c, jump_else);
+				return true;
+			}
+			Ast *else_stmt = astptr(stmt->ct_if_stmt.elif);
+			if (else_stmt->ast_kind != AST_CT_ELSE_STMT) return false;
+			unsigned jump_end = ct_emit(c, CT_OP_JUMP, 0);
+			ct_patch(c, jump_else);
+			if (!ct_compile_stmt_list(c, else_stmt->ct_else_stmt)) return false;
+			ct_patch(c, jump_end);
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+static bool ct_compile_stmt_list(CtCompiler *c, AstId current)
+{
+	while (current)
+	{
+		Ast *stmt = astptr(current);
+		if (!ct_compile_stmt(c, stmt)) return false;
+		current = stmt->next;
+	}
+	return true;
+}
+
+static inline Int ct_bool(bool value)
+{
+	return (Int) { .i = { 0, value }, .type = TYPE_BOOL };
+}
+
+/**
+ * Run the compiled loop. Returns false if evaluation hits something sema would report,
+ * such as a division by zero or too many iterations, in which case nothing is written back.
+ */
+static bool ct_vm_run(CtCompiler *c, Int *values, Type **types)
+{
+	Int stack[CT_VM_MAX_STACK];
+	Int *sp = stack;
+	CtInstr *code = c->code;
+	Int *constants = c->constants;
+	unsigned iterations = 0;
+	unsigned pc = 0;
+	while (true)
+	{
+		CtInstr *instr = &code[pc++];
+		switch (instr->op)
+		{
+			case CT_OP_PUSH:
+				*sp++ = constants[instr->arg];
+				break;
+			case CT_OP_LOAD:
+				*sp++ = values[instr->arg];
+				break;
+			case CT_OP_STORE:
+				values[instr->arg] = sp[-1];
+				types[instr->arg] = instr->type;
+				break;
+			case CT_OP_POP:
+				sp--;
+				break;
+			case CT_OP_CONV:
+				if (sp[-1].type != (TypeKind)instr->arg) sp[-1] = int_conv(sp[-1], (TypeKind)instr->arg);
+				break;
+			case CT_OP_ADD:
+				sp--;
+				sp[-1] = int_add(sp[-1], sp[0]);
+				break;
+			case CT_OP_SUB:
+				sp--;
+				sp[-1] = int_sub(sp[-1], sp[0]);
+				break;
+			case CT_OP_MUL:
+				sp--;
+				sp[-1] = int_mul(sp[-1], sp[0]);
+				break;
+			case CT_OP_DIV:
+				sp--;
+				if (int_is_zero(sp[0])) return false;
+				sp[-1] = int_div(sp[-1], sp[0]);
+				break;
+			case CT_OP_REM:
+				sp--;
+				if (int_is_zero(sp[0])) return false;
+				sp[-1] = int_rem(sp[-1], sp[0]);
+				break;
+			case CT_OP_BIT_AND:
+				sp--;
+				sp[-1] = int_and(sp[-1], sp[0]);
+				break;
+			case CT_OP_BIT_OR:
+				sp--;
+				sp[-1] = int_or(sp[-1], sp[0]);
+				break;
+			case CT_OP_BIT_XOR:
+				sp--;
+				sp[-1] = int_xor(sp[-1], sp[0]);
+				break;
+			case CT_OP_SHL:
+			case CT_OP_SHR:
+				sp--;
+				if (int_is_neg(sp[0]) || int_ucomp(sp[0], type_kind_bitsize(sp[-1].type), BINARYOP_GE)) return false;
+				sp[-1] = instr->op == CT_OP_SHL ? int_shl64(sp[-1], sp[0].i.low) : int_shr64(sp[-1], sp[0].i.low);
+				break;
+			case CT_OP_CMP:
+				sp--;
+				sp[-1] = ct_bool(int_comp(sp[-1], sp[0], (BinaryOp)instr->arg));
+				break;
+			case CT_OP_AND:
+				sp--;
+				sp[-1] = ct_bool(sp[-1].i.low && sp[0].i.low);
+				break;
+			case CT_OP_OR:
+				sp--;
+				sp[-1] = ct_bool(sp[-1].i.low || sp[0].i.low);
+				break;
+			case CT_OP_NEG:
+				sp[-1] = int_neg(sp[-1]);
+				break;
+			case CT_OP_BIT_NEG:
+				sp[-1] = int_not(sp[-1]);
+				break;
+			case CT_OP_NOT:
+				sp[-1] = ct_bool(!sp[-1].i.low);
+				break;
+			case CT_OP_INC:
+				sp[-1] = int_add64(sp[-1], 1);
+				break;
+			case CT_OP_DEC:
+				sp[-1] = int_sub64(sp[-1], 1);
+				break;
+			case CT_OP_JUMP:
+				pc = instr->arg;
+				break;
+			case CT_OP_JUMP_IF_FALSE:
+				if (!(--sp)->i.low) pc = instr->arg;
+				break;
+			case CT_OP_LOOP:
+				// Same cap as the regular path, running that as well would only repeat the work.
+				if (++iterations >= MAX_MACRO_ITERATIONS)
+				{
+					c->iteration_limit = true;
+					return false;
+				}
+				pc = instr->arg;
+				break;
+			case CT_OP_HALT:
+				return true;
+		}
+	}
+}
+
+/**
+ * Try to evaluate a "$for" that only updates compile time variables. The init part must already have been
+ * analysed. Returns true if the loop was fully evaluated, leaving the "$" variables with their final values.
+ * If the loop does not terminate, the error is reported here and failed_ref is set.
+ */
+bool sema_ct_vm_eval_for(SemaContext *context, Ast *statement, bool *failed_ref)
+{
+	CtCompiler c = { .context = context };
+	Expr **incr_list = statement->for_stmt.incr ? exprptr(statement->for_stmt.incr)->expression_list : NULL;
+
+	unsigned loop_start = vec_size(c.code);
+	if (!ct_compile_cond(&c, exprptr(statement->for_stmt.cond))) return false;
+	unsigned jump_exit = ct_emit(&c, CT_OP_JUMP_IF_FALSE, 0);
+	if (!ct_compile_stmt(&c, astptr(statement->for_stmt.body))) return false;
+	FOREACH(Expr *, expr, incr_list)
+	{
+		if (!ct_compile_effect(&c, expr)) return false;
+	}
+	ct_emit(&c, CT_OP_LOOP, loop_start);
+	ct_patch(&c, jump_exit);
+	ct_emit(&c, CT_OP_HALT, 0);
+
+	Int values[CT_VM_MAX_SLOTS];
+	Type *types[CT_VM_MAX_SLOTS];
+	for (unsigned i = 0; i < c.slot_count; i++)
+	{
+		Expr *init = c.slots[i]->var.init_expr;
+		values[i] = init->const_expr.const_kind == CONST_BOOL ? ct_bool(init->const_expr.b) : init->const_expr.ixx;
+		types[i] = NULL;
+	}
+	if (!ct_vm_run(&c, values, types))
+	{
+		if (!c.iteration_limit) return false;
+		SEMA_ERROR(statement, "The '$for' did not finish within %d iterations.", MAX_MACRO_ITERATIONS);
+		*failed_ref = true;
+		return false;
+	}
+
+	// Write back every variable that was assigned to.
+	for (unsigned i = 0; i < c.slot_count; i++)
+	{
+		Type *type = types[i];
+		if (!type) continue;
+		Decl *decl = c.slots[i];
+		Expr *value;
+		if (type->canonical == type_bool)
+		{
+			value = expr_new_const_bool(statement->span, type, values[i].i.low != 0);
+		}
+		else
+		{
+			value = expr_new_const_int(statement->span, type, 0);
+			value->const_expr.ixx = values[i];
+		}
+		decl->var.init_expr = value;
+		decl->type = type;
+	}
+	return true;
+}
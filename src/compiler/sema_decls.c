@@ -3,6 +3,7 @@
 // a copy of which can be found in the LICENSE file.
 
 #include "sema_internal.h"
+#include "compiler_tests/benchmark.h"
 
 static inline bool sema_analyse_func_macro(SemaContext *context, Decl *decl, AttributeDomain domain, bool *erase_decl);
 static inline bool sema_analyse_func(SemaContext *context, Decl *decl, bool *erase_decl);
@@ -209,7 +210,7 @@ static inline bool sema_analyse_struct_member(SemaContext *context, Decl *parent
 			UNREACHABLE
 	}
 	// Check attributes.
-	if (!sema_analyse_attributes(context, decl, decl->attributes, domain, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), domain, erase_decl)) return decl_poison(decl);
 
 	// If we should erase this declaration due to an @if, exit here.
 	if (*erase_decl) return true;
@@ -688,7 +689,7 @@ static bool sema_analyse_struct_union(SemaContext *context, Decl *decl, bool *er
 	// Begin by analysing attributes
 	bool is_union = decl->decl_kind == DECL_UNION;
 	AttributeDomain domain = is_union ? ATTR_UNION : ATTR_STRUCT;
-	if (!sema_analyse_attributes(context, decl, decl->attributes, domain, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), domain, erase_decl)) return decl_poison(decl);
 
 	// If an @if attribute erases it, end here
 	if (*erase_decl) return true;
@@ -741,7 +742,7 @@ static inline bool sema_analyse_bitstruct_member(SemaContext *context, Decl *par
 		RETURN_SEMA_ERROR(member, "Circular dependency resolving member.");
 	}
 
-	if (!sema_analyse_attributes(context, member, member->attributes, ATTR_BITSTRUCT_MEMBER, erase_decl)) return decl_poison(member);
+	if (!sema_analyse_attributes(context, member, decl_attributes(member), ATTR_BITSTRUCT_MEMBER, erase_decl)) return decl_poison(member);
 	if (*erase_decl) return true;
 
 	if (member->name)
@@ -915,7 +916,7 @@ AFTER_BIT_CHECK:
 static bool sema_analyse_interface(SemaContext *context, Decl *decl, bool *erase_decl)
 {
 	// Begin with analysing attributes.
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_INTERFACE, erase_decl)) return false;
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_INTERFACE, erase_decl)) return false;
 
 	// If erased using @if, we exit.
 	if (*erase_decl) return true;
@@ -1056,7 +1057,7 @@ RETRY:
 
 static bool sema_analyse_bitstruct(SemaContext *context, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_BITSTRUCT, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_BITSTRUCT, erase_decl)) return decl_poison(decl);
 	if (!sema_resolve_implemented_interfaces(context, decl, false)) return decl_poison(decl);
 	if (*erase_decl) return true;
 	DEBUG_LOG("Beginning analysis of %s.", decl->name ? decl->name : ".anon");
@@ -1250,7 +1251,7 @@ static inline bool sema_analyse_signature(SemaContext *context, Signature *sig,
 		ASSERT(param->resolve_status == RESOLVE_NOT_DONE && "The param shouldn't have been resolved yet.");
 		param->resolve_status = RESOLVE_RUNNING;
 		bool erase = false;
-		if (!sema_analyse_attributes(context, param, param->attributes, ATTR_PARAM, &erase))
+		if (!sema_analyse_attributes(context, param, decl_attributes(param), ATTR_PARAM, &erase))
 		{
 			return decl_poison(param);
 		}
@@ -1420,7 +1421,7 @@ bool sema_analyse_function_signature(SemaContext *context, Decl *func_decl, Type
 
 static inline bool sema_analyse_fntype(SemaContext *context, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_FNTYPE, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_FNTYPE, erase_decl)) return decl_poison(decl);
 	if (*erase_decl) return true;
 	Signature *sig = &decl->fntype_decl;
 	return sema_analyse_function_signature(context, decl, NULL, sig->abi, sig);
@@ -1428,7 +1429,7 @@ static inline bool sema_analyse_fntype(SemaContext *context, Decl *decl, bool *e
 
 static inline bool sema_analyse_typedef(SemaContext *context, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_ALIAS, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_ALIAS, erase_decl)) return decl_poison(decl);
 	if (*erase_decl) return true;
 
 	bool is_export = decl->is_export;
@@ -1455,7 +1456,7 @@ static inline bool sema_analyse_typedef(SemaContext *context, Decl *decl, bool *
 static inline bool sema_analyse_distinct(SemaContext *context, Decl *decl, bool *erase_decl)
 {
 	// Check the attributes on the distinct type.
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_DISTINCT, erase_decl)) return false;
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_DISTINCT, erase_decl)) return false;
 
 	// Erase it?
 	if (*erase_decl) return true;
@@ -1479,9 +1480,9 @@ static inline bool sema_analyse_distinct(SemaContext *context, Decl *decl, bool
 static inline bool sema_analyse_enum_param(SemaContext *context, Decl *param)
 {
 	ASSERT(param->decl_kind == DECL_VAR && param->var.kind == VARDECL_PARAM && param->var.type_info);
-	if (vec_size(param->attributes))
+	if (vec_size(decl_attributes(param)))
 	{
-		RETURN_SEMA_ERROR(param->attributes[0], "There are no valid attributes for associated values.");
+		RETURN_SEMA_ERROR(decl_attributes(param)[0], "There are no valid attributes for associated values.");
 	}
 	TypeInfo *type_info = type_infoptrzero(param->var.type_info);
 	if (!sema_resolve_type_info(context, type_info, RESOLVE_TYPE_DEFAULT)) return false;
@@ -1504,7 +1505,7 @@ static inline bool sema_analyse_enum_param(SemaContext *context, Decl *param)
 
 static inline bool sema_analyse_enum(SemaContext *context, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_ENUM, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_ENUM, erase_decl)) return decl_poison(decl);
 	if (*erase_decl) return true;
 	if (!sema_resolve_implemented_interfaces(context, decl, false)) return decl_poison(decl);
 
@@ -1557,7 +1558,7 @@ static inline bool sema_analyse_enum(SemaContext *context, Decl *decl, bool *era
 		Decl *enum_value = enum_values[i];
 
 		bool erase_val = false;
-		if (!sema_analyse_attributes(context, enum_value, enum_value->attributes, ATTR_ENUM_VALUE, &erase_val)) return decl_poison(decl);
+		if (!sema_analyse_attributes(context, enum_value, decl_attributes(enum_value), ATTR_ENUM_VALUE, &erase_val)) return decl_poison(decl);
 
 		if (erase_val)
 		{
@@ -1655,7 +1656,7 @@ ERR:
 
 static inline bool sema_analyse_fault(SemaContext *context, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_FAULT, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_FAULT, erase_decl)) return decl_poison(decl);
 	if (*erase_decl) return true;
 	decl->type = type_fault;
 	decl->alignment = type_abi_alignment(type_string);
@@ -2061,7 +2062,7 @@ static bool sema_check_operator_method_validity(SemaContext *context, Decl *meth
 
 bool sema_decl_if_cond(SemaContext *context, Decl *decl)
 {
-	Attr *attr = attr_find_kind(decl->attributes, ATTRIBUTE_IF);
+	Attr *attr = attr_find_kind(decl_attributes(decl), ATTRIBUTE_IF);
 	decl->is_if = true;
 	ASSERT(attr);
 	if (vec_size(attr->exprs) != 1)
@@ -2085,8 +2086,8 @@ bool sema_decl_if_cond(SemaContext *context, Decl *decl)
 
 INLINE SourceSpan method_find_overload_span(Decl *method)
 {
-	ASSERT(method->resolved_attributes && method->attrs_resolved);
-	return method->attrs_resolved->overload;
+	ASSERT(method->resolved_attributes && decl_attrs_resolved(method));
+	return decl_attrs_resolved(method)->overload;
 }
 
 static inline bool unit_add_base_extension_method(UNUSED SemaContext *context, CompilationUnit *unit, Type *parent_type, Decl *method)
@@ -2893,12 +2894,16 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 			[ATTRIBUTE_PUBLIC] = ATTR_FUNC | ATTR_MACRO | ATTR_GLOBAL | ATTR_CONST | USER_DEFINED_TYPES | ATTR_ALIAS | ATTR_INTERFACE,
 			[ATTRIBUTE_PURE] = ATTR_CALL,
 			[ATTRIBUTE_REFLECT] = ATTR_FUNC | ATTR_GLOBAL | ATTR_CONST | USER_DEFINED_TYPES,
+			[ATTRIBUTE_SAFE] = ATTR_FUNC,
 			[ATTRIBUTE_SAFEMACRO] = ATTR_MACRO,
 			[ATTRIBUTE_SECTION] = ATTR_FUNC | ATTR_CONST | ATTR_GLOBAL,
 			[ATTRIBUTE_TAG] = ATTR_BITSTRUCT_MEMBER | ATTR_MEMBER | USER_DEFINED_TYPES | CALLABLE_TYPE,
+			[ATTRIBUTE_TARGET_CLONES] = ATTR_FUNC,
 			[ATTRIBUTE_TEST] = ATTR_FUNC,
+			[ATTRIBUTE_UNROLL] = 0, // Special, used for loops only
 			[ATTRIBUTE_UNUSED] = (AttributeDomain)~(ATTR_CALL),
 			[ATTRIBUTE_USED] = (AttributeDomain)~(ATTR_CALL),
+			[ATTRIBUTE_VECTORIZE] = 0, // Special, used for loops only
 			[ATTRIBUTE_WASM] = ATTR_FUNC,
 			[ATTRIBUTE_WEAK] = ATTR_FUNC | ATTR_CONST | ATTR_GLOBAL | ATTR_ALIAS,
 			[ATTRIBUTE_WINMAIN] = ATTR_FUNC,
@@ -2912,7 +2917,7 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 
 	// No attribute has more than one argument right now.
 	unsigned args = vec_size(attr->exprs);
-	if (args > 1 && type != ATTRIBUTE_LINK && type != ATTRIBUTE_TAG && type != ATTRIBUTE_WASM)
+	if (args > 1 && type != ATTRIBUTE_LINK && type != ATTRIBUTE_TAG && type != ATTRIBUTE_WASM && type != ATTRIBUTE_TARGET_CLONES)
 	{
 		RETURN_SEMA_ERROR(attr->exprs[1], "Too many arguments for the attribute.");
 	}
@@ -3102,7 +3107,7 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 				{
 					RETURN_SEMA_ERROR(expr, "Expected a constant string value as argument.");
 				}
-				decl->extname = expr->const_expr.bytes.ptr;
+				decl_set_extname(decl, expr->const_expr.bytes.ptr);
 				decl->has_extname = true;
 			}
 			return true;
@@ -3123,7 +3128,7 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 					RETURN_SEMA_ERROR(expr, "An external name is already defined, please use '@extern` without an argument.");
 				}
 				decl->has_extname = true;
-				decl->extname = expr->const_expr.bytes.ptr;
+				decl_set_extname(decl, expr->const_expr.bytes.ptr);
 			}
 			decl->is_export = true;
 			return true;
@@ -3195,6 +3200,46 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 				if (has_link) vec_add(attr_data->links, string->const_expr.bytes.ptr);
 			}
 			return true;
+		case ATTRIBUTE_TARGET_CLONES:
+		{
+			if (args < 1) RETURN_SEMA_ERROR(attr, "'@target_clones' requires at least one feature list, e.g. '@target_clones(\"avx2,fma\")'.");
+			if (!decl->func_decl.body) RETURN_SEMA_ERROR(attr, "'@target_clones' can only be used on functions with a body.");
+			if (decl->func_decl.signature.variadic == VARIADIC_RAW)
+			{
+				RETURN_SEMA_ERROR(attr, "'@target_clones' cannot be used on C style variadic functions.");
+			}
+			bool is_x86 = compiler.platform.arch == ARCH_TYPE_X86 || compiler.platform.arch == ARCH_TYPE_X86_64;
+			for (unsigned i = 0; i < args; i++)
+			{
+				Expr *string = attr->exprs[i];
+				if (!sema_analyse_expr(context, string)) return false;
+				if (!expr_is_const_string(string)) RETURN_SEMA_ERROR(string, "Expected a constant string with a comma separated feature list, e.g. \"avx2,fma\".");
+				const char *features = string->const_expr.bytes.ptr;
+				if (!features[0]) RETURN_SEMA_ERROR(string, "The feature list may not be empty.");
+				if (!is_x86) continue;
+				scratch_buffer_clear();
+				for (const char *c = features;; c++)
+				{
+					if (*c != ',' && *c != 0)
+					{
+						scratch_buffer_append_char(*c);
+						continue;
+					}
+					if (!x86_feature_name_is_valid(scratch_buffer_to_string()))
+					{
+						RETURN_SEMA_ERROR(string, "'%s' is not a known x86 feature.", scratch_buffer_to_string());
+					}
+					if (!*c) break;
+					scratch_buffer_clear();
+				}
+				vec_add(attr_data->target_clones, features);
+			}
+			// Other targets simply compile the function normally.
+			if (!is_x86) return true;
+			if (no_stdlib()) RETURN_SEMA_ERROR(attr, "'@target_clones' needs the standard library to detect the CPU features.");
+			compiler.context.uses_target_clones = true;
+			return true;
+		}
 		case ATTRIBUTE_INIT:
 			decl->func_decl.attr_init = true;
 		PARSE:;
@@ -3236,7 +3281,7 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 					break;
 				case ATTRIBUTE_EXTERN:
 					decl->has_extname = true;
-					decl->extname = expr->const_expr.bytes.ptr;
+					decl_set_extname(decl, expr->const_expr.bytes.ptr);
 					break;
 				default:
 					UNREACHABLE
@@ -3357,6 +3402,13 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 		case ATTRIBUTE_PURE:
 			// Only used for calls.
 			UNREACHABLE
+		case ATTRIBUTE_SAFE:
+			if (!expr) RETURN_SEMA_ERROR(attr, "'@safe' requires a boolean argument, e.g. @safe(false).");
+			if (!sema_analyse_expr(context, expr)) return false;
+			if (!expr_is_const_bool(expr)) RETURN_SEMA_ERROR(expr, "Expected a constant boolean value as argument.");
+			decl->func_decl.safety_override = true;
+			decl->func_decl.safe_mode = expr->const_expr.b;
+			return true;
 		case ATTRIBUTE_SAFEMACRO:
 			decl->func_decl.signature.is_safemacro = true;
 			break;
@@ -3367,6 +3419,8 @@ static bool sema_analyse_attribute(SemaContext *context, ResolvedAttrData *attr_
 			decl->obfuscate = true;
 			break;
 		case ATTRIBUTE_JUMP:
+		case ATTRIBUTE_UNROLL:
+		case ATTRIBUTE_VECTORIZE:
 			break;
 		case ATTRIBUTE_NONE:
 			UNREACHABLE
@@ -3504,15 +3558,15 @@ static bool sema_analyse_attributes(SemaContext *context, Decl *decl, Attr **att
 	if (!sema_analyse_attributes_inner(context, &data, decl, attrs, domain, NULL, erase_decl)) return false;
 	if (*erase_decl) return true;
 	decl->resolved_attributes = true;
-	if (data.tags || data.deprecated || data.links || data.section || data.overload.row || data.wasm_module )
+	if (data.tags || data.deprecated || data.links || data.section || data.overload.pos || data.wasm_module || data.target_clones)
 	{
 		ResolvedAttrData *copy = MALLOCS(ResolvedAttrData);
 		*copy = data;
-		decl->attrs_resolved = copy;
+		decl_cold(decl)->attrs_resolved = copy;
 	}
-	else
+	else if (decl->cold)
 	{
-		decl->attrs_resolved = NULL;
+		decl->cold->attrs_resolved = NULL;
 	}
 	return true;
 }
@@ -3667,7 +3721,7 @@ Decl *sema_create_runner_main(SemaContext *context, Decl *decl)
 	Decl *function = decl_new(DECL_FUNC, NULL, decl->span);
 	function->is_export = true;
 	function->has_extname = true;
-	function->extname = kw_mainstub;
+	decl_set_extname(function, kw_mainstub);
 	function->name = kw_mainstub;
 	function->unit = decl->unit;
 
@@ -3676,14 +3730,14 @@ Decl *sema_create_runner_main(SemaContext *context, Decl *decl)
 	int param_count;
 	if (is_win32)
 	{
-		function->extname = kw_wmain;
+		decl_set_extname(function, kw_wmain);
 		params[0] = decl_new_generated_var(type_cint, VARDECL_PARAM, decl->span);
 		params[1] = decl_new_generated_var(type_get_ptr(type_get_ptr(type_ushort)), VARDECL_PARAM, decl->span);
 		param_count = 2;
 	}
 	else
 	{
-		function->extname = kw_main;
+		decl_set_extname(function, kw_main);
 		params[0] = decl_new_generated_var(type_cint, VARDECL_PARAM, decl->span);
 		params[1] = decl_new_generated_var(type_get_ptr(type_get_ptr(type_char)), VARDECL_PARAM, decl->span);
 		param_count = 2;
@@ -3729,7 +3783,7 @@ static inline Decl *sema_create_synthetic_main(SemaContext *context, Decl *decl,
 	Decl *function = decl_new(DECL_FUNC, NULL, decl->span);
 	function->is_export = true;
 	function->has_extname = true;
-	function->extname = kw_mainstub;
+	decl_set_extname(function, kw_mainstub);
 	function->name = kw_mainstub;
 	function->unit = decl->unit;
 
@@ -3738,7 +3792,7 @@ static inline Decl *sema_create_synthetic_main(SemaContext *context, Decl *decl,
 	int param_count;
 	if (is_winmain)
 	{
-		function->extname = kw_winmain;
+		decl_set_extname(function, kw_winmain);
 		params[0] = decl_new_generated_var(type_voidptr, VARDECL_PARAM, decl->span);
 		params[1]  = decl_new_generated_var(type_voidptr, VARDECL_PARAM, decl->span);
 		params[2]  = decl_new_generated_var(type_get_ptr(type_ushort), VARDECL_PARAM, decl->span);
@@ -3747,14 +3801,14 @@ static inline Decl *sema_create_synthetic_main(SemaContext *context, Decl *decl,
 	}
 	else if (is_wmain)
 	{
-		function->extname = kw_wmain;
+		decl_set_extname(function, kw_wmain);
 		params[0] = decl_new_generated_var(type_cint, VARDECL_PARAM, decl->span);
 		params[1] = decl_new_generated_var(type_get_ptr(type_get_ptr(type_ushort)), VARDECL_PARAM, decl->span);
 		param_count = 2;
 	}
 	else
 	{
-		function->extname = kw_main;
+		decl_set_extname(function, kw_main);
 		params[0] = decl_new_generated_var(type_cint, VARDECL_PARAM, decl->span);
 		params[1] = decl_new_generated_var(type_get_ptr(type_get_ptr(type_char)), VARDECL_PARAM, decl->span);
 		param_count = 2;
@@ -3907,7 +3961,7 @@ static inline bool sema_analyse_main_function(SemaContext *context, Decl *decl)
 		// Int return is pass-through at the moment.
 		decl->is_export = true;
 		decl->has_extname = true;
-		decl->extname = kw_main;
+		decl_set_extname(decl, kw_main);
 		function = decl;
 		goto REGISTER_MAIN;
 	}
@@ -3930,7 +3984,7 @@ REGISTER_MAIN:
 static inline bool sema_analyse_func_macro(SemaContext *context, Decl *decl, AttributeDomain domain, bool *erase_decl)
 {
 	assert((domain & CALLABLE_TYPE) == domain);
-	if (!sema_analyse_attributes(context, decl, decl->attributes, domain,
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), domain,
 								 erase_decl)) return decl_poison(decl);
 	return true;
 }
@@ -3943,6 +3997,18 @@ static inline bool sema_analyse_func(SemaContext *context, Decl *decl, bool *era
 	if (!sema_analyse_func_macro(context, decl, is_interface_method ? ATTR_INTERFACE_METHOD : ATTR_FUNC, erase_decl)) return false;
 	if (*erase_decl) return true;
 
+	// Without @safe on the function, use the one on the module, then the per-module setting.
+	if (!decl->func_decl.safety_override)
+	{
+		SafetyLevel safe_mode = decl->unit->safe_mode;
+		if (safe_mode == SAFETY_NOT_SET) safe_mode = module_safe_mode(decl->unit->module);
+		if (safe_mode != SAFETY_NOT_SET)
+		{
+			decl->func_decl.safety_override = true;
+			decl->func_decl.safe_mode = safe_mode == SAFETY_ON;
+		}
+	}
+
 	bool is_test = decl->func_decl.attr_test;
 	bool is_benchmark = decl->func_decl.attr_benchmark;
 	bool is_init_finalizer = decl->func_decl.attr_init || decl->func_decl.attr_finalizer;
@@ -4266,7 +4332,7 @@ static bool sema_analyse_attributes_for_var(SemaContext *context, Decl *decl, bo
 			domain = ATTR_LOCAL;
 			break;
 	}
-	if (!sema_analyse_attributes(context, decl, decl->attributes, domain, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), domain, erase_decl)) return decl_poison(decl);
 	return true;
 }
 
@@ -4610,13 +4676,13 @@ bool sema_analyse_var_decl(SemaContext *context, Decl *decl, bool local)
 	}
 	EXIT_OK:;
 	// Patch the external name for local consts and static variables.
-	if ((decl->var.kind == VARDECL_CONST || is_static) && !decl->extname && context->call_env.kind == CALL_ENV_FUNCTION)
+	if ((decl->var.kind == VARDECL_CONST || is_static) && !decl_extname(decl) && context->call_env.kind == CALL_ENV_FUNCTION)
 	{
 		scratch_buffer_clear();
 		scratch_buffer_append(context->call_env.current_function->name);
 		scratch_buffer_append_char('.');
 		scratch_buffer_append(decl->name);
-		decl->extname = scratch_buffer_copy();
+		decl_set_extname(decl, scratch_buffer_copy());
 	}
 	if (!decl->alignment)
 	{
@@ -4641,10 +4707,17 @@ static CompilationUnit *unit_copy(Module *module, CompilationUnit *unit)
 	copy->global_decls = copy_decl_list_single_for_unit(unit->global_decls);
 	copy->global_cond_decls = copy_decl_list_single_for_unit(unit->global_cond_decls);
 	copy->module = module;
+	copy->safe_mode = unit->safe_mode;
 	ASSERT(!unit->functions && !unit->macro_methods && !unit->methods && !unit->enums && !unit->ct_includes && !unit->types);
 	return copy;
 }
 
+static inline size_t sema_allocated_node_count(void)
+{
+	return ast_arena.allocated / sizeof(Ast) + expr_arena.allocated / sizeof(Expr)
+		+ decl_arena.allocated / sizeof(Decl) + type_info_arena.allocated / sizeof(TypeInfo);
+}
+
 static Module *module_instantiate_generic(SemaContext *context, Module *module, Path *path, Expr **params)
 {
 	unsigned decls = 0;
@@ -4923,15 +4996,20 @@ Decl *sema_analyse_parameterized_identifier(SemaContext *c, Path *decl_path, con
 			? c->unit->module->stage
 			: c->unit->module->stage - 1;
 	bool instatiation = false;
+	BenchTime instantiation_start;
 	if (!instantiated_module)
 	{
 		instatiation = true;
+		instantiation_start = benchstart();
+		size_t nodes = sema_allocated_node_count();
 		Path *path = CALLOCS(Path);
 		path->module = path_string;
 		path->span = module->name->span;
 		path->len = scratch_buffer.len;
 		instantiated_module = module_instantiate_generic(c, module, path, params);
 		if (!instantiated_module) return poisoned_decl;
+		module->generic_instances++;
+		module->generic_copied_nodes += sema_allocated_node_count() - nodes;
 		if (!sema_generate_parameterized_name_to_scratch(c, module, params, false, NULL)) return poisoned_decl;
 		instantiated_module->generic_suffix = scratch_buffer_copy();
 		sema_analyze_stage(instantiated_module, stage > ANALYSIS_POST_REGISTER ? ANALYSIS_POST_REGISTER : stage);
@@ -4957,6 +5035,7 @@ Decl *sema_analyse_parameterized_identifier(SemaContext *c, Path *decl_path, con
 		{
 			sema_analyze_stage(instantiated_module, stage);
 		}
+		module->generic_instantiation_time += benchmark(instantiation_start);
 	}
 
 	CompilationUnit *unit = symbol->unit;
@@ -4974,7 +5053,7 @@ Decl *sema_analyse_parameterized_identifier(SemaContext *c, Path *decl_path, con
 
 static inline bool sema_analyse_attribute_decl(SemaContext *context, SemaContext *c, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(c, decl, decl->attributes, ATTR_ALIAS, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(c, decl, decl_attributes(decl), ATTR_ALIAS, erase_decl)) return decl_poison(decl);
 	if (*erase_decl) return true;
 
 	Decl **params = decl->attr_decl.params;
@@ -4999,7 +5078,7 @@ static inline bool sema_analyse_attribute_decl(SemaContext *context, SemaContext
 
 static inline bool sema_analyse_alias(SemaContext *context, Decl *decl, bool *erase_decl)
 {
-	if (!sema_analyse_attributes(context, decl, decl->attributes, ATTR_ALIAS, erase_decl)) return decl_poison(decl);
+	if (!sema_analyse_attributes(context, decl, decl_attributes(decl), ATTR_ALIAS, erase_decl)) return decl_poison(decl);
 	if (*erase_decl) return true;
 
 	Expr *expr = decl->define_decl.alias_expr;
@@ -0,0 +1,614 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by a LGPLv3.0
+// a copy of which can be found in the LICENSE file.
+
+#include "sema_internal.h"
+
+// A local initialized with `mem::tnew(Type)` is moved to the stack when the
+// pointer never leaves the function: the variable may only be dereferenced,
+// e.g. `p.x = 1` or `*p = foo`, and the address of the pointee or anything
+// in it may not be taken. Anything else, including passing it to a function
+// or a macro, counts as an escape. The allocation is then replaced by a
+// local, zeroed or initialized with the value given to `tnew(Type, value)`,
+// which skips the temp allocator entirely.
+
+#define MAX_PROMOTED_SIZE 256
+
+static Decl **candidates;
+
+static void escape_expr(Expr *expr);
+static void escape_stmt(Ast *ast);
+static void escape_decl(Decl *decl);
+
+INLINE void escape_var(Decl *decl)
+{
+	FOREACH_IDX(i, Decl *, candidate, candidates)
+	{
+		if (candidate == decl) candidates[i] = NULL;
+	}
+}
+
+INLINE void escape_exprid(ExprId expr)
+{
+	if (expr) escape_expr(exprptr(expr));
+}
+
+INLINE void escape_astid(AstId astid)
+{
+	if (astid) escape_stmt(astptr(astid));
+}
+
+static void escape_expr_list(Expr **exprlist)
+{
+	FOREACH(Expr *, expr, exprlist) escape_expr(expr);
+}
+
+static void escape_stmt_chain(AstId astid)
+{
+	AstId current = astid;
+	while (current) escape_stmt(ast_next(&current));
+}
+
+/**
+ * Taking the address of something inside the pointee, e.g. `&p.x` or `p.arr[..]`,
+ * lets the pointer escape just as using it directly does.
+ */
+static void escape_address_of(Expr *expr)
+{
+	while (true)
+	{
+		switch (expr->expr_kind)
+		{
+			case EXPR_ACCESS_RESOLVED:
+			case EXPR_BITACCESS:
+				expr = expr->access_resolved_expr.parent;
+				continue;
+			case EXPR_SUBSCRIPT:
+			case EXPR_SUBSCRIPT_ADDR:
+				expr = exprptr(expr->subscript_expr.expr);
+				continue;
+			case EXPR_RVALUE:
+			case EXPR_RECAST:
+				expr = expr->inner_expr;
+				continue;
+			case EXPR_UNARY:
+				if (expr->unary_expr.operator != UNARYOP_DEREF) return;
+				expr = expr->unary_expr.expr;
+				if (expr->expr_kind == EXPR_IDENTIFIER) escape_var(expr->ident_expr);
+				return;
+			default:
+				return;
+		}
+	}
+}
+
+static void escape_asm_arg_list(ExprAsmArg **list)
+{
+	FOREACH(ExprAsmArg *, asm_arg, list)
+	{
+		switch (asm_arg->kind)
+		{
+			case ASM_ARG_REG:
+			case ASM_ARG_INT:
+				continue;
+			case ASM_ARG_ADDR:
+			case ASM_ARG_ADDROF:
+			case ASM_ARG_VALUE:
+				escape_exprid(asm_arg->expr_id);
+				continue;
+			case ASM_ARG_MEMVAR:
+			case ASM_ARG_REGVAR:
+				escape_var(asm_arg->ident.ident_decl);
+				continue;
+		}
+		UNREACHABLE
+	}
+}
+
+static void escape_stmt(Ast *ast)
+{
+	if (!ast) return;
+	switch (ast->ast_kind)
+	{
+		case AST_POISONED:
+		case CT_AST:
+		case AST_CONTRACT:
+		case AST_FOREACH_STMT:
+		case AST_CONTRACT_FAULT:
+			UNREACHABLE
+		case AST_ASM_STMT:
+			escape_expr_list(ast->asm_stmt.args);
+			return;
+		case AST_DEFER_STMT:
+			escape_astid(ast->defer_stmt.body);
+			return;
+		case AST_NOP_STMT:
+		case AST_ASM_LABEL:
+			return;
+		case AST_CT_COMPOUND_STMT:
+			escape_stmt_chain(ast->ct_compound_stmt);
+			return;
+		case AST_COMPOUND_STMT:
+			escape_stmt_chain(ast->compound_stmt.first_stmt);
+			return;
+		case AST_EXPR_STMT:
+			escape_expr(ast->expr_stmt);
+			return;
+		case AST_DECLARE_STMT:
+			escape_decl(ast->declare_stmt);
+			return;
+		case AST_RETURN_STMT:
+		case AST_BLOCK_EXIT_STMT:
+			escape_expr(ast->return_stmt.expr);
+			escape_stmt_chain(ast->return_stmt.cleanup);
+			if (ast->return_stmt.cleanup != ast->return_stmt.cleanup_fail)
+			{
+				escape_stmt_chain(ast->return_stmt.cleanup_fail);
+			}
+			return;
+		case AST_ASM_BLOCK_STMT:
+			if (ast->asm_block_stmt.is_string)
+			{
+				escape_exprid(ast->asm_block_stmt.asm_string);
+				return;
+			}
+			escape_stmt_chain(ast->asm_block_stmt.block->asm_stmt);
+			escape_asm_arg_list(ast->asm_block_stmt.block->input);
+			escape_asm_arg_list(ast->asm_block_stmt.block->output_vars);
+			return;
+		case AST_ASSERT_STMT:
+			escape_exprid(ast->assert_stmt.expr);
+			escape_exprid(ast->assert_stmt.message);
+			escape_expr_list(ast->assert_stmt.args);
+			return;
+		case AST_DECLS_STMT:
+		{
+			FOREACH(Decl *, decl, ast->decls_stmt) escape_decl(decl);
+			return;
+		}
+		case AST_FOR_STMT:
+			escape_exprid(ast->for_stmt.cond);
+			escape_exprid(ast->for_stmt.init);
+			escape_exprid(ast->for_stmt.incr);
+			escape_astid(ast->for_stmt.body);
+			return;
+		case AST_IF_STMT:
+			escape_exprid(ast->if_stmt.cond);
+			escape_astid(ast->if_stmt.then_body);
+			escape_astid(ast->if_stmt.else_body);
+			return;
+		case AST_SWITCH_STMT:
+			escape_exprid(ast->switch_stmt.cond);
+			{
+				FOREACH(Ast *, casestm, ast->switch_stmt.cases) escape_stmt(casestm);
+			}
+			return;
+		case AST_CASE_STMT:
+			escape_exprid(ast->case_stmt.expr);
+			escape_exprid(ast->case_stmt.to_expr);
+			escape_stmt(ast->case_stmt.body);
+			return;
+		case AST_DEFAULT_STMT:
+			escape_stmt(ast->case_stmt.body);
+			return;
+		case AST_NEXTCASE_STMT:
+			escape_stmt_chain(ast->nextcase_stmt.defer_id);
+			escape_expr(ast->nextcase_stmt.switch_expr);
+			return;
+		case AST_BREAK_STMT:
+		case AST_CONTINUE_STMT:
+			escape_stmt_chain(ast->contbreak_stmt.defers);
+			return;
+	}
+	UNREACHABLE
+}
+
+static void escape_const_initializer(ConstInitializer *const_init)
+{
+	if (!const_init) return;
+	switch (const_init->kind)
+	{
+		case CONST_INIT_ZERO:
+		case CONST_INIT_ARRAY_BYTES:
+			return;
+		case CONST_INIT_ARRAY_VALUE:
+			escape_const_initializer(const_init->init_array_value.element);
+			return;
+		case CONST_INIT_ARRAY_FULL:
+		{
+			ArraySize size = const_init->type->array.len;
+			for (ArrayIndex i = 0; i < (ArrayIndex)size; i++)
+			{
+				escape_const_initializer(const_init->init_array_full[i]);
+			}
+			return;
+		}
+		case CONST_INIT_ARRAY:
+		{
+			FOREACH(ConstInitializer *, i, const_init->init_array.elements) escape_const_initializer(i);
+			return;
+		}
+		case CONST_INIT_UNION:
+			escape_const_initializer(const_init->init_union.element);
+			return;
+		case CONST_INIT_STRUCT:
+		{
+			Decl *decl = const_init->type->decl;
+			uint32_t count = vec_size(decl->strukt.members);
+			if (decl->decl_kind == DECL_UNION && count) count = 1;
+			for (ArrayIndex i = 0; i < count; i++)
+			{
+				escape_const_initializer(const_init->init_struct[i]);
+			}
+			return;
+		}
+		case CONST_INIT_VALUE:
+			escape_expr(const_init->init_value);
+			return;
+	}
+	UNREACHABLE
+}
+
+static void escape_expr(Expr *expr)
+{
+RETRY:
+	if (!expr) return;
+	switch (expr->expr_kind)
+	{
+		case NON_RUNTIME_EXPR:
+		case EXPR_SUBSCRIPT_ASSIGN:
+		case EXPR_OPERATOR_CHARS:
+		case EXPR_MEMBER_GET:
+		case EXPR_NAMED_ARGUMENT:
+		case EXPR_LAMBDA:
+		case UNRESOLVED_EXPRS:
+			UNREACHABLE
+		case EXPR_TWO:
+			escape_expr(expr->two_expr.first);
+			expr = expr->two_expr.last;
+			goto RETRY;
+		case EXPR_DESIGNATOR:
+			expr = expr->designator_expr.value;
+			goto RETRY;
+		case EXPR_BUILTIN:
+		case EXPR_NOP:
+		case EXPR_RETVAL:
+		case EXPR_BENCHMARK_HOOK:
+		case EXPR_TEST_HOOK:
+		case EXPR_LAST_FAULT:
+			return;
+		case EXPR_MAKE_SLICE:
+			expr = expr->make_slice_expr.ptr;
+			goto RETRY;
+		case EXPR_MAKE_ANY:
+			escape_expr(expr->make_any_expr.typeid);
+			expr = expr->make_any_expr.inner;
+			goto RETRY;
+		case EXPR_ACCESS_RESOLVED:
+		case EXPR_BITACCESS:
+			expr = expr->access_resolved_expr.parent;
+			goto RETRY;
+		case EXPR_ASM:
+			switch (expr->expr_asm_arg.kind)
+			{
+				case ASM_ARG_REG:
+				case ASM_ARG_INT:
+					return;
+				case ASM_ARG_ADDROF:
+				case ASM_ARG_REGVAR:
+				case ASM_ARG_MEMVAR:
+					escape_var(expr->expr_asm_arg.ident.ident_decl);
+					return;
+				case ASM_ARG_VALUE:
+				case ASM_ARG_ADDR:
+					escape_exprid(expr->expr_asm_arg.expr_id);
+					return;
+			}
+			UNREACHABLE
+		case EXPR_BINARY:
+		case EXPR_BITASSIGN:
+			escape_exprid(expr->binary_expr.left);
+			escape_exprid(expr->binary_expr.right);
+			return;
+		case EXPR_CALL:
+			escape_expr_list(expr->call_expr.arguments);
+			if (expr->call_expr.varargs)
+			{
+				if (expr->call_expr.va_is_splat)
+				{
+					escape_expr(expr->call_expr.vasplat);
+				}
+				else
+				{
+					escape_expr_list(expr->call_expr.varargs);
+				}
+			}
+			if (expr->call_expr.is_builtin) return;
+			if (!expr->call_expr.is_func_ref)
+			{
+				escape_exprid(expr->call_expr.function);
+				return;
+			}
+			escape_stmt_chain(expr->call_expr.function_contracts);
+			return;
+		case EXPR_FORCE_UNWRAP:
+		case EXPR_RETHROW:
+		case EXPR_OPTIONAL:
+		case EXPR_VECTOR_TO_ARRAY:
+		case EXPR_SLICE_TO_VEC_ARRAY:
+		case EXPR_SCALAR_TO_VECTOR:
+		case EXPR_PTR_ACCESS:
+		case EXPR_ENUM_FROM_ORD:
+		case EXPR_FLOAT_TO_INT:
+		case EXPR_INT_TO_FLOAT:
+		case EXPR_INT_TO_PTR:
+		case EXPR_PTR_TO_INT:
+		case EXPR_SLICE_LEN:
+		case EXPR_VECTOR_FROM_ARRAY:
+		case EXPR_RVALUE:
+		case EXPR_RECAST:
+		case EXPR_DISCARD:
+		case EXPR_ADDR_CONVERSION:
+			expr = expr->inner_expr;
+			goto RETRY;
+		case EXPR_DEFAULT_ARG:
+			expr = expr->default_arg_expr.inner;
+			goto RETRY;
+		case EXPR_BUILTIN_ACCESS:
+			expr = exprptr(expr->builtin_access_expr.inner);
+			goto RETRY;
+		case EXPR_CATCH:
+			if (expr->catch_expr.decl) escape_decl(expr->catch_expr.decl);
+			escape_expr_list(expr->catch_expr.exprs);
+			return;
+		case EXPR_CONST:
+			switch (expr->const_expr.const_kind)
+			{
+				case CONST_SLICE:
+					escape_const_initializer(expr->const_expr.slice_init);
+					return;
+				case CONST_INITIALIZER:
+					escape_const_initializer(expr->const_expr.initializer);
+					return;
+				default:
+					return;
+			}
+		case EXPR_COND:
+			escape_expr_list(expr->cond_expr);
+			return;
+		case EXPR_DECL:
+			escape_decl(expr->decl_expr);
+			return;
+		case EXPR_EXPRESSION_LIST:
+			escape_expr_list(expr->expression_list);
+			return;
+		case EXPR_DESIGNATED_INITIALIZER_LIST:
+			escape_expr_list(expr->designated_init_list);
+			return;
+		case EXPR_IDENTIFIER:
+			escape_var(expr->ident_expr);
+			return;
+		case EXPR_INITIALIZER_LIST:
+			escape_expr_list(expr->initializer_list);
+			return;
+		case EXPR_MACRO_BLOCK:
+		{
+			FOREACH(Decl *, val, expr->macro_block.params) escape_decl(val);
+			escape_stmt_chain(expr->macro_block.first_stmt);
+			return;
+		}
+		case EXPR_MACRO_BODY_EXPANSION:
+		{
+			FOREACH(Decl *, arg, expr->body_expansion_expr.declarations) escape_decl(arg);
+			escape_expr_list(expr->body_expansion_expr.values);
+			escape_astid(expr->body_expansion_expr.first_stmt);
+			return;
+		}
+		case EXPR_POINTER_OFFSET:
+			escape_exprid(expr->pointer_offset_expr.ptr);
+			expr = exprptr(expr->pointer_offset_expr.offset);
+			goto RETRY;
+		case EXPR_UNARY:
+			switch (expr->unary_expr.operator)
+			{
+				case UNARYOP_DEREF:
+					// Using the pointee is fine.
+					if (expr->unary_expr.expr->expr_kind == EXPR_IDENTIFIER) return;
+					break;
+				case UNARYOP_ADDR:
+					escape_address_of(expr->unary_expr.expr);
+					break;
+				default:
+					break;
+			}
+			expr = expr->unary_expr.expr;
+			goto RETRY;
+		case EXPR_POST_UNARY:
+			expr = expr->unary_expr.expr;
+			goto RETRY;
+		case EXPR_SLICE_ASSIGN:
+		case EXPR_SLICE_COPY:
+			escape_exprid(expr->slice_assign_expr.left);
+			escape_exprid(expr->slice_assign_expr.right);
+			return;
+		case EXPR_SLICE:
+			escape_address_of(exprptr(expr->slice_expr.expr));
+			escape_exprid(expr->slice_expr.expr);
+			switch (expr->slice_expr.range.range_type)
+			{
+				case RANGE_CONST_RANGE:
+					return;
+				case RANGE_DYNAMIC:
+					escape_exprid(expr->slice_expr.range.start);
+					escape_exprid(expr->slice_expr.range.end);
+					return;
+				case RANGE_CONST_END:
+				case RANGE_CONST_LEN:
+					escape_exprid(expr->slice_expr.range.start);
+					return;
+			}
+			UNREACHABLE
+		case EXPR_SUBSCRIPT_ADDR:
+			escape_address_of(exprptr(expr->subscript_expr.expr));
+			FALLTHROUGH;
+		case EXPR_SUBSCRIPT:
+			escape_exprid(expr->subscript_expr.expr);
+			escape_exprid(expr->subscript_expr.index.expr);
+			return;
+		case EXPR_SWIZZLE:
+			escape_exprid(expr->swizzle_expr.parent);
+			return;
+		case EXPR_TERNARY:
+			escape_exprid(expr->ternary_expr.cond);
+			escape_exprid(expr->ternary_expr.then_expr);
+			escape_exprid(expr->ternary_expr.else_expr);
+			return;
+		case EXPR_TYPEID_INFO:
+			escape_exprid(expr->typeid_info_expr.parent);
+			return;
+		case EXPR_TRY:
+			escape_expr(expr->try_expr.optional);
+			if (expr->try_expr.assign_existing)
+			{
+				escape_expr(expr->try_expr.lhs);
+			}
+			else
+			{
+				escape_decl(expr->try_expr.decl);
+			}
+			return;
+		case EXPR_TRY_UNWRAP_CHAIN:
+			escape_expr_list(expr->try_unwrap_chain_expr);
+			return;
+		case EXPR_INT_TO_BOOL:
+			escape_expr(expr->int_to_bool_expr.inner);
+			return;
+		case EXPR_EXT_TRUNC:
+			escape_expr(expr->ext_trunc_expr.inner);
+			return;
+	}
+	UNREACHABLE
+}
+
+/**
+ * Find the value stored by the `*val = value` of a `tnew(Type, value)` expansion.
+ *
+ * @return false if the expansion allocates without storing a value we can find.
+ */
+static bool escape_temp_new_value(AstId astid, bool *allocates, Expr **value_ref)
+{
+	AstId current = astid;
+	while (current)
+	{
+		Ast *ast = ast_next(&current);
+		switch (ast->ast_kind)
+		{
+			case AST_CT_COMPOUND_STMT:
+				if (!escape_temp_new_value(ast->ct_compound_stmt, allocates, value_ref)) return false;
+				continue;
+			case AST_COMPOUND_STMT:
+				if (!escape_temp_new_value(ast->compound_stmt.first_stmt, allocates, value_ref)) return false;
+				continue;
+			case AST_DECLARE_STMT:
+				*allocates = true;
+				continue;
+			case AST_EXPR_STMT:
+			{
+				Expr *expr = ast->expr_stmt;
+				if (expr->expr_kind != EXPR_BINARY || expr->binary_expr.operator != BINARYOP_ASSIGN) return false;
+				Expr *left = exprptr(expr->binary_expr.left);
+				if (left->expr_kind != EXPR_UNARY || left->unary_expr.operator != UNARYOP_DEREF) return false;
+				*value_ref = exprptr(expr->binary_expr.right);
+				continue;
+			}
+			default:
+				continue;
+		}
+	}
+	return !*allocates || *value_ref;
+}
+
+static bool escape_is_temp_new(Decl *decl)
+{
+	if (decl->var.kind != VARDECL_LOCAL || decl->var.is_static || decl->var.is_threadlocal) return false;
+	// Any address taken of the variable itself is found by the walk.
+	if (decl->var.is_written || decl->var.is_addr) return false;
+	Expr *init = decl->var.init_expr;
+	if (!init || init->expr_kind != EXPR_MACRO_BLOCK) return false;
+	Decl *macro = init->macro_block.macro;
+	if (macro->name != kw_tnew || macro->unit->module->name->module != kw_std__core__mem) return false;
+	FOREACH(Decl *, param, init->macro_block.params)
+	{
+		if (param && !decl_var_kind_is_ct(param->var.kind)) return false;
+	}
+	bool allocates = false;
+	Expr *value = NULL;
+	if (!escape_temp_new_value(init->macro_block.first_stmt, &allocates, &value)) return false;
+	Type *type = init->type->canonical;
+	if (type->type_kind != TYPE_POINTER || decl->type->canonical != type) return false;
+	return type_size(type->pointer) <= MAX_PROMOTED_SIZE;
+}
+
+static void escape_decl(Decl *decl)
+{
+	if (!decl || decl->decl_kind != DECL_VAR) return;
+	switch (decl->var.kind)
+	{
+		case VARDECL_PARAM_CT:
+		case VARDECL_PARAM_CT_TYPE:
+		case VARDECL_LOCAL_CT:
+		case VARDECL_LOCAL_CT_TYPE:
+		case VARDECL_REWRAPPED:
+		case VARDECL_UNWRAPPED:
+		case VARDECL_PARAM_EXPR:
+			return;
+		case VARDECL_PARAM:
+			if (decl->var.init_expr && decl->var.init_expr->resolve_status == RESOLVE_DONE)
+			{
+				escape_expr(decl->var.init_expr);
+			}
+			return;
+		default:
+			// The value given to `tnew(Type, value)` may itself escape.
+			escape_expr(decl->var.init_expr);
+			if (escape_is_temp_new(decl)) vec_add(candidates, decl);
+			return;
+	}
+}
+
+/**
+ * Replace `mem::tnew(Type)` with the address of a new zeroed local, and
+ * `mem::tnew(Type, value)` with the address of a local holding the value.
+ */
+static void escape_promote_to_stack(Decl *decl)
+{
+	Expr *init = decl->var.init_expr;
+	Type *type = init->type->canonical->pointer;
+	bool allocates = false;
+	Expr *value = NULL;
+	escape_temp_new_value(init->macro_block.first_stmt, &allocates, &value);
+	Decl *temp = decl_new_generated_var(type, VARDECL_LOCAL, init->span);
+	Expr *temp_decl = expr_generate_decl(temp, value);
+	temp->var.no_init = false;
+	temp_decl->resolve_status = RESOLVE_DONE;
+	temp_decl->type = type;
+	Expr *addr = expr_variable(temp);
+	addr->type = type;
+	expr_insert_addr(addr);
+	Type *ptr_type = init->type;
+	init->expr_kind = EXPR_TWO;
+	init->two_expr.first = temp_decl;
+	init->two_expr.last = addr;
+	init->type = ptr_type;
+}
+
+void sema_promote_temp_allocations(Decl *func)
+{
+	vec_resize(candidates, 0);
+	FOREACH(Decl *, param, func->func_decl.signature.params) escape_decl(param);
+	escape_astid(func->func_decl.body);
+	FOREACH(Decl *, decl, candidates)
+	{
+		if (decl) escape_promote_to_stack(decl);
+	}
+}
@@ -826,6 +826,7 @@ bool sema_expr_check_assign(SemaContext *context, Expr *expr, bool *failed_ref)
 	if (expr->expr_kind == EXPR_IDENTIFIER)
 	{
 		expr->ident_expr->var.is_written = true;
+		sema_var_assigned(expr->ident_expr);
 	}
 	if (expr->expr_kind != EXPR_UNARY) return true;
 	inner = expr->inner_expr;
@@ -1485,7 +1486,7 @@ INLINE bool sema_set_default_argument(SemaContext *context, CalledDecl *callee,
 		bool success;
 		SCOPE_START
 			new_context->original_inline_line = context->original_inline_line ? context->original_inline_line
-																			  : call->span.row;
+																			  : span_row(call->span);
 			new_context->original_module = context->original_module;
 			success = sema_analyse_parameter(new_context, arg, param, callee->definition, optional, no_match_ref,
 											 callee->macro, false);
@@ -2142,7 +2143,7 @@ static inline bool sema_call_analyse_func_invocation(SemaContext *context, Decl
 	}
 	expr->call_expr.function_contracts = 0;
 	AstId docs = decl->func_decl.docs;
-	if (!safe_mode_enabled() || !sema_has_require(docs)) goto SKIP_CONTRACTS;
+	if (!safe_mode_enabled_in(context->call_env.current_function) || !sema_has_require(docs)) goto SKIP_CONTRACTS;
 	SemaContext temp_context;
 	bool success = false;
 	if (!sema_expr_setup_call_analysis(context, &callee, &temp_context,
@@ -2391,7 +2392,7 @@ static inline bool sema_expr_setup_call_analysis(SemaContext *context, CalledDec
 		expr->expr_other_context.context = context;
 	}
 	macro_context->macro_varargs = callee->macro ? call_expr->call_expr.varargs : NULL;
-	macro_context->original_inline_line = context->original_inline_line ? context->original_inline_line : call_expr->span.row;
+	macro_context->original_inline_line = context->original_inline_line ? context->original_inline_line : span_row(call_expr->span);
 	macro_context->original_module = context->original_module ? context->original_module : context->compilation_unit->module;
 	macro_context->macro_params = params;
 
@@ -2402,6 +2403,112 @@ static inline bool sema_expr_setup_call_analysis(SemaContext *context, CalledDec
 
 	return true;
 }
+/**
+ * A macro taking only compile time arguments, without varargs or a trailing body,
+ * may have its folded result reused for the same arguments.
+ */
+static inline bool sema_macro_may_memoize(Decl *decl, Expr *call_expr)
+{
+	Signature *sig = &decl->func_decl.signature;
+	if (sig->variadic != VARIADIC_NONE || decl->func_decl.body_param) return false;
+	if (call_expr->call_expr.macro_body || call_expr->call_expr.is_outer_call) return false;
+	FOREACH(Decl *, param, sig->params)
+	{
+		if (!param) return false;
+		if (param->var.kind != VARDECL_PARAM_CT && param->var.kind != VARDECL_PARAM_CT_TYPE) return false;
+	}
+	return true;
+}
+
+static bool sema_macro_memo_arg_match(Expr *arg, Expr *other)
+{
+	if (arg->type != other->type) return false;
+	const ExprConst *left = &arg->const_expr;
+	const ExprConst *right = &other->const_expr;
+	if (left->const_kind != right->const_kind) return false;
+	switch (left->const_kind)
+	{
+		case CONST_FLOAT:
+			return left->fxx.type == right->fxx.type && !memcmp(&left->fxx.f, &right->fxx.f, sizeof(Real));
+		case CONST_INTEGER:
+			return left->ixx.type == right->ixx.type && left->ixx.i.high == right->ixx.i.high && left->ixx.i.low == right->ixx.i.low;
+		case CONST_BOOL:
+			return left->b == right->b;
+		case CONST_ENUM:
+			return left->enum_val == right->enum_val;
+		case CONST_FAULT:
+			return left->fault == right->fault;
+		case CONST_POINTER:
+			return left->ptr == right->ptr;
+		case CONST_TYPEID:
+			return left->typeid == right->typeid;
+		case CONST_BYTES:
+		case CONST_STRING:
+			return left->bytes.len == right->bytes.len && !memcmp(left->bytes.ptr, right->bytes.ptr, left->bytes.len);
+		default:
+			return false;
+	}
+}
+
+static inline bool sema_macro_memo_args_supported(Expr **args)
+{
+	FOREACH(Expr *, arg, args)
+	{
+		if (arg->expr_kind != EXPR_CONST) return false;
+		switch (arg->const_expr.const_kind)
+		{
+			case CONST_SLICE:
+			case CONST_INITIALIZER:
+			case CONST_UNTYPED_LIST:
+			case CONST_REF:
+			case CONST_MEMBER:
+				return false;
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+static Expr *sema_macro_memo_find(Decl *decl, Expr **args)
+{
+	unsigned count = vec_size(args);
+	for (MacroMemo *memo = htable_get(&compiler.context.macro_memos, decl); memo; memo = memo->next)
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (!sema_macro_memo_arg_match(args[i], memo->args[i])) goto NEXT;
+		}
+		return memo->result;
+NEXT:;
+	}
+	return NULL;
+}
+
+static Expr **sema_macro_memo_key(Expr **args)
+{
+	Expr **key = VECNEW(Expr*, vec_size(args));
+	FOREACH(Expr *, arg, args) vec_add(key, copy_expr_single(arg));
+	return key;
+}
+
+static void sema_macro_memo_add(Decl *decl, Expr **key, Expr *result)
+{
+	MacroMemo *first = htable_get(&compiler.context.macro_memos, decl);
+	MacroMemo **next_ref = &first;
+	unsigned count = 0;
+	while (*next_ref)
+	{
+		if (++count == MAX_MACRO_MEMOS) return;
+		next_ref = &(*next_ref)->next;
+	}
+	MacroMemo *memo = CALLOCS(MacroMemo);
+	memo->args = key;
+	memo->result = copy_expr_single(result);
+	*next_ref = memo;
+	if (memo == first) htable_set(&compiler.context.macro_memos, decl, memo);
+}
+
 bool sema_expr_analyse_macro_call(SemaContext *context, Expr *call_expr, Expr *struct_var, Decl *decl,
 								  bool call_var_optional, bool *no_match_ref)
 {
@@ -2418,11 +2525,17 @@ bool sema_expr_analyse_macro_call(SemaContext *context, Expr *call_expr, Expr *s
 
 	sema_display_deprecated_warning_on_use(decl, call_expr->span);
 
+	// When the result may be memoized, the body is only copied if no result is found.
+	bool may_memoize = sema_macro_may_memoize(decl, call_expr);
+	Ast *body = NULL;
+	AstId docs = decl->func_decl.docs;
 	copy_begin();
 	Decl **params = copy_decl_list_macro(decl->func_decl.signature.params);
-	Ast *body = copy_ast_macro(astptr(decl->func_decl.body));
-	AstId docs = decl->func_decl.docs;
-	if (docs) docs = astid(copy_ast_macro(astptr(docs)));
+	if (!may_memoize)
+	{
+		body = copy_ast_macro(astptr(decl->func_decl.body));
+		if (docs) docs = astid(copy_ast_macro(astptr(docs)));
+	}
 	Signature *sig = &decl->func_decl.signature;
 	copy_end();
 	CalledDecl callee = {
@@ -2441,6 +2554,31 @@ bool sema_expr_analyse_macro_call(SemaContext *context, Expr *call_expr, Expr *s
 
 	unsigned vararg_index = sig->vararg_index;
 	Expr **args = call_expr->call_expr.arguments;
+	unsigned call_site_evals = compiler.context.call_site_evals;
+	unsigned warnings_found = compiler.context.warnings_found;
+	Expr **memo_key = NULL;
+	if (may_memoize)
+	{
+		if (sema_macro_memo_args_supported(args))
+		{
+			Expr *result = sema_macro_memo_find(decl, args);
+			if (result)
+			{
+				expr_replace(call_expr, copy_expr_single(result));
+				return true;
+			}
+			memo_key = sema_macro_memo_key(args);
+		}
+		// Copy the parameters again together with the body, so that the body refers to them.
+		Decl **evaluated_params = params;
+		copy_begin();
+		params = copy_decl_list_macro(decl->func_decl.signature.params);
+		body = copy_ast_macro(astptr(decl->func_decl.body));
+		if (docs) docs = astid(copy_ast_macro(astptr(docs)));
+		copy_end();
+		FOREACH_IDX(i, Decl *, param, params) param->type = evaluated_params[i]->type;
+		callee.params = params;
+	}
 	FOREACH_IDX(i, Decl *, param, params)
 	{
 		if (i == vararg_index)
@@ -2756,6 +2894,11 @@ bool sema_expr_analyse_macro_call(SemaContext *context, Expr *call_expr, Expr *s
 		}
 		if (ast_is_compile_time(body))
 		{
+			if (memo_key && expr_is_const(result) && call_site_evals == compiler.context.call_site_evals
+				&& warnings_found == compiler.context.warnings_found)
+			{
+				sema_macro_memo_add(decl, memo_key, result);
+			}
 			expr_replace(call_expr, result);
 			goto EXIT;
 		}
@@ -2770,6 +2913,10 @@ NOT_CT:
 	call_expr->macro_block.params = params;
 	call_expr->macro_block.block_exit = block_exit_ref;
 	call_expr->macro_block.is_noreturn = is_no_return;
+	if (decl->name == kw_tnew && decl->unit->module->name->module == kw_std__core__mem && context->call_env.current_function)
+	{
+		context->call_env.current_function->func_decl.has_temp_new = true;
+	}
 EXIT:
 	if (is_outer && !type_is_void(call_expr->type))
 	{
@@ -3099,7 +3246,7 @@ static inline bool sema_expr_analyse_typecall(SemaContext *context, Expr *expr)
 	const char *tagname = key->const_expr.bytes.ptr;
 	if (!decl) goto NOT_FOUND;
 	ASSERT_SPAN(expr, decl->resolved_attributes);
-	ResolvedAttrData *attrs = decl->attrs_resolved;
+	ResolvedAttrData *attrs = decl_attrs_resolved(decl);
 	if (!attrs || !attrs->tags) goto NOT_FOUND;
 	Expr *value = NULL;
 	FOREACH(Attr *, attr, attrs->tags)
@@ -3634,6 +3781,7 @@ static inline bool sema_expr_analyse_subscript_lvalue(SemaContext *context, Expr
 
 	expr->subscript_expr.expr = exprid(current_expr);
 	expr->type = type_add_optional(subscript_type, optional);
+	sema_loop_range_add_subscript(expr, current_expr, index);
 	return true;
 VALID_FAIL_POISON:
 	expr_poison(expr);
@@ -3794,6 +3942,7 @@ static inline bool sema_expr_analyse_subscript(SemaContext *context, Expr *expr,
 	{
 		expr->type = type_add_optional(subscript_type, optional);
 	}
+	sema_loop_range_add_subscript(expr, current_expr, index);
 	return true;
 VALID_FAIL_POISON:
 	expr_poison(expr);
@@ -4056,6 +4205,9 @@ static inline void sema_slice_initializer(Expr *expr, Expr *subscripted, Range *
 			vec_erase_front(initializer->init_array_full, range->start_index);
 			vec_resize(initializer->init_array_full, range->len_index);
 			break;
+		case CONST_INIT_ARRAY_BYTES:
+			initializer->init_array_bytes += range->start_index * type_size(inner_type->array.base);
+			break;
 		case CONST_INIT_ARRAY:
 		{
 			unsigned elements = vec_size(initializer->init_array.elements);
@@ -5097,6 +5249,9 @@ static inline bool sema_expr_fold_to_index(Expr *expr, Expr *parent, SubscriptIn
 		case CONST_INIT_ARRAY_FULL:
 			result = init->init_array_full[index];
 			break;
+		case CONST_INIT_ARRAY_BYTES:
+			const_init_bytes_rewrite_expr_at(init, index, expr);
+			return true;
 	}
 	switch (result->kind)
 	{
@@ -5105,6 +5260,7 @@ static inline bool sema_expr_fold_to_index(Expr *expr, Expr *parent, SubscriptIn
 			break;
 		case CONST_INIT_ARRAY:
 		case CONST_INIT_ARRAY_FULL:
+		case CONST_INIT_ARRAY_BYTES:
 		case CONST_INIT_STRUCT:
 		case CONST_INIT_UNION:
 			expr->expr_kind = EXPR_CONST;
@@ -5149,6 +5305,7 @@ static inline bool sema_expr_fold_to_member(Expr *expr, Expr *parent, Decl *memb
 		case CONST_INIT_VALUE:
 		case CONST_INIT_ARRAY:
 		case CONST_INIT_ARRAY_FULL:
+		case CONST_INIT_ARRAY_BYTES:
 		case CONST_INIT_ARRAY_VALUE:
 			UNREACHABLE
 	}
@@ -5164,6 +5321,7 @@ EVAL:
 		case CONST_INIT_UNION:
 		case CONST_INIT_ARRAY:
 		case CONST_INIT_ARRAY_FULL:
+		case CONST_INIT_ARRAY_BYTES:
 			expr->expr_kind = EXPR_CONST;
 			expr->const_expr.const_kind = CONST_INITIALIZER;
 			expr->const_expr.initializer = result;
@@ -8020,6 +8178,7 @@ RETRY:;
 			}
 			if (!sema_analyse_expr_address(context, inner)) return false;
 			expr_replace(expr, inner);
+			sema_loop_range_move_subscript(inner, expr);
 			return true;
 		case EXPR_ACCESS_RESOLVED:
 		case EXPR_ACCESS_UNRESOLVED:
@@ -8051,6 +8210,7 @@ RESOLVED:
 		}
 		RETURN_SEMA_ERROR(inner, error);
 	}
+	if (inner->expr_kind == EXPR_IDENTIFIER) sema_var_ref_taken(inner->ident_expr);
 
 	// 3. Get the pointer of the underlying type.
 	if (inner->type->type_kind == TYPE_FUNC_RAW)
@@ -8858,6 +9018,8 @@ static inline bool sema_expr_analyse_compiler_const(SemaContext *context, Expr *
 {
 	const char *string = expr->builtin_expr.ident;
 	BuiltinDefine def = BUILTIN_DEF_NONE;
+	// These depend on where a macro was expanded, so they prevent memoizing it.
+	compiler.context.call_site_evals++;
 	for (unsigned i = 0; i < NUMBER_OF_BUILTIN_DEFINES; i++)
 	{
 		if (string == builtin_defines[i])
@@ -8907,11 +9069,11 @@ static inline bool sema_expr_analyse_compiler_const(SemaContext *context, Expr *
 			}
 			else
 			{
-				expr_rewrite_const_int(expr, type_isz, expr->span.row);
+				expr_rewrite_const_int(expr, type_isz, span_row(expr->span));
 			}
 			return true;
 		case BUILTIN_DEF_LINE_RAW:
-			expr_rewrite_const_int(expr, type_isz, expr->span.row);
+			expr_rewrite_const_int(expr, type_isz, span_row(expr->span));
 			return true;
 		case BUILTIN_DEF_FUNCTION:
 			switch (context->call_env.kind)
@@ -9597,7 +9759,23 @@ static inline bool sema_expr_analyse_embed(SemaContext *context, Expr *expr, boo
 	{
 		string = file_append_path(path, string);
 	}
-	char *content = file_read_binary(string, &len);
+	compiler_add_input_file(string);
+	size_t mapped_size;
+	const char *content = file_map_read_only(string, &mapped_size);
+	if (content && mapped_size >= EMBED_INCBIN_MIN_SIZE)
+	{
+		// Large files are mapped, and the backend can reference the file instead of copying it.
+		if (mapped_size < len) len = mapped_size;
+		// The assembler may not resolve relative paths the way we do, so store it absolute.
+		const char *full_path = realpath(string, NULL);
+		EmbedFile embed = { .data = content, .len = len, .path = full_path ? full_path : string, .hash = fnv1a_64(content, len, FNV1_64_SEED) };
+		vec_add(compiler.context.embeds, embed);
+	}
+	else
+	{
+		if (content) file_unmap(content, mapped_size);
+		content = file_read_binary(string, &len);
+	}
 	if (!content)
 	{
 		if (!allow_fail) RETURN_SEMA_ERROR(expr, "Failed to load '%s'.", string);
@@ -9737,7 +9915,7 @@ static inline bool sema_expr_analyse_lambda(SemaContext *context, Type *target_t
 	scratch_buffer_append("$lambda");
 	scratch_buffer_append_unsigned_int(++unit->lambda_count);
 	decl->name = scratch_buffer_copy();
-	decl->extname = decl->name;
+	decl_set_extname(decl, decl->name);
 	decl->type = type_new_func(decl, sig);
 	if (!sema_analyse_function_signature(context, decl, NULL, sig->abi, sig)) return false;
 	if (flat && flat->pointer->function.prototype->raw_type != decl->type->function.prototype->raw_type)
@@ -9752,6 +9930,13 @@ static inline bool sema_expr_analyse_lambda(SemaContext *context, Type *target_t
 	{
 		decl->func_decl.in_macro = true;
 	}
+	// A lambda is as safe as the function it is written in.
+	Decl *outer = context->call_env.current_function;
+	if (outer && outer->decl_kind == DECL_FUNC && outer->func_decl.safety_override)
+	{
+		decl->func_decl.safety_override = true;
+		decl->func_decl.safe_mode = outer->func_decl.safe_mode;
+	}
 	decl->alignment = type_alloca_alignment(decl->type);
 	// We will actually compile this into any module using it (from a macro) by necessity,
 	// so we'll declare it as weak and externally visible.
@@ -9822,6 +10007,8 @@ static inline bool sema_expr_analyse_ct_defined(SemaContext *context, Expr *expr
 
 	Expr **list = expr->expression_list;
 
+	// The answer may change as more declarations are added, so don't memoize the macro.
+	compiler.context.call_site_evals++;
 	bool success = true;
 	bool failed = false;
 	unsigned list_len = vec_size(list);
@@ -11207,14 +11394,12 @@ TokenType sema_splitpathref(const char *string, ArraySize len, Path **path_ref,
 		string++;
 	}
 	if (len == 0) return TOKEN_INVALID_TOKEN;
-	uint32_t hash = FNV1_SEED;
 	size_t start = 0;
 	switch (string[0])
 	{
 		case '@':
 		case '$':
 		case '#':
-			hash = FNV1a(string[0], hash);
 			start = 1;
 			break;
 		default:
@@ -11225,10 +11410,9 @@ TokenType sema_splitpathref(const char *string, ArraySize len, Path **path_ref,
 	{
 		char c = string[i];
 		if (!char_is_alphanum_(c)) return TOKEN_INVALID_TOKEN;
-		hash = FNV1a(c, hash);
 	}
 	TokenType type = TOKEN_INVALID_TOKEN;
-	*ident_ref = symtab_find(string, len, hash, &type);
+	*ident_ref = symtab_find(string, len, symtab_hash(string, (uint32_t)len), &type);
 	if (!*ident_ref) return TOKEN_IDENT;
 	switch (type)
 	{
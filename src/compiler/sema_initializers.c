@@ -4,6 +4,8 @@
 
 #include "sema_internal.h"
 
+#define CONST_INIT_PACK_MIN_ELEMENTS 32
+
 static inline bool sema_expr_analyse_struct_plain_initializer(SemaContext *context, Decl *assigned, Expr *initializer);
 static inline bool sema_expr_analyse_array_plain_initializer(SemaContext *context, Type *assigned, Type *flattened,
 															 Expr *initializer);
@@ -66,6 +68,8 @@ bool const_init_local_init_may_be_global_inner(ConstInitializer *init, bool top)
 			list = init->init_array_full;
 			len = vec_size(list);
 			break;
+		case CONST_INIT_ARRAY_BYTES:
+			return true;
 		case CONST_INIT_ARRAY_VALUE:
 			return const_init_local_init_may_be_global_inner(init->init_array_value.element, false);
 	}
@@ -101,6 +105,113 @@ ConstInitializer *const_init_new_array_full(Type *type, ConstInitializer **eleme
 	return init;
 }
 
+ConstInitializer *const_init_new_array_bytes(Type *type, const char *bytes)
+{
+	ConstInitializer *init = CALLOCS(ConstInitializer);
+	init->kind = CONST_INIT_ARRAY_BYTES;
+	init->type = type_flatten(type);
+	init->init_array_bytes = bytes;
+	return init;
+}
+
+/**
+ * Only arrays of integers and bools are stored packed.
+ */
+bool const_init_type_may_be_packed(Type *flattened)
+{
+	if (flattened->type_kind != TYPE_ARRAY) return false;
+	Type *base = type_flatten(flattened->array.base);
+	return type_is_integer(base) || base->type_kind == TYPE_BOOL;
+}
+
+Int const_init_bytes_int_at(ConstInitializer *init, ArrayIndex index)
+{
+	ASSERT(init->kind == CONST_INIT_ARRAY_BYTES);
+	Type *base = type_flatten(init->type->array.base);
+	ByteSize size = type_size(base);
+	const unsigned char *ptr = (const unsigned char *)init->init_array_bytes + size * index;
+	Int128 value = { 0, 0 };
+	for (ByteSize i = 0; i < size; i++)
+	{
+		if (i < 8)
+		{
+			value.low |= (uint64_t)ptr[i] << (8 * i);
+			continue;
+		}
+		value.high |= (uint64_t)ptr[i] << (8 * (i - 8));
+	}
+	TypeKind kind = base->type_kind == TYPE_BOOL ? TYPE_U8 : base->type_kind;
+	return (Int) { i128_extend(value, kind), kind };
+}
+
+void const_init_bytes_rewrite_expr_at(ConstInitializer *init, ArrayIndex index, Expr *expr)
+{
+	Type *type = init->type->array.base;
+	Int value = const_init_bytes_int_at(init, index);
+	if (type_flatten(type)->type_kind == TYPE_BOOL)
+	{
+		expr_rewrite_const_bool(expr, type, value.i.low != 0);
+		return;
+	}
+	expr->expr_kind = EXPR_CONST;
+	expr->type = type;
+	expr->const_expr = (ExprConst) { .ixx = value, .const_kind = CONST_INTEGER };
+	expr->resolve_status = RESOLVE_DONE;
+}
+
+/**
+ * Turn a packed array back into one initializer per element, for the cases where
+ * the elements need to be updated or visited individually.
+ */
+void const_init_expand_bytes(ConstInitializer *init)
+{
+	if (init->kind != CONST_INIT_ARRAY_BYTES) return;
+	ArraySize len = init->type->array.len;
+	ConstInitializer **inits = VECNEW(ConstInitializer*, len);
+	for (ArraySize i = 0; i < len; i++)
+	{
+		Expr *expr = expr_new(EXPR_CONST, INVALID_SPAN);
+		const_init_bytes_rewrite_expr_at(init, i, expr);
+		vec_add(inits, const_init_new_value(expr));
+	}
+	init->kind = CONST_INIT_ARRAY_FULL;
+	init->init_array_full = inits;
+}
+
+/**
+ * Pack a long list of integer or bool constants into raw little-endian bytes,
+ * this avoids one initializer and one expression per element for large tables.
+ */
+static const char *sema_pack_const_elements(Type *flattened, Expr **elements)
+{
+	unsigned count = vec_size(elements);
+	if (count < CONST_INIT_PACK_MIN_ELEMENTS || !const_init_type_may_be_packed(flattened)) return NULL;
+	Type *base = flattened->array.base;
+	bool is_bool = type_flatten(base)->type_kind == TYPE_BOOL;
+	ConstKind const_kind = is_bool ? CONST_BOOL : CONST_INTEGER;
+	FOREACH(Expr *, expr, elements)
+	{
+		if (!expr_is_const(expr) || expr->type != base || expr->const_expr.const_kind != const_kind) return NULL;
+	}
+	ByteSize size = type_size(base);
+	unsigned char *bytes = MALLOC(size * count);
+	FOREACH_IDX(i, Expr *, expr, elements)
+	{
+		unsigned char *ptr = bytes + i * size;
+		if (is_bool)
+		{
+			ptr[0] = expr->const_expr.b;
+			continue;
+		}
+		Int128 value = expr->const_expr.ixx.i;
+		for (ByteSize j = 0; j < size; j++)
+		{
+			ptr[j] = (unsigned char)(j < 8 ? value.low >> (8 * j) : value.high >> (8 * (j - 8)));
+		}
+	}
+	return (const char *)bytes;
+}
+
 ConstInitializer *const_init_new_struct(Type *type, Expr **elements)
 {
 	ConstInitializer *init = CALLOCS(ConstInitializer);
@@ -448,6 +559,13 @@ static inline bool sema_expr_analyse_array_plain_initializer(SemaContext *contex
 	initializer->resolve_status = RESOLVE_DONE;
 	if (expr_is_runtime_const(initializer))
 	{
+		Type *const_type = type_flatten(initializer->type);
+		const char *bytes = sema_pack_const_elements(const_type, elements);
+		if (bytes)
+		{
+			expr_rewrite_const_initializer(initializer, initializer->type, const_init_new_array_bytes(const_type, bytes));
+			return true;
+		}
 		ConstInitializer **inits = VECNEW(ConstInitializer*, vec_size(elements));
 		FOREACH(Expr *, expr, elements)
 		{
@@ -458,7 +576,7 @@ static inline bool sema_expr_analyse_array_plain_initializer(SemaContext *contex
 			}
 			vec_add(inits, const_init_new_value(expr));
 		}
-		ConstInitializer *const_init = const_init_new_array_full(type_flatten(initializer->type), inits);
+		ConstInitializer *const_init = const_init_new_array_full(const_type, inits);
 		expr_rewrite_const_initializer(initializer, initializer->type, const_init);
 	}
 
@@ -913,6 +1031,15 @@ bool const_init_is_zero(ConstInitializer *init)
 			}
 			return true;
 		}
+		case CONST_INIT_ARRAY_BYTES:
+		{
+			ByteSize size = type_size(init->type);
+			for (ByteSize i = 0; i < size; i++)
+			{
+				if (init->init_array_bytes[i]) return false;
+			}
+			return true;
+		}
 		case CONST_INIT_ARRAY_VALUE:
 			return const_init_is_zero(init->init_array_value.element);
 	}
@@ -1096,6 +1223,7 @@ void const_init_rewrite_array_at(ConstInitializer *const_init, Expr *value, Arra
 		const_init->kind = CONST_INIT_ARRAY;
 		const_init->init_array.elements = NULL;
 	}
+	const_init_expand_bytes(const_init);
 	ConstInitializer *inner_value;
 	if (const_init->kind == CONST_INIT_ARRAY_FULL)
 	{
@@ -86,6 +86,7 @@ void sema_analysis_pass_interface(Module *module);
 void sema_analysis_pass_lambda(Module *module);
 void sema_analyze_stage(Module *module, AnalysisStage stage);
 void sema_trace_liveness(void);
+void sema_promote_temp_allocations(Decl *func);
 
 Expr *sema_expr_resolve_access_child(SemaContext *context, Expr *child, bool *missing);
 bool sema_analyse_expr_address(SemaContext *context, Expr *expr);
@@ -95,6 +96,7 @@ bool sema_analyse_expr_lvalue(SemaContext *context, Expr *expr, bool *failed_ref
 bool sema_analyse_expr_value(SemaContext *context, Expr *expr);
 Expr *expr_access_inline_member(Expr *parent, Decl *parent_decl);
 bool sema_analyse_ct_expr(SemaContext *context, Expr *expr);
+bool sema_ct_vm_eval_for(SemaContext *context, Ast *statement, bool *failed_ref);
 Decl *sema_find_typed_operator(SemaContext *context, OperatorOverload operator_overload, Expr *lhs, Expr *rhs, Decl **ambiguous_ref, bool *reverse);
 Decl *sema_find_untyped_operator(SemaContext *context, Type *type, OperatorOverload operator_overload, Decl *skipped);
 bool sema_insert_method_call(SemaContext *context, Expr *method_call, Decl *method_decl, Expr *parent, Expr **arguments, bool reverse_overload);
@@ -161,11 +163,11 @@ INLINE Attr* attr_find_kind(Attr **attrs, AttributeType attr_type)
 INLINE void sema_display_deprecated_warning_on_use(Decl *decl, SourceSpan span)
 {
 	ASSERT(decl->resolve_status == RESOLVE_DONE);
-	if (!decl->resolved_attributes || !decl->attrs_resolved || !decl->attrs_resolved->deprecated) return;
-	const char *msg = decl->attrs_resolved->deprecated;
+	if (!decl->resolved_attributes || !decl_attrs_resolved(decl) || !decl_attrs_resolved(decl)->deprecated) return;
+	const char *msg = decl_attrs_resolved(decl)->deprecated;
 
 	// Prevent multiple reports
-	decl->attrs_resolved->deprecated = NULL;
+	decl_attrs_resolved(decl)->deprecated = NULL;
 
 	if (compiler.build.silence_deprecation) return;
 	if (msg[0])
@@ -206,6 +206,7 @@ static void sema_trace_const_initializer_liveness(ConstInitializer *const_init)
 	switch (const_init->kind)
 	{
 		case CONST_INIT_ZERO:
+		case CONST_INIT_ARRAY_BYTES:
 			return;
 		case CONST_INIT_ARRAY_VALUE:
 			const_init = const_init->init_array_value.element;
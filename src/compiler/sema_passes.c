@@ -3,6 +3,7 @@
 // a copy of which can be found in the LICENSE file.
 
 #include "sema_internal.h"
+#include "compiler_tests/benchmark.h"
 
 void parent_path(StringSlice *slice)
 {
@@ -164,7 +165,7 @@ static Decl **sema_load_include(CompilationUnit *unit, Decl *decl)
 	}
 	SemaContext context;
 	sema_context_init(&context, unit);
-	FOREACH(Attr *, attr, decl->attributes)
+	FOREACH(Attr *, attr, decl_attributes(decl))
 	{
 		if (attr->attr_kind != ATTRIBUTE_IF)
 		{
@@ -238,8 +239,15 @@ static Decl **sema_run_exec(CompilationUnit *unit, Decl *decl)
 	}
 	SemaContext context;
 	sema_context_init(&context, unit);
-	FOREACH(Attr *, attr, decl->attributes)
+	bool is_pure = false;
+	FOREACH(Attr *, attr, decl_attributes(decl))
 	{
+		// @pure promises that the output only depends on the script, its arguments and stdin.
+		if (attr->attr_kind == ATTRIBUTE_PURE)
+		{
+			is_pure = true;
+			continue;
+		}
 		if (attr->attr_kind != ATTRIBUTE_IF)
 		{
 			RETURN_PRINT_ERROR_AT(NULL, attr, "Invalid attribute for '$exec'.");
@@ -265,8 +273,13 @@ static Decl **sema_run_exec(CompilationUnit *unit, Decl *decl)
 	scratch_buffer_clear();
 	const char *file_str = filename->const_expr.bytes.ptr;
 	bool c3_script = str_has_suffix(file_str, ".c3");
+	if (is_pure && !c3_script)
+	{
+		RETURN_PRINT_ERROR_AT(NULL, decl, "'@pure' can only be used when '$exec' runs a '.c3' script.");
+	}
 	if (!c3_script)
 	{
+		compiler_add_input_file(file_str);
 		scratch_buffer_append(file_str);
 		scratch_buffer_append(" ");
 	}
@@ -292,7 +305,7 @@ static Decl **sema_run_exec(CompilationUnit *unit, Decl *decl)
 	}
 	if (c3_script)
 	{
-		file = compile_and_invoke(file_str, scratch_buffer_copy(), stdin_string, 0);
+		file = compile_and_invoke(file_str, scratch_buffer_copy(), stdin_string, 0, is_pure);
 	}
 	else
 	{
@@ -767,6 +780,14 @@ void sema_analysis_pass_interface(Module *module)
 	DEBUG_LOG("Pass finished with %d error(s).", compiler.context.errors_found);
 }
 
+// With --trace-out every body gets its own span, so the expensive ones can be found.
+static inline void analyse_func_body_traced(SemaContext *context, Decl *decl)
+{
+	double start = trace_begin();
+	analyse_func_body(context, decl);
+	trace_end("sema", "function", decl->name, start);
+}
+
 void sema_analysis_pass_functions(Module *module)
 {
 	DEBUG_LOG("Pass: Function analysis %s", module->name->module);
@@ -777,13 +798,13 @@ void sema_analysis_pass_functions(Module *module)
 		sema_context_init(&context, unit);
 		FOREACH(Decl *, method, unit->methods)
 		{
-			analyse_func_body(&context, method);
+			analyse_func_body_traced(&context, method);
 		}
 		FOREACH(Decl *, func, unit->functions)
 		{
-			analyse_func_body(&context, func);
+			analyse_func_body_traced(&context, func);
 		}
-		if (unit->main_function && unit->main_function->is_synthetic) analyse_func_body(&context, unit->main_function);
+		if (unit->main_function && unit->main_function->is_synthetic) analyse_func_body_traced(&context, unit->main_function);
 		sema_context_destroy(&context);
 	}
 
@@ -1346,7 +1346,149 @@ static inline bool sema_analyse_for_cond(SemaContext *context, ExprId *cond_ref,
 	*cond_ref = cond ? exprid(cond) : 0;
 	return true;
 }
-static inline bool sema_analyse_for_stmt(SemaContext *context, Ast *statement)
+
+void sema_var_assigned(Decl *decl)
+{
+	FOREACH(LoopRange *, range, compiler.context.loop_ranges)
+	{
+		if (range->index == decl || range->slice == decl) range->modified = true;
+	}
+}
+
+void sema_var_ref_taken(Decl *decl)
+{
+	if (decl->decl_kind != DECL_VAR) return;
+	decl->var.ref_taken = true;
+	sema_var_assigned(decl);
+}
+
+/**
+ * Record x[i] for the innermost loop over `i` where it is in range.
+ */
+void sema_loop_range_add_subscript(Expr *subscript, Expr *parent, Expr *index)
+{
+	if (!vec_size(compiler.context.loop_ranges) || subscript->subscript_expr.index.start_from_end) return;
+	if (index->expr_kind != EXPR_IDENTIFIER) return;
+	Type *type = type_flatten(parent->type);
+	FOREACH(LoopRange *, range, compiler.context.loop_ranges)
+	{
+		if (!range->index || range->index != index->ident_expr) continue;
+		switch (type->type_kind)
+		{
+			case TYPE_SLICE:
+				if (!range->slice || parent->expr_kind != EXPR_IDENTIFIER || parent->ident_expr != range->slice) continue;
+				break;
+			case TYPE_ARRAY:
+				if (range->slice || type->array.len < range->len) continue;
+				break;
+			default:
+				continue;
+		}
+		vec_add(range->subscripts, subscript);
+		return;
+	}
+}
+
+/**
+ * Follow a recorded subscript that was copied into another expression, as with &x[i].
+ */
+void sema_loop_range_move_subscript(Expr *from, Expr *to)
+{
+	FOREACH(LoopRange *, range, compiler.context.loop_ranges)
+	{
+		FOREACH_IDX(i, Expr *, subscript, range->subscripts)
+		{
+			if (subscript == from) range->subscripts[i] = to;
+		}
+	}
+}
+
+static inline void sema_loop_range_push(LoopRange *range)
+{
+	vec_add(compiler.context.loop_ranges, range);
+}
+
+static inline void sema_loop_range_pop(LoopRange *range)
+{
+	ASSERT(VECLAST(compiler.context.loop_ranges) == range);
+	vec_pop(compiler.context.loop_ranges);
+}
+
+static inline void sema_loop_range_apply(LoopRange *range)
+{
+	if (range->modified) return;
+	FOREACH(Expr *, subscript, range->subscripts)
+	{
+		// The subscript may have been rewritten after analysis.
+		if (subscript->expr_kind != EXPR_SUBSCRIPT && subscript->expr_kind != EXPR_SUBSCRIPT_ADDR) continue;
+		subscript->subscript_expr.index.in_range = true;
+	}
+}
+
+INLINE bool sema_loop_range_local(Decl *decl)
+{
+	if (decl->decl_kind != DECL_VAR || decl->var.ref_taken) return false;
+	switch (decl->var.kind)
+	{
+		case VARDECL_LOCAL:
+			return !decl->var.is_static;
+		case VARDECL_PARAM:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Recognize `for (i = 0; i < x.len; i++)` over a local slice, and `for (i = 0; i < N; i++)`
+ * for arrays of at least N elements. The index must be an unsigned local that is at least as
+ * wide as usz, so that it can neither be negative nor wrap before reaching the length.
+ * The increment is checked after it has been analysed.
+ */
+static bool sema_for_stmt_loop_range(Ast *statement, LoopRange *range)
+{
+	if (statement->for_stmt.flow.skip_first || !statement->for_stmt.cond || !statement->for_stmt.incr) return false;
+	Expr *cond = exprptr(statement->for_stmt.cond);
+	if (cond->expr_kind == EXPR_COND)
+	{
+		if (vec_size(cond->cond_expr) != 1) return false;
+		cond = cond->cond_expr[0];
+	}
+	if (cond->expr_kind != EXPR_BINARY || cond->binary_expr.operator != BINARYOP_LT) return false;
+	Expr *left = exprptr(cond->binary_expr.left);
+	Expr *right = exprptr(cond->binary_expr.right);
+	if (left->expr_kind != EXPR_IDENTIFIER || !sema_loop_range_local(left->ident_expr)) return false;
+	Decl *index = left->ident_expr;
+	Type *index_type = type_flatten(index->type);
+	if (!type_is_unsigned(index_type) || type_size(index_type) < type_size(type_usz)) return false;
+	*range = (LoopRange) { .index = index };
+	if (right->expr_kind == EXPR_SLICE_LEN)
+	{
+		Expr *slice = right->inner_expr;
+		if (slice->expr_kind != EXPR_IDENTIFIER || !sema_loop_range_local(slice->ident_expr)) return false;
+		range->slice = slice->ident_expr;
+		return true;
+	}
+	if (!expr_is_const_int(right) || !int_fits(right->const_expr.ixx, TYPE_U32)) return false;
+	range->len = int_is_neg(right->const_expr.ixx) ? 0 : (ArraySize)right->const_expr.ixx.i.low;
+	return true;
+}
+
+static bool sema_for_stmt_incr_is_index_inc(Ast *statement, Decl *index)
+{
+	Expr *incr = exprptr(statement->for_stmt.incr);
+	if (incr->expr_kind == EXPR_EXPRESSION_LIST)
+	{
+		if (vec_size(incr->expression_list) != 1) return false;
+		incr = incr->expression_list[0];
+	}
+	if (incr->expr_kind != EXPR_UNARY && incr->expr_kind != EXPR_POST_UNARY) return false;
+	if (incr->unary_expr.operator != UNARYOP_INC) return false;
+	Expr *inner = incr->unary_expr.expr;
+	return inner->expr_kind == EXPR_IDENTIFIER && inner->ident_expr == index;
+}
+
+static inline bool sema_analyse_for_stmt_range(SemaContext *context, Ast *statement, LoopRange *range)
 {
 	bool success = true;
 	bool is_infinite = false;
@@ -1358,6 +1500,7 @@ static inline bool sema_analyse_for_stmt(SemaContext *context, Ast *statement)
 		RETURN_SEMA_ERROR(body, "Looping over a raw 'defer' is not allowed, was this a mistake?");
 	}
 	bool do_loop = statement->for_stmt.flow.skip_first;
+	LoopRange loop_range;
 	if (body->ast_kind != AST_COMPOUND_STMT && do_loop)
 	{
 		RETURN_SEMA_ERROR(body, "A do loop must use { } around its body.");
@@ -1383,10 +1526,14 @@ static inline bool sema_analyse_for_stmt(SemaContext *context, Ast *statement)
 			}
 
 
+			// Look for subscripts the loop keeps in range, while analysing the body.
+			if (!range && !do_loop && sema_for_stmt_loop_range(statement, &loop_range)) range = &loop_range;
+			if (range) sema_loop_range_push(range);
 			PUSH_BREAKCONT(statement);
 				success = sema_analyse_statement(context, body);
 				statement->for_stmt.flow.no_exit = context->active_scope.jump_end;
 			POP_BREAKCONT();
+			if (range) sema_loop_range_pop(range);
 
 			// End for body scope
 			context_pop_defers_and_replace_ast(context, body);
@@ -1418,6 +1565,10 @@ static inline bool sema_analyse_for_stmt(SemaContext *context, Ast *statement)
 				// Incr scope end
 			SCOPE_END;
 		}
+		if (success && range && (!range->index || sema_for_stmt_incr_is_index_inc(statement, range->index)))
+		{
+			sema_loop_range_apply(range);
+		}
 
 
 		// End for body scope
@@ -1432,6 +1583,11 @@ static inline bool sema_analyse_for_stmt(SemaContext *context, Ast *statement)
 	return success;
 }
 
+static inline bool sema_analyse_for_stmt(SemaContext *context, Ast *statement)
+{
+	return sema_analyse_for_stmt_range(context, statement, NULL);
+}
+
 /**
  * foreach_stmt ::= foreach
  * @param context
@@ -1845,6 +2001,30 @@ SKIP_OVERLOAD:;
 		expr_rewrite_enum_from_ord(index_expr, index_type);
 	}
 	subscript->subscript_expr.index.expr = exprid(index_expr);
+
+	// The index is below the length of arrays and of slices that don't change in the body.
+	LoopRange range = { .modified = false };
+	bool watch_slice = false;
+	if (!len && !is_enum_iterator)
+	{
+		if (enumerator_type->type_kind == TYPE_ARRAY)
+		{
+			subscript->subscript_expr.index.in_range = true;
+		}
+		else if (enumerator_type->type_kind == TYPE_SLICE)
+		{
+			if (enumerator->expr_kind != EXPR_IDENTIFIER)
+			{
+				subscript->subscript_expr.index.in_range = !is_addr;
+			}
+			else if (sema_loop_range_local(temp))
+			{
+				range.slice = temp;
+				vec_add(range.subscripts, subscript);
+				watch_slice = true;
+			}
+		}
+	}
 	if (value_by_ref)
 	{
 		Expr *addr = expr_new(EXPR_UNARY, subscript->span);
@@ -1867,7 +2047,7 @@ SKIP_OVERLOAD:;
 										.body = astid(compound_stmt),
 	};
 	statement->ast_kind = AST_FOR_STMT;
-	return sema_analyse_for_stmt(context, statement);
+	return sema_analyse_for_stmt_range(context, statement, watch_slice ? &range : NULL);
 
 }
 
@@ -2399,6 +2579,23 @@ static inline bool sema_check_value_case(SemaContext *context, Type *switch_type
 	return true;
 }
 
+/**
+ * A switch over enough constant strings is dispatched on the length and then on the
+ * bytes that tell the strings apart, so that only a single memcmp is needed.
+ */
+static inline bool sema_switch_is_string_dispatch(Type *flat, Ast **cases)
+{
+	if (flat->type_kind != TYPE_SLICE || type_size(flat->array.base) != 1) return false;
+	unsigned strings = 0;
+	FOREACH(Ast *, case_stmt, cases)
+	{
+		if (case_stmt->ast_kind != AST_CASE_STMT) continue;
+		if (!expr_is_const_string(exprptr(case_stmt->case_stmt.expr))) return false;
+		strings++;
+	}
+	return strings >= MIN_STRING_DISPATCH_CASES;
+}
+
 INLINE const char *create_missing_enums_in_switch_error(Ast **cases, unsigned found_count, Decl **enums)
 {
 	uint32_t enum_count = vec_size(enums);
@@ -2557,7 +2754,10 @@ static bool sema_analyse_switch_body(SemaContext *context, Ast *statement, Sourc
 	}
 
 	statement->flow.no_exit = all_jump_end;
-	statement->switch_stmt.flow.if_chain = if_chain || max_ranged;
+	statement->switch_stmt.flow.if_chain = if_chain;
+	// Constant cases with ranges too large to expand are split into clusters instead.
+	statement->switch_stmt.flow.clustered = !if_chain && max_ranged;
+	statement->switch_stmt.flow.string_dispatch = if_chain && !type_switch && sema_switch_is_string_dispatch(flat, cases);
 	return success;
 }
 
@@ -2777,6 +2977,11 @@ static inline bool sema_analyse_ct_foreach_stmt(SemaContext *context, Ast *state
 					statement->ast_kind = AST_NOP_STMT;
 					return true;
 				}
+				if (init_type == CONST_INIT_ARRAY_BYTES)
+				{
+					count = initializer->type->array.len;
+					break;
+				}
 				if (init_type != CONST_INIT_ARRAY_FULL)
 				{
 					SEMA_ERROR(collection, "Only regular arrays are allowed here.");
@@ -2943,6 +3148,7 @@ bool sema_analyse_ct_echo_stmt(SemaContext *context, Ast *statement)
 		SEMA_ERROR(message, "Expected a constant value.");
 		return false;
 	}
+	compiler.context.call_site_evals++;
 	printf("] ");
 	scratch_buffer_clear();
 	expr_const_to_scratch_buffer(&message->const_expr);
@@ -2989,11 +3195,20 @@ static inline bool sema_analyse_ct_for_stmt(SemaContext *context, Ast *statement
 	AstId *current = &start;
 	Expr **incr_list = incr ? exprptr(incr)->expression_list : NULL;
 	ASSERT(condition);
+	// Loops that only compute "$" values are run in the bytecode VM instead of being unrolled.
+	bool failed = false;
+	if (sema_ct_vm_eval_for(context, statement, &failed)) goto DONE;
+	if (failed) goto FAILED;
 	// We set a maximum of macro iterations.
 	// we might consider reducing this.
 	unsigned current_ct_scope = sema_context_push_ct_stack(context);
-	for (int i = 0; i < MAX_MACRO_ITERATIONS; i++)
+	for (int i = 0;; i++)
 	{
+		if (i == MAX_MACRO_ITERATIONS)
+		{
+			SEMA_ERROR(statement, "The '$for' did not finish within %d iterations.", MAX_MACRO_ITERATIONS);
+			goto FAILED;
+		}
 		sema_context_pop_ct_stack(context, current_ct_scope);
 		// First evaluate the cond, which we note that we *must* have.
 		// we need to make a copy
@@ -3024,6 +3239,7 @@ static inline bool sema_analyse_ct_for_stmt(SemaContext *context, Ast *statement
 			if (!sema_analyse_ct_expr(context, copy_expr_single(expr))) goto FAILED;
 		}
 	}
+DONE:
 	// Analysis is done turn the generated statements into a compound statement for lowering.
 	statement->ast_kind = AST_CT_COMPOUND_STMT;
 	statement->ct_compound_stmt = start;
@@ -3305,6 +3521,7 @@ NEXT:
 		}
 
 	SCOPE_END;
+	if (func->func_decl.has_temp_new) sema_promote_temp_allocations(func);
 	if (lambda_params)
 	{
 		FOREACH_IDX(i, Decl *, ct_param, lambda_params)
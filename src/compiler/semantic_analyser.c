@@ -143,12 +143,37 @@ static inline void halt_on_error(void)
 	}
 }
 
+static const char *analysis_stage_names[ANALYSIS_LAST + 1] = {
+	[ANALYSIS_NOT_BEGUN] = "not begun",
+	[ANALYSIS_MODULE_HIERARCHY] = "module hierarchy",
+	[ANALYSIS_MODULE_TOP] = "module top",
+	[ANALYSIS_IMPORTS] = "imports",
+	[ANALYSIS_REGISTER_GLOBAL_DECLARATIONS] = "register global declarations",
+	[ANALYSIS_INCLUDES] = "includes",
+	[ANALYSIS_REGISTER_CONDITIONAL_UNITS] = "register conditional units",
+	[ANALYSIS_REGISTER_CONDITIONAL_DECLARATIONS] = "register conditional declarations",
+	[ANALYSIS_METHODS_REGISTER] = "methods register",
+	[ANALYSIS_METHODS_REGISTER_GENERIC] = "methods register generic",
+	[ANALYSIS_METHODS_INCLUDES] = "methods includes",
+	[ANALYSIS_METHODS_INCLUDES_GENERIC] = "methods includes generic",
+	[ANALYSIS_METHODS_CONDITIONAL] = "methods conditional",
+	[ANALYSIS_METHODS_CONDITIONAL_GENERIC] = "methods conditional generic",
+	[ANALYSIS_POST_REGISTER] = "post register",
+	[ANALYSIS_DECLS] = "decls",
+	[ANALYSIS_CT_ECHO] = "ct echo",
+	[ANALYSIS_CT_ASSERT] = "ct assert",
+	[ANALYSIS_FUNCTIONS] = "functions",
+	[ANALYSIS_INTERFACE] = "interface",
+	[ANALYSIS_FINALIZE] = "finalize",
+};
+
 void sema_analyze_stage(Module *module, AnalysisStage stage)
 {
 	while (module->stage < stage)
 	{
 		compiler.context.decl_stack_bottom = compiler.context.decl_stack_top = compiler.context.decl_stack;
 		module->stage++;
+		double start = trace_begin();
 		switch (module->stage)
 		{
 			case ANALYSIS_NOT_BEGUN:
@@ -212,6 +237,7 @@ void sema_analyze_stage(Module *module, AnalysisStage stage)
 			case ANALYSIS_FINALIZE:
 				break;
 		}
+		trace_end("sema", analysis_stage_names[module->stage], module->name->module, start);
 		if (compiler.context.errors_found) return;
 	}
 }
@@ -371,6 +397,58 @@ static void assign_panicfn(void)
 	compiler.context.panicf = panicf_decl;
 }
 
+static void assign_target_clones_resolver(void)
+{
+	if (!compiler.context.uses_target_clones) return;
+	const char *resolver = "std::core::cpudetect::x86_has_features";
+	Path *path;
+	const char *ident;
+	if (sema_splitpathref(resolver, strlen(resolver), &path, &ident) != TOKEN_IDENT || path == NULL || !ident)
+	{
+		error_exit("'%s' is not a valid feature resolver.", resolver);
+	}
+	Decl *decl = sema_find_decl_in_modules(compiler.context.module_list, path, ident);
+	if (!decl || decl->decl_kind != DECL_FUNC)
+	{
+		error_exit("'%s' could not be found, it is needed for '@target_clones'.", resolver);
+	}
+	Signature *sig = decl->type->canonical->function.signature;
+	if (typeget(sig->rtype)->canonical != type_bool || vec_size(sig->params) != 1
+		|| type_flatten(sig->params[0]->type) != type_get_ptr(type_char))
+	{
+		error_exit("Expected '%s' to have the signature fn bool(ZString).", resolver);
+	}
+	decl->no_strip = true;
+	compiler.context.target_clones_resolver = decl;
+}
+
+static void assign_init_audit(void)
+{
+	if (!compiler.build.audit_init) return;
+	const char *auditfn = "std::core::runtime::audit_init";
+	Path *path;
+	const char *ident;
+	if (sema_splitpathref(auditfn, strlen(auditfn), &path, &ident) != TOKEN_IDENT || path == NULL || !ident)
+	{
+		error_exit("'%s' is not a valid init audit function.", auditfn);
+	}
+	Decl *decl = sema_find_decl_in_modules(compiler.context.module_list, path, ident);
+	if (!decl || decl->decl_kind != DECL_FUNC)
+	{
+		error_exit("'%s' could not be found, it is needed for '--audit-init'.", auditfn);
+	}
+	Signature *sig = decl->type->canonical->function.signature;
+	if (typeget(sig->rtype)->canonical != type_void || vec_size(sig->params) != 3
+		|| !type_is_func_ptr(type_flatten(sig->params[0]->type))
+		|| type_flatten(sig->params[1]->type) != type_get_ptr(type_char)
+		|| type_flatten(sig->params[2]->type) != type_uint)
+	{
+		error_exit("Expected '%s' to have the signature fn void(InitFn, ZString, uint).", auditfn);
+	}
+	decl->no_strip = true;
+	compiler.context.init_audit = decl;
+}
+
 static void assign_testfn(void)
 {
 	if (!compiler.build.testing) return;
@@ -493,6 +571,8 @@ RESOLVE_LAMBDA:;
 	halt_on_error();
 
 	assign_panicfn();
+	assign_target_clones_resolver();
+	assign_init_audit();
 	assign_testfn();
 	assign_benchfn();
 
@@ -15,8 +15,68 @@ File *source_file_by_id(FileId file)
 	return compiler.context.loaded_sources[file];
 }
 
+static void source_file_index_lines(File *file)
+{
+	const char *contents = file->contents ? file->contents : "";
+	const char *end = contents + file->content_len;
+	vec_add(file->line_offsets, 0);
+	for (const char *current = contents; (current = memchr(current, '\n', (size_t)(end - current))); current++)
+	{
+		vec_add(file->line_offsets, (uint32_t)(current - contents + 1));
+	}
+}
+
+SourceLoc span_location(SourceSpan span)
+{
+	if (!span.pos) return (SourceLoc) { 0, 0 };
+	File *file = source_file_by_id(span.file_id);
+	if (!file->line_offsets) source_file_index_lines(file);
+	uint32_t *lines = file->line_offsets;
+	uint32_t count = vec_size(lines);
+	uint32_t offset = span.pos - 1;
+	uint32_t line = file->last_line;
+	// Locations are mostly decoded in order, so try the last line first.
+	if (lines[line] > offset || (line + 1 < count && lines[line + 1] <= offset))
+	{
+		uint32_t low = 0;
+		uint32_t high = count;
+		while (high - low > 1)
+		{
+			uint32_t mid = low + (high - low) / 2;
+			if (lines[mid] <= offset)
+			{
+				low = mid;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		line = low;
+		file->last_line = line;
+	}
+	return (SourceLoc) { .row = line + 1, .col = offset - lines[line] + 1 };
+}
+
+static inline const char *source_file_intern_path(const char *path)
+{
+	uint32_t len = (uint32_t)strlen(path);
+	TokenType type = TOKEN_INVALID_TOKEN;
+	return symtab_add(path, len, symtab_hash(path, len), &type);
+}
+
+static const char *source_file_map(const char *full_path, size_t *size_ref);
+
+static inline void source_files_init(void)
+{
+	if (compiler.context.loaded_sources) return;
+	compiler.context.loaded_sources = VECNEW(File*, LEXER_FILES_START_CAPACITY);
+	htable_init(&compiler.context.loaded_sources_by_path, MAX_COMMAND_LINE_FILES);
+}
+
 File *source_file_text_load(const char *filename, char *content)
 {
+	source_files_init();
 	File *file = CALLOCS(File);
 	file->file_id = vec_size(compiler.context.loaded_sources);
 	file->full_path = str_copy(filename, strlen(filename));
@@ -31,6 +91,7 @@ File *source_file_text_load(const char *filename, char *content)
 
 File *source_file_generate(const char *filename)
 {
+	source_files_init();
 	File *file = CALLOCS(File);
 	file->file_id = vec_size(compiler.context.loaded_sources);
 	file->full_path = "<generated>";
@@ -40,26 +101,48 @@ File *source_file_generate(const char *filename)
 	return file;
 }
 
+// Paths are interned, so the lookup is a plain pointer hash.
+static inline File *source_file_find_loaded(const char *full_path)
+{
+	return htable_get(&compiler.context.loaded_sources_by_path, (void *)full_path);
+}
+
+bool source_file_is_on_disk(File *file)
+{
+	return file->full_path && source_file_find_loaded(file->full_path) == file;
+}
+
+static File *source_file_add(const char *full_path, const char *contents, size_t content_len)
+{
+	File *file = CALLOCS(File);
+	file->file_id = vec_size(compiler.context.loaded_sources);
+	file->full_path = full_path;
+	file->contents = contents;
+	file->content_len = content_len;
+	file_get_dir_and_filename_from_full(file->full_path, &file->name, &file->dir_path);
+	vec_add(compiler.context.loaded_sources, file);
+	htable_set(&compiler.context.loaded_sources_by_path, (void *)full_path, file);
+	return file;
+}
+
 File *source_file_load(const char *filename, bool *already_loaded, const char **error)
 {
 	if (already_loaded) *already_loaded = false;
-	if (!compiler.context.loaded_sources) compiler.context.loaded_sources = VECNEW(File*, LEXER_FILES_START_CAPACITY);
+	source_files_init();
 
-	char* full_path = malloc_arena(PATH_MAX + 1);
-
-	if (!realpath(filename, full_path))
+	char resolved_path[PATH_MAX + 1];
+	if (!realpath(filename, resolved_path))
 	{
 		*error = str_printf("Failed to resolve %s", filename);
 		return NULL;
 	}
+	const char *full_path = source_file_intern_path(resolved_path);
 
-	FOREACH(File *, file, compiler.context.loaded_sources)
+	File *file = source_file_find_loaded(full_path);
+	if (file)
 	{
-		if (strcmp(file->full_path, full_path) == 0)
-		{
-			if (already_loaded) *already_loaded = true;
-			return file;
-		}
+		if (already_loaded) *already_loaded = true;
+		return file;
 	}
 	if (vec_size(compiler.context.loaded_sources) == MAX_COMMAND_LINE_FILES)
 	{
@@ -68,15 +151,111 @@ File *source_file_load(const char *filename, bool *already_loaded, const char **
 	}
 
 	size_t size;
-	const char* source_text = file_read_all(filename, &size);
-	File *file = CALLOCS(File);
-	file->file_id = vec_size(compiler.context.loaded_sources);
-	file->full_path = full_path;
-	file->contents = source_text;
-	file->content_len = size;
-	file_get_dir_and_filename_from_full(file->full_path, &file->name, &file->dir_path);
-	vec_add(compiler.context.loaded_sources, file);
-	return file;
+	const char *source_text = source_file_map(full_path, &size);
+	if (source_text) return source_file_add(full_path, source_text, size);
+	char *buffer = file_try_read_all(full_path, &size);
+	if (!buffer)
+	{
+		*error = str_printf("Could not read %s", filename);
+		return NULL;
+	}
+	return source_file_add(full_path, buffer, file_clean_buffer(buffer, filename, size));
+}
+
+/**
+ * Try to map the source file directly, so the lexer can read it in place. This
+ * is only possible if the file doesn't need any cleaning (CRLF, BOM etc).
+ *
+ * @return the mapped contents or NULL if a buffered read must be used.
+ */
+static const char *source_file_map(const char *full_path, size_t *size_ref)
+{
+	size_t size;
+	const char *mapped = file_map_read_only(full_path, &size);
+	if (!mapped) return NULL;
+	if (file_buffer_needs_cleaning(mapped, size))
+	{
+		file_unmap(mapped, size);
+		return NULL;
+	}
+	*size_ref = size;
+	return mapped;
+}
+
+typedef struct
+{
+	const char *filename;
+	char *full_path;
+	const char *mapped;
+	char *contents;
+	size_t size;
+	Task task;
+} SourceFileRead;
+
+static void source_file_read_task(void *arg)
+{
+	SourceFileRead *read = arg;
+	// realpath(..., NULL), mapping and file_try_read_all only use malloc and
+	// system calls, so this is safe to run concurrently.
+	read->full_path = realpath(read->filename, NULL);
+	if (!read->full_path) return;
+	read->mapped = source_file_map(read->full_path, &read->size);
+	if (read->mapped) return;
+	read->contents = file_try_read_all(read->full_path, &read->size);
 }
 
+File **source_files_load(const char **filenames, int threads)
+{
+	source_files_init();
+	unsigned count = vec_size(filenames);
+	if (!count) return NULL;
+	SourceFileRead *reads = ccalloc(sizeof(SourceFileRead), count);
+	Task **tasks = NULL;
+	for (unsigned i = 0; i < count; i++)
+	{
+		reads[i].filename = filenames[i];
+		reads[i].task = (Task) { &source_file_read_task, &reads[i] };
+		vec_add(tasks, &reads[i].task);
+	}
+
+	// Reading is done in parallel, but files are registered in the original
+	// order so that file ids (and thus the parse order) stay deterministic.
+	if (threads > (int)count) threads = (int)count;
+	if (threads > 1)
+	{
+		taskqueue_run(tasks);
+	}
+	else
+	{
+		FOREACH(Task *, task, tasks) task->task(task->arg);
+	}
 
+	File **files = NULL;
+	for (unsigned i = 0; i < count; i++)
+	{
+		SourceFileRead *read = &reads[i];
+		if (!read->full_path) error_exit("Failed to resolve %s", read->filename);
+		const char *full_path = source_file_intern_path(read->full_path);
+		free(read->full_path);
+		if (source_file_find_loaded(full_path))
+		{
+			if (read->mapped) file_unmap(read->mapped, read->size);
+			free(read->contents);
+			continue;
+		}
+		if (vec_size(compiler.context.loaded_sources) == MAX_COMMAND_LINE_FILES)
+		{
+			error_exit("Exceeded max number of files %d", MAX_COMMAND_LINE_FILES);
+		}
+		if (read->mapped)
+		{
+			vec_add(files, source_file_add(full_path, read->mapped, read->size));
+			continue;
+		}
+		if (!read->contents) error_exit("Could not open file \"%s\".\n", read->filename);
+		size_t size = file_clean_buffer(read->contents, read->filename, read->size);
+		vec_add(files, source_file_add(full_path, read->contents, size));
+	}
+	free(reads);
+	return files;
+}
@@ -5,6 +5,8 @@
 
 #if PLATFORM_POSIX
 #include <sys/wait.h>
+#include <spawn.h>
+extern char **environ;
 #endif
 
 #if PLATFORM_WINDOWS
@@ -12,6 +14,52 @@
 #include <windows.h>
 #endif
 
+#if PLATFORM_POSIX
+/**
+ * Run a program with a NULL terminated argument list, without going through the
+ * shell, and wait for it to finish. This may be called from worker threads.
+ *
+ * @return the exit status of the program, or -1 if it couldn't run or was interrupted.
+ */
+int subprocess_spawn_and_wait(const char *name, const char **argv)
+{
+	// Spawn rather than fork, so the page tables of a large compiler process aren't copied.
+	pid_t cpid;
+	fflush(stdout);
+	fflush(stderr);
+	int err = posix_spawnp(&cpid, name, NULL, NULL, (char *const *)argv, environ);
+	if (err)
+	{
+		eprintf("Could not start child process %s: %s\n", name, strerror(err));
+		return -1;
+	}
+
+	for (;;)
+	{
+		int wstatus = 0;
+		if (waitpid(cpid, &wstatus, 0) < 0)
+		{
+			if (errno != EINTR)
+			{
+				eprintf("Could not wait on %s (pid %d): %s\n", name, cpid, strerror(errno));
+				return -1;
+			}
+			continue;
+		}
+
+		if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+
+		if (WIFSIGNALED(wstatus))
+		{
+			eprintf("Program interrupted by signal %d.\n", WTERMSIG(wstatus));
+			return -1;
+		}
+	}
+
+	return -1;
+}
+#endif
+
 int run_subprocess(const char *name, const char **args)
 {
 #if PLATFORM_WINDOWS
@@ -105,52 +153,11 @@ int run_subprocess(const char *name, const char **args)
 
 	return exit_status;
 #else
-	pid_t cpid = fork();
-	if (cpid < 0)
-	{
-		eprintf("Could not fork child process %s: %s\n", name, strerror(errno));
-		return -1;
-	}
-
-	if (cpid == 0)
-	{
-		const char **args_null = NULL;
-		vec_add(args_null, name);
-		for (uint32_t i = 0; i < vec_size(args); ++i)
-		{
-			vec_add(args_null, args[i]);
-		}
-		vec_add(args_null, NULL);
-		if (execvp(name, (char *const *)args_null) < 0)
-		{
-			eprintf("Could not exec child process %s: %s\n", name, strerror(errno));
-			exit(1);
-		}
-		exit(0);
-	}
-
-	for (;;)
-	{
-		int wstatus = 0;
-		if (waitpid(cpid, &wstatus, 0) < 0)
-		{
-			if (errno != EINTR)
-			{
-				eprintf("Could not wait on %s (pid %d): %s\n", name, cpid, strerror(errno));
-				return -1;
-			}
-			continue;
-		}
-
-		if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
-
-		if (WIFSIGNALED(wstatus))
-		{
-			eprintf("Program interrupted by signal %d.\n", WTERMSIG(wstatus));
-			return -1;
-		}
-	}
+	const char **args_null = NULL;
+	vec_add(args_null, name);
+	FOREACH(const char *, arg, args) vec_add(args_null, arg);
+	vec_add(args_null, NULL);
 
-	return cpid;
+	return subprocess_spawn_and_wait(name, args_null);
 #endif
 }
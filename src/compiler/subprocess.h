@@ -1,3 +1,4 @@
 #pragma once
 
 int run_subprocess(const char *name, const char **args);
+int subprocess_spawn_and_wait(const char *name, const char **argv);
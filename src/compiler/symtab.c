@@ -4,22 +4,24 @@
 
 #include "compiler_internal.h"
 
-typedef struct SymtabEntry_
+// The symtab is open addressed with linear probing, so a lookup is
+// usually a single cache line. The symbols themselves are copied into
+// the arena, which keeps them contiguous.
+typedef struct
 {
-	struct SymtabEntry_* next;
-	const char *value;
+	const char *symbol;
+	uint32_t hash;
 	uint16_t key_len;
 	TokenType type : 16;
-	uint32_t hash;
-	uint32_t index;
-	const char* symbol;
 } SymtabEntry;
 
 typedef struct
 {
-	SymtabEntry **bucket;
-	size_t bucket_max;
-	size_t bucket_mask;
+	SymtabEntry *entries;
+	uint32_t capacity;
+	uint32_t mask;
+	uint32_t count;
+	uint32_t max_load;
 } SymTab;
 
 
@@ -60,10 +62,12 @@ const char *kw_out;
 const char *kw_ptr;
 const char *kw_return;
 const char *kw_self;
+const char *kw_tnew;
 const char *kw_std;
 const char *kw_std__core;
 const char *kw_std__core__types;
 const char *kw_std__core__runtime;
+const char *kw_std__core__mem;
 const char *kw_std__io;
 const char *kw_type;
 const char *kw_typekind;
@@ -72,24 +76,65 @@ const char *kw_wmain;
 const char *kw_FILE_NOT_FOUND;
 const char *kw_IoError;
 
+void symtab_print_stats(void)
+{
+	uint64_t total_probes = 0;
+	uint32_t longest = 0;
+	for (uint32_t i = 0; i < symtab.capacity; i++)
+	{
+		SymtabEntry *entry = &symtab.entries[i];
+		if (!entry->symbol) continue;
+		uint32_t probes = ((i - entry->hash) & symtab.mask) + 1;
+		total_probes += probes;
+		if (probes > longest) longest = probes;
+	}
+	printf(" * Symtab: %u symbols, %u slots, %.2f average probes, longest probe %u\n",
+		   symtab.count, symtab.capacity, symtab.count ? (double)total_probes / symtab.count : 0.0, longest);
+}
+
 void symtab_destroy()
 {
-	free(symtab.bucket);
+	free(symtab.entries);
+	symtab = (SymTab) { 0 };
 }
 
+static inline SymtabEntry *symtab_entry_find(const char *symbol, uint32_t len, uint32_t hash)
+{
+	uint32_t index = hash & symtab.mask;
+	while (1)
+	{
+		SymtabEntry *entry = &symtab.entries[index];
+		if (!entry->symbol) return entry;
+		if (entry->hash == hash && entry->key_len == len && memcmp(symbol, entry->symbol, len) == 0) return entry;
+		index = (index + 1) & symtab.mask;
+	}
+}
 
+static void symtab_resize(uint32_t capacity)
+{
+	SymtabEntry *old_entries = symtab.entries;
+	uint32_t old_capacity = symtab.capacity;
+	symtab.entries = ccalloc(sizeof(SymtabEntry), capacity);
+	symtab.capacity = capacity;
+	symtab.mask = capacity - 1;
+	symtab.max_load = (uint32_t)(capacity * TABLE_MAX_LOAD);
+	for (uint32_t i = 0; i < old_capacity; i++)
+	{
+		SymtabEntry *entry = &old_entries[i];
+		if (!entry->symbol) continue;
+		// All symbols are unique, so we only need to look for an empty slot.
+		uint32_t index = entry->hash & symtab.mask;
+		while (symtab.entries[index].symbol) index = (index + 1) & symtab.mask;
+		symtab.entries[index] = *entry;
+	}
+	free(old_entries);
+}
 
 void symtab_init(uint32_t capacity)
 {
 	if (capacity < 0x100) error_exit("Too small symtab size.");
-	capacity = next_highest_power_of_2(capacity);
-	symtab.bucket_max = capacity;
-	symtab.bucket_mask = capacity - 1;
-
-	size_t size = capacity * sizeof(SymtabEntry*);
-	symtab.bucket = malloc(size);
-	// Touch all pages to improve perf(!)
-	memset(symtab.bucket, 0, size);
+	// The capacity is only the starting size, the table grows as needed.
+	symtab_resize(next_highest_power_of_2(capacity));
 
 	// Add keywords.
 	for (TokenType i = TOKEN_FIRST_KEYWORD; i <= TOKEN_LAST_KEYWORD; i++)
@@ -97,7 +142,7 @@ void symtab_init(uint32_t capacity)
 		TokenType type = i;
 		const char* name = token_type_to_string(type);
 		uint32_t len = (uint32_t)strlen(name);
-		const char* interned = symtab_add(name, (uint32_t)strlen(name), fnv1a(name, len), &type);
+		const char* interned = symtab_add(name, (uint32_t)strlen(name), symtab_hash(name, len), &type);
 		switch (type)
 		{
 			case TOKEN_RETURN:
@@ -107,11 +152,11 @@ void symtab_init(uint32_t capacity)
 				break;
 		}
 		ASSERT(type == i);
-		ASSERT(symtab_add(name, (uint32_t)strlen(name), fnv1a(name, len), &type) == interned);
+		ASSERT(symtab_add(name, (uint32_t)strlen(name), symtab_hash(name, len), &type) == interned);
 	}
 
 	// Init some constant idents
-#define KW_DEF(x) symtab_add(x, sizeof(x) - 1, fnv1a(x, sizeof(x) - 1), &type)
+#define KW_DEF(x) symtab_add(x, sizeof(x) - 1, symtab_hash(x, sizeof(x) - 1), &type)
 	TokenType type = TOKEN_CONST_IDENT;
 	builtin_defines[BUILTIN_DEF_DATE] = KW_DEF("DATE");
 	builtin_defines[BUILTIN_DEF_FILE] = KW_DEF("FILE");
@@ -145,10 +190,12 @@ void symtab_init(uint32_t capacity)
 	kw_out = KW_DEF("out");
 	kw_ptr = KW_DEF("ptr");
 	kw_self = KW_DEF("self");
+	kw_tnew = KW_DEF("tnew");
 	kw_std = KW_DEF("std");
 	kw_std__core = KW_DEF("std::core");
 	kw_std__core__types = KW_DEF("std::core::types");
 	kw_std__core__runtime = KW_DEF("std::core::runtime");
+	kw_std__core__mem = KW_DEF("std::core::mem");
 	kw_std__io = KW_DEF("std::io");
 	kw_type = KW_DEF("type");
 	kw_winmain = KW_DEF("wWinMain");
@@ -244,6 +291,8 @@ void symtab_init(uint32_t capacity)
 	builtin_list[BUILTIN_MEMSET] = KW_DEF("memset");
 	builtin_list[BUILTIN_MEMSET_INLINE] = KW_DEF("memset_inline");
 	builtin_list[BUILTIN_NEARBYINT] = KW_DEF("nearbyint");
+	builtin_list[BUILTIN_NONTEMPORAL_LOAD] = KW_DEF("nontemporal_load");
+	builtin_list[BUILTIN_NONTEMPORAL_STORE] = KW_DEF("nontemporal_store");
 	builtin_list[BUILTIN_OVERFLOW_ADD] = KW_DEF("overflow_add");
 	builtin_list[BUILTIN_OVERFLOW_SUB] = KW_DEF("overflow_sub");
 	builtin_list[BUILTIN_OVERFLOW_MUL] = KW_DEF("overflow_mul");
@@ -272,6 +321,7 @@ void symtab_init(uint32_t capacity)
 	builtin_list[BUILTIN_SAT_SUB] = KW_DEF("sat_sub");
 	builtin_list[BUILTIN_SCATTER] = KW_DEF("scatter");
 	builtin_list[BUILTIN_SELECT] = KW_DEF("select");
+	builtin_list[BUILTIN_SHUFFLE] = KW_DEF("shuffle");
 	builtin_list[BUILTIN_SET_ROUNDING_MODE] = KW_DEF("set_rounding_mode");
 	builtin_list[BUILTIN_SIN] = KW_DEF("sin");
 	builtin_list[BUILTIN_STR_HASH] = KW_DEF("str_hash");
@@ -284,6 +334,7 @@ void symtab_init(uint32_t capacity)
 	builtin_list[BUILTIN_SQRT] = KW_DEF("sqrt");
 	builtin_list[BUILTIN_SYSCALL] = KW_DEF("syscall");
 	builtin_list[BUILTIN_SYSCLOCK] = KW_DEF("sysclock");
+	builtin_list[BUILTIN_SYSCLOCK_FENCED] = KW_DEF("sysclock_fenced");
 	builtin_list[BUILTIN_TRAP] = KW_DEF("trap");
 	builtin_list[BUILTIN_TRUNC] = KW_DEF("trunc");
 	builtin_list[BUILTIN_VECCOMPLT] = KW_DEF("veccomplt");
@@ -369,12 +420,16 @@ void symtab_init(uint32_t capacity)
 	attribute_list[ATTRIBUTE_PURE] = kw_at_pure;
 	attribute_list[ATTRIBUTE_PUBLIC] = KW_DEF("@public");
 	attribute_list[ATTRIBUTE_REFLECT] = KW_DEF("@reflect");
+	attribute_list[ATTRIBUTE_SAFE] = KW_DEF("@safe");
 	attribute_list[ATTRIBUTE_SAFEMACRO] = KW_DEF("@safemacro");
 	attribute_list[ATTRIBUTE_SECTION] = KW_DEF("@section");
 	attribute_list[ATTRIBUTE_TEST] = KW_DEF("@test");
 	attribute_list[ATTRIBUTE_TAG] = KW_DEF("@tag");
+	attribute_list[ATTRIBUTE_TARGET_CLONES] = KW_DEF("@target_clones");
+	attribute_list[ATTRIBUTE_UNROLL] = KW_DEF("@unroll");
 	attribute_list[ATTRIBUTE_UNUSED] = KW_DEF("@unused");
 	attribute_list[ATTRIBUTE_USED] = KW_DEF("@used");
+	attribute_list[ATTRIBUTE_VECTORIZE] = KW_DEF("@vectorize");
 	attribute_list[ATTRIBUTE_WASM] = KW_DEF("@wasm");
 	attribute_list[ATTRIBUTE_WEAK] = KW_DEF("@weak");
 	attribute_list[ATTRIBUTE_WINMAIN] = KW_DEF("@winmain");
@@ -387,62 +442,39 @@ void symtab_init(uint32_t capacity)
 }
 
 
-const char *symtab_find(const char *symbol, uint32_t len, uint32_t fnv1hash, TokenType *type)
+const char *symtab_find(const char *symbol, uint32_t len, uint32_t hash, TokenType *type)
 {
-	size_t pos = fnv1hash & symtab.bucket_mask;
-	SymtabEntry *bucket = symtab.bucket[pos];
-	while (bucket)
-	{
-		if (bucket->index == fnv1hash && len == bucket->key_len && memcmp(symbol, bucket->symbol, len) == 0)
-		{
-			*type = bucket->type;
-			return bucket->symbol;
-		}
-		bucket = bucket->next;
-	}
-	return NULL;
+	SymtabEntry *entry = symtab_entry_find(symbol, len, hash);
+	if (!entry->symbol) return NULL;
+	*type = entry->type;
+	return entry->symbol;
 }
 
 const char *symtab_preset(const char *data, TokenType type)
 {
 	uint32_t len = (uint32_t)strlen(data);
 	TokenType result = type;
-	const char *res = symtab_add(data, len, fnv1a(data, len), &result);
+	const char *res = symtab_add(data, len, symtab_hash(data, len), &result);
 	ASSERT(result == type);
 	return res;
 }
 
-const char *symtab_add(const char *data, uint32_t len, uint32_t fnv1hash, TokenType *type)
+const char *symtab_add(const char *data, uint32_t len, uint32_t hash, TokenType *type)
 {
-	size_t pos = fnv1hash & symtab.bucket_mask;
-	SymtabEntry *first_bucket = symtab.bucket[pos];
-	if (!first_bucket)
+	SymtabEntry *entry = symtab_entry_find(data, len, hash);
+	if (entry->symbol)
 	{
-		SymtabEntry *node = malloc_arena(sizeof(SymtabEntry));
-		symtab.bucket[pos] = node;
-		node->key_len = len;
-		node->next = NULL;
-		node->index = fnv1hash;
-		node->type = *type;
-		return node->symbol = str_copy(data, len);
+		*type = entry->type;
+		return entry->symbol;
 	}
-	SymtabEntry *bucket = first_bucket;
-	do
+	if (symtab.count + 1 > symtab.max_load)
 	{
-		if (bucket->index == fnv1hash && len == bucket->key_len && memcmp(data, bucket->symbol, len) == 0)
-		{
-			*type = bucket->type;
-			return bucket->symbol;
-		}
-		bucket = bucket->next;
-	} while (bucket);
-	SymtabEntry *node = malloc_arena(sizeof(SymtabEntry));
-	node->next = first_bucket;
-	symtab.bucket[pos] = node;
-	node->key_len = len;
-	node->index = fnv1hash;
-	node->type = *type;
-	return node->symbol = str_copy(data, len);
+		symtab_resize(symtab.capacity * 2);
+		entry = symtab_entry_find(data, len, hash);
+	}
+	symtab.count++;
+	*entry = (SymtabEntry) { .symbol = str_copy(data, len), .hash = hash, .key_len = (uint16_t)len, .type = *type };
+	return entry->symbol;
 }
 
 
@@ -530,57 +562,65 @@ void *stable_get(STable *table, const char *key)
 
 
 
-void htable_init(HTable *table, uint32_t initial_size)
+static inline HTEntry *htentry_find(HTEntry *entries, uint32_t capacity, void *key)
 {
-	ASSERT(initial_size && "Size must be larger than 0");
-	size_t size = next_highest_power_of_2(initial_size);
+	uint32_t mask = capacity - 1;
+	// Fibonacci hashing: the top bits of the product depend on all bits of the pointer.
+	uint64_t hash_key = (uint64_t)(uintptr_t)key * 0x9E3779B97F4A7C15ULL;
+	uint32_t index = (uint32_t)(hash_key >> 32 >> (32 - ctz(capacity)));
+	while (1)
+	{
+		HTEntry *entry = &entries[index];
+		if (entry->key == key || !entry->key) return entry;
+		index = (index + 1) & mask;
+	}
+}
 
-	size_t mem_size = initial_size * sizeof(HTEntry);
-	table->entries = calloc_arena(mem_size);
+static inline void htable_resize(HTable *table)
+{
+	ASSERT(table->capacity < MAX_HASH_SIZE && "Table size too large, exceeded max hash size");
+	uint32_t new_capacity = table->capacity << 1u;
+	HTEntry *new_data = CALLOC(new_capacity * sizeof(HTEntry));
+	for (uint32_t i = 0; i < table->capacity; i++)
+	{
+		HTEntry *entry = &table->entries[i];
+		if (!entry->key) continue;
+		*htentry_find(new_data, new_capacity, entry->key) = *entry;
+	}
+	table->entries = new_data;
+	table->max_load = (uint32_t)(new_capacity * TABLE_MAX_LOAD);
+	table->capacity = new_capacity;
+}
 
-	table->mask = size - 1;
+void htable_init(HTable *table, uint32_t initial_size)
+{
+	ASSERT(initial_size && "Size must be larger than 0");
+	uint32_t capacity = next_highest_power_of_2(initial_size);
+	table->entries = CALLOC(capacity * sizeof(HTEntry));
+	table->count = 0;
+	table->capacity = capacity;
+	table->max_load = (uint32_t)(capacity * TABLE_MAX_LOAD);
 }
 
 void *htable_set(HTable *table, void *key, void *value)
 {
+	ASSERT(key && "Cannot insert NULL key");
 	ASSERT(value && "Cannot insert NULL");
-	uint32_t idx = (((uintptr_t)key) ^ ((uintptr_t)key) >> 8) & table->mask;
-	HTEntry **entry_ref = &table->entries[idx];
-	HTEntry *entry = *entry_ref;
-	if (!entry)
-	{
-		entry = CALLOCS(HTEntry);
-		entry->key = key;
-		entry->value = value;
-		*entry_ref = entry;
-		return NULL;
-	}
-	HTEntry *first_entry = entry;
-	do
-	{
-		if (entry->key == key) return entry->value;
-		entry = entry->next;
-	} while (entry);
-
-	entry = CALLOCS(HTEntry);
+	HTEntry *entry = htentry_find(table->entries, table->capacity, key);
+	if (entry->key) return entry->value;
 	entry->key = key;
 	entry->value = value;
-	entry->next = first_entry;
-	*entry_ref = entry;
+	if (++table->count >= table->max_load) htable_resize(table);
 	return NULL;
 }
 
+uint32_t htable_count(HTable *table)
+{
+	return table->count;
+}
 
 void *htable_get(HTable *table, void *key)
 {
-	uint32_t idx = (((uintptr_t)key) ^ ((uintptr_t)key) >> 8) & table->mask;
-	HTEntry *entry = table->entries[idx];
-	if (!entry) return NULL;
-	do
-	{
-		if (entry->key == key) return entry->value;
-		entry = entry->next;
-	} while (entry);
-	return NULL;
+	if (!table->entries) return NULL;
+	return htentry_find(table->entries, table->capacity, key)->value;
 }
-
@@ -442,6 +442,12 @@ static X86Feature x86feature_from_string(const char *str)
 	return -1;
 }
 
+bool x86_feature_name_is_valid(const char *name)
+{
+	int feature = x86feature_from_string(name);
+	return feature >= 0;
+}
+
 static bool x64features_contains(X86Features *cpu_features, X86Feature feature)
 {
 	if (feature < 64)
@@ -451,6 +457,51 @@ static bool x64features_contains(X86Features *cpu_features, X86Feature feature)
 	return !!((cpu_features->bits[1]) & (1ULL << (feature - 64)));
 }
 
+/**
+ * Whether a runtime shuffle of a byte vector compiles to a single instruction (pshufb or tbl),
+ * so that table lookups over byte vectors beat scalar code. The C backend lowers vectors
+ * to loops over the elements, so it never qualifies.
+ */
+bool target_has_byte_shuffle(void)
+{
+	if (compiler.build.backend != BACKEND_LLVM) return false;
+	switch (compiler.platform.arch)
+	{
+		case ARCH_TYPE_X86_64:
+			return x64features_contains(&compiler.platform.x64.features, X86_FEAT_SSSE3);
+		case ARCH_TYPE_AARCH64:
+		case ARCH_TYPE_AARCH64_BE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * The width in bits of the widest integer SIMD register, so that code working on
+ * independent 32-bit lanes can pick its lane count. 0 when vectors are not native,
+ * which includes everything under the C backend.
+ */
+int target_int_vector_bits(void)
+{
+	if (compiler.build.backend != BACKEND_LLVM) return 0;
+	switch (compiler.platform.arch)
+	{
+		case ARCH_TYPE_X86_64:
+		{
+			X86Features *features = &compiler.platform.x64.features;
+			if (x64features_contains(features, X86_FEAT_AVX512F)) return 512;
+			if (x64features_contains(features, X86_FEAT_AVX2)) return 256;
+			return x64features_contains(features, X86_FEAT_SSE2) ? 128 : 0;
+		}
+		case ARCH_TYPE_AARCH64:
+		case ARCH_TYPE_AARCH64_BE:
+			return 128;
+		default:
+			return 0;
+	}
+}
+
 static void x86features_as_diff_to_scratch(X86Features *cpu_features, X86CpuSet set)
 {
 	X86Features diff = { .bits[0] = 0 };
@@ -1826,23 +1877,26 @@ INLINE const char *llvm_macos_target_triple(const char *triple)
 #define XTENSA_AVAILABLE 0
 #endif
 
-void *llvm_target_machine_create(void)
+void llvm_target_init(void)
 {
 	static bool llvm_initialized = false;
 
-	if (!llvm_initialized)
-	{
-		llvm_initialized = true;
+	if (llvm_initialized) return;
+	llvm_initialized = true;
 #if XTENSA_AVAILABLE
-		INITIALIZE_TARGET(Xtensa);
+	INITIALIZE_TARGET(Xtensa);
 #endif
-		INITIALIZE_TARGET(ARM);
-		INITIALIZE_TARGET(AArch64);
-		INITIALIZE_TARGET(RISCV);
-		INITIALIZE_TARGET(WebAssembly);
-		INITIALIZE_TARGET(X86);
-		// To support more targets, add them above.
-	}
+	INITIALIZE_TARGET(ARM);
+	INITIALIZE_TARGET(AArch64);
+	INITIALIZE_TARGET(RISCV);
+	INITIALIZE_TARGET(WebAssembly);
+	INITIALIZE_TARGET(X86);
+	// To support more targets, add them above.
+}
+
+void *llvm_target_machine_create(void)
+{
+	llvm_target_init();
 	char *err = NULL;
 	LLVMTargetRef target = NULL;
 	if (LLVMGetTargetFromTriple(compiler.platform.target_triple, &target, &err) != 0)
@@ -58,13 +58,23 @@ static unsigned size_slice;
 static AlignSize alignment_slice;
 static AlignSize max_alignment_vector;
 
-#define PTR_OFFSET 0
-#define INFERRED_ARRAY_OFFSET 1
-#define FLEXIBLE_ARRAY_OFFSET 2
-#define SLICE_OFFSET 3
-#define INFERRED_VECTOR_OFFSET 4
-#define OPTIONAL_OFFSET 5
-#define ARRAY_OFFSET 6
+// Derived types (pointers, optionals, arrays, vectors, slices and function pointers)
+// are hash-consed on (kind, base, len), so each exists exactly once.
+typedef struct
+{
+	Type *base;
+	ArraySize len;
+	TypeKind kind;
+	Type *type;
+} TypeInternEntry;
+
+static struct
+{
+	uint32_t count;
+	uint32_t capacity;
+	uint32_t max_load;
+	TypeInternEntry *entries;
+} intern_table;
 
 static void type_append_func_to_scratch(FunctionPrototype *prototype);
 
@@ -735,173 +745,103 @@ AlignSize type_abi_alignment(Type *type)
 	UNREACHABLE
 }
 
-static inline void create_type_cache(Type *type)
-{
-	ASSERT(type->type_cache == NULL);
-	for (int i = 0; i < ARRAY_OFFSET; i++)
-	{
-		vec_add(type->type_cache, NULL);
-	}
-}
-
-static Type *type_generate_ptr(Type *ptr_type, bool canonical)
+static inline uint32_t type_intern_hash(TypeKind kind, Type *base, ArraySize len)
 {
-	if (canonical) ptr_type = ptr_type->canonical;
-	if (!ptr_type->type_cache)
-	{
-		create_type_cache(ptr_type);
-	}
-
-	Type *ptr = ptr_type->type_cache[PTR_OFFSET];
-	if (ptr == NULL)
-	{
-		ptr = type_new(TYPE_POINTER, str_printf("%s*", ptr_type->name));
-		ptr->pointer = ptr_type;
-		ptr_type->type_cache[PTR_OFFSET] = ptr;
-		if (ptr_type == ptr_type->canonical)
-		{
-			ptr->canonical = ptr;
-		}
-		else
-		{
-			ptr->canonical = type_generate_ptr(ptr_type->canonical, true);
-		}
-	}
-	return ptr;
+	uint64_t hash = ((uintptr_t)base >> 3) * 31 + kind;
+	hash = hash * 31 + len;
+	hash ^= hash >> 29;
+	return (uint32_t)(hash ^ (hash >> 32));
 }
 
-static Type *type_generate_optional(Type *optional_type, bool canonical)
+static void type_intern_init(uint32_t capacity)
 {
-	if (canonical) optional_type = optional_type->canonical;
-	if (!optional_type->type_cache)
-	{
-		create_type_cache(optional_type);
-	}
-	Type *optional = optional_type->type_cache[OPTIONAL_OFFSET];
-	if (optional == NULL)
-	{
-		optional = type_new(TYPE_OPTIONAL, str_printf("%s?", optional_type->name));
-		optional->pointer = optional_type;
-		optional_type->type_cache[OPTIONAL_OFFSET] = optional;
-		if (optional_type == optional_type->canonical)
-		{
-			optional->canonical = optional;
-		}
-		else
-		{
-			optional->canonical = type_generate_optional(optional_type->canonical, true);
-		}
-	}
-	return optional;
+	ASSERT(is_power_of_two(capacity) && capacity > 1);
+	intern_table.entries = CALLOC(capacity * sizeof(TypeInternEntry));
+	intern_table.capacity = capacity;
+	intern_table.count = 0;
+	intern_table.max_load = (uint32_t)(TABLE_MAX_LOAD * capacity);
 }
 
-static Type *type_generate_slice(Type *arr_type, bool canonical)
+static TypeInternEntry *type_intern_find(TypeKind kind, Type *base, ArraySize len)
 {
-	if (canonical) arr_type = arr_type->canonical;
-	if (!arr_type->type_cache)
-	{
-		create_type_cache(arr_type);
-	}
-
-	Type *arr = arr_type->type_cache[SLICE_OFFSET];
-	if (arr == NULL)
+	uint32_t mask = intern_table.capacity - 1;
+	uint32_t index = type_intern_hash(kind, base, len) & mask;
+	while (1)
 	{
-		arr = type_new(TYPE_SLICE, str_printf("%s[]", arr_type->name));
-		arr->array.base = arr_type;
-		arr_type->type_cache[SLICE_OFFSET] = arr;
-		if (arr_type == arr_type->canonical)
-		{
-			arr->canonical = arr;
-		}
-		else
-		{
-			arr->canonical = type_generate_slice(arr_type->canonical, true);
-		}
+		TypeInternEntry *entry = &intern_table.entries[index];
+		if (!entry->type) return entry;
+		if (entry->base == base && entry->kind == kind && entry->len == len) return entry;
+		index = (index + 1) & mask;
 	}
-	return arr;
 }
 
-static Type *type_generate_inferred_array(Type *arr_type, bool canonical)
+static void type_intern_add(TypeKind kind, Type *base, ArraySize len, Type *type)
 {
-	if (canonical) arr_type = arr_type->canonical;
-	if (!arr_type->type_cache)
-	{
-		create_type_cache(arr_type);
-	}
-
-	Type *arr = arr_type->type_cache[INFERRED_ARRAY_OFFSET];
-	if (arr == NULL)
+	TypeInternEntry *entry = type_intern_find(kind, base, len);
+	ASSERT(!entry->type);
+	*entry = (TypeInternEntry) { .base = base, .len = len, .kind = kind, .type = type };
+	if (++intern_table.count < intern_table.max_load) return;
+	TypeInternEntry *entries = intern_table.entries;
+	uint32_t old_capacity = intern_table.capacity;
+	type_intern_init(old_capacity << 1);
+	for (uint32_t i = 0; i < old_capacity; i++)
 	{
-		arr = type_new(TYPE_INFERRED_ARRAY, str_printf("%s[*]", arr_type->name));
-		arr->array.base = arr_type;
-		arr_type->type_cache[INFERRED_ARRAY_OFFSET] = arr;
-		if (arr_type == arr_type->canonical)
-		{
-			arr->canonical = arr;
-		}
-		else
-		{
-			arr->canonical = type_generate_inferred_array(arr_type->canonical, true);
-		}
+		TypeInternEntry *old = &entries[i];
+		if (!old->type) continue;
+		*type_intern_find(old->kind, old->base, old->len) = *old;
+		intern_table.count++;
 	}
-	return arr;
 }
 
-static Type *type_generate_inferred_vector(Type *arr_type, bool canonical)
+static const char *type_derived_name(TypeKind kind, Type *base, ArraySize len)
 {
-	if (canonical) arr_type = arr_type->canonical;
-	if (!arr_type->type_cache)
-	{
-		create_type_cache(arr_type);
-	}
-
-	Type *arr = arr_type->type_cache[INFERRED_VECTOR_OFFSET];
-	if (arr == NULL)
+	switch (kind)
 	{
-		arr = type_new(TYPE_INFERRED_VECTOR, str_printf("%s[<*>]", arr_type->name));
-		arr->array.base = arr_type;
-		arr_type->type_cache[INFERRED_VECTOR_OFFSET] = arr;
-		if (arr_type == arr_type->canonical)
-		{
-			arr->canonical = arr;
-		}
-		else
-		{
-			arr->canonical = type_generate_inferred_vector(arr_type->canonical, true);
-		}
+		case TYPE_POINTER:
+			return str_printf("%s*", base->name);
+		case TYPE_OPTIONAL:
+			return str_printf("%s?", base->name);
+		case TYPE_SLICE:
+			return str_printf("%s[]", base->name);
+		case TYPE_INFERRED_ARRAY:
+		case TYPE_FLEXIBLE_ARRAY:
+			return str_printf("%s[*]", base->name);
+		case TYPE_INFERRED_VECTOR:
+			return str_printf("%s[<*>]", base->name);
+		case TYPE_ARRAY:
+			return str_printf("%s[%u]", base->name, len);
+		case TYPE_VECTOR:
+			return str_printf("%s[<%u>]", base->name, len);
+		default:
+			UNREACHABLE
 	}
-	return arr;
 }
 
-static Type *type_generate_flexible_array(Type *arr_type, bool canonical)
+static Type *type_generate_derived(TypeKind kind, Type *base, ArraySize len, bool canonical)
 {
-	if (canonical) arr_type = arr_type->canonical;
-	if (!arr_type->type_cache)
-	{
-		create_type_cache(arr_type);
-	}
+	if (canonical) base = base->canonical;
+	TypeInternEntry *entry = type_intern_find(kind, base, len);
+	if (entry->type) return entry->type;
 
-	Type *arr = arr_type->type_cache[FLEXIBLE_ARRAY_OFFSET];
-	if (arr == NULL)
+	Type *type = type_new(kind, type_derived_name(kind, base, len));
+	switch (kind)
 	{
-		arr = type_new(TYPE_FLEXIBLE_ARRAY, str_printf("%s[*]", arr_type->name));
-		arr->array.base = arr_type;
-		arr->array.len = 0;
-		arr_type->type_cache[FLEXIBLE_ARRAY_OFFSET] = arr;
-		if (arr_type == arr_type->canonical)
-		{
-			arr->canonical = arr;
-		}
-		else
-		{
-			arr->canonical = type_generate_flexible_array(arr_type->canonical, true);
-		}
+		case TYPE_POINTER:
+			type->pointer = base;
+			break;
+		case TYPE_OPTIONAL:
+			type->optional = base;
+			break;
+		default:
+			type->array.base = base;
+			type->array.len = len;
+			break;
 	}
-	return arr;
+	type_intern_add(kind, base, len, type);
+	type->canonical = base == base->canonical ? type : type_generate_derived(kind, base->canonical, len, true);
+	return type;
 }
 
-
-
 Type *type_get_ptr_recurse(Type *ptr_type)
 {
 	if (ptr_type->type_kind == TYPE_OPTIONAL)
@@ -916,47 +856,49 @@ Type *type_get_ptr(Type *ptr_type)
 {
 	ASSERT(ptr_type->type_kind != TYPE_FUNC_RAW);
 	ASSERT(!type_is_optional(ptr_type));
-	return type_generate_ptr(ptr_type, false);
+	return type_generate_derived(TYPE_POINTER, ptr_type, 0, false);
 }
 
 Type *type_get_func_ptr(Type *func_type)
 {
 	ASSERT(func_type->type_kind == TYPE_FUNC_RAW);
-	if (func_type->func_ptr) return func_type->func_ptr;
-	Type *type = func_type->func_ptr = type_new(TYPE_FUNC_PTR, func_type->name);
+	TypeInternEntry *entry = type_intern_find(TYPE_FUNC_PTR, func_type, 0);
+	if (entry->type) return entry->type;
+	Type *type = type_new(TYPE_FUNC_PTR, func_type->name);
 	type->pointer = func_type;
 	type->canonical = type;
+	type_intern_add(TYPE_FUNC_PTR, func_type, 0, type);
 	return type;
 }
 
 Type *type_get_optional(Type *optional_type)
 {
 	ASSERT(!type_is_optional(optional_type));
-	return type_generate_optional(optional_type, false);
+	return type_generate_derived(TYPE_OPTIONAL, optional_type, 0, false);
 }
 
 Type *type_get_slice(Type *arr_type)
 {
 	ASSERT(type_is_valid_for_array(arr_type));
-	return type_generate_slice(arr_type, false);
+	return type_generate_derived(TYPE_SLICE, arr_type, 0, false);
 }
 
 Type *type_get_inferred_array(Type *arr_type)
 {
 	ASSERT(type_is_valid_for_array(arr_type));
-	return type_generate_inferred_array(arr_type, false);
+	return type_generate_derived(TYPE_INFERRED_ARRAY, arr_type, 0, false);
 }
 
 Type *type_get_inferred_vector(Type *arr_type)
 {
 	ASSERT(type_is_valid_for_array(arr_type));
-	return type_generate_inferred_vector(arr_type, false);
+	return type_generate_derived(TYPE_INFERRED_VECTOR, arr_type, 0, false);
 }
 
 Type *type_get_flexible_array(Type *arr_type)
 {
 	ASSERT(type_is_valid_for_array(arr_type));
-	return type_generate_flexible_array(arr_type, false);
+	return type_generate_derived(TYPE_FLEXIBLE_ARRAY, arr_type, 0, false);
 }
 
 
@@ -1097,58 +1039,11 @@ Type *type_get_indexed_type(Type *type)
 	}
 }
 
-static Type *type_create_array(Type *element_type, ArraySize len, bool vector, bool canonical)
-{
-	if (canonical) element_type = element_type->canonical;
-	if (!element_type->type_cache)
-	{
-		create_type_cache(element_type);
-	}
-	int entries = (int)vec_size(element_type->type_cache);
-	for (int i = ARRAY_OFFSET; i < entries; i++)
-	{
-		Type *ptr_vec = element_type->type_cache[i];
-		if (vector)
-		{
-			if (ptr_vec->type_kind != TYPE_VECTOR) continue;
-			if (ptr_vec->array.len == len) return ptr_vec;
-		}
-		else
-		{
-			if (ptr_vec->type_kind == TYPE_VECTOR) continue;
-			if (ptr_vec->array.len == len) return ptr_vec;
-		}
-	}
-	Type *vec_arr;
-	if (vector)
-	{
-		vec_arr = type_new(TYPE_VECTOR, str_printf("%s[<%u>]", element_type->name, len));
-		vec_arr->array.base = element_type;
-		vec_arr->array.len = len;
-	}
-	else
-	{
-		vec_arr = type_new(TYPE_ARRAY, str_printf("%s[%u]", element_type->name, len));
-		vec_arr->array.base = element_type;
-		vec_arr->array.len = len;
-	}
-	if (element_type->canonical == element_type)
-	{
-		vec_arr->canonical = vec_arr;
-	}
-	else
-	{
-		vec_arr->canonical = type_create_array(element_type, len, vector, true);
-	}
-	vec_add(element_type->type_cache, vec_arr);
-	return vec_arr;
-}
-
 Type *type_get_array(Type *arr_type, ArraySize len)
 {
 	ASSERT(len > 0 && "Created a zero length array");
 	ASSERT(type_is_valid_for_array(arr_type));
-	return type_create_array(arr_type, len, false, false);
+	return type_generate_derived(TYPE_ARRAY, arr_type, len, false);
 }
 
 bool type_is_valid_for_vector(Type *type)
@@ -1234,7 +1129,7 @@ Type *type_get_vector_bool(Type *original_type)
 Type *type_get_vector(Type *vector_type, unsigned len)
 {
 	ASSERT(type_is_valid_for_vector(vector_type));
-	return type_create_array(vector_type, len, true, false);
+	return type_generate_derived(TYPE_VECTOR, vector_type, len, false);
 }
 
 static void type_create(const char *name, Type *location, TypeKind kind, unsigned bitsize,
@@ -1317,7 +1212,7 @@ Type *type_create_struct(const char *name, Type **types, const char **names, int
 {
 	Decl *decl = decl_new_with_type(symtab_preset(name, TOKEN_TYPE_IDENT), INVALID_SPAN, DECL_STRUCT);
 	decl->unit = compiler.context.core_unit;
-	decl->extname = decl->name;
+	decl_set_extname(decl, decl->name);
 	AlignSize offset = 0;
 	AlignSize max_align = 0;
 	for (int i = 0; i < count; i++)
@@ -1343,6 +1238,7 @@ Type *type_create_struct(const char *name, Type **types, const char **names, int
 }
 void type_setup(PlatformTarget *target)
 {
+	type_intern_init(0x4000);
 	max_alignment_vector = (AlignSize)target->align_max_vector;
 
 	type_create_float("float16", &t.f16, TYPE_F16, BITS16);
@@ -1373,9 +1269,8 @@ void type_setup(PlatformTarget *target)
 	type_create("void", &t.wildcard, TYPE_WILDCARD, 1, 1, 1);
 	type_init("typeid", &t.typeid, TYPE_TYPEID, target->width_pointer, target->align_pointer);
 	type_init("void*", &t.voidstar, TYPE_POINTER, target->width_pointer, target->align_pointer);
-	create_type_cache(type_void);
-	type_void->type_cache[0] = &t.voidstar;
 	t.voidstar.pointer = type_void;
+	type_intern_add(TYPE_POINTER, type_void, 0, &t.voidstar);
 	type_create("any", &t.any, TYPE_ANY, target->width_pointer * 2, target->align_pointer.align, target->align_pointer.pref_align);
 
 	type_create_alias("usz", &t.usz, type_int_unsigned_by_bitsize(target->width_pointer));
@@ -1390,7 +1285,7 @@ void type_setup(PlatformTarget *target)
 	type_wildcard_optional = type_get_optional(type_wildcard);
 	Decl *string_decl = decl_new_with_type(symtab_preset("String", TOKEN_TYPE_IDENT), INVALID_SPAN, DECL_DISTINCT);
 	string_decl->unit = compiler.context.core_unit;
-	string_decl->extname = string_decl->name;
+	decl_set_extname(string_decl, string_decl->name);
 	string_decl->is_substruct = true;
 	string_decl->distinct = type_info_new_base(type_chars, INVALID_SPAN);
 	string_decl->resolve_status = RESOLVE_DONE;
@@ -0,0 +1,235 @@
+// Copyright (c) 2026 Christoffer Lerno. All rights reserved.
+// Use of this source code is governed by the GNU LGPLv3.0 license
+// a copy of which can be found in the LICENSE file.
+
+#include "compiler_internal.h"
+#include <errno.h>
+
+// In watch mode the process forks for every build, like the daemon does for
+// every request. When a build finishes, the child sends the files it depended
+// on (sources, $include, $embed and $exec files and the project file) back over a
+// pipe, as zero terminated strings. The parent then waits for one of them to
+// change and starts the next build.
+
+#if PLATFORM_WINDOWS
+
+void compiler_watch(BuildOptions *options)
+{
+	error_exit("Watch mode is not supported on Windows.");
+}
+
+void compiler_watch_report(void)
+{
+}
+
+#else
+
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#endif
+
+#define WATCH_POLL_MS 250
+#define WATCH_SETTLE_MS 50
+
+static int watch_report_fd = -1;
+
+typedef struct
+{
+	char *paths;
+	size_t len;
+} WatchList;
+
+static void watch_report_path(const char *path)
+{
+	size_t len = strlen(path) + 1;
+	const char *ptr = path;
+	while (len)
+	{
+		ssize_t written = write(watch_report_fd, ptr, len);
+		if (written < 0 && errno == EINTR) continue;
+		if (written <= 0) return;
+		ptr += written;
+		len -= (size_t)written;
+	}
+}
+
+void compiler_watch_report(void)
+{
+	if (watch_report_fd < 0) return;
+	FOREACH(const char *, path, compiler_input_files()) watch_report_path(path);
+	close(watch_report_fd);
+	watch_report_fd = -1;
+}
+
+static void watch_read_list(int fd, WatchList *list)
+{
+	size_t capacity = 4096;
+	char *data = malloc(capacity);
+	size_t len = 0;
+	while (1)
+	{
+		if (len == capacity) data = realloc(data, capacity *= 2);
+		ssize_t read_len = read(fd, data + len, capacity - len);
+		if (read_len < 0 && errno == EINTR) continue;
+		if (read_len <= 0) break;
+		len += (size_t)read_len;
+	}
+	close(fd);
+	// A build that ended without reporting keeps watching the previous files.
+	if (!len)
+	{
+		free(data);
+		return;
+	}
+	free(list->paths);
+	list->paths = data;
+	list->len = len;
+}
+
+#define WATCH_FOREACH_PATH(list__, path__) \
+	for (const char *path__ = (list__)->paths; path__ && path__ < (list__)->paths + (list__)->len; path__ += strlen(path__) + 1)
+
+#if defined(__linux__)
+
+/**
+ * Watch the directories of the files rather than the files themselves, since
+ * many editors save by writing a new file and renaming it over the old one.
+ */
+static bool watch_wait_for_change(WatchList *list)
+{
+	int fd = inotify_init1(IN_CLOEXEC);
+	if (fd < 0) return false;
+	uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM;
+	const char **dirs = NULL;
+	WATCH_FOREACH_PATH(list, path)
+	{
+		char *dir = file_get_dir(path);
+		int wd = inotify_add_watch(fd, dir, mask);
+		if (wd < 0) continue;
+		// Watch descriptors are reused for the same directory.
+		while (vec_size(dirs) <= (unsigned)wd) vec_add(dirs, NULL);
+		dirs[wd] = dir;
+	}
+	if (!dirs)
+	{
+		close(fd);
+		return false;
+	}
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	bool changed = false;
+	while (!changed)
+	{
+		ssize_t len = read(fd, buffer, sizeof(buffer));
+		if (len < 0 && errno == EINTR) continue;
+		if (len <= 0) break;
+		for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *)ptr)->len)
+		{
+			struct inotify_event *event = (struct inotify_event *)ptr;
+			if (!event->len || event->wd < 0 || (unsigned)event->wd >= vec_size(dirs) || !dirs[event->wd]) continue;
+			const char *changed_path = file_append_path(dirs[event->wd], event->name);
+			WATCH_FOREACH_PATH(list, path)
+			{
+				if (str_eq(path, changed_path))
+				{
+					changed = true;
+					break;
+				}
+			}
+			if (changed) break;
+		}
+	}
+	// Let the editor finish writing, and drop the events of the same save.
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	while (changed && poll(&pfd, 1, WATCH_SETTLE_MS) > 0)
+	{
+		if (read(fd, buffer, sizeof(buffer)) <= 0) break;
+	}
+	close(fd);
+	return changed;
+}
+
+#else
+
+static bool watch_wait_for_change(WatchList *list)
+{
+	return false;
+}
+
+#endif
+
+/**
+ * Used when file notifications aren't available: compare size and mtime.
+ */
+static void watch_poll_for_change(WatchList *list)
+{
+	unsigned count = 0;
+	WATCH_FOREACH_PATH(list, path) count++;
+	size_t *sizes = calloc(count, sizeof(size_t));
+	int64_t *mtimes = calloc(count, sizeof(int64_t));
+	unsigned index = 0;
+	WATCH_FOREACH_PATH(list, path)
+	{
+		file_size_and_mtime(path, &sizes[index], &mtimes[index]);
+		index++;
+	}
+	while (1)
+	{
+		struct timespec delay = { .tv_nsec = WATCH_POLL_MS * 1000000L };
+		nanosleep(&delay, NULL);
+		index = 0;
+		WATCH_FOREACH_PATH(list, path)
+		{
+			size_t size = 0;
+			int64_t mtime = 0;
+			file_size_and_mtime(path, &size, &mtime);
+			if (size != sizes[index] || mtime != mtimes[index])
+			{
+				free(sizes);
+				free(mtimes);
+				return;
+			}
+			index++;
+		}
+	}
+}
+
+void compiler_watch(BuildOptions *options)
+{
+	WatchList list = { 0 };
+	while (1)
+	{
+		int fds[2];
+		if (pipe(fds)) error_exit("Failed to create the watch pipe: %s.", strerror(errno));
+		// Programs started by the build must not hold on to the pipe.
+		fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+		fflush(stdout);
+		fflush(stderr);
+		pid_t pid = fork();
+		if (pid < 0) error_exit("Failed to start a build: %s.", strerror(errno));
+		if (!pid)
+		{
+			close(fds[0]);
+			watch_report_fd = fds[1];
+			return;
+		}
+		close(fds[1]);
+		watch_read_list(fds[0], &list);
+		int status;
+		while (waitpid(pid, &status, 0) < 0)
+		{
+			if (errno != EINTR) error_exit("Failed to wait for the build: %s.", strerror(errno));
+		}
+		bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if (!list.len) error_exit("The build stopped before any files were loaded, nothing to watch.");
+		printf("%s, watching for changes.\n", success ? "Build finished" : "Build failed");
+		fflush(stdout);
+		if (!watch_wait_for_change(&list)) watch_poll_for_change(&list);
+		printf("\nChange detected, rebuilding.\n");
+	}
+}
+
+#endif
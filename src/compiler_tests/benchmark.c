@@ -8,6 +8,28 @@
 
 BenchTime begin;
 
+typedef struct
+{
+	char *name;
+	const char *category;
+	double start;
+	double duration;
+	unsigned thread;
+} TraceEvent;
+
+bool trace_active = false;
+static const char *trace_file;
+static TraceEvent *trace_events;
+static size_t trace_event_count;
+static size_t trace_event_capacity;
+static unsigned trace_threads;
+
+#if defined(_MSC_VER)
+static __declspec(thread) unsigned trace_thread_id;
+#else
+static _Thread_local unsigned trace_thread_id;
+#endif
+
 #if USE_PTHREAD
 
 void bench_begin(void)
@@ -61,3 +83,103 @@ double benchmark(BenchTime start)
 
 #endif
 
+
+#if PLATFORM_WINDOWS
+#include <windows.h>
+static SRWLOCK trace_lock = SRWLOCK_INIT;
+#define TRACE_LOCK() AcquireSRWLockExclusive(&trace_lock)
+#define TRACE_UNLOCK() ReleaseSRWLockExclusive(&trace_lock)
+#elif USE_PTHREAD
+#include <pthread.h>
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+#define TRACE_LOCK() pthread_mutex_lock(&trace_lock)
+#define TRACE_UNLOCK() pthread_mutex_unlock(&trace_lock)
+#else
+#define TRACE_LOCK() do {} while (0)
+#define TRACE_UNLOCK() do {} while (0)
+#endif
+
+void trace_init(const char *filename)
+{
+	trace_file = filename;
+	trace_active = filename != NULL;
+}
+
+// This may be called from the codegen threads, so only use malloc here.
+void trace_end(const char *category, const char *name, const char *detail, double start)
+{
+	if (!trace_active) return;
+	double end = bench_mark();
+	size_t len = strlen(name) + (detail ? strlen(detail) + 1 : 0) + 1;
+	char *full_name = malloc(len);
+	if (detail)
+	{
+		snprintf(full_name, len, "%s %s", name, detail);
+	}
+	else
+	{
+		memcpy(full_name, name, len);
+	}
+	TRACE_LOCK();
+	// Threads are numbered in order of their first event, with the main thread first.
+	if (!trace_thread_id) trace_thread_id = ++trace_threads;
+	if (trace_event_count == trace_event_capacity)
+	{
+		trace_event_capacity = trace_event_capacity ? trace_event_capacity * 2 : 1024;
+		trace_events = realloc(trace_events, trace_event_capacity * sizeof(TraceEvent));
+		if (!trace_events) error_exit("Out of memory recording trace events.");
+	}
+	trace_events[trace_event_count++] = (TraceEvent) { .name = full_name, .category = category, .start = start,
+	                                                   .duration = end - start, .thread = trace_thread_id };
+	TRACE_UNLOCK();
+}
+
+static void trace_print_json_string(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (const char *c = str; *c; c++)
+	{
+		switch (*c)
+		{
+			case '"':
+				fputs("\\\"", file);
+				break;
+			case '\\':
+				fputs("\\\\", file);
+				break;
+			default:
+				if ((unsigned char)*c < 0x20)
+				{
+					fprintf(file, "\\u%04x", (unsigned char)*c);
+					break;
+				}
+				fputc(*c, file);
+				break;
+		}
+	}
+	fputc('"', file);
+}
+
+void trace_write(void)
+{
+	if (!trace_active) return;
+	trace_active = false;
+	FILE *file = fopen(trace_file, "w");
+	if (!file) error_exit("Failed to open '%s' for writing the trace.", trace_file);
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	for (size_t i = 0; i < trace_event_count; i++)
+	{
+		TraceEvent *event = &trace_events[i];
+		fputs("{\"name\":", file);
+		trace_print_json_string(file, event->name);
+		fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+		        event->category, event->start * 1000000, event->duration * 1000000, event->thread,
+		        i + 1 < trace_event_count ? "," : "");
+		free(event->name);
+	}
+	fputs("]}\n", file);
+	fclose(file);
+	free(trace_events);
+	trace_events = NULL;
+	trace_event_count = trace_event_capacity = 0;
+}
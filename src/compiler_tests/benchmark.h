@@ -5,6 +5,7 @@
 // a copy of which can be found in the LICENSE file.
 
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -18,3 +19,13 @@ void bench_begin(void);
 double bench_mark(void);
 BenchTime benchstart(void);
 double benchmark(BenchTime start);
+
+// Chrome trace event timeline, enabled with --trace-out. Spans are
+// recorded from any thread, and written out by trace_write.
+extern bool trace_active;
+void trace_init(const char *filename);
+void trace_end(const char *category, const char *name, const char *detail, double start);
+void trace_write(void);
+
+// Returns the span start, to be passed to trace_end.
+static inline double trace_begin(void) { return trace_active ? bench_mark() : 0; }
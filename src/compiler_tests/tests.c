@@ -188,14 +188,90 @@ static void test_json(void)
 	TEST_ASSERT(strcmp(array->elements[0]->str, "hello\nworld\t.") == 0, "Mismatching string");
 }
 
+static void test_taskqueue_task(void *arg)
+{
+	(*(int *)arg)++;
+}
+
+static void test_taskqueue(void)
+{
+	printf("Begin taskqueue testing.\n");
+	static int runs[200];
+	static Task tasks[200];
+	Task **task_list = NULL;
+	for (int i = 0; i < 200; i++)
+	{
+		runs[i] = 0;
+		tasks[i] = (Task) { &test_taskqueue_task, &runs[i], (size_t)(i * 7919 % 13) };
+		vec_add(task_list, &tasks[i]);
+	}
+	taskqueue_run(task_list);
+	for (int i = 0; i < 200; i++)
+	{
+		TEST_ASSERTF(runs[i] == 1, "Task %d ran %d times", i, runs[i]);
+	}
+	printf("-- Tested taskqueue - OK.\n");
+}
+
+static void test_symtab(void)
+{
+	printf("Begin symtab testing.\n");
+	// Start small so that the table has to grow several times.
+	const char *interned[5000];
+	for (int i = 0; i < 5000; i++)
+	{
+		char name[32];
+		int len = snprintf(name, sizeof(name), "symtab_test_%d", i);
+		TokenType type = TOKEN_IDENT;
+		interned[i] = symtab_add(name, (uint32_t)len, symtab_hash(name, (uint32_t)len), &type);
+		TEST_ASSERTF(type == TOKEN_IDENT && strcmp(interned[i], name) == 0, "Failed to intern %s", name);
+	}
+	for (int i = 0; i < 5000; i++)
+	{
+		char name[32];
+		int len = snprintf(name, sizeof(name), "symtab_test_%d", i);
+		TokenType type = TOKEN_INVALID_TOKEN;
+		TEST_ASSERTF(symtab_find(name, (uint32_t)len, symtab_hash(name, (uint32_t)len), &type) == interned[i], "Lost %s after resize", name);
+		TEST_ASSERTF(type == TOKEN_IDENT, "Wrong type for %s", name);
+	}
+	TokenType type = TOKEN_INVALID_TOKEN;
+	TEST_ASSERT(symtab_find("return", 6, symtab_hash("return", 6), &type) == kw_return && type == TOKEN_RETURN, "Lost keyword after resize");
+	TEST_ASSERT(!symtab_find("symtab_test_x", 13, symtab_hash("symtab_test_x", 13), &type), "Found missing symbol");
+	printf("-- Tested symtab - OK.\n");
+}
+
+static void test_htable(void)
+{
+	printf("Begin htable testing.\n");
+	static int keys[3000];
+	HTable table;
+	htable_init(&table, 16);
+	for (int i = 0; i < 3000; i++)
+	{
+		TEST_ASSERTF(htable_set(&table, &keys[i], &keys[(i + 1) % 3000]) == NULL, "Key %d was already set", i);
+	}
+	TEST_ASSERT(htable_set(&table, &keys[0], &keys[2]) == &keys[1], "Expected the existing value to be returned");
+	TEST_ASSERTF(htable_count(&table) == 3000, "Expected 3000 entries, was %u", htable_count(&table));
+	for (int i = 0; i < 3000; i++)
+	{
+		TEST_ASSERTF(htable_get(&table, &keys[i]) == &keys[(i + 1) % 3000], "Lost key %d after resize", i);
+	}
+	TEST_ASSERT(htable_get(&table, &table) == NULL, "Found missing key");
+	printf("-- Tested htable - OK.\n");
+}
+
 void compiler_tests(void)
 {
-	symtab_init(0x100000);
+	symtab_init(0x100);
+	// The arena tests release the arena, so the symtab must be tested first.
+	test_symtab();
 
 	test_file();
 	test128();
 	run_arena_allocator_tests();
 
 	test_json();
+	test_taskqueue();
+	test_htable();
 	exit_compiler(COMPILER_SUCCESS_EXIT);
 }
\ No newline at end of file
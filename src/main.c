@@ -2,6 +2,7 @@
 #include "compiler/compiler.h"
 #include "compiler_tests/tests.h"
 #include "utils/lib.h"
+#include "utils/vmem.h"
 #include <compiler_tests/benchmark.h>
 
 
@@ -17,6 +18,8 @@ NORETURN void exit_compiler(int exit_value)
 
 static void cleanup()
 {
+	compiler_watch_report();
+	trace_write();
 	symtab_destroy();
 	memory_release();
 }
@@ -43,11 +46,21 @@ int main_real(int argc, const char *argv[])
 	long long max_mem = 0;
 	for (int i = 0; i < argc; i++)
 	{
+		if (str_eq(argv[i], "--huge-pages"))
+		{
+			vmem_set_huge_pages(true);
+			continue;
+		}
+		if (str_eq(argv[i], "--daemon") && i < argc - 1)
+		{
+			int result = compiler_daemon_request(argv[i + 1], argc, argv);
+			if (result >= 0) return result;
+			continue;
+		}
 		if (str_eq(argv[i], "--max-mem") && i < argc - 1)
 		{
 			max_mem = atoll(argv[i + 1]);
 			if (max_mem) max_mem = next_highest_power_of_2(max_mem);
-			break;
 		}
 	}
 	// First setup memory
@@ -55,6 +68,15 @@ int main_real(int argc, const char *argv[])
 
 	// Parse arguments.
 	BuildOptions build_options = parse_arguments(argc, argv);
+	if (build_options.command == COMMAND_DAEMON)
+	{
+		// This only returns in the process handling a request, with its arguments.
+		compiler_daemon(&build_options, &argc, &argv);
+		build_options = parse_arguments(argc, argv);
+	}
+	// This only returns in the process running a build.
+	if (build_options.watch) compiler_watch(&build_options);
+	trace_init(build_options.trace_file);
 
 	// Init the compiler
 	compiler_init(&build_options);
@@ -113,10 +135,13 @@ int main_real(int argc, const char *argv[])
 					break;
 			}
 			break;
+		case COMMAND_DAEMON:
 		case COMMAND_MISSING:
 			UNREACHABLE
 	}
 
+	compiler_watch_report();
+	trace_write();
 	symtab_destroy();
 	memory_release();
 	return 0;
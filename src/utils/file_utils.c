@@ -11,10 +11,22 @@
 #include <windows.h>
 #endif
 
+#if PLATFORM_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#define FILE_IN_MEMORY_PREFIX "/proc/self/fd/"
+#endif
+
 #ifndef _MSC_VER
 #include <dirent.h>
 #include <unistd.h>
+#include <utime.h>
 #else
+#include <sys/utime.h>
 #include <fileapi.h>
 #include <stringapiset.h>
 
@@ -221,7 +233,13 @@ bool file_touch(const char *path)
 	FILE *file = fopen(path, "a");
 #endif
 	if (!file) return false;
-	return fclose(file) == 0;
+	if (fclose(file) != 0) return false;
+	// Opening the file doesn't change it, so set the modification time explicitly.
+#if (_MSC_VER)
+	return _wutime(win_utf8to16(path), NULL) == 0;
+#else
+	return utime(path, NULL) == 0;
+#endif
 }
 
 size_t file_clean_buffer(char *buffer, const char *path, size_t file_size)
@@ -267,6 +285,119 @@ bool file_write_all(const char *path, const char *data, size_t len)
 	return success;
 }
 
+/**
+ * Write the data unless the file already has exactly this content,
+ * in which case the file and its modification time are left as is.
+ */
+bool file_write_if_changed(const char *path, const char *data, size_t len)
+{
+	size_t old_len;
+	char *old = file_try_read_all(path, &old_len);
+	bool unchanged = old && old_len == len && memcmp(old, data, len) == 0;
+	free(old);
+	if (unchanged) return true;
+	return file_write_all(path, data, len);
+}
+
+#if defined(_MSC_VER)
+static __declspec(thread) unsigned temp_name_counter;
+#else
+static _Thread_local unsigned temp_name_counter;
+#endif
+
+/**
+ * Get a name next to 'path' to write to before renaming the file into place. It
+ * holds the process id, and the address of a thread local counter together with
+ * its next value, so no other process or thread gets the same name.
+ *
+ * @return the malloc'ed name, as this may be called from worker threads.
+ */
+char *file_temp_name(const char *path)
+{
+#if PLATFORM_WINDOWS
+	unsigned long pid = (unsigned long)GetCurrentProcessId();
+#else
+	unsigned long pid = (unsigned long)getpid();
+#endif
+	unsigned long long thread = (unsigned long long)(uintptr_t)&temp_name_counter;
+	unsigned count = temp_name_counter++;
+	int len = snprintf(NULL, 0, "%s.%lu.%llx.%u.tmp", path, pid, thread, count);
+	char *name = malloc((size_t)len + 1);
+	snprintf(name, (size_t)len + 1, "%s.%lu.%llx.%u.tmp", path, pid, thread, count);
+	return name;
+}
+
+/**
+ * Store data in a cache entry, prefixed by the full key it belongs to, so that a
+ * lookup can tell a hit from another key which happens to have the same file name.
+ * The entry is written under a temporary name and then renamed, so concurrent
+ * builds never see a partial entry.
+ */
+bool file_cache_store(const char *path, const char *key, size_t key_len, const char *data, size_t len)
+{
+	char *temp_name = file_temp_name(path);
+	FILE *file = file_open_write(temp_name);
+	bool success = false;
+	if (file)
+	{
+		uint64_t stored_len = key_len;
+		success = fwrite(&stored_len, sizeof(stored_len), 1, file) == 1
+			&& fwrite(key, 1, key_len, file) == key_len
+			&& fwrite(data, 1, len, file) == len;
+		success = !fclose(file) && success;
+	}
+	if (!success || rename(temp_name, path) != 0)
+	{
+		remove(temp_name);
+		success = false;
+	}
+	free(temp_name);
+	return success;
+}
+
+/**
+ * Get the data of a cache entry written by file_cache_store, if it was stored with
+ * exactly this key.
+ *
+ * @return the malloc'ed data, or NULL if there is no entry for the key.
+ */
+char *file_cache_fetch(const char *path, const char *key, size_t key_len, size_t *return_size)
+{
+	size_t size;
+	char *entry = file_try_read_all(path, &size);
+	if (!entry) return NULL;
+	uint64_t stored_len;
+	size_t header = sizeof(stored_len) + key_len;
+	if (size < header) goto MISS;
+	memcpy(&stored_len, entry, sizeof(stored_len));
+	if (stored_len != key_len || memcmp(entry + sizeof(stored_len), key, key_len) != 0) goto MISS;
+	*return_size = size - header;
+	memmove(entry, entry + header, *return_size + 1);
+	return entry;
+MISS:
+	free(entry);
+	return NULL;
+}
+
+/**
+ * Create an anonymous file backed by memory. The returned path can be used
+ * to write and read the file from within this process only, and the memory
+ * is released by calling file_delete_file on it.
+ *
+ * @return the path, or NULL if memory backed files are not available.
+ */
+const char *file_create_in_memory(const char *name)
+{
+#if defined(FILE_IN_MEMORY_PREFIX) && defined(SYS_memfd_create)
+	// Close on exec, since the path is only meaningful in this process.
+	int fd = (int)syscall(SYS_memfd_create, name, 1 /* MFD_CLOEXEC */);
+	if (fd < 0) return NULL;
+	return str_printf(FILE_IN_MEMORY_PREFIX "%d", fd);
+#else
+	return NULL;
+#endif
+}
+
 char *file_read_all(const char *path, size_t *return_size)
 {
 	FILE *file = file_open_read(path);
@@ -300,6 +431,125 @@ char *file_read_all(const char *path, size_t *return_size)
 	return buffer;
 }
 
+// Like file_read_all, but safe to call from worker threads: the buffer is
+// malloc'ed, not cleaned, and NULL is returned on failure instead of exiting.
+char *file_try_read_all(const char *path, size_t *return_size)
+{
+	FILE *file = file_open_read(path);
+	if (file == NULL) return NULL;
+
+	fseek(file, 0L, SEEK_END);
+	size_t file_size = (size_t)ftell(file);
+	rewind(file);
+
+	char *buffer = malloc(file_size + 1);
+	if (!buffer)
+	{
+		fclose(file);
+		return NULL;
+	}
+	size_t bytes_read = fread(buffer, sizeof(char), file_size, file);
+	fclose(file);
+	if (bytes_read < file_size)
+	{
+		free(buffer);
+		return NULL;
+	}
+	buffer[bytes_read] = '\0';
+	*return_size = bytes_read;
+	return buffer;
+}
+
+// Mapped sources must have some zeroed slack after the last byte, since the
+// lexer relies on a zero terminator and may peek a few characters ahead.
+#define FILE_MAP_MIN_SLACK 16
+
+static size_t file_page_size(void)
+{
+#if PLATFORM_WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Map a file read only into memory, returning NULL if it can't be mapped or if the
+// mapping would not end in zeroed slack, in which case a normal read should be used.
+// This only uses system calls, so it is safe to call from worker threads.
+const char *file_map_read_only(const char *path, size_t *return_size)
+{
+#if PLATFORM_WINDOWS
+	uint16_t *wpath = win_utf8to16(path);
+	HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	free(wpath);
+	if (file == INVALID_HANDLE_VALUE) return NULL;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || !file_size.QuadPart)
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+	size_t size = (size_t)file_size.QuadPart;
+	size_t page_size = file_page_size();
+	size_t tail = size % page_size;
+	if (!tail || tail > page_size - FILE_MAP_MIN_SLACK)
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping) return NULL;
+	const char *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data) return NULL;
+	*return_size = size;
+	return data;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return NULL;
+	struct stat info;
+	if (fstat(fd, &info) || !S_ISREG(info.st_mode) || !info.st_size)
+	{
+		close(fd);
+		return NULL;
+	}
+	size_t size = (size_t)info.st_size;
+	size_t page_size = file_page_size();
+	size_t tail = size % page_size;
+	if (!tail || tail > page_size - FILE_MAP_MIN_SLACK)
+	{
+		close(fd);
+		return NULL;
+	}
+	void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return NULL;
+	*return_size = size;
+	return data;
+#endif
+}
+
+void file_unmap(const char *data, size_t size)
+{
+#if PLATFORM_WINDOWS
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, size);
+#endif
+}
+
+// Returns true if file_clean_buffer would need to rewrite (or reject) the buffer.
+bool file_buffer_needs_cleaning(const char *buffer, size_t size)
+{
+	if (!size) return false;
+	if (buffer[0] == (char)0xFF || (size >= 2 && buffer[1] == (char)0xFE)) return true;
+	if (size >= 3 && buffer[0] == (char)0xEF && buffer[1] == (char)0xBB && buffer[2] == (char)0xBF) return true;
+	return memchr(buffer, '\r', size) != NULL;
+}
+
 static bool file_read(FILE *file, char *buffer, size_t *read)
 {
 	size_t to_read = *read;
@@ -514,6 +764,15 @@ bool file_exists(const char *path)
 	return S_ISDIR(st.st_mode) || S_ISREG(st.st_mode) || S_ISREG(st.st_mode);
 }
 
+bool file_size_and_mtime(const char *path, size_t *size, int64_t *mtime)
+{
+	struct stat st;
+	if (stat(path, &st) || !S_ISREG(st.st_mode)) return false;
+	*size = (size_t)st.st_size;
+	*mtime = (int64_t)st.st_mtime;
+	return true;
+}
+
 #define PATH_BUFFER_SIZE 16384
 static char path_buffer[PATH_BUFFER_SIZE];
 
@@ -582,6 +841,10 @@ void file_copy_file(const char *src_path, const char *dst_path, bool overwrite)
 bool file_delete_file(const char *path)
 {
 	ASSERT(path);
+#if defined(FILE_IN_MEMORY_PREFIX)
+	int memory_fd;
+	if (sscanf(path, FILE_IN_MEMORY_PREFIX "%d", &memory_fd) == 1) return !close(memory_fd);
+#endif
 #if (_MSC_VER)
 	return DeleteFileW(win_utf8to16(path));
 #else
@@ -668,17 +931,31 @@ void file_add_wildcard_files(const char ***files, const char *path, bool recursi
 		DEBUG_LOG("Searching file %s", ent->d_name);
 		if (namelen < 3 || !file_has_suffix_in_list(ent->d_name, namelen, suffix_list, suffix_count))
 		{
+			if (!recursive) continue;
+#ifdef DT_DIR
+			// The entry type avoids a stat per file, which is slow on network file systems.
+			if (ent->d_type != DT_DIR && ent->d_type != DT_LNK && ent->d_type != DT_UNKNOWN) continue;
+#endif
 			char *format = path_ends_with_slash ? "%s%s" : "%s/%s";
 			char *new_path = str_printf(format, path, ent->d_name);
 			bool is_directory;
-			struct stat st;
-			if (stat(new_path, &st))
+#ifdef DT_DIR
+			if (ent->d_type == DT_DIR)
 			{
-				DEBUG_LOG("Failed to stat %s", new_path);
-				continue;
+				is_directory = true;
+			}
+			else
+#endif
+			{
+				struct stat st;
+				if (stat(new_path, &st))
+				{
+					DEBUG_LOG("Failed to stat %s", new_path);
+					continue;
+				}
+				is_directory = S_ISDIR(st.st_mode);
 			}
-			is_directory = S_ISDIR(st.st_mode);
-			if (is_directory && ent->d_name[0] != '.' && recursive)
+			if (is_directory)
 			{
 				DEBUG_LOG("Enter sub dir %s", ent->d_name);
 				file_add_wildcard_files(files, new_path, recursive, suffix_list, suffix_count);
@@ -98,39 +98,313 @@ END:
 	return NULL;
 }
 
+// WinHTTP downloads run one at a time, without resuming or caching.
+void download_files(Download *downloads, unsigned count, const char *cache_dir, DownloadDone on_done)
+{
+	(void)cache_dir;
+	for (unsigned i = 0; i < count; i++)
+	{
+		Download *download = &downloads[i];
+		const char *url = download->url;
+		const char *host = strstr(url, "://");
+		const char *resource = strchr(host ? host + 3 : url, '/');
+		if (!resource) resource = url + strlen(url);
+		download->error = download_file(str_copy(url, (size_t)(resource - url)), resource[0] ? resource : "/", download->file_path);
+		if (on_done) on_done(download, i + 1, count);
+	}
+}
+
 #elif CURL_FOUND
 #include <curl/curl.h>
 
+#define DOWNLOAD_MAX_PER_HOST 4
+#define DOWNLOAD_STALL_SECONDS 30
+
+// A download goes to '<file>.part' and is renamed when complete. A failed
+// download keeps the part and its ETag in '<file>.part.etag', and the next
+// attempt resumes it with a range request, guarded by If-Range so that
+// a changed file is fetched from the start instead.
+//
+// With a cache directory, each url is kept as '<hash of url>.c3l' with a
+// '.meta' file holding its ETag and a hash of the content. A cached copy is
+// revalidated with If-None-Match, and used as is when the server answers
+// 304 or cannot be reached.
+typedef struct
+{
+	Download *download;
+	CURL *handle;
+	struct curl_slist *headers;
+	FILE *file;
+	const char *part_path;
+	const char *etag_path;
+	const char *cache_path;
+	const char *cache_meta_path;
+	const char *cached_etag;
+	char etag[256];
+	bool resumed;
+} Transfer;
+
 static size_t write_data(void *ptr, size_t size, size_t nmemb, void *stream)
 {
 	return fwrite(ptr, size, nmemb, (FILE *)stream);
 }
 
-const char *download_file(const char *url, const char *resource, const char *file_path)
+static size_t transfer_header(char *buffer, size_t size, size_t nitems, void *data)
 {
-	CURL *curl_handle = curl_easy_init();
-	if (!curl_handle) error_exit("Could not initialize cURL subsystem.");
-	FILE* file = fopen(file_path, "w+b");
-	if (!file) return str_printf("Failed to open file '%s' for output", file_path);
-	const char *total_url = str_printf("%s%s", url, resource);
-	curl_easy_setopt(curl_handle, CURLOPT_URL, total_url);
-	curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1L);
-	curl_easy_setopt(curl_handle, CURLOPT_VERBOSE, 0L);
-	// Enable this later
-	curl_easy_setopt(curl_handle, CURLOPT_NOPROGRESS, 1L);
-	curl_easy_setopt(curl_handle, CURLOPT_FAILONERROR, 1L);
-	curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_data);
-	curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, file);
-	CURLcode result = curl_easy_perform(curl_handle);
-	if (curl_easy_perform(curl_handle) != CURLE_OK)
-	{
-
-		fclose(file);
-		remove(file_path);
-		return curl_easy_strerror(result);
+	Transfer *transfer = data;
+	size_t len = size * nitems;
+	if (len > 5 && strncasecmp(buffer, "etag:", 5) == 0)
+	{
+		const char *value = buffer + 5;
+		const char *end = buffer + len;
+		while (value < end && (*value == ' ' || *value == '\t')) value++;
+		while (end > value && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' ')) end--;
+		size_t value_len = (size_t)(end - value);
+		if (value_len < sizeof(transfer->etag))
+		{
+			memcpy(transfer->etag, value, value_len);
+			transfer->etag[value_len] = 0;
+		}
 	}
-	fclose(file);
-	return NULL;
+	return len;
+}
+
+static char *read_small_file(const char *path)
+{
+	size_t len;
+	char *data = file_try_read_all(path, &len);
+	if (!data) return NULL;
+	while (len && (data[len - 1] == '\n' || data[len - 1] == '\r')) data[--len] = 0;
+	if (!len)
+	{
+		free(data);
+		return NULL;
+	}
+	return data;
+}
+
+/**
+ * @return the ETag of the cached copy, or NULL if there is no intact copy.
+ */
+static const char *cache_validate(Transfer *transfer)
+{
+	char *meta = read_small_file(transfer->cache_meta_path);
+	if (!meta) return NULL;
+	char *newline = strchr(meta, '\n');
+	unsigned long long expected;
+	if (!newline || sscanf(newline + 1, "%llx", &expected) != 1)
+	{
+		free(meta);
+		return NULL;
+	}
+	*newline = 0;
+	size_t len;
+	char *data = file_try_read_all(transfer->cache_path, &len);
+	bool intact = data && fnv1a_64(data, len, FNV1_64_SEED) == expected;
+	free(data);
+	if (!intact)
+	{
+		free(meta);
+		return NULL;
+	}
+	return meta;
+}
+
+static bool cache_copy_to(const char *from, const char *to, uint64_t *hash_ref)
+{
+	size_t len;
+	char *data = file_try_read_all(from, &len);
+	if (!data) return false;
+	bool success = file_write_all(to, data, len);
+	if (hash_ref) *hash_ref = fnv1a_64(data, len, FNV1_64_SEED);
+	free(data);
+	return success;
+}
+
+static void cache_store(Transfer *transfer)
+{
+	if (!transfer->cache_path || !transfer->etag[0]) return;
+	uint64_t hash;
+	if (!cache_copy_to(transfer->download->file_path, transfer->cache_path, &hash)) return;
+	const char *meta = str_printf("%s\n%016llx\n", transfer->etag, (unsigned long long)hash);
+	file_write_all(transfer->cache_meta_path, meta, strlen(meta));
+}
+
+static bool transfer_start(CURLM *multi, Transfer *transfer)
+{
+	transfer->etag[0] = 0;
+	transfer->headers = NULL;
+	transfer->resumed = false;
+	char *part_etag = file_exists(transfer->part_path) ? read_small_file(transfer->etag_path) : NULL;
+	size_t part_size = 0;
+	int64_t part_mtime;
+	if (part_etag && file_size_and_mtime(transfer->part_path, &part_size, &part_mtime) && part_size)
+	{
+		transfer->resumed = true;
+		transfer->headers = curl_slist_append(transfer->headers, str_printf("If-Range: %s", part_etag));
+	}
+	free(part_etag);
+	if (transfer->cached_etag)
+	{
+		transfer->headers = curl_slist_append(transfer->headers, str_printf("If-None-Match: %s", transfer->cached_etag));
+	}
+	transfer->file = fopen(transfer->part_path, transfer->resumed ? "ab" : "wb");
+	if (!transfer->file)
+	{
+		transfer->download->error = str_printf("Failed to open file '%s' for output", transfer->part_path);
+		return false;
+	}
+	CURL *handle = transfer->handle = curl_easy_init();
+	if (!handle) error_exit("Could not initialize cURL subsystem.");
+	curl_easy_setopt(handle, CURLOPT_URL, transfer->download->url);
+	curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(handle, CURLOPT_VERBOSE, 0L);
+	curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 1L);
+	curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+	// Give up on a stalled download, it is resumed on the next attempt.
+	curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, 1L);
+	curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, (long)DOWNLOAD_STALL_SECONDS);
+	curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, write_data);
+	curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer->file);
+	curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, transfer_header);
+	curl_easy_setopt(handle, CURLOPT_HEADERDATA, transfer);
+	curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer);
+	if (transfer->headers) curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->headers);
+	if (transfer->resumed) curl_easy_setopt(handle, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)part_size);
+	curl_multi_add_handle(multi, handle);
+	return true;
+}
+
+static void transfer_end(CURLM *multi, Transfer *transfer)
+{
+	curl_multi_remove_handle(multi, transfer->handle);
+	curl_easy_cleanup(transfer->handle);
+	curl_slist_free_all(transfer->headers);
+	transfer->handle = NULL;
+	transfer->headers = NULL;
+	if (transfer->file) fclose(transfer->file);
+	transfer->file = NULL;
+}
+
+/**
+ * @return true if the transfer was restarted and isn't done yet.
+ */
+static bool transfer_finish(CURLM *multi, Transfer *transfer, CURLcode result)
+{
+	Download *download = transfer->download;
+	long status = 0;
+	curl_easy_getinfo(transfer->handle, CURLINFO_RESPONSE_CODE, &status);
+	bool resumed = transfer->resumed;
+	transfer_end(multi, transfer);
+	if (result == CURLE_OK && status == 304 && transfer->cached_etag)
+	{
+		file_delete_file(transfer->part_path);
+		if (!cache_copy_to(transfer->cache_path, download->file_path, NULL))
+		{
+			download->error = str_printf("Failed to write '%s'", download->file_path);
+		}
+		return false;
+	}
+	if (result == CURLE_OK)
+	{
+		file_delete_file(transfer->etag_path);
+		if (rename(transfer->part_path, download->file_path) != 0)
+		{
+			download->error = str_printf("Failed to write '%s'", download->file_path);
+			return false;
+		}
+		cache_store(transfer);
+		return false;
+	}
+	// The part could not be resumed, e.g. the file changed, so start over.
+	if (resumed && (result == CURLE_RANGE_ERROR || status == 416))
+	{
+		file_delete_file(transfer->part_path);
+		file_delete_file(transfer->etag_path);
+		return transfer_start(multi, transfer);
+	}
+	// Keep what we got, to resume it on the next attempt.
+	if (transfer->etag[0])
+	{
+		file_write_all(transfer->etag_path, transfer->etag, strlen(transfer->etag));
+	}
+	else if (!resumed)
+	{
+		file_delete_file(transfer->part_path);
+	}
+	if (transfer->cached_etag && result != CURLE_HTTP_RETURNED_ERROR
+		&& cache_copy_to(transfer->cache_path, download->file_path, NULL))
+	{
+		return false;
+	}
+	download->error = str_copy(curl_easy_strerror(result), strlen(curl_easy_strerror(result)));
+	return false;
+}
+
+void download_files(Download *downloads, unsigned count, const char *cache_dir, DownloadDone on_done)
+{
+	CURLM *multi = curl_multi_init();
+	if (!multi) error_exit("Could not initialize cURL subsystem.");
+	// Transfers to the same host share connections, and are multiplexed where HTTP/2 is available.
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long)DOWNLOAD_MAX_PER_HOST);
+	if (cache_dir) dir_make(cache_dir);
+	Transfer *transfers = ccalloc(sizeof(Transfer), count);
+	unsigned done = 0;
+	for (unsigned i = 0; i < count; i++)
+	{
+		Transfer *transfer = &transfers[i];
+		Download *download = &downloads[i];
+		download->error = NULL;
+		transfer->download = download;
+		transfer->part_path = str_printf("%s.part", download->file_path);
+		transfer->etag_path = str_printf("%s.part.etag", download->file_path);
+		if (cache_dir)
+		{
+			uint64_t key = fnv1a_64(download->url, strlen(download->url), FNV1_64_SEED);
+			transfer->cache_path = file_append_path(cache_dir, str_printf("%016llx.c3l", (unsigned long long)key));
+			transfer->cache_meta_path = str_printf("%s.meta", transfer->cache_path);
+			transfer->cached_etag = cache_validate(transfer);
+		}
+		if (!transfer_start(multi, transfer) && on_done) on_done(download, ++done, count);
+	}
+	int running = 1;
+	while (running)
+	{
+		if (curl_multi_perform(multi, &running) != CURLM_OK) break;
+		CURLMsg *msg;
+		int queued;
+		while ((msg = curl_multi_info_read(multi, &queued)))
+		{
+			if (msg->msg != CURLMSG_DONE) continue;
+			Transfer *transfer;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+			if (transfer_finish(multi, transfer, msg->data.result))
+			{
+				running = 1;
+				continue;
+			}
+			if (on_done) on_done(transfer->download, ++done, count);
+		}
+		if (running) curl_multi_poll(multi, NULL, 0, 1000, NULL);
+	}
+	for (unsigned i = 0; i < count; i++)
+	{
+		Transfer *transfer = &transfers[i];
+		if (!transfer->handle) continue;
+		transfer_end(multi, transfer);
+		transfer->download->error = "The download was interrupted";
+		if (on_done) on_done(transfer->download, ++done, count);
+	}
+	free(transfers);
+	curl_multi_cleanup(multi);
+}
+
+const char *download_file(const char *url, const char *resource, const char *file_path)
+{
+	Download download = { .url = str_printf("%s%s", url, resource), .file_path = file_path };
+	download_files(&download, 1, NULL, NULL);
+	return download.error;
 }
 
-#endif
\ No newline at end of file
+#endif
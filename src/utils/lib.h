@@ -13,7 +13,18 @@
 #endif
 
 #if FETCH_AVAILABLE
+typedef struct
+{
+	const char *url;
+	const char *file_path;
+	// Set if the download failed.
+	const char *error;
+} Download;
+
+typedef void (*DownloadDone)(Download *download, unsigned done, unsigned total);
+
 const char *download_file(const char *url, const char *resource, const char *file_path);
+void download_files(Download *downloads, unsigned count, const char *cache_dir, DownloadDone on_done);
 #endif
 
 #define ELEMENTLEN(x) (sizeof(x) / sizeof(x[0]))
@@ -54,10 +65,18 @@ struct ScratchBuf { char str[MAX_STRING_BUFFER]; uint32_t len; };
 extern struct ScratchBuf scratch_buffer;
 
 
+typedef struct TaskBatch_
+{
+	unsigned remaining;
+} TaskBatch;
+
 typedef struct Task_
 {
 	void (*task)(void *arg);
 	void *arg;
+	// Estimated size of the task, larger tasks are scheduled first.
+	size_t cost;
+	TaskBatch *batch;
 } Task;
 
 uint16_t *win_utf8to16(const char *name);
@@ -79,11 +98,21 @@ bool file_delete_file(const char *path);
 void file_delete_dir(const char *path);
 bool file_is_dir(const char *file);
 bool file_exists(const char *path);
+bool file_size_and_mtime(const char *path, size_t *size, int64_t *mtime);
 FILE *file_open_read(const char *path);
 bool file_touch(const char *path);
 char *file_read_binary(const char *path, size_t *size);
 char *file_read_all(const char *path, size_t *return_size);
+char *file_try_read_all(const char *path, size_t *return_size);
+const char *file_map_read_only(const char *path, size_t *return_size);
+void file_unmap(const char *data, size_t size);
+bool file_buffer_needs_cleaning(const char *buffer, size_t size);
 bool file_write_all(const char *path, const char *data, size_t len);
+bool file_write_if_changed(const char *path, const char *data, size_t len);
+char *file_temp_name(const char *path);
+bool file_cache_store(const char *path, const char *key, size_t key_len, const char *data, size_t len);
+char *file_cache_fetch(const char *path, const char *key, size_t key_len, size_t *return_size);
+const char *file_create_in_memory(const char *name);
 size_t file_clean_buffer(char *buffer, const char *path, size_t file_size);
 char *file_get_dir(const char *full_path);
 void file_get_dir_and_filename_from_full(const char *full_path, char **filename, char **dir_path);
@@ -126,8 +155,14 @@ static inline void *malloc_arena(size_t len)
 #endif
 void free_arena(void);
 void print_arena_status(void);
+size_t peak_rss_kb(void);
+void arena_usage(size_t *memory, size_t *string_memory, size_t *allocations);
 void run_arena_allocator_tests(void);
-void taskqueue_run(int threads, Task **task_list);
+void taskqueue_set_threads(int threads);
+void taskqueue_submit(TaskBatch *batch, Task **task_list);
+void taskqueue_wait(TaskBatch *batch);
+void taskqueue_run(Task **task_list);
+void taskqueue_after_fork(void);
 int cpus(void);
 const char *date_get(void);
 const char *time_get(void);
@@ -204,6 +239,7 @@ static inline int char_hex_to_nibble(char c);
 INLINE char char_nibble_to_hex(int c);
 
 static inline uint32_t fnv1a(const char *key, uint32_t len);
+static inline uint64_t fnv1a_64(const void *data, size_t len, uint64_t hash);
 
 INLINE uint32_t vec_size(const void *vec);
 static inline void vec_resize(void *vec, uint32_t new_size);
@@ -252,6 +288,19 @@ static inline uint32_t fnv1a(const char *key, uint32_t len)
 	return hash;
 }
 
+#define FNV1_64_PRIME 0x100000001B3ull
+#define FNV1_64_SEED 0xCBF29CE484222325ull
+
+static inline uint64_t fnv1a_64(const void *data, size_t len, uint64_t hash)
+{
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < len; i++)
+	{
+		hash = (hash ^ bytes[i]) * FNV1_64_PRIME;
+	}
+	return hash;
+}
+
 typedef struct
 {
 	uint32_t size;
@@ -450,6 +499,17 @@ static int clz(uint64_t num)
 #endif
 }
 
+static inline int ctz(uint64_t num)
+{
+#if IS_CLANG || IS_GCC
+	return (int)__builtin_ctzll(num);
+#else
+	unsigned long index;
+	_BitScanForward64(&index, (__int64)num);
+	return (int)index;
+#endif
+}
+
 static inline unsigned char power_of_2(uint64_t pot_value)
 {
 	return 64 - clz(pot_value);
@@ -4,6 +4,12 @@
 
 #include "common.h"
 #include "vmem.h"
+#if PLATFORM_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#elif PLATFORM_POSIX
+#include <sys/resource.h>
+#endif
 
 #define KB 1024ul
 // Use 1MB at a time.
@@ -52,9 +58,42 @@ void *calloc_arena(size_t mem)
 void print_arena_status(void)
 {
 	printf("-- ARENA INFO -- \n");
-	printf(" * Memory used:  %zu Kb\n", arena.allocated / 1024);
+	printf(" * Memory used:  %zu Kb (%.1f%% of %zu Mb reserved)\n", arena.allocated / 1024,
+	       arena.allocated * 100.0 / arena.size, arena.size / MB);
 	printf(" * Allocations: %d\n", allocations_done);
 	printf(" * String memory used:  %zu Kb\n", char_arena.allocated / 1024);
+	if (arena.prefaults || char_arena.prefaults)
+	{
+		printf(" * Prefaulted:  %zu Kb (%u times)\n", (arena.prefaulted + char_arena.prefaulted) / 1024,
+		       arena.prefaults + char_arena.prefaults);
+	}
+}
+
+void arena_usage(size_t *memory, size_t *string_memory, size_t *allocations)
+{
+	*memory = arena.allocated;
+	*string_memory = char_arena.allocated;
+	*allocations = (size_t)allocations_done;
+}
+
+size_t peak_rss_kb(void)
+{
+#if PLATFORM_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.PeakWorkingSetSize / KB;
+#elif PLATFORM_POSIX
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)) return 0;
+#if __APPLE__
+	// MacOS reports bytes rather than kilobytes.
+	return (size_t)usage.ru_maxrss / KB;
+#else
+	return (size_t)usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
 }
 
 void free_arena(void)
@@ -2,113 +2,314 @@
 #include "compiler_tests/benchmark.h"
 
 // Our task queue is only made for scheduling compilation tasks so there is
-// a single thread that adds the tasks.
+// a single thread that adds the tasks: the main thread.
+//
+// The worker threads are started by the first batch and are then reused by
+// every later stage, so a run that never submits a batch starts no threads. Tasks are submitted in batches, which are sorted largest
+// first and dealt out round-robin to one deque per worker. A worker takes from
+// its own deque, and once that is empty it steals the largest waiting task of
+// the other workers, so a big task started late doesn't leave the other threads
+// idle.
+// The main thread helps out with any queued task while it waits for a batch,
+// so batches submitted back to back overlap.
 
 #if USE_PTHREAD
 #include <pthread.h>
+typedef pthread_mutex_t TaskLock;
+typedef pthread_cond_t TaskCondition;
+typedef pthread_t TaskThread;
+#define TASK_LOCK_INIT(lock_) do { if (pthread_mutex_init(lock_, NULL)) error_exit("Failed to set up mutex"); } while (0)
+#define TASK_LOCK(lock_) pthread_mutex_lock(lock_)
+#define TASK_UNLOCK(lock_) pthread_mutex_unlock(lock_)
+#define TASK_CONDITION_INIT(cond_) do { if (pthread_cond_init(cond_, NULL)) error_exit("Failed to set up condition"); } while (0)
+#define TASK_CONDITION_WAIT(cond_, lock_) pthread_cond_wait(cond_, lock_)
+#define TASK_CONDITION_SIGNAL_ALL(cond_) pthread_cond_broadcast(cond_)
+#elif PLATFORM_WINDOWS
+#include <Windows.h>
+#include <process.h>
+typedef CRITICAL_SECTION TaskLock;
+typedef CONDITION_VARIABLE TaskCondition;
+typedef HANDLE TaskThread;
+#define TASK_LOCK_INIT(lock_) InitializeCriticalSection(lock_)
+#define TASK_LOCK(lock_) EnterCriticalSection(lock_)
+#define TASK_UNLOCK(lock_) LeaveCriticalSection(lock_)
+#define TASK_CONDITION_INIT(cond_) InitializeConditionVariable(cond_)
+#define TASK_CONDITION_WAIT(cond_, lock_) SleepConditionVariableCS(cond_, lock_, INFINITE)
+#define TASK_CONDITION_SIGNAL_ALL(cond_) WakeAllConditionVariable(cond_)
+#endif
 
-typedef struct TaskQueue_
+typedef struct
 {
-	pthread_mutex_t lock;
-	Task **queue;
-} TaskQueue;
+	Task *task;
+	unsigned index;
+} TaskOrder;
 
-static void *taskqueue_thread(void *data)
+static int task_order_compare(const void *a, const void *b)
 {
-	TaskQueue *task_queue = data;
-	while (1)
-	{
-		pthread_mutex_lock(&task_queue->lock);
-		unsigned task_count = vec_size(task_queue->queue);
-		if (!task_count) goto SHUTDOWN;
-		Task *task = (Task*)task_queue->queue[task_count - 1];
-		vec_pop(task_queue->queue);
-		pthread_mutex_unlock(&task_queue->lock);
-		task->task(task->arg);
-	}
-SHUTDOWN:
-	pthread_mutex_unlock(&task_queue->lock);
-	pthread_exit(NULL);
-	return NULL;
+	const TaskOrder *left = a;
+	const TaskOrder *right = b;
+	if (left->task->cost != right->task->cost) return left->task->cost > right->task->cost ? -1 : 1;
+	// Keep the original order for equal costs.
+	return left->index < right->index ? -1 : 1;
+}
+
+static Task **taskqueue_sort(Task **task_list, unsigned count)
+{
+	TaskOrder *order = cmalloc(sizeof(TaskOrder) * count);
+	for (unsigned i = 0; i < count; i++) order[i] = (TaskOrder) { task_list[i], i };
+	qsort(order, count, sizeof(TaskOrder), task_order_compare);
+	Task **sorted = cmalloc(sizeof(Task *) * count);
+	for (unsigned i = 0; i < count; i++) sorted[i] = order[i].task;
+	free(order);
+	return sorted;
 }
 
-void taskqueue_run(int threads, Task **task_list)
+#if USE_PTHREAD || PLATFORM_WINDOWS
+
+typedef struct
+{
+	TaskLock lock;
+	Task **tasks;
+	unsigned head;
+	unsigned tail;
+	unsigned capacity;
+} TaskDeque;
+
+typedef struct
 {
-	ASSERT(threads > 0);
-	pthread_t *pthreads = malloc(sizeof(pthread_t) * (unsigned)threads);
-	TaskQueue queue = { .queue = task_list };
-	if (pthread_mutex_init(&queue.lock, NULL)) error_exit("Failed to set up mutex");
-	for (int i = 0; i < threads; i++)
+	// Guards pending, the batch counters and sleeping.
+	TaskLock lock;
+	// Signalled when tasks are submitted.
+	TaskCondition work_available;
+	// Signalled when a batch completes.
+	TaskCondition batch_done;
+	unsigned pending;
+	TaskDeque *deques;
+	unsigned workers;
+	unsigned next_deque;
+} TaskPool;
+
+static TaskPool pool;
+static int pool_threads = 1;
+
+static Task *taskqueue_take(TaskDeque *deque)
+{
+	TASK_LOCK(&deque->lock);
+	Task *task = NULL;
+	if (deque->head < deque->tail)
 	{
-		if (pthread_create(&pthreads[i], NULL, taskqueue_thread, &queue)) error_exit("Fail to set up thread pool");
+		task = deque->tasks[deque->head++];
+		if (deque->head == deque->tail) deque->head = deque->tail = 0;
 	}
-	for (int i = 0; i < threads; i++)
+	TASK_UNLOCK(&deque->lock);
+	return task;
+}
+
+static void taskqueue_put(TaskDeque *deque, Task *task)
+{
+	TASK_LOCK(&deque->lock);
+	if (deque->tail == deque->capacity)
 	{
-		if (pthread_join(pthreads[i], NULL) != 0) error_exit("Failed to join thread.");
+		deque->capacity = deque->capacity ? deque->capacity * 2 : 64;
+		deque->tasks = realloc(deque->tasks, sizeof(Task *) * deque->capacity);
+		if (!deque->tasks) error_exit("Failed to allocate the task queue.");
 	}
-	free(pthreads);
-	pthread_mutex_destroy(&queue.lock);
+	deque->tasks[deque->tail++] = task;
+	TASK_UNLOCK(&deque->lock);
 }
 
-#elif PLATFORM_WINDOWS
+// Get the cost of the next task in the deque. Batches are queued largest first.
+static bool taskqueue_peek_cost(TaskDeque *deque, size_t *cost_ref)
+{
+	TASK_LOCK(&deque->lock);
+	bool found = deque->head < deque->tail;
+	if (found) *cost_ref = deque->tasks[deque->head]->cost;
+	TASK_UNLOCK(&deque->lock);
+	return found;
+}
 
-#include <Windows.h>
-#include <process.h>
+// Find a task in the deque at 'own', or else steal the largest one queued elsewhere.
+static Task *taskqueue_find(unsigned own)
+{
+	Task *task = taskqueue_take(&pool.deques[own]);
+	while (!task)
+	{
+		bool found = false;
+		size_t best_cost = 0;
+		unsigned best = 0;
+		for (unsigned i = 1; i < pool.workers; i++)
+		{
+			unsigned index = (own + i) % pool.workers;
+			size_t cost;
+			if (!taskqueue_peek_cost(&pool.deques[index], &cost)) continue;
+			if (found && cost <= best_cost) continue;
+			found = true;
+			best_cost = cost;
+			best = index;
+		}
+		if (!found) return NULL;
+		// Another thread may have taken it in the meantime, then look again.
+		task = taskqueue_take(&pool.deques[best]);
+	}
+	TASK_LOCK(&pool.lock);
+	pool.pending--;
+	TASK_UNLOCK(&pool.lock);
+	return task;
+}
 
-typedef struct TaskQueue_
+static void taskqueue_execute(Task *task)
 {
-	CRITICAL_SECTION lock;
-	Task **queue;
-} TaskQueue;
+	TaskBatch *batch = task->batch;
+	task->task(task->arg);
+	TASK_LOCK(&pool.lock);
+	if (!--batch->remaining) TASK_CONDITION_SIGNAL_ALL(&pool.batch_done);
+	TASK_UNLOCK(&pool.lock);
+}
 
-static unsigned WINAPI taskqueue_thread(LPVOID lpParam)
+static void taskqueue_work(unsigned index)
 {
-	TaskQueue *task_queue = (TaskQueue *)lpParam;
-	bool is_active = false;
 	while (1)
 	{
-		EnterCriticalSection(&task_queue->lock);
-		unsigned task_count = vec_size(task_queue->queue);
-		if (!task_count) goto SHUTDOWN;
-		Task *task = (Task*)task_queue->queue[task_count - 1];
-		vec_pop(task_queue->queue);
-		LeaveCriticalSection(&task_queue->lock);
-		task->task(task->arg);
+		Task *task = taskqueue_find(index);
+		if (task)
+		{
+			taskqueue_execute(task);
+			continue;
+		}
+		TASK_LOCK(&pool.lock);
+		while (!pool.pending) TASK_CONDITION_WAIT(&pool.work_available, &pool.lock);
+		TASK_UNLOCK(&pool.lock);
 	}
-SHUTDOWN:
-	LeaveCriticalSection(&task_queue->lock);
+}
+
+#if USE_PTHREAD
+static void *taskqueue_thread(void *data)
+{
+	taskqueue_work((unsigned)(uintptr_t)data);
+	return NULL;
+}
+
+static void taskqueue_start_thread(unsigned index)
+{
+	// The workers live until the process exits, so they are never joined.
+	TaskThread thread;
+	if (pthread_create(&thread, NULL, taskqueue_thread, (void *)(uintptr_t)index)) error_exit("Fail to set up thread pool");
+	pthread_detach(thread);
+}
+#else
+static unsigned WINAPI taskqueue_thread(LPVOID lpParam)
+{
+	taskqueue_work((unsigned)(uintptr_t)lpParam);
 	return 0;
 }
 
-void taskqueue_run(int threads, Task **task_list)
+static void taskqueue_start_thread(unsigned index)
+{
+	// The workers live until the process exits, so they are never joined.
+	TaskThread thread = (HANDLE)_beginthreadex(NULL, 0, taskqueue_thread, (void *)(uintptr_t)index, 0, NULL);
+	if (thread == NULL) error_exit("Fail to set up thread pool");
+	CloseHandle(thread);
+}
+#endif
+
+void taskqueue_set_threads(int threads)
+{
+	pool_threads = threads;
+}
+
+static void taskqueue_start(void)
 {
-	ASSERT(threads > 0);
-	HANDLE *handles = malloc(sizeof(HANDLE) * (unsigned)threads);
-	TaskQueue queue = { .queue = task_list };
-	InitializeCriticalSection(&queue.lock);
-	for (int i = 0; i < threads; i++)
+	// The main thread runs tasks too while waiting, so it counts as one of the threads.
+	unsigned workers = pool_threads > 1 ? (unsigned)pool_threads - 1 : 0;
+	TASK_LOCK_INIT(&pool.lock);
+	TASK_CONDITION_INIT(&pool.work_available);
+	TASK_CONDITION_INIT(&pool.batch_done);
+	// Always have one deque, so that there is somewhere to queue tasks.
+	pool.deques = ccalloc(sizeof(TaskDeque), workers ? workers : 1);
+	pool.workers = workers ? workers : 1;
+	for (unsigned i = 0; i < pool.workers; i++) TASK_LOCK_INIT(&pool.deques[i].lock);
+	for (unsigned i = 0; i < workers; i++) taskqueue_start_thread(i);
+}
+
+void taskqueue_submit(TaskBatch *batch, Task **task_list)
+{
+	if (!pool.deques) taskqueue_start();
+	unsigned count = vec_size(task_list);
+	batch->remaining = count;
+	if (!count) return;
+	Task **sorted = taskqueue_sort(task_list, count);
+	// Count the tasks before queuing them, so that pending never drops below zero.
+	TASK_LOCK(&pool.lock);
+	pool.pending += count;
+	TASK_UNLOCK(&pool.lock);
+	// Deal the sorted tasks round-robin, so every worker starts with one of the largest.
+	for (unsigned i = 0; i < count; i++)
 	{
-		handles[i] = (HANDLE)_beginthreadex(NULL, 0, taskqueue_thread, &queue, 0, NULL);
-		if (handles[i] == NULL) error_exit("Fail to set up thread pool");
+		sorted[i]->batch = batch;
+		taskqueue_put(&pool.deques[pool.next_deque], sorted[i]);
+		pool.next_deque = (pool.next_deque + 1) % pool.workers;
 	}
-	WaitForMultipleObjects(threads, handles, TRUE, INFINITE);
+	free(sorted);
+	TASK_LOCK(&pool.lock);
+	TASK_CONDITION_SIGNAL_ALL(&pool.work_available);
+	TASK_UNLOCK(&pool.lock);
+}
 
-	for (int i = 0; i < threads; i++)
+void taskqueue_after_fork(void)
+{
+	// Only the forking thread exists in the child, so drop the old pool
+	// and let the next batch start new workers.
+	pool = (TaskPool) { 0 };
+}
+
+void taskqueue_wait(TaskBatch *batch)
+{
+	while (1)
 	{
-		CloseHandle(handles[i]);
+		TASK_LOCK(&pool.lock);
+		while (batch->remaining && !pool.pending) TASK_CONDITION_WAIT(&pool.batch_done, &pool.lock);
+		bool done = !batch->remaining;
+		TASK_UNLOCK(&pool.lock);
+		if (done) return;
+		Task *task = taskqueue_find(0);
+		if (task) taskqueue_execute(task);
 	}
-	free((void*)handles);
-	DeleteCriticalSection(&queue.lock);
 }
 
 #else
 
-void taskqueue_run(int threads, Task **task_list)
+void taskqueue_set_threads(int threads)
 {
-	FOREACH(Task *, task, task_list)
+}
+
+void taskqueue_after_fork(void)
+{
+}
+
+void taskqueue_submit(TaskBatch *batch, Task **task_list)
+{
+	unsigned count = vec_size(task_list);
+	batch->remaining = count;
+	if (!count) return;
+	Task **sorted = taskqueue_sort(task_list, count);
+	for (unsigned i = 0; i < count; i++)
 	{
-		task->task(task->arg);
+		sorted[i]->task(sorted[i]->arg);
 	}
+	batch->remaining = 0;
+	free(sorted);
+}
+
+void taskqueue_wait(TaskBatch *batch)
+{
+	ASSERT(!batch->remaining);
 }
 
-#endif
\ No newline at end of file
+#endif
+
+void taskqueue_run(Task **task_list)
+{
+	TaskBatch batch;
+	taskqueue_submit(&batch, task_list);
+	taskqueue_wait(&batch);
+}
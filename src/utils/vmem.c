@@ -16,6 +16,12 @@
 #define COMMIT_PAGE_SIZE 0x10000
 #endif
 
+// With huge pages, memory is made resident this much at a time.
+#define PREFAULT_CHUNK (2 * 1024 * 1024)
+#define PREFAULT_TOUCH_STRIDE 4096
+
+static bool huge_pages = false;
+
 
 static inline void mmap_init(Vmem *vmem, size_t size)
 {
@@ -45,6 +51,10 @@ static inline void mmap_init(Vmem *vmem, size_t size)
 	{
 		FATAL_ERROR("Failed to map a virtual memory block.");
 	}
+#ifdef MADV_HUGEPAGE
+	// Only a hint, if transparent huge pages are unavailable we just get normal pages.
+	if (huge_pages) madvise(ptr, size, MADV_HUGEPAGE);
+#endif
 	// Otherwise, record the size and we're fine!
 #else
 	FATAL_ERROR("Unsupported platform.");
@@ -52,21 +62,54 @@ static inline void mmap_init(Vmem *vmem, size_t size)
 	vmem->size = size;
 	vmem->ptr = ptr;
 	vmem->allocated = 0;
+	vmem->prefaulted = 0;
+	vmem->prefaults = 0;
 }
 
+#if PLATFORM_POSIX
+// Make the memory up to the next chunk boundary resident in one go, rather than
+// taking a page fault for every page the first time it's used.
+static void mmap_prefault(Vmem *vmem, size_t allocated_after)
+{
+	size_t end = (allocated_after + PREFAULT_CHUNK - 1) / PREFAULT_CHUNK * PREFAULT_CHUNK;
+	if (end > vmem->size) end = vmem->size;
+	uint8_t *start = ((uint8_t *)vmem->ptr) + vmem->prefaulted;
+	size_t len = end - vmem->prefaulted;
+#ifdef MADV_POPULATE_WRITE
+	if (madvise(start, len, MADV_POPULATE_WRITE) != 0)
+#endif
+	{
+		// Nothing is allocated past the old prefault point, so writing zeroes is safe.
+		for (size_t i = 0; i < len; i += PREFAULT_TOUCH_STRIDE)
+		{
+			((volatile uint8_t *)start)[i] = 0;
+		}
+	}
+	vmem->prefaulted = end;
+	vmem->prefaults++;
+}
+#endif
+
 static inline void* mmap_allocate(Vmem *vmem, size_t to_allocate)
 {
 	size_t allocated_after = to_allocate + vmem->allocated;
 #if PLATFORM_WINDOWS
-	size_t blocks_committed = vmem->committed / COMMIT_PAGE_SIZE;
-	size_t end_block = (allocated_after + COMMIT_PAGE_SIZE - 1) / COMMIT_PAGE_SIZE;  // round up
+	// Large pages can't be committed incrementally, so instead commit in bigger blocks.
+	size_t commit_size = huge_pages ? PREFAULT_CHUNK : COMMIT_PAGE_SIZE;
+	size_t blocks_committed = vmem->committed / commit_size;
+	size_t end_block = (allocated_after + commit_size - 1) / commit_size;  // round up
 	size_t blocks_to_allocate = end_block - blocks_committed;
 	if (blocks_to_allocate > 0)
 	{
-		size_t to_commit = blocks_to_allocate * COMMIT_PAGE_SIZE;
+		size_t to_commit = blocks_to_allocate * commit_size;
 		void *res = VirtualAlloc(((char*)vmem->ptr) + vmem->committed, to_commit, MEM_COMMIT, PAGE_READWRITE);
 		if (!res) FATAL_ERROR("Failed to allocate more memory.");
 		vmem->committed += to_commit;
+		if (huge_pages)
+		{
+			vmem->prefaulted = vmem->committed;
+			vmem->prefaults++;
+		}
 	}
 #endif
 	void *ptr = ((uint8_t *)vmem->ptr) + vmem->allocated;
@@ -76,6 +119,9 @@ static inline void* mmap_allocate(Vmem *vmem, size_t to_allocate)
 		error_exit("Error: The compiler ran out of memory! Over %u MB was allocated from a single memory arena, perhaps "
 				   "you called some recursive macro?", (unsigned)(vmem->size / (1024 * 1024)));
 	}
+#if PLATFORM_POSIX
+	if (huge_pages && allocated_after > vmem->prefaulted) mmap_prefault(vmem, allocated_after);
+#endif
 	return ptr;
 }
 
@@ -85,6 +131,11 @@ void vmem_set_max_limit(size_t size_in_mb)
 	max = size_in_mb;
 }
 
+void vmem_set_huge_pages(bool use_huge_pages)
+{
+	huge_pages = use_huge_pages;
+}
+
 void vmem_init(Vmem *vmem, size_t size_in_mb)
 {
 	if (size_in_mb > max) size_in_mb = max;
@@ -107,4 +158,4 @@ void vmem_free(Vmem *vmem)
 	vmem->allocated = 0;
 	vmem->ptr = 0;
 	vmem->size = 0;
-}
\ No newline at end of file
+}
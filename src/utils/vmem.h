@@ -14,9 +14,13 @@ typedef struct
 #if PLATFORM_WINDOWS
 	size_t committed;
 #endif
+	// Bytes made resident ahead of use, and the number of times it was done.
+	size_t prefaulted;
+	unsigned prefaults;
 } Vmem;
 
 void vmem_init(Vmem *vmem, size_t size_in_mb);
 void *vmem_alloc(Vmem *vmem, size_t alloc);
 void vmem_free(Vmem *vmem);
-void vmem_set_max_limit(size_t size_in_mb);
\ No newline at end of file
+void vmem_set_max_limit(size_t size_in_mb);
+void vmem_set_huge_pages(bool use_huge_pages);
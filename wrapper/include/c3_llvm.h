@@ -35,12 +35,27 @@ typedef enum
 	LLVM_Oz
 } LLVMOptLevels;
 
+typedef struct
+{
+	char *name;
+	double seconds;
+	unsigned runs;
+} LLVMPassTiming;
+
 typedef struct
 {
 	bool should_debug;
 	bool should_verify;
 	LLVMOptLevels opt_level;
 	bool is_kernel;
+	bool thin_lto;
+	// A textual pipeline replacing the default one, or NULL.
+	const char *pipeline;
+	struct
+	{
+		bool instrument;
+		const char *profile;
+	} pgo;
 	struct
 	{
 		bool recover;
@@ -64,9 +79,18 @@ typedef struct
 		bool slp_vectorize;
 		bool merge_functions;
 	} opt;
+	struct
+	{
+		bool enabled;
+		// Filled in by llvm_run_passes, slowest first. The caller frees the names and the array.
+		LLVMPassTiming *entries;
+		unsigned count;
+	} timing;
 } LLVMPasses;
 
 bool llvm_run_passes(LLVMModuleRef m, LLVMTargetMachineRef tm, LLVMPasses *passes);
+bool llvm_write_thin_lto_bitcode(LLVMModuleRef m, const char *filename);
+bool llvm_emit_object_split_dwarf(LLVMTargetMachineRef ref, LLVMModuleRef m, const char *obj_file, const char *dwo_file);
 bool llvm_link_elf(const char **args, int arg_count, const char **error_string);
 bool llvm_link_macho(const char **args, int arg_count, const char **error_string);
 bool llvm_link_coff(const char **args, int arg_count, const char **error_string);
@@ -79,6 +103,10 @@ void LLVMBuilderSetFastMathFlags(LLVMBuilderRef Builder, FastMathOption option);
 void LLVMSetDSOLocal(LLVMValueRef Global, bool value);
 void LLVMSetTargetMachineUseInitArray(LLVMTargetMachineRef ref, bool use_init_array);
 void LLVMSetNoSanitizeAddress(LLVMValueRef Global);
+void LLVMDIBuilderRetainType(LLVMDIBuilderRef Builder, LLVMMetadataRef Type);
+// Clone a function in its module, the clone has internal linkage.
+LLVMValueRef LLVMCloneFunctionInternal(LLVMValueRef Fn, const char *Name);
+void LLVMDeleteFunctionBody(LLVMValueRef Fn);
 
 #ifdef __cplusplus
 }
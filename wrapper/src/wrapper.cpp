@@ -2,7 +2,9 @@
 // For hacking the C API
 #include <llvm/IR/PassManager.h>
 #include "c3_llvm.h"
+#include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ArchiveWriter.h"
 #include "llvm/Object/IRObjectFile.h"
@@ -28,7 +30,16 @@
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Scalar/JumpThreading.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/PGOOptions.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
 static_assert(LLVM_VERSION_MAJOR >= 17, "Unsupported LLVM version, 17+ is needed.");
 
 #define LINK_SIG \
@@ -131,6 +142,57 @@ static bool llvm_link(ObjFormat format, const char **args, int arg_count, const
 	return success;
 }
 
+// Times every pass and analysis, not counting the time spent in the passes it runs itself.
+// Each llvm_run_passes call has its own, so modules can be optimized in parallel.
+struct PassTimer
+{
+	struct Frame
+	{
+		std::chrono::steady_clock::time_point start;
+		double children;
+	};
+	std::vector<Frame> stack;
+	llvm::StringMap<std::pair<double, unsigned>> totals;
+
+	void begin()
+	{
+		stack.push_back({ std::chrono::steady_clock::now(), 0 });
+	}
+
+	void end(llvm::StringRef name)
+	{
+		Frame frame = stack.back();
+		stack.pop_back();
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - frame.start).count();
+		auto &total = totals[name];
+		total.first += elapsed - frame.children;
+		total.second++;
+		if (!stack.empty()) stack.back().children += elapsed;
+	}
+
+	void register_callbacks(llvm::PassInstrumentationCallbacks &PIC)
+	{
+		PIC.registerBeforeNonSkippedPassCallback([this](llvm::StringRef, llvm::Any) { begin(); });
+		PIC.registerAfterPassCallback([this](llvm::StringRef name, llvm::Any, const llvm::PreservedAnalyses &) { end(name); });
+		PIC.registerAfterPassInvalidatedCallback([this](llvm::StringRef name, const llvm::PreservedAnalyses &) { end(name); });
+		PIC.registerBeforeAnalysisCallback([this](llvm::StringRef, llvm::Any) { begin(); });
+		PIC.registerAfterAnalysisCallback([this](llvm::StringRef name, llvm::Any) { end(name); });
+	}
+
+	void store(LLVMPasses *passes)
+	{
+		passes->timing.count = totals.size();
+		passes->timing.entries = (LLVMPassTiming *)calloc(totals.size() ? totals.size() : 1, sizeof(LLVMPassTiming));
+		unsigned index = 0;
+		for (auto &entry : totals)
+		{
+			passes->timing.entries[index++] = { strdup(entry.getKey().str().c_str()), entry.getValue().first, entry.getValue().second };
+		}
+		std::sort(passes->timing.entries, passes->timing.entries + index,
+		          [](const LLVMPassTiming &a, const LLVMPassTiming &b) { return a.seconds > b.seconds; });
+	}
+};
+
 extern "C" {
 
 
@@ -143,6 +205,8 @@ bool llvm_run_passes(LLVMModuleRef m, LLVMTargetMachineRef tm, LLVMPasses *passe
 	llvm::TargetMachine *Machine = (llvm::TargetMachine *)(tm);
 	llvm::Module *Mod = llvm::unwrap(m);
 	llvm::PassInstrumentationCallbacks PIC;
+	PassTimer timer;
+	if (passes->timing.enabled) timer.register_callbacks(PIC);
 	llvm::PipelineTuningOptions PTO{};
 	PTO.LoopUnrolling = passes->opt.unroll_loops;
 	PTO.LoopInterleaving = passes->opt.interleave_loops;
@@ -153,7 +217,17 @@ bool llvm_run_passes(LLVMModuleRef m, LLVMTargetMachineRef tm, LLVMPasses *passe
 #if LLVM_VERSION_MAJOR > 16
 	PTO.UnifiedLTO = false;
 #endif
-	llvm::PassBuilder PB(Machine, PTO, std::nullopt, &PIC);
+	std::optional<llvm::PGOOptions> PGOOpt;
+	if (passes->pgo.instrument)
+	{
+		// An empty file name makes the runtime write default_<hash>.profraw.
+		PGOOpt = llvm::PGOOptions("", "", "", "", llvm::vfs::getRealFileSystem(), llvm::PGOOptions::IRInstr);
+	}
+	else if (passes->pgo.profile)
+	{
+		PGOOpt = llvm::PGOOptions(passes->pgo.profile, "", "", "", llvm::vfs::getRealFileSystem(), llvm::PGOOptions::IRUse);
+	}
+	llvm::PassBuilder PB(Machine, PTO, PGOOpt, &PIC);
 
 	llvm::LoopAnalysisManager LAM;
 	llvm::FunctionAnalysisManager FAM;
@@ -197,11 +271,40 @@ bool llvm_run_passes(LLVMModuleRef m, LLVMTargetMachineRef tm, LLVMPasses *passe
 		default:
 			exit(-1);
 	}
+	llvm::ModulePassManager MPM;
+	if (passes->pipeline)
+	{
+		// The sanitizers are still added after an explicit pipeline.
+		if (auto Err = PB.parsePassPipeline(MPM, passes->pipeline))
+		{
+			llvm::errs() << "Invalid pass pipeline '" << passes->pipeline << "': " << llvm::toString(std::move(Err)) << "\n";
+			return false;
+		}
+	}
+	else if (passes->thin_lto)
+	{
+		// Only the pre-link part runs here, the rest is done by the linker across all modules.
+		if (passes->opt_level == LLVM_O0)
+		{
 #if LLVM_VERSION_MAJOR > 19
-	llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(level, llvm::ThinOrFullLTOPhase::None);
+			MPM = PB.buildO0DefaultPipeline(level, llvm::ThinOrFullLTOPhase::ThinLTOPreLink);
 #else
-	llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(level, false);
+			MPM = PB.buildO0DefaultPipeline(level, true);
 #endif
+		}
+		else
+		{
+			MPM = PB.buildThinLTOPreLinkDefaultPipeline(level);
+		}
+	}
+	else
+	{
+#if LLVM_VERSION_MAJOR > 19
+		MPM = PB.buildPerModuleDefaultPipeline(level, llvm::ThinOrFullLTOPhase::None);
+#else
+		MPM = PB.buildPerModuleDefaultPipeline(level, false);
+#endif
+	}
 	if (passes->should_verify)
 	{
 		MPM.addPass(llvm::VerifierPass());
@@ -262,9 +365,47 @@ bool llvm_run_passes(LLVMModuleRef m, LLVMTargetMachineRef tm, LLVMPasses *passe
 	// MPM.addPass(DataFlowSanitizerPass(LangOpts.NoSanitizeFiles));
 
 	MPM.run(*Mod, MAM);
+	if (passes->timing.enabled) timer.store(passes);
 	return true;
 }
 
+bool llvm_write_thin_lto_bitcode(LLVMModuleRef m, const char *filename)
+{
+	llvm::Module *Mod = llvm::unwrap(m);
+	std::error_code EC;
+	llvm::raw_fd_ostream OS(filename, EC, llvm::sys::fs::OF_None);
+	if (EC) return false;
+	// The summary is what lets the linker import functions between modules.
+	llvm::ModuleSummaryIndex Index = llvm::buildModuleSummaryIndex(*Mod, nullptr, nullptr);
+	llvm::WriteBitcodeToFile(*Mod, OS, false, &Index, true);
+	OS.flush();
+	return !OS.has_error();
+}
+
+bool llvm_emit_object_split_dwarf(LLVMTargetMachineRef ref, LLVMModuleRef m, const char *obj_file, const char *dwo_file)
+{
+	auto machine = (llvm::TargetMachine*)ref;
+	llvm::Module *Mod = llvm::unwrap(m);
+	std::error_code EC;
+	llvm::raw_fd_ostream OS(obj_file, EC, llvm::sys::fs::OF_None);
+	if (EC) return false;
+	llvm::raw_fd_ostream DwoOS(dwo_file, EC, llvm::sys::fs::OF_None);
+	if (EC) return false;
+	// The C API has no way to set the .dwo stream, so use the legacy codegen pipeline directly.
+	machine->Options.MCOptions.SplitDwarfFile = dwo_file;
+	llvm::legacy::PassManager PM;
+#if LLVM_VERSION_MAJOR > 17
+	auto file_type = llvm::CodeGenFileType::ObjectFile;
+#else
+	auto file_type = llvm::CGFT_ObjectFile;
+#endif
+	if (machine->addPassesToEmitFile(PM, OS, &DwoOS, file_type)) return false;
+	PM.run(*Mod);
+	OS.flush();
+	DwoOS.flush();
+	return !OS.has_error() && !DwoOS.has_error();
+}
+
 bool llvm_ar(const char *out_name, const char **args, size_t count, int ArFormat)
 {
 	llvm::object::Archive::Kind kind;
@@ -324,6 +465,29 @@ void LLVMSetDSOLocal(LLVMValueRef Global, bool value)
 	llvm::unwrap<llvm::GlobalValue>(Global)->setDSOLocal(value);
 }
 
+void LLVMDIBuilderRetainType(LLVMDIBuilderRef Builder, LLVMMetadataRef Type)
+{
+	auto builder = (llvm::DIBuilder*)Builder;
+	builder->retainType(llvm::unwrap<llvm::DIScope>(Type));
+}
+
+LLVMValueRef LLVMCloneFunctionInternal(LLVMValueRef Fn, const char *Name)
+{
+	llvm::ValueToValueMapTy map;
+	llvm::Function *clone = llvm::CloneFunction(llvm::unwrap<llvm::Function>(Fn), map);
+	clone->setName(Name);
+	clone->setComdat(nullptr);
+	clone->setLinkage(llvm::GlobalValue::InternalLinkage);
+	clone->setVisibility(llvm::GlobalValue::DefaultVisibility);
+	clone->setDLLStorageClass(llvm::GlobalValue::DefaultStorageClass);
+	return llvm::wrap(clone);
+}
+
+void LLVMDeleteFunctionBody(LLVMValueRef Fn)
+{
+	llvm::unwrap<llvm::Function>(Fn)->deleteBody();
+}
+
 void LLVMSetNoSanitizeAddress(LLVMValueRef Global)
 {
 	auto global = llvm::unwrap<llvm::GlobalValue>(Global);